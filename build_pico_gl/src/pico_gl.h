@@ -12,9 +12,16 @@
     - Single header library for easy build system integration
     - Embeds GLAD for seamless OpenGL function loading
     - Simple texture and shader creation
+    - Optional on-disk cache of linked shader programs
     - Default shader and uniforms
     - Rendering of dynamic vertex arrays and static vertex buffers
+    - Streaming uploads of dynamic vertex arrays without driver stalls
+    - Automatic batching of consecutive vertex array draws
+    - Custom vertex formats with compact attribute types
+    - Geometry pools that draw many static meshes in one call
+    - Instanced drawing of vertex buffers
     - Render to texture
+    - Asynchronous texture uploads through pixel buffer objects
     - Simplified shader uniform setters
     - State stack
     - Simple and concise API
@@ -45,7 +52,66 @@
     stack, make some local changes, and pop the stack to restore the original
     state.
 
-    Uniforms can be set using a simple, fast, and concise API.
+    Linked shader programs can be cached on disk by calling
+    `pgl_set_program_cache_dir`. `pgl_create_shader` then loads programs with
+    `glProgramBinary` when a binary for the same sources and driver exists,
+    skipping compilation, linking, and uniform enumeration. Otherwise the
+    program is compiled and its binary is written to the cache. The cache is
+    only used if program binaries are available (GLES 3.0 and later).
+
+    Uniforms can be set using a simple, fast, and concise API. Each shader
+    keeps a copy of the values last sent to its uniforms, so setting a uniform
+    to its current value does not reach OpenGL (or interrupt a batch). Uniforms
+    that are set often can be looked up once with `pgl_get_uniform_handle` and
+    then set with `pgl_set_uniform`.
+
+    Vertex and index arrays passed to `pgl_draw_array` and
+    `pgl_draw_indexed_array` are written into a streaming ring buffer instead of
+    reallocating GPU storage on every draw. The ring is divided into segments
+    that are guarded by fences, so data is only overwritten once the GPU has
+    finished reading it. The ring grows (orphaning the old storage) if a single
+    draw does not fit.
+
+    Consecutive calls to `pgl_draw_array` that share the same texture, shader,
+    and state are merged into a single draw call. Strips are converted into
+    lists so that they can be merged as well. Batched vertices are drawn when
+    the state changes, the batch is full, the render target changes, or
+    `pgl_flush` is called. Call `pgl_flush` before presenting a frame or making
+    OpenGL calls directly.
+
+    Vertices are not limited to `pgl_vertex_t`. A `pgl_vertex_format_t`
+    describes a custom vertex layout, where each attribute may be stored as
+    32-bit or 16-bit floats, or as (normalized) 8-bit or 16-bit integers. Such
+    vertices are drawn with `pgl_draw_formatted_array` or stored in a buffer
+    created by `pgl_create_formatted_buffer`. Each context keeps a vertex array
+    per format that it has drawn, and formatted draws are batched like
+    `pgl_draw_array`.
+
+    Static geometry can be packed into a geometry pool (see `pgl_create_pool`).
+    A pool is a single vertex buffer (and index buffer) from which ranges are
+    allocated with `pgl_alloc_pool_range`. `pgl_draw_pool` draws any subset of
+    the ranges with a single `glMultiDrawArrays` or `glMultiDrawElements` call.
+    These are not available in GLES, where the ranges are drawn one by one.
+
+    Textures can be updated without stalling the render thread by staging the
+    pixels in an upload buffer. The buffer is mapped with
+    `pgl_map_upload_buffer` and may then be filled from any thread (e.g. a
+    loader thread). `pgl_upload_texture_async` then schedules the copy on the
+    GPU, and `pgl_is_upload_complete` reports when the buffer can be reused.
+    All other calls must be made on the thread that owns the OpenGL context.
+
+    Buffers created with `pgl_create_buffer` can be drawn many times in a
+    single call with `pgl_draw_buffer_instanced`. Each instance reads a
+    transform, a color, and a UV rectangle from an instance buffer (see
+    `pgl_instance_t`). The shader returned by `pgl_create_instanced_shader`
+    applies them, and custom shaders can read them at the attribute locations
+    documented with `pgl_instance_t`.
+
+    pico_gl keeps a copy of the OpenGL state it changes (bound objects, enabled
+    capabilities, blending, viewport, etc.) and skips calls that would not
+    change it. Objects are left bound after use. Call
+    `pgl_invalidate_state_cache` after making OpenGL calls directly. The
+    number of skipped calls is returned by `pgl_get_elided_calls`.
 
     Please see the examples for more details.
 
@@ -62,6 +128,10 @@
     - PICO_GL_UNIFORM_NAME_LENGTH (default: 32)
     - PICO_GL_MAX_UNIFORMS (default: 32)
     - PICO_GL_MAX_STATES (default: 32)
+    - PICO_GL_STREAM_BUFFER_SIZE (default: 4194304 bytes)
+    - PICO_GL_MAX_BATCH_VERTICES (default: 16384)
+    - PICO_GL_MAX_PATH_LENGTH (default: 256)
+    - PICO_GL_MAX_VERTEX_FORMATS (default: 8)
 
     Must be defined before PICO_GL_IMPLEMENTATION
 
@@ -207,6 +277,57 @@ typedef struct
     float uv[2];
 } pgl_vertex_t;
 
+/**
+ * @brief Storage types of vertex attributes
+ */
+typedef enum
+{
+    PGL_FLOAT32,     //!< 32-bit float
+    PGL_FLOAT16,     //!< 16-bit float (see `pgl_float_to_half`)
+    PGL_INT16,       //!< Signed 16-bit integer converted to float
+    PGL_INT16_NORM,  //!< Signed 16-bit integer normalized to [-1, 1]
+    PGL_UINT16_NORM, //!< Unsigned 16-bit integer normalized to [0, 1]
+    PGL_UINT8_NORM,  //!< Unsigned 8-bit integer normalized to [0, 1]
+} pgl_attr_type_t;
+
+/**
+ * @brief Describes how an attribute is stored in a vertex
+ */
+typedef struct
+{
+    pgl_attr_type_t type;
+    uint32_t        components; //!< Number of components (1 to 4)
+    uint32_t        offset;     //!< Offset from the start of the vertex in bytes
+} pgl_attr_format_t;
+
+/**
+ * @brief Describes the memory layout of a custom vertex
+ *
+ * Components missing from an attribute default to 0 (y and z) or 1 (w), so a
+ * position with two components lies in the plane z = 0. Strides and offsets
+ * should be multiples of 4 bytes for the best performance.
+ */
+typedef struct
+{
+    pgl_attr_format_t pos;
+    pgl_attr_format_t color;
+    pgl_attr_format_t uv;
+    uint32_t          stride; //!< Size of a vertex in bytes
+} pgl_vertex_format_t;
+
+/**
+ * @brief Per-instance data for instanced drawing
+ *
+ * The attribute locations below are used by the default instanced shader and
+ * are available to custom shaders.
+ */
+typedef struct
+{
+    float transform[16]; //!< Applied before the context transform (locations 3-6, `mat4`)
+    float color[4];      //!< Multiplied with the vertex color (location 7)
+    float uv_rect[4];    //!< UV offset (xy) and scale (zw) (location 8)
+} pgl_instance_t;
+
 /**
  * @brief 2D floating point vector
  */
@@ -272,6 +393,21 @@ typedef struct pgl_texture_t pgl_texture_t;
  */
 typedef struct pgl_buffer_t pgl_buffer_t;
 
+/**
+ * @brief Contains per-instance buffer data/state
+ */
+typedef struct pgl_instance_buffer_t pgl_instance_buffer_t;
+
+/**
+ * @brief Contains staging buffer data/state for asynchronous texture uploads
+ */
+typedef struct pgl_upload_buffer_t pgl_upload_buffer_t;
+
+/**
+ * @brief Contains geometry pool data/state
+ */
+typedef struct pgl_pool_t pgl_pool_t;
+
 /**
  * @brief Defines an OpenGL (GLAD) function loader
  *
@@ -292,6 +428,20 @@ typedef void* (*pgl_loader_fn)(const char* name);
  */
 int pgl_global_init(pgl_loader_fn loader_fp, bool gles);
 
+/**
+ * @brief Forgets the cached OpenGL state
+ *
+ * Must be called after changing OpenGL state outside of pico_gl, so that the
+ * next pico_gl calls that depend on that state reach OpenGL
+ */
+void pgl_invalidate_state_cache(void);
+
+/**
+ * @brief Returns the number of OpenGL calls that were skipped because they
+ * would not have changed the cached state
+ */
+uint64_t pgl_get_elided_calls(void);
+
 /**
  * @brief Returns the current error code
  */
@@ -372,6 +522,31 @@ void pgl_resize(pgl_ctx_t* ctx, uint32_t w, uint32_t h, bool reset_vp);
 pgl_shader_t* pgl_create_shader(pgl_ctx_t* ctx, const char* vert_src,
                                                 const char* frag_src);
 
+/**
+ * @brief Creates a shader program for `pgl_draw_buffer_instanced`
+ *
+ * The vertex shader applies the attributes of `pgl_instance_t`. If `frag_src`
+ * is `NULL`, then the default fragment source is used.
+ *
+ * @param ctx      The relevant context
+ * @param frag_src Fragment shader source
+ *
+ * @returns Pointer to the shader program, or \em NULL on error
+ */
+pgl_shader_t* pgl_create_instanced_shader(pgl_ctx_t* ctx, const char* frag_src);
+
+/**
+ * @brief Sets the directory of the on-disk program cache
+ *
+ * Shaders created afterwards are loaded from, or written to, the cache. The
+ * directory must exist.
+ *
+ * @param path The cache directory, or `NULL` to disable the cache
+ *
+ * @returns 0 on success and -1 if the path is too long
+ */
+int pgl_set_program_cache_dir(const char* path);
+
 /**
  * @brief Destroys a shader program
  *
@@ -464,6 +639,66 @@ void pgl_update_texture(pgl_ctx_t* ctx,
                         int w, int h,
                         const uint8_t* bitmap);
 
+/**
+ * @brief Creates a staging buffer for asynchronous texture uploads
+ *
+ * @param ctx  The relevant context
+ * @param size The size of the buffer in bytes
+ *
+ * @returns A pointer to the buffer or `NULL` on error
+ */
+pgl_upload_buffer_t* pgl_create_upload_buffer(pgl_ctx_t* ctx, size_t size);
+
+/**
+ * @brief Destroys a staging buffer
+ *
+ * Pending copies from the buffer still complete.
+ */
+void pgl_destroy_upload_buffer(pgl_upload_buffer_t* buffer);
+
+/**
+ * @brief Maps a staging buffer for writing
+ *
+ * The returned memory may be written from any thread until the buffer is
+ * passed to `pgl_upload_texture_async`. Mapping a buffer whose previous copy
+ * is still pending does not wait for it.
+ *
+ * @param buffer The staging buffer
+ *
+ * @returns A pointer to `size` bytes of memory, or `NULL` on error
+ */
+uint8_t* pgl_map_upload_buffer(pgl_upload_buffer_t* buffer);
+
+/**
+ * @brief Copies pixels from a mapped staging buffer into a region of a texture
+ *
+ * The buffer is unmapped and the copy is performed by the GPU. The pixels are
+ * read from the start of the buffer as tightly packed rows in the texture's
+ * format.
+ *
+ * @param ctx     The relevant context
+ * @param buffer  The mapped staging buffer
+ * @param texture The texture to update
+ * @param x       The x offset of the region
+ * @param y       The y offset of the region
+ * @param w       The width of the region
+ * @param h       The height of the region
+ *
+ * @returns 0 on success and -1 on failure
+ */
+int pgl_upload_texture_async(pgl_ctx_t* ctx,
+                             pgl_upload_buffer_t* buffer,
+                             pgl_texture_t* texture,
+                             int x, int y,
+                             int w, int h);
+
+/**
+ * @brief Returns true if the last copy from a staging buffer has completed
+ *
+ * Does not block.
+ */
+bool pgl_is_upload_complete(pgl_upload_buffer_t* buffer);
+
 /**
  * @brief Generate mipmaps for the specified texture
  *
@@ -545,6 +780,9 @@ void pgl_clear(float r, float g, float b, float a);
 /**
  * Draws primitives according to a vertex array
  *
+ * The vertices are appended to a batch if the previous draw used the same
+ * texture, shader, and state. The batch is drawn later (see `pgl_flush`).
+ *
  * @param ctx       The relevant context
  * @param primitive The type of geometry to draw
  * @param vertices  A vertex array
@@ -559,6 +797,45 @@ void pgl_draw_array(pgl_ctx_t* ctx,
                     pgl_texture_t* texture,
                     pgl_shader_t* shader);
 
+/**
+ * Draws primitives according to an array of custom vertices
+ *
+ * Draws are batched like those of `pgl_draw_array` if they also use the same
+ * vertex format.
+ *
+ * @param ctx       The relevant context
+ * @param primitive The type of geometry to draw
+ * @param format    The layout of the vertices
+ * @param vertices  A vertex array
+ * @param count     The number of vertices
+ * @param texture   The texture to draw from (can be `NULL`)
+ * @param shader    The shader used to draw the array (cannot be `NULL`)
+ */
+void pgl_draw_formatted_array(pgl_ctx_t* ctx,
+                              pgl_primitive_t primitive,
+                              const pgl_vertex_format_t* format,
+                              const void* vertices,
+                              pgl_size_t count,
+                              pgl_texture_t* texture,
+                              pgl_shader_t* shader);
+
+/**
+ * @brief Converts a float to a 16-bit float (for `PGL_FLOAT16` attributes)
+ */
+uint16_t pgl_float_to_half(float value);
+
+/**
+ * @brief Draws the vertices batched by `pgl_draw_array`
+ *
+ * Must be called before presenting a frame, reading pixels, or making OpenGL
+ * calls directly. Binding a shader or texture, setting a uniform, changing
+ * the render target, or drawing with any context flush the batch
+ * automatically.
+ *
+ * @param ctx The relevant context
+ */
+void pgl_flush(pgl_ctx_t* ctx);
+
 /**
  * Draws primvities according to vertex and index arrays
  *
@@ -594,6 +871,23 @@ pgl_buffer_t* pgl_create_buffer(pgl_ctx_t* ctx,
                                 const pgl_vertex_t* vertices,
                                 pgl_size_t count);
 
+/**
+ * @brief Creates a buffer in VRAM to store an array of custom vertices
+ *
+ * @param ctx       The relevant context
+ * @param primitive The type of geometry to draw
+ * @param format    The layout of the vertices
+ * @param vertices  A vertex array
+ * @param count     The number of vertices to store in the buffer
+ *
+ * @returns A pointer to the buffer or `NULL` on error
+ */
+pgl_buffer_t* pgl_create_formatted_buffer(pgl_ctx_t* ctx,
+                                          pgl_primitive_t primitive,
+                                          const pgl_vertex_format_t* format,
+                                          const void* vertices,
+                                          pgl_size_t count);
+
 /**
  * @brief Substitutes the data in a buffer with new data
  *
@@ -608,6 +902,20 @@ void pgl_sub_buffer_data(pgl_ctx_t *ctx,
                          pgl_size_t count,
                          pgl_size_t offset);
 
+/**
+ * @brief Substitutes vertices in a buffer created by
+ * `pgl_create_formatted_buffer`
+ *
+ * @param buffer   The buffer to write to
+ * @param vertices A vertex array in the format of the buffer
+ * @param count    The number of vertices to substitute
+ * @param offset   The index of the first vertex to substitute
+ */
+void pgl_sub_formatted_buffer_data(pgl_buffer_t* buffer,
+                                   const void* vertices,
+                                   pgl_size_t count,
+                                   pgl_size_t offset);
+
 /**
  * @brief Destroys a previously created buffer
  */
@@ -629,6 +937,147 @@ void pgl_draw_buffer(pgl_ctx_t* ctx,
                      pgl_texture_t* texture,
                      pgl_shader_t* shader);
 
+/**
+ * @brief Creates a buffer in VRAM to store per-instance data
+ *
+ * @param ctx       The relevant context
+ * @param instances An array of instances (can be `NULL` to leave the buffer
+ * uninitialized)
+ * @param count     The number of instances the buffer holds
+ *
+ * @returns A pointer to the buffer or `NULL` on error
+ */
+pgl_instance_buffer_t* pgl_create_instance_buffer(pgl_ctx_t* ctx,
+                                                  const pgl_instance_t* instances,
+                                                  pgl_size_t count);
+
+/**
+ * @brief Substitutes the data in an instance buffer with new data
+ *
+ * Replacing the whole buffer reallocates its storage, so the update does not
+ * wait for draws that still read the old data.
+ *
+ * @param buffer    The buffer to write to
+ * @param instances An array of instances
+ * @param count     The number of instances to substitute
+ * @param offset    The index of the first instance to substitute
+ */
+void pgl_sub_instance_data(pgl_instance_buffer_t* buffer,
+                           const pgl_instance_t* instances,
+                           pgl_size_t count,
+                           pgl_size_t offset);
+
+/**
+ * @brief Destroys a previously created instance buffer
+ */
+void pgl_destroy_instance_buffer(pgl_instance_buffer_t* buffer);
+
+/**
+ * @brief Draws a previously created buffer once per instance
+ *
+ * @param ctx            The relevant context
+ * @param buffer         The buffer to draw
+ * @param start          The base vertex index
+ * @param count          The number of vertices to draw from `start`
+ * @param instances      The per-instance data
+ * @param first_instance The index of the first instance to draw
+ * @param instance_count The number of instances to draw
+ * @param texture        The texture to draw from (can be `NULL`)
+ * @param shader         The shader used to draw the array (cannot be `NULL`)
+ */
+void pgl_draw_buffer_instanced(pgl_ctx_t* ctx,
+                               pgl_buffer_t* buffer,
+                               pgl_size_t start, pgl_size_t count,
+                               const pgl_instance_buffer_t* instances,
+                               pgl_size_t first_instance,
+                               pgl_size_t instance_count,
+                               pgl_texture_t* texture,
+                               pgl_shader_t* shader);
+
+/**
+ * @brief Creates a geometry pool
+ *
+ * A pool stores the vertices (and indices) of many meshes in one buffer, so
+ * that they can be drawn together with `pgl_draw_pool`. The capacities are
+ * fixed.
+ *
+ * @param ctx             The relevant context
+ * @param primitive       The type of geometry of every range
+ * @param format          The layout of the vertices (`NULL` for `pgl_vertex_t`)
+ * @param vertex_capacity The number of vertices the pool holds
+ * @param index_capacity  The number of indices the pool holds (0 if the ranges
+ * are not indexed)
+ * @param max_ranges      The maximum number of ranges
+ *
+ * @returns A pointer to the pool or `NULL` on error
+ */
+pgl_pool_t* pgl_create_pool(pgl_ctx_t* ctx,
+                            pgl_primitive_t primitive,
+                            const pgl_vertex_format_t* format,
+                            pgl_size_t vertex_capacity,
+                            pgl_size_t index_capacity,
+                            pgl_size_t max_ranges);
+
+/**
+ * @brief Destroys a geometry pool
+ */
+void pgl_destroy_pool(pgl_pool_t* pool);
+
+/**
+ * @brief Allocates a range in a pool and uploads its vertices and indices
+ *
+ * @param pool         The pool to allocate from
+ * @param vertices     A vertex array in the format of the pool
+ * @param vertex_count The number of vertices
+ * @param indices      An index array relative to the first vertex (must be
+ * `NULL` if and only if the pool has no index capacity)
+ * @param index_count  The number of indices
+ *
+ * @returns A handle to the range or -1 if the pool is full
+ */
+int32_t pgl_alloc_pool_range(pgl_pool_t* pool,
+                             const void* vertices, pgl_size_t vertex_count,
+                             const uint32_t* indices, pgl_size_t index_count);
+
+/**
+ * @brief Frees a range so that its space can be reused
+ */
+void pgl_free_pool_range(pgl_pool_t* pool, int32_t range);
+
+/**
+ * @brief Substitutes vertices in a range
+ *
+ * @param pool     The pool containing the range
+ * @param range    The range to write to
+ * @param vertices A vertex array in the format of the pool
+ * @param count    The number of vertices to substitute
+ * @param offset   The index of the first vertex (relative to the range) to
+ * substitute
+ */
+void pgl_sub_pool_range_data(pgl_pool_t* pool,
+                             int32_t range,
+                             const void* vertices,
+                             pgl_size_t count,
+                             pgl_size_t offset);
+
+/**
+ * @brief Draws ranges of a pool in a single call
+ *
+ * @param ctx     The relevant context
+ * @param pool    The pool to draw from
+ * @param ranges  The handles of the ranges to draw (`NULL` to draw every
+ * allocated range)
+ * @param count   The number of handles
+ * @param texture The texture to draw from (can be `NULL`)
+ * @param shader  The shader used to draw the ranges (cannot be `NULL`)
+ */
+void pgl_draw_pool(pgl_ctx_t* ctx,
+                   pgl_pool_t* pool,
+                   const int32_t* ranges,
+                   pgl_size_t count,
+                   pgl_texture_t* texture,
+                   pgl_shader_t* shader);
+
 /**
  * @brief Turns matrix transposition on/off
  */
@@ -991,6 +1440,32 @@ void pgl_set_m4(pgl_shader_t* shader, const char* name, const pgl_m4_t matrix);
  */
 void pgl_set_s2d(pgl_shader_t* shader, const char* name, int32_t value);
 
+/**
+ * @brief Looks up a uniform so that it can be set without searching by name
+ *
+ * @param shader The uniform's shader program
+ * @param name   The name of the uniform
+ *
+ * @returns A handle to the uniform, or -1 if the shader has no active uniform
+ * with that name
+ */
+int32_t pgl_get_uniform_handle(const pgl_shader_t* shader, const char* name);
+
+/**
+ * @brief Sets a uniform by handle
+ *
+ * The value is interpreted according to the type declared in the shader:
+ * floats for float vectors and matrices, and `int32_t` for integer vectors,
+ * booleans, and samplers. Matrices respect `pgl_set_transpose`.
+ *
+ * @param shader The uniform's shader program
+ * @param handle The handle returned by `pgl_get_uniform_handle` (-1 is ignored)
+ * @param value  The value(s) of the uniform
+ * @param count  The number of array elements in `value` (1 if not an array)
+ */
+void pgl_set_uniform(pgl_shader_t* shader, int32_t handle,
+                     const void* value, pgl_size_t count);
+
 #endif // PICO_GL_H
 
 #ifdef __cplusplus
@@ -1035,6 +1510,22 @@ void pgl_set_s2d(pgl_shader_t* shader, const char* name, int32_t value);
 #define PICO_GL_MAX_STATES 32
 #endif
 
+#ifndef PICO_GL_STREAM_BUFFER_SIZE
+#define PICO_GL_STREAM_BUFFER_SIZE 4194304
+#endif
+
+#ifndef PICO_GL_MAX_BATCH_VERTICES
+#define PICO_GL_MAX_BATCH_VERTICES 16384
+#endif
+
+#ifndef PICO_GL_MAX_PATH_LENGTH
+#define PICO_GL_MAX_PATH_LENGTH 256
+#endif
+
+#ifndef PICO_GL_MAX_VERTEX_FORMATS
+#define PICO_GL_MAX_VERTEX_FORMATS 8
+#endif
+
 /*=============================================================================
  * Internal aliases
  *============================================================================*/
@@ -1046,6 +1537,28 @@ void pgl_set_s2d(pgl_shader_t* shader, const char* name, int32_t value);
 #define PGL_UNIFORM_NAME_LENGTH PICO_GL_UNIFORM_NAME_LENGTH
 #define PGL_MAX_UNIFORMS        PICO_GL_MAX_UNIFORMS
 #define PGL_MAX_STATES          PICO_GL_MAX_STATES
+#define PGL_STREAM_BUFFER_SIZE  PICO_GL_STREAM_BUFFER_SIZE
+#define PGL_MAX_BATCH_VERTICES  PICO_GL_MAX_BATCH_VERTICES
+#define PGL_MAX_PATH_LENGTH     PICO_GL_MAX_PATH_LENGTH
+#define PGL_MAX_VERTEX_FORMATS  PICO_GL_MAX_VERTEX_FORMATS
+
+// Number of fenced segments in a streaming buffer
+#define PGL_STREAM_SEGMENT_COUNT 4
+
+// Size of the batch in bytes. Compact vertices fit more vertices into a batch.
+#define PGL_BATCH_SIZE (PGL_MAX_BATCH_VERTICES * sizeof(pgl_vertex_t))
+
+// Identifies program cache files ("PGLB")
+#define PGL_PROGRAM_CACHE_MAGIC 0x424C4750
+
+// Changes whenever the layout of program cache files changes
+#define PGL_PROGRAM_CACHE_VERSION 1
+
+// Cache directory plus the file name of a program
+#define PGL_PROGRAM_PATH_LENGTH (PGL_MAX_PATH_LENGTH + 32)
+
+// Object name that never matches a cached binding
+#define PGL_UNKNOWN_ID ((GLuint)-1)
 
 /*=============================================================================
  * Internal PGL enum to GL enum maps
@@ -1061,6 +1574,27 @@ void pgl_set_s2d(pgl_shader_t* shader, const char* name, int32_t value);
 
 static bool pgl_initialized = false;
 
+// The context with batched vertices (if any). Only one batch is pending at a
+// time, and it is drawn before any other context issues GL commands.
+static pgl_ctx_t* pgl_batch_ctx = NULL;
+
+// Layout of pgl_vertex_t
+static const pgl_vertex_format_t pgl_default_format =
+{
+    { PGL_FLOAT32, 3, offsetof(pgl_vertex_t, pos)   },
+    { PGL_FLOAT32, 4, offsetof(pgl_vertex_t, color) },
+    { PGL_FLOAT32, 2, offsetof(pgl_vertex_t, uv)    },
+    sizeof(pgl_vertex_t)
+};
+
+static const GLenum pgl_cap_map[] =
+{
+    GL_BLEND,
+    GL_DEPTH_TEST,
+    GL_FRAMEBUFFER_SRGB,
+    GL_MULTISAMPLE
+};
+
 static const char* pgl_error_msg_map[] =
 {
     "No error",
@@ -1090,6 +1624,16 @@ static const GLenum pgl_format_map[] =
     GL_BGRA
 };
 
+// Bytes per pixel of each format
+static const size_t pgl_format_size_map[] =
+{
+    1,
+    3,
+    4,
+    3,
+    4
+};
+
 static const GLenum pgl_blend_factor_map[] =
 {
     GL_ZERO,
@@ -1113,6 +1657,26 @@ static const GLenum pgl_blend_eq_map[] =
     GL_MAX
 };
 
+static const GLenum pgl_attr_type_map[] =
+{
+    GL_FLOAT,
+    GL_HALF_FLOAT,
+    GL_SHORT,
+    GL_SHORT,
+    GL_UNSIGNED_SHORT,
+    GL_UNSIGNED_BYTE
+};
+
+static const GLboolean pgl_attr_norm_map[] =
+{
+    GL_FALSE,
+    GL_FALSE,
+    GL_FALSE,
+    GL_TRUE,
+    GL_TRUE,
+    GL_TRUE
+};
+
 static const GLenum pgl_primitive_map[] =
 {
     GL_POINTS,
@@ -1143,8 +1707,30 @@ typedef struct
 	GLenum     type;
 	GLint      location;
 	pgl_hash_t hash;
+	uint8_t*   value;     // Copy of the value last sent to GL
+	size_t     capacity;  // Size of the copy in bytes (0 if not cached)
+	size_t     cached;    // Number of leading bytes of the copy that are valid
+	bool       transpose; // Transpose flag the matrix was last sent with
 } pgl_uniform_t;
 
+// Program cache file layout: header, uniform table, program binary
+typedef struct
+{
+    uint32_t magic;
+    uint32_t format;
+    uint64_t key;
+    uint32_t length;
+    uint32_t uniform_count;
+} pgl_program_header_t;
+
+typedef struct
+{
+    char     name[PGL_UNIFORM_NAME_LENGTH];
+    int32_t  size;
+    uint32_t type;
+    int32_t  location;
+} pgl_cached_uniform_t;
+
 typedef struct
 {
     int32_t x, y, w, h;
@@ -1166,6 +1752,85 @@ typedef struct
     pgl_state_t array[PGL_MAX_STATES];
 } pgl_state_stack_t;
 
+typedef struct
+{
+    GLenum     target;
+    GLuint     id;
+    GLsizeiptr size;
+    GLintptr   head;          // Next free byte
+    int        open;          // First segment written since it was last fenced
+    int        last;          // Segment containing the last byte written
+    GLsync     fences[PGL_STREAM_SEGMENT_COUNT];
+} pgl_stream_t;
+
+// Vertex array used by immediate draws of one vertex format
+typedef struct
+{
+    pgl_vertex_format_t format;
+    GLuint              vao;
+} pgl_layout_t;
+
+// Span of vertices or indices in a geometry pool
+typedef struct
+{
+    pgl_size_t start;
+    pgl_size_t count;
+} pgl_span_t;
+
+typedef struct
+{
+    pgl_span_t* spans; // Free spans sorted by start
+    pgl_size_t  count;
+} pgl_span_list_t;
+
+typedef struct
+{
+    bool       used;
+    pgl_span_t vertices;
+    pgl_span_t indices;
+} pgl_pool_range_t;
+
+typedef struct
+{
+    pgl_primitive_t primitive; // PGL_POINTS, PGL_LINES, or PGL_TRIANGLES
+    pgl_texture_t*  texture;
+    pgl_shader_t*   shader;
+    pgl_state_t     state;
+    pgl_layout_t*   layout;
+    uint8_t*        vertices;  // PGL_BATCH_SIZE bytes
+    pgl_size_t      count;
+} pgl_batch_t;
+
+typedef enum
+{
+    PGL_CAP_BLEND,
+    PGL_CAP_DEPTH_TEST,
+    PGL_CAP_FRAMEBUFFER_SRGB,
+    PGL_CAP_MULTISAMPLE,
+    PGL_CAP_COUNT
+} pgl_cap_t;
+
+// Copy of the OpenGL state changed by pico_gl. All contexts share the OpenGL
+// context, so there is only one copy.
+typedef struct
+{
+    GLuint           program;
+    GLuint           texture;
+    GLuint           vao;
+    GLuint           array_buffer;
+    int8_t           caps[PGL_CAP_COUNT]; // -1 if unknown
+    pgl_blend_mode_t blend_mode;
+    pgl_viewport_t   viewport;
+    float            line_width;
+    float            clear_color[4];
+    uint64_t         elided;
+} pgl_gl_state_t;
+
+static pgl_gl_state_t pgl_gl_state;
+
+// Directory of the program cache (empty if disabled)
+static char pgl_program_cache_dir[PGL_MAX_PATH_LENGTH];
+
 /*=============================================================================
  * Internal function declarations
  *============================================================================*/
@@ -1173,30 +1838,84 @@ typedef struct
 static void pgl_set_error(pgl_ctx_t* ctx, pgl_error_t code);
 
 static const char* pgl_get_default_vert_shader();
+static const char* pgl_get_instanced_vert_shader();
 static const char* pgl_get_default_frag_shader();
 
 static pgl_state_stack_t* pgl_get_active_stack(pgl_ctx_t* ctx);
 static pgl_state_t* pgl_get_active_state(pgl_ctx_t* ctx);
 
-static void pgl_reset_last_state(pgl_ctx_t* ctx);
-
-static void pgl_apply_blend(pgl_ctx_t* ctx, const pgl_blend_mode_t* mode);
+static void pgl_apply_blend(const pgl_blend_mode_t* mode);
 static void pgl_apply_transform(pgl_ctx_t* ctx, const pgl_m4_t matrix);
 static void pgl_apply_projection(pgl_ctx_t* ctx, const pgl_m4_t matrix);
-static void pgl_apply_viewport(pgl_ctx_t* ctx, const pgl_viewport_t* viewport);
-
-static void pgl_before_draw(pgl_ctx_t* ctx, pgl_texture_t* texture, pgl_shader_t* shader);
-static void pgl_after_draw(pgl_ctx_t* ctx);
-
+static void pgl_apply_viewport(const pgl_viewport_t* viewport);
+
+static void pgl_before_draw(pgl_ctx_t* ctx, pgl_texture_t* texture,
+                            pgl_shader_t* shader, const pgl_state_t* state);
+
+static void pgl_gl_use_program(GLuint program);
+static void pgl_gl_bind_texture(GLuint texture);
+static void pgl_gl_bind_vertex_array(GLuint vao);
+static void pgl_gl_bind_buffer(GLenum target, GLuint buffer);
+static void pgl_gl_set_cap(pgl_cap_t cap, bool enabled);
+static void pgl_gl_delete_texture(GLuint texture);
+static void pgl_gl_delete_vertex_array(GLuint vao);
+static void pgl_gl_delete_buffer(GLuint buffer);
+
+static void pgl_flush_pending(void);
+
+static void pgl_draw_vertices(pgl_ctx_t* ctx,
+                              pgl_primitive_t primitive,
+                              const pgl_layout_t* layout,
+                              const void* vertices,
+                              pgl_size_t count,
+                              pgl_texture_t* texture,
+                              pgl_shader_t* shader,
+                              const pgl_state_t* state);
+
+static pgl_primitive_t pgl_list_primitive(pgl_primitive_t primitive);
+static pgl_size_t pgl_list_vertex_count(pgl_primitive_t primitive, pgl_size_t count);
+static void pgl_copy_as_list(uint8_t* dst,
+                             pgl_primitive_t primitive,
+                             const uint8_t* src,
+                             pgl_size_t count,
+                             size_t stride);
+
+static bool pgl_alloc_span(pgl_span_list_t* list, pgl_size_t size, pgl_size_t* start);
+static void pgl_free_span(pgl_span_list_t* list, pgl_span_t span);
+
+static GLuint pgl_compile_program(pgl_ctx_t* ctx, const char* vert_src,
+                                  const char* frag_src, bool retrievable);
 static int pgl_load_uniforms(pgl_shader_t* shader);
-static const pgl_uniform_t* pgl_find_uniform(const pgl_shader_t* shader, const char* name);
-
-static void pgl_bind_attributes();
+static int pgl_init_uniforms(pgl_shader_t* shader);
+
+static bool pgl_program_cache_enabled(void);
+static uint64_t pgl_program_key(const char* vert_src, const char* frag_src);
+static void pgl_program_path(char* path, size_t size, uint64_t key);
+static GLuint pgl_load_program(pgl_shader_t* shader, uint64_t key);
+static void pgl_save_program(const pgl_shader_t* shader, uint64_t key);
+static int32_t pgl_find_uniform(const pgl_shader_t* shader, const char* name);
+static size_t pgl_uniform_type_size(GLenum type);
+static bool pgl_cache_uniform(pgl_uniform_t* uniform, const void* value, size_t size);
+static void pgl_send_uniform(pgl_shader_t* shader, int32_t handle, GLenum type,
+                             const void* value, pgl_size_t count);
+
+static pgl_layout_t* pgl_get_layout(pgl_ctx_t* ctx, const pgl_vertex_format_t* format);
+static void pgl_bind_attribute(GLuint index, const pgl_attr_format_t* attr, GLsizei stride);
+static void pgl_bind_attributes(const pgl_vertex_format_t* format);
+static void pgl_attach_instances(pgl_buffer_t* buffer,
+                                 const pgl_instance_buffer_t* instances,
+                                 pgl_size_t first_instance);
+
+static void pgl_init_stream(pgl_stream_t* stream, GLenum target, GLsizeiptr size);
+static void pgl_destroy_stream(pgl_stream_t* stream);
+static void* pgl_map_stream(pgl_stream_t* stream, GLsizeiptr size,
+                            GLsizeiptr align, GLintptr* offset);
 
 static void pgl_log(const char* fmt, ...);
 static void pgl_log_error(const char* file, unsigned line, const char* expr);
 static pgl_error_t pgl_map_error(GLenum id);
 static pgl_hash_t pgl_hash_str(const char* str);
+static uint64_t pgl_hash_bytes64(uint64_t hash, const void* data, size_t size);
 static bool pgl_str_equal(const char* str1, const char* str2);
 static bool pgl_mem_equal(const void* ptr1, const void* ptr2, size_t size);
 
@@ -1211,6 +1930,10 @@ static bool pgl_mem_equal(const void* ptr1, const void* ptr2, size_t size);
 static const pgl_hash_t PGL_OFFSET_BASIS = 0x811C9DC5;
 static const pgl_hash_t PGL_PRIME = 0x1000193;
 
+// Program cache keys are 64-bit to make collisions between files unlikely
+static const uint64_t PGL_OFFSET_BASIS_64 = 0xCBF29CE484222325ULL;
+static const uint64_t PGL_PRIME_64 = 0x100000001B3ULL;
+
 /*=============================================================================
  * Shaders GL3
  *============================================================================*/
@@ -1259,12 +1982,36 @@ static const pgl_hash_t PGL_PRIME = 0x1000193;
 "   frag_color = texture(u_tex, uv) * color;\n" \
 "}\n"
 
-static const GLchar* PGL_GL_VERT_SRC = PGL_GL_HDR PGL_GL_VERT_BODY;
-static const GLchar* PGL_GL_FRAG_SRC = PGL_GL_HDR PGL_GL_FRAG_BODY;
+#define PGL_GL_INST_VERT_BODY "" \
+"layout (location = 0) in vec3 a_pos;\n" \
+"layout (location = 1) in vec4 a_color;\n" \
+"layout (location = 2) in vec2 a_uv;\n" \
+"layout (location = 3) in mat4 a_inst_transform;\n" \
+"layout (location = 7) in vec4 a_inst_color;\n" \
+"layout (location = 8) in vec4 a_inst_uv_rect;\n" \
+"\n" \
+"out vec4 color;\n" \
+"out vec2 uv;\n" \
+"\n" \
+"uniform mat4 u_transform;\n" \
+"uniform mat4 u_projection;\n" \
+"\n" \
+"void main()\n" \
+"{\n" \
+"   gl_Position = u_projection * u_transform * a_inst_transform * vec4(a_pos, 1);\n" \
+"   color = a_color * a_inst_color;\n" \
+"   uv = a_inst_uv_rect.xy + a_uv * a_inst_uv_rect.zw;\n" \
+"}\n"
+
+static const GLchar* PGL_GL_VERT_SRC = PGL_GL_HDR PGL_GL_VERT_BODY;
+static const GLchar* PGL_GL_FRAG_SRC = PGL_GL_HDR PGL_GL_FRAG_BODY;
 
 static const GLchar* PGL_GLES_VERT_SRC = PGL_GLES_HDR PGL_GL_VERT_BODY;
 static const GLchar* PGL_GLES_FRAG_SRC = PGL_GLES_HDR PGL_GL_FRAG_BODY;
 
+static const GLchar* PGL_GL_INST_VERT_SRC   = PGL_GL_HDR PGL_GL_INST_VERT_BODY;
+static const GLchar* PGL_GLES_INST_VERT_SRC = PGL_GLES_HDR PGL_GL_INST_VERT_BODY;
+
 /*=============================================================================
  * Public API implementation
  *============================================================================*/
@@ -1273,14 +2020,14 @@ struct pgl_ctx_t
 {
     pgl_error_t       error_code;
     pgl_shader_t*     shader;
-    pgl_texture_t*    texture;
     pgl_texture_t*    target;
-    pgl_state_t       last_state;
     pgl_state_stack_t stack;
     pgl_state_stack_t target_stack;
-    GLuint            vao;
-    GLuint            vbo;
-    GLuint            ebo;
+    pgl_layout_t      layouts[PGL_MAX_VERTEX_FORMATS]; // The first describes pgl_vertex_t
+    pgl_size_t        layout_count;
+    pgl_stream_t      vertex_stream;
+    pgl_stream_t      index_stream;
+    pgl_batch_t       batch;
     uint32_t          w, h;
     uint32_t          samples;
     bool              srgb;
@@ -1297,6 +2044,10 @@ struct pgl_shader_t
 
     pgl_size_t uniform_count;
     pgl_uniform_t uniforms[PGL_MAX_UNIFORMS];
+    uint8_t* uniform_values;
+
+    int32_t transform;
+    int32_t projection;
 
     pgl_attribute_t pos;
     pgl_attribute_t color;
@@ -1322,12 +2073,57 @@ struct pgl_texture_t
 
 struct pgl_buffer_t
 {
-    GLenum  primitive;
-    GLuint  vao;
-    GLuint  vbo;
-    GLsizei count;
+    pgl_ctx_t* ctx;
+    GLenum     primitive;
+    GLuint     vao;
+    GLuint     vbo;
+    GLsizei    count;
+    GLsizei    stride;
+
+    // Instance data the vertex array currently points at
+    uint64_t   instance_serial;
+    pgl_size_t first_instance;
+};
+
+struct pgl_pool_t
+{
+    pgl_ctx_t*        ctx;
+    GLenum            primitive;
+    GLuint            vao;
+    GLuint            vbo;
+    GLuint            ebo;           // 0 if the ranges are not indexed
+    GLsizei           stride;
+    pgl_size_t        max_ranges;
+    pgl_pool_range_t* ranges;
+    pgl_span_list_t   free_vertices;
+    pgl_span_list_t   free_indices;
+
+    // Arguments of the multi-draw calls
+    GLint*            firsts;
+    GLsizei*          counts;
+    const GLvoid**    offsets;
+};
+
+struct pgl_upload_buffer_t
+{
+    pgl_ctx_t* ctx;
+    GLuint     pbo;
+    size_t     size;
+    bool       mapped;
+    GLsync     fence;
+};
+
+struct pgl_instance_buffer_t
+{
+    pgl_ctx_t* ctx;
+    GLuint     vbo;
+    pgl_size_t count;
+    uint64_t   serial;
 };
 
+// Identifies instance buffers, since OpenGL reuses the names of deleted buffers
+static uint64_t pgl_instance_serial = 0;
+
 pgl_error_t pgl_get_error(pgl_ctx_t* ctx)
 {
     return ctx->error_code;
@@ -1399,13 +2195,8 @@ int pgl_global_init(pgl_loader_fn loader_fp, bool gles)
             PGL_LOG("GLAD GLES2 loader failed");
             return -1;
         }
-
-        pgl_initialized = true;
-
-        return 0;
     }
-
-    if (NULL == loader_fp)
+    else if (NULL == loader_fp)
     {
         if (!gladLoadGL())
         {
@@ -1422,13 +2213,53 @@ int pgl_global_init(pgl_loader_fn loader_fp, bool gles)
         }
     }
 
-    PGL_CHECK(glEnable(GL_BLEND));
+    // The GL state is unknown until it is set, on both GL and GLES
+    pgl_invalidate_state_cache();
+
+    if (!gles)
+        pgl_gl_set_cap(PGL_CAP_BLEND, true);
 
     pgl_initialized = true;
 
     return 0;
 }
 
+void pgl_invalidate_state_cache(void)
+{
+    pgl_gl_state.program      = PGL_UNKNOWN_ID;
+    pgl_gl_state.texture      = PGL_UNKNOWN_ID;
+    pgl_gl_state.vao          = PGL_UNKNOWN_ID;
+    pgl_gl_state.array_buffer = PGL_UNKNOWN_ID;
+
+    for (int i = 0; i < PGL_CAP_COUNT; i++)
+    {
+        pgl_gl_state.caps[i] = -1;
+    }
+
+    pgl_blend_mode_t mode =
+    {
+        PGL_FACTOR_COUNT, PGL_FACTOR_COUNT, PGL_EQ_COUNT,
+        PGL_FACTOR_COUNT, PGL_FACTOR_COUNT, PGL_EQ_COUNT
+    };
+
+    pgl_gl_state.blend_mode = mode;
+
+    pgl_viewport_t viewport = { -1, -1, -1, -1 };
+    pgl_gl_state.viewport = viewport;
+
+    pgl_gl_state.line_width = -1.0f;
+
+    for (int i = 0; i < 4; i++)
+    {
+        pgl_gl_state.clear_color[i] = -1.0f;
+    }
+}
+
+uint64_t pgl_get_elided_calls(void)
+{
+    return pgl_gl_state.elided;
+}
+
 pgl_ctx_t* pgl_create_context(uint32_t w, uint32_t h, bool depth,
                               uint32_t samples, bool srgb, void* mem_ctx)
 {
@@ -1445,6 +2276,14 @@ pgl_ctx_t* pgl_create_context(uint32_t w, uint32_t h, bool depth,
 
     memset(ctx, 0, sizeof(pgl_ctx_t));
 
+    ctx->batch.vertices = PGL_MALLOC(PGL_BATCH_SIZE, mem_ctx);
+
+    if (!ctx->batch.vertices)
+    {
+        PGL_FREE(ctx, mem_ctx);
+        return NULL;
+    }
+
     ctx->w = w;
     ctx->h = h;
     ctx->samples = samples;
@@ -1452,17 +2291,19 @@ pgl_ctx_t* pgl_create_context(uint32_t w, uint32_t h, bool depth,
     ctx->depth = depth;
     ctx->mem_ctx = mem_ctx;
 
-    // Create VBO/EBO
-    PGL_CHECK(glGenVertexArrays(1, &ctx->vao));
-    PGL_CHECK(glBindVertexArray(ctx->vao));
-    PGL_CHECK(glGenBuffers(1, &ctx->vbo));
-    PGL_CHECK(glGenBuffers(1, &ctx->ebo));
-    PGL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ctx->ebo));
-    PGL_CHECK(glBufferData(GL_ELEMENT_ARRAY_BUFFER, 0, NULL, GL_STATIC_DRAW));
-    PGL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, ctx->vbo));
-    PGL_CHECK(glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_STATIC_DRAW));
-    pgl_bind_attributes();
-    PGL_CHECK(glBindVertexArray(0));
+    // Create the streaming VBO/EBO used by the immediate draw functions. The
+    // vertex array of pgl_vertex_t is bound first to record the EBO.
+    pgl_layout_t* layout = &ctx->layouts[0];
+
+    PGL_CHECK(glGenVertexArrays(1, &layout->vao));
+    pgl_gl_bind_vertex_array(layout->vao);
+    pgl_init_stream(&ctx->index_stream, GL_ELEMENT_ARRAY_BUFFER, PGL_STREAM_BUFFER_SIZE);
+    pgl_init_stream(&ctx->vertex_stream, GL_ARRAY_BUFFER, PGL_STREAM_BUFFER_SIZE);
+
+    layout->format = pgl_default_format;
+    ctx->layout_count = 1;
+
+    pgl_bind_attributes(&pgl_default_format);
 
     if (samples > 0)
     {
@@ -1472,7 +2313,7 @@ pgl_ctx_t* pgl_create_context(uint32_t w, uint32_t h, bool depth,
         if (samples > (uint32_t)max_samples)
             ctx->samples = (uint32_t)max_samples;
 
-        PGL_CHECK(glEnable(GL_MULTISAMPLE));
+        pgl_gl_set_cap(PGL_CAP_MULTISAMPLE, true);
     }
 
     pgl_clear_stack(ctx);
@@ -1485,9 +2326,19 @@ void pgl_destroy_context(pgl_ctx_t* ctx)
 {
     PGL_ASSERT(ctx);
 
-    PGL_CHECK(glDeleteBuffers(1, &ctx->vbo));
-    PGL_CHECK(glDeleteBuffers(1, &ctx->ebo));
-    PGL_CHECK(glDeleteVertexArrays(1, &ctx->vao));
+    // Batched vertices are discarded
+    if (pgl_batch_ctx == ctx)
+        pgl_batch_ctx = NULL;
+
+    PGL_FREE(ctx->batch.vertices, ctx->mem_ctx);
+
+    pgl_destroy_stream(&ctx->vertex_stream);
+    pgl_destroy_stream(&ctx->index_stream);
+
+    for (pgl_size_t i = 0; i < ctx->layout_count; i++)
+    {
+        pgl_gl_delete_vertex_array(ctx->layouts[i].vao);
+    }
     PGL_FREE(ctx, ctx->mem_ctx);
 }
 
@@ -1521,6 +2372,64 @@ pgl_shader_t* pgl_create_shader(pgl_ctx_t* ctx, const char* vert_src,
         frag_src = pgl_get_default_frag_shader();
     }
 
+    pgl_shader_t* shader = PGL_MALLOC(sizeof(pgl_shader_t), ctx->mem_ctx);
+
+    if (!shader)
+    {
+        pgl_set_error(ctx, PGL_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    memset(shader, 0, sizeof(pgl_shader_t));
+
+    shader->ctx = ctx;
+
+    // Try the program cache first
+    bool cache = pgl_program_cache_enabled();
+    uint64_t key = 0;
+
+    if (cache)
+    {
+        key = pgl_program_key(vert_src, frag_src);
+        shader->program = pgl_load_program(shader, key);
+    }
+
+    bool cached = (0 != shader->program);
+
+    if (!cached)
+    {
+        shader->program = pgl_compile_program(ctx, vert_src, frag_src, cache);
+
+        if (0 == shader->program)
+        {
+            PGL_FREE(shader, ctx->mem_ctx);
+            return NULL;
+        }
+    }
+
+    pgl_bind_shader(ctx, shader);
+
+    if (cached)
+    {
+        pgl_init_uniforms(shader);
+    }
+    else
+    {
+        pgl_load_uniforms(shader);
+
+        if (cache)
+            pgl_save_program(shader, key);
+    }
+
+    shader->transform  = pgl_find_uniform(shader, "u_transform");
+    shader->projection = pgl_find_uniform(shader, "u_projection");
+
+    return shader;
+}
+
+static GLuint pgl_compile_program(pgl_ctx_t* ctx, const char* vert_src,
+                                  const char* frag_src, bool retrievable)
+{
     // Create shaders
     GLuint vs, fs, program;
 
@@ -1543,7 +2452,7 @@ pgl_shader_t* pgl_create_shader(pgl_ctx_t* ctx, const char* vert_src,
         PGL_CHECK(glDeleteShader(vs));
         PGL_LOG("Error compiling vertex shader: %s", msg);
         pgl_set_error(ctx, PGL_SHADER_COMPILATION_ERROR);
-        return NULL;
+        return 0;
     }
 
     // Compile fragment shader
@@ -1560,7 +2469,7 @@ pgl_shader_t* pgl_create_shader(pgl_ctx_t* ctx, const char* vert_src,
         PGL_CHECK(glDeleteShader(fs));
         PGL_LOG("Error compiling fragment shader: %s", msg);
         pgl_set_error(ctx, PGL_SHADER_COMPILATION_ERROR);
-        return NULL;
+        return 0;
     }
 
     // Link program
@@ -1570,6 +2479,11 @@ pgl_shader_t* pgl_create_shader(pgl_ctx_t* ctx, const char* vert_src,
 
     PGL_CHECK(glAttachShader(program, vs));
     PGL_CHECK(glAttachShader(program, fs));
+
+    // Some drivers only keep the binary if asked before linking
+    if (retrievable)
+        PGL_CHECK(glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+
     PGL_CHECK(glLinkProgram(program));
     PGL_CHECK(glGetProgramiv(program, GL_LINK_STATUS, &is_linked));
 
@@ -1584,26 +2498,39 @@ pgl_shader_t* pgl_create_shader(pgl_ctx_t* ctx, const char* vert_src,
         PGL_CHECK(glDeleteProgram(program));
         PGL_LOG("Error linking shader program: %s", msg);
         pgl_set_error(ctx, PGL_SHADER_LINKING_ERROR);
-        return NULL;
+        return 0;
     }
 
-    pgl_shader_t* shader = PGL_MALLOC(sizeof(pgl_shader_t), ctx->mem_ctx);
+    return program;
+}
 
-    if (!shader)
+int pgl_set_program_cache_dir(const char* path)
+{
+    if (!path)
     {
-        pgl_set_error(ctx, PGL_OUT_OF_MEMORY);
-        return NULL;
+        pgl_program_cache_dir[0] = '\0';
+        return 0;
     }
 
-    memset(shader, 0, sizeof(pgl_shader_t));
+    size_t length = strlen(path);
 
-    shader->program = program;
-    shader->ctx = ctx;
+    if (length >= PGL_MAX_PATH_LENGTH)
+    {
+        PGL_LOG("Program cache path is too long");
+        pgl_program_cache_dir[0] = '\0';
+        return -1;
+    }
 
-    pgl_bind_shader(ctx, shader);
-    pgl_load_uniforms(shader);
+    memcpy(pgl_program_cache_dir, path, length + 1);
 
-    return shader;
+    return 0;
+}
+
+pgl_shader_t* pgl_create_instanced_shader(pgl_ctx_t* ctx, const char* frag_src)
+{
+    PGL_ASSERT(ctx);
+
+    return pgl_create_shader(ctx, pgl_get_instanced_vert_shader(), frag_src);
 }
 
 void pgl_destroy_shader(pgl_shader_t* shader)
@@ -1613,6 +2540,10 @@ void pgl_destroy_shader(pgl_shader_t* shader)
 
     pgl_bind_shader(shader->ctx, NULL);
     PGL_CHECK(glDeleteProgram(shader->program));
+
+    if (shader->uniform_values)
+        PGL_FREE(shader->uniform_values, shader->ctx->mem_ctx);
+
     PGL_FREE(shader, shader->ctx->mem_ctx);
 }
 
@@ -1627,24 +2558,17 @@ void pgl_bind_shader(pgl_ctx_t* ctx, pgl_shader_t* shader)
 {
     PGL_ASSERT(ctx);
 
-    if (ctx->shader == shader)
-        return;
+    // Uniform setters bind their shader, so this also keeps uniform changes
+    // from applying to vertices batched earlier
+    pgl_flush_pending();
 
-    if (NULL != shader)
-    {
-        PGL_CHECK(glUseProgram(shader->program));
-        ctx->shader = shader;
-    }
-    else
-    {
-        PGL_CHECK(glUseProgram(0));
-        ctx->shader = NULL;
-    }
+    ctx->shader = shader;
+    pgl_gl_use_program((NULL != shader) ? shader->program : 0);
 }
 
 static void pgl_set_texture_params(GLuint tex_id, bool smooth, bool repeat)
 {
-    PGL_CHECK(glBindTexture(GL_TEXTURE_2D, tex_id));
+    pgl_gl_bind_texture(tex_id);
 
     PGL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
                               smooth ? GL_LINEAR : GL_NEAREST));
@@ -1667,6 +2591,9 @@ pgl_texture_t* pgl_create_texture(pgl_ctx_t* ctx,
 {
     PGL_ASSERT(ctx);
 
+    // Texture creation changes the bindings behind the context's back
+    pgl_flush_pending();
+
     // Check texture dimensions
     if (w <= 0 || h <= 0)
     {
@@ -1706,7 +2633,7 @@ pgl_texture_t* pgl_create_texture(pgl_ctx_t* ctx,
 
     if (-1 == pgl_upload_texture(ctx, tex, w, h, NULL))
     {
-        PGL_CHECK(glDeleteTextures(1, &tex->id));
+        pgl_gl_delete_texture(tex->id);
         PGL_FREE(tex, ctx->mem_ctx);
         return NULL;
     }
@@ -1726,7 +2653,6 @@ pgl_texture_t* pgl_create_texture(pgl_ctx_t* ctx,
 
             pgl_set_texture_params(tex->depth_id, smooth, repeat);
 
-            PGL_CHECK(glBindTexture(GL_TEXTURE_2D, tex->depth_id));
             PGL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, w, h, 0,
                                    GL_DEPTH_COMPONENT, GL_UNSIGNED_BYTE, NULL));
         }
@@ -1819,12 +2745,12 @@ pgl_texture_t* pgl_create_texture(pgl_ctx_t* ctx,
 
             // Framebuffer is incomplete, so release resources
 
-            PGL_CHECK(glDeleteTextures(1, &tex->id));
+            pgl_gl_delete_texture(tex->id);
             PGL_CHECK(glDeleteFramebuffers(1, &tex->fbo));
 
             if (ctx->depth)
             {
-                PGL_CHECK(glDeleteTextures(1, &tex->depth_id));
+                pgl_gl_delete_texture(tex->depth_id);
             }
 
             if (ctx->samples > 0)
@@ -1869,7 +2795,7 @@ pgl_texture_t* pgl_texture_from_bitmap(pgl_ctx_t* ctx,
 
     if (-1 == pgl_upload_texture(ctx, tex, w, h, bitmap))
     {
-        PGL_CHECK(glDeleteTextures(1, &tex->id));
+        pgl_gl_delete_texture(tex->id);
         PGL_FREE(tex, ctx->mem_ctx);
         return NULL;
     }
@@ -1914,6 +2840,147 @@ void pgl_update_texture(pgl_ctx_t* ctx,
                               GL_UNSIGNED_BYTE, bitmap));
 }
 
+pgl_upload_buffer_t* pgl_create_upload_buffer(pgl_ctx_t* ctx, size_t size)
+{
+    PGL_ASSERT(ctx);
+    PGL_ASSERT(size > 0);
+
+    pgl_upload_buffer_t* buffer = PGL_MALLOC(sizeof(pgl_upload_buffer_t), ctx->mem_ctx);
+
+    if (!buffer)
+    {
+        pgl_set_error(ctx, PGL_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    buffer->ctx = ctx;
+    buffer->size = size;
+    buffer->mapped = false;
+    buffer->fence = NULL;
+
+    PGL_CHECK(glGenBuffers(1, &buffer->pbo));
+
+    PGL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer->pbo));
+    PGL_CHECK(glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW));
+    PGL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+
+    return buffer;
+}
+
+void pgl_destroy_upload_buffer(pgl_upload_buffer_t* buffer)
+{
+    PGL_ASSERT(buffer);
+
+    if (buffer->mapped)
+    {
+        PGL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer->pbo));
+        PGL_CHECK(glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER));
+        PGL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+    }
+
+    if (buffer->fence)
+        PGL_CHECK(glDeleteSync(buffer->fence));
+
+    PGL_CHECK(glDeleteBuffers(1, &buffer->pbo));
+
+    PGL_FREE(buffer, buffer->ctx->mem_ctx);
+}
+
+uint8_t* pgl_map_upload_buffer(pgl_upload_buffer_t* buffer)
+{
+    PGL_ASSERT(buffer);
+    PGL_ASSERT(!buffer->mapped);
+
+    // Invalidating the whole buffer lets the driver hand out fresh storage if
+    // a copy from the old storage is still pending
+    PGL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer->pbo));
+
+    void* ptr;
+
+    PGL_CHECK(ptr = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, buffer->size,
+                                     GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+
+    PGL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+
+    if (!ptr)
+    {
+        pgl_set_error(buffer->ctx, PGL_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    buffer->mapped = true;
+
+    return ptr;
+}
+
+int pgl_upload_texture_async(pgl_ctx_t* ctx,
+                             pgl_upload_buffer_t* buffer,
+                             pgl_texture_t* texture,
+                             int x, int y,
+                             int w, int h)
+{
+    PGL_ASSERT(ctx);
+    PGL_ASSERT(buffer);
+    PGL_ASSERT(texture);
+    PGL_ASSERT(buffer->mapped);
+    PGL_ASSERT(x >= 0 && y >= 0 && w > 0 && h > 0);
+    PGL_ASSERT(x + w <= texture->w && y + h <= texture->h);
+    PGL_ASSERT((size_t)w * (size_t)h * pgl_format_size_map[texture->fmt] <= buffer->size);
+
+    PGL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer->pbo));
+
+    GLboolean intact;
+    PGL_CHECK(intact = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER));
+
+    buffer->mapped = false;
+
+    // The buffer contents are undefined if the storage was lost while mapped
+    if (!intact)
+    {
+        PGL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+        pgl_set_error(ctx, PGL_INVALID_OPERATION);
+        return -1;
+    }
+
+    // Binds the texture and draws batched vertices that still use its old
+    // contents
+    pgl_bind_texture(ctx, texture);
+
+    // With a pixel unpack buffer bound, the pointer is an offset into it
+    PGL_CHECK(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+    PGL_CHECK(glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h,
+                              pgl_format_map[texture->fmt],
+                              GL_UNSIGNED_BYTE, (GLvoid*)0));
+    PGL_CHECK(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+
+    PGL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+
+    if (buffer->fence)
+        PGL_CHECK(glDeleteSync(buffer->fence));
+
+    PGL_CHECK(buffer->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+
+    return 0;
+}
+
+bool pgl_is_upload_complete(pgl_upload_buffer_t* buffer)
+{
+    PGL_ASSERT(buffer);
+
+    if (!buffer->fence)
+        return true;
+
+    GLenum result = glClientWaitSync(buffer->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+
+    if (GL_TIMEOUT_EXPIRED == result)
+        return false;
+
+    PGL_CHECK(glDeleteSync(buffer->fence));
+    buffer->fence = NULL;
+
+    return true;
+}
+
 int pgl_generate_mipmap(pgl_texture_t* texture, bool linear)
 {
     PGL_ASSERT(texture);
@@ -1947,8 +3014,9 @@ void pgl_destroy_texture(pgl_texture_t* tex)
 {
     PGL_ASSERT(tex);
 
-    pgl_bind_texture(tex->ctx, NULL);
-    PGL_CHECK(glDeleteTextures(1, &tex->id));
+    // Batched vertices may still use the texture
+    pgl_flush_pending();
+    pgl_gl_delete_texture(tex->id);
 
     if (tex->target)
     {
@@ -1956,7 +3024,7 @@ void pgl_destroy_texture(pgl_texture_t* tex)
 
         if (tex->ctx->depth)
         {
-            PGL_CHECK(glDeleteTextures(1, &tex->depth_id));
+            pgl_gl_delete_texture(tex->depth_id);
         }
 
         if (tex->ctx->samples > 0)
@@ -2001,25 +3069,17 @@ void pgl_bind_texture(pgl_ctx_t* ctx, pgl_texture_t* texture)
 {
     PGL_ASSERT(ctx);
 
-    if (ctx->texture == texture)
-        return;
+    pgl_flush_pending();
 
-    if (NULL != texture)
-    {
-        PGL_CHECK(glBindTexture(GL_TEXTURE_2D, texture->id));
-        ctx->texture = texture;
-    }
-    else
-    {
-        PGL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
-        ctx->texture = NULL;
-    }
+    pgl_gl_bind_texture((NULL != texture) ? texture->id : 0);
 }
 
 int pgl_set_render_target(pgl_ctx_t* ctx, pgl_texture_t* target)
 {
     PGL_ASSERT(ctx);
 
+    pgl_flush_pending();
+
     if (ctx->target == target)
         return 0;
 
@@ -2037,7 +3097,6 @@ int pgl_set_render_target(pgl_ctx_t* ctx, pgl_texture_t* target)
         PGL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
 
         ctx->target = NULL;
-        pgl_reset_last_state(ctx);
 
         return 0;
     }
@@ -2051,7 +3110,6 @@ int pgl_set_render_target(pgl_ctx_t* ctx, pgl_texture_t* target)
 
     pgl_clear_stack(ctx);
     pgl_reset_state(ctx);
-    pgl_reset_last_state(ctx);
     pgl_set_viewport(ctx, 0, 0, target->w, target->h);
 
     return 0;
@@ -2059,7 +3117,20 @@ int pgl_set_render_target(pgl_ctx_t* ctx, pgl_texture_t* target)
 
 void pgl_clear(float r, float g, float b, float a)
 {
-    PGL_CHECK(glClearColor(r, g, b, a));
+    pgl_flush_pending();
+
+    float color[4] = { r, g, b, a };
+
+    if (pgl_mem_equal(color, pgl_gl_state.clear_color, sizeof(color)))
+    {
+        pgl_gl_state.elided++;
+    }
+    else
+    {
+        PGL_CHECK(glClearColor(r, g, b, a));
+        memcpy(pgl_gl_state.clear_color, color, sizeof(color));
+    }
+
     PGL_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
 }
 
@@ -2069,58 +3140,271 @@ void pgl_draw_array(pgl_ctx_t* ctx,
                    pgl_size_t count,
                    pgl_texture_t* texture,
                    pgl_shader_t* shader)
+{
+    pgl_draw_formatted_array(ctx, primitive, &pgl_default_format,
+                             vertices, count, texture, shader);
+}
+
+void pgl_draw_formatted_array(pgl_ctx_t* ctx,
+                              pgl_primitive_t primitive,
+                              const pgl_vertex_format_t* format,
+                              const void* vertices,
+                              pgl_size_t count,
+                              pgl_texture_t* texture,
+                              pgl_shader_t* shader)
 {
     PGL_ASSERT(ctx);
+    PGL_ASSERT(format);
     PGL_ASSERT(vertices);
     PGL_ASSERT(shader);
 
-    pgl_before_draw(ctx, texture, shader);
+    pgl_size_t list_count = pgl_list_vertex_count(primitive, count);
 
-    PGL_CHECK(glBindVertexArray(ctx->vao));
+    if (0 == list_count)
+        return;
 
-    PGL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, ctx->vbo));
-    PGL_CHECK(glBufferData(GL_ARRAY_BUFFER, count * sizeof(pgl_vertex_t), vertices, GL_STATIC_DRAW));
+    pgl_layout_t* layout = pgl_get_layout(ctx, format);
 
-    PGL_CHECK(glDrawArrays(pgl_primitive_map[primitive], 0, count));
-    PGL_CHECK(glBindVertexArray(0));
+    if (!layout)
+        return;
 
-    pgl_after_draw(ctx);
-}
+    pgl_state_t* state = pgl_get_active_state(ctx);
 
-void pgl_draw_indexed_array(pgl_ctx_t* ctx,
-                            pgl_primitive_t primitive,
-                            const pgl_vertex_t* vertices, pgl_size_t vertex_count,
-                            const uint32_t* indices, pgl_size_t index_count,
-                            pgl_texture_t* texture,
-                            pgl_shader_t* shader)
-{
-    PGL_ASSERT(ctx);
-    PGL_ASSERT(vertices);
-    PGL_ASSERT(indices);
-    PGL_ASSERT(shader);
+    pgl_size_t capacity = PGL_BATCH_SIZE / format->stride;
 
-    pgl_before_draw(ctx, texture, shader);
+    // Too large to batch
+    if (list_count > capacity)
+    {
+        pgl_flush_pending();
+        pgl_draw_vertices(ctx, primitive, layout, vertices, count, texture, shader, state);
+        return;
+    }
 
-    PGL_CHECK(glBindVertexArray(ctx->vao));
+    pgl_batch_t* batch = &ctx->batch;
 
-    PGL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, ctx->vbo));
-    PGL_CHECK(glBufferData(GL_ARRAY_BUFFER, vertex_count * sizeof(pgl_vertex_t), vertices, GL_STATIC_DRAW));
+    pgl_primitive_t list_primitive = pgl_list_primitive(primitive);
 
-    PGL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ctx->ebo));
-    PGL_CHECK(glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_count * sizeof(GLuint), indices, GL_STATIC_DRAW));
+    bool compatible = batch->count > 0 &&
+                      batch->primitive == list_primitive &&
+                      batch->layout == layout &&
+                      batch->texture == texture &&
+                      batch->shader == shader &&
+                      pgl_mem_equal(&batch->state, state, sizeof(pgl_state_t));
 
-    PGL_CHECK(glDrawElements(pgl_primitive_map[primitive], index_count, GL_UNSIGNED_INT, 0));
-    PGL_CHECK(glBindVertexArray(0));
+    if (!compatible || batch->count + list_count > capacity)
+        pgl_flush(ctx);
 
-    pgl_after_draw(ctx);
+    if (0 == batch->count)
+    {
+        // Draws must reach OpenGL in order, even across contexts
+        pgl_flush_pending();
+
+        pgl_batch_ctx = ctx;
+
+        batch->primitive = list_primitive;
+        batch->layout = layout;
+        batch->texture = texture;
+        batch->shader = shader;
+        batch->state = *state;
+    }
+
+    pgl_copy_as_list(batch->vertices + batch->count * format->stride,
+                     primitive, vertices, count, format->stride);
+
+    batch->count += list_count;
+}
+
+uint16_t pgl_float_to_half(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+    int32_t  exponent = (int32_t)((bits >> 23) & 0xFF);
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    // Infinity and NaN
+    if (0xFF == exponent)
+        return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+
+    exponent += 15 - 127;
+
+    // Too large, rounds to infinity
+    if (exponent >= 31)
+        return sign | 0x7C00;
+
+    // Too small, rounds to zero
+    if (exponent < -10)
+        return sign;
+
+    uint32_t shift = 13;
+    uint32_t half;
+
+    if (exponent <= 0)
+    {
+        // Subnormal, the implicit leading bit becomes explicit
+        mantissa |= 0x800000;
+        shift = (uint32_t)(14 - exponent);
+        half = mantissa >> shift;
+    }
+    else
+    {
+        half = ((uint32_t)exponent << 10) | (mantissa >> shift);
+    }
+
+    // Round to nearest even. A carry into the exponent is still correct.
+    uint32_t rest = mantissa & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+
+    if (rest > halfway || (rest == halfway && (half & 1)))
+        half++;
+
+    return sign | (uint16_t)half;
+}
+
+void pgl_flush(pgl_ctx_t* ctx)
+{
+    PGL_ASSERT(ctx);
+
+    pgl_batch_t* batch = &ctx->batch;
+
+    if (0 == batch->count)
+        return;
+
+    // Cleared first, because drawing binds the shader and texture, which
+    // flushes again
+    pgl_size_t count = batch->count;
+    batch->count = 0;
+
+    if (pgl_batch_ctx == ctx)
+        pgl_batch_ctx = NULL;
+
+    pgl_draw_vertices(ctx, batch->primitive, batch->layout, batch->vertices, count,
+                      batch->texture, batch->shader, &batch->state);
+}
+
+// Only one batch is pending at a time, but it may belong to another context.
+// Anything that issues GL commands or changes global GL state draws it first.
+static void pgl_flush_pending(void)
+{
+    if (pgl_batch_ctx)
+        pgl_flush(pgl_batch_ctx);
+}
+
+static void pgl_draw_vertices(pgl_ctx_t* ctx,
+                              pgl_primitive_t primitive,
+                              const pgl_layout_t* layout,
+                              const void* vertices,
+                              pgl_size_t count,
+                              pgl_texture_t* texture,
+                              pgl_shader_t* shader,
+                              const pgl_state_t* state)
+{
+    pgl_before_draw(ctx, texture, shader, state);
+
+    pgl_gl_bind_vertex_array(layout->vao);
+
+    GLintptr offset;
+    GLsizeiptr stride = layout->format.stride;
+    GLsizeiptr size = count * stride;
+
+    // Vertices are aligned so that they can be addressed by index
+    void* dst = pgl_map_stream(&ctx->vertex_stream, size, stride, &offset);
+
+    if (!dst)
+    {
+        pgl_set_error(ctx, PGL_OUT_OF_MEMORY);
+        return;
+    }
+
+    memcpy(dst, vertices, size);
+    PGL_CHECK(glUnmapBuffer(GL_ARRAY_BUFFER));
+
+    GLint first = (GLint)(offset / stride);
+
+    PGL_CHECK(glDrawArrays(pgl_primitive_map[primitive], first, count));
+}
+
+void pgl_draw_indexed_array(pgl_ctx_t* ctx,
+                            pgl_primitive_t primitive,
+                            const pgl_vertex_t* vertices, pgl_size_t vertex_count,
+                            const uint32_t* indices, pgl_size_t index_count,
+                            pgl_texture_t* texture,
+                            pgl_shader_t* shader)
+{
+    PGL_ASSERT(ctx);
+    PGL_ASSERT(vertices);
+    PGL_ASSERT(indices);
+    PGL_ASSERT(shader);
+
+    if (0 == vertex_count || 0 == index_count)
+        return;
+
+    pgl_flush_pending();
+
+    pgl_state_t* state = pgl_get_active_state(ctx);
+
+    pgl_before_draw(ctx, texture, shader, state);
+
+    pgl_gl_bind_vertex_array(ctx->layouts[0].vao);
+
+    GLintptr vertex_offset, index_offset;
+    GLsizeiptr vertex_size = vertex_count * sizeof(pgl_vertex_t);
+    GLsizeiptr index_size  = index_count * sizeof(GLuint);
+
+    void* vertex_dst = pgl_map_stream(&ctx->vertex_stream, vertex_size,
+                                      sizeof(pgl_vertex_t), &vertex_offset);
+
+    if (!vertex_dst)
+    {
+        pgl_set_error(ctx, PGL_OUT_OF_MEMORY);
+        return;
+    }
+
+    memcpy(vertex_dst, vertices, vertex_size);
+    PGL_CHECK(glUnmapBuffer(GL_ARRAY_BUFFER));
+
+    GLuint* index_dst = pgl_map_stream(&ctx->index_stream, index_size,
+                                       sizeof(GLuint), &index_offset);
+
+    if (!index_dst)
+    {
+        pgl_set_error(ctx, PGL_OUT_OF_MEMORY);
+        return;
+    }
+
+    // glDrawElementsBaseVertex is not available in GLES 3.1, so the indices
+    // are rebased onto the vertices' position in the ring while copying
+    GLuint base = (GLuint)(vertex_offset / (GLintptr)sizeof(pgl_vertex_t));
+
+    for (pgl_size_t i = 0; i < index_count; i++)
+    {
+        index_dst[i] = indices[i] + base;
+    }
+
+    PGL_CHECK(glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER));
+
+    PGL_CHECK(glDrawElements(pgl_primitive_map[primitive], index_count,
+                             GL_UNSIGNED_INT, (GLvoid*)index_offset));
 }
 
 pgl_buffer_t* pgl_create_buffer(pgl_ctx_t* ctx,
                                 pgl_primitive_t primitive,
                                 const pgl_vertex_t* vertices,
                                 pgl_size_t count)
+{
+    return pgl_create_formatted_buffer(ctx, primitive, &pgl_default_format,
+                                       vertices, count);
+}
+
+pgl_buffer_t* pgl_create_formatted_buffer(pgl_ctx_t* ctx,
+                                          pgl_primitive_t primitive,
+                                          const pgl_vertex_format_t* format,
+                                          const void* vertices,
+                                          pgl_size_t count)
 {
     PGL_ASSERT(ctx);
+    PGL_ASSERT(format);
     PGL_ASSERT(vertices);
 
     pgl_buffer_t* buffer = PGL_MALLOC(sizeof(pgl_buffer_t), ctx->mem_ctx);
@@ -2134,16 +3418,19 @@ pgl_buffer_t* pgl_create_buffer(pgl_ctx_t* ctx,
     PGL_CHECK(glGenVertexArrays(1, &buffer->vao));
     PGL_CHECK(glGenBuffers(1, &buffer->vbo));
 
-    PGL_CHECK(glBindVertexArray(buffer->vao));
+    pgl_gl_bind_vertex_array(buffer->vao);
 
-    PGL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, buffer->vbo));
-    PGL_CHECK(glBufferData(GL_ARRAY_BUFFER, count * sizeof(pgl_vertex_t), vertices, GL_DYNAMIC_DRAW));
+    pgl_gl_bind_buffer(GL_ARRAY_BUFFER, buffer->vbo);
+    PGL_CHECK(glBufferData(GL_ARRAY_BUFFER, count * format->stride, vertices, GL_DYNAMIC_DRAW));
 
-    pgl_bind_attributes();
-    PGL_CHECK(glBindVertexArray(0));
+    pgl_bind_attributes(format);
 
+    buffer->ctx = ctx;
     buffer->primitive = pgl_primitive_map[primitive];
     buffer->count = count;
+    buffer->stride = format->stride;
+    buffer->instance_serial = 0;
+    buffer->first_instance = 0;
 
     return buffer;
 }
@@ -2156,20 +3443,37 @@ void pgl_sub_buffer_data(pgl_ctx_t* ctx,
 {
     PGL_ASSERT(ctx);
     PGL_ASSERT(vertices);
+    PGL_ASSERT(buffer->stride == sizeof(pgl_vertex_t));
     PGL_ASSERT(count + offset <= (pgl_size_t)buffer->count);
 
-    PGL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, buffer->vbo));
+    pgl_gl_bind_buffer(GL_ARRAY_BUFFER, buffer->vbo);
     PGL_CHECK(glBufferSubData(GL_ARRAY_BUFFER, offset, count * sizeof(pgl_vertex_t), vertices));
 
     buffer->count = count;
 }
 
+void pgl_sub_formatted_buffer_data(pgl_buffer_t* buffer,
+                                   const void* vertices,
+                                   pgl_size_t count,
+                                   pgl_size_t offset)
+{
+    PGL_ASSERT(buffer);
+    PGL_ASSERT(vertices);
+    PGL_ASSERT(count + offset <= (pgl_size_t)buffer->count);
+
+    pgl_gl_bind_buffer(GL_ARRAY_BUFFER, buffer->vbo);
+    PGL_CHECK(glBufferSubData(GL_ARRAY_BUFFER,
+                              (GLintptr)offset * buffer->stride,
+                              (GLsizeiptr)count * buffer->stride,
+                              vertices));
+}
+
 void pgl_destroy_buffer(pgl_buffer_t* buffer)
 {
     PGL_ASSERT(buffer);
 
-    PGL_CHECK(glDeleteVertexArrays(1, &buffer->vao));
-    PGL_CHECK(glDeleteBuffers(1, &buffer->vbo));
+    pgl_gl_delete_vertex_array(buffer->vao);
+    pgl_gl_delete_buffer(buffer->vbo);
 
     PGL_FREE(buffer, buffer->ctx->mem_ctx);
 }
@@ -2186,165 +3490,564 @@ void pgl_draw_buffer(pgl_ctx_t* ctx,
 
     PGL_ASSERT(start + count <= (pgl_size_t)buffer->count);
 
-    pgl_before_draw(ctx, texture, shader);
+    pgl_flush_pending();
 
-    PGL_CHECK(glBindVertexArray(buffer->vao));
-    PGL_CHECK(glDrawArrays(buffer->primitive, start, count));
-    PGL_CHECK(glBindVertexArray(0));
+    pgl_state_t* state = pgl_get_active_state(ctx);
 
-    pgl_after_draw(ctx);
-}
+    pgl_before_draw(ctx, texture, shader, state);
 
-void pgl_set_transpose(pgl_ctx_t* ctx, bool enabled)
-{
-    PGL_ASSERT(ctx);
-    ctx->transpose = enabled;
+    pgl_gl_bind_vertex_array(buffer->vao);
+    PGL_CHECK(glDrawArrays(buffer->primitive, start, count));
 }
 
-void pgl_set_blend_mode(pgl_ctx_t* ctx, pgl_blend_mode_t mode)
+pgl_instance_buffer_t* pgl_create_instance_buffer(pgl_ctx_t* ctx,
+                                                  const pgl_instance_t* instances,
+                                                  pgl_size_t count)
 {
     PGL_ASSERT(ctx);
+    PGL_ASSERT(count > 0);
 
-    pgl_state_t* state = pgl_get_active_state(ctx);
-    state->blend_mode = mode;
-}
-
-void pgl_reset_blend_mode(pgl_ctx_t* ctx)
-{
-    PGL_ASSERT(ctx);
+    pgl_instance_buffer_t* buffer = PGL_MALLOC(sizeof(pgl_instance_buffer_t), ctx->mem_ctx);
 
-    pgl_state_t* state = pgl_get_active_state(ctx);
+    if (!buffer)
+    {
+        pgl_set_error(ctx, PGL_OUT_OF_MEMORY);
+        return NULL;
+    }
 
-    pgl_blend_mode_t mode = {
-        PGL_SRC_ALPHA,
-        PGL_ONE_MINUS_SRC_ALPHA,
-        PGL_FUNC_ADD,
-        PGL_ONE,
-        PGL_ONE_MINUS_SRC_ALPHA,
-        PGL_FUNC_ADD
-    };
+    PGL_CHECK(glGenBuffers(1, &buffer->vbo));
 
-    state->blend_mode = mode;
-}
+    pgl_gl_bind_buffer(GL_ARRAY_BUFFER, buffer->vbo);
+    PGL_CHECK(glBufferData(GL_ARRAY_BUFFER, count * sizeof(pgl_instance_t), instances, GL_DYNAMIC_DRAW));
 
-void pgl_set_transform(pgl_ctx_t* ctx, const pgl_m4_t matrix)
-{
-    PGL_ASSERT(ctx);
-    PGL_ASSERT(matrix);
+    buffer->ctx = ctx;
+    buffer->count = count;
+    buffer->serial = ++pgl_instance_serial;
 
-    pgl_state_t* state = pgl_get_active_state(ctx);
-    memcpy(state->transform, matrix, sizeof(pgl_m4_t));
+    return buffer;
 }
 
-void pgl_set_transform_3d(pgl_ctx_t* ctx, const pgl_m3_t matrix)
+void pgl_sub_instance_data(pgl_instance_buffer_t* buffer,
+                           const pgl_instance_t* instances,
+                           pgl_size_t count,
+                           pgl_size_t offset)
 {
-    PGL_ASSERT(ctx);
-    PGL_ASSERT(matrix);
+    PGL_ASSERT(buffer);
+    PGL_ASSERT(instances);
+    PGL_ASSERT(count + offset <= buffer->count);
 
-    if (ctx->transpose)
-    {
-        const pgl_m4_t matrix4 =
-        {
-            matrix[0], matrix[1], 0.0f, matrix[2],
-            matrix[3], matrix[4], 0.0f, matrix[5],
-            0.0f,      0.0f,      1.0f, 0.0f,
-            matrix[6], matrix[7], 0.0f, matrix[8]
-        };
+    pgl_gl_bind_buffer(GL_ARRAY_BUFFER, buffer->vbo);
 
-        pgl_set_transform(ctx, matrix4);
-    }
-    else
+    // Orphan the storage when all of it is replaced
+    if (0 == offset && count == buffer->count)
     {
-        const pgl_m4_t matrix4 =
-        {
-            matrix[0], matrix[3], 0.0f, matrix[6],
-            matrix[1], matrix[4], 0.0f, matrix[7],
-            0.0f,      0.0f,      1.0f, 0.0f,
-            matrix[2], matrix[5], 0.0f, matrix[8]
-        };
-
-        pgl_set_transform(ctx, matrix4);
+        PGL_CHECK(glBufferData(GL_ARRAY_BUFFER, count * sizeof(pgl_instance_t), instances, GL_DYNAMIC_DRAW));
+        return;
     }
+
+    PGL_CHECK(glBufferSubData(GL_ARRAY_BUFFER, offset * sizeof(pgl_instance_t),
+                              count * sizeof(pgl_instance_t), instances));
 }
 
-void pgl_reset_transform(pgl_ctx_t* ctx)
+void pgl_destroy_instance_buffer(pgl_instance_buffer_t* buffer)
 {
-    PGL_ASSERT(ctx);
-
-    pgl_state_t* state = pgl_get_active_state(ctx);
+    PGL_ASSERT(buffer);
 
-    const pgl_m4_t matrix =
-    {
-        1.0f, 0.0f, 0.0f, 0.0f,
-        0.0f, 1.0f, 0.0f, 0.0f,
-        0.0f, 0.0f, 1.0f, 0.0f,
-        0.0f, 0.0f, 0.0f, 1.0f
-    };
+    pgl_gl_delete_buffer(buffer->vbo);
 
-    memcpy(state->transform, matrix, sizeof(pgl_m4_t));
+    PGL_FREE(buffer, buffer->ctx->mem_ctx);
 }
 
-void pgl_set_projection(pgl_ctx_t* ctx, const pgl_m4_t matrix)
+void pgl_draw_buffer_instanced(pgl_ctx_t* ctx,
+                               pgl_buffer_t* buffer,
+                               pgl_size_t start, pgl_size_t count,
+                               const pgl_instance_buffer_t* instances,
+                               pgl_size_t first_instance,
+                               pgl_size_t instance_count,
+                               pgl_texture_t* texture,
+                               pgl_shader_t* shader)
 {
     PGL_ASSERT(ctx);
-    PGL_ASSERT(matrix);
+    PGL_ASSERT(buffer);
+    PGL_ASSERT(instances);
+    PGL_ASSERT(shader);
+
+    PGL_ASSERT(start + count <= (pgl_size_t)buffer->count);
+    PGL_ASSERT(first_instance + instance_count <= instances->count);
+
+    if (0 == count || 0 == instance_count)
+        return;
+
+    pgl_flush_pending();
 
     pgl_state_t* state = pgl_get_active_state(ctx);
-    memcpy(state->projection, matrix, sizeof(pgl_m4_t));
+
+    pgl_before_draw(ctx, texture, shader, state);
+
+    pgl_gl_bind_vertex_array(buffer->vao);
+    pgl_attach_instances(buffer, instances, first_instance);
+
+    PGL_CHECK(glDrawArraysInstanced(buffer->primitive, start, count, instance_count));
 }
 
-void pgl_set_projection_3d(pgl_ctx_t* ctx, const pgl_m3_t matrix)
+pgl_pool_t* pgl_create_pool(pgl_ctx_t* ctx,
+                            pgl_primitive_t primitive,
+                            const pgl_vertex_format_t* format,
+                            pgl_size_t vertex_capacity,
+                            pgl_size_t index_capacity,
+                            pgl_size_t max_ranges)
 {
     PGL_ASSERT(ctx);
-    PGL_ASSERT(matrix);
+    PGL_ASSERT(vertex_capacity > 0);
+    PGL_ASSERT(max_ranges > 0);
 
-    if (ctx->transpose)
-    {
-        const pgl_m4_t matrix4 =
-        {
-            matrix[0], matrix[1], 0.0f, matrix[2],
-            matrix[3], matrix[4], 0.0f, matrix[5],
-            0.0f,      0.0f,      1.0f, 0.0f,
-            matrix[6], matrix[7], 0.0f, matrix[8]
-        };
+    if (!format)
+        format = &pgl_default_format;
 
-        pgl_set_projection(ctx, matrix4);
+    // There are never more free spans than ranges plus one
+    pgl_size_t max_spans = max_ranges + 1;
+
+    // The pool and its arrays are allocated in one block. Arrays are ordered
+    // by decreasing alignment.
+    size_t size = sizeof(pgl_pool_t) +
+                  max_ranges * sizeof(GLvoid*) +
+                  max_ranges * sizeof(pgl_pool_range_t) +
+                  2 * max_spans * sizeof(pgl_span_t) +
+                  max_ranges * sizeof(GLint) +
+                  max_ranges * sizeof(GLsizei);
+
+    pgl_pool_t* pool = PGL_MALLOC(size, ctx->mem_ctx);
+
+    if (!pool)
+    {
+        pgl_set_error(ctx, PGL_OUT_OF_MEMORY);
+        return NULL;
     }
-    else
+
+    memset(pool, 0, size);
+
+    uint8_t* ptr = (uint8_t*)(pool + 1);
+
+    pool->offsets = (const GLvoid**)ptr;
+    ptr += max_ranges * sizeof(GLvoid*);
+
+    pool->ranges = (pgl_pool_range_t*)ptr;
+    ptr += max_ranges * sizeof(pgl_pool_range_t);
+
+    pool->free_vertices.spans = (pgl_span_t*)ptr;
+    ptr += max_spans * sizeof(pgl_span_t);
+
+    pool->free_indices.spans = (pgl_span_t*)ptr;
+    ptr += max_spans * sizeof(pgl_span_t);
+
+    pool->firsts = (GLint*)ptr;
+    ptr += max_ranges * sizeof(GLint);
+
+    pool->counts = (GLsizei*)ptr;
+
+    pool->ctx = ctx;
+    pool->primitive = pgl_primitive_map[primitive];
+    pool->stride = format->stride;
+    pool->max_ranges = max_ranges;
+
+    pool->free_vertices.spans[0] = (pgl_span_t){ 0, vertex_capacity };
+    pool->free_vertices.count = 1;
+
+    pool->free_indices.spans[0] = (pgl_span_t){ 0, index_capacity };
+    pool->free_indices.count = (index_capacity > 0) ? 1 : 0;
+
+    PGL_CHECK(glGenVertexArrays(1, &pool->vao));
+    PGL_CHECK(glGenBuffers(1, &pool->vbo));
+
+    pgl_gl_bind_vertex_array(pool->vao);
+
+    pgl_gl_bind_buffer(GL_ARRAY_BUFFER, pool->vbo);
+    PGL_CHECK(glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)vertex_capacity * format->stride,
+                           NULL, GL_STATIC_DRAW));
+
+    pgl_bind_attributes(format);
+
+    if (index_capacity > 0)
     {
-        const pgl_m4_t matrix4 =
-        {
-            matrix[0], matrix[3], 0.0f, matrix[6],
-            matrix[1], matrix[4], 0.0f, matrix[7],
-            0.0f,      0.0f,      1.0f, 0.0f,
-            matrix[2], matrix[5], 0.0f, matrix[8]
-        };
+        PGL_CHECK(glGenBuffers(1, &pool->ebo));
 
-        pgl_set_projection(ctx, matrix4);
+        pgl_gl_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, pool->ebo);
+        PGL_CHECK(glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_capacity * sizeof(GLuint),
+                               NULL, GL_STATIC_DRAW));
     }
+
+    return pool;
 }
 
-void pgl_reset_projection(pgl_ctx_t* ctx)
+void pgl_destroy_pool(pgl_pool_t* pool)
 {
-    PGL_ASSERT(ctx);
+    PGL_ASSERT(pool);
 
-    pgl_state_t* state = pgl_get_active_state(ctx);
+    pgl_gl_delete_vertex_array(pool->vao);
+    pgl_gl_delete_buffer(pool->vbo);
 
-    const pgl_m4_t matrix =
-    {
-        1.0f, 0.0f, 0.0f, 0.0f,
-        0.0f, 1.0f, 0.0f, 0.0f,
-        0.0f, 0.0f, 1.0f, 0.0f,
-        0.0f, 0.0f, 0.0f, 1.0f
-    };
+    if (pool->ebo)
+        pgl_gl_delete_buffer(pool->ebo);
 
-    memcpy(state->projection, matrix, sizeof(pgl_m4_t));
+    PGL_FREE(pool, pool->ctx->mem_ctx);
 }
 
-void pgl_set_viewport(pgl_ctx_t* ctx, int32_t x, int32_t y,
-                                      int32_t w, int32_t h)
+int32_t pgl_alloc_pool_range(pgl_pool_t* pool,
+                             const void* vertices, pgl_size_t vertex_count,
+                             const uint32_t* indices, pgl_size_t index_count)
 {
-    PGL_ASSERT(ctx);
+    PGL_ASSERT(pool);
+    PGL_ASSERT(vertices);
+    PGL_ASSERT(vertex_count > 0);
+    PGL_ASSERT((0 != pool->ebo) == (NULL != indices));
+    PGL_ASSERT(!indices || index_count > 0);
+
+    // Find an unused range
+    int32_t handle = -1;
+
+    for (pgl_size_t i = 0; i < pool->max_ranges; i++)
+    {
+        if (!pool->ranges[i].used)
+        {
+            handle = (int32_t)i;
+            break;
+        }
+    }
+
+    if (handle < 0)
+        return -1;
+
+    pgl_pool_range_t* range = &pool->ranges[handle];
+
+    range->vertices.count = vertex_count;
+    range->indices.count = indices ? index_count : 0;
+
+    if (!pgl_alloc_span(&pool->free_vertices, vertex_count, &range->vertices.start))
+        return -1;
+
+    if (indices && !pgl_alloc_span(&pool->free_indices, index_count, &range->indices.start))
+    {
+        pgl_free_span(&pool->free_vertices, range->vertices);
+        return -1;
+    }
+
+    range->used = true;
+
+    pgl_gl_bind_buffer(GL_ARRAY_BUFFER, pool->vbo);
+    PGL_CHECK(glBufferSubData(GL_ARRAY_BUFFER,
+                              (GLintptr)range->vertices.start * pool->stride,
+                              (GLsizeiptr)vertex_count * pool->stride,
+                              vertices));
+
+    if (indices)
+    {
+        // Indices are stored relative to the start of the pool, so that
+        // ranges can be drawn without a base vertex
+        pgl_gl_bind_vertex_array(pool->vao);
+
+        GLuint* dst;
+
+        PGL_CHECK(dst = glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER,
+                                         range->indices.start * sizeof(GLuint),
+                                         index_count * sizeof(GLuint),
+                                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT));
+
+        if (!dst)
+        {
+            pgl_free_pool_range(pool, handle);
+            pgl_set_error(pool->ctx, PGL_OUT_OF_MEMORY);
+            return -1;
+        }
+
+        for (pgl_size_t i = 0; i < index_count; i++)
+        {
+            dst[i] = indices[i] + range->vertices.start;
+        }
+
+        PGL_CHECK(glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER));
+    }
+
+    return handle;
+}
+
+void pgl_free_pool_range(pgl_pool_t* pool, int32_t range)
+{
+    PGL_ASSERT(pool);
+    PGL_ASSERT(range >= 0 && (pgl_size_t)range < pool->max_ranges);
+    PGL_ASSERT(pool->ranges[range].used);
+
+    pgl_pool_range_t* entry = &pool->ranges[range];
+
+    pgl_free_span(&pool->free_vertices, entry->vertices);
+
+    if (entry->indices.count > 0)
+        pgl_free_span(&pool->free_indices, entry->indices);
+
+    entry->used = false;
+}
+
+void pgl_sub_pool_range_data(pgl_pool_t* pool,
+                             int32_t range,
+                             const void* vertices,
+                             pgl_size_t count,
+                             pgl_size_t offset)
+{
+    PGL_ASSERT(pool);
+    PGL_ASSERT(vertices);
+    PGL_ASSERT(range >= 0 && (pgl_size_t)range < pool->max_ranges);
+    PGL_ASSERT(pool->ranges[range].used);
+
+    const pgl_span_t* span = &pool->ranges[range].vertices;
+
+    PGL_ASSERT(count + offset <= span->count);
+
+    pgl_gl_bind_buffer(GL_ARRAY_BUFFER, pool->vbo);
+    PGL_CHECK(glBufferSubData(GL_ARRAY_BUFFER,
+                              (GLintptr)(span->start + offset) * pool->stride,
+                              (GLsizeiptr)count * pool->stride,
+                              vertices));
+}
+
+void pgl_draw_pool(pgl_ctx_t* ctx,
+                   pgl_pool_t* pool,
+                   const int32_t* ranges,
+                   pgl_size_t count,
+                   pgl_texture_t* texture,
+                   pgl_shader_t* shader)
+{
+    PGL_ASSERT(ctx);
+    PGL_ASSERT(pool);
+    PGL_ASSERT(shader);
+
+    // Gather the ranges to draw
+    GLsizei draw_count = 0;
+
+    if (!ranges)
+        count = pool->max_ranges;
+
+    for (pgl_size_t i = 0; i < count; i++)
+    {
+        int32_t handle = ranges ? ranges[i] : (int32_t)i;
+
+        PGL_ASSERT(handle >= 0 && (pgl_size_t)handle < pool->max_ranges);
+        PGL_ASSERT(!ranges || pool->ranges[handle].used);
+
+        const pgl_pool_range_t* range = &pool->ranges[handle];
+
+        if (!range->used)
+            continue;
+
+        if (pool->ebo)
+        {
+            pool->counts[draw_count]  = range->indices.count;
+            pool->offsets[draw_count] = (const GLvoid*)(range->indices.start * sizeof(GLuint));
+        }
+        else
+        {
+            pool->counts[draw_count] = range->vertices.count;
+            pool->firsts[draw_count] = range->vertices.start;
+        }
+
+        draw_count++;
+    }
+
+    if (0 == draw_count)
+        return;
+
+    pgl_flush_pending();
+
+    pgl_state_t* state = pgl_get_active_state(ctx);
+
+    pgl_before_draw(ctx, texture, shader, state);
+
+    pgl_gl_bind_vertex_array(pool->vao);
+
+    // The multi-draw functions are not part of GLES, where the ranges are
+    // drawn one at a time
+    if (pool->ebo)
+    {
+        if (glad_glMultiDrawElements)
+        {
+            PGL_CHECK(glMultiDrawElements(pool->primitive, pool->counts, GL_UNSIGNED_INT,
+                                          pool->offsets, draw_count));
+            return;
+        }
+
+        for (GLsizei i = 0; i < draw_count; i++)
+        {
+            PGL_CHECK(glDrawElements(pool->primitive, pool->counts[i], GL_UNSIGNED_INT,
+                                     pool->offsets[i]));
+        }
+    }
+    else
+    {
+        if (glad_glMultiDrawArrays)
+        {
+            PGL_CHECK(glMultiDrawArrays(pool->primitive, pool->firsts, pool->counts,
+                                        draw_count));
+            return;
+        }
+
+        for (GLsizei i = 0; i < draw_count; i++)
+        {
+            PGL_CHECK(glDrawArrays(pool->primitive, pool->firsts[i], pool->counts[i]));
+        }
+    }
+}
+
+void pgl_set_transpose(pgl_ctx_t* ctx, bool enabled)
+{
+    PGL_ASSERT(ctx);
+
+    // Applies to the matrices of batched vertices when they are drawn
+    pgl_flush_pending();
+    ctx->transpose = enabled;
+}
+
+void pgl_set_blend_mode(pgl_ctx_t* ctx, pgl_blend_mode_t mode)
+{
+    PGL_ASSERT(ctx);
+
+    pgl_state_t* state = pgl_get_active_state(ctx);
+    state->blend_mode = mode;
+}
+
+void pgl_reset_blend_mode(pgl_ctx_t* ctx)
+{
+    PGL_ASSERT(ctx);
+
+    pgl_state_t* state = pgl_get_active_state(ctx);
+
+    pgl_blend_mode_t mode = {
+        PGL_SRC_ALPHA,
+        PGL_ONE_MINUS_SRC_ALPHA,
+        PGL_FUNC_ADD,
+        PGL_ONE,
+        PGL_ONE_MINUS_SRC_ALPHA,
+        PGL_FUNC_ADD
+    };
+
+    state->blend_mode = mode;
+}
+
+void pgl_set_transform(pgl_ctx_t* ctx, const pgl_m4_t matrix)
+{
+    PGL_ASSERT(ctx);
+    PGL_ASSERT(matrix);
+
+    pgl_state_t* state = pgl_get_active_state(ctx);
+    memcpy(state->transform, matrix, sizeof(pgl_m4_t));
+}
+
+void pgl_set_transform_3d(pgl_ctx_t* ctx, const pgl_m3_t matrix)
+{
+    PGL_ASSERT(ctx);
+    PGL_ASSERT(matrix);
+
+    if (ctx->transpose)
+    {
+        const pgl_m4_t matrix4 =
+        {
+            matrix[0], matrix[1], 0.0f, matrix[2],
+            matrix[3], matrix[4], 0.0f, matrix[5],
+            0.0f,      0.0f,      1.0f, 0.0f,
+            matrix[6], matrix[7], 0.0f, matrix[8]
+        };
+
+        pgl_set_transform(ctx, matrix4);
+    }
+    else
+    {
+        const pgl_m4_t matrix4 =
+        {
+            matrix[0], matrix[3], 0.0f, matrix[6],
+            matrix[1], matrix[4], 0.0f, matrix[7],
+            0.0f,      0.0f,      1.0f, 0.0f,
+            matrix[2], matrix[5], 0.0f, matrix[8]
+        };
+
+        pgl_set_transform(ctx, matrix4);
+    }
+}
+
+void pgl_reset_transform(pgl_ctx_t* ctx)
+{
+    PGL_ASSERT(ctx);
+
+    pgl_state_t* state = pgl_get_active_state(ctx);
+
+    const pgl_m4_t matrix =
+    {
+        1.0f, 0.0f, 0.0f, 0.0f,
+        0.0f, 1.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, 1.0f, 0.0f,
+        0.0f, 0.0f, 0.0f, 1.0f
+    };
+
+    memcpy(state->transform, matrix, sizeof(pgl_m4_t));
+}
+
+void pgl_set_projection(pgl_ctx_t* ctx, const pgl_m4_t matrix)
+{
+    PGL_ASSERT(ctx);
+    PGL_ASSERT(matrix);
+
+    pgl_state_t* state = pgl_get_active_state(ctx);
+    memcpy(state->projection, matrix, sizeof(pgl_m4_t));
+}
+
+void pgl_set_projection_3d(pgl_ctx_t* ctx, const pgl_m3_t matrix)
+{
+    PGL_ASSERT(ctx);
+    PGL_ASSERT(matrix);
+
+    if (ctx->transpose)
+    {
+        const pgl_m4_t matrix4 =
+        {
+            matrix[0], matrix[1], 0.0f, matrix[2],
+            matrix[3], matrix[4], 0.0f, matrix[5],
+            0.0f,      0.0f,      1.0f, 0.0f,
+            matrix[6], matrix[7], 0.0f, matrix[8]
+        };
+
+        pgl_set_projection(ctx, matrix4);
+    }
+    else
+    {
+        const pgl_m4_t matrix4 =
+        {
+            matrix[0], matrix[3], 0.0f, matrix[6],
+            matrix[1], matrix[4], 0.0f, matrix[7],
+            0.0f,      0.0f,      1.0f, 0.0f,
+            matrix[2], matrix[5], 0.0f, matrix[8]
+        };
+
+        pgl_set_projection(ctx, matrix4);
+    }
+}
+
+void pgl_reset_projection(pgl_ctx_t* ctx)
+{
+    PGL_ASSERT(ctx);
+
+    pgl_state_t* state = pgl_get_active_state(ctx);
+
+    const pgl_m4_t matrix =
+    {
+        1.0f, 0.0f, 0.0f, 0.0f,
+        0.0f, 1.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, 1.0f, 0.0f,
+        0.0f, 0.0f, 0.0f, 1.0f
+    };
+
+    memcpy(state->projection, matrix, sizeof(pgl_m4_t));
+}
+
+void pgl_set_viewport(pgl_ctx_t* ctx, int32_t x, int32_t y,
+                                      int32_t w, int32_t h)
+{
+    PGL_ASSERT(ctx);
 
     pgl_state_t* state = pgl_get_active_state(ctx);
     state->viewport = (pgl_viewport_t){ x, y, w, h };
@@ -2422,13 +4125,9 @@ void pgl_set_bool(pgl_shader_t* shader, const char* name, bool value)
     PGL_ASSERT(shader);
     PGL_ASSERT(name);
 
-    pgl_bind_shader(shader->ctx, shader);
-    const pgl_uniform_t* uniform = pgl_find_uniform(shader, name);
-
-    if (!uniform)
-        return;
+    int32_t values[] = { value };
 
-    PGL_CHECK(glUniform1i(uniform->location, value));
+    pgl_send_uniform(shader, pgl_find_uniform(shader, name), GL_BOOL, values, 1);
 }
 
 void pgl_set_1i(pgl_shader_t* shader, const char* name, int32_t a)
@@ -2436,13 +4135,7 @@ void pgl_set_1i(pgl_shader_t* shader, const char* name, int32_t a)
     PGL_ASSERT(shader);
     PGL_ASSERT(name);
 
-    pgl_bind_shader(shader->ctx, shader);
-    const pgl_uniform_t* uniform = pgl_find_uniform(shader, name);
-
-    if (!uniform)
-        return;
-
-    PGL_CHECK(glUniform1i(uniform->location, a));
+    pgl_send_uniform(shader, pgl_find_uniform(shader, name), GL_INT, &a, 1);
 }
 
 void pgl_set_2i(pgl_shader_t* shader, const char* name, int32_t a, int32_t b)
@@ -2450,13 +4143,9 @@ void pgl_set_2i(pgl_shader_t* shader, const char* name, int32_t a, int32_t b)
     PGL_ASSERT(shader);
     PGL_ASSERT(name);
 
-    pgl_bind_shader(shader->ctx, shader);
-    const pgl_uniform_t* uniform = pgl_find_uniform(shader, name);
-
-    if (!uniform)
-        return;
+    int32_t values[] = { a, b };
 
-    PGL_CHECK(glUniform2i(uniform->location, a, b));
+    pgl_send_uniform(shader, pgl_find_uniform(shader, name), GL_INT_VEC2, values, 1);
 }
 
 void pgl_set_3i(pgl_shader_t* shader, const char* name, int32_t a, int32_t b,
@@ -2465,13 +4154,9 @@ void pgl_set_3i(pgl_shader_t* shader, const char* name, int32_t a, int32_t b,
     PGL_ASSERT(shader);
     PGL_ASSERT(name);
 
-    pgl_bind_shader(shader->ctx, shader);
-    const pgl_uniform_t* uniform = pgl_find_uniform(shader, name);
+    int32_t values[] = { a, b, c };
 
-    if (!uniform)
-        return;
-
-    PGL_CHECK(glUniform3i(uniform->location, a, b, c));
+    pgl_send_uniform(shader, pgl_find_uniform(shader, name), GL_INT_VEC3, values, 1);
 }
 
 void pgl_set_4i(pgl_shader_t* shader, const char* name, int32_t a, int32_t b,
@@ -2480,13 +4165,9 @@ void pgl_set_4i(pgl_shader_t* shader, const char* name, int32_t a, int32_t b,
     PGL_ASSERT(shader);
     PGL_ASSERT(name);
 
-    pgl_bind_shader(shader->ctx, shader);
-    const pgl_uniform_t* uniform = pgl_find_uniform(shader, name);
-
-    if (!uniform)
-        return;
+    int32_t values[] = { a, b, c, d };
 
-    PGL_CHECK(glUniform4i(uniform->location, a, b, c, d));
+    pgl_send_uniform(shader, pgl_find_uniform(shader, name), GL_INT_VEC4, values, 1);
 }
 
 void pgl_set_v2i(pgl_shader_t* shader, const char* name, const pgl_v2i_t vec)
@@ -2494,7 +4175,7 @@ void pgl_set_v2i(pgl_shader_t* shader, const char* name, const pgl_v2i_t vec)
     PGL_ASSERT(shader);
     PGL_ASSERT(name);
 
-    pgl_set_2i(shader, name, vec[0], vec[1]);
+    pgl_send_uniform(shader, pgl_find_uniform(shader, name), GL_INT_VEC2, vec, 1);
 }
 
 void pgl_set_v3i(pgl_shader_t* shader, const char* name, const pgl_v3i_t vec)
@@ -2502,7 +4183,7 @@ void pgl_set_v3i(pgl_shader_t* shader, const char* name, const pgl_v3i_t vec)
     PGL_ASSERT(shader);
     PGL_ASSERT(name);
 
-    pgl_set_3i(shader, name, vec[0], vec[1], vec[2]);
+    pgl_send_uniform(shader, pgl_find_uniform(shader, name), GL_INT_VEC3, vec, 1);
 }
 
 
@@ -2511,7 +4192,7 @@ void pgl_set_v4i(pgl_shader_t* shader, const char* name, const pgl_v4i_t vec)
     PGL_ASSERT(shader);
     PGL_ASSERT(name);
 
-    pgl_set_4i(shader, name, vec[0], vec[1], vec[2], vec[3]);
+    pgl_send_uniform(shader, pgl_find_uniform(shader, name), GL_INT_VEC4, vec, 1);
 }
 
 void pgl_set_1f(pgl_shader_t* shader, const char* name, float x)
@@ -2519,13 +4200,7 @@ void pgl_set_1f(pgl_shader_t* shader, const char* name, float x)
     PGL_ASSERT(shader);
     PGL_ASSERT(name);
 
-    pgl_bind_shader(shader->ctx, shader);
-    const pgl_uniform_t* uniform = pgl_find_uniform(shader, name);
-
-    if (!uniform)
-        return;
-
-    PGL_CHECK(glUniform1f(uniform->location, x));
+    pgl_send_uniform(shader, pgl_find_uniform(shader, name), GL_FLOAT, &x, 1);
 }
 
 void pgl_set_2f(pgl_shader_t* shader, const char* name, float x, float y)
@@ -2533,13 +4208,9 @@ void pgl_set_2f(pgl_shader_t* shader, const char* name, float x, float y)
     PGL_ASSERT(shader);
     PGL_ASSERT(name);
 
-    pgl_bind_shader(shader->ctx, shader);
-    const pgl_uniform_t* uniform = pgl_find_uniform(shader, name);
-
-    if (!uniform)
-        return;
+    float values[] = { x, y };
 
-    PGL_CHECK(glUniform2f(uniform->location, x, y));
+    pgl_send_uniform(shader, pgl_find_uniform(shader, name), GL_FLOAT_VEC2, values, 1);
 }
 
 void pgl_set_3f(pgl_shader_t* shader, const char* name, float x, float y, float z)
@@ -2547,13 +4218,9 @@ void pgl_set_3f(pgl_shader_t* shader, const char* name, float x, float y, float
     PGL_ASSERT(shader);
     PGL_ASSERT(name);
 
-    pgl_bind_shader(shader->ctx, shader);
-    const pgl_uniform_t* uniform = pgl_find_uniform(shader, name);
-
-    if (!uniform)
-        return;
+    float values[] = { x, y, z };
 
-    PGL_CHECK(glUniform3f(uniform->location, x, y, z));
+    pgl_send_uniform(shader, pgl_find_uniform(shader, name), GL_FLOAT_VEC3, values, 1);
 }
 
 void pgl_set_4f(pgl_shader_t* shader, const char* name, float x, float y,
@@ -2562,13 +4229,9 @@ void pgl_set_4f(pgl_shader_t* shader, const char* name, float x, float y,
     PGL_ASSERT(shader);
     PGL_ASSERT(name);
 
-    pgl_bind_shader(shader->ctx, shader);
-    const pgl_uniform_t* uniform = pgl_find_uniform(shader, name);
-
-    if (!uniform)
-        return;
+    float values[] = { x, y, z, w };
 
-    PGL_CHECK(glUniform4f(uniform->location, x, y, z, w));
+    pgl_send_uniform(shader, pgl_find_uniform(shader, name), GL_FLOAT_VEC4, values, 1);
 }
 
 void pgl_set_v2f(pgl_shader_t* shader, const char* name, const pgl_v2f_t vec)
@@ -2577,7 +4240,7 @@ void pgl_set_v2f(pgl_shader_t* shader, const char* name, const pgl_v2f_t vec)
     PGL_ASSERT(name);
     PGL_ASSERT(vec);
 
-    pgl_set_2f(shader, name, vec[0], vec[1]);
+    pgl_send_uniform(shader, pgl_find_uniform(shader, name), GL_FLOAT_VEC2, vec, 1);
 }
 
 void pgl_set_v3f(pgl_shader_t* shader, const char* name, const pgl_v3f_t vec)
@@ -2586,7 +4249,7 @@ void pgl_set_v3f(pgl_shader_t* shader, const char* name, const pgl_v3f_t vec)
     PGL_ASSERT(name);
     PGL_ASSERT(vec);
 
-    pgl_set_3f(shader, name, vec[0], vec[1], vec[2]);
+    pgl_send_uniform(shader, pgl_find_uniform(shader, name), GL_FLOAT_VEC3, vec, 1);
 }
 
 void pgl_set_v4f(pgl_shader_t* shader, const char* name, const pgl_v4f_t vec)
@@ -2595,7 +4258,7 @@ void pgl_set_v4f(pgl_shader_t* shader, const char* name, const pgl_v4f_t vec)
     PGL_ASSERT(name);
     PGL_ASSERT(vec);
 
-    pgl_set_4f(shader, name, vec[0], vec[1], vec[2], vec[3]);
+    pgl_send_uniform(shader, pgl_find_uniform(shader, name), GL_FLOAT_VEC4, vec, 1);
 }
 
 void pgl_set_a1f(pgl_shader_t* shader,
@@ -2607,13 +4270,7 @@ void pgl_set_a1f(pgl_shader_t* shader,
     PGL_ASSERT(name);
     PGL_ASSERT(values);
 
-    pgl_bind_shader(shader->ctx, shader);
-    const pgl_uniform_t* uniform = pgl_find_uniform(shader, name);
-
-    if (!uniform)
-        return;
-
-    PGL_CHECK(glUniform1fv(uniform->location, count, values));
+    pgl_send_uniform(shader, pgl_find_uniform(shader, name), GL_FLOAT, values, count);
 }
 
 void pgl_set_a2f(pgl_shader_t* shader,
@@ -2625,423 +4282,1237 @@ void pgl_set_a2f(pgl_shader_t* shader,
     PGL_ASSERT(name);
     PGL_ASSERT(vec);
 
-    pgl_bind_shader(shader->ctx, shader);
-    const pgl_uniform_t* uniform = pgl_find_uniform(shader, name);
+    // The vectors are contiguous, so they can be sent as they are
+    pgl_send_uniform(shader, pgl_find_uniform(shader, name), GL_FLOAT_VEC2, vec, count);
+}
+
+void pgl_set_a3f(pgl_shader_t* shader,
+                const char* name,
+                const pgl_v3f_t* vec,
+                pgl_size_t count)
+{
+    PGL_ASSERT(shader);
+    PGL_ASSERT(name);
+    PGL_ASSERT(vec);
+
+    // The vectors are contiguous, so they can be sent as they are
+    pgl_send_uniform(shader, pgl_find_uniform(shader, name), GL_FLOAT_VEC3, vec, count);
+}
+
+void pgl_set_a4f(pgl_shader_t* shader,
+                const char* name,
+                const pgl_v4f_t* vec,
+                pgl_size_t count)
+{
+    PGL_ASSERT(shader);
+    PGL_ASSERT(name);
+    PGL_ASSERT(vec);
+
+    // The vectors are contiguous, so they can be sent as they are
+    pgl_send_uniform(shader, pgl_find_uniform(shader, name), GL_FLOAT_VEC4, vec, count);
+}
+
+void pgl_set_m2(pgl_shader_t* shader, const char* name, const pgl_m2_t matrix)
+{
+    PGL_ASSERT(shader);
+    PGL_ASSERT(name);
+    PGL_ASSERT(matrix);
+
+    pgl_send_uniform(shader, pgl_find_uniform(shader, name), GL_FLOAT_MAT2, matrix, 1);
+}
+
+void pgl_set_m3(pgl_shader_t* shader, const char* name, const pgl_m3_t matrix)
+{
+    PGL_ASSERT(shader);
+    PGL_ASSERT(name);
+    PGL_ASSERT(matrix);
+
+    pgl_send_uniform(shader, pgl_find_uniform(shader, name), GL_FLOAT_MAT3, matrix, 1);
+}
+
+void pgl_set_m4(pgl_shader_t* shader, const char* name, const pgl_m4_t matrix)
+{
+    PGL_ASSERT(shader);
+    PGL_ASSERT(name);
+    PGL_ASSERT(matrix);
+
+    pgl_send_uniform(shader, pgl_find_uniform(shader, name), GL_FLOAT_MAT4, matrix, 1);
+}
+
+void pgl_set_s2d(pgl_shader_t* shader, const char* name, int32_t value)
+{
+    PGL_ASSERT(shader);
+    PGL_ASSERT(name);
+
+    pgl_send_uniform(shader, pgl_find_uniform(shader, name), GL_SAMPLER_2D, &value, 1);
+}
+
+int32_t pgl_get_uniform_handle(const pgl_shader_t* shader, const char* name)
+{
+    PGL_ASSERT(shader);
+    PGL_ASSERT(name);
+
+    return pgl_find_uniform(shader, name);
+}
+
+void pgl_set_uniform(pgl_shader_t* shader, int32_t handle,
+                     const void* value, pgl_size_t count)
+{
+    PGL_ASSERT(shader);
+    PGL_ASSERT(handle < (int32_t)shader->uniform_count);
+    PGL_ASSERT(value);
+
+    if (handle < 0)
+        return;
+
+    pgl_send_uniform(shader, handle, shader->uniforms[handle].type, value, count);
+}
+
+/*=============================================================================
+ * Internal API implementation
+ *============================================================================*/
+
+static void pgl_set_error(pgl_ctx_t* ctx, pgl_error_t code)
+{
+    PGL_ASSERT(ctx);
+    ctx->error_code = code;
+}
+
+static const char* pgl_get_default_vert_shader()
+{
+    pgl_version_t ver = pgl_get_version();
+
+    switch (ver)
+    {
+        case PGL_GL3:
+            return PGL_GL_VERT_SRC;
+
+        case PGL_GLES3:
+            return PGL_GLES_VERT_SRC;
+
+        default:
+            return NULL;
+    }
+}
+
+static const char* pgl_get_instanced_vert_shader()
+{
+    pgl_version_t ver = pgl_get_version();
+
+    switch (ver)
+    {
+        case PGL_GL3:
+            return PGL_GL_INST_VERT_SRC;
+
+        case PGL_GLES3:
+            return PGL_GLES_INST_VERT_SRC;
 
-    if (!uniform)
+        default:
+            return NULL;
+    }
+}
+
+static const char* pgl_get_default_frag_shader()
+{
+    pgl_version_t ver = pgl_get_version();
+
+    switch (ver)
+    {
+        case PGL_GL3:
+            return PGL_GL_FRAG_SRC;
+
+        case PGL_GLES3:
+            return PGL_GLES_FRAG_SRC;
+
+        default:
+            return NULL;
+    }
+}
+
+static pgl_state_stack_t* pgl_get_active_stack(pgl_ctx_t* ctx)
+{
+    PGL_ASSERT(ctx);
+
+    pgl_state_stack_t* stack = &ctx->stack;
+
+    if (ctx->target)
+        stack = &ctx->target_stack;
+
+    return stack;
+}
+
+static pgl_state_t* pgl_get_active_state(pgl_ctx_t* ctx)
+{
+    PGL_ASSERT(ctx);
+
+    return &pgl_get_active_stack(ctx)->state;
+}
+
+static void pgl_apply_blend(const pgl_blend_mode_t* mode)
+{
+    PGL_ASSERT(mode);
+
+    if (pgl_mem_equal(mode, &pgl_gl_state.blend_mode, sizeof(pgl_blend_mode_t)))
+    {
+        pgl_gl_state.elided += 2;
         return;
+    }
+
+    PGL_CHECK(glBlendFuncSeparate(pgl_blend_factor_map[mode->color_src],
+                                  pgl_blend_factor_map[mode->color_dst],
+                                  pgl_blend_factor_map[mode->alpha_src],
+                                  pgl_blend_factor_map[mode->alpha_dst]));
+
+    PGL_CHECK(glBlendEquationSeparate(pgl_blend_eq_map[mode->color_eq],
+                                      pgl_blend_eq_map[mode->alpha_eq]));
+
+    pgl_gl_state.blend_mode = *mode;
+}
+
+// The matrices are compared against the values last sent to the bound shader,
+// since each program has its own uniforms
+static void pgl_apply_transform(pgl_ctx_t* ctx, const pgl_m4_t matrix)
+{
+    PGL_ASSERT(ctx);
+    PGL_ASSERT(matrix);
+
+    pgl_send_uniform(ctx->shader, ctx->shader->transform,
+                     GL_FLOAT_MAT4, matrix, 1);
+}
 
-    float values[2 * count];
+static void pgl_apply_projection(pgl_ctx_t* ctx, const pgl_m4_t matrix)
+{
+    PGL_ASSERT(ctx);
+    PGL_ASSERT(matrix);
+
+    pgl_send_uniform(ctx->shader, ctx->shader->projection,
+                     GL_FLOAT_MAT4, matrix, 1);
+}
+
+static void pgl_apply_viewport(const pgl_viewport_t* viewport)
+{
+    PGL_ASSERT(viewport);
+
+    if (viewport->w <= 0 && viewport->h <= 0)
+        return;
+
+    if (pgl_mem_equal(viewport, &pgl_gl_state.viewport, sizeof(pgl_viewport_t)))
+    {
+        pgl_gl_state.elided++;
+        return;
+    }
+
+    PGL_CHECK(glViewport(viewport->x, viewport->y, viewport->w, viewport->h));
+
+    pgl_gl_state.viewport = *viewport;
+}
+
+static void pgl_apply_line_width(float line_width)
+{
+    if (line_width == pgl_gl_state.line_width)
+    {
+        pgl_gl_state.elided++;
+        return;
+    }
+
+    PGL_CHECK(glLineWidth(line_width));
+
+    pgl_gl_state.line_width = line_width;
+}
+
+static void pgl_before_draw(pgl_ctx_t* ctx, pgl_texture_t* texture,
+                            pgl_shader_t* shader, const pgl_state_t* state)
+{
+    PGL_ASSERT(ctx);
+    PGL_ASSERT(shader);
+    PGL_ASSERT(state);
+
+    pgl_bind_texture(ctx, texture);
+    pgl_bind_shader(ctx, shader);
+
+    pgl_apply_viewport(&state->viewport);
+    pgl_apply_blend(&state->blend_mode);
+    pgl_apply_transform(ctx, state->transform);
+    pgl_apply_projection(ctx, state->projection);
+    pgl_apply_line_width(state->line_width);
+
+    pgl_gl_set_cap(PGL_CAP_BLEND, true);
+    pgl_gl_set_cap(PGL_CAP_DEPTH_TEST, ctx->depth);
+    pgl_gl_set_cap(PGL_CAP_FRAMEBUFFER_SRGB, ctx->srgb);
+}
+
+static void pgl_gl_use_program(GLuint program)
+{
+    if (pgl_gl_state.program == program)
+    {
+        pgl_gl_state.elided++;
+        return;
+    }
+
+    PGL_CHECK(glUseProgram(program));
+    pgl_gl_state.program = program;
+}
+
+static void pgl_gl_bind_texture(GLuint texture)
+{
+    if (pgl_gl_state.texture == texture)
+    {
+        pgl_gl_state.elided++;
+        return;
+    }
+
+    PGL_CHECK(glBindTexture(GL_TEXTURE_2D, texture));
+    pgl_gl_state.texture = texture;
+}
+
+static void pgl_gl_bind_vertex_array(GLuint vao)
+{
+    if (pgl_gl_state.vao == vao)
+    {
+        pgl_gl_state.elided++;
+        return;
+    }
+
+    PGL_CHECK(glBindVertexArray(vao));
+    pgl_gl_state.vao = vao;
+}
+
+// Only GL_ARRAY_BUFFER is cached, the element array binding belongs to the
+// bound vertex array
+static void pgl_gl_bind_buffer(GLenum target, GLuint buffer)
+{
+    if (GL_ARRAY_BUFFER != target)
+    {
+        PGL_CHECK(glBindBuffer(target, buffer));
+        return;
+    }
+
+    if (pgl_gl_state.array_buffer == buffer)
+    {
+        pgl_gl_state.elided++;
+        return;
+    }
+
+    PGL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, buffer));
+    pgl_gl_state.array_buffer = buffer;
+}
+
+static void pgl_gl_set_cap(pgl_cap_t cap, bool enabled)
+{
+    PGL_ASSERT(cap < PGL_CAP_COUNT);
+
+    if (pgl_gl_state.caps[cap] == (int8_t)enabled)
+    {
+        pgl_gl_state.elided++;
+        return;
+    }
+
+    if (enabled)
+        PGL_CHECK(glEnable(pgl_cap_map[cap]));
+    else
+        PGL_CHECK(glDisable(pgl_cap_map[cap]));
+
+    pgl_gl_state.caps[cap] = (int8_t)enabled;
+}
+
+// Deleting a bound object reverts the binding to zero. The name may be reused
+// by the next object, so the cache has to be updated too.
+static void pgl_gl_delete_texture(GLuint texture)
+{
+    PGL_CHECK(glDeleteTextures(1, &texture));
+
+    if (pgl_gl_state.texture == texture)
+        pgl_gl_state.texture = 0;
+}
+
+static void pgl_gl_delete_vertex_array(GLuint vao)
+{
+    PGL_CHECK(glDeleteVertexArrays(1, &vao));
+
+    if (pgl_gl_state.vao == vao)
+        pgl_gl_state.vao = 0;
+}
+
+static void pgl_gl_delete_buffer(GLuint buffer)
+{
+    PGL_CHECK(glDeleteBuffers(1, &buffer));
+
+    if (pgl_gl_state.array_buffer == buffer)
+        pgl_gl_state.array_buffer = 0;
+}
+
+
+static pgl_primitive_t pgl_list_primitive(pgl_primitive_t primitive)
+{
+    switch (primitive)
+    {
+        case PGL_LINE_STRIP:     return PGL_LINES;
+        case PGL_TRIANGLE_STRIP: return PGL_TRIANGLES;
+        default:                 return primitive;
+    }
+}
+
+// Returns the number of vertices drawn as a list (incomplete primitives are
+// dropped, as OpenGL would)
+static pgl_size_t pgl_list_vertex_count(pgl_primitive_t primitive, pgl_size_t count)
+{
+    switch (primitive)
+    {
+        case PGL_POINTS:         return count;
+        case PGL_LINES:          return count - count % 2;
+        case PGL_LINE_STRIP:     return (count >= 2) ? 2 * (count - 1) : 0;
+        case PGL_TRIANGLES:      return count - count % 3;
+        case PGL_TRIANGLE_STRIP: return (count >= 3) ? 3 * (count - 2) : 0;
+    }
+
+    return 0;
+}
+
+static void pgl_copy_as_list(uint8_t* dst,
+                             pgl_primitive_t primitive,
+                             const uint8_t* src,
+                             pgl_size_t count,
+                             size_t stride)
+{
+    switch (primitive)
+    {
+        case PGL_LINE_STRIP:
+            for (pgl_size_t i = 0; i + 1 < count; i++)
+            {
+                memcpy(dst, src + i * stride, 2 * stride);
+                dst += 2 * stride;
+            }
+            break;
+
+        case PGL_TRIANGLE_STRIP:
+            // Every other triangle is flipped to preserve the winding order
+            for (pgl_size_t i = 0; i + 2 < count; i++)
+            {
+                memcpy(dst, src + ((i % 2) ? i + 1 : i) * stride, stride);
+                dst += stride;
+
+                memcpy(dst, src + ((i % 2) ? i : i + 1) * stride, stride);
+                dst += stride;
+
+                memcpy(dst, src + (i + 2) * stride, stride);
+                dst += stride;
+            }
+            break;
+
+        default:
+            memcpy(dst, src, pgl_list_vertex_count(primitive, count) * stride);
+            break;
+    }
+}
+
+// Takes `size` elements from the first free span that is large enough
+static bool pgl_alloc_span(pgl_span_list_t* list, pgl_size_t size, pgl_size_t* start)
+{
+    for (pgl_size_t i = 0; i < list->count; i++)
+    {
+        pgl_span_t* span = &list->spans[i];
+
+        if (span->count < size)
+            continue;
+
+        *start = span->start;
+
+        span->start += size;
+        span->count -= size;
+
+        if (0 == span->count)
+        {
+            memmove(span, span + 1, (list->count - i - 1) * sizeof(pgl_span_t));
+            list->count--;
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+// Returns a span to the list, merging it with adjacent free spans
+static void pgl_free_span(pgl_span_list_t* list, pgl_span_t span)
+{
+    pgl_size_t i = 0;
+
+    while (i < list->count && list->spans[i].start < span.start)
+        i++;
+
+    pgl_span_t* spans = list->spans;
+
+    bool merge_prev = i > 0 && spans[i - 1].start + spans[i - 1].count == span.start;
+    bool merge_next = i < list->count && span.start + span.count == spans[i].start;
+
+    if (merge_prev && merge_next)
+    {
+        spans[i - 1].count += span.count + spans[i].count;
+        memmove(&spans[i], &spans[i + 1], (list->count - i - 1) * sizeof(pgl_span_t));
+        list->count--;
+    }
+    else if (merge_prev)
+    {
+        spans[i - 1].count += span.count;
+    }
+    else if (merge_next)
+    {
+        spans[i].start = span.start;
+        spans[i].count += span.count;
+    }
+    else
+    {
+        memmove(&spans[i + 1], &spans[i], (list->count - i) * sizeof(pgl_span_t));
+        spans[i] = span;
+        list->count++;
+    }
+}
+
+static int pgl_load_uniforms(pgl_shader_t* shader)
+{
+    PGL_ASSERT(shader);
+
+    // Get number of active uniforms
+    GLint uniform_count;
+    glGetProgramiv(shader->program, GL_ACTIVE_UNIFORMS, &uniform_count);
+    shader->uniform_count = uniform_count;
+
+    // Validate number of uniforms
+    PGL_ASSERT(uniform_count < PGL_MAX_UNIFORMS);
+
+    if (uniform_count >= PGL_MAX_UNIFORMS)
+    {
+        pgl_set_error(shader->ctx, PGL_INVALID_UNIFORM_COUNT);
+        return -1;
+    }
+
+    // Loop through active uniforms and add them to the uniform array
+    for (GLint i = 0; i < uniform_count; i++)
+    {
+        pgl_uniform_t uniform;
+        GLsizei name_length;
+
+        // Uniform index
+        GLint index = i;
+
+        // Get uniform information
+        PGL_CHECK(glGetActiveUniform(shader->program, index,
+                                     PGL_UNIFORM_NAME_LENGTH, // Max name length
+                                     &name_length, &uniform.size, &uniform.type,
+                                     uniform.name));
+
+        // Validate name length
+        PGL_ASSERT(name_length <= PGL_UNIFORM_NAME_LENGTH);
+
+        if (name_length > PGL_UNIFORM_NAME_LENGTH)
+        {
+            pgl_set_error(shader->ctx, PGL_INVALID_UNIFORM_NAME);
+            return -1;
+        }
+
+        // Get uniform location
+        uniform.location = glGetUniformLocation(shader->program, uniform.name);
+
+        // Store uniform in the array
+        shader->uniforms[i] = uniform;
+    }
+
+    return pgl_init_uniforms(shader);
+}
+
+// Prepares uniforms whose name, size, type, and location are known
+static int pgl_init_uniforms(pgl_shader_t* shader)
+{
+    PGL_ASSERT(shader);
+
+    pgl_size_t uniform_count = shader->uniform_count;
+
+    for (pgl_size_t i = 0; i < uniform_count; i++)
+    {
+        pgl_uniform_t* uniform = &shader->uniforms[i];
+
+        // Hash name for fast lookups
+        uniform->hash = pgl_hash_str(uniform->name);
+
+        // Reserve space for a copy of the value
+        uniform->value = NULL;
+        uniform->capacity = pgl_uniform_type_size(uniform->type) * (size_t)uniform->size;
+        uniform->cached = 0;
+        uniform->transpose = false;
+    }
+
+    // Allocate the copies of the uniform values in one block
+    size_t values_size = 0;
+
+    for (pgl_size_t i = 0; i < uniform_count; i++)
+    {
+        values_size += shader->uniforms[i].capacity;
+    }
+
+    if (values_size > 0)
+    {
+        shader->uniform_values = PGL_MALLOC(values_size, shader->ctx->mem_ctx);
+
+        if (!shader->uniform_values)
+        {
+            // Uniforms still work without the copies, they are just always sent
+            for (pgl_size_t i = 0; i < uniform_count; i++)
+            {
+                shader->uniforms[i].capacity = 0;
+            }
+
+            pgl_set_error(shader->ctx, PGL_OUT_OF_MEMORY);
+            return -1;
+        }
+
+        uint8_t* value = shader->uniform_values;
+
+        for (pgl_size_t i = 0; i < uniform_count; i++)
+        {
+            shader->uniforms[i].value = value;
+            value += shader->uniforms[i].capacity;
+        }
+    }
+
+	return 0;
+}
+
+static int32_t pgl_find_uniform(const pgl_shader_t* shader, const char* name)
+{
+    PGL_ASSERT(shader);
+    PGL_ASSERT(name && strlen(name) > 0);
+
+	pgl_size_t uniform_count = shader->uniform_count;
+	const pgl_uniform_t* uniforms = shader->uniforms;
+
+	uint64_t hash = pgl_hash_str(name);
+
+	for (pgl_size_t i = 0; i < uniform_count; i++)
+	{
+		const pgl_uniform_t* uniform = &uniforms[i];
+
+		if (uniform->hash == hash && pgl_str_equal(name, uniform->name))
+		{
+			return (int32_t)i;
+        }
+	}
+
+    return -1;
+}
+
+static bool pgl_program_cache_enabled(void)
+{
+    if ('\0' == pgl_program_cache_dir[0])
+        return false;
+
+    // Program binaries are core in GL 4.1 and GLES 3.0
+    if (!glad_glProgramBinary || !glad_glGetProgramBinary || !glad_glProgramParameteri)
+        return false;
+
+    GLint format_count = 0;
+    PGL_CHECK(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count));
+
+    return format_count > 0;
+}
+
+// Binaries are only valid for the driver that produced them, so the driver
+// strings are part of the key
+static uint64_t pgl_program_key(const char* vert_src, const char* frag_src)
+{
+    const char* strings[] =
+    {
+        vert_src,
+        frag_src,
+        (const char*)glGetString(GL_VENDOR),
+        (const char*)glGetString(GL_RENDERER),
+        (const char*)glGetString(GL_VERSION)
+    };
+
+    uint64_t hash = PGL_OFFSET_BASIS_64;
+
+    for (size_t i = 0; i < sizeof(strings) / sizeof(strings[0]); i++)
+    {
+        const char* str = strings[i] ? strings[i] : "";
+
+        // Include the terminator so that moving text between strings changes the key
+        hash = pgl_hash_bytes64(hash, str, strlen(str) + 1);
+    }
+
+    const uint32_t layout[] = { PGL_PROGRAM_CACHE_VERSION, PGL_UNIFORM_NAME_LENGTH };
+
+    return pgl_hash_bytes64(hash, layout, sizeof(layout));
+}
+
+static void pgl_program_path(char* path, size_t size, uint64_t key)
+{
+    snprintf(path, size, "%s/%08lx%08lx.pglb",
+             pgl_program_cache_dir,
+             (unsigned long)(key >> 32),
+             (unsigned long)(key & 0xFFFFFFFF));
+}
+
+// Loads the program and the uniform table, or returns 0 on a cache miss
+static GLuint pgl_load_program(pgl_shader_t* shader, uint64_t key)
+{
+    PGL_ASSERT(shader);
+
+    char path[PGL_PROGRAM_PATH_LENGTH];
+    pgl_program_path(path, sizeof(path), key);
+
+    FILE* file = fopen(path, "rb");
+
+    if (!file)
+        return 0;
+
+    pgl_program_header_t header;
+
+    if (1 != fread(&header, sizeof(header), 1, file) ||
+        PGL_PROGRAM_CACHE_MAGIC != header.magic     ||
+        key != header.key                           ||
+        0 == header.length                          ||
+        header.uniform_count >= PGL_MAX_UNIFORMS)
+    {
+        fclose(file);
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < header.uniform_count; i++)
+    {
+        pgl_cached_uniform_t cached;
+
+        if (1 != fread(&cached, sizeof(cached), 1, file))
+        {
+            fclose(file);
+            return 0;
+        }
+
+        pgl_uniform_t* uniform = &shader->uniforms[i];
+
+        memcpy(uniform->name, cached.name, PGL_UNIFORM_NAME_LENGTH);
+        uniform->name[PGL_UNIFORM_NAME_LENGTH - 1] = '\0';
+
+        uniform->size     = cached.size;
+        uniform->type     = cached.type;
+        uniform->location = cached.location;
+    }
+
+    void* binary = PGL_MALLOC(header.length, shader->ctx->mem_ctx);
+
+    if (!binary)
+    {
+        fclose(file);
+        return 0;
+    }
+
+    size_t read = fread(binary, 1, header.length, file);
+
+    fclose(file);
+
+    if (read != header.length)
+    {
+        PGL_FREE(binary, shader->ctx->mem_ctx);
+        return 0;
+    }
+
+    // The driver rejects binaries it cannot use (e.g. after an update)
+    GLuint program;
+    GLint is_linked = GL_FALSE;
+
+    PGL_CHECK(program = glCreateProgram());
+    PGL_CHECK(glProgramBinary(program, header.format, binary, (GLsizei)header.length));
+    PGL_CHECK(glGetProgramiv(program, GL_LINK_STATUS, &is_linked));
 
-    pgl_size_t i, j;
+    PGL_FREE(binary, shader->ctx->mem_ctx);
 
-    for (i = 0, j = 0; j < count; i += 2, j++)
+    if (GL_FALSE == is_linked)
     {
-        values[i]     = vec[j][0];
-        values[i + 1] = vec[j][1];
+        PGL_CHECK(glDeleteProgram(program));
+        return 0;
     }
 
-    PGL_CHECK(glUniform2fv(uniform->location, count, values));
+    shader->uniform_count = header.uniform_count;
+
+    return program;
 }
 
-void pgl_set_a3f(pgl_shader_t* shader,
-                const char* name,
-                const pgl_v3f_t* vec,
-                pgl_size_t count)
+static void pgl_save_program(const pgl_shader_t* shader, uint64_t key)
 {
     PGL_ASSERT(shader);
-    PGL_ASSERT(name);
-    PGL_ASSERT(vec);
 
-    pgl_bind_shader(shader->ctx, shader);
-    const pgl_uniform_t* uniform = pgl_find_uniform(shader, name);
+    GLint length = 0;
+    PGL_CHECK(glGetProgramiv(shader->program, GL_PROGRAM_BINARY_LENGTH, &length));
 
-    if (!uniform)
+    if (length <= 0)
         return;
 
-    float values[3 * count];
+    void* binary = PGL_MALLOC((size_t)length, shader->ctx->mem_ctx);
 
-    pgl_size_t i, j;
+    if (!binary)
+        return;
 
-    for (i = 0, j = 0; j < count; i += 3, j++)
-    {
-        values[i]     = vec[j][0];
-        values[i + 1] = vec[j][1];
-        values[i + 2] = vec[j][2];
-    }
+    GLenum format = 0;
 
-    PGL_CHECK(glUniform3fv(uniform->location, count, values));
-}
+    PGL_CHECK(glGetProgramBinary(shader->program, length, &length, &format, binary));
 
-void pgl_set_a4f(pgl_shader_t* shader,
-                const char* name,
-                const pgl_v4f_t* vec,
-                pgl_size_t count)
-{
-    PGL_ASSERT(shader);
-    PGL_ASSERT(name);
-    PGL_ASSERT(vec);
+    char path[PGL_PROGRAM_PATH_LENGTH];
+    pgl_program_path(path, sizeof(path), key);
 
-    pgl_bind_shader(shader->ctx, shader);
-    const pgl_uniform_t* uniform = pgl_find_uniform(shader, name);
+    FILE* file = fopen(path, "wb");
 
-    if (!uniform)
+    if (!file)
+    {
+        PGL_LOG("Unable to write program cache file %s", path);
+        PGL_FREE(binary, shader->ctx->mem_ctx);
         return;
+    }
 
-    float values[4 * count];
+    pgl_program_header_t header =
+    {
+        PGL_PROGRAM_CACHE_MAGIC,
+        format,
+        key,
+        (uint32_t)length,
+        (uint32_t)shader->uniform_count
+    };
 
-    pgl_size_t i, j;
+    bool ok = (1 == fwrite(&header, sizeof(header), 1, file));
 
-    for (i = 0, j = 0; j < count; i += 4, j++)
+    for (pgl_size_t i = 0; ok && i < shader->uniform_count; i++)
     {
-        values[i]     = vec[j][0];
-        values[i + 1] = vec[j][1];
-        values[i + 2] = vec[j][2];
-        values[i + 3] = vec[j][3];
-    }
-
-    PGL_CHECK(glUniform4fv(uniform->location, count, values));
-}
+        const pgl_uniform_t* uniform = &shader->uniforms[i];
 
-void pgl_set_m2(pgl_shader_t* shader, const char* name, const pgl_m2_t matrix)
-{
-    PGL_ASSERT(shader);
-    PGL_ASSERT(name);
-    PGL_ASSERT(matrix);
+        pgl_cached_uniform_t cached;
+        memset(&cached, 0, sizeof(cached));
 
-    pgl_bind_shader(shader->ctx, shader);
-    const pgl_uniform_t* uniform = pgl_find_uniform(shader, name);
+        memcpy(cached.name, uniform->name, PGL_UNIFORM_NAME_LENGTH);
+        cached.size     = uniform->size;
+        cached.type     = uniform->type;
+        cached.location = uniform->location;
 
-    if (!uniform)
-        return;
+        ok = (1 == fwrite(&cached, sizeof(cached), 1, file));
+    }
 
-    PGL_CHECK(glUniformMatrix2fv(uniform->location, uniform->size, shader->ctx->transpose, (float*)matrix));
-}
+    if (ok)
+        ok = ((size_t)length == fwrite(binary, 1, (size_t)length, file));
 
-void pgl_set_m3(pgl_shader_t* shader, const char* name, const pgl_m3_t matrix)
-{
-    PGL_ASSERT(shader);
-    PGL_ASSERT(name);
-    PGL_ASSERT(matrix);
+    fclose(file);
 
-    pgl_bind_shader(shader->ctx, shader);
-    const pgl_uniform_t* uniform = pgl_find_uniform(shader, name);
+    // Never leave a truncated file behind
+    if (!ok)
+        remove(path);
 
-    if (!uniform)
-        return;
+    PGL_FREE(binary, shader->ctx->mem_ctx);
+}
 
-    PGL_CHECK(glUniformMatrix3fv(uniform->location, uniform->size, shader->ctx->transpose, (float*)matrix));
+// Size in bytes of a single element of a uniform, or 0 if the type has no
+// setter (in which case the uniform is not cached)
+static size_t pgl_uniform_type_size(GLenum type)
+{
+    switch (type)
+    {
+        case GL_FLOAT:        return 1 * sizeof(float);
+        case GL_FLOAT_VEC2:   return 2 * sizeof(float);
+        case GL_FLOAT_VEC3:   return 3 * sizeof(float);
+        case GL_FLOAT_VEC4:   return 4 * sizeof(float);
+        case GL_FLOAT_MAT2:   return 4 * sizeof(float);
+        case GL_FLOAT_MAT3:   return 9 * sizeof(float);
+        case GL_FLOAT_MAT4:   return 16 * sizeof(float);
+
+        case GL_INT:
+        case GL_BOOL:
+        case GL_SAMPLER_2D:
+        case GL_SAMPLER_3D:
+        case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_2D_SHADOW:
+        case GL_SAMPLER_2D_ARRAY: return 1 * sizeof(int32_t);
+
+        case GL_INT_VEC2:
+        case GL_BOOL_VEC2:    return 2 * sizeof(int32_t);
+        case GL_INT_VEC3:
+        case GL_BOOL_VEC3:    return 3 * sizeof(int32_t);
+        case GL_INT_VEC4:
+        case GL_BOOL_VEC4:    return 4 * sizeof(int32_t);
+
+        default:              return 0;
+    }
 }
 
-void pgl_set_m4(pgl_shader_t* shader, const char* name, const pgl_m4_t matrix)
+// Compares a value against the copy of the value last sent to the uniform and
+// updates the copy. Returns true if the value needs to be sent.
+static bool pgl_cache_uniform(pgl_uniform_t* uniform, const void* value, size_t size)
 {
-    PGL_ASSERT(shader);
-    PGL_ASSERT(name);
-    PGL_ASSERT(matrix);
+    PGL_ASSERT(uniform);
+    PGL_ASSERT(value);
 
-    pgl_bind_shader(shader->ctx, shader);
-    const pgl_uniform_t* uniform = pgl_find_uniform(shader, name);
+    if (size > uniform->capacity)
+    {
+        uniform->cached = 0;
+        return true;
+    }
 
-    if (!uniform)
-        return;
+    if (size <= uniform->cached && pgl_mem_equal(uniform->value, value, size))
+        return false;
 
-    PGL_CHECK(glUniformMatrix4fv(uniform->location, uniform->size, shader->ctx->transpose, (float*)matrix));
+    memcpy(uniform->value, value, size);
+
+    // Elements past the end of a shorter array keep their previous values
+    if (size > uniform->cached)
+        uniform->cached = size;
+
+    return true;
 }
 
-void pgl_set_s2d(pgl_shader_t* shader, const char* name, int32_t value)
+static void pgl_send_uniform(pgl_shader_t* shader, int32_t handle, GLenum type,
+                             const void* value, pgl_size_t count)
 {
     PGL_ASSERT(shader);
-    PGL_ASSERT(name);
+    PGL_ASSERT(value);
 
-    pgl_bind_shader(shader->ctx, shader);
-    const pgl_uniform_t* uniform = pgl_find_uniform(shader, name);
-
-    if (!uniform)
+    if (handle < 0)
         return;
 
-    PGL_CHECK(glUniform1i(uniform->location, value));
-}
-
-/*=============================================================================
- * Internal API implementation
- *============================================================================*/
+    pgl_uniform_t* uniform = &shader->uniforms[handle];
 
-static void pgl_set_error(pgl_ctx_t* ctx, pgl_error_t code)
-{
-    PGL_ASSERT(ctx);
-    ctx->error_code = code;
-}
+    GLboolean transpose = shader->ctx->transpose;
 
-static const char* pgl_get_default_vert_shader()
-{
-    pgl_version_t ver = pgl_get_version();
+    bool matrix = (GL_FLOAT_MAT2 == type || GL_FLOAT_MAT3 == type ||
+                   GL_FLOAT_MAT4 == type);
 
-    switch (ver)
+    // A matrix sent with a different transpose flag is a different value
+    if (matrix && uniform->transpose != transpose)
     {
-        case PGL_GL3:
-            return PGL_GL_VERT_SRC;
+        uniform->transpose = transpose;
+        uniform->cached = 0;
+    }
 
-        case PGL_GLES3:
-            return PGL_GLES_VERT_SRC;
+    if (!pgl_cache_uniform(uniform, value, pgl_uniform_type_size(type) * count))
+        return;
 
-        default:
-            return NULL;
-    }
-}
+    // Binding the shader flushes the batch, which is only needed when the
+    // value actually changes
+    pgl_bind_shader(shader->ctx, shader);
 
-static const char* pgl_get_default_frag_shader()
-{
-    pgl_version_t ver = pgl_get_version();
+    GLint location = uniform->location;
 
-    switch (ver)
+    switch (type)
     {
-        case PGL_GL3:
-            return PGL_GL_FRAG_SRC;
-
-        case PGL_GLES3:
-            return PGL_GLES_FRAG_SRC;
+        case GL_FLOAT:
+            PGL_CHECK(glUniform1fv(location, count, value));
+            break;
+
+        case GL_FLOAT_VEC2:
+            PGL_CHECK(glUniform2fv(location, count, value));
+            break;
+
+        case GL_FLOAT_VEC3:
+            PGL_CHECK(glUniform3fv(location, count, value));
+            break;
+
+        case GL_FLOAT_VEC4:
+            PGL_CHECK(glUniform4fv(location, count, value));
+            break;
+
+        case GL_FLOAT_MAT2:
+            PGL_CHECK(glUniformMatrix2fv(location, count, transpose, value));
+            break;
+
+        case GL_FLOAT_MAT3:
+            PGL_CHECK(glUniformMatrix3fv(location, count, transpose, value));
+            break;
+
+        case GL_FLOAT_MAT4:
+            PGL_CHECK(glUniformMatrix4fv(location, count, transpose, value));
+            break;
+
+        case GL_INT:
+        case GL_BOOL:
+        case GL_SAMPLER_2D:
+        case GL_SAMPLER_3D:
+        case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_2D_SHADOW:
+        case GL_SAMPLER_2D_ARRAY:
+            PGL_CHECK(glUniform1iv(location, count, value));
+            break;
+
+        case GL_INT_VEC2:
+        case GL_BOOL_VEC2:
+            PGL_CHECK(glUniform2iv(location, count, value));
+            break;
+
+        case GL_INT_VEC3:
+        case GL_BOOL_VEC3:
+            PGL_CHECK(glUniform3iv(location, count, value));
+            break;
+
+        case GL_INT_VEC4:
+        case GL_BOOL_VEC4:
+            PGL_CHECK(glUniform4iv(location, count, value));
+            break;
 
         default:
-            return NULL;
+            PGL_ASSERT(false); // Unsupported uniform type
+            break;
     }
 }
 
-static void pgl_reset_last_state(pgl_ctx_t* ctx)
+// Returns the vertex array that immediate draws of the format use, creating
+// it on first use
+static pgl_layout_t* pgl_get_layout(pgl_ctx_t* ctx, const pgl_vertex_format_t* format)
 {
-    PGL_ASSERT(ctx);
+    PGL_ASSERT(format->stride > 0);
 
-    pgl_state_t* last = &ctx->last_state;
+    for (pgl_size_t i = 0; i < ctx->layout_count; i++)
+    {
+        if (pgl_mem_equal(&ctx->layouts[i].format, format, sizeof(pgl_vertex_format_t)))
+            return &ctx->layouts[i];
+    }
 
-    memset(last, 0, sizeof(pgl_state_t));
+    pgl_layout_t* layout;
 
-    pgl_blend_mode_t mode =
+    if (ctx->layout_count < PGL_MAX_VERTEX_FORMATS)
     {
-        PGL_FACTOR_COUNT, PGL_FACTOR_COUNT, PGL_EQ_COUNT,
-        PGL_FACTOR_COUNT, PGL_FACTOR_COUNT, PGL_EQ_COUNT
-    };
+        layout = &ctx->layouts[ctx->layout_count];
 
-    last->blend_mode = mode;
-}
+        PGL_CHECK(glGenVertexArrays(1, &layout->vao));
 
-static pgl_state_stack_t* pgl_get_active_stack(pgl_ctx_t* ctx)
-{
-    PGL_ASSERT(ctx);
+        if (0 == layout->vao)
+        {
+            pgl_set_error(ctx, PGL_OUT_OF_MEMORY);
+            return NULL;
+        }
 
-    pgl_state_stack_t* stack = &ctx->stack;
+        ctx->layout_count++;
+    }
+    else
+    {
+        // Out of vertex arrays, so the last one is reconfigured. The batch may
+        // still hold vertices in its old format.
+        layout = &ctx->layouts[PGL_MAX_VERTEX_FORMATS - 1];
+        pgl_flush_pending();
+    }
 
-    if (ctx->target)
-        stack = &ctx->target_stack;
+    layout->format = *format;
 
-    return stack;
-}
+    pgl_gl_bind_vertex_array(layout->vao);
+    pgl_gl_bind_buffer(GL_ARRAY_BUFFER, ctx->vertex_stream.id);
+    pgl_gl_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, ctx->index_stream.id);
 
-static pgl_state_t* pgl_get_active_state(pgl_ctx_t* ctx)
-{
-    PGL_ASSERT(ctx);
+    pgl_bind_attributes(format);
 
-    return &pgl_get_active_stack(ctx)->state;
+    return layout;
 }
 
-static void pgl_apply_blend(pgl_ctx_t* ctx, const pgl_blend_mode_t* mode)
+static void pgl_bind_attribute(GLuint index, const pgl_attr_format_t* attr, GLsizei stride)
 {
-    PGL_ASSERT(ctx);
-    PGL_ASSERT(mode);
-
-    if (pgl_mem_equal(mode, &ctx->last_state.blend_mode, sizeof(pgl_blend_mode_t)))
-        return;
+    PGL_ASSERT(attr->components >= 1 && attr->components <= 4);
 
-    PGL_CHECK(glBlendFuncSeparate(pgl_blend_factor_map[mode->color_src],
-                                  pgl_blend_factor_map[mode->color_dst],
-                                  pgl_blend_factor_map[mode->alpha_src],
-                                  pgl_blend_factor_map[mode->alpha_dst]));
+    PGL_CHECK(glVertexAttribPointer(index, (GLint)attr->components,
+                                    pgl_attr_type_map[attr->type],
+                                    pgl_attr_norm_map[attr->type],
+                                    stride,
+                                    (GLvoid*)(uintptr_t)attr->offset));
 
-    PGL_CHECK(glBlendEquationSeparate(pgl_blend_eq_map[mode->color_eq],
-                                      pgl_blend_eq_map[mode->alpha_eq]));
+    PGL_CHECK(glEnableVertexAttribArray(index));
 }
 
-static void pgl_apply_transform(pgl_ctx_t* ctx, const pgl_m4_t matrix)
+// Points the attributes of the bound vertex array at the bound array buffer
+static void pgl_bind_attributes(const pgl_vertex_format_t* format)
 {
-    PGL_ASSERT(ctx);
-    PGL_ASSERT(matrix);
-
-    if (pgl_mem_equal(matrix, ctx->last_state.transform, sizeof(pgl_m4_t)))
-        return;
+    GLsizei stride = (GLsizei)format->stride;
 
-    pgl_set_m4(ctx->shader, "u_transform", matrix);
+    pgl_bind_attribute(0, &format->pos, stride);   // Position
+    pgl_bind_attribute(1, &format->color, stride); // Color
+    pgl_bind_attribute(2, &format->uv, stride);    // UV
 }
 
-static void pgl_apply_projection(pgl_ctx_t* ctx, const pgl_m4_t matrix)
+// Points the instance attributes of the bound vertex array at the instance
+// buffer. There is no base instance in GL 3.3 or GLES 3.1, so the first
+// instance is selected by offsetting the attribute pointers.
+static void pgl_attach_instances(pgl_buffer_t* buffer,
+                                 const pgl_instance_buffer_t* instances,
+                                 pgl_size_t first_instance)
 {
-    PGL_ASSERT(ctx);
-    PGL_ASSERT(matrix);
+    PGL_ASSERT(buffer);
+    PGL_ASSERT(instances);
 
-    if (pgl_mem_equal(matrix, &ctx->last_state.projection, sizeof(pgl_m4_t)))
+    if (buffer->instance_serial == instances->serial &&
+        buffer->first_instance == first_instance)
         return;
 
-    pgl_set_m4(ctx->shader, "u_projection", matrix);
-}
+    pgl_gl_bind_buffer(GL_ARRAY_BUFFER, instances->vbo);
 
-static void pgl_apply_viewport(pgl_ctx_t* ctx, const pgl_viewport_t* viewport)
-{
-    PGL_ASSERT(ctx);
-    PGL_ASSERT(viewport);
+    size_t base = first_instance * sizeof(pgl_instance_t);
 
-    if (viewport->w <= 0 && viewport->h <= 0)
-        return;
+    // Transform (a mat4 occupies four consecutive locations)
+    for (GLuint i = 0; i < 4; i++)
+    {
+        size_t offset = base + offsetof(pgl_instance_t, transform) + i * 4 * sizeof(float);
 
-    if (pgl_mem_equal(viewport, &ctx->last_state.viewport, sizeof(pgl_viewport_t)))
-        return;
+        PGL_CHECK(glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE,
+                                        sizeof(pgl_instance_t),
+                                        (GLvoid*)offset));
 
-    PGL_CHECK(glViewport(viewport->x, viewport->y, viewport->w, viewport->h));
-}
+        PGL_CHECK(glEnableVertexAttribArray(3 + i));
+        PGL_CHECK(glVertexAttribDivisor(3 + i, 1));
+    }
 
-static void pgl_apply_line_width(pgl_ctx_t* ctx, float line_width)
-{
-    PGL_ASSERT(ctx);
+    // Color
+    PGL_CHECK(glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE,
+                                    sizeof(pgl_instance_t),
+                                    (GLvoid*)(base + offsetof(pgl_instance_t, color))));
 
-    if (line_width == ctx->last_state.line_width)
-        return;
+    PGL_CHECK(glEnableVertexAttribArray(7));
+    PGL_CHECK(glVertexAttribDivisor(7, 1));
 
-    PGL_CHECK(glLineWidth(line_width));
-}
+    // UV rectangle
+    PGL_CHECK(glVertexAttribPointer(8, 4, GL_FLOAT, GL_FALSE,
+                                    sizeof(pgl_instance_t),
+                                    (GLvoid*)(base + offsetof(pgl_instance_t, uv_rect))));
 
-static void pgl_before_draw(pgl_ctx_t* ctx, pgl_texture_t* texture, pgl_shader_t* shader)
-{
-    PGL_ASSERT(ctx);
-    PGL_ASSERT(shader);
+    PGL_CHECK(glEnableVertexAttribArray(8));
+    PGL_CHECK(glVertexAttribDivisor(8, 1));
 
-    pgl_bind_texture(ctx, texture);
-    pgl_bind_shader(ctx, shader);
+    buffer->instance_serial = instances->serial;
+    buffer->first_instance = first_instance;
+}
 
-    pgl_state_t* state = pgl_get_active_state(ctx);
+static void pgl_init_stream(pgl_stream_t* stream, GLenum target, GLsizeiptr size)
+{
+    PGL_ASSERT(stream);
+    PGL_ASSERT(size >= PGL_STREAM_SEGMENT_COUNT);
 
-    pgl_apply_viewport(ctx, &state->viewport);
-    pgl_apply_blend(ctx, &state->blend_mode);
-    pgl_apply_transform(ctx, state->transform);
-    pgl_apply_projection(ctx, state->projection);
-    pgl_apply_line_width(ctx, state->line_width);
+    memset(stream, 0, sizeof(pgl_stream_t));
 
-    glEnable(GL_BLEND);
+    stream->target = target;
+    stream->size = size;
+    stream->open = -1;
+    stream->last = -1;
 
-    if (ctx->depth)
-        PGL_CHECK(glEnable(GL_DEPTH_TEST));
-    else
-        PGL_CHECK(glDisable(GL_DEPTH_TEST));
+    PGL_CHECK(glGenBuffers(1, &stream->id));
+    pgl_gl_bind_buffer(target, stream->id);
+    PGL_CHECK(glBufferData(target, size, NULL, GL_STREAM_DRAW));
+}
 
-    if (ctx->srgb)
-        PGL_CHECK(glEnable(GL_FRAMEBUFFER_SRGB));
-    else
-        PGL_CHECK(glDisable(GL_FRAMEBUFFER_SRGB));
+static void pgl_delete_stream_fences(pgl_stream_t* stream)
+{
+    for (int i = 0; i < PGL_STREAM_SEGMENT_COUNT; i++)
+    {
+        if (stream->fences[i])
+        {
+            PGL_CHECK(glDeleteSync(stream->fences[i]));
+            stream->fences[i] = NULL;
+        }
+    }
 }
 
-static void pgl_after_draw(pgl_ctx_t* ctx)
+static void pgl_destroy_stream(pgl_stream_t* stream)
 {
-    PGL_ASSERT(ctx);
+    PGL_ASSERT(stream);
 
-    ctx->last_state = *pgl_get_active_state(ctx);
+    pgl_delete_stream_fences(stream);
+    pgl_gl_delete_buffer(stream->id);
 }
 
-static int pgl_load_uniforms(pgl_shader_t* shader)
+static void pgl_wait_stream_fence(pgl_stream_t* stream, int segment)
 {
-    PGL_ASSERT(shader);
-
-    // Get number of active uniforms
-    GLint uniform_count;
-    glGetProgramiv(shader->program, GL_ACTIVE_UNIFORMS, &uniform_count);
-    shader->uniform_count = uniform_count;
+    GLsync fence = stream->fences[segment];
 
-    // Validate number of uniforms
-    PGL_ASSERT(uniform_count < PGL_MAX_UNIFORMS);
+    if (!fence)
+        return;
 
-    if (uniform_count >= PGL_MAX_UNIFORMS)
-    {
-        pgl_set_error(shader->ctx, PGL_INVALID_UNIFORM_COUNT);
-        return -1;
-    }
+    GLenum result;
 
-    // Loop through active uniforms and add them to the uniform array
-    for (GLint i = 0; i < uniform_count; i++)
+    do
     {
-        pgl_uniform_t uniform;
-        GLsizei name_length;
+        // GL_TIMEOUT_IGNORED is not allowed here in GLES, so poll (1ms)
+        result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+    } while (GL_TIMEOUT_EXPIRED == result);
 
-        // Uniform index
-        GLint index = i;
+    PGL_CHECK(glDeleteSync(fence));
+    stream->fences[segment] = NULL;
+}
 
-        // Get uniform information
-        PGL_CHECK(glGetActiveUniform(shader->program, index,
-                                     PGL_UNIFORM_NAME_LENGTH, // Max name length
-                                     &name_length, &uniform.size, &uniform.type,
-                                     uniform.name));
+// Maps `size` bytes of the ring for writing and returns the offset of the
+// mapped range. The range must be unmapped before drawing.
+static void* pgl_map_stream(pgl_stream_t* stream, GLsizeiptr size,
+                            GLsizeiptr align, GLintptr* offset)
+{
+    PGL_ASSERT(stream);
+    PGL_ASSERT(size > 0);
+    PGL_ASSERT(align > 0);
+    PGL_ASSERT(offset);
 
-        // Validate name length
-        PGL_ASSERT(name_length <= PGL_UNIFORM_NAME_LENGTH);
+    pgl_gl_bind_buffer(stream->target, stream->id);
 
-        if (name_length > PGL_UNIFORM_NAME_LENGTH)
-        {
-            pgl_set_error(shader->ctx, PGL_INVALID_UNIFORM_NAME);
-            return -1;
-        }
+    // Orphan the storage if the data cannot fit at all. Draws that are still
+    // in flight keep reading from the old storage.
+    if (size > stream->size)
+    {
+        pgl_delete_stream_fences(stream);
 
-        // Get uniform location
-        uniform.location = glGetUniformLocation(shader->program, uniform.name);
+        while (stream->size < size)
+            stream->size *= 2;
 
-        // Hash name for fast lookups
-        uniform.hash = pgl_hash_str(uniform.name);
+        stream->head = 0;
+        stream->open = -1;
+        stream->last = -1;
 
-        // Store uniform in the array
-        shader->uniforms[i] = uniform;
+        PGL_CHECK(glBufferData(stream->target, stream->size, NULL, GL_STREAM_DRAW));
     }
 
-	return 0;
-}
+    GLintptr start = (stream->head + align - 1) / align * align;
 
-static const pgl_uniform_t* pgl_find_uniform(const pgl_shader_t* shader, const char* name)
-{
-    PGL_ASSERT(shader);
-    PGL_ASSERT(name && strlen(name) > 0);
+    bool wrap = start + size > stream->size;
 
-	pgl_size_t uniform_count = shader->uniform_count;
-	const pgl_uniform_t* uniforms = shader->uniforms;
+    if (wrap)
+        start = 0;
 
-	uint64_t hash = pgl_hash_str(name);
+    GLsizeiptr segment_size = (stream->size + PGL_STREAM_SEGMENT_COUNT - 1) /
+                              PGL_STREAM_SEGMENT_COUNT;
 
-	for (pgl_size_t i = 0; i < uniform_count; i++)
-	{
-		const pgl_uniform_t* uniform = &uniforms[i];
+    int first = (int)(start / segment_size);
+    int last  = (int)((start + size - 1) / segment_size);
 
-		if (uniform->hash == hash && pgl_str_equal(name, uniform->name))
-		{
-			return uniform;
+    // Fence the segments that the write head is leaving. Every draw that
+    // reads from them has already been issued.
+    if (stream->open >= 0)
+    {
+        int end = stream->last;
+
+        if (!wrap && first - 1 < end)
+            end = first - 1;
+
+        for (int i = stream->open; i <= end; i++)
+        {
+            PGL_CHECK(stream->fences[i] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
         }
-	}
 
-    return NULL;
-}
+        stream->open = (end == stream->last) ? -1 : first;
+    }
 
-static void pgl_bind_attributes()
-{
-    // Position
-    PGL_CHECK(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
-                                    sizeof(pgl_vertex_t),
-                                    (GLvoid*)offsetof(pgl_vertex_t, pos)));
+    // Wait until the GPU has finished reading the segments about to be
+    // overwritten (usually long ago)
+    for (int i = first; i <= last; i++)
+    {
+        pgl_wait_stream_fence(stream, i);
+    }
 
-    PGL_CHECK(glEnableVertexAttribArray(0));
+    if (stream->open < 0)
+        stream->open = first;
 
-    // Color
-    PGL_CHECK(glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE,
-                                    sizeof(pgl_vertex_t),
-                                    (GLvoid*)offsetof(pgl_vertex_t, color)));
+    stream->last = last;
+    stream->head = start + size;
 
-    PGL_CHECK(glEnableVertexAttribArray(1));
+    *offset = start;
 
-    // UV
-    PGL_CHECK(glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE,
-                                    sizeof(pgl_vertex_t),
-                                    (GLvoid*)offsetof(pgl_vertex_t, uv)));
+    void* ptr = NULL;
 
-    PGL_CHECK(glEnableVertexAttribArray(2));
+    PGL_CHECK(ptr = glMapBufferRange(stream->target, start, size,
+                                     GL_MAP_WRITE_BIT |
+                                     GL_MAP_INVALIDATE_RANGE_BIT |
+                                     GL_MAP_UNSYNCHRONIZED_BIT));
 
+    return ptr;
 }
 
 static void pgl_log(const char* fmt, ...)
@@ -3084,6 +5555,19 @@ static pgl_error_t pgl_map_error(GLenum id)
 
     return PGL_UNKNOWN_ERROR;
 }
+static uint64_t pgl_hash_bytes64(uint64_t hash, const void* data, size_t size)
+{
+    const uint8_t* bytes = data;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= PGL_PRIME_64;
+    }
+
+    return hash;
+}
+
 static bool pgl_str_equal(const char* str1, const char* str2)
 {
     return (0 == strcmp(str1, str2));
@@ -24,54 +24,179 @@
  * For more information, please refer to <http://unlicense.org/>
  *============================================================================*/
 
+#define PICO_TIME_IMPLEMENTATION
+#include "../pico_time.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*=============================================================================
+ * Allocation tracking
+ *============================================================================*/
+
+// Every ECS allocation is routed through these hooks so that the benchmark
+// can report the peak number of bytes in use
+typedef struct
+{
+    size_t current;
+    size_t peak;
+} mem_stats_t;
+
+// Prepended to each allocation to remember its size
+typedef union
+{
+    size_t size;
+    double align_d;
+    void*  align_p;
+} mem_header_t;
+
+static void* bench_malloc(size_t size, void* ctx);
+static void* bench_realloc(void* ptr, size_t size, void* ctx);
+static void  bench_free(void* ptr, void* ctx);
+
 //#define ECS_DEBUG
 #define PICO_ECS_MAX_SYSTEMS 16
 #define PICO_ECS_MAX_COMPONENTS 64
+#define PICO_ECS_MALLOC(size, ctx)       (bench_malloc(size, ctx))
+#define PICO_ECS_REALLOC(ptr, size, ctx) (bench_realloc(ptr, size, ctx))
+#define PICO_ECS_FREE(ptr, ctx)          (bench_free(ptr, ctx))
 #define PICO_ECS_IMPLEMENTATION
 #include "../pico_ecs.h"
 
-#include <stdio.h>
-#include <stdlib.h>
-#include <time.h>
+static void mem_track(mem_stats_t* stats, size_t old_size, size_t new_size)
+{
+    stats->current = stats->current - old_size + new_size;
+
+    if (stats->current > stats->peak)
+        stats->peak = stats->current;
+}
+
+static void* bench_malloc(size_t size, void* ctx)
+{
+    mem_header_t* header = malloc(sizeof(mem_header_t) + size);
+
+    if (!header)
+        return NULL;
+
+    header->size = size;
+    mem_track(ctx, 0, size);
+
+    return header + 1;
+}
+
+static void* bench_realloc(void* ptr, size_t size, void* ctx)
+{
+    if (!ptr)
+        return bench_malloc(size, ctx);
+
+    mem_header_t* header = (mem_header_t*)ptr - 1;
+    size_t old_size = header->size;
+
+    header = realloc(header, sizeof(mem_header_t) + size);
+
+    if (!header)
+        return NULL;
+
+    header->size = size;
+    mem_track(ctx, old_size, size);
+
+    return header + 1;
+}
+
+static void bench_free(void* ptr, void* ctx)
+{
+    if (!ptr)
+        return;
+
+    mem_header_t* header = (mem_header_t*)ptr - 1;
+    mem_track(ctx, header->size, 0);
+
+    free(header);
+}
 
 /*=============================================================================
  * Preamble
  *============================================================================*/
 
-int random_int(int min, int max)
-{
-    return rand() % (max + 1 - min) + min;
-}
+#define DEFAULT_ENTITIES (1000 * 1000)
+#define ITERATIONS       10
+#define SPARSE_STRIDE    16
+#define MAX_ITER_COMPS   16
+
+static ecs_t*      ecs = NULL;
+static mem_stats_t mem = { 0 };
+
+// Number of entities in each scenario (set from the command line)
+static int entity_count = DEFAULT_ENTITIES;
 
-#define MIN_ENTITIES (1000 * 1000)
-#define MAX_ENTITIES (1000 * 1000)
+// IDs of the entities created during setup
+static ecs_id_t* ids = NULL;
 
-static clock_t start, end;
-static ecs_t* ecs = NULL;
+// Number of entities visited by the iteration system
+static int iter_visited = 0;
 
-static void setup();
-static void teardown();
+// Print comma-separated values instead of a table
+static bool csv = false;
 
-static void bench_begin(const char* name)
+// State of the random number generator. rand() is not used because RAND_MAX
+// may be as small as 32767, which would not reach most entities
+static uint32_t rng_state = 1;
+
+// Returns a pseudo-random number (xorshift32)
+static uint32_t bench_rand(void)
 {
-    printf("---------------------------------------------------------------\n");
-    printf("Running: %s\n", name);
-    start = clock();
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
 }
 
-static void bench_end()
+typedef void (*setup_fn)(void);
+typedef int  (*bench_fn)(void);
+
+// Runs a benchmark function and reports its cost per operation. The setup
+// function is not timed, but its allocations count towards the peak
+static void bench_run(const char* name,
+                      bench_fn fp,
+                      setup_fn setup_fp,
+                      setup_fn teardown_fp)
 {
-    end = clock();
-    double elapsed = 1000.0 * (double)(end - start) / CLOCKS_PER_SEC;
-    printf("Time elapsed %f ms\n", elapsed);
+    mem.peak = mem.current;
+
+    setup_fp();
+
+    ptime_t start = pt_now();
+    int ops = fp();
+    ptime_t end = pt_now();
+
+    teardown_fp();
+
+    double elapsed_ms = (double)pt_to_usec(end - start) / 1000.0;
+    double ns_per_op  = (ops > 0) ? elapsed_ms * 1000000.0 / ops : 0.0;
+
+#ifdef PICO_ECS_ARCHETYPES
+    const char* mode = "archetypes";
+#else
+    const char* mode = "sparse";
+#endif
+
+    if (csv)
+    {
+        printf("%s,%s,%d,%d,%.3f,%.3f,%zu\n",
+               name, mode, entity_count, ops, ns_per_op, elapsed_ms, mem.peak);
+    }
+    else
+    {
+        printf("%-36s %10d %12.2f %12.3f %14zu\n",
+               name, ops, ns_per_op, elapsed_ms, mem.peak);
+    }
 }
 
 #define BENCH_RUN(fp, setup_fp, teardown_fp) \
-    setup_fp(); \
-    bench_begin(#fp); \
-    fp(); \
-    bench_end(); \
-    teardown_fp();
+    bench_run(#fp, fp, setup_fp, teardown_fp)
 
 /*=============================================================================
  * Systems/components
@@ -82,12 +207,15 @@ ecs_id_t MovementSystem;
 ecs_id_t ComflabSystem;
 ecs_id_t BoundsSystem;
 ecs_id_t QueueDestroySystem;
+ecs_id_t QueueRemoveSystem;
+ecs_id_t IterSystem;
 
 // Component IDs
 ecs_id_t PosComponent;
 ecs_id_t DirComponent;
 ecs_id_t RectComponent;
 ecs_id_t ComflabComponent;
+ecs_id_t IterComponents[MAX_ITER_COMPS];
 
 // Position component
 typedef struct
@@ -116,6 +244,11 @@ ecs_ret_t movement_system(ecs_t* ecs, ecs_id_t* entities,
                           int entity_count, ecs_dt_t dt,
                           void* udata);
 
+#ifdef PICO_ECS_ARCHETYPES
+ecs_ret_t movement_chunk_system(ecs_t* ecs, ecs_chunk_t* chunk,
+                                ecs_dt_t dt, void* udata);
+#endif
+
 ecs_ret_t comflab_system(ecs_t* ecs, ecs_id_t* entities,
                          int entity_count, ecs_dt_t dt,
                          void* udata);
@@ -126,42 +259,88 @@ ecs_ret_t bounds_system(ecs_t* ecs,
                         ecs_dt_t dt,
                         void* udata);
 
+ecs_ret_t queue_destroy_system(ecs_t* ecs,
+                               ecs_id_t* entities,
+                               int entity_count,
+                               ecs_dt_t dt,
+                               void* udata);
+
+ecs_ret_t queue_remove_system(ecs_t* ecs,
+                              ecs_id_t* entities,
+                              int entity_count,
+                              ecs_dt_t dt,
+                              void* udata);
+
+ecs_ret_t iter_system(ecs_t* ecs,
+                      ecs_id_t* entities,
+                      int entity_count,
+                      ecs_dt_t dt,
+                      void* udata);
+
 static void setup()
 {
     // Create ECS instance
-    ecs = ecs_new(MIN_ENTITIES, NULL);
+    ecs = ecs_new(entity_count, &mem);
 
     // Register two new components
     PosComponent  = ecs_register_component(ecs, sizeof(v2d_t),  NULL, NULL);
     RectComponent = ecs_register_component(ecs, sizeof(rect_t), NULL, NULL);
 }
 
-static void setup_destroy_with_two_components()
+static void create_two_components()
 {
-    // Create ECS instance
-    ecs = ecs_new(MIN_ENTITIES, NULL);
-
-    PosComponent  = ecs_register_component(ecs, sizeof(v2d_t),  NULL, NULL);
-    RectComponent = ecs_register_component(ecs, sizeof(rect_t), NULL, NULL);
-
-    for (ecs_id_t i = 0; i < MAX_ENTITIES; i++)
+    for (int i = 0; i < entity_count; i++)
     {
-        ecs_id_t id = ecs_create(ecs);
-        ecs_add(ecs, id, PosComponent, NULL);
-        ecs_add(ecs, id, RectComponent, NULL);
+        ids[i] = ecs_create(ecs);
+        ecs_add(ecs, ids[i], PosComponent, NULL);
+        ecs_add(ecs, ids[i], RectComponent, NULL);
     }
 }
 
+// Systems only pick up entities that gain components after they are
+// registered, so the systems are registered first
+static void setup_queue_destroy()
+{
+    setup();
+
+    QueueDestroySystem = ecs_register_system(ecs, queue_destroy_system, NULL, NULL, NULL);
+    ecs_require_component(ecs, QueueDestroySystem, PosComponent);
+    ecs_require_component(ecs, QueueDestroySystem, RectComponent);
+
+    create_two_components();
+}
+
+static void setup_queue_remove()
+{
+    setup();
+
+    QueueRemoveSystem = ecs_register_system(ecs, queue_remove_system, NULL, NULL, NULL);
+    ecs_require_component(ecs, QueueRemoveSystem, PosComponent);
+    ecs_require_component(ecs, QueueRemoveSystem, RectComponent);
+
+    create_two_components();
+}
+
+static void setup_two_components()
+{
+    setup();
+    create_two_components();
+}
+
 static void setup_three_systems()
 {
-    ecs = ecs_new(MIN_ENTITIES, NULL);
+    ecs = ecs_new(entity_count, &mem);
 
     PosComponent = ecs_register_component(ecs, sizeof(v2d_t), NULL, NULL);
     DirComponent = ecs_register_component(ecs, sizeof(v2d_t), NULL, NULL);
     ComflabComponent = ecs_register_component(ecs, sizeof(comflab_t), NULL, NULL);
     RectComponent = ecs_register_component(ecs, sizeof(rect_t), NULL, NULL);
 
+#ifdef PICO_ECS_ARCHETYPES
+    MovementSystem = ecs_register_chunk_system(ecs, movement_chunk_system, NULL, NULL, NULL);
+#else
     MovementSystem = ecs_register_system(ecs, movement_system, NULL, NULL, NULL);
+#endif
     ecs_require_component(ecs, MovementSystem, PosComponent);
     ecs_require_component(ecs, MovementSystem, DirComponent);
 
@@ -172,6 +351,61 @@ static void setup_three_systems()
     ecs_require_component(ecs, BoundsSystem, RectComponent);
 }
 
+// Every entity gets all iteration components, the system requires the first
+// `comp_count` of them
+static void setup_iter(int comp_count)
+{
+    ecs = ecs_new(entity_count, &mem);
+
+    for (int i = 0; i < MAX_ITER_COMPS; i++)
+        IterComponents[i] = ecs_register_component(ecs, sizeof(v2d_t), NULL, NULL);
+
+    IterSystem = ecs_register_system(ecs, iter_system, NULL, NULL,
+                                     (void*)(intptr_t)comp_count);
+
+    for (int i = 0; i < comp_count; i++)
+        ecs_require_component(ecs, IterSystem, IterComponents[i]);
+
+    for (int i = 0; i < entity_count; i++)
+    {
+        ids[i] = ecs_create(ecs);
+
+        for (int j = 0; j < MAX_ITER_COMPS; j++)
+            *(v2d_t*)ecs_add(ecs, ids[i], IterComponents[j], NULL) = (v2d_t){ 1, 1 };
+    }
+}
+
+static void setup_iter_1()  { setup_iter(1);  }
+static void setup_iter_4()  { setup_iter(4);  }
+static void setup_iter_16() { setup_iter(16); }
+
+// Every entity exists, but only every `stride`-th entity has the component
+// the system requires
+static void setup_population(int stride)
+{
+    ecs = ecs_new(entity_count, &mem);
+
+    PosComponent  = ecs_register_component(ecs, sizeof(v2d_t),  NULL, NULL);
+    RectComponent = ecs_register_component(ecs, sizeof(rect_t), NULL, NULL);
+
+    IterComponents[0] = PosComponent;
+    IterSystem = ecs_register_system(ecs, iter_system, NULL, NULL, (void*)(intptr_t)1);
+    ecs_require_component(ecs, IterSystem, PosComponent);
+
+    for (int i = 0; i < entity_count; i++)
+    {
+        ids[i] = ecs_create(ecs);
+
+        if (i % stride == 0)
+            *(v2d_t*)ecs_add(ecs, ids[i], PosComponent, NULL) = (v2d_t){ 1, 1 };
+        else
+            ecs_add(ecs, ids[i], RectComponent, NULL);
+    }
+}
+
+static void setup_dense()  { setup_population(1); }
+static void setup_sparse() { setup_population(SPARSE_STRIDE); }
+
 // Runs after benchmark function
 static void teardown()
 {
@@ -183,16 +417,16 @@ static void teardown()
 static void setup_get()
 {
     // Create ECS instance
-    ecs = ecs_new(MIN_ENTITIES, NULL);
+    ecs = ecs_new(entity_count, &mem);
     PosComponent = ecs_register_component(ecs, sizeof(v2d_t), NULL, NULL);
 
-    for (ecs_id_t i = 0; i < MAX_ENTITIES; i++)
+    for (int i = 0; i < entity_count; i++)
     {
         // Create entity
-        ecs_id_t id = ecs_create(ecs);
+        ids[i] = ecs_create(ecs);
 
         // Add components
-        ecs_add(ecs, id, PosComponent, NULL);
+        ecs_add(ecs, ids[i], PosComponent, NULL);
     }
 }
 
@@ -223,6 +457,30 @@ ecs_ret_t movement_system(ecs_t* ecs,
     return 0;
 }
 
+#ifdef PICO_ECS_ARCHETYPES
+ecs_ret_t movement_chunk_system(ecs_t* ecs,
+                                ecs_chunk_t* chunk,
+                                ecs_dt_t dt,
+                                void* udata)
+{
+    (void)ecs;
+    (void)udata;
+
+    int count = ecs_chunk_count(chunk);
+
+    v2d_t* pos = ecs_chunk_column(chunk, PosComponent);
+    v2d_t* dir = ecs_chunk_column(chunk, DirComponent);
+
+    for (int i = 0; i < count; i++)
+    {
+        pos[i].x += pos[i].x + dir[i].x * dt;
+        pos[i].y += pos[i].y + dir[i].y * dt;
+    }
+
+    return 0;
+}
+#endif
+
 ecs_ret_t comflab_system(ecs_t* ecs,
                         ecs_id_t* entities,
                         int entity_count,
@@ -288,36 +546,109 @@ ecs_ret_t queue_destroy_system(ecs_t* ecs,
     return 0;
 }
 
+ecs_ret_t queue_remove_system(ecs_t* ecs,
+                              ecs_id_t* entities,
+                              int entity_count,
+                              ecs_dt_t dt,
+                              void* udata)
+{
+    (void)dt;
+    (void)udata;
+
+    for (int i = 0; i < entity_count; i++)
+    {
+        ecs_queue_remove(ecs, entities[i], PosComponent);
+    }
+
+    return 0;
+}
+
+// Sums the first `udata` iteration components of each entity
+ecs_ret_t iter_system(ecs_t* ecs,
+                      ecs_id_t* entities,
+                      int entity_count,
+                      ecs_dt_t dt,
+                      void* udata)
+{
+    int comp_count = (int)(intptr_t)udata;
+
+    iter_visited += entity_count;
+
+    for (int i = 0; i < entity_count; i++)
+    {
+        // Get entity ID
+        ecs_id_t id = entities[i];
+
+        v2d_t* first = ecs_get(ecs, id, IterComponents[0]);
+
+        for (int j = 1; j < comp_count; j++)
+        {
+            v2d_t* other = ecs_get(ecs, id, IterComponents[j]);
+            first->x += other->x * dt;
+            first->y += other->y * dt;
+        }
+    }
+
+    return 0;
+}
+
 /*=============================================================================
- * Benchmark functions
+ * Benchmark functions (each returns the number of operations it performed)
  *============================================================================*/
 
 // Creates entity IDs as fast as possible
-static void bench_create()
+static int bench_create()
 {
-    for (ecs_id_t i = 0; i < MAX_ENTITIES; i++)
+    for (int i = 0; i < entity_count; i++)
         ecs_create(ecs);
+
+    return entity_count;
 }
 
 // Creates entity IDs as fast as possible and immediately destroys the
 // coresponding entity
-static void bench_create_destroy()
+static int bench_create_destroy()
 {
-    for (ecs_id_t i = 0; i < MAX_ENTITIES; i++)
+    for (int i = 0; i < entity_count; i++)
         ecs_destroy(ecs, ecs_create(ecs));
+
+    return entity_count;
 }
 
-static void bench_destroy_with_two_components()
+// Destroys entities and recreates them in a fresh population, so that IDs
+// and storage are recycled in an unpredictable order
+static int bench_create_destroy_churn()
 {
-    for (ecs_id_t i = 0; i < MAX_ENTITIES; i++)
+    for (int i = 0; i < entity_count; i++)
+    {
+        ids[i] = ecs_create(ecs);
+        ecs_add(ecs, ids[i], PosComponent, NULL);
+    }
+
+    for (int i = 0; i < entity_count; i++)
+    {
+        int j = (int)(bench_rand() % (uint32_t)entity_count);
+        ecs_destroy(ecs, ids[j]);
+        ids[j] = ecs_create(ecs);
+        ecs_add(ecs, ids[j], PosComponent, NULL);
+    }
+
+    return entity_count * 2;
+}
+
+static int bench_destroy_with_two_components()
+{
+    for (int i = 0; i < entity_count; i++)
     {
-        ecs_destroy(ecs, i);
+        ecs_destroy(ecs, ids[i]);
     }
+
+    return entity_count;
 }
 
-static void bench_create_with_two_components()
+static int bench_create_with_two_components()
 {
-    for (ecs_id_t i = 0; i < MAX_ENTITIES; i++)
+    for (int i = 0; i < entity_count; i++)
     {
         // Create entity
         ecs_id_t id = ecs_create(ecs);
@@ -326,23 +657,45 @@ static void bench_create_with_two_components()
         ecs_add(ecs, id, PosComponent, NULL);
         ecs_add(ecs, id, RectComponent, NULL);
     }
+
+    return entity_count;
 }
 
-// Adds components to entities and assigns values to them
-static void bench_add_remove()
+// Adds a component and removes it again
+static int bench_add_remove()
 {
-    for (ecs_id_t i = 0; i < MAX_ENTITIES; i++)
+    for (int i = 0; i < entity_count; i++)
     {
         ecs_id_t id = ecs_create(ecs);
         ecs_add(ecs, id, PosComponent, NULL);
         ecs_remove(ecs, id, PosComponent);
     }
+
+    return entity_count;
+}
+
+// Repeatedly toggles a component on existing entities, moving them in and
+// out of systems
+static int bench_add_remove_churn()
+{
+    for (int k = 0; k < ITERATIONS; k++)
+    {
+        for (int i = 0; i < entity_count; i++)
+        {
+            if (k % 2 == 0)
+                ecs_remove(ecs, ids[i], RectComponent);
+            else
+                ecs_add(ecs, ids[i], RectComponent, NULL);
+        }
+    }
+
+    return entity_count * ITERATIONS;
 }
 
 // Adds components to entities and assigns values to them
-static void bench_add_assign()
+static int bench_add_assign()
 {
-    for (ecs_id_t i = 0; i < MAX_ENTITIES; i++)
+    for (int i = 0; i < entity_count; i++)
     {
         // Create entity
         ecs_id_t id = ecs_create(ecs);
@@ -355,37 +708,41 @@ static void bench_add_assign()
         *pos  = (v2d_t) { 1, 2 };
         *rect = (rect_t){ 1, 2, 3, 4 };
     }
+
+    return entity_count;
 }
 
-// Adds components to entities, retrieves the components, and assigns
-// values to them
-static void bench_get()
+// Retrieves a component from each entity
+static int bench_get()
 {
-    for (ecs_id_t i = 0; i < MAX_ENTITIES; i++)
+    for (int i = 0; i < entity_count; i++)
     {
-        // Create entity
-        ecs_get(ecs, i, PosComponent);
+        ecs_get(ecs, ids[i], PosComponent);
     }
+
+    return entity_count;
 }
 
-static void bench_queue_destroy()
+// Queues every entity for destruction and flushes the queue at the end of
+// the update
+static int bench_queue_destroy()
 {
-    QueueDestroySystem = ecs_register_system(ecs, queue_destroy_system, NULL, NULL, NULL);
-    ecs_require_component(ecs, QueueDestroySystem, PosComponent);
-    ecs_require_component(ecs, QueueDestroySystem, RectComponent);
-
-    for (ecs_id_t i = 0; i < MAX_ENTITIES; i++)
-    {
-        ecs_create(ecs);
-    }
-
     ecs_update_system(ecs, QueueDestroySystem, 1.0f);
+    return entity_count;
 }
 
-static void bench_three_systems()
+// Queues a component removal for every entity and flushes the queue at the
+// end of the update
+static int bench_queue_remove()
+{
+    ecs_update_system(ecs, QueueRemoveSystem, 1.0f);
+    return entity_count;
+}
+
+static int bench_three_systems()
 {
     // Create entities
-    for (ecs_id_t i = 0; i < MAX_ENTITIES; i++)
+    for (int i = 0; i < entity_count; i++)
     {
         // Create entity
         ecs_id_t id = ecs_create(ecs);
@@ -411,26 +768,94 @@ static void bench_three_systems()
     ecs_update_system(ecs, MovementSystem, 1.0f);
     ecs_update_system(ecs, ComflabSystem, 1.0f);
     ecs_update_system(ecs, BoundsSystem, 1.0f);
+
+    return entity_count;
+}
+
+// Runs the iteration system several times, an operation is one entity visit
+static int bench_iterate()
+{
+    iter_visited = 0;
+
+    for (int k = 0; k < ITERATIONS; k++)
+        ecs_update_system(ecs, IterSystem, 1.0f);
+
+    return iter_visited;
+}
+
+static int bench_iterate_1_comp()   { return bench_iterate(); }
+static int bench_iterate_4_comps()  { return bench_iterate(); }
+static int bench_iterate_16_comps() { return bench_iterate(); }
+static int bench_iterate_dense()    { return bench_iterate(); }
+static int bench_iterate_sparse()   { return bench_iterate(); }
+
+static void print_usage(const char* prog)
+{
+    fprintf(stderr, "Usage: %s [-n entity_count] [-csv]\n", prog);
 }
 
-int main()
+int main(int argc, char** argv)
 {
-    printf("===============================================================\n");
+    for (int i = 1; i < argc; i++)
+    {
+        if (0 == strcmp(argv[i], "-csv"))
+        {
+            csv = true;
+        }
+        else if (0 == strcmp(argv[i], "-n") && i + 1 < argc)
+        {
+            entity_count = atoi(argv[++i]);
+        }
+        else
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (entity_count <= 0)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
 
-    printf("Number of entities: %u\n", MAX_ENTITIES);
+    ids = malloc(entity_count * sizeof(ecs_id_t));
+
+    if (csv)
+    {
+        printf("benchmark,mode,entities,ops,ns_per_op,total_ms,peak_bytes\n");
+    }
+    else
+    {
+        printf("===============================================================================\n");
+        printf("Number of entities: %d\n", entity_count);
+        printf("-------------------------------------------------------------------------------\n");
+        printf("%-36s %10s %12s %12s %14s\n", "Benchmark", "Ops", "ns/op", "Total (ms)", "Peak (bytes)");
+        printf("-------------------------------------------------------------------------------\n");
+    }
 
     BENCH_RUN(bench_create, setup, teardown);
     BENCH_RUN(bench_create_destroy, setup, teardown);
+    BENCH_RUN(bench_create_destroy_churn, setup, teardown);
     BENCH_RUN(bench_create_with_two_components, setup, teardown);
-    BENCH_RUN(bench_destroy_with_two_components, setup_destroy_with_two_components, teardown);
+    BENCH_RUN(bench_destroy_with_two_components, setup_two_components, teardown);
     BENCH_RUN(bench_add_remove, setup, teardown);
+    BENCH_RUN(bench_add_remove_churn, setup_two_components, teardown);
     BENCH_RUN(bench_add_assign, setup, teardown);
     BENCH_RUN(bench_get, setup_get, teardown);
-    BENCH_RUN(bench_queue_destroy, setup, teardown);
+    BENCH_RUN(bench_queue_destroy, setup_queue_destroy, teardown);
+    BENCH_RUN(bench_queue_remove, setup_queue_remove, teardown);
     BENCH_RUN(bench_three_systems, setup_three_systems, teardown);
+    BENCH_RUN(bench_iterate_1_comp, setup_iter_1, teardown);
+    BENCH_RUN(bench_iterate_4_comps, setup_iter_4, teardown);
+    BENCH_RUN(bench_iterate_16_comps, setup_iter_16, teardown);
+    BENCH_RUN(bench_iterate_dense, setup_dense, teardown);
+    BENCH_RUN(bench_iterate_sparse, setup_sparse, teardown);
+
+    if (!csv)
+        printf("-------------------------------------------------------------------------------\n");
 
-    printf("---------------------------------------------------------------\n");
+    free(ids);
 
     return 0;
 }
-
@@ -189,6 +189,8 @@ int main(int argc, char *argv[])
         pgl_draw_array(ctx, PGL_TRIANGLES, vertices, 6, target_tex, shader);
         //pgl_draw_indexed(ctx, PGL_TRIANGLES, indexed_vertices, 4, indices, 6, tex, shader);
 
+        pgl_flush(ctx);
+
         SDL_GL_SwapWindow(window);
     }
 
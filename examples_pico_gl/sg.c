@@ -499,6 +499,8 @@ int main(int argc, char *argv[])
         // into [0, 1]
         node_render(sg->root_node, accumulator / FIXED_STEP);
 
+        pgl_flush(ctx);
+
         SDL_GL_SwapWindow(app->window);
     }
 
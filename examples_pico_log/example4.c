@@ -0,0 +1,45 @@
+#define PICO_LOG_IMPLEMENTATION
+#include "../pico_log.h"
+
+#include <stdio.h>
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    log_add_stream(stdout, LOG_LEVEL_INFO);
+
+    // Entries are queued instead of written. A full queue drops entries and
+    // reports how many were dropped.
+    if (!log_enable_async(LOG_OVERFLOW_COUNT))
+    {
+        printf("Asynchronous logging is not supported\n");
+        return 1;
+    }
+
+    for (int frame = 0; frame < 3; frame++)
+    {
+        log_info("Frame %d: begin", frame);
+        log_info("Frame %d: end", frame);
+
+        // Write the queued entries (e.g. once per frame or from another thread)
+        size_t count = log_flush_async();
+
+        printf("Frame %d: %zu entries written\n", frame, count);
+    }
+
+    // Overflow the queue
+    for (int i = 0; i < 1000; i++)
+    {
+        log_info("Test message: %d", i);
+    }
+
+    log_flush_async();
+
+    printf("Dropped: %lu\n", log_get_dropped_count());
+
+    log_disable_async();
+
+    return 0;
+}
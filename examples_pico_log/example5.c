@@ -0,0 +1,37 @@
+#define PICO_LOG_IMPLEMENTATION
+#include "../pico_log.h"
+
+#include <stdio.h>
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    // Rotate at 4 KiB, keeping example5.log.1 and example5.log.2
+    log_appender_t id = log_add_file("example5.log", LOG_LEVEL_INFO, 4096, 2);
+
+    if (id < 0)
+    {
+        printf("Unable to open example5.log\n");
+        return 1;
+    }
+
+    log_display_timestamp(id, true);
+
+    // These entries are buffered in memory and written in a few large writes
+    for (int i = 0; i < 200; i++)
+    {
+        log_info("Test message: %d", i);
+    }
+
+    // Errors are written immediately
+    log_error("Something went wrong");
+
+    // Removing the appender writes the remaining entries and closes the file
+    log_remove_appender(id);
+
+    printf("Wrote example5.log, example5.log.1, and example5.log.2\n");
+
+    return 0;
+}
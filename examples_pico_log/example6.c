@@ -0,0 +1,50 @@
+#define PICO_LOG_IMPLEMENTATION
+#include "../pico_log.h"
+
+#include <stdio.h>
+
+// Collects binary records in memory. A real program might append them to a
+// file and decode it offline.
+static unsigned char records[65536];
+static size_t records_size = 0;
+
+static void binary_appender(const void* data, size_t size, void* udata)
+{
+    (void)udata;
+
+    if (records_size + size <= sizeof(records))
+    {
+        memcpy(records + records_size, data, size);
+        records_size += size;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    log_set_binary_appender(binary_appender, LOG_LEVEL_TRACE, NULL);
+
+    // No text is formatted here, only the arguments are stored
+    for (int i = 0; i < 5; i++)
+    {
+        log_trace_binary("Frame %d took %.2f ms (%s)", i, 16.6 + i, "ok");
+    }
+
+    log_warn_binary("Binary log size: %zu bytes", records_size);
+
+    printf("Binary log size: %zu bytes\n", records_size);
+
+    // Turn the records back into text
+    log_appender_t id = log_add_stream(stdout, LOG_LEVEL_TRACE);
+
+    log_display_timestamp(id, true);
+    log_display_function(id, true);
+
+    size_t count = log_decode_binary(records, records_size);
+
+    printf("Decoded %zu entries\n", count);
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+// Benchmarks are timed with the cycle counter of pico_time when it is included
+// before the implementation of pico_unit
+#define PICO_TIME_IMPLEMENTATION
+#include "../pico_time.h"
+
+#define PICO_UNIT_IMPLEMENTATION
+#include "../pico_unit.h"
+
+#include <stdint.h>
+
+#define ARRAY_SIZE 1024
+
+static uint32_t g_array[ARRAY_SIZE];
+
+static void
+bench_setup ()
+{
+    for (int i = 0; i < ARRAY_SIZE; i++)
+    {
+        g_array[i] = (uint32_t)(i * 2654435761u);
+    }
+}
+
+/* Measures a loop over an array. */
+BENCH_CASE(bench_sum)
+{
+    for (size_t i = 0; i < iterations; i++)
+    {
+        uint32_t sum = 0;
+
+        for (int j = 0; j < ARRAY_SIZE; j++)
+        {
+            sum += g_array[j];
+        }
+
+        PU_DO_NOT_OPTIMIZE(sum);
+    }
+}
+
+/* Measures a single multiplication. */
+BENCH_CASE(bench_hash)
+{
+    uint32_t value = 1;
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        value = value * 2654435761u + 1;
+        PU_DO_NOT_OPTIMIZE(value);
+    }
+}
+
+/* Measures writing to memory. */
+BENCH_CASE(bench_memset)
+{
+    for (size_t i = 0; i < iterations; i++)
+    {
+        memset(g_array, (int)i, sizeof(g_array));
+        PU_DO_NOT_OPTIMIZE(g_array);
+    }
+}
+
+/* Tests and benchmarks can be run by the same program. */
+TEST_CASE(test_setup)
+{
+    REQUIRE(g_array[1] == 2654435761u);
+    return true;
+}
+
+int
+main ()
+{
+    pu_display_colors(true);
+
+    bench_setup();
+
+    RUN_TEST_CASE(test_setup);
+
+    // Results are also written to a file for regression tracking
+    pu_bench_output("example3.csv", PU_BENCH_CSV);
+
+    RUN_BENCH_CASE(bench_sum);
+    RUN_BENCH_CASE(bench_hash);
+    RUN_BENCH_CASE(bench_memset);
+
+    pu_bench_output(NULL, PU_BENCH_CSV);
+
+    pu_print_stats();
+
+    return pu_test_failed();
+}
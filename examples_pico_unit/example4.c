@@ -0,0 +1,90 @@
+// Required to run tests in parallel
+#define PICO_UNIT_PARALLEL
+
+#define PICO_UNIT_IMPLEMENTATION
+#include "../pico_unit.h"
+
+#include <signal.h>
+
+/* Takes a while, so that tests visibly run concurrently. */
+static bool slow_sum(unsigned n, unsigned long long expected)
+{
+    unsigned long long sum = 0;
+
+    for (unsigned j = 0; j < 200; j++)
+    {
+        sum = 0;
+
+        for (unsigned i = 1; i <= n; i++)
+        {
+            sum += i;
+        }
+    }
+
+    return sum == expected;
+}
+
+TEST_CASE(test_sum1)
+{
+    REQUIRE(slow_sum(1000000, 500000500000ULL));
+    return true;
+}
+
+TEST_CASE(test_sum2)
+{
+    REQUIRE(slow_sum(2000000, 2000001000000ULL));
+    return true;
+}
+
+TEST_CASE(test_sum3)
+{
+    REQUIRE(slow_sum(3000000, 4500001500000ULL));
+    return true;
+}
+
+/* This test fails. */
+TEST_CASE(test_failing)
+{
+    REQUIRE(slow_sum(1000, 0));
+    return true;
+}
+
+/* This test crashes, which is only survivable when tests are isolated. */
+TEST_CASE(test_crashing)
+{
+    raise(SIGSEGV);
+    return true;
+}
+
+static TEST_SUITE(suite_sums)
+{
+    RUN_TEST_CASE(test_sum1);
+    RUN_TEST_CASE(test_sum2);
+    RUN_TEST_CASE(test_sum3);
+}
+
+int
+main ()
+{
+    pu_display_colors(true);
+
+    // Tests are queued and run by as many threads as there are CPUs
+    pu_begin_parallel(0, false);
+
+    RUN_TEST_SUITE(suite_sums);
+    RUN_TEST_CASE(test_failing);
+
+    pu_end_parallel();
+
+    // Each test runs in its own process, so a crash is reported as a failure
+    pu_begin_parallel(0, true);
+
+    RUN_TEST_SUITE(suite_sums);
+    RUN_TEST_CASE(test_crashing);
+
+    pu_end_parallel();
+
+    pu_print_stats();
+
+    return 0;
+}
@@ -12,6 +12,9 @@
     - Single header library for easy build system integration
     - No dyanmic memory allocation
     - Simple and concise API
+    - SSSE3, AVX2, and NEON (AArch64) acceleration
+    - Streaming interface for chunked input
+    - Validating decoder with support for the URL-safe alphabet
     - Permissive license (MIT)
 
     Summary:
@@ -40,11 +43,27 @@
     > #include "pico_b64.h"
 
     to a source file (once), then simply include the header normally.
+
+    Data that does not fit in memory at once can be processed in chunks with
+    `b64_encode_init`/`b64_encode_update`/`b64_encode_final` (and their decode
+    counterparts). The state carries incomplete groups from one chunk to the
+    next, so chunks may have any size and the output is the same as that of
+    a single call on the whole input.
+
+    `b64_decode_checked` decodes and validates untrusted input in a single
+    pass. It reports the offset of the first invalid character, and accepts
+    either the standard alphabet or the URL-safe one ('-' and '_' in place of
+    '+' and '/'), with or without padding.
+
+    Vectorized code is used when the compiler targets SSSE3, AVX2, or AArch64
+    NEON (e.g. with -mssse3, -mavx2, or -march=native). Define
+    PICO_B64_NO_SIMD before the implementation to use the scalar code only.
 */
 
 #ifndef PICO_B64_H
 #define PICO_B64_H
 
+#include <stdbool.h>
 #include <stddef.h>
 
 #ifdef __cplusplus
@@ -91,6 +110,122 @@ size_t b64_encode(char* dst, const unsigned char* src, size_t len);
  */
 size_t b64_decode(unsigned char* dst, const char* src, size_t len);
 
+/**
+ * @brief Incremental encoding state
+ */
+typedef struct
+{
+    unsigned char tmp[3]; //!< Bytes of an incomplete group
+    int len;              //!< Number of bytes in `tmp`
+} b64_encode_state_t;
+
+/**
+ * @brief Incremental decoding state
+ */
+typedef struct
+{
+    unsigned char tmp[4]; //!< Values of an incomplete group
+    int len;              //!< Number of values in `tmp`
+    bool stopped;         //!< True once padding or an invalid character was
+                          //!< found. Any further input is ignored.
+} b64_decode_state_t;
+
+/**
+ * @brief Initializes an incremental encoding
+ */
+void b64_encode_init(b64_encode_state_t* state);
+
+/**
+ * @brief Encodes a chunk of bytes
+ *
+ * @param state The encoding state
+ * @param dst   Encoded character buffer. Must have room for
+ *              `4 * ((len + 2) / 3)` characters.
+ * @param src   Byte array to be encoded
+ * @param len   Length of `src` in bytes
+ * @returns     Number of encoded characters
+ */
+size_t b64_encode_update(b64_encode_state_t* state,
+                         char* dst,
+                         const unsigned char* src,
+                         size_t len);
+
+/**
+ * @brief Encodes the last incomplete group, adding padding
+ *
+ * @param state The encoding state (reinitialized afterwards)
+ * @param dst   Encoded character buffer with room for 4 characters
+ * @returns     Number of encoded characters
+ */
+size_t b64_encode_final(b64_encode_state_t* state, char* dst);
+
+/**
+ * @brief Initializes an incremental decoding
+ */
+void b64_decode_init(b64_decode_state_t* state);
+
+/**
+ * @brief Decodes a chunk of characters
+ *
+ * @param state The decoding state
+ * @param dst   Decoded byte array. Must have room for `3 * ((len + 3) / 4)`
+ *              bytes.
+ * @param src   Character array to be decoded
+ * @param len   Length of `src` in bytes
+ * @returns     Number of decoded bytes
+ */
+size_t b64_decode_update(b64_decode_state_t* state,
+                         unsigned char* dst,
+                         const char* src,
+                         size_t len);
+
+/**
+ * @brief Decodes the last incomplete group
+ *
+ * @param state The decoding state (reinitialized afterwards)
+ * @param dst   Decoded byte array with room for 2 bytes
+ * @returns     Number of decoded bytes
+ */
+size_t b64_decode_final(b64_decode_state_t* state, unsigned char* dst);
+
+/**
+ * @brief Base64 alphabets
+ */
+typedef enum
+{
+    B64_STANDARD, //!< RFC 4648 section 4 ('+' and '/')
+    B64_URL       //!< RFC 4648 section 5 ('-' and '_')
+} b64_alphabet_t;
+
+/**
+ * @brief Value of the error offset when the input is valid
+ */
+#define B64_NO_ERROR ((size_t)-1)
+
+/**
+ * @brief Decodes and validates a Base64 encoded string in a single pass
+ *
+ * The input is valid if it consists of characters from the alphabet, and
+ * either ends with a group of two or more characters or is padded to a
+ * multiple of four with '='. Nothing may follow the padding.
+ *
+ * @param dst      Decoded byte array. Must have room for `3 * ((len + 3) / 4)`
+ *                 bytes.
+ * @param src      Character array to be decoded
+ * @param len      Length of `src` in bytes
+ * @param alphabet The alphabet of `src`
+ * @param error    Set to the offset of the first invalid character, `len` if
+ *                 the input ends prematurely, or B64_NO_ERROR if the input is
+ *                 valid. May be NULL.
+ * @returns        Number of decoded bytes. If the input is invalid, only the
+ *                 complete groups before the error are decoded.
+ */
+size_t b64_decode_checked(unsigned char* dst,
+                          const char* src,
+                          size_t len,
+                          b64_alphabet_t alphabet,
+                          size_t* error);
+
 #ifdef __cplusplus
 }
 #endif
@@ -99,10 +234,11 @@ size_t b64_decode(unsigned char* dst, const char* src, size_t len);
 
 #ifdef PICO_B64_IMPLEMENTATION
 
-#include <ctype.h>
 #include <math.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 /*=============================================================================
  * Look-up table
@@ -148,6 +284,80 @@ size_t b64_decoded_size(const char* src, size_t len)
     return floor(3.0 * (len - padding) / 4.0);
 }
 
+/*=============================================================================
+ * SIMD selection
+ *============================================================================*/
+
+/*
+ * Vectorized kernels are selected at compile time from the instruction sets
+ * the compiler targets (e.g. -mssse3, -mavx2, or -march=native). They handle
+ * the bulk of the input and leave the remainder to the scalar code, which
+ * also takes over as soon as a block contains a character that is not part
+ * of the alphabet, so that output and error behavior are identical.
+ */
+
+#ifndef PICO_B64_NO_SIMD
+    #if defined(__AVX2__)
+        #define B64_AVX2
+        #include <immintrin.h>
+    #endif
+
+    #if defined(__SSSE3__) || defined(B64_AVX2)
+        #define B64_SSSE3
+        #include <tmmintrin.h>
+    #endif
+
+    #if defined(__aarch64__) && defined(__ARM_NEON)
+        #define B64_NEON
+        #include <arm_neon.h>
+    #endif
+#endif
+
+/*=============================================================================
+ * Decoding table (0xFF marks characters outside of the alphabet)
+ *============================================================================*/
+
+static const unsigned char b64_decode_table[256] =
+{
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,   62, 0xFF, 0xFF, 0xFF,   63,
+      52,   53,   54,   55,   56,   57,   58,   59,   60,   61, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF,    0,    1,    2,    3,    4,    5,    6,    7,    8,    9,   10,   11,   12,   13,   14,
+      15,   16,   17,   18,   19,   20,   21,   22,   23,   24,   25, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF,   26,   27,   28,   29,   30,   31,   32,   33,   34,   35,   36,   37,   38,   39,   40,
+      41,   42,   43,   44,   45,   46,   47,   48,   49,   50,   51, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+// Same as the above, but for the URL-safe alphabet
+static const unsigned char b64_decode_url_table[256] =
+{
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,   62, 0xFF, 0xFF,
+      52,   53,   54,   55,   56,   57,   58,   59,   60,   61, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF,    0,    1,    2,    3,    4,    5,    6,    7,    8,    9,   10,   11,   12,   13,   14,
+      15,   16,   17,   18,   19,   20,   21,   22,   23,   24,   25, 0xFF, 0xFF, 0xFF, 0xFF,   63,
+    0xFF,   26,   27,   28,   29,   30,   31,   32,   33,   34,   35,   36,   37,   38,   39,   40,
+      41,   42,   43,   44,   45,   46,   47,   48,   49,   50,   51, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
 /*=============================================================================
  * Buffer encoding/decoding functions
  *============================================================================*/
@@ -166,40 +376,425 @@ static inline void b64_decode_tmp(unsigned char* buf, unsigned char* tmp)
     buf[2] = ((tmp[2] & 0x3) << 6) + tmp[3];
 }
 
+/*=============================================================================
+ * SSSE3/AVX2 kernels
+ *
+ * These follow the pshufb based algorithms by Wojciech Muła and Daniel Lemire.
+ * Encoding spreads each 3 bytes over 4 bytes, extracts the 6-bit indices with
+ * multiplies, and translates indices to characters by adding per-range
+ * offsets looked up with pshufb. Decoding classifies characters by their
+ * nibbles to validate them and find their offsets, then packs the 6-bit
+ * values back together with multiply-adds.
+ *============================================================================*/
+
+#ifdef B64_SSSE3
+
+static inline __m128i b64_enc_reshuffle_sse(__m128i in)
+{
+    in = _mm_shuffle_epi8(in, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4,
+                                            7, 6, 8, 7, 10, 9, 11, 10));
+
+    __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+
+    return _mm_or_si128(t1, t3);
+}
+
+static inline __m128i b64_enc_translate_sse(__m128i in)
+{
+    const __m128i lut = _mm_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4,
+                                      -4, -4, -4, -4, -19, -16, 0, 0);
+
+    __m128i indices = _mm_subs_epu8(in, _mm_set1_epi8(51));
+    __m128i mask    = _mm_cmpgt_epi8(in, _mm_set1_epi8(25));
+
+    indices = _mm_sub_epi8(indices, mask);
+
+    return _mm_add_epi8(in, _mm_shuffle_epi8(lut, indices));
+}
+
+// Returns the number of bytes encoded (a multiple of 12)
+static size_t b64_encode_sse(char* dst, const unsigned char* src, size_t len)
+{
+    size_t count = 0;
+
+    // Each step reads 16 bytes, of which 12 are encoded
+    while (len - count >= 16)
+    {
+        __m128i in = _mm_loadu_si128((const __m128i*)(src + count));
+
+        in = b64_enc_translate_sse(b64_enc_reshuffle_sse(in));
+
+        _mm_storeu_si128((__m128i*)(dst + count / 3 * 4), in);
+
+        count += 12;
+    }
+
+    return count;
+}
+
+// Converts 16 characters to 6-bit values. Returns false if any character is
+// not part of the alphabet
+static inline bool b64_dec_translate_sse(__m128i* str)
+{
+    const __m128i lut_lo   = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                           0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lut_hi   = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                           0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+                                           0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask_2f  = _mm_set1_epi8(0x2f);
+
+    __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(*str, 4), mask_2f);
+    __m128i lo_nibbles = _mm_and_si128(*str, mask_2f);
+    __m128i hi         = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+    __m128i lo         = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+
+    __m128i invalid = _mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128());
+
+    if (0xFFFF != _mm_movemask_epi8(invalid))
+        return false;
+
+    __m128i eq_2f = _mm_cmpeq_epi8(*str, mask_2f);
+    __m128i roll  = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles));
+
+    *str = _mm_add_epi8(*str, roll);
+
+    return true;
+}
+
+// Packs 16 6-bit values into 12 bytes at the start of the register
+static inline __m128i b64_dec_reshuffle_sse(__m128i in)
+{
+    __m128i merged = _mm_maddubs_epi16(in, _mm_set1_epi32(0x01400140));
+    __m128i out    = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+
+    return _mm_shuffle_epi8(out, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9,
+                                               8, 14, 13, 12, -1, -1, -1, -1));
+}
+
+// Stores the first 12 bytes of a register without writing past them
+static inline void b64_store12_sse(unsigned char* dst, __m128i in)
+{
+    int tail = _mm_cvtsi128_si32(_mm_srli_si128(in, 8));
+
+    _mm_storel_epi64((__m128i*)dst, in);
+    memcpy(dst + 8, &tail, sizeof(tail));
+}
+
+// Returns the number of characters decoded (a multiple of 16)
+static size_t b64_decode_sse(unsigned char* dst, const char* src, size_t len)
+{
+    size_t count = 0;
+
+    while (len - count >= 16)
+    {
+        __m128i str = _mm_loadu_si128((const __m128i*)(src + count));
+
+        if (!b64_dec_translate_sse(&str))
+            break;
+
+        b64_store12_sse(dst + count / 4 * 3, b64_dec_reshuffle_sse(str));
+
+        count += 16;
+    }
+
+    return count;
+}
+
+#endif // B64_SSSE3
+
+#ifdef B64_AVX2
+
+// Returns the number of bytes encoded (a multiple of 24)
+static size_t b64_encode_avx2(char* dst, const unsigned char* src, size_t len)
+{
+    const __m256i shuffle = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                                             1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m256i lut     = _mm256_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0,
+                                             65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+
+    size_t count = 0;
+
+    // Each lane encodes 12 bytes from a 16 byte load, so the second load reads
+    // 4 bytes past the 24 that are encoded
+    while (len - count >= 28)
+    {
+        __m128i lo = _mm_loadu_si128((const __m128i*)(src + count));
+        __m128i hi = _mm_loadu_si128((const __m128i*)(src + count + 12));
+
+        __m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+
+        in = _mm256_shuffle_epi8(in, shuffle);
+
+        __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+        __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+        __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+
+        in = _mm256_or_si256(t1, t3);
+
+        __m256i indices = _mm256_subs_epu8(in, _mm256_set1_epi8(51));
+        __m256i mask    = _mm256_cmpgt_epi8(in, _mm256_set1_epi8(25));
+
+        indices = _mm256_sub_epi8(indices, mask);
+        in = _mm256_add_epi8(in, _mm256_shuffle_epi8(lut, indices));
+
+        _mm256_storeu_si256((__m256i*)(dst + count / 3 * 4), in);
+
+        count += 24;
+    }
+
+    return count;
+}
+
+// Returns the number of characters decoded (a multiple of 32)
+static size_t b64_decode_avx2(unsigned char* dst, const char* src, size_t len)
+{
+    const __m256i lut_lo   = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                              0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+                                              0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                              0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m256i lut_hi   = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                              0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                              0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                              0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lut_roll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+                                              0, 0, 0, 0, 0, 0, 0, 0,
+                                              0, 16, 19, 4, -65, -65, -71, -71,
+                                              0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i shuffle  = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                              2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m256i mask_2f  = _mm256_set1_epi8(0x2f);
+
+    size_t count = 0;
+
+    while (len - count >= 32)
+    {
+        __m256i str = _mm256_loadu_si256((const __m256i*)(src + count));
+
+        __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4), mask_2f);
+        __m256i lo_nibbles = _mm256_and_si256(str, mask_2f);
+        __m256i hi         = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+        __m256i lo         = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+
+        __m256i valid = _mm256_cmpeq_epi8(_mm256_and_si256(lo, hi), _mm256_setzero_si256());
+
+        if (-1 != _mm256_movemask_epi8(valid))
+            break;
+
+        __m256i eq_2f = _mm256_cmpeq_epi8(str, mask_2f);
+        __m256i roll  = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+
+        str = _mm256_add_epi8(str, roll);
+
+        __m256i merged = _mm256_maddubs_epi16(str, _mm256_set1_epi32(0x01400140));
+        __m256i out    = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+
+        out = _mm256_shuffle_epi8(out, shuffle);
+
+        unsigned char* ptr = dst + count / 4 * 3;
+
+        b64_store12_sse(ptr,      _mm256_castsi256_si128(out));
+        b64_store12_sse(ptr + 12, _mm256_extracti128_si256(out, 1));
+
+        count += 32;
+    }
+
+    return count;
+}
+
+#endif // B64_AVX2
+
+/*=============================================================================
+ * NEON kernels (AArch64)
+ *
+ * Loads deinterleave 3 byte groups (or 4 character groups) into separate
+ * registers, so that the bit manipulation is plain shifts and the character
+ * translation is a lookup in a 64 (or 128) byte table.
+ *============================================================================*/
+
+#ifdef B64_NEON
+
+static inline uint8x16x4_t b64_load_table_neon(const unsigned char* table)
+{
+    uint8x16x4_t result;
+
+    result.val[0] = vld1q_u8(table);
+    result.val[1] = vld1q_u8(table + 16);
+    result.val[2] = vld1q_u8(table + 32);
+    result.val[3] = vld1q_u8(table + 48);
+
+    return result;
+}
+
+// Returns the number of bytes encoded (a multiple of 48)
+static size_t b64_encode_neon(char* dst, const unsigned char* src, size_t len)
+{
+    const uint8x16x4_t table = b64_load_table_neon((const unsigned char*)b64_table);
+    const uint8x16_t   mask  = vdupq_n_u8(0x3F);
+
+    size_t count = 0;
+
+    while (len - count >= 48)
+    {
+        uint8x16x3_t in = vld3q_u8(src + count);
+        uint8x16x4_t out;
+
+        out.val[0] = vshrq_n_u8(in.val[0], 2);
+        out.val[1] = vandq_u8(vorrq_u8(vshrq_n_u8(in.val[1], 4), vshlq_n_u8(in.val[0], 4)), mask);
+        out.val[2] = vandq_u8(vorrq_u8(vshrq_n_u8(in.val[2], 6), vshlq_n_u8(in.val[1], 2)), mask);
+        out.val[3] = vandq_u8(in.val[2], mask);
+
+        out.val[0] = vqtbl4q_u8(table, out.val[0]);
+        out.val[1] = vqtbl4q_u8(table, out.val[1]);
+        out.val[2] = vqtbl4q_u8(table, out.val[2]);
+        out.val[3] = vqtbl4q_u8(table, out.val[3]);
+
+        vst4q_u8((uint8_t*)(dst + count / 3 * 4), out);
+
+        count += 48;
+    }
+
+    return count;
+}
+
+// Returns the number of characters decoded (a multiple of 64)
+static size_t b64_decode_neon(unsigned char* dst, const char* src, size_t len)
+{
+    const uint8x16x4_t table_lo = b64_load_table_neon(b64_decode_table);
+    const uint8x16x4_t table_hi = b64_load_table_neon(b64_decode_table + 64);
+    const uint8x16_t   offset   = vdupq_n_u8(64);
+
+    size_t count = 0;
+
+    while (len - count >= 64)
+    {
+        uint8x16x4_t in = vld4q_u8((const uint8_t*)(src + count));
+        uint8x16_t error = vdupq_n_u8(0);
+
+        // Characters above 127 are out of range of both tables (giving 0), so
+        // their high bit is checked along with the 0xFF sentinel
+        for (int i = 0; i < 4; i++)
+        {
+            uint8x16_t value = vorrq_u8(vqtbl4q_u8(table_lo, in.val[i]),
+                                        vqtbl4q_u8(table_hi, vsubq_u8(in.val[i], offset)));
+
+            error     = vorrq_u8(error, vorrq_u8(value, in.val[i]));
+            in.val[i] = value;
+        }
+
+        if (vmaxvq_u8(error) & 0x80)
+            break;
+
+        uint8x16x3_t out;
+
+        out.val[0] = vorrq_u8(vshlq_n_u8(in.val[0], 2), vshrq_n_u8(in.val[1], 4));
+        out.val[1] = vorrq_u8(vshlq_n_u8(in.val[1], 4), vshrq_n_u8(in.val[2], 2));
+        out.val[2] = vorrq_u8(vshlq_n_u8(in.val[2], 6), in.val[3]);
+
+        vst3q_u8(dst + count / 4 * 3, out);
+
+        count += 64;
+    }
+
+    return count;
+}
+
+#endif // B64_NEON
+
 /*=============================================================================
  * Encoding
  *============================================================================*/
 
-size_t b64_encode(char* dst, const unsigned char* src, size_t len)
+// Encodes whole groups of 3 bytes (len must be a multiple of 3)
+static size_t b64_encode_groups(char* dst, const unsigned char* src, size_t len)
 {
-    int i = 0;
-    int j = 0;
     size_t size = 0;
-    unsigned char buf[4];
-    unsigned char tmp[3];
 
-    // Parse until end of source
-    while (len--)
+    // Encode the bulk of the input with the vector kernels
+    size_t count = 0;
+
+#if defined(B64_AVX2)
+    count += b64_encode_avx2(dst, src, len);
+#endif
+
+#if defined(B64_SSSE3)
+    count += b64_encode_sse(dst + count / 3 * 4, src + count, len - count);
+#elif defined(B64_NEON)
+    count += b64_encode_neon(dst, src, len);
+#endif
+
+    src  += count;
+    len  -= count;
+    size += count / 3 * 4;
+
+    // Encode 3 bytes at a time
+    while (len >= 3)
     {
-        // Read up to 3 bytes at a time into 'tmp'
-        tmp[i++] = *(src++);
+        dst[size++] = b64_table[src[0] >> 2];
+        dst[size++] = b64_table[((src[0] & 0x03) << 4) | (src[1] >> 4)];
+        dst[size++] = b64_table[((src[1] & 0x0f) << 2) | (src[2] >> 6)];
+        dst[size++] = b64_table[src[2] & 0x3f];
 
-        // If 3 bytes read then encode them
-        if (3 == i)
-        {
-            b64_encode_tmp(buf, tmp);
+        src += 3;
+        len -= 3;
+    }
+
+    return size;
+}
+
+void b64_encode_init(b64_encode_state_t* state)
+{
+    state->len = 0;
+}
 
-            // Translate buffer
-            for (i = 0; i < 4; ++i)
-            {
-                dst[size++] = b64_table[buf[i]];
-            }
+size_t b64_encode_update(b64_encode_state_t* state,
+                         char* dst,
+                         const unsigned char* src,
+                         size_t len)
+{
+    size_t size = 0;
 
-            // reset index
-            i = 0;
+    // Complete the group left over by the previous chunk
+    if (state->len > 0)
+    {
+        while (state->len < 3 && len > 0)
+        {
+            state->tmp[state->len++] = *(src++);
+            len--;
+        }
+
+        if (3 == state->len)
+        {
+            size += b64_encode_groups(dst, state->tmp, 3);
+            state->len = 0;
         }
     }
 
+    size_t count = len - len % 3;
+
+    size += b64_encode_groups(dst + size, src, count);
+
+    // Keep the rest for the next chunk
+    while (count < len)
+    {
+        state->tmp[state->len++] = src[count++];
+    }
+
+    return size;
+}
+
+size_t b64_encode_final(b64_encode_state_t* state, char* dst)
+{
+    int i = state->len;
+    int j = 0;
+    size_t size = 0;
+    unsigned char buf[4];
+    unsigned char* tmp = state->tmp;
+
     // Remainder
     if (i > 0)
     {
@@ -225,84 +820,159 @@ size_t b64_encode(char* dst, const unsigned char* src, size_t len)
         }
     }
 
+    b64_encode_init(state);
+
     return size;
 }
 
+size_t b64_encode(char* dst, const unsigned char* src, size_t len)
+{
+    b64_encode_state_t state;
+
+    b64_encode_init(&state);
+
+    size_t size = b64_encode_update(&state, dst, src, len);
+
+    return size + b64_encode_final(&state, dst + size);
+}
+
 /*=============================================================================
  * Decoding
  *============================================================================*/
 
-static inline size_t b64_table_lookup(char symbol)
+// Decodes whole groups of 4 valid characters using the given table. Returns
+// the number of characters decoded, which stops short of the first group
+// containing padding or an invalid character.
+static size_t b64_decode_groups_table(unsigned char* dst,
+                                      const char* src,
+                                      size_t len,
+                                      const unsigned char* table)
 {
-    size_t i;
+    size_t count = 0;
 
-    for (i = 0; i < 64; ++i)
+    // Branchless within a group, the sentinel sets the high bit of the union
+    while (len - count >= 4)
     {
-        if (symbol == b64_table[i])
-            return i;
+        unsigned a = table[(unsigned char)src[count + 0]];
+        unsigned b = table[(unsigned char)src[count + 1]];
+        unsigned c = table[(unsigned char)src[count + 2]];
+        unsigned d = table[(unsigned char)src[count + 3]];
+
+        if ((a | b | c | d) & 0x80)
+            break;
+
+        *(dst++) = (unsigned char)((a << 2) | (b >> 4));
+        *(dst++) = (unsigned char)((b << 4) | (c >> 2));
+        *(dst++) = (unsigned char)((c << 6) | d);
+
+        count += 4;
+    }
+
+    return count;
+}
+
+// Same as the above for the standard alphabet, with the vector kernels
+static size_t b64_decode_groups(unsigned char* dst, const char* src, size_t len)
+{
+    // Decode the bulk of the input with the vector kernels
+    size_t count = 0;
+
+#if defined(B64_AVX2)
+    count += b64_decode_avx2(dst, src, len);
+#endif
+
+#if defined(B64_SSSE3)
+    count += b64_decode_sse(dst + count / 4 * 3, src + count, len - count);
+#elif defined(B64_NEON)
+    count += b64_decode_neon(dst, src, len);
+#endif
+
+    // Decode 4 characters at a time while they are all valid
+    count += b64_decode_groups_table(dst + count / 4 * 3, src + count,
+                                     len - count, b64_decode_table);
+
+    return count;
+}
+
+// Adds one character to the current group. Returns the number of decoded
+// bytes (3 when the group is complete)
+static inline size_t b64_decode_char(b64_decode_state_t* state,
+                                     unsigned char* dst,
+                                     char symbol)
+{
+    unsigned char value = b64_decode_table[(unsigned char)symbol];
+
+    // Stop if char is padding ('=') or not base64
+    if (0xFF == value)
+    {
+        state->stopped = true;
+        return 0;
+    }
+
+    state->tmp[state->len++] = value;
+
+    if (4 == state->len)
+    {
+        b64_decode_tmp(dst, state->tmp);
+        state->len = 0;
+        return 3;
     }
 
     return 0;
 }
 
-size_t b64_decode(unsigned char* dst, const char * src, size_t len)
+void b64_decode_init(b64_decode_state_t* state)
+{
+    state->len = 0;
+    state->stopped = false;
+}
+
+size_t b64_decode_update(b64_decode_state_t* state,
+                         unsigned char* dst,
+                         const char* src,
+                         size_t len)
 {
-    int i = 0;
-    int j = 0;
     size_t size = 0;
-    unsigned char buf[3];
-    unsigned char tmp[4];
+    size_t pos = 0;
 
-    // Parse until end of source
-    while (len--) {
-        // Break if char is padding ('=') or not base64 char
-        if ('=' == src[j])
-            break;
+    // Complete the group left over by the previous chunk
+    while (!state->stopped && state->len > 0 && pos < len)
+    {
+        size += b64_decode_char(state, dst + size, src[pos++]);
+    }
 
-        // Break if char is not base64
-        if (!isalnum((int)src[j]) && '+' != src[j] && '/' != src[j])
-            break;
+    if (state->stopped)
+        return size;
 
-        // Read up to 4 bytes at a time into 'tmp'
-        tmp[i++] = src[j++];
+    size_t count = b64_decode_groups(dst + size, src + pos, len - pos);
 
-        // If 4 bytes read then decode into 'buf'
-        if (4 == i)
-        {
-            // Translate values in 'tmp' from table
-            for (i = 0; i < 4; ++i)
-            {
-                tmp[i] = b64_table_lookup(tmp[i]);
-            }
-
-            // Decode transform
-            b64_decode_tmp(buf, tmp);
-
-            // Write into result
-            for (i = 0; i < 3; ++i)
-            {
-                dst[size++] = buf[i];
-            }
-
-            // Reset
-            i = 0;
-        }
+    size += count / 4 * 3;
+    pos  += count;
+
+    // The rest is either an incomplete group or contains the end of the data
+    while (!state->stopped && pos < len)
+    {
+        size += b64_decode_char(state, dst + size, src[pos++]);
     }
 
+    return size;
+}
+
+size_t b64_decode_final(b64_decode_state_t* state, unsigned char* dst)
+{
+    int i = state->len;
+    int j = 0;
+    size_t size = 0;
+    unsigned char buf[3];
+    unsigned char* tmp = state->tmp;
+
     // Remainder
     if (i > 0)
     {
-        // Fill 'tmp' with '\0' at most 3 times
+        // Fill 'tmp' with 0 at most 3 times
         for (j = i; j < 4; ++j)
         {
-            tmp[j] = '\0';
-        }
-
-        // Translate remainder
-        for (j = 0; j < 4; ++j)
-        {
-            // find translation char in 'b64_table'
-            tmp[j] = b64_table_lookup(tmp[j]);
+            tmp[j] = 0;
         }
 
         // Decode transform
@@ -315,6 +985,96 @@ size_t b64_decode(unsigned char* dst, const char * src, size_t len)
         }
     }
 
+    b64_decode_init(state);
+
+    return size;
+}
+
+size_t b64_decode(unsigned char* dst, const char * src, size_t len)
+{
+    b64_decode_state_t state;
+
+    b64_decode_init(&state);
+
+    size_t size = b64_decode_update(&state, dst, src, len);
+
+    return size + b64_decode_final(&state, dst + size);
+}
+
+/*=============================================================================
+ * Validated decoding
+ *============================================================================*/
+
+size_t b64_decode_checked(unsigned char* dst,
+                          const char* src,
+                          size_t len,
+                          b64_alphabet_t alphabet,
+                          size_t* error)
+{
+    const unsigned char* table = b64_decode_table;
+    size_t pos;
+
+    if (B64_URL == alphabet)
+    {
+        table = b64_decode_url_table;
+        pos = b64_decode_groups_table(dst, src, len, table);
+    }
+    else
+    {
+        pos = b64_decode_groups(dst, src, len);
+    }
+
+    size_t size = pos / 4 * 3;
+    size_t error_pos = B64_NO_ERROR;
+
+    // What remains is either an incomplete final group or a group with an
+    // invalid character (so there are at most 3 valid characters)
+    unsigned char tmp[4] = { 0, 0, 0, 0 };
+    int n = 0;
+
+    while (pos < len && n < 3 && 0xFF != table[(unsigned char)src[pos]])
+    {
+        tmp[n++] = table[(unsigned char)src[pos++]];
+    }
+
+    if (pos == len)
+    {
+        // A single character does not encode a complete byte
+        if (1 == n)
+            error_pos = pos - 1;
+    }
+    else if ('=' != src[pos] || n < 2)
+    {
+        error_pos = pos;
+    }
+    else
+    {
+        // The final group must be padded to four characters
+        for (int i = n; i < 4 && B64_NO_ERROR == error_pos; i++, pos++)
+        {
+            if (pos == len || '=' != src[pos])
+                error_pos = pos;
+        }
+
+        if (B64_NO_ERROR == error_pos && pos != len)
+            error_pos = pos;
+    }
+
+    if (B64_NO_ERROR == error_pos && n > 0)
+    {
+        unsigned char buf[3];
+
+        b64_decode_tmp(buf, tmp);
+
+        for (int i = 0; i < n - 1; i++)
+        {
+            dst[size++] = buf[i];
+        }
+    }
+
+    if (error)
+        *error = error_pos;
+
     return size;
 }
 
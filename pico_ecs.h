@@ -64,9 +64,114 @@
 
     - PICO_ECS_MAX_COMPONENTS (default: 32)
     - PICO_ECS_MAX_SYSTEMS (default: 16)
+    - PICO_ECS_CHUNK_SIZE (default: 256)
 
     Must be defined before PICO_ECS_IMPLEMENTATION
 
+    Reserved storage:
+    -----------------
+
+    By default the entity array and component arrays grow on demand, which
+    reallocates (and copies) them as entity IDs increase. `ecs_new_reserved`
+    instead allocates storage for a fixed maximum number of entities up front.
+    Growth within the reservation then only initializes the new entities, so
+    arrays are never copied and pointers returned by `ecs_get` remain valid
+    until the component is removed. Creating more than the reserved number of
+    entities is an error.
+
+    Only the entries in use are written to, so on platforms that back large
+    allocations with virtual memory, physical pages are committed as the
+    entity count grows. Supplying an arena through the custom allocator hooks
+    also works well in this mode, since every reservation is made once.
+
+    Pointer stability applies to components with the default indexed storage.
+    Packed components and archetype chunks still move when entities leave
+    them.
+
+    Archetypes:
+    -----------
+
+    Defining PICO_ECS_ARCHETYPES (before including the header) switches to an
+    alternative storage backend. Entities are grouped by the set of components
+    they have (their archetype) into chunks of PICO_ECS_CHUNK_SIZE entities.
+    Each chunk stores its components as contiguous columns, which can be
+    iterated directly by systems registered with `ecs_register_chunk_system`.
+
+    In this mode, adding or removing a component moves the entity to another
+    archetype. This invalidates pointers to all of the entity's components and
+    also pointers to the components of the entity that fills the vacated slot.
+
+    Parallel updates:
+    -----------------
+
+    `ecs_update_systems_parallel` runs systems that do not access the same
+    components concurrently. Systems declare how they access components with
+    `ecs_require_component_access` and `ecs_declare_component_access`, and the
+    worker pool is supplied via `ecs_set_parallel`. The library does not create
+    threads itself.
+
+    Systems running in parallel must not create or destroy entities, or add or
+    remove components directly. Instead they should use `ecs_queue_destroy` and
+    `ecs_queue_remove`, which are safe to call from any job. Queued operations
+    are applied once all systems in a batch have finished.
+
+    A single heavy system can also be split across workers with
+    `ecs_set_system_slices`. Its callback is then invoked once per contiguous
+    slice of its entities, with the same restrictions as above.
+
+    Thread-local storage is used to route queued operations to the right job.
+    PICO_ECS_THREAD_LOCAL can be defined to override the storage qualifier.
+
+    Snapshots:
+    ----------
+
+    `ecs_snapshot` copies the state of all entities, components, systems and
+    queries into a caller supplied buffer, and `ecs_restore` copies it back.
+    This is intended for saving and rolling back the world within a single
+    run of the program. Snapshots are raw memory, so they are not portable
+    between builds or platforms, and can only be restored into an ECS with the
+    same components, systems and queries registered (in the same order).
+    Prefabs and callbacks are not part of a snapshot.
+
+    `ecs_snapshot_diff` encodes a snapshot as the bytes that differ from an
+    earlier one, and `ecs_snapshot_patch` rebuilds it.
+
+    Generational IDs:
+    -----------------
+
+    By default entity IDs are plain indices that are recycled once an entity is
+    destroyed, so a stale ID may refer to a newer entity. Defining
+    PICO_ECS_GENERATIONS (before including the header) packs a generation
+    counter into the upper bits of each entity ID. The counter is incremented
+    whenever an entity is destroyed, so `ecs_is_ready` returns false for stale
+    IDs and debug builds assert when they are used.
+
+    PICO_ECS_INDEX_BITS (default: 20) sets the number of bits used for the
+    index, which limits the number of entities to 2^PICO_ECS_INDEX_BITS - 1.
+    The remaining bits hold the generation, which wraps around.
+    `ECS_ID_INDEX` extracts the index, e.g. for use with side tables.
+
+    Change tracking:
+    ----------------
+
+    Components registered with `ecs_track_changes` record when each instance
+    was last modified. Modifications are recorded by `ecs_add`, `ecs_get_mut`
+    and `ecs_mark_changed` (plain `ecs_get` does not record anything). A system
+    that calls `ecs_require_changed` only receives the entities whose tracked
+    components changed since the system last ran, so its cost scales with the
+    number of changes rather than the number of entities.
+
+    Iteration order:
+    ----------------
+
+    Systems receive their entities in the order they joined the system, which
+    after a lot of churn bears little relation to where their components are
+    stored. `ecs_set_system_order` keeps a system's entities sorted by entity
+    index, so that indexed component arrays are read sequentially, or by a user
+    supplied key such as a Morton code. Sorting happens right before the system
+    runs and uses an insertion sort, so it is cheap when few entities joined,
+    left or changed keys since the last run.
+
     Todo:
     -----
     - Better default assertion macro
@@ -99,6 +204,29 @@ typedef uint32_t ecs_id_t;
  */
 #define ECS_NULL ((ecs_id_t)-1)
 
+#ifdef PICO_ECS_GENERATIONS
+
+#ifndef PICO_ECS_INDEX_BITS
+#define PICO_ECS_INDEX_BITS 20
+#endif
+
+/**
+ * @brief Extracts the index from an entity ID
+ */
+#define ECS_ID_INDEX(id) ((ecs_id_t)(id) & (((ecs_id_t)1 << PICO_ECS_INDEX_BITS) - 1))
+
+/**
+ * @brief Extracts the generation from an entity ID
+ */
+#define ECS_ID_GENERATION(id) ((ecs_id_t)(id) >> PICO_ECS_INDEX_BITS)
+
+#else
+
+#define ECS_ID_INDEX(id)      ((ecs_id_t)(id))
+#define ECS_ID_GENERATION(id) ((ecs_id_t)0)
+
+#endif // PICO_ECS_GENERATIONS
+
 /**
  * @brief Return code for update callback and calling functions
  */
@@ -123,6 +251,19 @@ typedef ECS_DT_TYPE ecs_dt_t;
  */
 ecs_t* ecs_new(size_t entity_count, void* mem_ctx);
 
+/**
+ * @brief Creates an ECS instance with storage reserved for a fixed number of
+ * entities. The entity array and indexed component arrays are never
+ * reallocated, so component pointers remain stable.
+ *
+ * @param entity_count The inital number of pooled entities
+ * @param max_entities The maximum number of entities (at least `entity_count`)
+ * @param mem_ctx The  Context for a custom allocator
+ *
+ * @returns An ECS instance or NULL if out of memory
+ */
+ecs_t* ecs_new_reserved(size_t entity_count, size_t max_entities, void* mem_ctx);
+
 /**
  * @brief Destroys an ECS instance
  *
@@ -178,6 +319,40 @@ ecs_id_t ecs_register_component(ecs_t* ecs,
                                 ecs_constructor_fn constructor,
                                 ecs_destructor_fn destructor);
 
+/**
+ * @brief Component storage modes
+ */
+typedef enum
+{
+    ECS_STORAGE_INDEXED, //!< One slot per entity ID (default)
+    ECS_STORAGE_PACKED   //!< Slots are packed densely next to a sparse-set index
+} ecs_storage_t;
+
+/**
+ * @brief Sets the storage mode of a component
+ *
+ * Indexed components reserve a slot for every entity ID, so memory use is
+ * proportional to the number of entities. Packed components only store
+ * instances that exist, which is better suited to components used by a small
+ * fraction of entities. However, pointers to packed components are invalidated
+ * whenever an instance of the same component is added or removed.
+ *
+ * Must be called before the component is added to any entity.
+ *
+ * @param ecs     The ECS instance
+ * @param comp_id The component ID
+ * @param storage The storage mode
+ */
+void ecs_set_component_storage(ecs_t* ecs, ecs_id_t comp_id, ecs_storage_t storage);
+
+/**
+ * @brief Enables change tracking for a component
+ *
+ * @param ecs     The ECS instance
+ * @param comp_id The component ID
+ */
+void ecs_track_changes(ecs_t* ecs, ecs_id_t comp_id);
+
 /**
  * @brief System update callback
  *
@@ -235,12 +410,54 @@ ecs_id_t ecs_register_system(ecs_t* ecs,
 /**
  * @brief Determines which components are available to the specified system.
  *
+ * For the purpose of parallel scheduling, the system is assumed to write to
+ * the component.
+ *
  * @param ecs     The ECS instance
  * @param sys_id  The target system ID
  * @param comp_id The component ID
  */
 void ecs_require_component(ecs_t* ecs, ecs_id_t sys_id, ecs_id_t comp_id);
 
+/**
+ * @brief Component access modes used for parallel scheduling
+ */
+typedef enum
+{
+    ECS_ACCESS_READ, //!< The system only reads the component
+    ECS_ACCESS_WRITE //!< The system reads and writes the component
+} ecs_access_t;
+
+/**
+ * @brief Requires a component and declares how the system accesses it
+ *
+ * @param ecs     The ECS instance
+ * @param sys_id  The target system ID
+ * @param comp_id The component ID
+ * @param access  The access mode
+ */
+void ecs_require_component_access(ecs_t* ecs,
+                                  ecs_id_t sys_id,
+                                  ecs_id_t comp_id,
+                                  ecs_access_t access);
+
+/**
+ * @brief Declares access to a component without requiring it
+ *
+ * Used when a system accesses components of entities it does not manage, for
+ * example a system that reads the position of a target entity. Systems that
+ * declare no access at all never run concurrently with other systems.
+ *
+ * @param ecs     The ECS instance
+ * @param sys_id  The target system ID
+ * @param comp_id The component ID
+ * @param access  The access mode
+ */
+void ecs_declare_component_access(ecs_t* ecs,
+                                  ecs_id_t sys_id,
+                                  ecs_id_t comp_id,
+                                  ecs_access_t access);
+
 /**
  * @brief Excludes entities having the specified component from being added to
  * the target system.
@@ -251,6 +468,58 @@ void ecs_require_component(ecs_t* ecs, ecs_id_t sys_id, ecs_id_t comp_id);
  */
 void ecs_exclude_component(ecs_t* ecs, ecs_id_t sys_id, ecs_id_t comp_id);
 
+/**
+ * @brief Restricts a system to entities whose component has changed
+ *
+ * The system is only passed the entities for which the component was added
+ * or marked as changed since the system last ran. If this is called for
+ * several components, entities where any of them changed are passed. The
+ * component must already be required by the system and must have change
+ * tracking enabled.
+ *
+ * @param ecs     The ECS instance
+ * @param sys_id  The target system ID
+ * @param comp_id The component to watch
+ */
+void ecs_require_changed(ecs_t* ecs, ecs_id_t sys_id, ecs_id_t comp_id);
+
+/**
+ * @brief System iteration orders
+ */
+typedef enum
+{
+    ECS_ORDER_NONE, //!< Entities are passed in the order they joined (default)
+    ECS_ORDER_ID,   //!< Entities are sorted by entity index
+    ECS_ORDER_KEY   //!< Entities are sorted by a user supplied key
+} ecs_order_t;
+
+/**
+ * @brief Returns the sort key of an entity
+ *
+ * @param ecs       The ECS instance
+ * @param entity_id The entity being sorted
+ * @param udata     The user data passed to the system
+ *
+ * @returns The key, entities are passed to the system in ascending key order
+ */
+typedef uint64_t (*ecs_sort_fn)(ecs_t* ecs, ecs_id_t entity_id, void* udata);
+
+/**
+ * @brief Sets the order in which a system receives its entities
+ *
+ * The entities are sorted each time before the system runs. Sorting is
+ * incremental, so keys should change gradually between runs.
+ *
+ * @param ecs     The ECS instance
+ * @param sys_id  The target system ID
+ * @param order   The iteration order
+ * @param sort_cb Returns the sort key of an entity (ECS_ORDER_KEY only)
+ */
+void ecs_set_system_order(ecs_t* ecs,
+                          ecs_id_t sys_id,
+                          ecs_order_t order,
+                          ecs_sort_fn sort_cb);
+
 /**
  * @brief Enables a system
  *
@@ -267,6 +536,70 @@ void ecs_enable_system(ecs_t* ecs, ecs_id_t sys_id);
  */
 void ecs_disable_system(ecs_t* ecs, ecs_id_t sys_id);
 
+#ifdef PICO_ECS_ARCHETYPES
+
+/**
+ * @brief A chunk of entities sharing the same archetype
+ */
+typedef struct ecs_chunk_s ecs_chunk_t;
+
+/**
+ * @brief Chunk system update callback
+ *
+ * Called once per non-empty chunk whose archetype matches the system. Entities
+ * must not be created, destroyed, or have components added or removed while
+ * chunks are being iterated. Use the queue functions instead.
+ *
+ * @param ecs   The ECS instance
+ * @param chunk The chunk being processed
+ * @param dt    The time delta
+ * @param udata The user data associated with the system
+ */
+typedef ecs_ret_t (*ecs_chunk_fn)(ecs_t* ecs,
+                                  ecs_chunk_t* chunk,
+                                  ecs_dt_t dt,
+                                  void* udata);
+
+/**
+ * @brief Registers a system that iterates over chunks
+ *
+ * @param ecs       The ECS instance
+ * @param chunk_cb  Callback that is fired for every matching chunk
+ * @param add_cb    Called when an entity is added to the system (can be NULL)
+ * @param remove_cb Called when an entity is removed from the system (can be NULL)
+ * @param udata     The user data passed to the callbacks
+ * @returns         The system's ID
+ */
+ecs_id_t ecs_register_chunk_system(ecs_t* ecs,
+                                   ecs_chunk_fn chunk_cb,
+                                   ecs_added_fn add_cb,
+                                   ecs_removed_fn remove_cb,
+                                   void* udata);
+
+/**
+ * @brief Returns the number of entities in a chunk
+ */
+int ecs_chunk_count(ecs_chunk_t* chunk);
+
+/**
+ * @brief Returns the IDs of the entities in a chunk
+ */
+ecs_id_t* ecs_chunk_entities(ecs_chunk_t* chunk);
+
+/**
+ * @brief Returns the contiguous array of components of the specified type in
+ * a chunk
+ *
+ * @param chunk   The chunk
+ * @param comp_id The component ID
+ *
+ * @returns An array of `ecs_chunk_count(chunk)` components, or NULL if the
+ * chunk's archetype does not include the component
+ */
+void* ecs_chunk_column(ecs_chunk_t* chunk, ecs_id_t comp_id);
+
+#endif // PICO_ECS_ARCHETYPES
+
 /**
  * @brief Creates an entity
  *
@@ -276,6 +609,32 @@ void ecs_disable_system(ecs_t* ecs, ecs_id_t sys_id);
  */
 ecs_id_t ecs_create(ecs_t* ecs);
 
+/**
+ * @brief Creates many entities sharing the same set of components
+ *
+ * Entity IDs are reserved from the pool in one step and the new entities are
+ * matched against systems once, instead of once per entity and component.
+ *
+ * If `values` is NULL, or `values[i]` is NULL, component `comp_ids[i]` is
+ * zeroed and passed to its constructor with NULL arguments. Otherwise
+ * `values[i]` must point to `count` contiguous instances of the component,
+ * which are copied into the new entities in order (the constructor is not
+ * called).
+ *
+ * @param ecs        The ECS instance
+ * @param entities   Receives the `count` new entity IDs
+ * @param count      The number of entities to create
+ * @param comp_ids   The components added to every entity
+ * @param comp_count The number of components
+ * @param values     Initial component values (can be NULL)
+ */
+void ecs_create_many(ecs_t* ecs,
+                     ecs_id_t* entities,
+                     int count,
+                     const ecs_id_t* comp_ids,
+                     int comp_count,
+                     const void* const* values);
+
 /**
  * @brief Returns true if the entity is currently active
  *
@@ -316,6 +675,144 @@ bool ecs_has(ecs_t* ecs, ecs_id_t entity_id, ecs_id_t comp_id);
  */
 void* ecs_add(ecs_t* ecs, ecs_id_t entity_id, ecs_id_t comp_id, void* args);
 
+/**
+ * @brief Adds a component instance to many entities
+ *
+ * Equivalent to calling `ecs_add` for each entity, except that system
+ * membership is only recomputed when an entity's component set differs from
+ * that of the previous entity.
+ *
+ * @param ecs       The ECS instance
+ * @param entities  The entity IDs
+ * @param count     The number of entities
+ * @param comp_id   The component ID
+ * @param values    `count` component instances copied into the entities in
+ *                  order (can be NULL, in which case the components are
+ *                  zeroed and constructed)
+ * @param args      Arguments passed to the constructor (ignored if `values`
+ *                  is not NULL)
+ */
+void ecs_add_many(ecs_t* ecs,
+                  const ecs_id_t* entities,
+                  int count,
+                  ecs_id_t comp_id,
+                  const void* values,
+                  void* args);
+
+/**
+ * @brief Registers a prefab
+ *
+ * A prefab is a template made of a set of components and their default
+ * values. The systems matching a prefab are resolved once and cached, so
+ * instantiating it only copies components and inserts the new entity into
+ * those systems.
+ *
+ * @param ecs The ECS instance
+ *
+ * @returns The prefab's ID
+ */
+ecs_id_t ecs_register_prefab(ecs_t* ecs);
+
+/**
+ * @brief Adds a component to a prefab
+ *
+ * @param ecs       The ECS instance
+ * @param prefab_id The prefab ID
+ * @param comp_id   The component ID
+ *
+ * @returns The prefab's default instance of the component (initially zeroed).
+ * It is copied into every instance of the prefab, without calling the
+ * component's constructor. The pointer remains valid until `ecs_free`.
+ */
+void* ecs_prefab_add(ecs_t* ecs, ecs_id_t prefab_id, ecs_id_t comp_id);
+
+/**
+ * @brief Creates an entity from a prefab
+ *
+ * @param ecs       The ECS instance
+ * @param prefab_id The prefab ID
+ *
+ * @returns The new entity ID
+ */
+ecs_id_t ecs_instantiate(ecs_t* ecs, ecs_id_t prefab_id);
+
+/**
+ * @brief Creates many entities from a prefab
+ *
+ * @param ecs       The ECS instance
+ * @param prefab_id The prefab ID
+ * @param entities  Receives the `count` new entity IDs
+ * @param count     The number of entities to create
+ */
+void ecs_instantiate_many(ecs_t* ecs, ecs_id_t prefab_id, ecs_id_t* entities, int count);
+
+/**
+ * @brief Registers a query
+ *
+ * A query tracks the entities that have all of the required components and
+ * none of the excluded ones. Like system membership, the result is kept up to
+ * date as components are added and removed, so it can be read at any time
+ * without a scan. Unlike systems, the number of queries is not limited.
+ *
+ * @param ecs           The ECS instance
+ * @param require       The required components (can be NULL)
+ * @param require_count The number of required components
+ * @param exclude       The excluded components (can be NULL)
+ * @param exclude_count The number of excluded components
+ *
+ * @returns The query's ID
+ */
+ecs_id_t ecs_register_query(ecs_t* ecs,
+                            const ecs_id_t* require,
+                            int require_count,
+                            const ecs_id_t* exclude,
+                            int exclude_count);
+
+/**
+ * @brief Returns the number of entities matching a query
+ *
+ * @param ecs      The ECS instance
+ * @param query_id The query ID
+ */
+int ecs_query_count(ecs_t* ecs, ecs_id_t query_id);
+
+/**
+ * @brief Returns the entities matching a query
+ *
+ * The array is invalidated when an entity or component is added, removed, or
+ * destroyed.
+ *
+ * @param ecs      The ECS instance
+ * @param query_id The query ID
+ *
+ * @returns An array of `ecs_query_count` entity IDs
+ */
+ecs_id_t* ecs_query_entities(ecs_t* ecs, ecs_id_t query_id);
+
+/**
+ * @brief Finds entities matching a set of components without a cached query
+ *
+ * Scans every entity, which is suitable for infrequent lookups.
+ *
+ * @param ecs           The ECS instance
+ * @param require       The required components (can be NULL)
+ * @param require_count The number of required components
+ * @param exclude       The excluded components (can be NULL)
+ * @param exclude_count The number of excluded components
+ * @param entities      Receives up to `max_count` matching entity IDs (can be
+ *                      NULL)
+ * @param max_count     The capacity of `entities`
+ *
+ * @returns The total number of matching entities
+ */
+int ecs_scan(ecs_t* ecs,
+             const ecs_id_t* require,
+             int require_count,
+             const ecs_id_t* exclude,
+             int exclude_count,
+             ecs_id_t* entities,
+             int max_count);
+
 /**
  * @brief Gets a component instance associated with an entity
  *
@@ -327,6 +824,31 @@ void* ecs_add(ecs_t* ecs, ecs_id_t entity_id, ecs_id_t comp_id, void* args);
  */
 void* ecs_get(ecs_t* ecs, ecs_id_t entity_id, ecs_id_t comp_id);
 
+/**
+ * @brief Gets a component instance for modification
+ *
+ * Same as `ecs_get`, but also marks the component as changed.
+ *
+ * @param ecs       The ECS instance
+ * @param entity_id The entity ID
+ * @param comp_id   The component ID
+ *
+ * @returns The component instance
+ */
+void* ecs_get_mut(ecs_t* ecs, ecs_id_t entity_id, ecs_id_t comp_id);
+
+/**
+ * @brief Marks a component instance as changed
+ *
+ * Does nothing if change tracking is not enabled for the component. Safe to
+ * call from parallel jobs.
+ *
+ * @param ecs       The ECS instance
+ * @param entity_id The entity ID
+ * @param comp_id   The component ID
+ */
+void ecs_mark_changed(ecs_t* ecs, ecs_id_t entity_id, ecs_id_t comp_id);
+
 /**
  * @brief Removes a component instance from an entity
  *
@@ -379,6 +901,139 @@ ecs_ret_t ecs_update_system(ecs_t* ecs, ecs_id_t sys_id, ecs_dt_t dt);
  */
 ecs_ret_t ecs_update_systems(ecs_t* ecs, ecs_dt_t dt);
 
+/**
+ * @brief A unit of work dispatched to the worker pool
+ *
+ * @param data  Opaque data owned by the library
+ * @param index The index of the task
+ */
+typedef void (*ecs_task_fn)(void* data, int index);
+
+/**
+ * @brief Runs tasks on a worker pool
+ *
+ * Must call `task(data, i)` exactly once for every `i` in `[0, count)`, from
+ * any thread, and only return once all calls have completed.
+ *
+ * @param task  The task function
+ * @param data  The data to pass to the task function
+ * @param count The number of tasks
+ * @param udata The user data passed to `ecs_set_parallel`
+ */
+typedef void (*ecs_parallel_fn)(ecs_task_fn task, void* data, int count, void* udata);
+
+/**
+ * @brief Sets the worker pool used by parallel updates
+ *
+ * If no pool is set (or `parallel_cb` is NULL), tasks are run sequentially
+ * on the calling thread.
+ *
+ * @param ecs         The ECS instance
+ * @param parallel_cb The function that dispatches tasks to the pool
+ * @param udata       The user data passed to the callback
+ */
+void ecs_set_parallel(ecs_t* ecs, ecs_parallel_fn parallel_cb, void* udata);
+
+/**
+ * @brief Splits the entities of a system into slices processed in parallel
+ *
+ * When enabled, the system callback is invoked once for every contiguous
+ * slice of up to `slice_size` entities, and the slices are dispatched to the
+ * worker pool set with `ecs_set_parallel`. This applies both to
+ * `ecs_update_system` and `ecs_update_systems_parallel`. The callback must
+ * only modify the entities in its slice and defer structural changes using
+ * the queue functions.
+ *
+ * @param ecs        The ECS instance
+ * @param sys_id     The system ID
+ * @param slice_size The maximum number of entities per slice (0 disables
+ *                   slicing)
+ */
+void ecs_set_system_slices(ecs_t* ecs, ecs_id_t sys_id, int slice_size);
+
+/**
+ * @brief Updates all systems, running non-conflicting systems in parallel
+ *
+ * Systems are grouped into batches. Two systems are placed in different
+ * batches if either one writes to a component the other accesses, with the
+ * system registered first running first. Queued operations are flushed after
+ * each batch.
+ *
+ * @param ecs The ECS instance
+ * @param dt  The time delta
+ *
+ * @returns The first non-zero code returned by a system (in registration
+ * order), in which case later batches are not run
+ */
+ecs_ret_t ecs_update_systems_parallel(ecs_t* ecs, ecs_dt_t dt);
+
+/**
+ * @brief Takes a snapshot of the ECS
+ *
+ * @param ecs    The ECS instance
+ * @param buffer The destination buffer (can be NULL)
+ * @param size   The size of the buffer in bytes
+ *
+ * @returns The size of the snapshot in bytes. Nothing is written if this is
+ * larger than `size`
+ */
+size_t ecs_snapshot(ecs_t* ecs, void* buffer, size_t size);
+
+/**
+ * @brief Restores a snapshot taken with `ecs_snapshot`
+ *
+ * Add/remove callbacks, constructors and destructors are not called.
+ *
+ * @param ecs    The ECS instance
+ * @param buffer The snapshot
+ * @param size   The size of the snapshot in bytes
+ *
+ * @returns False if the snapshot does not match the registered components,
+ * systems and queries (in which case the ECS is unchanged) or if it is
+ * truncated (in which case the ECS must be reset)
+ */
+bool ecs_restore(ecs_t* ecs, const void* buffer, size_t size);
+
+/**
+ * @brief Encodes a snapshot as the difference from a base snapshot
+ *
+ * @param base          The base snapshot
+ * @param base_size     The size of the base snapshot
+ * @param snapshot      The snapshot to encode
+ * @param snapshot_size The size of the snapshot to encode
+ * @param delta         The destination buffer (can be NULL)
+ * @param delta_size    The size of the destination buffer
+ *
+ * @returns The size of the delta in bytes. Nothing is written if this is
+ * larger than `delta_size`
+ */
+size_t ecs_snapshot_diff(const void* base,
+                         size_t base_size,
+                         const void* snapshot,
+                         size_t snapshot_size,
+                         void* delta,
+                         size_t delta_size);
+
+/**
+ * @brief Rebuilds a snapshot from a base snapshot and a delta
+ *
+ * @param base          The base snapshot passed to `ecs_snapshot_diff`
+ * @param base_size     The size of the base snapshot
+ * @param delta         The delta produced by `ecs_snapshot_diff`
+ * @param delta_size    The size of the delta
+ * @param snapshot      The destination buffer (can be NULL, may be `base`)
+ * @param snapshot_size The size of the destination buffer
+ *
+ * @returns The size of the rebuilt snapshot, or zero if the delta is malformed.
+ * Nothing is written if the size is larger than `snapshot_size`
+ */
+size_t ecs_snapshot_patch(const void* base,
+                          size_t base_size,
+                          const void* delta,
+                          size_t delta_size,
+                          void* snapshot,
+                          size_t snapshot_size);
+
 #ifdef __cplusplus
 }
 #endif
@@ -399,6 +1054,22 @@ ecs_ret_t ecs_update_systems(ecs_t* ecs, ecs_dt_t dt);
 #define PICO_ECS_MAX_SYSTEMS 16
 #endif
 
+#ifndef PICO_ECS_CHUNK_SIZE
+#define PICO_ECS_CHUNK_SIZE 256
+#endif
+
+#ifndef PICO_ECS_THREAD_LOCAL
+    #if defined(__cplusplus) && __cplusplus >= 201103L
+        #define PICO_ECS_THREAD_LOCAL thread_local
+    #elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+        #define PICO_ECS_THREAD_LOCAL _Thread_local
+    #elif defined(_MSC_VER)
+        #define PICO_ECS_THREAD_LOCAL __declspec(thread)
+    #else
+        #define PICO_ECS_THREAD_LOCAL __thread
+    #endif
+#endif
+
 #ifdef NDEBUG
     #define PICO_ECS_ASSERT(expr) ((void)0)
 #else
@@ -422,9 +1093,17 @@ ecs_ret_t ecs_update_systems(ecs_t* ecs, ecs_dt_t dt);
 #define ECS_ASSERT          PICO_ECS_ASSERT
 #define ECS_MAX_COMPONENTS  PICO_ECS_MAX_COMPONENTS
 #define ECS_MAX_SYSTEMS     PICO_ECS_MAX_SYSTEMS
+#define ECS_CHUNK_SIZE      PICO_ECS_CHUNK_SIZE
 #define ECS_MALLOC          PICO_ECS_MALLOC
 #define ECS_REALLOC         PICO_ECS_REALLOC
 #define ECS_FREE            PICO_ECS_FREE
+#define ECS_THREAD_LOCAL    PICO_ECS_THREAD_LOCAL
+
+#ifdef PICO_ECS_GENERATIONS
+#define ECS_INDEX_MASK  (((ecs_id_t)1 << PICO_ECS_INDEX_BITS) - 1)
+#define ECS_MAKE_ID(index, generation) \
+    ((ecs_id_t)(index) | ((ecs_id_t)(generation) << PICO_ECS_INDEX_BITS))
+#endif
 
 /*=============================================================================
  * Internal data structures
@@ -474,12 +1153,22 @@ typedef struct
 {
     ecs_bitset_t comp_bits;
     bool         ready;
+#ifdef PICO_ECS_GENERATIONS
+    ecs_id_t     generation; // Incremented when the entity is destroyed
+#endif
+#ifdef PICO_ECS_ARCHETYPES
+    ecs_id_t     archetype; // Archetype the entity belongs to (0 if none)
+    size_t       row;       // Position of the entity within the archetype
+#endif
 } ecs_entity_t;
 
 typedef struct
 {
     ecs_constructor_fn constructor;
     ecs_destructor_fn  destructor;
+    ecs_storage_t      storage;
+    ecs_sparse_set_t   index; // Maps entity IDs to slots (packed storage only)
+    uint32_t*          ticks; // Tick of the last change per entity (tracked only)
 } ecs_comp_t;
 
 typedef struct
@@ -491,9 +1180,111 @@ typedef struct
     ecs_removed_fn   remove_cb;
     ecs_bitset_t     require_bits;
     ecs_bitset_t     exclude_bits;
+    ecs_bitset_t     read_bits;  // Components read by the system
+    ecs_bitset_t     write_bits; // Components written by the system
+    int              slice_size; // Entities per parallel slice (0 if disabled)
+    ecs_id_t         changed_comps[ECS_MAX_COMPONENTS]; // Components watched for changes
+    size_t           changed_comp_count;
+    ecs_id_t*        changed_ids;      // Scratch list of changed entities
+    size_t           changed_capacity;
+    uint32_t         last_tick;        // Tick of the last run
+    ecs_order_t      order;
+    ecs_sort_fn      sort_cb;
+    uint64_t*        sort_keys;        // Scratch list of sort keys
+    size_t           sort_capacity;
     void*            udata;
+#ifdef PICO_ECS_ARCHETYPES
+    ecs_chunk_fn     chunk_cb;
+    ecs_stack_t      archetypes; // Matching archetypes (chunk systems only)
+#endif
 } ecs_sys_t;
 
+#ifdef PICO_ECS_ARCHETYPES
+
+// A chunk is a single allocation: the header below, followed by the entity IDs
+// and one column per component in the archetype
+struct ecs_chunk_s
+{
+    size_t    count;
+    ecs_id_t* entities;
+    void*     columns[ECS_MAX_COMPONENTS];
+};
+
+typedef struct
+{
+    ecs_bitset_t  comp_bits;
+    ecs_id_t      comp_ids[ECS_MAX_COMPONENTS];
+    size_t        comp_count;
+    size_t        count;          // Number of entities (rows)
+    size_t        chunk_bytes;    // Size of a chunk allocation
+    size_t        offsets[ECS_MAX_COMPONENTS];
+    ecs_id_t      add_edges[ECS_MAX_COMPONENTS];    // Archetype reached by adding a component
+    ecs_id_t      remove_edges[ECS_MAX_COMPONENTS]; // Archetype reached by removing a component
+    ecs_chunk_t** chunks;
+    size_t        chunk_count;    // Number of allocated chunks
+    size_t        chunk_capacity;
+} ecs_archetype_t;
+
+#endif // PICO_ECS_ARCHETYPES
+
+// A sorted list of system IDs
+typedef struct
+{
+    ecs_id_t ids[ECS_MAX_SYSTEMS];
+    size_t   count;
+} ecs_sys_list_t;
+
+typedef struct
+{
+    ecs_bitset_t   comp_bits;
+    ecs_id_t       comp_ids[ECS_MAX_COMPONENTS];
+    size_t         comp_count;
+    void*          values[ECS_MAX_COMPONENTS]; // Default component instances
+    ecs_sys_list_t systems;        // Cached matching systems
+    size_t         system_version; // Value of ecs->system_version when cached
+    bool           matched;        // True if the cached systems are valid
+} ecs_prefab_t;
+
+typedef struct
+{
+    ecs_bitset_t     require_bits;
+    ecs_bitset_t     exclude_bits;
+    ecs_sparse_set_t entity_ids;
+} ecs_query_t;
+
+// Deferred operations recorded by a single job
+typedef struct
+{
+    ecs_stack_t destroy_queue;
+    ecs_stack_t remove_queue;
+} ecs_queue_t;
+
+// A system run (or slice of one) dispatched to the worker pool
+typedef struct
+{
+    ecs_id_t  sys_id;
+    ecs_id_t* entities; // First entity of the slice
+    size_t    count;    // Number of entities in the slice
+    bool      slice;
+    ecs_dt_t  dt;
+    ecs_ret_t code;
+} ecs_job_t;
+
+// Serialization cursors (a writer without data only measures)
+typedef struct
+{
+    char*  data;
+    size_t size;
+    size_t offset;
+} ecs_writer_t;
+
+typedef struct
+{
+    const char* data;
+    size_t      size;
+    size_t      offset;
+} ecs_reader_t;
+
 struct ecs_s
 {
     ecs_stack_t   entity_pool;
@@ -501,14 +1292,40 @@ struct ecs_s
     ecs_stack_t   remove_queue;
     ecs_entity_t* entities;
     size_t        entity_count;
+    size_t        reserved_count; // Entities reserved up front (0 if growable)
     ecs_comp_t    comps[ECS_MAX_COMPONENTS];
     ecs_array_t   comp_arrays[ECS_MAX_COMPONENTS];
     size_t        comp_count;
     ecs_sys_t     systems[ECS_MAX_SYSTEMS];
     size_t        system_count;
+    ecs_sys_list_t require_index[ECS_MAX_COMPONENTS]; // Systems requiring each component (or nothing)
+    ecs_sys_list_t exclude_index[ECS_MAX_COMPONENTS]; // Systems excluding each component
+    size_t        system_version; // Incremented whenever system requirements change
+    uint32_t      tick;           // Advanced after each system run
+    ecs_prefab_t* prefabs;
+    size_t        prefab_count;
+    size_t        prefab_capacity;
+    ecs_query_t*  queries;
+    size_t        query_count;
+    size_t        query_capacity;
     void*         mem_ctx;
+#ifdef PICO_ECS_ARCHETYPES
+    ecs_archetype_t* archetypes;
+    size_t           archetype_count;
+    size_t           archetype_capacity;
+#endif
+    ecs_parallel_fn parallel_cb;
+    void*           parallel_udata;
+    ecs_job_t*      jobs;
+    ecs_queue_t*    job_queues;
+    size_t          job_count;
+    size_t          job_capacity;
 };
 
+// The job (if any) being run by the current thread
+static ECS_THREAD_LOCAL ecs_t*       ecs_local_ecs   = NULL;
+static ECS_THREAD_LOCAL ecs_queue_t* ecs_local_queue = NULL;
+
 /*=============================================================================
  * Internal realloc wrapper
  *============================================================================*/
@@ -517,8 +1334,74 @@ void* ecs_realloc_zero(ecs_t* ecs, void* ptr, size_t old_size, size_t new_size);
 /*=============================================================================
  * Internal functions to flush destroyed entities and removed component
  *============================================================================*/
-static void ecs_flush_destroyed(ecs_t* ecs);
-static void ecs_flush_removed(ecs_t* ecs);
+static void ecs_flush_destroyed(ecs_t* ecs, ecs_stack_t* destroy_queue);
+static void ecs_flush_removed(ecs_t* ecs, ecs_stack_t* remove_queue);
+
+/*=============================================================================
+ * Internal component to system index functions
+ *============================================================================*/
+static void ecs_sys_list_insert(ecs_sys_list_t* list, ecs_id_t sys_id);
+static void ecs_sys_list_remove(ecs_sys_list_t* list, ecs_id_t sys_id);
+static void ecs_index_system(ecs_t* ecs, ecs_id_t sys_id);
+
+/*=============================================================================
+ * Internal query functions
+ *============================================================================*/
+static void ecs_make_bits(ecs_bitset_t* bits, const ecs_id_t* comp_ids, int comp_count);
+static void ecs_update_queries(ecs_t* ecs, ecs_id_t entity_id, ecs_id_t comp_id);
+static void ecs_leave_queries(ecs_t* ecs, ecs_id_t entity_id);
+
+/*=============================================================================
+ * Internal system execution functions
+ *============================================================================*/
+static ecs_ret_t ecs_run_system(ecs_t* ecs, ecs_sys_t* sys, ecs_dt_t dt);
+static size_t    ecs_system_entities(ecs_t* ecs, ecs_sys_t* sys, ecs_id_t** entities);
+static void      ecs_sort_system_entities(ecs_t* ecs, ecs_sys_t* sys);
+static void      ecs_push_jobs(ecs_t* ecs, ecs_id_t sys_id, ecs_dt_t dt);
+static void      ecs_run_job(void* data, int index);
+static ecs_ret_t ecs_run_jobs(ecs_t* ecs);
+static bool      ecs_systems_conflict(ecs_sys_t* sys1, ecs_sys_t* sys2);
+
+/*=============================================================================
+ * Internal entity pool functions
+ *============================================================================*/
+static ecs_id_t ecs_entity_id(ecs_t* ecs, ecs_id_t index);
+static size_t ecs_entity_capacity(ecs_t* ecs);
+static void ecs_reserve_entities(ecs_t* ecs, size_t count);
+static void ecs_grow_entities(ecs_t* ecs, size_t new_count);
+static void ecs_spawn_entities(ecs_t* ecs,
+                               ecs_id_t* entities,
+                               int count,
+                               ecs_bitset_t* comp_bits,
+                               const ecs_id_t* comp_ids,
+                               int comp_count);
+static void ecs_match_systems(ecs_t* ecs, ecs_bitset_t* comp_bits, ecs_sys_list_t* list);
+static void ecs_join_systems(ecs_t* ecs,
+                             const ecs_id_t* entities,
+                             int count,
+                             ecs_sys_list_t* list);
+
+/*=============================================================================
+ * Internal component storage functions
+ *============================================================================*/
+static void* ecs_comp_insert(ecs_t* ecs, ecs_id_t entity_id, ecs_id_t comp_id);
+static void  ecs_comp_erase(ecs_t* ecs, ecs_id_t entity_id, ecs_id_t comp_id);
+static void  ecs_entity_release(ecs_t* ecs, ecs_id_t entity_id);
+
+/*=============================================================================
+ * Internal archetype functions
+ *============================================================================*/
+#ifdef PICO_ECS_ARCHETYPES
+static ecs_id_t ecs_archetype_get(ecs_t* ecs, ecs_bitset_t* comp_bits);
+static ecs_id_t ecs_archetype_edge(ecs_t* ecs, ecs_id_t arch_id, ecs_id_t comp_id, bool add);
+static size_t   ecs_archetype_push(ecs_t* ecs, ecs_id_t arch_id, ecs_id_t entity_id);
+static void     ecs_archetype_erase(ecs_t* ecs, ecs_id_t arch_id, size_t row);
+static void     ecs_archetype_move(ecs_t* ecs, ecs_id_t entity_id, ecs_id_t dst_id);
+static void*    ecs_archetype_slot(ecs_t* ecs, ecs_archetype_t* arch, size_t row, ecs_id_t comp_id);
+static void     ecs_archetype_free(ecs_t* ecs, ecs_archetype_t* arch);
+static void     ecs_system_match_archetypes(ecs_t* ecs, ecs_sys_t* sys);
+static ecs_ret_t ecs_run_chunk_system(ecs_t* ecs, ecs_sys_t* sys, ecs_dt_t dt);
+#endif // PICO_ECS_ARCHETYPES
 
 /*=============================================================================
  * Internal bit set functions
@@ -560,28 +1443,60 @@ static int      ecs_stack_size(ecs_stack_t* pool);
 /*=============================================================================
  * Internal array functions
  *============================================================================*/
-static void   ecs_array_init(ecs_t* ecs, ecs_array_t* array, size_t size, size_t capacity);
 static void   ecs_array_free(ecs_t* ecs, ecs_array_t* array);
+#ifndef PICO_ECS_ARCHETYPES
+static void   ecs_array_init(ecs_t* ecs, ecs_array_t* array, size_t size, size_t capacity);
 static void   ecs_array_resize(ecs_t* ecs, ecs_array_t* array, size_t capacity);
+#endif
+
+/*=============================================================================
+ * Internal snapshot functions
+ *============================================================================*/
+static void ecs_write(ecs_writer_t* writer, const void* src, size_t size);
+static bool ecs_read(ecs_reader_t* reader, void* dst, size_t size);
+static void ecs_write_stack(ecs_writer_t* writer, ecs_stack_t* stack);
+static bool ecs_read_stack(ecs_t* ecs, ecs_reader_t* reader, ecs_stack_t* stack);
+static void ecs_write_sparse_set(ecs_writer_t* writer, ecs_sparse_set_t* set);
+static bool ecs_read_sparse_set(ecs_t* ecs, ecs_reader_t* reader, ecs_sparse_set_t* set);
+static void ecs_write_header(ecs_t* ecs, ecs_writer_t* writer);
+static bool ecs_read_header(ecs_t* ecs, ecs_reader_t* reader);
+static void ecs_write_world(ecs_t* ecs, ecs_writer_t* writer);
+static bool ecs_read_world(ecs_t* ecs, ecs_reader_t* reader);
+static void ecs_write_delta(ecs_writer_t* writer,
+                            const char* base, size_t base_size,
+                            const char* snapshot, size_t snapshot_size);
 
 /*=============================================================================
  * Internal validation functions
  *============================================================================*/
 #ifndef NDEBUG
 static bool ecs_is_not_null(void* ptr);
+static bool ecs_is_not_in_job(ecs_t* ecs);
 static bool ecs_is_valid_component_id(ecs_id_t id);
 static bool ecs_is_valid_system_id(ecs_id_t id);
 static bool ecs_is_entity_ready(ecs_t* ecs, ecs_id_t entity_id);
 static bool ecs_is_component_ready(ecs_t* ecs, ecs_id_t comp_id);
 static bool ecs_is_system_ready(ecs_t* ecs, ecs_id_t sys_id);
+static bool ecs_is_prefab_ready(ecs_t* ecs, ecs_id_t prefab_id);
+static bool ecs_is_query_ready(ecs_t* ecs, ecs_id_t query_id);
 #endif // NDEBUG
 /*=============================================================================
  * Public API implementation
  *============================================================================*/
 
 ecs_t* ecs_new(size_t entity_count, void* mem_ctx)
+{
+    return ecs_new_reserved(entity_count, 0, mem_ctx);
+}
+
+ecs_t* ecs_new_reserved(size_t entity_count, size_t max_entities, void* mem_ctx)
 {
     ECS_ASSERT(entity_count > 0);
+    ECS_ASSERT(0 == max_entities || max_entities >= entity_count);
+
+#ifdef PICO_ECS_GENERATIONS
+    ECS_ASSERT(max_entities <= ECS_INDEX_MASK);
+#endif
 
     ecs_t* ecs = (ecs_t*)ECS_MALLOC(sizeof(ecs_t), mem_ctx);
 
@@ -591,16 +1506,20 @@ ecs_t* ecs_new(size_t entity_count, void* mem_ctx)
 
     memset(ecs, 0, sizeof(ecs_t));
 
-    ecs->entity_count = entity_count;
-    ecs->mem_ctx      = mem_ctx;
+    ecs->entity_count   = entity_count;
+    ecs->reserved_count = max_entities;
+    ecs->mem_ctx        = mem_ctx;
+
+    // Tick zero means "never changed"
+    ecs->tick = 1;
 
     // Initialize entity pool and queues
-    ecs_stack_init(ecs, &ecs->entity_pool,   entity_count);
+    ecs_stack_init(ecs, &ecs->entity_pool,   ecs_entity_capacity(ecs));
     ecs_stack_init(ecs, &ecs->destroy_queue, entity_count);
     ecs_stack_init(ecs, &ecs->remove_queue,  entity_count * 2);
 
-    // Allocate entity array
-    ecs->entities = (ecs_entity_t*)ECS_MALLOC(ecs->entity_count * sizeof(ecs_entity_t),
+    // Allocate entity array (only the entities in use are zeroed below)
+    ecs->entities = (ecs_entity_t*)ECS_MALLOC(ecs_entity_capacity(ecs) * sizeof(ecs_entity_t),
                                               ecs->mem_ctx);
 
     // Zero entity array
@@ -612,6 +1531,14 @@ ecs_t* ecs_new(size_t entity_count, void* mem_ctx)
         ecs_stack_push(ecs, &ecs->entity_pool, id);
     }
 
+#ifdef PICO_ECS_ARCHETYPES
+    // Create the empty archetype (ID 0) that entities without components
+    // belong to
+    ecs_bitset_t empty_bits;
+    memset(&empty_bits, 0, sizeof(ecs_bitset_t));
+    ecs_archetype_get(ecs, &empty_bits);
+#endif
+
     return ecs;
 }
 
@@ -619,28 +1546,89 @@ void ecs_free(ecs_t* ecs)
 {
     ECS_ASSERT(ecs_is_not_null(ecs));
 
-    for (ecs_id_t entity_id = 0; entity_id < ecs->entity_count; entity_id++)
+    for (ecs_id_t index = 0; index < ecs->entity_count; index++)
     {
-        if (ecs->entities[entity_id].ready)
-            ecs_destroy(ecs, entity_id);
+        if (ecs->entities[index].ready)
+            ecs_destroy(ecs, ecs_entity_id(ecs, index));
     }
 
     ecs_stack_free(ecs, &ecs->entity_pool);
     ecs_stack_free(ecs, &ecs->destroy_queue);
     ecs_stack_free(ecs, &ecs->remove_queue);
 
+    for (size_t i = 0; i < ecs->job_capacity; i++)
+    {
+        ecs_stack_free(ecs, &ecs->job_queues[i].destroy_queue);
+        ecs_stack_free(ecs, &ecs->job_queues[i].remove_queue);
+    }
+
+    if (ecs->jobs)
+    {
+        ECS_FREE(ecs->jobs, ecs->mem_ctx);
+        ECS_FREE(ecs->job_queues, ecs->mem_ctx);
+    }
+
     for (ecs_id_t comp_id = 0; comp_id < ecs->comp_count; comp_id++)
     {
         ecs_array_t* comp_array = &ecs->comp_arrays[comp_id];
         ecs_array_free(ecs, comp_array);
+
+        ecs_comp_t* comp = &ecs->comps[comp_id];
+
+#ifndef PICO_ECS_ARCHETYPES
+        if (ECS_STORAGE_PACKED == comp->storage)
+            ecs_sparse_set_free(ecs, &comp->index);
+#endif
+
+        if (comp->ticks)
+            ECS_FREE(comp->ticks, ecs->mem_ctx);
     }
 
     for (ecs_id_t sys_id = 0; sys_id < ecs->system_count; sys_id++)
     {
         ecs_sys_t* sys = &ecs->systems[sys_id];
         ecs_sparse_set_free(ecs, &sys->entity_ids);
+
+        if (sys->changed_ids)
+            ECS_FREE(sys->changed_ids, ecs->mem_ctx);
+
+        if (sys->sort_keys)
+            ECS_FREE(sys->sort_keys, ecs->mem_ctx);
+
+#ifdef PICO_ECS_ARCHETYPES
+        if (sys->chunk_cb)
+            ecs_stack_free(ecs, &sys->archetypes);
+#endif
+    }
+
+#ifdef PICO_ECS_ARCHETYPES
+    for (ecs_id_t arch_id = 0; arch_id < ecs->archetype_count; arch_id++)
+    {
+        ecs_archetype_free(ecs, &ecs->archetypes[arch_id]);
+    }
+
+    ECS_FREE(ecs->archetypes, ecs->mem_ctx);
+#endif
+
+    for (ecs_id_t prefab_id = 0; prefab_id < ecs->prefab_count; prefab_id++)
+    {
+        ecs_prefab_t* prefab = &ecs->prefabs[prefab_id];
+
+        for (size_t i = 0; i < prefab->comp_count; i++)
+            ECS_FREE(prefab->values[prefab->comp_ids[i]], ecs->mem_ctx);
+    }
+
+    if (ecs->prefabs)
+        ECS_FREE(ecs->prefabs, ecs->mem_ctx);
+
+    for (ecs_id_t query_id = 0; query_id < ecs->query_count; query_id++)
+    {
+        ecs_sparse_set_free(ecs, &ecs->queries[query_id].entity_ids);
     }
 
+    if (ecs->queries)
+        ECS_FREE(ecs->queries, ecs->mem_ctx);
+
     ECS_FREE(ecs->entities, ecs->mem_ctx);
     ECS_FREE(ecs, ecs->mem_ctx);
 }
@@ -649,17 +1637,27 @@ void ecs_reset(ecs_t* ecs)
 {
     ECS_ASSERT(ecs_is_not_null(ecs));
 
-    for (ecs_id_t entity_id = 0; entity_id < ecs->entity_count; entity_id++)
+    for (ecs_id_t index = 0; index < ecs->entity_count; index++)
     {
-        if (ecs->entities[entity_id].ready)
-            ecs_destroy(ecs, entity_id);
+        if (ecs->entities[index].ready)
+            ecs_destroy(ecs, ecs_entity_id(ecs, index));
     }
 
     ecs->entity_pool.size   = 0;
     ecs->destroy_queue.size = 0;
     ecs->remove_queue.size  = 0;
 
+#ifdef PICO_ECS_GENERATIONS
+    // Generations survive the reset so that old IDs remain stale
+    for (ecs_id_t index = 0; index < ecs->entity_count; index++)
+    {
+        ecs_id_t generation = ecs->entities[index].generation;
+        memset(&ecs->entities[index], 0, sizeof(ecs_entity_t));
+        ecs->entities[index].generation = generation;
+    }
+#else
     memset(ecs->entities, 0, ecs->entity_count * sizeof(ecs_entity_t));
+#endif
 
     for (ecs_id_t entity_id = 0; entity_id < ecs->entity_count; entity_id++)
     {
@@ -670,6 +1668,11 @@ void ecs_reset(ecs_t* ecs)
     {
         ecs->systems[sys_id].entity_ids.size = 0;
     }
+
+    for (ecs_id_t query_id = 0; query_id < ecs->query_count; query_id++)
+    {
+        ecs->queries[query_id].entity_ids.size = 0;
+    }
 }
 
 ecs_id_t ecs_register_component(ecs_t* ecs,
@@ -684,16 +1687,84 @@ ecs_id_t ecs_register_component(ecs_t* ecs,
     ecs_id_t comp_id = ecs->comp_count;
 
     ecs_array_t* comp_array = &ecs->comp_arrays[comp_id];
-    ecs_array_init(ecs, comp_array, size, ecs->entity_count);
+
+#ifdef PICO_ECS_ARCHETYPES
+    // Component data lives in archetype chunks, only the size is needed
+    comp_array->size = size;
+#else
+    ecs_array_init(ecs, comp_array, size, ecs_entity_capacity(ecs));
+#endif
 
     ecs->comps[comp_id].constructor = constructor;
     ecs->comps[comp_id].destructor = destructor;
+    ecs->comps[comp_id].storage = ECS_STORAGE_INDEXED;
+
+    // Systems without requirements are interested in every component
+    for (ecs_id_t sys_id = 0; sys_id < ecs->system_count; sys_id++)
+    {
+        if (ecs_bitset_is_zero(&ecs->systems[sys_id].require_bits))
+            ecs_sys_list_insert(&ecs->require_index[comp_id], sys_id);
+    }
 
     ecs->comp_count++;
 
     return comp_id;
 }
 
+void ecs_set_component_storage(ecs_t* ecs, ecs_id_t comp_id, ecs_storage_t storage)
+{
+    ECS_ASSERT(ecs_is_not_null(ecs));
+    ECS_ASSERT(ecs_is_valid_component_id(comp_id));
+    ECS_ASSERT(ecs_is_component_ready(ecs, comp_id));
+
+    ecs_comp_t*  comp       = &ecs->comps[comp_id];
+    ecs_array_t* comp_array = &ecs->comp_arrays[comp_id];
+
+    if (storage == comp->storage)
+        return;
+
+#ifdef PICO_ECS_ARCHETYPES
+    // Archetype chunks are always packed, so the mode is only recorded
+    (void)comp_array;
+#else
+    size_t size = comp_array->size;
+
+    ecs_array_free(ecs, comp_array);
+
+    if (ECS_STORAGE_PACKED == storage)
+    {
+        // Packed components start small and grow with their population
+        ecs_array_init(ecs, comp_array, size, 16);
+        ecs_sparse_set_init(ecs, &comp->index, 16);
+    }
+    else
+    {
+        ecs_array_init(ecs, comp_array, size, ecs_entity_capacity(ecs));
+        ecs_sparse_set_free(ecs, &comp->index);
+    }
+#endif
+
+    comp->storage = storage;
+}
+
+void ecs_track_changes(ecs_t* ecs, ecs_id_t comp_id)
+{
+    ECS_ASSERT(ecs_is_not_null(ecs));
+    ECS_ASSERT(ecs_is_valid_component_id(comp_id));
+    ECS_ASSERT(ecs_is_component_ready(ecs, comp_id));
+
+    ecs_comp_t* comp = &ecs->comps[comp_id];
+
+    if (comp->ticks)
+        return;
+
+    // One tick per entity ID, grown along with the entity array so that
+    // marking never allocates
+    comp->ticks = (uint32_t*)ECS_MALLOC(ecs_entity_capacity(ecs) * sizeof(uint32_t),
+                                        ecs->mem_ctx);
+    memset(comp->ticks, 0, ecs->entity_count * sizeof(uint32_t));
+}
+
 ecs_id_t ecs_register_system(ecs_t* ecs,
                              ecs_system_fn system_cb,
                              ecs_added_fn add_cb,
@@ -715,11 +1786,66 @@ ecs_id_t ecs_register_system(ecs_t* ecs,
     sys->remove_cb = remove_cb;
     sys->udata = udata;
 
+    ecs_index_system(ecs, sys_id);
+
+    ecs->system_count++;
+
+    return sys_id;
+}
+
+#ifdef PICO_ECS_ARCHETYPES
+
+ecs_id_t ecs_register_chunk_system(ecs_t* ecs,
+                                   ecs_chunk_fn chunk_cb,
+                                   ecs_added_fn add_cb,
+                                   ecs_removed_fn remove_cb,
+                                   void* udata)
+{
+    ECS_ASSERT(ecs_is_not_null(ecs));
+    ECS_ASSERT(ecs->system_count < ECS_MAX_SYSTEMS);
+    ECS_ASSERT(NULL != chunk_cb);
+
+    ecs_id_t sys_id = ecs->system_count;
+    ecs_sys_t* sys = &ecs->systems[sys_id];
+
+    ecs_sparse_set_init(ecs, &sys->entity_ids, ecs->entity_count);
+    ecs_stack_init(ecs, &sys->archetypes, 8);
+
+    sys->active = true;
+    sys->chunk_cb = chunk_cb;
+    sys->add_cb = add_cb;
+    sys->remove_cb = remove_cb;
+    sys->udata = udata;
+
+    ecs_system_match_archetypes(ecs, sys);
+    ecs_index_system(ecs, sys_id);
+
     ecs->system_count++;
 
     return sys_id;
 }
 
+int ecs_chunk_count(ecs_chunk_t* chunk)
+{
+    ECS_ASSERT(ecs_is_not_null(chunk));
+    return chunk->count;
+}
+
+ecs_id_t* ecs_chunk_entities(ecs_chunk_t* chunk)
+{
+    ECS_ASSERT(ecs_is_not_null(chunk));
+    return chunk->entities;
+}
+
+void* ecs_chunk_column(ecs_chunk_t* chunk, ecs_id_t comp_id)
+{
+    ECS_ASSERT(ecs_is_not_null(chunk));
+    ECS_ASSERT(ecs_is_valid_component_id(comp_id));
+    return chunk->columns[comp_id];
+}
+
+#endif // PICO_ECS_ARCHETYPES
+
 void ecs_require_component(ecs_t* ecs, ecs_id_t sys_id, ecs_id_t comp_id)
 {
     ECS_ASSERT(ecs_is_not_null(ecs));
@@ -731,6 +1857,43 @@ void ecs_require_component(ecs_t* ecs, ecs_id_t sys_id, ecs_id_t comp_id)
     // Set system component bit for the specified component
     ecs_sys_t* sys = &ecs->systems[sys_id];
     ecs_bitset_flip(&sys->require_bits, comp_id, true);
+
+    // Update the component to system index
+    ecs_index_system(ecs, sys_id);
+
+    // Assume the worst when scheduling
+    ecs_declare_component_access(ecs, sys_id, comp_id, ECS_ACCESS_WRITE);
+
+#ifdef PICO_ECS_ARCHETYPES
+    ecs_system_match_archetypes(ecs, sys);
+#endif
+}
+
+void ecs_require_component_access(ecs_t* ecs,
+                                  ecs_id_t sys_id,
+                                  ecs_id_t comp_id,
+                                  ecs_access_t access)
+{
+    ecs_require_component(ecs, sys_id, comp_id);
+    ecs_declare_component_access(ecs, sys_id, comp_id, access);
+}
+
+void ecs_declare_component_access(ecs_t* ecs,
+                                  ecs_id_t sys_id,
+                                  ecs_id_t comp_id,
+                                  ecs_access_t access)
+{
+    ECS_ASSERT(ecs_is_not_null(ecs));
+    ECS_ASSERT(ecs_is_valid_system_id(sys_id));
+    ECS_ASSERT(ecs_is_valid_component_id(comp_id));
+    ECS_ASSERT(ecs_is_system_ready(ecs, sys_id));
+    ECS_ASSERT(ecs_is_component_ready(ecs, comp_id));
+
+    ecs_sys_t* sys = &ecs->systems[sys_id];
+
+    // Writing implies reading
+    ecs_bitset_flip(&sys->read_bits,  comp_id, true);
+    ecs_bitset_flip(&sys->write_bits, comp_id, ECS_ACCESS_WRITE == access);
 }
 
 void ecs_exclude_component(ecs_t* ecs, ecs_id_t sys_id, ecs_id_t comp_id)
@@ -744,6 +1907,61 @@ void ecs_exclude_component(ecs_t* ecs, ecs_id_t sys_id, ecs_id_t comp_id)
     // Set system component bit for the specified component
     ecs_sys_t* sys = &ecs->systems[sys_id];
     ecs_bitset_flip(&sys->exclude_bits, comp_id, true);
+
+    // Update the component to system index
+    ecs_index_system(ecs, sys_id);
+
+#ifdef PICO_ECS_ARCHETYPES
+    ecs_system_match_archetypes(ecs, sys);
+#endif
+}
+
+void ecs_require_changed(ecs_t* ecs, ecs_id_t sys_id, ecs_id_t comp_id)
+{
+    ECS_ASSERT(ecs_is_not_null(ecs));
+    ECS_ASSERT(ecs_is_valid_system_id(sys_id));
+    ECS_ASSERT(ecs_is_valid_component_id(comp_id));
+    ECS_ASSERT(ecs_is_system_ready(ecs, sys_id));
+    ECS_ASSERT(ecs_is_component_ready(ecs, comp_id));
+    ECS_ASSERT(NULL != ecs->comps[comp_id].ticks);
+
+    ecs_sys_t* sys = &ecs->systems[sys_id];
+
+    ECS_ASSERT(ecs_bitset_test(&sys->require_bits, comp_id));
+
+#ifdef PICO_ECS_ARCHETYPES
+    // Chunk systems iterate whole chunks
+    ECS_ASSERT(NULL == sys->chunk_cb);
+#endif
+
+    for (size_t i = 0; i < sys->changed_comp_count; i++)
+    {
+        if (sys->changed_comps[i] == comp_id)
+            return;
+    }
+
+    sys->changed_comps[sys->changed_comp_count++] = comp_id;
+}
+
+void ecs_set_system_order(ecs_t* ecs,
+                          ecs_id_t sys_id,
+                          ecs_order_t order,
+                          ecs_sort_fn sort_cb)
+{
+    ECS_ASSERT(ecs_is_not_null(ecs));
+    ECS_ASSERT(ecs_is_valid_system_id(sys_id));
+    ECS_ASSERT(ecs_is_system_ready(ecs, sys_id));
+    ECS_ASSERT(ECS_ORDER_KEY != order || NULL != sort_cb);
+
+    ecs_sys_t* sys = &ecs->systems[sys_id];
+
+#ifdef PICO_ECS_ARCHETYPES
+    // Chunk systems iterate whole chunks
+    ECS_ASSERT(NULL == sys->chunk_cb);
+#endif
+
+    sys->order   = order;
+    sys->sort_cb = sort_cb;
 }
 
 void ecs_enable_system(ecs_t* ecs, ecs_id_t sys_id)
@@ -769,50 +1987,99 @@ void ecs_disable_system(ecs_t* ecs, ecs_id_t sys_id)
 ecs_id_t ecs_create(ecs_t* ecs)
 {
     ECS_ASSERT(ecs_is_not_null(ecs));
-
-    ecs_stack_t* pool = &ecs->entity_pool;
+    ECS_ASSERT(ecs_is_not_in_job(ecs));
 
     // If pool is empty, increase the number of entity IDs
-    if (0 == ecs_stack_size(pool))
+    ecs_reserve_entities(ecs, 1);
+
+    ecs_id_t index = ecs_stack_pop(&ecs->entity_pool);
+    ecs->entities[index].ready = true;
+
+    return ecs_entity_id(ecs, index);
+}
+
+void ecs_create_many(ecs_t* ecs,
+                     ecs_id_t* entities,
+                     int count,
+                     const ecs_id_t* comp_ids,
+                     int comp_count,
+                     const void* const* values)
+{
+    ECS_ASSERT(ecs_is_not_null(ecs));
+    ECS_ASSERT(ecs_is_not_in_job(ecs));
+    ECS_ASSERT(ecs_is_not_null(entities));
+    ECS_ASSERT(count >= 0);
+    ECS_ASSERT(comp_count >= 0);
+    ECS_ASSERT(0 == comp_count || ecs_is_not_null((void*)comp_ids));
+
+    // Build the signature shared by all of the new entities
+    ecs_bitset_t comp_bits;
+    memset(&comp_bits, 0, sizeof(ecs_bitset_t));
+
+    for (int i = 0; i < comp_count; i++)
+    {
+        ECS_ASSERT(ecs_is_valid_component_id(comp_ids[i]));
+        ECS_ASSERT(ecs_is_component_ready(ecs, comp_ids[i]));
+
+        ecs_bitset_flip(&comp_bits, comp_ids[i], true);
+    }
+
+    ecs_spawn_entities(ecs, entities, count, &comp_bits, comp_ids, comp_count);
+
+    // Initialize components
+    for (int j = 0; j < comp_count; j++)
     {
-        size_t old_count = ecs->entity_count;
-        size_t new_count = old_count + (old_count / 2) + 2;
+        ecs_id_t comp_id = comp_ids[j];
+        ecs_comp_t* comp = &ecs->comps[comp_id];
+        size_t size = ecs->comp_arrays[comp_id].size;
 
-        // Reallocates entities and zeros new ones
-        ecs->entities = (ecs_entity_t*)ecs_realloc_zero(ecs, ecs->entities,
-                                                        old_count * sizeof(ecs_entity_t),
-                                                        new_count * sizeof(ecs_entity_t));
+        const char* value = values ? (const char*)values[j] : NULL;
 
-        // Push new entity IDs into the pool
-        for (ecs_id_t id = old_count; id < new_count; id++)
+        for (int i = 0; i < count; i++)
         {
-            ecs_stack_push(ecs, pool, id);
-        }
+            void* ptr = ecs_get(ecs, entities[i], comp_id);
 
-        // Update entity count
-        ecs->entity_count = new_count;
-    }
+            if (value)
+            {
+                memcpy(ptr, value + size * i, size);
+            }
+            else
+            {
+                memset(ptr, 0, size);
 
-    ecs_id_t entity_id = ecs_stack_pop(pool);
-    ecs->entities[entity_id].ready = true;
+                if (comp->constructor)
+                    comp->constructor(ecs, entities[i], ptr, NULL);
+            }
+        }
+    }
 
-    return entity_id;
+    // Match the signature against each system once
+    ecs_sys_list_t systems;
+    ecs_match_systems(ecs, &comp_bits, &systems);
+    ecs_join_systems(ecs, entities, count, &systems);
 }
 
 bool ecs_is_ready(ecs_t* ecs, ecs_id_t entity_id)
 {
     ECS_ASSERT(ecs_is_not_null(ecs));
 
-    return ecs->entities[entity_id].ready;
+    ecs_id_t index = ECS_ID_INDEX(entity_id);
+
+    if (index >= ecs->entity_count || !ecs->entities[index].ready)
+        return false;
+
+    // Stale IDs carry an older generation
+    return ecs_entity_id(ecs, index) == entity_id;
 }
 
 void ecs_destroy(ecs_t* ecs, ecs_id_t entity_id)
 {
     ECS_ASSERT(ecs_is_not_null(ecs));
+    ECS_ASSERT(ecs_is_not_in_job(ecs));
     ECS_ASSERT(ecs_is_entity_ready(ecs, entity_id));
 
     // Load entity
-    ecs_entity_t* entity = &ecs->entities[entity_id];
+    ecs_entity_t* entity = &ecs->entities[ECS_ID_INDEX(entity_id)];
 
     // Remove entity from systems
     for (ecs_id_t sys_id = 0; sys_id < ecs->system_count; sys_id++)
@@ -828,9 +2095,12 @@ void ecs_destroy(ecs_t* ecs, ecs_id_t entity_id)
         }
     }
 
+    // Remove entity from queries
+    ecs_leave_queries(ecs, entity_id);
+
     // Push entity ID back into pool
     ecs_stack_t* pool = &ecs->entity_pool;
-    ecs_stack_push(ecs, pool, entity_id);
+    ecs_stack_push(ecs, pool, ECS_ID_INDEX(entity_id));
 
     // Loop through components and call the destructors
     for (ecs_id_t comp_id = 0; comp_id < ecs->comp_count; comp_id++)
@@ -847,9 +2117,20 @@ void ecs_destroy(ecs_t* ecs, ecs_id_t entity_id)
         }
     }
 
+    // Release component storage
+    ecs_entity_release(ecs, entity_id);
+
     // Reset entity (sets bitset to 0 and ready to false)
+#ifdef PICO_ECS_GENERATIONS
+    ecs_id_t generation = entity->generation;
     memset(entity, 0, sizeof(ecs_entity_t));
-}
+
+    // Invalidate existing IDs of the entity
+    entity->generation = (generation + 1) & ((ecs_id_t)-1 >> PICO_ECS_INDEX_BITS);
+#else
+    memset(entity, 0, sizeof(ecs_entity_t));
+#endif
+}
 
 bool ecs_has(ecs_t* ecs, ecs_id_t entity_id, ecs_id_t comp_id)
 {
@@ -858,7 +2139,7 @@ bool ecs_has(ecs_t* ecs, ecs_id_t entity_id, ecs_id_t comp_id)
     ECS_ASSERT(ecs_is_entity_ready(ecs, entity_id));
 
     // Load  entity
-    ecs_entity_t* entity = &ecs->entities[entity_id];
+    ecs_entity_t* entity = &ecs->entities[ECS_ID_INDEX(entity_id)];
 
     // Return true if the component belongs to the entity
     return ecs_bitset_test(&entity->comp_bits, comp_id);
@@ -871,32 +2152,73 @@ void* ecs_get(ecs_t* ecs, ecs_id_t entity_id, ecs_id_t comp_id)
     ECS_ASSERT(ecs_is_component_ready(ecs, comp_id));
     ECS_ASSERT(ecs_is_entity_ready(ecs, entity_id));
 
+    ecs_array_t* comp_array = &ecs->comp_arrays[comp_id];
+    ecs_comp_t*  comp       = &ecs->comps[comp_id];
+
+#ifdef PICO_ECS_ARCHETYPES
+    // Return pointer into the entity's archetype chunk
+    (void)comp;
+    (void)comp_array;
+
+    ecs_entity_t* entity = &ecs->entities[ECS_ID_INDEX(entity_id)];
+    ecs_archetype_t* arch = &ecs->archetypes[entity->archetype];
+
+    return ecs_archetype_slot(ecs, arch, entity->row, comp_id);
+#else
+    // Return pointer to packed component
+    //  idx0,  idx1,  idx2, ... (comp->index.sparse[eid])
+    // [comp0, comp1, comp2, ...]
+    if (ECS_STORAGE_PACKED == comp->storage)
+    {
+        size_t index = comp->index.sparse[ECS_ID_INDEX(entity_id)];
+        return (char*)comp_array->data + (comp_array->size * index);
+    }
+
     // Return pointer to component
     //  eid0,  eid1   eid2, ...
     // [comp0, comp1, comp2, ...]
-    ecs_array_t* comp_array = &ecs->comp_arrays[comp_id];
-    return (char*)comp_array->data + (comp_array->size * entity_id);
+    return (char*)comp_array->data + (comp_array->size * ECS_ID_INDEX(entity_id));
+#endif
+}
+
+void* ecs_get_mut(ecs_t* ecs, ecs_id_t entity_id, ecs_id_t comp_id)
+{
+    ecs_mark_changed(ecs, entity_id, comp_id);
+    return ecs_get(ecs, entity_id, comp_id);
+}
+
+void ecs_mark_changed(ecs_t* ecs, ecs_id_t entity_id, ecs_id_t comp_id)
+{
+    ECS_ASSERT(ecs_is_not_null(ecs));
+    ECS_ASSERT(ecs_is_valid_component_id(comp_id));
+    ECS_ASSERT(ecs_is_component_ready(ecs, comp_id));
+    ECS_ASSERT(ecs_is_entity_ready(ecs, entity_id));
+
+    uint32_t* ticks = ecs->comps[comp_id].ticks;
+
+    // Each entity has its own slot and the tick does not change while jobs
+    // are running, so concurrent marks do not interfere
+    if (ticks)
+        ticks[ECS_ID_INDEX(entity_id)] = ecs->tick;
 }
 
 void* ecs_add(ecs_t* ecs, ecs_id_t entity_id, ecs_id_t comp_id, void* args)
 {
     ECS_ASSERT(ecs_is_not_null(ecs));
+    ECS_ASSERT(ecs_is_not_in_job(ecs));
     ECS_ASSERT(ecs_is_valid_component_id(comp_id));
     ECS_ASSERT(ecs_is_entity_ready(ecs, entity_id));
     ECS_ASSERT(ecs_is_component_ready(ecs, comp_id));
 
     // Load entity
-    ecs_entity_t* entity = &ecs->entities[entity_id];
+    ecs_entity_t* entity = &ecs->entities[ECS_ID_INDEX(entity_id)];
 
     // Load component
     ecs_array_t* comp_array = &ecs->comp_arrays[comp_id];
     ecs_comp_t* comp = &ecs->comps[comp_id];
 
-    // Grow the component array
-    ecs_array_resize(ecs, comp_array, entity_id);
-
-    // Get pointer to component
-    void* ptr = ecs_get(ecs, entity_id, comp_id);
+    // Reserve storage and get pointer to component
+    void* ptr = ecs_comp_insert(ecs, entity_id, comp_id);
 
     // Zero component
     memset(ptr, 0, comp_array->size);
@@ -905,14 +2227,37 @@ void* ecs_add(ecs_t* ecs, ecs_id_t entity_id, ecs_id_t comp_id, void* args)
     if (comp->constructor)
         comp->constructor(ecs, entity_id, ptr, args);
 
+    // Adding a component counts as a change
+    if (comp->ticks)
+        comp->ticks[ECS_ID_INDEX(entity_id)] = ecs->tick;
+
     // Set entity component bit that determines which systems this entity
     // belongs to
     ecs_bitset_flip(&entity->comp_bits, comp_id, true);
 
-    // Add entity to systems
-    for (ecs_id_t sys_id = 0; sys_id < ecs->system_count; sys_id++)
+    ecs_update_queries(ecs, entity_id, comp_id);
+
+    // Remove entity from systems that exclude the component
+    ecs_sys_list_t* exclude_list = &ecs->exclude_index[comp_id];
+
+    for (size_t i = 0; i < exclude_list->count; i++)
     {
-        ecs_sys_t* sys = &ecs->systems[sys_id];
+        ecs_sys_t* sys = &ecs->systems[exclude_list->ids[i]];
+
+        if (ecs_sparse_set_remove(&sys->entity_ids, entity_id))
+        {
+            if (sys->remove_cb)
+                sys->remove_cb(ecs, entity_id, sys->udata);
+        }
+    }
+
+    // Add entity to systems. Only systems that require the component can
+    // start matching as a result of adding it
+    ecs_sys_list_t* require_list = &ecs->require_index[comp_id];
+
+    for (size_t i = 0; i < require_list->count; i++)
+    {
+        ecs_sys_t* sys = &ecs->systems[require_list->ids[i]];
 
         if (ecs_entity_system_test(&sys->require_bits, &sys->exclude_bits, &entity->comp_bits))
         {
@@ -928,15 +2273,306 @@ void* ecs_add(ecs_t* ecs, ecs_id_t entity_id, ecs_id_t comp_id, void* args)
     return ptr;
 }
 
+void ecs_add_many(ecs_t* ecs,
+                  const ecs_id_t* entities,
+                  int count,
+                  ecs_id_t comp_id,
+                  const void* values,
+                  void* args)
+{
+    ECS_ASSERT(ecs_is_not_null(ecs));
+    ECS_ASSERT(ecs_is_not_in_job(ecs));
+    ECS_ASSERT(ecs_is_valid_component_id(comp_id));
+    ECS_ASSERT(ecs_is_component_ready(ecs, comp_id));
+    ECS_ASSERT(count >= 0);
+
+    ecs_comp_t* comp = &ecs->comps[comp_id];
+    size_t size = ecs->comp_arrays[comp_id].size;
+
+    // Systems the entity leaves and joins, cached for the previous signature
+    ecs_bitset_t prev_bits;
+    bool have_prev = false;
+
+    ecs_id_t leave_ids[ECS_MAX_SYSTEMS];
+    ecs_id_t join_ids[ECS_MAX_SYSTEMS];
+    size_t leave_count = 0;
+    size_t join_count = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        ecs_id_t entity_id = entities[i];
+
+        ECS_ASSERT(ecs_is_entity_ready(ecs, entity_id));
+
+        void* ptr = ecs_comp_insert(ecs, entity_id, comp_id);
+
+        if (values)
+        {
+            memcpy(ptr, (const char*)values + size * i, size);
+        }
+        else
+        {
+            memset(ptr, 0, size);
+
+            if (comp->constructor)
+                comp->constructor(ecs, entity_id, ptr, args);
+        }
+
+        if (comp->ticks)
+            comp->ticks[ECS_ID_INDEX(entity_id)] = ecs->tick;
+
+        ecs_entity_t* entity = &ecs->entities[ECS_ID_INDEX(entity_id)];
+
+        if (!have_prev || !ecs_bitset_equal(&prev_bits, &entity->comp_bits))
+        {
+            prev_bits = entity->comp_bits;
+            have_prev = true;
+
+            ecs_bitset_t new_bits = prev_bits;
+            ecs_bitset_flip(&new_bits, comp_id, true);
+
+            ecs_sys_list_t* exclude_list = &ecs->exclude_index[comp_id];
+            ecs_sys_list_t* require_list = &ecs->require_index[comp_id];
+
+            leave_count = 0;
+            join_count = 0;
+
+            for (size_t j = 0; j < exclude_list->count; j++)
+                leave_ids[leave_count++] = exclude_list->ids[j];
+
+            for (size_t j = 0; j < require_list->count; j++)
+            {
+                ecs_sys_t* sys = &ecs->systems[require_list->ids[j]];
+
+                if (ecs_entity_system_test(&sys->require_bits, &sys->exclude_bits, &new_bits))
+                    join_ids[join_count++] = require_list->ids[j];
+            }
+        }
+
+        ecs_bitset_flip(&entity->comp_bits, comp_id, true);
+
+        ecs_update_queries(ecs, entity_id, comp_id);
+
+        for (size_t j = 0; j < leave_count; j++)
+        {
+            ecs_sys_t* sys = &ecs->systems[leave_ids[j]];
+
+            if (ecs_sparse_set_remove(&sys->entity_ids, entity_id))
+            {
+                if (sys->remove_cb)
+                    sys->remove_cb(ecs, entity_id, sys->udata);
+            }
+        }
+
+        for (size_t j = 0; j < join_count; j++)
+        {
+            ecs_sys_t* sys = &ecs->systems[join_ids[j]];
+
+            if (ecs_sparse_set_add(ecs, &sys->entity_ids, entity_id))
+            {
+                if (sys->add_cb)
+                    sys->add_cb(ecs, entity_id, sys->udata);
+            }
+        }
+    }
+}
+
+ecs_id_t ecs_register_prefab(ecs_t* ecs)
+{
+    ECS_ASSERT(ecs_is_not_null(ecs));
+
+    // Grow prefab array
+    if (ecs->prefab_count == ecs->prefab_capacity)
+    {
+        ecs->prefab_capacity += (ecs->prefab_capacity / 2) + 2;
+        ecs->prefabs = (ecs_prefab_t*)ECS_REALLOC(ecs->prefabs,
+                                                  ecs->prefab_capacity * sizeof(ecs_prefab_t),
+                                                  ecs->mem_ctx);
+    }
+
+    ecs_id_t prefab_id = ecs->prefab_count++;
+
+    memset(&ecs->prefabs[prefab_id], 0, sizeof(ecs_prefab_t));
+
+    return prefab_id;
+}
+
+void* ecs_prefab_add(ecs_t* ecs, ecs_id_t prefab_id, ecs_id_t comp_id)
+{
+    ECS_ASSERT(ecs_is_not_null(ecs));
+    ECS_ASSERT(ecs_is_prefab_ready(ecs, prefab_id));
+    ECS_ASSERT(ecs_is_valid_component_id(comp_id));
+    ECS_ASSERT(ecs_is_component_ready(ecs, comp_id));
+
+    ecs_prefab_t* prefab = &ecs->prefabs[prefab_id];
+
+    // Adding a component twice returns the existing instance
+    if (ecs_bitset_test(&prefab->comp_bits, comp_id))
+        return prefab->values[comp_id];
+
+    size_t size = ecs->comp_arrays[comp_id].size;
+
+    prefab->values[comp_id] = ECS_MALLOC(size, ecs->mem_ctx);
+    memset(prefab->values[comp_id], 0, size);
+
+    ecs_bitset_flip(&prefab->comp_bits, comp_id, true);
+    prefab->comp_ids[prefab->comp_count++] = comp_id;
+
+    // The signature changed, so the cached systems are stale
+    prefab->matched = false;
+
+    return prefab->values[comp_id];
+}
+
+ecs_id_t ecs_instantiate(ecs_t* ecs, ecs_id_t prefab_id)
+{
+    ecs_id_t entity_id;
+    ecs_instantiate_many(ecs, prefab_id, &entity_id, 1);
+    return entity_id;
+}
+
+void ecs_instantiate_many(ecs_t* ecs, ecs_id_t prefab_id, ecs_id_t* entities, int count)
+{
+    ECS_ASSERT(ecs_is_not_null(ecs));
+    ECS_ASSERT(ecs_is_not_in_job(ecs));
+    ECS_ASSERT(ecs_is_prefab_ready(ecs, prefab_id));
+    ECS_ASSERT(ecs_is_not_null(entities));
+    ECS_ASSERT(count >= 0);
+
+    ecs_prefab_t* prefab = &ecs->prefabs[prefab_id];
+
+    ecs_spawn_entities(ecs, entities, count, &prefab->comp_bits,
+                       prefab->comp_ids, (int)prefab->comp_count);
+
+    // Copy default components
+    for (size_t j = 0; j < prefab->comp_count; j++)
+    {
+        ecs_id_t comp_id = prefab->comp_ids[j];
+        size_t size = ecs->comp_arrays[comp_id].size;
+
+        for (int i = 0; i < count; i++)
+            memcpy(ecs_get(ecs, entities[i], comp_id), prefab->values[comp_id], size);
+    }
+
+    // Resolve matching systems if the signature or the systems have changed
+    if (!prefab->matched || prefab->system_version != ecs->system_version)
+    {
+        ecs_match_systems(ecs, &prefab->comp_bits, &prefab->systems);
+        prefab->system_version = ecs->system_version;
+        prefab->matched = true;
+    }
+
+    ecs_join_systems(ecs, entities, count, &prefab->systems);
+}
+
+ecs_id_t ecs_register_query(ecs_t* ecs,
+                            const ecs_id_t* require,
+                            int require_count,
+                            const ecs_id_t* exclude,
+                            int exclude_count)
+{
+    ECS_ASSERT(ecs_is_not_null(ecs));
+    ECS_ASSERT(require_count >= 0 && exclude_count >= 0);
+
+    // Grow query array
+    if (ecs->query_count == ecs->query_capacity)
+    {
+        ecs->query_capacity += (ecs->query_capacity / 2) + 2;
+        ecs->queries = (ecs_query_t*)ECS_REALLOC(ecs->queries,
+                                                 ecs->query_capacity * sizeof(ecs_query_t),
+                                                 ecs->mem_ctx);
+    }
+
+    ecs_id_t query_id = ecs->query_count++;
+    ecs_query_t* query = &ecs->queries[query_id];
+
+    ecs_make_bits(&query->require_bits, require, require_count);
+    ecs_make_bits(&query->exclude_bits, exclude, exclude_count);
+
+    ecs_sparse_set_init(ecs, &query->entity_ids, ecs->entity_count);
+
+    // Pick up existing entities, afterwards the query is maintained
+    // incrementally
+    for (ecs_id_t index = 0; index < ecs->entity_count; index++)
+    {
+        ecs_entity_t* entity = &ecs->entities[index];
+
+        if (entity->ready && !ecs_bitset_is_zero(&entity->comp_bits) &&
+            ecs_entity_system_test(&query->require_bits, &query->exclude_bits, &entity->comp_bits))
+        {
+            ecs_sparse_set_add(ecs, &query->entity_ids, ecs_entity_id(ecs, index));
+        }
+    }
+
+    return query_id;
+}
+
+int ecs_query_count(ecs_t* ecs, ecs_id_t query_id)
+{
+    ECS_ASSERT(ecs_is_not_null(ecs));
+    ECS_ASSERT(ecs_is_query_ready(ecs, query_id));
+
+    return (int)ecs->queries[query_id].entity_ids.size;
+}
+
+ecs_id_t* ecs_query_entities(ecs_t* ecs, ecs_id_t query_id)
+{
+    ECS_ASSERT(ecs_is_not_null(ecs));
+    ECS_ASSERT(ecs_is_query_ready(ecs, query_id));
+
+    return ecs->queries[query_id].entity_ids.dense;
+}
+
+int ecs_scan(ecs_t* ecs,
+             const ecs_id_t* require,
+             int require_count,
+             const ecs_id_t* exclude,
+             int exclude_count,
+             ecs_id_t* entities,
+             int max_count)
+{
+    ECS_ASSERT(ecs_is_not_null(ecs));
+    ECS_ASSERT(require_count >= 0 && exclude_count >= 0);
+    ECS_ASSERT(max_count >= 0);
+
+    ecs_bitset_t require_bits, exclude_bits;
+
+    ecs_make_bits(&require_bits, require, require_count);
+    ecs_make_bits(&exclude_bits, exclude, exclude_count);
+
+    int count = 0;
+
+    // The bit sets are compared a word at a time, and empty entities fail on
+    // the first word test
+    for (ecs_id_t index = 0; index < ecs->entity_count; index++)
+    {
+        ecs_entity_t* entity = &ecs->entities[index];
+
+        if (!entity->ready || ecs_bitset_is_zero(&entity->comp_bits))
+            continue;
+
+        if (!ecs_entity_system_test(&require_bits, &exclude_bits, &entity->comp_bits))
+            continue;
+
+        if (entities && count < max_count)
+            entities[count] = ecs_entity_id(ecs, index);
+
+        count++;
+    }
+
+    return count;
+}
+
 void ecs_remove(ecs_t* ecs, ecs_id_t entity_id, ecs_id_t comp_id)
 {
     ECS_ASSERT(ecs_is_not_null(ecs));
+    ECS_ASSERT(ecs_is_not_in_job(ecs));
     ECS_ASSERT(ecs_is_valid_component_id(comp_id));
     ECS_ASSERT(ecs_is_component_ready(ecs, comp_id));
     ECS_ASSERT(ecs_is_entity_ready(ecs, entity_id));
 
     // Load entity
-    ecs_entity_t* entity = &ecs->entities[entity_id];
+    ecs_entity_t* entity = &ecs->entities[ECS_ID_INDEX(entity_id)];
 
     // Create bit mask with comp bit flipped on
     ecs_bitset_t comp_bit;
@@ -944,9 +2580,12 @@ void ecs_remove(ecs_t* ecs, ecs_id_t entity_id, ecs_id_t comp_id)
     memset(&comp_bit, 0, sizeof(ecs_bitset_t));
     ecs_bitset_flip(&comp_bit, comp_id, true);
 
-    for (ecs_id_t sys_id = 0; sys_id < ecs->system_count; sys_id++)
+    // Only systems that require the component (or nothing) can pass the test
+    ecs_sys_list_t* require_list = &ecs->require_index[comp_id];
+
+    for (size_t i = 0; i < require_list->count; i++)
     {
-        ecs_sys_t* sys = &ecs->systems[sys_id];
+        ecs_sys_t* sys = &ecs->systems[require_list->ids[i]];
 
         if (ecs_entity_system_test(&sys->require_bits, &sys->exclude_bits, &comp_bit))
         {
@@ -966,8 +2605,31 @@ void ecs_remove(ecs_t* ecs, ecs_id_t entity_id, ecs_id_t comp_id)
         comp->destructor(ecs, entity_id, ptr);
     }
 
+    // Release storage
+    ecs_comp_erase(ecs, entity_id, comp_id);
+
     // Reset the relevant component mask bit
     ecs_bitset_flip(&entity->comp_bits, comp_id, false);
+
+    ecs_update_queries(ecs, entity_id, comp_id);
+
+    // Add entity to systems that were only excluding it because of the
+    // component
+    ecs_sys_list_t* exclude_list = &ecs->exclude_index[comp_id];
+
+    for (size_t i = 0; i < exclude_list->count; i++)
+    {
+        ecs_sys_t* sys = &ecs->systems[exclude_list->ids[i]];
+
+        if (ecs_entity_system_test(&sys->require_bits, &sys->exclude_bits, &entity->comp_bits))
+        {
+            if (ecs_sparse_set_add(ecs, &sys->entity_ids, entity_id))
+            {
+                if (sys->add_cb)
+                    sys->add_cb(ecs, entity_id, sys->udata);
+            }
+        }
+    }
 }
 
 void ecs_queue_destroy(ecs_t* ecs, ecs_id_t entity_id)
@@ -975,7 +2637,13 @@ void ecs_queue_destroy(ecs_t* ecs, ecs_id_t entity_id)
     ECS_ASSERT(ecs_is_not_null(ecs));
     ECS_ASSERT(ecs_is_entity_ready(ecs, entity_id));
 
-    ecs_stack_push(ecs, &ecs->destroy_queue, entity_id);
+    ecs_stack_t* destroy_queue = &ecs->destroy_queue;
+
+    // Jobs record into their own queue
+    if (ecs_local_ecs == ecs)
+        destroy_queue = &ecs_local_queue->destroy_queue;
+
+    ecs_stack_push(ecs, destroy_queue, entity_id);
 }
 
 void ecs_queue_remove(ecs_t* ecs, ecs_id_t entity_id, ecs_id_t comp_id)
@@ -984,8 +2652,14 @@ void ecs_queue_remove(ecs_t* ecs, ecs_id_t entity_id, ecs_id_t comp_id)
     ECS_ASSERT(ecs_is_entity_ready(ecs, entity_id));
     ECS_ASSERT(ecs_has(ecs, entity_id, comp_id));
 
-    ecs_stack_push(ecs, &ecs->remove_queue, entity_id);
-    ecs_stack_push(ecs, &ecs->remove_queue, comp_id);
+    ecs_stack_t* remove_queue = &ecs->remove_queue;
+
+    // Jobs record into their own queue
+    if (ecs_local_ecs == ecs)
+        remove_queue = &ecs_local_queue->remove_queue;
+
+    ecs_stack_push(ecs, remove_queue, entity_id);
+    ecs_stack_push(ecs, remove_queue, comp_id);
 }
 
 ecs_ret_t ecs_update_system(ecs_t* ecs, ecs_id_t sys_id, ecs_dt_t dt)
@@ -993,6 +2667,7 @@ ecs_ret_t ecs_update_system(ecs_t* ecs, ecs_id_t sys_id, ecs_dt_t dt)
     ECS_ASSERT(ecs_is_not_null(ecs));
     ECS_ASSERT(ecs_is_valid_system_id(sys_id));
     ECS_ASSERT(ecs_is_system_ready(ecs, sys_id));
+    ECS_ASSERT(ecs_is_not_in_job(ecs));
     ECS_ASSERT(dt >= 0.0f);
 
     ecs_sys_t* sys = &ecs->systems[sys_id];
@@ -1000,14 +2675,23 @@ ecs_ret_t ecs_update_system(ecs_t* ecs, ecs_id_t sys_id, ecs_dt_t dt)
     if (!sys->active)
         return 0;
 
-    ecs_ret_t code = sys->system_cb(ecs,
-                     sys->entity_ids.dense,
-                     sys->entity_ids.size,
-                     dt,
-                     sys->udata);
+    ecs_ret_t code;
+
+    if (sys->slice_size > 0)
+    {
+        ecs_push_jobs(ecs, sys_id, dt);
+        code = ecs_run_jobs(ecs);
+    }
+    else
+    {
+        code = ecs_run_system(ecs, sys, dt);
+    }
+
+    // Changes made from here on are newer than this run
+    sys->last_tick = ecs->tick++;
 
-    ecs_flush_destroyed(ecs);
-    ecs_flush_removed(ecs);
+    ecs_flush_destroyed(ecs, &ecs->destroy_queue);
+    ecs_flush_removed(ecs, &ecs->remove_queue);
 
     return code;
 }
@@ -1028,61 +2712,1237 @@ ecs_ret_t ecs_update_systems(ecs_t* ecs, ecs_dt_t dt)
     return 0;
 }
 
-/*=============================================================================
- * Internal realloc wrapper
- *============================================================================*/
-void* ecs_realloc_zero(ecs_t* ecs, void* ptr, size_t old_size, size_t new_size)
+void ecs_set_parallel(ecs_t* ecs, ecs_parallel_fn parallel_cb, void* udata)
 {
-    (void)ecs;
-
-    ptr = ECS_REALLOC(ptr, new_size, ecs->mem_ctx);
-
-    if (new_size > old_size && ptr) {
-        size_t diff = new_size - old_size;
-        void* start = ((char*)ptr)+ old_size;
-        memset(start, 0, diff);
-    }
+    ECS_ASSERT(ecs_is_not_null(ecs));
 
-    return ptr;
+    ecs->parallel_cb    = parallel_cb;
+    ecs->parallel_udata = udata;
 }
 
-/*=============================================================================
- * Internal functions to flush destroyed entity and removed component
- *============================================================================*/
-
-static void ecs_flush_destroyed(ecs_t* ecs)
+void ecs_set_system_slices(ecs_t* ecs, ecs_id_t sys_id, int slice_size)
 {
-    ecs_stack_t* destroy_queue = &ecs->destroy_queue;
+    ECS_ASSERT(ecs_is_not_null(ecs));
+    ECS_ASSERT(ecs_is_valid_system_id(sys_id));
+    ECS_ASSERT(ecs_is_system_ready(ecs, sys_id));
+    ECS_ASSERT(slice_size >= 0);
 
-    for (size_t i = 0; i < destroy_queue->size; i++)
-    {
-        ecs_id_t entity_id = destroy_queue->array[i];
+    ecs_sys_t* sys = &ecs->systems[sys_id];
 
-        if (ecs_is_ready(ecs, entity_id))
-            ecs_destroy(ecs, entity_id);
-    }
+#ifdef PICO_ECS_ARCHETYPES
+    // Chunk systems are not sliced
+    ECS_ASSERT(NULL == sys->chunk_cb);
+#endif
 
-    destroy_queue->size = 0;
+    sys->slice_size = slice_size;
 }
 
-static void ecs_flush_removed(ecs_t* ecs)
+ecs_ret_t ecs_update_systems_parallel(ecs_t* ecs, ecs_dt_t dt)
 {
-    ecs_stack_t* remove_queue = &ecs->remove_queue;
+    ECS_ASSERT(ecs_is_not_null(ecs));
+    ECS_ASSERT(ecs_is_not_in_job(ecs));
+    ECS_ASSERT(dt >= 0.0f);
 
-    for (size_t i = 0; i < remove_queue->size; i += 2)
+    // Each system runs in the batch after the last earlier system it
+    // conflicts with
+    size_t batches[ECS_MAX_SYSTEMS];
+    size_t batch_count = 0;
+
+    for (ecs_id_t sys_id = 0; sys_id < ecs->system_count; sys_id++)
     {
-        ecs_id_t entity_id = remove_queue->array[i];
+        batches[sys_id] = 0;
 
-        if (ecs_is_ready(ecs, entity_id))
+        for (ecs_id_t prev_id = 0; prev_id < sys_id; prev_id++)
         {
-            ecs_id_t comp_id = remove_queue->array[i + 1];
-            ecs_remove(ecs, entity_id, comp_id);
+            if (batches[prev_id] + 1 > batches[sys_id] &&
+                ecs_systems_conflict(&ecs->systems[prev_id], &ecs->systems[sys_id]))
+            {
+                batches[sys_id] = batches[prev_id] + 1;
+            }
+        }
+
+        if (batches[sys_id] + 1 > batch_count)
+            batch_count = batches[sys_id] + 1;
+    }
+
+    for (size_t batch = 0; batch < batch_count; batch++)
+    {
+        for (ecs_id_t sys_id = 0; sys_id < ecs->system_count; sys_id++)
+        {
+            if (batches[sys_id] == batch && ecs->systems[sys_id].active)
+                ecs_push_jobs(ecs, sys_id, dt);
+        }
+
+        ecs_ret_t code = ecs_run_jobs(ecs);
+
+        // Systems in a batch share a tick
+        for (ecs_id_t sys_id = 0; sys_id < ecs->system_count; sys_id++)
+        {
+            if (batches[sys_id] == batch && ecs->systems[sys_id].active)
+                ecs->systems[sys_id].last_tick = ecs->tick;
+        }
+
+        ecs->tick++;
+
+        if (0 != code)
+            return code;
+    }
+
+    return 0;
+}
+
+size_t ecs_snapshot(ecs_t* ecs, void* buffer, size_t size)
+{
+    ECS_ASSERT(ecs_is_not_null(ecs));
+    ECS_ASSERT(ecs_is_not_in_job(ecs));
+
+    // Measure first so that nothing is written to a buffer that is too small
+    ecs_writer_t writer = { NULL, 0, 0 };
+    ecs_write_world(ecs, &writer);
+
+    size_t required = writer.offset;
+
+    if (buffer && required <= size)
+    {
+        writer.data   = (char*)buffer;
+        writer.size   = size;
+        writer.offset = 0;
+
+        ecs_write_world(ecs, &writer);
+    }
+
+    return required;
+}
+
+bool ecs_restore(ecs_t* ecs, const void* buffer, size_t size)
+{
+    ECS_ASSERT(ecs_is_not_null(ecs));
+    ECS_ASSERT(ecs_is_not_in_job(ecs));
+    ECS_ASSERT(ecs_is_not_null((void*)buffer));
+
+    ecs_reader_t reader = { (const char*)buffer, size, 0 };
+
+    // Reject snapshots of a differently configured ECS before changing
+    // anything
+    if (!ecs_read_header(ecs, &reader))
+        return false;
+
+    return ecs_read_world(ecs, &reader) && reader.offset == reader.size;
+}
+
+size_t ecs_snapshot_diff(const void* base,
+                         size_t base_size,
+                         const void* snapshot,
+                         size_t snapshot_size,
+                         void* delta,
+                         size_t delta_size)
+{
+    ECS_ASSERT(ecs_is_not_null((void*)base));
+    ECS_ASSERT(ecs_is_not_null((void*)snapshot));
+
+    ecs_writer_t writer = { NULL, 0, 0 };
+    ecs_write_delta(&writer, (const char*)base, base_size,
+                             (const char*)snapshot, snapshot_size);
+
+    size_t required = writer.offset;
+
+    if (delta && required <= delta_size)
+    {
+        writer.data   = (char*)delta;
+        writer.size   = delta_size;
+        writer.offset = 0;
+
+        ecs_write_delta(&writer, (const char*)base, base_size,
+                                 (const char*)snapshot, snapshot_size);
+    }
+
+    return required;
+}
+
+size_t ecs_snapshot_patch(const void* base,
+                          size_t base_size,
+                          const void* delta,
+                          size_t delta_size,
+                          void* snapshot,
+                          size_t snapshot_size)
+{
+    ECS_ASSERT(ecs_is_not_null((void*)base));
+    ECS_ASSERT(ecs_is_not_null((void*)delta));
+
+    ecs_reader_t reader = { (const char*)delta, delta_size, 0 };
+
+    uint64_t target_size;
+
+    if (!ecs_read(&reader, &target_size, sizeof(uint64_t)))
+        return 0;
+
+    if (!snapshot || target_size > snapshot_size)
+        return (size_t)target_size;
+
+    // Start from the base, then overwrite the runs that differ
+    memmove(snapshot, base, base_size < target_size ? base_size : (size_t)target_size);
+
+    while (reader.offset < reader.size)
+    {
+        uint64_t offset, length;
+
+        if (!ecs_read(&reader, &offset, sizeof(uint64_t)) ||
+            !ecs_read(&reader, &length, sizeof(uint64_t)))
+            return 0;
+
+        if (offset > target_size || length > target_size - offset)
+            return 0;
+
+        if (!ecs_read(&reader, (char*)snapshot + offset, (size_t)length))
+            return 0;
+    }
+
+    return (size_t)target_size;
+}
+
+/*=============================================================================
+ * Internal realloc wrapper
+ *============================================================================*/
+void* ecs_realloc_zero(ecs_t* ecs, void* ptr, size_t old_size, size_t new_size)
+{
+    (void)ecs;
+
+    ptr = ECS_REALLOC(ptr, new_size, ecs->mem_ctx);
+
+    if (new_size > old_size && ptr) {
+        size_t diff = new_size - old_size;
+        void* start = ((char*)ptr)+ old_size;
+        memset(start, 0, diff);
+    }
+
+    return ptr;
+}
+
+/*=============================================================================
+ * Internal functions to flush destroyed entity and removed component
+ *============================================================================*/
+
+static void ecs_flush_destroyed(ecs_t* ecs, ecs_stack_t* destroy_queue)
+{
+    for (size_t i = 0; i < destroy_queue->size; i++)
+    {
+        ecs_id_t entity_id = destroy_queue->array[i];
+
+        if (ecs_is_ready(ecs, entity_id))
+            ecs_destroy(ecs, entity_id);
+    }
+
+    destroy_queue->size = 0;
+}
+
+static void ecs_flush_removed(ecs_t* ecs, ecs_stack_t* remove_queue)
+{
+    for (size_t i = 0; i < remove_queue->size; i += 2)
+    {
+        ecs_id_t entity_id = remove_queue->array[i];
+
+        if (ecs_is_ready(ecs, entity_id))
+        {
+            ecs_id_t comp_id = remove_queue->array[i + 1];
+            ecs_remove(ecs, entity_id, comp_id);
+        }
+    }
+
+    remove_queue->size = 0;
+}
+
+/*=============================================================================
+ * Internal component to system index functions
+ *============================================================================*/
+
+static void ecs_sys_list_insert(ecs_sys_list_t* list, ecs_id_t sys_id)
+{
+    // Keep the list sorted so systems are visited in registration order
+    size_t i = 0;
+
+    while (i < list->count && list->ids[i] < sys_id)
+        i++;
+
+    if (i < list->count && list->ids[i] == sys_id)
+        return;
+
+    memmove(&list->ids[i + 1], &list->ids[i], (list->count - i) * sizeof(ecs_id_t));
+
+    list->ids[i] = sys_id;
+    list->count++;
+}
+
+static void ecs_sys_list_remove(ecs_sys_list_t* list, ecs_id_t sys_id)
+{
+    for (size_t i = 0; i < list->count; i++)
+    {
+        if (list->ids[i] == sys_id)
+        {
+            memmove(&list->ids[i], &list->ids[i + 1], (list->count - i - 1) * sizeof(ecs_id_t));
+            list->count--;
+            return;
+        }
+    }
+}
+
+static void ecs_index_system(ecs_t* ecs, ecs_id_t sys_id)
+{
+    ecs_sys_t* sys = &ecs->systems[sys_id];
+
+    // Invalidates systems cached by prefabs
+    ecs->system_version++;
+
+    // A system without requirements matches any entity with a component, so
+    // it is listed under every component
+    bool wildcard = ecs_bitset_is_zero(&sys->require_bits);
+
+    for (ecs_id_t comp_id = 0; comp_id < ecs->comp_count; comp_id++)
+    {
+        if (wildcard || ecs_bitset_test(&sys->require_bits, comp_id))
+            ecs_sys_list_insert(&ecs->require_index[comp_id], sys_id);
+        else
+            ecs_sys_list_remove(&ecs->require_index[comp_id], sys_id);
+
+        if (ecs_bitset_test(&sys->exclude_bits, comp_id))
+            ecs_sys_list_insert(&ecs->exclude_index[comp_id], sys_id);
+    }
+}
+
+/*=============================================================================
+ * Internal query functions
+ *============================================================================*/
+
+static void ecs_make_bits(ecs_bitset_t* bits, const ecs_id_t* comp_ids, int comp_count)
+{
+    memset(bits, 0, sizeof(ecs_bitset_t));
+
+    for (int i = 0; i < comp_count; i++)
+    {
+        ECS_ASSERT(ecs_is_valid_component_id(comp_ids[i]));
+        ecs_bitset_flip(bits, comp_ids[i], true);
+    }
+}
+
+static void ecs_update_queries(ecs_t* ecs, ecs_id_t entity_id, ecs_id_t comp_id)
+{
+    ecs_entity_t* entity = &ecs->entities[ECS_ID_INDEX(entity_id)];
+
+    bool has_comps = !ecs_bitset_is_zero(&entity->comp_bits);
+
+    for (ecs_id_t query_id = 0; query_id < ecs->query_count; query_id++)
+    {
+        ecs_query_t* query = &ecs->queries[query_id];
+
+        // Only queries that mention the component (or require nothing) can
+        // change their result
+        if (!ecs_bitset_test(&query->require_bits, comp_id) &&
+            !ecs_bitset_test(&query->exclude_bits, comp_id) &&
+            !ecs_bitset_is_zero(&query->require_bits))
+        {
+            continue;
+        }
+
+        if (has_comps &&
+            ecs_entity_system_test(&query->require_bits, &query->exclude_bits, &entity->comp_bits))
+        {
+            ecs_sparse_set_add(ecs, &query->entity_ids, entity_id);
+        }
+        else
+        {
+            ecs_sparse_set_remove(&query->entity_ids, entity_id);
+        }
+    }
+}
+
+static void ecs_leave_queries(ecs_t* ecs, ecs_id_t entity_id)
+{
+    for (ecs_id_t query_id = 0; query_id < ecs->query_count; query_id++)
+    {
+        ecs_sparse_set_remove(&ecs->queries[query_id].entity_ids, entity_id);
+    }
+}
+
+/*=============================================================================
+ * Internal system execution functions
+ *============================================================================*/
+
+static ecs_ret_t ecs_run_system(ecs_t* ecs, ecs_sys_t* sys, ecs_dt_t dt)
+{
+#ifdef PICO_ECS_ARCHETYPES
+    if (sys->chunk_cb)
+        return ecs_run_chunk_system(ecs, sys, dt);
+#endif
+
+    ecs_id_t* entities = NULL;
+    size_t entity_count = ecs_system_entities(ecs, sys, &entities);
+
+    return sys->system_cb(ecs,
+                          entities,
+                          entity_count,
+                          dt,
+                          sys->udata);
+}
+
+static size_t ecs_system_entities(ecs_t* ecs, ecs_sys_t* sys, ecs_id_t** entities)
+{
+    if (ECS_ORDER_NONE != sys->order)
+        ecs_sort_system_entities(ecs, sys);
+
+    if (0 == sys->changed_comp_count)
+    {
+        *entities = sys->entity_ids.dense;
+        return sys->entity_ids.size;
+    }
+
+    // Grow the scratch list to fit every entity in the system
+    if (sys->changed_capacity < sys->entity_ids.size)
+    {
+        sys->changed_capacity = sys->entity_ids.size;
+        sys->changed_ids = (ecs_id_t*)ECS_REALLOC(sys->changed_ids,
+                                                  sys->changed_capacity * sizeof(ecs_id_t),
+                                                  ecs->mem_ctx);
+    }
+
+    // Collect entities with a component that changed after the last run
+    size_t count = 0;
+
+    for (size_t i = 0; i < sys->entity_ids.size; i++)
+    {
+        ecs_id_t entity_id = sys->entity_ids.dense[i];
+
+        for (size_t j = 0; j < sys->changed_comp_count; j++)
+        {
+            if (ecs->comps[sys->changed_comps[j]].ticks[ECS_ID_INDEX(entity_id)] > sys->last_tick)
+            {
+                sys->changed_ids[count++] = entity_id;
+                break;
+            }
+        }
+    }
+
+    *entities = sys->changed_ids;
+    return count;
+}
+
+static void ecs_sort_system_entities(ecs_t* ecs, ecs_sys_t* sys)
+{
+    ecs_sparse_set_t* set = &sys->entity_ids;
+
+    if (set->size < 2)
+        return;
+
+    // Grow the scratch list to fit a key for every entity
+    if (sys->sort_capacity < set->size)
+    {
+        sys->sort_capacity = set->size;
+        sys->sort_keys = (uint64_t*)ECS_REALLOC(sys->sort_keys,
+                                                sys->sort_capacity * sizeof(uint64_t),
+                                                ecs->mem_ctx);
+    }
+
+    uint64_t* keys = sys->sort_keys;
+
+    for (size_t i = 0; i < set->size; i++)
+    {
+        if (ECS_ORDER_KEY == sys->order)
+            keys[i] = sys->sort_cb(ecs, set->dense[i], sys->udata);
+        else
+            keys[i] = ECS_ID_INDEX(set->dense[i]);
+    }
+
+    // Insertion sort, linear if the entities are (nearly) in order already
+    size_t first_moved = set->size;
+
+    for (size_t i = 1; i < set->size; i++)
+    {
+        uint64_t key = keys[i];
+        ecs_id_t entity_id = set->dense[i];
+
+        size_t j = i;
+
+        while (j > 0 && keys[j - 1] > key)
+        {
+            keys[j] = keys[j - 1];
+            set->dense[j] = set->dense[j - 1];
+            j--;
+        }
+
+        if (j != i)
+        {
+            keys[j] = key;
+            set->dense[j] = entity_id;
+
+            if (j < first_moved)
+                first_moved = j;
+        }
+    }
+
+    // Update the sparse indices of entities that moved
+    for (size_t i = first_moved; i < set->size; i++)
+    {
+        set->sparse[ECS_ID_INDEX(set->dense[i])] = i;
+    }
+}
+
+static void ecs_push_job(ecs_t* ecs, ecs_job_t* job)
+{
+    // Grow job arrays, each job has its own queues
+    if (ecs->job_count == ecs->job_capacity)
+    {
+        size_t old_capacity = ecs->job_capacity;
+        size_t new_capacity = old_capacity + (old_capacity / 2) + ECS_MAX_SYSTEMS;
+
+        ecs->jobs = (ecs_job_t*)ECS_REALLOC(ecs->jobs,
+                                            new_capacity * sizeof(ecs_job_t),
+                                            ecs->mem_ctx);
+
+        ecs->job_queues = (ecs_queue_t*)ECS_REALLOC(ecs->job_queues,
+                                                    new_capacity * sizeof(ecs_queue_t),
+                                                    ecs->mem_ctx);
+
+        for (size_t i = old_capacity; i < new_capacity; i++)
+        {
+            ecs_stack_init(ecs, &ecs->job_queues[i].destroy_queue, 16);
+            ecs_stack_init(ecs, &ecs->job_queues[i].remove_queue,  32);
+        }
+
+        ecs->job_capacity = new_capacity;
+    }
+
+    ecs->jobs[ecs->job_count++] = *job;
+}
+
+static void ecs_push_jobs(ecs_t* ecs, ecs_id_t sys_id, ecs_dt_t dt)
+{
+    ecs_sys_t* sys = &ecs->systems[sys_id];
+
+    ecs_job_t job;
+    memset(&job, 0, sizeof(ecs_job_t));
+
+    job.sys_id = sys_id;
+    job.dt     = dt;
+
+    if (0 == sys->slice_size)
+    {
+        ecs_push_job(ecs, &job);
+        return;
+    }
+
+    // One job per slice
+    ecs_id_t* entities = NULL;
+
+    size_t entity_count = ecs_system_entities(ecs, sys, &entities);
+    size_t slice_size   = (size_t)sys->slice_size;
+
+    job.slice = true;
+
+    for (size_t offset = 0; offset < entity_count; offset += slice_size)
+    {
+        job.entities = entities + offset;
+        job.count    = entity_count - offset < slice_size ? entity_count - offset : slice_size;
+
+        ecs_push_job(ecs, &job);
+    }
+}
+
+static void ecs_run_job(void* data, int index)
+{
+    ecs_t* ecs = (ecs_t*)data;
+    ecs_job_t* job = &ecs->jobs[index];
+    ecs_sys_t* sys = &ecs->systems[job->sys_id];
+
+    // Route queued operations to the job's own queue
+    ecs_t*       prev_ecs   = ecs_local_ecs;
+    ecs_queue_t* prev_queue = ecs_local_queue;
+
+    ecs_local_ecs   = ecs;
+    ecs_local_queue = &ecs->job_queues[index];
+
+    if (job->slice)
+    {
+        job->code = sys->system_cb(ecs,
+                                   job->entities,
+                                   job->count,
+                                   job->dt,
+                                   sys->udata);
+    }
+    else
+    {
+        job->code = ecs_run_system(ecs, sys, job->dt);
+    }
+
+    ecs_local_ecs   = prev_ecs;
+    ecs_local_queue = prev_queue;
+}
+
+static ecs_ret_t ecs_run_jobs(ecs_t* ecs)
+{
+    int job_count = (int)ecs->job_count;
+
+    if (0 == job_count)
+        return 0;
+
+    if (ecs->parallel_cb)
+    {
+        ecs->parallel_cb(ecs_run_job, ecs, job_count, ecs->parallel_udata);
+    }
+    else
+    {
+        for (int i = 0; i < job_count; i++)
+        {
+            ecs_run_job(ecs, i);
+        }
+    }
+
+    // Barrier: apply deferred operations in job order
+    for (int i = 0; i < job_count; i++)
+    {
+        ecs_queue_t* queue = &ecs->job_queues[i];
+
+        ecs_flush_destroyed(ecs, &queue->destroy_queue);
+        ecs_flush_removed(ecs, &queue->remove_queue);
+    }
+
+    ecs->job_count = 0;
+
+    // Report the first failure in job order
+    for (int i = 0; i < job_count; i++)
+    {
+        if (0 != ecs->jobs[i].code)
+            return ecs->jobs[i].code;
+    }
+
+    return 0;
+}
+
+static bool ecs_systems_conflict(ecs_sys_t* sys1, ecs_sys_t* sys2)
+{
+    // Systems that have not declared their access run on their own
+    if (ecs_bitset_is_zero(&sys1->read_bits) || ecs_bitset_is_zero(&sys2->read_bits))
+        return true;
+
+    ecs_bitset_t overlap = ecs_bitset_and(&sys1->write_bits, &sys2->read_bits);
+
+    if (ecs_bitset_true(&overlap))
+        return true;
+
+    overlap = ecs_bitset_and(&sys2->write_bits, &sys1->read_bits);
+
+    return ecs_bitset_true(&overlap);
+}
+
+/*=============================================================================
+ * Internal entity pool functions
+ *============================================================================*/
+
+static ecs_id_t ecs_entity_id(ecs_t* ecs, ecs_id_t index)
+{
+#ifdef PICO_ECS_GENERATIONS
+    return ECS_MAKE_ID(index, ecs->entities[index].generation);
+#else
+    (void)ecs;
+    return index;
+#endif
+}
+
+static size_t ecs_entity_capacity(ecs_t* ecs)
+{
+    return ecs->reserved_count ? ecs->reserved_count : ecs->entity_count;
+}
+
+static void ecs_reserve_entities(ecs_t* ecs, size_t count)
+{
+    ecs_stack_t* pool = &ecs->entity_pool;
+
+    if ((size_t)ecs_stack_size(pool) >= count)
+        return;
+
+    size_t old_count = ecs->entity_count;
+    size_t new_count = old_count;
+
+    // Grow until the pool holds enough IDs
+    while (new_count - old_count + (size_t)ecs_stack_size(pool) < count)
+    {
+        new_count += (new_count / 2) + 2;
+    }
+
+    // Reserved storage cannot grow past the reservation
+    if (ecs->reserved_count && new_count > ecs->reserved_count)
+        new_count = ecs->reserved_count;
+
+    ECS_ASSERT(new_count - old_count + (size_t)ecs_stack_size(pool) >= count);
+
+    ecs_grow_entities(ecs, new_count);
+
+    // Push new entity IDs into the pool
+    for (ecs_id_t id = old_count; id < new_count; id++)
+    {
+        ecs_stack_push(ecs, pool, id);
+    }
+}
+
+static void ecs_grow_entities(ecs_t* ecs, size_t new_count)
+{
+    size_t old_count = ecs->entity_count;
+
+#ifdef PICO_ECS_GENERATIONS
+    // The largest index is reserved so that no ID equals ECS_NULL
+    ECS_ASSERT(new_count <= ECS_INDEX_MASK);
+#endif
+
+    if (ecs->reserved_count)
+    {
+        ECS_ASSERT(new_count <= ecs->reserved_count);
+
+        // Storage is already allocated, only zero the new entities
+        if (new_count > old_count)
+        {
+            memset(&ecs->entities[old_count], 0,
+                   (new_count - old_count) * sizeof(ecs_entity_t));
+
+            for (ecs_id_t comp_id = 0; comp_id < ecs->comp_count; comp_id++)
+            {
+                uint32_t* ticks = ecs->comps[comp_id].ticks;
+
+                if (ticks)
+                    memset(&ticks[old_count], 0, (new_count - old_count) * sizeof(uint32_t));
+            }
+        }
+
+        ecs->entity_count = new_count;
+        return;
+    }
+
+    // Reallocates entities and zeros new ones
+    ecs->entities = (ecs_entity_t*)ecs_realloc_zero(ecs, ecs->entities,
+                                                    old_count * sizeof(ecs_entity_t),
+                                                    new_count * sizeof(ecs_entity_t));
+
+    // Grow change ticks of tracked components
+    for (ecs_id_t comp_id = 0; comp_id < ecs->comp_count; comp_id++)
+    {
+        ecs_comp_t* comp = &ecs->comps[comp_id];
+
+        if (comp->ticks)
+        {
+            comp->ticks = (uint32_t*)ecs_realloc_zero(ecs, comp->ticks,
+                                                      old_count * sizeof(uint32_t),
+                                                      new_count * sizeof(uint32_t));
+        }
+    }
+
+    // Update entity count
+    ecs->entity_count = new_count;
+}
+
+static void ecs_spawn_entities(ecs_t* ecs,
+                               ecs_id_t* entities,
+                               int count,
+                               ecs_bitset_t* comp_bits,
+                               const ecs_id_t* comp_ids,
+                               int comp_count)
+{
+    // Reserve all of the IDs up front
+    ecs_reserve_entities(ecs, count);
+
+    ecs_id_t max_index = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        ecs_id_t index = ecs_stack_pop(&ecs->entity_pool);
+        ecs_entity_t* entity = &ecs->entities[index];
+
+        entity->ready = true;
+        entity->comp_bits = *comp_bits;
+
+        if (index > max_index)
+            max_index = index;
+
+        entities[i] = ecs_entity_id(ecs, index);
+    }
+
+#ifdef PICO_ECS_ARCHETYPES
+    (void)max_index;
+
+    // Every entity lands in the same archetype
+    ecs_id_t arch_id = ecs_archetype_get(ecs, comp_bits);
+
+    for (int i = 0; i < count; i++)
+        ecs_archetype_move(ecs, entities[i], arch_id);
+#else
+    // Grow each component array once
+    for (int j = 0; j < comp_count; j++)
+    {
+        ecs_comp_t* comp = &ecs->comps[comp_ids[j]];
+
+        if (ECS_STORAGE_PACKED == comp->storage)
+            ecs_array_resize(ecs, &ecs->comp_arrays[comp_ids[j]], comp->index.size + count);
+        else
+            ecs_array_resize(ecs, &ecs->comp_arrays[comp_ids[j]], max_index);
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        for (int j = 0; j < comp_count; j++)
+            ecs_comp_insert(ecs, entities[i], comp_ids[j]);
+    }
+#endif
+
+    // New components count as changes
+    for (int j = 0; j < comp_count; j++)
+    {
+        uint32_t* ticks = ecs->comps[comp_ids[j]].ticks;
+
+        if (!ticks)
+            continue;
+
+        for (int i = 0; i < count; i++)
+            ticks[ECS_ID_INDEX(entities[i])] = ecs->tick;
+    }
+
+    // Match the signature against each query once
+    if (ecs_bitset_is_zero(comp_bits))
+        return;
+
+    for (ecs_id_t query_id = 0; query_id < ecs->query_count; query_id++)
+    {
+        ecs_query_t* query = &ecs->queries[query_id];
+
+        if (!ecs_entity_system_test(&query->require_bits, &query->exclude_bits, comp_bits))
+            continue;
+
+        for (int i = 0; i < count; i++)
+            ecs_sparse_set_add(ecs, &query->entity_ids, entities[i]);
+    }
+}
+
+static void ecs_match_systems(ecs_t* ecs, ecs_bitset_t* comp_bits, ecs_sys_list_t* list)
+{
+    list->count = 0;
+
+    // Entities without components do not belong to any system
+    if (ecs_bitset_is_zero(comp_bits))
+        return;
+
+    for (ecs_id_t sys_id = 0; sys_id < ecs->system_count; sys_id++)
+    {
+        ecs_sys_t* sys = &ecs->systems[sys_id];
+
+        if (ecs_entity_system_test(&sys->require_bits, &sys->exclude_bits, comp_bits))
+            list->ids[list->count++] = sys_id;
+    }
+}
+
+static void ecs_join_systems(ecs_t* ecs,
+                             const ecs_id_t* entities,
+                             int count,
+                             ecs_sys_list_t* list)
+{
+    for (size_t j = 0; j < list->count; j++)
+    {
+        ecs_sys_t* sys = &ecs->systems[list->ids[j]];
+
+        for (int i = 0; i < count; i++)
+        {
+            if (ecs_sparse_set_add(ecs, &sys->entity_ids, entities[i]))
+            {
+                if (sys->add_cb)
+                    sys->add_cb(ecs, entities[i], sys->udata);
+            }
+        }
+    }
+}
+
+/*=============================================================================
+ * Internal component storage functions
+ *============================================================================*/
+
+#ifdef PICO_ECS_ARCHETYPES
+
+static void* ecs_comp_insert(ecs_t* ecs, ecs_id_t entity_id, ecs_id_t comp_id)
+{
+    ecs_entity_t* entity = &ecs->entities[ECS_ID_INDEX(entity_id)];
+
+    // Move the entity to the archetype that includes the component
+    if (!ecs_bitset_test(&entity->comp_bits, comp_id))
+    {
+        ecs_id_t dst_id = ecs_archetype_edge(ecs, entity->archetype, comp_id, true);
+        ecs_archetype_move(ecs, entity_id, dst_id);
+    }
+
+    return ecs_get(ecs, entity_id, comp_id);
+}
+
+static void ecs_comp_erase(ecs_t* ecs, ecs_id_t entity_id, ecs_id_t comp_id)
+{
+    ecs_entity_t* entity = &ecs->entities[ECS_ID_INDEX(entity_id)];
+
+    // Move the entity to the archetype that lacks the component
+    if (ecs_bitset_test(&entity->comp_bits, comp_id))
+    {
+        ecs_id_t dst_id = ecs_archetype_edge(ecs, entity->archetype, comp_id, false);
+        ecs_archetype_move(ecs, entity_id, dst_id);
+    }
+}
+
+static void ecs_entity_release(ecs_t* ecs, ecs_id_t entity_id)
+{
+    ecs_entity_t* entity = &ecs->entities[ECS_ID_INDEX(entity_id)];
+
+    if (0 != entity->archetype)
+        ecs_archetype_erase(ecs, entity->archetype, entity->row);
+
+    entity->archetype = 0;
+}
+
+#else
+
+static void* ecs_comp_insert(ecs_t* ecs, ecs_id_t entity_id, ecs_id_t comp_id)
+{
+    ecs_array_t* comp_array = &ecs->comp_arrays[comp_id];
+    ecs_comp_t*  comp       = &ecs->comps[comp_id];
+
+    if (ECS_STORAGE_PACKED == comp->storage)
+    {
+        // Append a slot unless the entity already has one (re-adding a
+        // component reuses the existing slot)
+        if (ecs_sparse_set_add(ecs, &comp->index, entity_id))
+        {
+            ecs_array_resize(ecs, comp_array, comp->index.size);
+            comp_array->count = comp->index.size;
+        }
+    }
+    else
+    {
+        // Grow the component array
+        ecs_array_resize(ecs, comp_array, ECS_ID_INDEX(entity_id));
+    }
+
+    return ecs_get(ecs, entity_id, comp_id);
+}
+
+static void ecs_comp_erase(ecs_t* ecs, ecs_id_t entity_id, ecs_id_t comp_id)
+{
+    ecs_array_t* comp_array = &ecs->comp_arrays[comp_id];
+    ecs_comp_t*  comp       = &ecs->comps[comp_id];
+
+    // Indexed slots are simply left behind
+    if (ECS_STORAGE_PACKED != comp->storage)
+        return;
+
+    size_t index = ecs_sparse_set_find(&comp->index, entity_id);
+
+    if (ECS_NULL == index)
+        return;
+
+    // Move the last slot into the hole, mirroring the swap performed by
+    // ecs_sparse_set_remove
+    size_t last = comp->index.size - 1;
+
+    if (index != last)
+    {
+        memcpy((char*)comp_array->data + comp_array->size * index,
+               (char*)comp_array->data + comp_array->size * last,
+               comp_array->size);
+    }
+
+    ecs_sparse_set_remove(&comp->index, entity_id);
+    comp_array->count = comp->index.size;
+}
+
+static void ecs_entity_release(ecs_t* ecs, ecs_id_t entity_id)
+{
+    ecs_entity_t* entity = &ecs->entities[ECS_ID_INDEX(entity_id)];
+
+    for (ecs_id_t comp_id = 0; comp_id < ecs->comp_count; comp_id++)
+    {
+        if (ecs_bitset_test(&entity->comp_bits, comp_id))
+            ecs_comp_erase(ecs, entity_id, comp_id);
+    }
+}
+
+#endif // PICO_ECS_ARCHETYPES
+
+/*=============================================================================
+ * Internal archetype functions
+ *============================================================================*/
+
+#ifdef PICO_ECS_ARCHETYPES
+
+// Alignment of columns within a chunk
+#define ECS_COLUMN_ALIGN 16
+
+static inline size_t ecs_align(size_t offset)
+{
+    return (offset + ECS_COLUMN_ALIGN - 1) & ~(size_t)(ECS_COLUMN_ALIGN - 1);
+}
+
+static ecs_id_t ecs_archetype_get(ecs_t* ecs, ecs_bitset_t* comp_bits)
+{
+    // Archetypes are few in number, so a linear search is sufficient. Most
+    // lookups are avoided altogether by caching add/remove edges
+    for (ecs_id_t arch_id = 0; arch_id < ecs->archetype_count; arch_id++)
+    {
+        if (ecs_bitset_equal(&ecs->archetypes[arch_id].comp_bits, comp_bits))
+            return arch_id;
+    }
+
+    // Grow archetype array
+    if (ecs->archetype_count == ecs->archetype_capacity)
+    {
+        ecs->archetype_capacity += (ecs->archetype_capacity / 2) + 2;
+        ecs->archetypes = (ecs_archetype_t*)ECS_REALLOC(ecs->archetypes,
+                                                        ecs->archetype_capacity * sizeof(ecs_archetype_t),
+                                                        ecs->mem_ctx);
+    }
+
+    ecs_id_t arch_id = ecs->archetype_count++;
+    ecs_archetype_t* arch = &ecs->archetypes[arch_id];
+
+    memset(arch, 0, sizeof(ecs_archetype_t));
+
+    arch->comp_bits = *comp_bits;
+
+    // Compute chunk layout: header, entity IDs, then one column per component
+    size_t offset = ecs_align(sizeof(ecs_chunk_t));
+    offset += ECS_CHUNK_SIZE * sizeof(ecs_id_t);
+
+    for (ecs_id_t comp_id = 0; comp_id < ECS_MAX_COMPONENTS; comp_id++)
+    {
+        arch->add_edges[comp_id]    = ECS_NULL;
+        arch->remove_edges[comp_id] = ECS_NULL;
+
+        if (comp_id < ecs->comp_count && ecs_bitset_test(comp_bits, comp_id))
+        {
+            offset = ecs_align(offset);
+            arch->offsets[comp_id] = offset;
+            arch->comp_ids[arch->comp_count++] = comp_id;
+            offset += ECS_CHUNK_SIZE * ecs->comp_arrays[comp_id].size;
+        }
+    }
+
+    arch->chunk_bytes = offset;
+
+    // Register the archetype with matching chunk systems
+    if (!ecs_bitset_is_zero(comp_bits))
+    {
+        for (ecs_id_t sys_id = 0; sys_id < ecs->system_count; sys_id++)
+        {
+            ecs_sys_t* sys = &ecs->systems[sys_id];
+
+            if (sys->chunk_cb &&
+                ecs_entity_system_test(&sys->require_bits, &sys->exclude_bits, comp_bits))
+            {
+                ecs_stack_push(ecs, &sys->archetypes, arch_id);
+            }
+        }
+    }
+
+    return arch_id;
+}
+
+static ecs_id_t ecs_archetype_edge(ecs_t* ecs, ecs_id_t arch_id, ecs_id_t comp_id, bool add)
+{
+    ecs_archetype_t* arch = &ecs->archetypes[arch_id];
+    ecs_id_t* edges = add ? arch->add_edges : arch->remove_edges;
+
+    if (ECS_NULL != edges[comp_id])
+        return edges[comp_id];
+
+    ecs_bitset_t comp_bits = arch->comp_bits;
+    ecs_bitset_flip(&comp_bits, comp_id, add);
+
+    // May reallocate the archetype array
+    ecs_id_t dst_id = ecs_archetype_get(ecs, &comp_bits);
+
+    arch = &ecs->archetypes[arch_id];
+    edges = add ? arch->add_edges : arch->remove_edges;
+    edges[comp_id] = dst_id;
+
+    return dst_id;
+}
+
+static size_t ecs_archetype_push(ecs_t* ecs, ecs_id_t arch_id, ecs_id_t entity_id)
+{
+    ecs_archetype_t* arch = &ecs->archetypes[arch_id];
+
+    size_t row = arch->count;
+    size_t chunk_index = row / ECS_CHUNK_SIZE;
+
+    // Allocate a new chunk if all existing chunks are full. Empty chunks are
+    // kept around and reused.
+    if (chunk_index == arch->chunk_count)
+    {
+        if (arch->chunk_count == arch->chunk_capacity)
+        {
+            arch->chunk_capacity += (arch->chunk_capacity / 2) + 2;
+            arch->chunks = (ecs_chunk_t**)ECS_REALLOC(arch->chunks,
+                                                      arch->chunk_capacity * sizeof(ecs_chunk_t*),
+                                                      ecs->mem_ctx);
+        }
+
+        ecs_chunk_t* chunk = (ecs_chunk_t*)ECS_MALLOC(arch->chunk_bytes, ecs->mem_ctx);
+
+        memset(chunk, 0, sizeof(ecs_chunk_t));
+
+        chunk->entities = (ecs_id_t*)((char*)chunk + ecs_align(sizeof(ecs_chunk_t)));
+
+        for (size_t i = 0; i < arch->comp_count; i++)
+        {
+            ecs_id_t comp_id = arch->comp_ids[i];
+            chunk->columns[comp_id] = (char*)chunk + arch->offsets[comp_id];
+        }
+
+        arch->chunks[arch->chunk_count++] = chunk;
+    }
+
+    ecs_chunk_t* chunk = arch->chunks[chunk_index];
+    chunk->entities[chunk->count++] = entity_id;
+
+    arch->count++;
+
+    return row;
+}
+
+static void ecs_archetype_erase(ecs_t* ecs, ecs_id_t arch_id, size_t row)
+{
+    ecs_archetype_t* arch = &ecs->archetypes[arch_id];
+
+    size_t last = arch->count - 1;
+
+    ecs_chunk_t* dst_chunk = arch->chunks[row  / ECS_CHUNK_SIZE];
+    ecs_chunk_t* src_chunk = arch->chunks[last / ECS_CHUNK_SIZE];
+
+    // Swap the last row into the hole so chunks remain contiguous
+    if (row != last)
+    {
+        size_t dst_slot = row  % ECS_CHUNK_SIZE;
+        size_t src_slot = last % ECS_CHUNK_SIZE;
+
+        ecs_id_t moved_id = src_chunk->entities[src_slot];
+        dst_chunk->entities[dst_slot] = moved_id;
+
+        for (size_t i = 0; i < arch->comp_count; i++)
+        {
+            ecs_id_t comp_id = arch->comp_ids[i];
+            size_t size = ecs->comp_arrays[comp_id].size;
+
+            memcpy((char*)dst_chunk->columns[comp_id] + size * dst_slot,
+                   (char*)src_chunk->columns[comp_id] + size * src_slot,
+                   size);
+        }
+
+        ecs->entities[ECS_ID_INDEX(moved_id)].row = row;
+    }
+
+    src_chunk->count--;
+    arch->count--;
+}
+
+static void ecs_archetype_move(ecs_t* ecs, ecs_id_t entity_id, ecs_id_t dst_id)
+{
+    ecs_entity_t* entity = &ecs->entities[ECS_ID_INDEX(entity_id)];
+
+    ecs_id_t src_id  = entity->archetype;
+    size_t   src_row = entity->row;
+
+    size_t dst_row = 0;
+
+    // Entities without components are not stored
+    if (0 != dst_id)
+    {
+        dst_row = ecs_archetype_push(ecs, dst_id, entity_id);
+
+        // Copy the components shared by both archetypes
+        if (0 != src_id)
+        {
+            ecs_archetype_t* src = &ecs->archetypes[src_id];
+            ecs_archetype_t* dst = &ecs->archetypes[dst_id];
+
+            for (size_t i = 0; i < dst->comp_count; i++)
+            {
+                ecs_id_t comp_id = dst->comp_ids[i];
+
+                if (ecs_bitset_test(&src->comp_bits, comp_id))
+                {
+                    memcpy(ecs_archetype_slot(ecs, dst, dst_row, comp_id),
+                           ecs_archetype_slot(ecs, src, src_row, comp_id),
+                           ecs->comp_arrays[comp_id].size);
+                }
+            }
+        }
+    }
+
+    if (0 != src_id)
+        ecs_archetype_erase(ecs, src_id, src_row);
+
+    entity->archetype = dst_id;
+    entity->row       = dst_row;
+}
+
+static inline void* ecs_archetype_slot(ecs_t* ecs, ecs_archetype_t* arch, size_t row, ecs_id_t comp_id)
+{
+    ecs_chunk_t* chunk = arch->chunks[row / ECS_CHUNK_SIZE];
+    return (char*)chunk->columns[comp_id] +
+           ecs->comp_arrays[comp_id].size * (row % ECS_CHUNK_SIZE);
+}
+
+static void ecs_archetype_free(ecs_t* ecs, ecs_archetype_t* arch)
+{
+    (void)ecs;
+
+    for (size_t i = 0; i < arch->chunk_count; i++)
+    {
+        ECS_FREE(arch->chunks[i], ecs->mem_ctx);
+    }
+
+    if (arch->chunks)
+        ECS_FREE(arch->chunks, ecs->mem_ctx);
+}
+
+static void ecs_system_match_archetypes(ecs_t* ecs, ecs_sys_t* sys)
+{
+    if (!sys->chunk_cb)
+        return;
+
+    sys->archetypes.size = 0;
+
+    // Skip the empty archetype (ID 0)
+    for (ecs_id_t arch_id = 1; arch_id < ecs->archetype_count; arch_id++)
+    {
+        ecs_archetype_t* arch = &ecs->archetypes[arch_id];
+
+        if (ecs_entity_system_test(&sys->require_bits, &sys->exclude_bits, &arch->comp_bits))
+            ecs_stack_push(ecs, &sys->archetypes, arch_id);
+    }
+}
+
+static ecs_ret_t ecs_run_chunk_system(ecs_t* ecs, ecs_sys_t* sys, ecs_dt_t dt)
+{
+    for (size_t i = 0; i < sys->archetypes.size; i++)
+    {
+        ecs_archetype_t* arch = &ecs->archetypes[sys->archetypes.array[i]];
+
+        for (size_t j = 0; j < arch->chunk_count; j++)
+        {
+            ecs_chunk_t* chunk = arch->chunks[j];
+
+            // Chunks are filled in order, so the first empty chunk marks the end
+            if (0 == chunk->count)
+                break;
+
+            ecs_ret_t code = sys->chunk_cb(ecs, chunk, dt, sys->udata);
+
+            if (0 != code)
+                return code;
         }
     }
 
-    remove_queue->size = 0;
+    return 0;
 }
 
+#endif // PICO_ECS_ARCHETYPES
+
 
 /*=============================================================================
  * Internal bitset functions
@@ -1242,219 +4102,686 @@ static void ecs_sparse_set_init(ecs_t* ecs, ecs_sparse_set_t* set, size_t capaci
     set->capacity = capacity;
     set->size = 0;
 
-    set->dense  = (ecs_id_t*)ECS_MALLOC(capacity * sizeof(ecs_id_t), ecs->mem_ctx);
-    set->sparse = (size_t*)  ECS_MALLOC(capacity * sizeof(size_t),   ecs->mem_ctx);
+    set->dense  = (ecs_id_t*)ECS_MALLOC(capacity * sizeof(ecs_id_t), ecs->mem_ctx);
+    set->sparse = (size_t*)  ECS_MALLOC(capacity * sizeof(size_t),   ecs->mem_ctx);
+
+    memset(set->sparse, 0, capacity * sizeof(size_t));
+}
+
+static void ecs_sparse_set_free(ecs_t* ecs, ecs_sparse_set_t* set)
+{
+    ECS_ASSERT(ecs_is_not_null(ecs));
+    ECS_ASSERT(ecs_is_not_null(set));
+
+    (void)ecs;
+
+    ECS_FREE(set->dense,  ecs->mem_ctx);
+    ECS_FREE(set->sparse, ecs->mem_ctx);
+}
+
+static bool ecs_sparse_set_add(ecs_t* ecs, ecs_sparse_set_t* set, ecs_id_t id)
+{
+    ECS_ASSERT(ecs_is_not_null(ecs));
+    ECS_ASSERT(ecs_is_not_null(set));
+
+    (void)ecs;
+
+    // The sparse array is indexed by entity index, the dense array holds the
+    // full IDs
+    ecs_id_t index = ECS_ID_INDEX(id);
+
+    // Grow sparse set if necessary
+    if (index >= set->capacity)
+    {
+        size_t old_capacity = set->capacity;
+        size_t new_capacity = old_capacity;
+
+        // Calculate new capacity
+        while (new_capacity <= index)
+        {
+            new_capacity += (new_capacity / 2) + 2;
+        }
+
+        // Grow dense array
+        set->dense = (ecs_id_t*)ECS_REALLOC(set->dense,
+                                            new_capacity * sizeof(ecs_id_t),
+                                            ecs->mem_ctx);
+
+        // Grow sparse array and zero it
+        set->sparse = (size_t*)ecs_realloc_zero(ecs,
+                                                set->sparse,
+                                                old_capacity * sizeof(size_t),
+                                                new_capacity * sizeof(size_t));
+
+        // Set the new capacity
+        set->capacity = new_capacity;
+    }
+
+    // Check if ID exists within the set
+    if (ECS_NULL != ecs_sparse_set_find(set, id))
+        return false;
+
+    // Add ID to set
+    set->dense[set->size] = id;
+    set->sparse[index] = set->size;
+
+    set->size++;
+
+    return true;
+}
+
+static size_t ecs_sparse_set_find(ecs_sparse_set_t* set, ecs_id_t id)
+{
+    ECS_ASSERT(ecs_is_not_null(set));
+
+    ecs_id_t index = ECS_ID_INDEX(id);
+
+    // IDs beyond the capacity of the set were never added
+    if (index >= set->capacity)
+        return ECS_NULL;
+
+    if (set->sparse[index] < set->size && set->dense[set->sparse[index]] == id)
+        return set->sparse[index];
+    else
+        return ECS_NULL;
+}
+
+static bool ecs_sparse_set_remove(ecs_sparse_set_t* set, ecs_id_t id)
+{
+    ECS_ASSERT(ecs_is_not_null(set));
+
+    if (ECS_NULL == ecs_sparse_set_find(set, id))
+        return false;
+
+    // Swap and remove (changes order of array)
+    ecs_id_t tmp = set->dense[set->size - 1];
+    set->dense[set->sparse[ECS_ID_INDEX(id)]] = tmp;
+    set->sparse[ECS_ID_INDEX(tmp)] = set->sparse[ECS_ID_INDEX(id)];
+
+    set->size--;
+
+    return true;
+}
+
+/*=============================================================================
+ * Internal system entity add/remove functions
+ *============================================================================*/
+
+inline static bool ecs_entity_system_test(ecs_bitset_t* require_bits,
+                                          ecs_bitset_t* exclude_bits,
+                                          ecs_bitset_t* entity_bits)
+{
+    if (!ecs_bitset_is_zero(exclude_bits))
+    {
+        ecs_bitset_t overlap = ecs_bitset_and(entity_bits, exclude_bits);
+
+        if (ecs_bitset_true(&overlap))
+        {
+            return false;
+        }
+    }
+
+    ecs_bitset_t entity_and_require = ecs_bitset_and(entity_bits, require_bits);
+    return ecs_bitset_equal(&entity_and_require, require_bits);
+}
+
+/*=============================================================================
+ * Internal ID pool functions
+ *============================================================================*/
+
+inline static void ecs_stack_init(ecs_t* ecs, ecs_stack_t* stack, int capacity)
+{
+    ECS_ASSERT(ecs_is_not_null(ecs));
+    ECS_ASSERT(ecs_is_not_null(stack));
+    ECS_ASSERT(capacity > 0);
+
+    (void)ecs;
+
+    stack->size = 0;
+    stack->capacity = capacity;
+    stack->array = (ecs_id_t*)ECS_MALLOC(capacity * sizeof(ecs_id_t), ecs->mem_ctx);
+}
+
+inline static void ecs_stack_free(ecs_t* ecs, ecs_stack_t* stack)
+{
+    ECS_ASSERT(ecs_is_not_null(ecs));
+    ECS_ASSERT(ecs_is_not_null(stack));
+
+    (void)ecs;
+
+    ECS_FREE(stack->array, ecs->mem_ctx);
+}
+
+inline static void ecs_stack_push(ecs_t* ecs, ecs_stack_t* stack, ecs_id_t id)
+{
+    ECS_ASSERT(ecs_is_not_null(ecs));
+    ECS_ASSERT(ecs_is_not_null(stack));
+    ECS_ASSERT(stack->capacity > 0);
+
+    (void)ecs;
+
+    if (stack->size == stack->capacity)
+    {
+        stack->capacity += (stack->capacity / 2) + 2;
+
+        stack->array = (ecs_id_t*)ECS_REALLOC(stack->array,
+                                              stack->capacity * sizeof(ecs_id_t),
+                                              ecs->mem_ctx);
+    }
+
+    stack->array[stack->size++] = id;
+}
+
+inline static ecs_id_t ecs_stack_pop(ecs_stack_t* stack)
+{
+    ECS_ASSERT(ecs_is_not_null(stack));
+    return stack->array[--stack->size];
+}
+
+inline static int ecs_stack_size(ecs_stack_t* stack)
+{
+    return stack->size;
+}
+
+static void ecs_array_free(ecs_t* ecs, ecs_array_t* array)
+{
+    ECS_ASSERT(ecs_is_not_null(ecs));
+    ECS_ASSERT(ecs_is_not_null(array));
+
+    (void)ecs;
+
+    ECS_FREE(array->data, ecs->mem_ctx);
+}
+
+#ifndef PICO_ECS_ARCHETYPES
+
+static void ecs_array_init(ecs_t* ecs, ecs_array_t* array, size_t size, size_t capacity)
+{
+    ECS_ASSERT(ecs_is_not_null(ecs));
+    ECS_ASSERT(ecs_is_not_null(array));
+
+    (void)ecs;
+
+    memset(array, 0, sizeof(ecs_array_t));
+
+    array->capacity = capacity;
+    array->count = 0;
+    array->size = size;
+    array->data = ECS_MALLOC(size * capacity, ecs->mem_ctx);
+}
+
+static void ecs_array_resize(ecs_t* ecs, ecs_array_t* array, size_t capacity)
+{
+    ECS_ASSERT(ecs_is_not_null(ecs));
+    ECS_ASSERT(ecs_is_not_null(array));
+
+    (void)ecs;
+
+    if (capacity >= array->capacity)
+    {
+        while (array->capacity <= capacity)
+        {
+            array->capacity += (array->capacity / 2) + 2;
+        }
+
+        array->data = ECS_REALLOC(array->data,
+                                  array->capacity * array->size,
+                                  ecs->mem_ctx);
+    }
+}
+
+#endif // PICO_ECS_ARCHETYPES
+
+/*=============================================================================
+ * Internal snapshot functions
+ *============================================================================*/
+
+#define ECS_SNAPSHOT_MAGIC 0x53434550 // "PECS"
+
+// Differences separated by fewer equal bytes than this are merged into a
+// single run, which is cheaper than the header of a new run
+#define ECS_DELTA_GAP (2 * sizeof(uint64_t))
+
+static void ecs_write(ecs_writer_t* writer, const void* src, size_t size)
+{
+    if (writer->data && size > 0)
+    {
+        ECS_ASSERT(writer->offset + size <= writer->size);
+        memcpy(writer->data + writer->offset, src, size);
+    }
+
+    writer->offset += size;
+}
+
+static bool ecs_read(ecs_reader_t* reader, void* dst, size_t size)
+{
+    if (size > reader->size - reader->offset)
+        return false;
+
+    if (size > 0)
+        memcpy(dst, reader->data + reader->offset, size);
+
+    reader->offset += size;
+
+    return true;
+}
+
+static void ecs_write_stack(ecs_writer_t* writer, ecs_stack_t* stack)
+{
+    ecs_write(writer, &stack->size, sizeof(size_t));
+    ecs_write(writer, stack->array, stack->size * sizeof(ecs_id_t));
+}
+
+static bool ecs_read_stack(ecs_t* ecs, ecs_reader_t* reader, ecs_stack_t* stack)
+{
+    (void)ecs;
+
+    size_t size;
+
+    if (!ecs_read(reader, &size, sizeof(size_t)))
+        return false;
+
+    if (size > stack->capacity)
+    {
+        stack->capacity = size;
+        stack->array = (ecs_id_t*)ECS_REALLOC(stack->array,
+                                              stack->capacity * sizeof(ecs_id_t),
+                                              ecs->mem_ctx);
+    }
+
+    stack->size = size;
 
-    memset(set->sparse, 0, capacity * sizeof(size_t));
+    return ecs_read(reader, stack->array, size * sizeof(ecs_id_t));
 }
 
-static void ecs_sparse_set_free(ecs_t* ecs, ecs_sparse_set_t* set)
+static void ecs_write_sparse_set(ecs_writer_t* writer, ecs_sparse_set_t* set)
 {
-    ECS_ASSERT(ecs_is_not_null(ecs));
-    ECS_ASSERT(ecs_is_not_null(set));
-
-    (void)ecs;
-
-    ECS_FREE(set->dense,  ecs->mem_ctx);
-    ECS_FREE(set->sparse, ecs->mem_ctx);
+    // The sparse array is rebuilt from the dense one
+    ecs_write(writer, &set->capacity, sizeof(size_t));
+    ecs_write(writer, &set->size, sizeof(size_t));
+    ecs_write(writer, set->dense, set->size * sizeof(ecs_id_t));
 }
 
-static bool ecs_sparse_set_add(ecs_t* ecs, ecs_sparse_set_t* set, ecs_id_t id)
+static bool ecs_read_sparse_set(ecs_t* ecs, ecs_reader_t* reader, ecs_sparse_set_t* set)
 {
-    ECS_ASSERT(ecs_is_not_null(ecs));
-    ECS_ASSERT(ecs_is_not_null(set));
+    size_t capacity, size;
 
-    (void)ecs;
+    if (!ecs_read(reader, &capacity, sizeof(size_t)) ||
+        !ecs_read(reader, &size, sizeof(size_t)) ||
+        size > capacity)
+        return false;
 
-    // Grow sparse set if necessary
-    if (id >= set->capacity)
+    if (capacity > set->capacity)
     {
-        size_t old_capacity = set->capacity;
-        size_t new_capacity = old_capacity;
-
-        // Calculate new capacity
-        while (new_capacity <= id)
-        {
-            new_capacity += (new_capacity / 2) + 2;
-        }
-
-        // Grow dense array
         set->dense = (ecs_id_t*)ECS_REALLOC(set->dense,
-                                            new_capacity * sizeof(ecs_id_t),
+                                            capacity * sizeof(ecs_id_t),
                                             ecs->mem_ctx);
 
-        // Grow sparse array and zero it
         set->sparse = (size_t*)ecs_realloc_zero(ecs,
                                                 set->sparse,
-                                                old_capacity * sizeof(size_t),
-                                                new_capacity * sizeof(size_t));
+                                                set->capacity * sizeof(size_t),
+                                                capacity * sizeof(size_t));
 
-        // Set the new capacity
-        set->capacity = new_capacity;
+        set->capacity = capacity;
     }
 
-    // Check if ID exists within the set
-    if (ECS_NULL != ecs_sparse_set_find(set, id))
+    set->size = 0;
+
+    if (!ecs_read(reader, set->dense, size * sizeof(ecs_id_t)))
         return false;
 
-    // Add ID to set
-    set->dense[set->size] = id;
-    set->sparse[id] = set->size;
+    for (size_t i = 0; i < size; i++)
+    {
+        if (ECS_ID_INDEX(set->dense[i]) >= set->capacity)
+            return false;
 
-    set->size++;
+        set->sparse[ECS_ID_INDEX(set->dense[i])] = i;
+    }
+
+    set->size = size;
 
     return true;
 }
 
-static size_t ecs_sparse_set_find(ecs_sparse_set_t* set, ecs_id_t id)
+static void ecs_write_header(ecs_t* ecs, ecs_writer_t* writer)
 {
-    ECS_ASSERT(ecs_is_not_null(set));
+    uint32_t magic = ECS_SNAPSHOT_MAGIC;
 
-    if (set->sparse[id] < set->size && set->dense[set->sparse[id]] == id)
-        return set->sparse[id];
-    else
-        return ECS_NULL;
+    ecs_write(writer, &magic, sizeof(uint32_t));
+    ecs_write(writer, &ecs->comp_count, sizeof(size_t));
+    ecs_write(writer, &ecs->system_count, sizeof(size_t));
+    ecs_write(writer, &ecs->query_count, sizeof(size_t));
+
+    for (ecs_id_t comp_id = 0; comp_id < ecs->comp_count; comp_id++)
+    {
+        ecs_comp_t* comp = &ecs->comps[comp_id];
+        bool tracked = NULL != comp->ticks;
+
+        ecs_write(writer, &ecs->comp_arrays[comp_id].size, sizeof(size_t));
+        ecs_write(writer, &comp->storage, sizeof(ecs_storage_t));
+        ecs_write(writer, &tracked, sizeof(bool));
+    }
 }
 
-static bool ecs_sparse_set_remove(ecs_sparse_set_t* set, ecs_id_t id)
+static bool ecs_read_header(ecs_t* ecs, ecs_reader_t* reader)
 {
-    ECS_ASSERT(ecs_is_not_null(set));
+    uint32_t magic;
+    size_t comp_count, system_count, query_count;
 
-    if (ECS_NULL == ecs_sparse_set_find(set, id))
+    if (!ecs_read(reader, &magic, sizeof(uint32_t)) ||
+        !ecs_read(reader, &comp_count, sizeof(size_t)) ||
+        !ecs_read(reader, &system_count, sizeof(size_t)) ||
+        !ecs_read(reader, &query_count, sizeof(size_t)))
         return false;
 
-    // Swap and remove (changes order of array)
-    ecs_id_t tmp = set->dense[set->size - 1];
-    set->dense[set->sparse[id]] = tmp;
-    set->sparse[tmp] = set->sparse[id];
+    if (ECS_SNAPSHOT_MAGIC != magic ||
+        comp_count   != ecs->comp_count ||
+        system_count != ecs->system_count ||
+        query_count  != ecs->query_count)
+        return false;
 
-    set->size--;
+    for (ecs_id_t comp_id = 0; comp_id < ecs->comp_count; comp_id++)
+    {
+        ecs_comp_t* comp = &ecs->comps[comp_id];
+
+        size_t size;
+        ecs_storage_t storage;
+        bool tracked;
+
+        if (!ecs_read(reader, &size, sizeof(size_t)) ||
+            !ecs_read(reader, &storage, sizeof(ecs_storage_t)) ||
+            !ecs_read(reader, &tracked, sizeof(bool)))
+            return false;
+
+        if (size    != ecs->comp_arrays[comp_id].size ||
+            storage != comp->storage ||
+            tracked != (NULL != comp->ticks))
+            return false;
+    }
 
     return true;
 }
 
-/*=============================================================================
- * Internal system entity add/remove functions
- *============================================================================*/
-
-inline static bool ecs_entity_system_test(ecs_bitset_t* require_bits,
-                                          ecs_bitset_t* exclude_bits,
-                                          ecs_bitset_t* entity_bits)
+static void ecs_write_world(ecs_t* ecs, ecs_writer_t* writer)
 {
-    if (!ecs_bitset_is_zero(exclude_bits))
+    ecs_write_header(ecs, writer);
+
+    ecs_write(writer, &ecs->entity_count, sizeof(size_t));
+    ecs_write(writer, &ecs->tick, sizeof(uint32_t));
+
+    ecs_write_stack(writer, &ecs->entity_pool);
+    ecs_write_stack(writer, &ecs->destroy_queue);
+    ecs_write_stack(writer, &ecs->remove_queue);
+
+    ecs_write(writer, ecs->entities, ecs->entity_count * sizeof(ecs_entity_t));
+
+    for (ecs_id_t comp_id = 0; comp_id < ecs->comp_count; comp_id++)
     {
-        ecs_bitset_t overlap = ecs_bitset_and(entity_bits, exclude_bits);
+        ecs_comp_t* comp = &ecs->comps[comp_id];
 
-        if (ecs_bitset_true(&overlap))
+#ifndef PICO_ECS_ARCHETYPES
+        ecs_array_t* comp_array = &ecs->comp_arrays[comp_id];
+
+        if (ECS_STORAGE_PACKED == comp->storage)
         {
-            return false;
+            ecs_write_sparse_set(writer, &comp->index);
+            ecs_write(writer, comp_array->data, comp->index.size * comp_array->size);
+        }
+        else
+        {
+            // Slots beyond the array capacity have never been used
+            size_t count = comp_array->capacity < ecs->entity_count ?
+                           comp_array->capacity : ecs->entity_count;
+
+            ecs_write(writer, &count, sizeof(size_t));
+            ecs_write(writer, comp_array->data, count * comp_array->size);
         }
+#endif
+
+        if (comp->ticks)
+            ecs_write(writer, comp->ticks, ecs->entity_count * sizeof(uint32_t));
     }
 
-    ecs_bitset_t entity_and_require = ecs_bitset_and(entity_bits, require_bits);
-    return ecs_bitset_equal(&entity_and_require, require_bits);
-}
+#ifdef PICO_ECS_ARCHETYPES
+    // Archetypes are stored chunk by chunk
+    ecs_write(writer, &ecs->archetype_count, sizeof(size_t));
 
-/*=============================================================================
- * Internal ID pool functions
- *============================================================================*/
+    for (ecs_id_t arch_id = 0; arch_id < ecs->archetype_count; arch_id++)
+    {
+        ecs_archetype_t* arch = &ecs->archetypes[arch_id];
 
-inline static void ecs_stack_init(ecs_t* ecs, ecs_stack_t* stack, int capacity)
-{
-    ECS_ASSERT(ecs_is_not_null(ecs));
-    ECS_ASSERT(ecs_is_not_null(stack));
-    ECS_ASSERT(capacity > 0);
+        ecs_write(writer, &arch->comp_bits, sizeof(ecs_bitset_t));
+        ecs_write(writer, &arch->count, sizeof(size_t));
 
-    (void)ecs;
+        for (size_t row = 0; row < arch->count; row += ECS_CHUNK_SIZE)
+        {
+            ecs_chunk_t* chunk = arch->chunks[row / ECS_CHUNK_SIZE];
 
-    stack->size = 0;
-    stack->capacity = capacity;
-    stack->array = (ecs_id_t*)ECS_MALLOC(capacity * sizeof(ecs_id_t), ecs->mem_ctx);
-}
+            ecs_write(writer, chunk->entities, chunk->count * sizeof(ecs_id_t));
 
-inline static void ecs_stack_free(ecs_t* ecs, ecs_stack_t* stack)
-{
-    ECS_ASSERT(ecs_is_not_null(ecs));
-    ECS_ASSERT(ecs_is_not_null(stack));
+            for (size_t i = 0; i < arch->comp_count; i++)
+            {
+                ecs_id_t comp_id = arch->comp_ids[i];
 
-    (void)ecs;
+                ecs_write(writer, chunk->columns[comp_id],
+                          chunk->count * ecs->comp_arrays[comp_id].size);
+            }
+        }
+    }
+#endif
 
-    ECS_FREE(stack->array, ecs->mem_ctx);
+    for (ecs_id_t sys_id = 0; sys_id < ecs->system_count; sys_id++)
+    {
+        ecs_sys_t* sys = &ecs->systems[sys_id];
+
+        ecs_write(writer, &sys->last_tick, sizeof(uint32_t));
+        ecs_write_sparse_set(writer, &sys->entity_ids);
+    }
+
+    for (ecs_id_t query_id = 0; query_id < ecs->query_count; query_id++)
+    {
+        ecs_write_sparse_set(writer, &ecs->queries[query_id].entity_ids);
+    }
 }
 
-inline static void ecs_stack_push(ecs_t* ecs, ecs_stack_t* stack, ecs_id_t id)
+static bool ecs_read_world(ecs_t* ecs, ecs_reader_t* reader)
 {
-    ECS_ASSERT(ecs_is_not_null(ecs));
-    ECS_ASSERT(ecs_is_not_null(stack));
-    ECS_ASSERT(stack->capacity > 0);
+    size_t entity_count;
 
-    (void)ecs;
+    if (!ecs_read(reader, &entity_count, sizeof(size_t)) || 0 == entity_count)
+        return false;
 
-    if (stack->size == stack->capacity)
+    // Reserved storage cannot hold more entities than were reserved
+    if (ecs->reserved_count && entity_count > ecs->reserved_count)
+        return false;
+
+    // Arrays indexed by entity ID must hold every ID in the snapshot. Larger
+    // arrays are kept as they are.
+    if (entity_count > ecs->entity_count)
+        ecs_grow_entities(ecs, entity_count);
+
+    ecs->entity_count = entity_count;
+
+    if (!ecs_read(reader, &ecs->tick, sizeof(uint32_t)))
+        return false;
+
+    if (!ecs_read_stack(ecs, reader, &ecs->entity_pool) ||
+        !ecs_read_stack(ecs, reader, &ecs->destroy_queue) ||
+        !ecs_read_stack(ecs, reader, &ecs->remove_queue))
+        return false;
+
+    if (!ecs_read(reader, ecs->entities, entity_count * sizeof(ecs_entity_t)))
+        return false;
+
+    for (ecs_id_t comp_id = 0; comp_id < ecs->comp_count; comp_id++)
     {
-        stack->capacity += (stack->capacity / 2) + 2;
+        ecs_comp_t* comp = &ecs->comps[comp_id];
 
-        stack->array = (ecs_id_t*)ECS_REALLOC(stack->array,
-                                              stack->capacity * sizeof(ecs_id_t),
-                                              ecs->mem_ctx);
+#ifndef PICO_ECS_ARCHETYPES
+        ecs_array_t* comp_array = &ecs->comp_arrays[comp_id];
+
+        if (ECS_STORAGE_PACKED == comp->storage)
+        {
+            if (!ecs_read_sparse_set(ecs, reader, &comp->index))
+                return false;
+
+            ecs_array_resize(ecs, comp_array, comp->index.size);
+            comp_array->count = comp->index.size;
+
+            if (!ecs_read(reader, comp_array->data, comp->index.size * comp_array->size))
+                return false;
+        }
+        else
+        {
+            size_t count;
+
+            if (!ecs_read(reader, &count, sizeof(size_t)))
+                return false;
+
+            ecs_array_resize(ecs, comp_array, count);
+
+            if (!ecs_read(reader, comp_array->data, count * comp_array->size))
+                return false;
+        }
+#endif
+
+        if (comp->ticks && !ecs_read(reader, comp->ticks, entity_count * sizeof(uint32_t)))
+            return false;
     }
 
-    stack->array[stack->size++] = id;
-}
+#ifdef PICO_ECS_ARCHETYPES
+    // Empty every archetype, chunks are kept for reuse
+    for (ecs_id_t arch_id = 0; arch_id < ecs->archetype_count; arch_id++)
+    {
+        ecs_archetype_t* arch = &ecs->archetypes[arch_id];
 
-inline static ecs_id_t ecs_stack_pop(ecs_stack_t* stack)
-{
-    ECS_ASSERT(ecs_is_not_null(stack));
-    return stack->array[--stack->size];
-}
+        for (size_t i = 0; i < arch->chunk_count; i++)
+            arch->chunks[i]->count = 0;
 
-inline static int ecs_stack_size(ecs_stack_t* stack)
-{
-    return stack->size;
-}
+        arch->count = 0;
+    }
 
-static void ecs_array_init(ecs_t* ecs, ecs_array_t* array, size_t size, size_t capacity)
-{
-    ECS_ASSERT(ecs_is_not_null(ecs));
-    ECS_ASSERT(ecs_is_not_null(array));
+    size_t archetype_count;
 
-    (void)ecs;
+    if (!ecs_read(reader, &archetype_count, sizeof(size_t)))
+        return false;
 
-    memset(array, 0, sizeof(ecs_array_t));
+    for (size_t i = 0; i < archetype_count; i++)
+    {
+        ecs_bitset_t comp_bits;
+        size_t count;
 
-    array->capacity = capacity;
-    array->count = 0;
-    array->size = size;
-    array->data = ECS_MALLOC(size * capacity, ecs->mem_ctx);
-}
+        if (!ecs_read(reader, &comp_bits, sizeof(ecs_bitset_t)) ||
+            !ecs_read(reader, &count, sizeof(size_t)))
+            return false;
 
-static void ecs_array_free(ecs_t* ecs, ecs_array_t* array)
-{
-    ECS_ASSERT(ecs_is_not_null(ecs));
-    ECS_ASSERT(ecs_is_not_null(array));
+        // Archetype IDs may differ between instances, so they are looked up
+        // by signature
+        ecs_id_t arch_id = ecs_archetype_get(ecs, &comp_bits);
 
-    (void)ecs;
+        for (size_t start = 0; start < count; start += ECS_CHUNK_SIZE)
+        {
+            size_t rows = count - start < ECS_CHUNK_SIZE ? count - start : ECS_CHUNK_SIZE;
 
-    ECS_FREE(array->data, ecs->mem_ctx);
+            for (size_t row = 0; row < rows; row++)
+            {
+                ecs_id_t entity_id;
+
+                if (!ecs_read(reader, &entity_id, sizeof(ecs_id_t)) ||
+                    ECS_ID_INDEX(entity_id) >= entity_count)
+                    return false;
+
+                ecs->entities[ECS_ID_INDEX(entity_id)].archetype = arch_id;
+                ecs->entities[ECS_ID_INDEX(entity_id)].row = ecs_archetype_push(ecs, arch_id, entity_id);
+            }
+
+            // Rows were pushed into an empty archetype, so the chunk layout
+            // matches the snapshot
+            ecs_archetype_t* arch = &ecs->archetypes[arch_id];
+            ecs_chunk_t* chunk = arch->chunks[start / ECS_CHUNK_SIZE];
+
+            for (size_t j = 0; j < arch->comp_count; j++)
+            {
+                ecs_id_t comp_id = arch->comp_ids[j];
+
+                if (!ecs_read(reader, chunk->columns[comp_id],
+                              rows * ecs->comp_arrays[comp_id].size))
+                    return false;
+            }
+        }
+    }
+#endif
+
+    for (ecs_id_t sys_id = 0; sys_id < ecs->system_count; sys_id++)
+    {
+        ecs_sys_t* sys = &ecs->systems[sys_id];
+
+        if (!ecs_read(reader, &sys->last_tick, sizeof(uint32_t)) ||
+            !ecs_read_sparse_set(ecs, reader, &sys->entity_ids))
+            return false;
+    }
+
+    for (ecs_id_t query_id = 0; query_id < ecs->query_count; query_id++)
+    {
+        if (!ecs_read_sparse_set(ecs, reader, &ecs->queries[query_id].entity_ids))
+            return false;
+    }
+
+    return true;
 }
 
-static void ecs_array_resize(ecs_t* ecs, ecs_array_t* array, size_t capacity)
+static void ecs_write_delta(ecs_writer_t* writer,
+                            const char* base, size_t base_size,
+                            const char* snapshot, size_t snapshot_size)
 {
-    ECS_ASSERT(ecs_is_not_null(ecs));
-    ECS_ASSERT(ecs_is_not_null(array));
+    uint64_t target_size = snapshot_size;
+    ecs_write(writer, &target_size, sizeof(uint64_t));
 
-    (void)ecs;
+    size_t common = base_size < snapshot_size ? base_size : snapshot_size;
+    size_t i = 0;
 
-    if (capacity >= array->capacity)
+    while (i < common)
     {
-        while (array->capacity <= capacity)
+        // Skip identical blocks quickly
+        if (i + 64 <= common && 0 == memcmp(base + i, snapshot + i, 64))
         {
-            array->capacity += (array->capacity / 2) + 2;
+            i += 64;
+            continue;
         }
 
-        array->data = ECS_REALLOC(array->data,
-                                  array->capacity * array->size,
-                                  ecs->mem_ctx);
+        if (base[i] == snapshot[i])
+        {
+            i++;
+            continue;
+        }
+
+        // Extend the run until a long enough stretch of equal bytes is found
+        size_t start = i;
+        size_t end = i + 1;
+
+        for (size_t j = end; j < common && j - end < ECS_DELTA_GAP; j++)
+        {
+            if (base[j] != snapshot[j])
+                end = j + 1;
+        }
+
+        uint64_t offset = start, length = end - start;
+
+        ecs_write(writer, &offset, sizeof(uint64_t));
+        ecs_write(writer, &length, sizeof(uint64_t));
+        ecs_write(writer, snapshot + start, end - start);
+
+        i = end;
+    }
+
+    // Bytes beyond the end of the base are always sent
+    if (snapshot_size > common)
+    {
+        uint64_t offset = common, length = snapshot_size - common;
+
+        ecs_write(writer, &offset, sizeof(uint64_t));
+        ecs_write(writer, &length, sizeof(uint64_t));
+        ecs_write(writer, snapshot + common, snapshot_size - common);
     }
 }
 
@@ -1479,7 +4806,7 @@ static bool ecs_is_valid_system_id(ecs_id_t id)
 
 static bool ecs_is_entity_ready(ecs_t* ecs, ecs_id_t entity_id)
 {
-    return ecs->entities[entity_id].ready;
+    return ecs_is_ready(ecs, entity_id);
 }
 
 static bool ecs_is_component_ready(ecs_t* ecs, ecs_id_t comp_id)
@@ -1492,6 +4819,21 @@ static bool ecs_is_system_ready(ecs_t* ecs, ecs_id_t sys_id)
     return sys_id < ecs->system_count;
 }
 
+static bool ecs_is_prefab_ready(ecs_t* ecs, ecs_id_t prefab_id)
+{
+    return prefab_id < ecs->prefab_count;
+}
+
+static bool ecs_is_query_ready(ecs_t* ecs, ecs_id_t query_id)
+{
+    return query_id < ecs->query_count;
+}
+
+static bool ecs_is_not_in_job(ecs_t* ecs)
+{
+    return ecs_local_ecs != ecs;
+}
+
 #endif // NDEBUG
 
 #endif // PICO_ECS_IMPLEMENTATION
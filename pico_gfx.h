@@ -15,6 +15,8 @@
     - Flexible pipeline configuration
     - Simple state management system (state stack)
     - Render to texture
+    - Automatic batching of sprites and other geometry
+    - Command buffers that can be recorded on worker threads
     - Custom shaders via the sokol shader compiler
     - Simple and concise API
     - Permissive license (zlib or public domain)
@@ -79,6 +81,46 @@
     by calling `pg_set_uniform_block`. These functions operate on structs
     supplied by a compiled shader,
 
+    Uniform blocks, textures, and samplers are looked up by name. In hot code
+    paths, the names can be resolved once (e.g. `pg_get_uniform_block_handle`)
+    and the resulting handles used instead (e.g. `pg_set_uniform_block_by_handle`).
+
+    Drawing many small objects (e.g. sprites) with individual calls to `pg_draw`
+    is expensive. A batch (`pg_create_batch`) accumulates quads and triangles
+    (`pg_batch_quad/pg_batch_vertices`) in a streaming vertex buffer and draws
+    them with as few calls as possible. A new draw call is only issued when the
+    pipeline, viewport, scissor, textures, samplers, or uniform blocks change.
+    Pending geometry is drawn automatically at the end of the pass, or by
+    calling `pg_flush_batch`. Instanced batches (`pg_create_instanced_batch`)
+    work the same way, but accumulate per-instance data that is written in
+    place (`pg_batch_instances`) and drawn over shared geometry.
+
+    Geometry that changes many times per frame can be sub-allocated from a
+    streaming buffer (`pg_create_stream_buffer/pg_alloc_stream_buffer`) and
+    bound at the returned offset with `pg_bind_buffer_offset`.
+
+    All calls into sokol_gfx must happen on the thread that owns the graphics
+    context. Command buffers (`pg_create_cmdbuf`) record state changes, buffer
+    appends, and draws without touching the context, so a frame can be built on
+    several threads. The command buffers are then replayed on the main thread
+    with `pg_submit_cmdbuf`. Groups of commands can be tagged with 64-bit sort
+    keys (`pg_cmdbuf_set_sort_key/pg_make_sort_key`) and reordered with
+    `pg_sort_cmdbuf` to minimize pipeline and texture switches. The number of
+    switches per frame is reported by `pg_get_stats`.
+
+    Many small images can share a few large textures by packing them into an
+    atlas (`pg_create_atlas/pg_add_atlas_image`). Each image is looked up by
+    key (`pg_get_atlas_region`), which returns its page and texture
+    coordinates. Images drawn from the same page do not break a batch. Changes
+    are uploaded once per frame with `pg_commit_atlas`.
+
+    `pg_get_stats` also reports the number of passes, draws, texture binds, and
+    bytes uploaded in the previous frame, and `pg_get_pass_stats` reports the
+    same counters for each render pass. If PICO_GFX_PROFILE is defined, the CPU
+    time spent between `pg_begin_pass` and `pg_end_pass` is measured using
+    pico_time, which must then be included before pico_gfx.h. GPU timings are
+    not available because sokol_gfx does not expose timer queries.
+
     Please see the examples for more details.
 
     C++
@@ -116,6 +158,8 @@
 
     - PICO_GFX_HASHTABLE_KEY_SIZE (default: 16)
     - PICO_GFX_STACK_MAX_SIZE (default: 16)
+    - PICO_GFX_MAX_PASS_STATS (default: 16)
+    - PICO_GFX_ATLAS_KEY_SIZE (default: 32)
 
     Customization:
     --------
@@ -126,6 +170,7 @@
     - PICO_GFX_MALLOC
     - PICO_GFX_REALLOC
     - PICO_GFX_FREE
+    - PICO_GFX_PROFILE
 
     The above (constants/macros) must be defined before PICO_GFX_IMPLEMENTATION
 */
@@ -157,6 +202,7 @@
 #define PG_MAX_VERTEX_BUFFERS    SG_MAX_VERTEX_BUFFERS
 #define PG_MAX_TEXTURE_SLOTS     SG_MAX_SHADERSTAGE_IMAGES
 #define PG_MAX_SAMPLER_SLOTS     SG_MAX_SHADERSTAGE_SAMPLERS
+#define PG_MAX_UNIFORM_BLOCKS    (2 * SG_MAX_SHADERSTAGE_UBS)
 
 /**
  * @brief Graphics backends
@@ -338,6 +384,36 @@ void pg_end_pass(pg_ctx_t* ctx);
 */
 void pg_flush(pg_ctx_t* ctx);
 
+/**
+ * @brief Frame (or pass) statistics
+ */
+typedef struct pg_stats_t
+{
+    int passes;            //!< The number of render passes
+    int draws;             //!< The number of draw calls
+    int pipeline_switches; //!< The number of times a different pipeline was applied
+    int texture_switches;  //!< The number of draws that changed the bound textures
+    int texture_binds;     //!< The number of textures submitted with new bindings
+    size_t bytes_uploaded; //!< The number of bytes written to buffers and textures
+    double cpu_time;       //!< Seconds spent inside passes (requires PICO_GFX_PROFILE)
+} pg_stats_t;
+
+/**
+ * @brief Returns the statistics for the previous frame (ended by `pg_flush`)
+ */
+pg_stats_t pg_get_stats(const pg_ctx_t* ctx);
+
+/**
+ * @brief Returns the statistics of a render pass in the previous frame
+ *
+ * Only the first PICO_GFX_MAX_PASS_STATS passes of a frame are recorded.
+ * Uploads made outside of a pass only count towards the frame statistics.
+ *
+ * @param ctx The graphics context
+ * @param pass The index of the pass (in the order the passes began)
+ */
+pg_stats_t pg_get_pass_stats(const pg_ctx_t* ctx, int pass);
+
 /**
  * @brief Pushes the active state onto the stack.
  *
@@ -395,9 +471,20 @@ void pg_reset_pipeline(pg_ctx_t* ctx);
 
 /**
  * @brief Binds a buffer to the specified slot
+ *
+ * Draws use the buffer offset (`pg_get_buffer_offset`) at the time of drawing.
  */
 void pg_bind_buffer(pg_ctx_t* ctx, int slot, pg_buffer_t* buffer);
 
+/**
+ * @brief Binds a buffer to the specified slot at a fixed offset
+ * @param ctx The graphics context
+ * @param slot The binding slot
+ * @param buffer The buffer to bind
+ * @param offset The offset (in bytes), e.g. returned by `pg_alloc_stream_buffer`
+ */
+void pg_bind_buffer_offset(pg_ctx_t* ctx, int slot, pg_buffer_t* buffer, int offset);
+
 /**
  * @brief Clears buffer bindings
  */
@@ -423,6 +510,22 @@ void pg_reset_index_buffer(pg_ctx_t* ctx);
  */
 void pg_bind_texture(pg_shader_t* shader, const char* name, pg_texture_t* texture);
 
+/**
+ * @brief Returns a handle to the texture slot with the given name
+ *
+ * Binding by handle avoids a name lookup per call. The handle is only valid
+ * for the shader that returned it.
+ */
+int pg_get_texture_handle(const pg_shader_t* shader, const char* name);
+
+/**
+ * @brief Binds a texture to the slot referred to by a handle
+ * @param shader The shader associated with the texture
+ * @param handle The handle returned by `pg_get_texture_handle`
+ * @param texture The texture to bind
+ */
+void pg_bind_texture_by_handle(pg_shader_t* shader, int handle, pg_texture_t* texture);
+
 /**
  * @brief Resets the texture bindings for the current state
  */
@@ -436,6 +539,21 @@ void pg_reset_textures(pg_shader_t* shader);
  */
 void pg_bind_sampler(pg_shader_t* shader, const char* name, pg_sampler_t* sampler);
 
+/**
+ * @brief Returns a handle to the sampler slot with the given name
+ *
+ * The handle is only valid for the shader that returned it.
+ */
+int pg_get_sampler_handle(const pg_shader_t* shader, const char* name);
+
+/**
+ * @brief Binds a sampler to the slot referred to by a handle
+ * @param shader The shader associated with the sampler
+ * @param handle The handle returned by `pg_get_sampler_handle`
+ * @param sampler The sampler to bind
+ */
+void pg_bind_sampler_by_handle(pg_shader_t* shader, int handle, pg_sampler_t* sampler);
+
 /**
  * @brief Resets the sampler bindings for the current state
  */
@@ -492,6 +610,26 @@ void pg_alloc_uniform_block(pg_shader_t* shader, pg_stage_t stage, const char* n
  */
 void pg_set_uniform_block(pg_shader_t* shader, const char* name, const void* data);
 
+/**
+ * @brief Returns a handle to a registered uniform block (UB)
+ *
+ * Setting a UB by handle avoids a hashtable lookup per call. The handle is only
+ * valid for the shader that returned it.
+ *
+ * @param shader The shader owning the UB
+ * @param name The name of the UB as supplied by `sokol_shdc`
+ * @returns The handle, or -1 if the UB has not been registered
+ */
+int pg_get_uniform_block_handle(const pg_shader_t* shader, const char* name);
+
+/**
+ * @brief Sets a uniform block (UB) referred to by a handle
+ * @param shader The shader owning the UB
+ * @param handle The handle returned by `pg_get_uniform_block_handle`
+ * @param data The data to set (must be the whole UB)
+ */
+void pg_set_uniform_block_by_handle(pg_shader_t* shader, int handle, const void* data);
+
 /**
  * @brief Vertex attribute pixel formats
  */
@@ -632,6 +770,91 @@ void pg_get_texture_size(const pg_texture_t* texture, int* width, int* height);
  */
 void pg_update_texture(pg_texture_t* texture, char* data, int width, int height);
 
+/**
+ * @brief A texture atlas that packs images into one or more texture pages
+ */
+typedef struct pg_atlas_t pg_atlas_t;
+
+/**
+ * @brief The location of an image in an atlas
+ */
+typedef struct pg_atlas_region_t
+{
+    pg_texture_t* texture; //!< The page containing the image
+    int page;              //!< The index of the page
+    int x, y;              //!< The position of the image in the page (pixels)
+    int width, height;     //!< The size of the image (pixels)
+    float u0, v0;          //!< Top-left texture coordinates
+    float u1, v1;          //!< Bottom-right texture coordinates
+} pg_atlas_region_t;
+
+/**
+ * @brief Creates a texture atlas
+ *
+ * Images are packed into pages using the skyline bottom-left heuristic. A new
+ * page is created whenever an image does not fit into the existing ones.
+ *
+ * @param ctx The graphics context
+ * @param page_width The width of each page
+ * @param page_height The height of each page
+ * @param padding Transparent pixels between adjacent images (prevents bleeding
+ * when sampling with linear filtering)
+ */
+pg_atlas_t* pg_create_atlas(pg_ctx_t* ctx, int page_width, int page_height, int padding);
+
+/**
+ * @brief Destroys an atlas and its pages
+ */
+void pg_destroy_atlas(pg_atlas_t* atlas);
+
+/**
+ * @brief Copies an RGBA8 image into the atlas
+ *
+ * The image appears in its page after the next call to `pg_commit_atlas`.
+ *
+ * @param atlas The atlas
+ * @param key The name used to look up the image (unique, shorter than
+ * PICO_GFX_ATLAS_KEY_SIZE)
+ * @param data Image data (format must be RGBA8)
+ * @param width Image width
+ * @param height Image height
+ * @returns False if the image is larger than a page
+ */
+bool pg_add_atlas_image(pg_atlas_t* atlas,
+                        const char* key,
+                        const uint8_t* data,
+                        int width, int height);
+
+/**
+ * @brief Replaces the pixels of an image added with `pg_add_atlas_image`
+ * @param data Image data (RGBA8, same size as the original image)
+ */
+void pg_update_atlas_image(pg_atlas_t* atlas, const char* key, const uint8_t* data);
+
+/**
+ * @brief Looks up the location of an image
+ * @returns False if there is no image with the given key
+ */
+bool pg_get_atlas_region(const pg_atlas_t* atlas,
+                         const char* key,
+                         pg_atlas_region_t* region);
+
+/**
+ * @brief Uploads the pages that changed since the last commit. This can only
+ * be called once per frame
+ */
+void pg_commit_atlas(pg_atlas_t* atlas);
+
+/**
+ * @brief Returns the number of pages in an atlas
+ */
+int pg_get_atlas_page_count(const pg_atlas_t* atlas);
+
+/**
+ * @brief Returns the texture of an atlas page
+ */
+pg_texture_t* pg_get_atlas_page(const pg_atlas_t* atlas, int page);
+
 /**
  * @brief Sampler options
  */
@@ -724,14 +947,288 @@ void pg_set_buffer_offset(pg_buffer_t* buffer, int offset);
  */
 void pg_reset_buffer(pg_buffer_t* buffer);
 
+/**
+ * @brief Creates a streaming vertex buffer for data that changes many times
+ * per frame
+ *
+ * Space is sub-allocated linearly each frame by `pg_alloc_stream_buffer`, so
+ * unrelated geometry (e.g. particles and UI) can share one buffer. sokol_gfx
+ * keeps a copy of the buffer for each frame in flight, so writing never waits
+ * on the GPU, and the buffer is never recreated.
+ *
+ * @param ctx The graphics context
+ * @param size The capacity (in bytes) per frame
+ */
+pg_buffer_t* pg_create_stream_buffer(pg_ctx_t* ctx, size_t size);
+
+/**
+ * @brief Copies data into a streaming buffer
+ *
+ * Bind the data with `pg_bind_buffer_offset`. Allocations are valid for the
+ * rest of the frame.
+ *
+ * @param buffer A buffer created by `pg_create_stream_buffer`
+ * @param data The data to copy
+ * @param size The size of the data (in bytes)
+ * @returns The offset (in bytes) of the data, or -1 if the buffer does not have
+ * enough space left in this frame
+ */
+int pg_alloc_stream_buffer(pg_buffer_t* buffer, const void* data, size_t size);
+
 /**
  * @brief Draws from the buffers that are bound to the current state
+ *
+ * Only state that differs from the previous draw in the same pass is applied.
+ * Uniform blocks are uploaded again only if their contents were changed by
+ * `pg_set_uniform_block` or the pipeline changed.
+ *
  * @param ctx The graphics context
  * @param start The position of the first element
  * @param count The number of elements to draw
  * @param instances The number of instances
  */
-void pg_draw(const pg_ctx_t* ctx, size_t start, size_t count, size_t instances);
+void pg_draw(pg_ctx_t* ctx, size_t start, size_t count, size_t instances);
+
+/**
+ * @brief Accumulates geometry into a streaming vertex buffer
+ */
+typedef struct pg_batch_t pg_batch_t;
+
+/**
+ * @brief Creates a batch
+ *
+ * The batch owns a streaming vertex buffer that is bound to slot 0 when the
+ * batch is drawn. The vertex layout is defined by the active pipeline, which
+ * must not be indexed.
+ *
+ * @param ctx The graphics context
+ * @param max_vertices The maximum number of vertices submitted per frame
+ * @param vertex_size The size (in bytes) of each individual vertex
+ */
+pg_batch_t* pg_create_batch(pg_ctx_t* ctx, size_t max_vertices, size_t vertex_size);
+
+/**
+ * @brief Destroys a batch (pending geometry is discarded)
+ */
+void pg_destroy_batch(pg_batch_t* batch);
+
+/**
+ * @brief Adds triangles to a batch
+ *
+ * The vertices are drawn with the pipeline, viewport, and scissor that are
+ * active when they are added, and with the textures, samplers, and uniform
+ * blocks of the pipeline's shader. Pending geometry is drawn when any of these
+ * change, when another batch is used, when `pg_draw` is called, or at the end
+ * of the pass.
+ *
+ * @param batch The batch
+ * @param vertices The vertex data
+ * @param count The number of vertices (a multiple of three)
+ */
+void pg_batch_vertices(pg_batch_t* batch, const void* vertices, size_t count);
+
+/**
+ * @brief Adds a quad to a batch
+ * @param batch The batch
+ * @param vertices Four vertices ordered around the quad. The quad is split
+ * into the triangles (0, 1, 2) and (0, 2, 3)
+ */
+void pg_batch_quad(pg_batch_t* batch, const void* vertices);
+
+/**
+ * @brief Creates an instanced batch
+ *
+ * Instead of vertices, an instanced batch accumulates per-instance data in its
+ * streaming buffer, which is bound to slot 1. The shared geometry is bound to
+ * slot 0 and drawn once per instance. The pipeline layout must declare buffer
+ * 1 as instanced (see `pg_vertex_buf_t`). Batches are broken under the same
+ * conditions as for `pg_batch_vertices`.
+ *
+ * @param ctx The graphics context
+ * @param vertices The geometry drawn for each instance (e.g. a quad)
+ * @param vertex_count The number of vertices to draw from `vertices`
+ * @param max_instances The maximum number of instances submitted per frame
+ * @param instance_size The size (in bytes) of each instance
+ */
+pg_batch_t* pg_create_instanced_batch(pg_ctx_t* ctx,
+                                      pg_buffer_t* vertices,
+                                      size_t vertex_count,
+                                      size_t max_instances,
+                                      size_t instance_size);
+
+/**
+ * @brief Reserves space for instances in an instanced batch
+ *
+ * The instance data is written directly into the returned memory, which
+ * remains valid until the next call involving the batch. See also
+ * `pg_batch_instances`.
+ *
+ * @param batch The instanced batch
+ * @param count The number of instances
+ * @param instance_size The size of each instance (must match the batch)
+ * @returns Memory for `count` instances
+ */
+void* pg_batch_alloc_instances(pg_batch_t* batch, size_t count, size_t instance_size);
+
+/**
+ * @brief Typed version of `pg_batch_alloc_instances`
+ *
+ * Example:
+ * > particle_t* particles = pg_batch_instances(batch, particle_t, 100);
+ */
+#define pg_batch_instances(batch, type, count) \
+    ((type*)pg_batch_alloc_instances(batch, count, sizeof(type)))
+
+/**
+ * @brief Draws any pending geometry in the batch
+ */
+void pg_flush_batch(pg_batch_t* batch);
+
+/**
+ * @brief A list of recorded state changes, buffer appends, and draws
+ *
+ * Recording does not call into sokol_gfx or modify the graphics context, so
+ * command buffers can be recorded on any thread, one thread per command buffer
+ * at a time. Command buffers must be submitted on the thread that owns the
+ * graphics context. Textures, samplers, and uniform blocks are referred to by
+ * handle (see `pg_get_uniform_block_handle`).
+ */
+typedef struct pg_cmdbuf_t pg_cmdbuf_t;
+
+/**
+ * @brief Creates a command buffer
+ * @param ctx The graphics context
+ * @param size The initial size (in bytes) of the command memory. This grows as
+ * needed
+ */
+pg_cmdbuf_t* pg_create_cmdbuf(pg_ctx_t* ctx, size_t size);
+
+/**
+ * @brief Destroys a command buffer
+ */
+void pg_destroy_cmdbuf(pg_cmdbuf_t* cmdbuf);
+
+/**
+ * @brief Removes all commands from a command buffer, retaining its memory
+ */
+void pg_reset_cmdbuf(pg_cmdbuf_t* cmdbuf);
+
+/**
+ * @brief Records `pg_set_pipeline`
+ */
+void pg_cmdbuf_set_pipeline(pg_cmdbuf_t* cmdbuf, pg_pipeline_t* pipeline);
+
+/**
+ * @brief Records `pg_set_viewport`
+ */
+void pg_cmdbuf_set_viewport(pg_cmdbuf_t* cmdbuf, int x, int y, int w, int h);
+
+/**
+ * @brief Records `pg_set_scissor`
+ */
+void pg_cmdbuf_set_scissor(pg_cmdbuf_t* cmdbuf, int x, int y, int w, int h);
+
+/**
+ * @brief Records `pg_bind_buffer`
+ */
+void pg_cmdbuf_bind_buffer(pg_cmdbuf_t* cmdbuf, int slot, pg_buffer_t* buffer);
+
+/**
+ * @brief Records `pg_bind_buffer_offset`
+ */
+void pg_cmdbuf_bind_buffer_offset(pg_cmdbuf_t* cmdbuf,
+                                  int slot,
+                                  pg_buffer_t* buffer,
+                                  int offset);
+
+/**
+ * @brief Records `pg_set_index_buffer`
+ */
+void pg_cmdbuf_set_index_buffer(pg_cmdbuf_t* cmdbuf, pg_buffer_t* buffer);
+
+/**
+ * @brief Records `pg_bind_texture_by_handle`
+ */
+void pg_cmdbuf_bind_texture(pg_cmdbuf_t* cmdbuf,
+                            pg_shader_t* shader,
+                            int handle,
+                            pg_texture_t* texture);
+
+/**
+ * @brief Records `pg_bind_sampler_by_handle`
+ */
+void pg_cmdbuf_bind_sampler(pg_cmdbuf_t* cmdbuf,
+                            pg_shader_t* shader,
+                            int handle,
+                            pg_sampler_t* sampler);
+
+/**
+ * @brief Records `pg_set_uniform_block_by_handle`. The data is copied
+ */
+void pg_cmdbuf_set_uniform_block(pg_cmdbuf_t* cmdbuf,
+                                 pg_shader_t* shader,
+                                 int handle,
+                                 const void* data);
+
+/**
+ * @brief Records `pg_append_buffer`. The data is copied
+ *
+ * The buffer offset is set when the command buffer is submitted, so draws
+ * recorded after the append use the appended data.
+ */
+void pg_cmdbuf_append_buffer(pg_cmdbuf_t* cmdbuf,
+                             pg_buffer_t* buffer,
+                             const void* data,
+                             size_t count);
+
+/**
+ * @brief Records `pg_draw`
+ */
+void pg_cmdbuf_draw(pg_cmdbuf_t* cmdbuf, size_t start, size_t count, size_t instances);
+
+/**
+ * @brief Starts a group of commands with the given sort key
+ *
+ * All commands recorded until the next key belong to the group. Commands
+ * recorded before the first key have a key of zero. Since `pg_sort_cmdbuf` may
+ * reorder groups, each group should set all of the state its draws depend on.
+ */
+void pg_cmdbuf_set_sort_key(pg_cmdbuf_t* cmdbuf, uint64_t key);
+
+/**
+ * @brief Sorts the command groups in a command buffer by key (ascending)
+ *
+ * The sort is stable, so groups with equal keys keep their recorded order. This
+ * function may be called on the recording thread.
+ */
+void pg_sort_cmdbuf(pg_cmdbuf_t* cmdbuf);
+
+/**
+ * @brief Builds a sort key that groups draws by layer, then pipeline, then
+ * texture, then depth
+ *
+ * The key layout (from most to least significant) is layer (8 bits), pipeline
+ * (16 bits), texture (16 bits), and depth (24 bits).
+ *
+ * @param layer The layer
+ * @param pipeline The pipeline (can be NULL)
+ * @param texture The texture (can be NULL)
+ * @param depth The depth in [0, 1]. Smaller values sort first
+ */
+uint64_t pg_make_sort_key(uint8_t layer,
+                          const pg_pipeline_t* pipeline,
+                          const pg_texture_t* texture,
+                          float depth);
+
+/**
+ * @brief Replays a command buffer in the active pass
+ *
+ * Commands are executed in the order they were recorded (or sorted by
+ * `pg_sort_cmdbuf`), starting from the active state. The active state is restored afterwards, but shader state
+ * (textures, samplers, and uniform blocks) is not. The command buffer is left
+ * intact, so it may be submitted again.
+ */
+void pg_submit_cmdbuf(pg_ctx_t* ctx, const pg_cmdbuf_t* cmdbuf);
 
 /*=============================================================================
  * Internals
@@ -757,6 +1254,7 @@ pg_shader_t* pg_create_shader_internal(pg_ctx_t* ctx, pg_shader_internal_t inter
 
 #ifdef PICO_GFX_IMPLEMENTATION
 
+#include <stdlib.h>
 #include <string.h>
 
 /*=============================================================================
@@ -771,6 +1269,18 @@ pg_shader_t* pg_create_shader_internal(pg_ctx_t* ctx, pg_shader_internal_t inter
 #define PICO_GFX_HASHTABLE_KEY_SIZE 16
 #endif
 
+#ifndef PICO_GFX_MAX_PASS_STATS
+#define PICO_GFX_MAX_PASS_STATS 16
+#endif
+
+#ifndef PICO_GFX_ATLAS_KEY_SIZE
+#define PICO_GFX_ATLAS_KEY_SIZE 32
+#endif
+
+#if defined(PICO_GFX_PROFILE) && !defined(PICO_TIME_H)
+    #error "PICO_GFX_PROFILE requires pico_time.h to be included first"
+#endif
+
 /*=============================================================================
  * Macros
  *============================================================================*/
@@ -873,6 +1383,7 @@ typedef struct pg_arena_t pg_arena_t;
 
 static pg_arena_t* pg_arena_new(size_t size, void* mem_ctx);
 static void* pg_arena_alloc(pg_arena_t* arena, size_t size);
+static void pg_arena_reset(pg_arena_t* arena);
 static void pg_arena_free(pg_arena_t* arena);
 
 /*=============================================================================
@@ -905,8 +1416,19 @@ typedef struct pg_state_t
     pg_shader_t*   shader;
     pg_buffer_t*   index_buffer;
     pg_buffer_t*   buffers[PG_MAX_VERTEX_BUFFERS];
+    int            buffer_offsets[PG_MAX_VERTEX_BUFFERS]; // -1 if not fixed
 } pg_state_t;
 
+// State most recently submitted to sokol_gfx in the current pass
+typedef struct pg_applied_state_t
+{
+    bool        valid;
+    sg_pipeline pipeline;
+    sg_bindings bindings;
+    pg_rect_t   viewport;
+    pg_rect_t   scissor;
+} pg_applied_state_t;
+
 struct pg_ctx_t
 {
     void* mem_ctx;
@@ -920,6 +1442,16 @@ struct pg_ctx_t
     pg_state_t state;
     pg_state_t state_stack[PICO_GFX_STACK_MAX_SIZE];
     int stack_size;
+    pg_applied_state_t applied;
+    pg_batch_t* batch;
+    pg_stats_t stats;
+    pg_stats_t frame_stats;
+    pg_stats_t pass_start_stats;
+    pg_stats_t pass_stats[PICO_GFX_MAX_PASS_STATS];
+    pg_stats_t frame_pass_stats[PICO_GFX_MAX_PASS_STATS];
+#ifdef PICO_GFX_PROFILE
+    ptime_t pass_start_time;
+#endif
 };
 
 struct pg_pipeline_t
@@ -931,6 +1463,15 @@ struct pg_pipeline_t
     pg_shader_t* shader;
 };
 
+typedef struct
+{
+    int        slot;
+    pg_stage_t stage;
+    void*      data;
+    size_t     size;
+    bool       dirty;
+} pg_uniform_block_t;
+
 struct pg_shader_t
 {
     pg_ctx_t* ctx;
@@ -939,18 +1480,12 @@ struct pg_shader_t
     pg_shader_internal_t internal;
     pg_texture_t* textures[PG_MAX_TEXTURE_SLOTS];
     pg_sampler_t* samplers[PG_MAX_SAMPLER_SLOTS];
-    pg_hashtable_t* uniform_blocks;
+    pg_uniform_block_t uniform_blocks[PG_MAX_UNIFORM_BLOCKS];
+    int uniform_block_count;
+    pg_hashtable_t* uniform_block_handles;
     pg_arena_t* arena;
 };
 
-typedef struct
-{
-    int        slot;
-    pg_stage_t stage;
-    void*      data;
-    size_t     size;
-} pg_uniform_block_t;
-
 struct pg_texture_t
 {
     pg_ctx_t* ctx;
@@ -961,6 +1496,33 @@ struct pg_texture_t
     sg_attachments attachments;
 };
 
+typedef struct
+{
+    int x, y, width;
+} pg_skyline_node_t;
+
+typedef struct
+{
+    pg_texture_t* texture;
+    uint8_t* pixels;
+    pg_skyline_node_t* nodes;
+    int node_count;
+    bool dirty;
+} pg_atlas_page_t;
+
+struct pg_atlas_t
+{
+    pg_ctx_t* ctx;
+    int width, height;
+    int padding;
+    pg_atlas_page_t* pages;
+    int page_count;
+    pg_atlas_region_t* regions;
+    int region_count;
+    int region_capacity;
+    pg_hashtable_t* region_handles;
+};
+
 struct pg_sampler_t
 {
     pg_ctx_t* ctx;
@@ -979,11 +1541,92 @@ struct pg_buffer_t
     size_t offset;
 };
 
-void pg_init(void)
+struct pg_batch_t
 {
-    sg_setup(&(sg_desc)
+    pg_ctx_t* ctx;
+    pg_buffer_t* buffer;
+    pg_state_t state;
+    size_t capacity;
+    size_t element_size;
+    size_t count;
+    char* data;
+    bool instanced;
+    pg_buffer_t* vertex_buffer;
+    size_t vertex_count;
+};
+
+typedef enum
+{
+    PG_CMD_SET_PIPELINE,
+    PG_CMD_SET_VIEWPORT,
+    PG_CMD_SET_SCISSOR,
+    PG_CMD_BIND_BUFFER,
+    PG_CMD_SET_INDEX_BUFFER,
+    PG_CMD_BIND_TEXTURE,
+    PG_CMD_BIND_SAMPLER,
+    PG_CMD_SET_UNIFORM_BLOCK,
+    PG_CMD_APPEND_BUFFER,
+    PG_CMD_DRAW,
+    PG_CMD_SORT_KEY,
+} pg_cmd_type_t;
+
+typedef struct pg_cmd_t
+{
+    struct pg_cmd_t* next;
+    pg_cmd_type_t type;
+
+    union
     {
-        .logger.func = pg_log_sg,
+        pg_pipeline_t* pipeline;
+        pg_rect_t rect;
+        struct { int slot; pg_buffer_t* buffer; int offset; } buffer;
+        struct { pg_shader_t* shader; int handle; pg_texture_t* texture; } texture;
+        struct { pg_shader_t* shader; int handle; pg_sampler_t* sampler; } sampler;
+        struct { pg_shader_t* shader; int handle; void* data; } uniforms;
+        struct { pg_buffer_t* buffer; void* data; size_t count; } append;
+        struct { size_t start; size_t count; size_t instances; } draw;
+        uint64_t key;
+    } u;
+} pg_cmd_t;
+
+struct pg_cmdbuf_t
+{
+    pg_ctx_t* ctx;
+    pg_arena_t* arena;
+    pg_cmd_t* head;
+    pg_cmd_t* tail;
+    size_t group_count;
+};
+
+typedef struct
+{
+    uint64_t  key;
+    size_t    seq;
+    pg_cmd_t* head;
+    pg_cmd_t* tail;
+} pg_cmd_group_t;
+
+static bool pg_rect_equal(const pg_rect_t* a, const pg_rect_t* b)
+{
+    return a->x == b->x && a->y == b->y &&
+           a->width == b->width && a->height == b->height;
+}
+
+// Draws the pending batch if it depends on the shader state that is about to
+// change
+static void pg_flush_shader_batch(pg_shader_t* shader)
+{
+    pg_batch_t* batch = shader->ctx->batch;
+
+    if (batch && batch->state.pipeline->shader == shader)
+        pg_flush_batch(batch);
+}
+
+void pg_init(void)
+{
+    sg_setup(&(sg_desc)
+    {
+        .logger.func = pg_log_sg,
         .allocator =
         {
             .alloc_fn = pg_malloc,
@@ -1099,6 +1742,16 @@ void pg_begin_pass(pg_ctx_t* ctx, pg_texture_t* target, bool clear)
 
     sg_begin_pass(&pass);
 
+    // Counters are attributed to the pass by their difference at pg_end_pass
+    ctx->pass_start_stats = ctx->stats;
+
+#ifdef PICO_GFX_PROFILE
+    ctx->pass_start_time = pt_now();
+#endif
+
+    // Nothing has been applied in the new pass
+    ctx->applied.valid = false;
+
     pg_reset_viewport(ctx);
     pg_reset_scissor(ctx);
 
@@ -1107,15 +1760,65 @@ void pg_begin_pass(pg_ctx_t* ctx, pg_texture_t* target, bool clear)
 
 void pg_end_pass(pg_ctx_t* ctx)
 {
+    PICO_GFX_ASSERT(ctx);
+
+    if (ctx->batch)
+        pg_flush_batch(ctx->batch);
+
     sg_end_pass();
     ctx->target = NULL;
     ctx->pass_active = false;
+
+    pg_stats_t* stats = &ctx->stats;
+
+#ifdef PICO_GFX_PROFILE
+    stats->cpu_time += pt_to_sec(pt_now() - ctx->pass_start_time);
+#endif
+
+    if (stats->passes < PICO_GFX_MAX_PASS_STATS)
+    {
+        const pg_stats_t* start = &ctx->pass_start_stats;
+
+        ctx->pass_stats[stats->passes] = (pg_stats_t)
+        {
+            .passes            = 1,
+            .draws             = stats->draws - start->draws,
+            .pipeline_switches = stats->pipeline_switches - start->pipeline_switches,
+            .texture_switches  = stats->texture_switches - start->texture_switches,
+            .texture_binds     = stats->texture_binds - start->texture_binds,
+            .bytes_uploaded    = stats->bytes_uploaded - start->bytes_uploaded,
+            .cpu_time          = stats->cpu_time - start->cpu_time
+        };
+    }
+
+    stats->passes++;
 }
 
 void pg_flush(pg_ctx_t* ctx)
 {
-    (void)ctx;
+    PICO_GFX_ASSERT(ctx);
+
     sg_commit();
+
+    ctx->frame_stats = ctx->stats;
+    memcpy(ctx->frame_pass_stats, ctx->pass_stats, sizeof(ctx->pass_stats));
+    memset(&ctx->stats, 0, sizeof(pg_stats_t));
+}
+
+pg_stats_t pg_get_stats(const pg_ctx_t* ctx)
+{
+    PICO_GFX_ASSERT(ctx);
+    return ctx->frame_stats;
+}
+
+pg_stats_t pg_get_pass_stats(const pg_ctx_t* ctx, int pass)
+{
+    PICO_GFX_ASSERT(ctx);
+    PICO_GFX_ASSERT(pass >= 0);
+    PICO_GFX_ASSERT(pass < ctx->frame_stats.passes);
+    PICO_GFX_ASSERT(pass < PICO_GFX_MAX_PASS_STATS);
+
+    return ctx->frame_pass_stats[pass];
 }
 
 void pg_push_state(pg_ctx_t* ctx)
@@ -1211,12 +1914,26 @@ void pg_bind_buffer(pg_ctx_t* ctx, int slot, pg_buffer_t* buffer)
     PICO_GFX_ASSERT(slot < PG_MAX_VERTEX_BUFFERS);
 
     ctx->state.buffers[slot] = buffer;
+    ctx->state.buffer_offsets[slot] = -1;
+}
+
+void pg_bind_buffer_offset(pg_ctx_t* ctx, int slot, pg_buffer_t* buffer, int offset)
+{
+    PICO_GFX_ASSERT(offset >= 0);
+
+    pg_bind_buffer(ctx, slot, buffer);
+    ctx->state.buffer_offsets[slot] = offset;
 }
 
 void pg_reset_buffers(pg_ctx_t* ctx)
 {
     PICO_GFX_ASSERT(ctx);
     memset(&ctx->state.buffers, 0, sizeof(ctx->state.buffers));
+
+    for (int slot = 0; slot < PG_MAX_VERTEX_BUFFERS; slot++)
+    {
+        ctx->state.buffer_offsets[slot] = -1;
+    }
 }
 
 void pg_set_index_buffer(pg_ctx_t* ctx, pg_buffer_t* buffer)
@@ -1237,17 +1954,33 @@ void pg_bind_texture(pg_shader_t* shader, const char* name, pg_texture_t* textur
     PICO_GFX_ASSERT(shader);
     PICO_GFX_ASSERT(name);
 
-    int slot = shader->internal.get_img_slot(SG_SHADERSTAGE_FS, name);
+    pg_bind_texture_by_handle(shader, pg_get_texture_handle(shader, name), texture);
+}
 
-    PICO_GFX_ASSERT(slot >= 0);
-    PICO_GFX_ASSERT(slot < PG_MAX_TEXTURE_SLOTS);
+int pg_get_texture_handle(const pg_shader_t* shader, const char* name)
+{
+    PICO_GFX_ASSERT(shader);
+    PICO_GFX_ASSERT(name);
+
+    return shader->internal.get_img_slot(SG_SHADERSTAGE_FS, name);
+}
+
+void pg_bind_texture_by_handle(pg_shader_t* shader, int handle, pg_texture_t* texture)
+{
+    PICO_GFX_ASSERT(shader);
+    PICO_GFX_ASSERT(handle >= 0);
+    PICO_GFX_ASSERT(handle < PG_MAX_TEXTURE_SLOTS);
 
-    shader->textures[slot] = texture;
+    if (shader->textures[handle] != texture)
+        pg_flush_shader_batch(shader);
+
+    shader->textures[handle] = texture;
 }
 
 void pg_reset_textures(pg_shader_t* shader)
 {
     PICO_GFX_ASSERT(shader);
+    pg_flush_shader_batch(shader);
     memset(shader->textures, 0, sizeof(shader->textures));
 }
 
@@ -1256,17 +1989,33 @@ void pg_bind_sampler(pg_shader_t* shader, const char* name, pg_sampler_t* sample
     PICO_GFX_ASSERT(shader);
     PICO_GFX_ASSERT(name);
 
-    int slot = shader->internal.get_smp_slot(SG_SHADERSTAGE_FS, name);
+    pg_bind_sampler_by_handle(shader, pg_get_sampler_handle(shader, name), sampler);
+}
 
-    PICO_GFX_ASSERT(slot >= 0);
-    PICO_GFX_ASSERT(slot < PG_MAX_TEXTURE_SLOTS);
+int pg_get_sampler_handle(const pg_shader_t* shader, const char* name)
+{
+    PICO_GFX_ASSERT(shader);
+    PICO_GFX_ASSERT(name);
+
+    return shader->internal.get_smp_slot(SG_SHADERSTAGE_FS, name);
+}
+
+void pg_bind_sampler_by_handle(pg_shader_t* shader, int handle, pg_sampler_t* sampler)
+{
+    PICO_GFX_ASSERT(shader);
+    PICO_GFX_ASSERT(handle >= 0);
+    PICO_GFX_ASSERT(handle < PG_MAX_SAMPLER_SLOTS);
+
+    if (shader->samplers[handle] != sampler)
+        pg_flush_shader_batch(shader);
 
-    shader->samplers[slot] = sampler;
+    shader->samplers[handle] = sampler;
 }
 
 void pg_reset_samplers(pg_shader_t* shader)
 {
     PICO_GFX_ASSERT(shader);
+    pg_flush_shader_batch(shader);
     memset(shader->samplers, 0, sizeof(shader->samplers));
 }
 
@@ -1391,10 +2140,11 @@ pg_shader_t* pg_create_shader_internal(pg_ctx_t* ctx, pg_shader_internal_t inter
 {
     pg_shader_t* shader = PICO_GFX_MALLOC(sizeof(pg_shader_t), ctx->mem_ctx);
 
+    shader->ctx = ctx;
+
     pg_reset_textures(shader);
     pg_reset_samplers(shader);
 
-    shader->ctx = ctx;
     shader->internal = internal;
     shader->desc = internal.get_shader_desc(sg_query_backend());
 
@@ -1402,9 +2152,9 @@ pg_shader_t* pg_create_shader_internal(pg_ctx_t* ctx, pg_shader_internal_t inter
 
     shader->handle = sg_make_shader(shader->desc);
 
-    shader->uniform_blocks = pg_hashtable_new(16, PICO_GFX_HASHTABLE_KEY_SIZE,
-                                              sizeof(pg_uniform_block_t),
-                                              ctx->mem_ctx);
+    shader->uniform_block_count = 0;
+    shader->uniform_block_handles = pg_hashtable_new(16, PICO_GFX_HASHTABLE_KEY_SIZE,
+                                                     sizeof(int), ctx->mem_ctx);
 
     shader->arena = pg_arena_new(512, ctx->mem_ctx);
 
@@ -1415,7 +2165,7 @@ void pg_destroy_shader(pg_shader_t* shader)
 {
     PICO_GFX_ASSERT(shader);
     sg_destroy_shader(shader->handle);
-    pg_hashtable_free(shader->uniform_blocks);
+    pg_hashtable_free(shader->uniform_block_handles);
     pg_arena_free(shader->arena);
     PICO_GFX_FREE(shader, shader->ctx->mem_ctx);
 }
@@ -1431,17 +2181,26 @@ void pg_alloc_uniform_block(pg_shader_t* shader, pg_stage_t stage, const char* n
     PICO_GFX_ASSERT(shader);
     PICO_GFX_ASSERT(name);
 
+    // Registering a block twice is harmless
+    if (pg_get_uniform_block_handle(shader, name) >= 0)
+        return;
+
+    PICO_GFX_ASSERT(shader->uniform_block_count < PG_MAX_UNIFORM_BLOCKS);
+
     size_t size = shader->internal.get_uniformblock_size(pg_map_stage(stage), name);
 
-    pg_uniform_block_t block =
+    int handle = shader->uniform_block_count++;
+
+    shader->uniform_blocks[handle] = (pg_uniform_block_t)
     {
         .slot  = shader->internal.get_uniformblock_slot(pg_map_stage(stage), name),
         .stage = stage,
         .data  = pg_arena_alloc(shader->arena, size),
         .size  = size,
+        .dirty = true,
     };
 
-    pg_hashtable_put(shader->uniform_blocks, name, &block);
+    pg_hashtable_put(shader->uniform_block_handles, name, &handle);
 }
 
 void pg_set_uniform_block(pg_shader_t* shader,
@@ -1452,11 +2211,39 @@ void pg_set_uniform_block(pg_shader_t* shader,
     PICO_GFX_ASSERT(name);
     PICO_GFX_ASSERT(data);
 
-    pg_uniform_block_t* block = pg_hashtable_get(shader->uniform_blocks, name);
+    int handle = pg_get_uniform_block_handle(shader, name);
+
+    PICO_GFX_ASSERT(handle >= 0);
+
+    pg_set_uniform_block_by_handle(shader, handle, data);
+}
+
+int pg_get_uniform_block_handle(const pg_shader_t* shader, const char* name)
+{
+    PICO_GFX_ASSERT(shader);
+    PICO_GFX_ASSERT(name);
+
+    const int* handle = pg_hashtable_get(shader->uniform_block_handles, name);
+
+    return (handle) ? *handle : -1;
+}
+
+void pg_set_uniform_block_by_handle(pg_shader_t* shader, int handle, const void* data)
+{
+    PICO_GFX_ASSERT(shader);
+    PICO_GFX_ASSERT(handle >= 0);
+    PICO_GFX_ASSERT(handle < shader->uniform_block_count);
+    PICO_GFX_ASSERT(data);
+
+    pg_uniform_block_t* block = &shader->uniform_blocks[handle];
+
+    if (memcmp(block->data, data, block->size) == 0)
+        return;
 
-    PICO_GFX_ASSERT(block);
+    pg_flush_shader_batch(shader);
 
     memcpy(block->data, data, block->size);
+    block->dirty = true;
 }
 
 pg_texture_t* pg_create_texture(pg_ctx_t* ctx,
@@ -1469,8 +2256,10 @@ pg_texture_t* pg_create_texture(pg_ctx_t* ctx,
     PICO_GFX_ASSERT(data);
     PICO_GFX_ASSERT(size > 0);
 
+    const pg_texture_opts_t default_opts = { 0 };
+
     if (opts == NULL)
-        opts = &(pg_texture_opts_t){ 0 };
+        opts = &default_opts;
 
     PICO_GFX_ASSERT(opts->mipmaps >= 0);
 
@@ -1502,8 +2291,10 @@ pg_texture_t* pg_create_render_texture(pg_ctx_t* ctx,
     PICO_GFX_ASSERT(width > 0);
     PICO_GFX_ASSERT(height > 0);
 
+    const pg_texture_opts_t default_opts = { 0 };
+
     if (opts == NULL)
-        opts = &(pg_texture_opts_t){ 0 };
+        opts = &default_opts;
 
     PICO_GFX_ASSERT(opts->mipmaps >= 0);
 
@@ -1556,8 +2347,10 @@ void pg_update_texture(pg_texture_t* texture, char* data, int width, int height)
     // NOTE: Replaces all existing data
     sg_image_data img_data = { 0 };
     img_data.subimage[0][0].ptr = data;
-    img_data.subimage[0][0].size = (size_t)(width * height);
+    img_data.subimage[0][0].size = (size_t)(width * height * 4);
     sg_update_image(texture->handle, &img_data);
+
+    texture->ctx->stats.bytes_uploaded += img_data.subimage[0][0].size;
 }
 
 uint32_t pg_get_texture_id(const pg_texture_t* texture)
@@ -1577,255 +2370,1254 @@ void pg_get_texture_size(const pg_texture_t* texture, int* width, int* height)
         *height = texture->height;
 }
 
-pg_sampler_t* pg_create_sampler(pg_ctx_t* ctx, const pg_sampler_opts_t* opts)
+// Atlas pages are dynamic images because sokol_gfx can only update those
+static pg_texture_t* pg_create_atlas_texture(pg_ctx_t* ctx, int width, int height)
 {
-    if (opts == NULL)
-        opts = &(pg_sampler_opts_t){ 0 };
+    pg_texture_t* texture = PICO_GFX_MALLOC(sizeof(pg_texture_t), ctx->mem_ctx);
+
+    sg_image_desc desc = { 0 };
+
+    desc.usage = SG_USAGE_DYNAMIC;
+    desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+
+    desc.width  = texture->width  = width;
+    desc.height = texture->height = height;
+
+    texture->ctx = ctx;
+    texture->target = false;
+    texture->handle = sg_make_image(&desc);
+
+    PICO_GFX_ASSERT(sg_query_image_state(texture->handle) == SG_RESOURCESTATE_VALID);
+
+    return texture;
+}
+
+pg_atlas_t* pg_create_atlas(pg_ctx_t* ctx, int page_width, int page_height, int padding)
+{
+    PICO_GFX_ASSERT(ctx);
+    PICO_GFX_ASSERT(page_width > 0);
+    PICO_GFX_ASSERT(page_height > 0);
+    PICO_GFX_ASSERT(padding >= 0);
+
+    pg_atlas_t* atlas = PICO_GFX_MALLOC(sizeof(pg_atlas_t), ctx->mem_ctx);
+
+    atlas->ctx = ctx;
+    atlas->width = page_width;
+    atlas->height = page_height;
+    atlas->padding = padding;
+    atlas->pages = NULL;
+    atlas->page_count = 0;
+    atlas->regions = NULL;
+    atlas->region_count = 0;
+    atlas->region_capacity = 0;
+    atlas->region_handles = pg_hashtable_new(16, PICO_GFX_ATLAS_KEY_SIZE,
+                                             sizeof(int), ctx->mem_ctx);
+
+    return atlas;
+}
+
+void pg_destroy_atlas(pg_atlas_t* atlas)
+{
+    PICO_GFX_ASSERT(atlas);
+
+    for (int i = 0; i < atlas->page_count; i++)
+    {
+        pg_atlas_page_t* page = &atlas->pages[i];
+
+        pg_destroy_texture(page->texture);
+        PICO_GFX_FREE(page->pixels, atlas->ctx->mem_ctx);
+        PICO_GFX_FREE(page->nodes, atlas->ctx->mem_ctx);
+    }
+
+    pg_hashtable_free(atlas->region_handles);
+
+    PICO_GFX_FREE(atlas->pages, atlas->ctx->mem_ctx);
+    PICO_GFX_FREE(atlas->regions, atlas->ctx->mem_ctx);
+    PICO_GFX_FREE(atlas, atlas->ctx->mem_ctx);
+}
+
+static pg_atlas_page_t* pg_add_atlas_page(pg_atlas_t* atlas)
+{
+    atlas->pages = PICO_GFX_REALLOC(atlas->pages,
+                                    (size_t)(atlas->page_count + 1) * sizeof(pg_atlas_page_t),
+                                    atlas->ctx->mem_ctx);
+
+    pg_atlas_page_t* page = &atlas->pages[atlas->page_count++];
+
+    size_t pixels_size = (size_t)atlas->width * (size_t)atlas->height * 4;
+
+    page->texture = pg_create_atlas_texture(atlas->ctx, atlas->width, atlas->height);
+    page->pixels = PICO_GFX_MALLOC(pixels_size, atlas->ctx->mem_ctx);
+    memset(page->pixels, 0, pixels_size);
+
+    // The skyline spans the page plus the padding to the right of the last
+    // column, so images can touch the right edge. Every node is at least one
+    // pixel wide, which bounds the number of nodes (plus one during insertion)
+    int skyline_width = atlas->width + atlas->padding;
+
+    page->nodes = PICO_GFX_MALLOC((size_t)(skyline_width + 1) * sizeof(pg_skyline_node_t),
+                                  atlas->ctx->mem_ctx);
+
+    page->nodes[0] = (pg_skyline_node_t){ 0, 0, skyline_width };
+    page->node_count = 1;
+    page->dirty = true;
+
+    return page;
+}
+
+// Returns the height at which a rectangle placed at the start of a skyline
+// node would rest, or -1 if the rectangle does not fit
+static int pg_skyline_fit(const pg_atlas_t* atlas,
+                          const pg_atlas_page_t* page,
+                          int index, int width, int height)
+{
+    const pg_skyline_node_t* nodes = page->nodes;
+
+    if (nodes[index].x + width > atlas->width + atlas->padding)
+        return -1;
+
+    int y = 0;
+    int remaining = width;
+
+    for (int i = index; remaining > 0; i++)
+    {
+        if (nodes[i].y > y)
+            y = nodes[i].y;
+
+        remaining -= nodes[i].width;
+    }
+
+    if (y + height > atlas->height + atlas->padding)
+        return -1;
+
+    return y;
+}
+
+static void pg_skyline_remove(pg_atlas_page_t* page, int index)
+{
+    memmove(&page->nodes[index], &page->nodes[index + 1],
+            (size_t)(page->node_count - index - 1) * sizeof(pg_skyline_node_t));
+
+    page->node_count--;
+}
+
+// Reserves a rectangle in the page using the skyline bottom-left heuristic
+static bool pg_skyline_insert(const pg_atlas_t* atlas,
+                              pg_atlas_page_t* page,
+                              int width, int height,
+                              int* x, int* y)
+{
+    pg_skyline_node_t* nodes = page->nodes;
+
+    int best_index = -1;
+    int best_top = 0;
+    int best_width = 0;
+    int best_y = 0;
+
+    for (int i = 0; i < page->node_count; i++)
+    {
+        int fit_y = pg_skyline_fit(atlas, page, i, width, height);
+
+        if (fit_y < 0)
+            continue;
+
+        int top = fit_y + height;
+
+        if (best_index < 0 || top < best_top ||
+            (top == best_top && nodes[i].width < best_width))
+        {
+            best_index = i;
+            best_top = top;
+            best_width = nodes[i].width;
+            best_y = fit_y;
+        }
+    }
+
+    if (best_index < 0)
+        return false;
+
+    *x = nodes[best_index].x;
+    *y = best_y;
+
+    memmove(&nodes[best_index + 1], &nodes[best_index],
+            (size_t)(page->node_count - best_index) * sizeof(pg_skyline_node_t));
+
+    nodes[best_index] = (pg_skyline_node_t){ *x, best_top, width };
+    page->node_count++;
+
+    // Trim the nodes that are now covered by the new node
+    int i = best_index + 1;
+
+    while (i < page->node_count)
+    {
+        int end = nodes[i - 1].x + nodes[i - 1].width;
+
+        if (nodes[i].x >= end)
+            break;
+
+        int overlap = end - nodes[i].x;
+
+        nodes[i].x += overlap;
+        nodes[i].width -= overlap;
+
+        if (nodes[i].width > 0)
+            break;
+
+        pg_skyline_remove(page, i);
+    }
+
+    // Merge neighbours at the same height
+    i = 0;
+
+    while (i + 1 < page->node_count)
+    {
+        if (nodes[i].y == nodes[i + 1].y)
+        {
+            nodes[i].width += nodes[i + 1].width;
+            pg_skyline_remove(page, i + 1);
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    return true;
+}
+
+static void pg_blit_atlas_image(pg_atlas_t* atlas,
+                                const pg_atlas_region_t* region,
+                                const uint8_t* data)
+{
+    pg_atlas_page_t* page = &atlas->pages[region->page];
+
+    size_t row_size = (size_t)region->width * 4;
+
+    for (int row = 0; row < region->height; row++)
+    {
+        size_t offset = ((size_t)(region->y + row) * (size_t)atlas->width +
+                         (size_t)region->x) * 4;
+
+        memcpy(page->pixels + offset, data + (size_t)row * row_size, row_size);
+    }
+
+    page->dirty = true;
+}
+
+bool pg_add_atlas_image(pg_atlas_t* atlas,
+                        const char* key,
+                        const uint8_t* data,
+                        int width, int height)
+{
+    PICO_GFX_ASSERT(atlas);
+    PICO_GFX_ASSERT(key);
+    PICO_GFX_ASSERT(strlen(key) < PICO_GFX_ATLAS_KEY_SIZE);
+    PICO_GFX_ASSERT(!pg_hashtable_get(atlas->region_handles, key));
+    PICO_GFX_ASSERT(data);
+    PICO_GFX_ASSERT(width > 0);
+    PICO_GFX_ASSERT(height > 0);
+
+    if (width > atlas->width || height > atlas->height)
+        return false;
+
+    int padded_width  = width  + atlas->padding;
+    int padded_height = height + atlas->padding;
+
+    int page_index = -1;
+    int x = 0, y = 0;
+
+    for (int i = 0; i < atlas->page_count; i++)
+    {
+        if (pg_skyline_insert(atlas, &atlas->pages[i], padded_width, padded_height, &x, &y))
+        {
+            page_index = i;
+            break;
+        }
+    }
+
+    if (page_index < 0)
+    {
+        pg_atlas_page_t* page = pg_add_atlas_page(atlas);
+
+        bool inserted = pg_skyline_insert(atlas, page, padded_width, padded_height, &x, &y);
+
+        PICO_GFX_ASSERT(inserted);
+        (void)inserted;
+
+        page_index = atlas->page_count - 1;
+    }
+
+    if (atlas->region_count == atlas->region_capacity)
+    {
+        atlas->region_capacity = (atlas->region_capacity > 0) ? 2 * atlas->region_capacity : 16;
+
+        atlas->regions = PICO_GFX_REALLOC(atlas->regions,
+                                          (size_t)atlas->region_capacity * sizeof(pg_atlas_region_t),
+                                          atlas->ctx->mem_ctx);
+    }
+
+    int handle = atlas->region_count++;
+
+    float page_width  = (float)atlas->width;
+    float page_height = (float)atlas->height;
+
+    pg_atlas_region_t* region = &atlas->regions[handle];
+
+    *region = (pg_atlas_region_t)
+    {
+        .texture = atlas->pages[page_index].texture,
+        .page    = page_index,
+        .x = x, .y = y,
+        .width = width, .height = height,
+        .u0 = (float)x / page_width,
+        .v0 = (float)y / page_height,
+        .u1 = (float)(x + width)  / page_width,
+        .v1 = (float)(y + height) / page_height
+    };
+
+    pg_hashtable_put(atlas->region_handles, key, &handle);
+
+    pg_blit_atlas_image(atlas, region, data);
+
+    return true;
+}
+
+void pg_update_atlas_image(pg_atlas_t* atlas, const char* key, const uint8_t* data)
+{
+    PICO_GFX_ASSERT(atlas);
+    PICO_GFX_ASSERT(key);
+    PICO_GFX_ASSERT(data);
+
+    const int* handle = pg_hashtable_get(atlas->region_handles, key);
+
+    PICO_GFX_ASSERT(handle);
+
+    if (!handle)
+        return;
+
+    pg_blit_atlas_image(atlas, &atlas->regions[*handle], data);
+}
+
+bool pg_get_atlas_region(const pg_atlas_t* atlas,
+                         const char* key,
+                         pg_atlas_region_t* region)
+{
+    PICO_GFX_ASSERT(atlas);
+    PICO_GFX_ASSERT(key);
+
+    const int* handle = pg_hashtable_get(atlas->region_handles, key);
+
+    if (!handle)
+        return false;
+
+    if (region)
+        *region = atlas->regions[*handle];
+
+    return true;
+}
+
+void pg_commit_atlas(pg_atlas_t* atlas)
+{
+    PICO_GFX_ASSERT(atlas);
+
+    // sokol_gfx can only replace whole images, so dirty pages are uploaded
+    // in full from their CPU copies
+    for (int i = 0; i < atlas->page_count; i++)
+    {
+        pg_atlas_page_t* page = &atlas->pages[i];
+
+        if (!page->dirty)
+            continue;
+
+        pg_update_texture(page->texture, (char*)page->pixels, atlas->width, atlas->height);
+        page->dirty = false;
+    }
+}
+
+int pg_get_atlas_page_count(const pg_atlas_t* atlas)
+{
+    PICO_GFX_ASSERT(atlas);
+    return atlas->page_count;
+}
+
+pg_texture_t* pg_get_atlas_page(const pg_atlas_t* atlas, int page)
+{
+    PICO_GFX_ASSERT(atlas);
+    PICO_GFX_ASSERT(page >= 0 && page < atlas->page_count);
+    return atlas->pages[page].texture;
+}
+
+pg_sampler_t* pg_create_sampler(pg_ctx_t* ctx, const pg_sampler_opts_t* opts)
+{
+    const pg_sampler_opts_t default_opts = { 0 };
+
+    if (opts == NULL)
+        opts = &default_opts;
+
+    pg_sampler_t* sampler = PICO_GFX_MALLOC(sizeof(pg_sampler_t), ctx->mem_ctx);
+
+    sg_sampler_desc desc = { 0 };
+
+    desc.min_filter = (opts->smooth) ? SG_FILTER_LINEAR : SG_FILTER_NEAREST;
+    desc.mag_filter = (opts->smooth) ? SG_FILTER_LINEAR : SG_FILTER_NEAREST;
+
+    desc.wrap_u = (opts->repeat_u) ? SG_WRAP_REPEAT : SG_WRAP_CLAMP_TO_EDGE;
+    desc.wrap_v = (opts->repeat_v) ? SG_WRAP_REPEAT : SG_WRAP_CLAMP_TO_EDGE;
+
+    sampler->ctx = ctx;
+    sampler->handle = sg_make_sampler(&desc);
+
+    return sampler;
+}
+
+void pg_destroy_sampler(pg_sampler_t* sampler)
+{
+    sg_destroy_sampler(sampler->handle);
+    PICO_GFX_FREE(sampler, sampler->ctx->mem_ctx);
+}
+
+// Uploads uniform blocks that have changed since they were last applied, or
+// all uniform blocks if forced
+static void pg_apply_uniforms(pg_shader_t* shader, bool force)
+{
+    PICO_GFX_ASSERT(shader);
+
+    for (int i = 0; i < shader->uniform_block_count; i++)
+    {
+        pg_uniform_block_t* block = &shader->uniform_blocks[i];
+
+        if (!force && !block->dirty)
+            continue;
+
+        block->dirty = false;
+
+        sg_range range = { .ptr = block->data, .size = block->size };
+
+        sg_shader_stage stage = pg_map_stage(block->stage);
+
+        sg_apply_uniforms(stage, block->slot, &range);
+    }
+}
+
+pg_buffer_t* pg_create_vertex_buffer(pg_ctx_t* ctx,
+                                     pg_buffer_usage_t usage,
+                                     const void* data,
+                                     size_t count,
+                                     size_t max_elements,
+                                     size_t element_size)
+{
+    PICO_GFX_ASSERT(ctx);
+
+    pg_buffer_t* buffer = PICO_GFX_MALLOC(sizeof(pg_buffer_t), ctx->mem_ctx);
+
+    buffer->ctx = ctx;
+    buffer->type = PG_BUFFER_TYPE_VERTEX;
+    buffer->usage = usage;
+    buffer->count = count;
+    buffer->element_size = element_size;
+    buffer->size = max_elements * element_size;
+    buffer->offset = 0;
+
+    buffer->handle = sg_make_buffer(&(sg_buffer_desc)
+    {
+        .type  = SG_BUFFERTYPE_VERTEXBUFFER,
+        .usage = pg_map_usage(usage),
+        .data  = { .ptr = data, .size = count * element_size },
+        .size  = buffer->size
+    });
+
+    PICO_GFX_ASSERT(sg_query_buffer_state(buffer->handle) == SG_RESOURCESTATE_VALID);
+
+    return buffer;
+}
+
+pg_buffer_t* pg_create_index_buffer(pg_ctx_t* ctx,
+                                    pg_buffer_usage_t usage,
+                                    const void* data,
+                                    size_t count,
+                                    size_t max_elements)
+{
+    PICO_GFX_ASSERT(ctx);
+
+    pg_buffer_t* buffer = PICO_GFX_MALLOC(sizeof(pg_buffer_t), ctx->mem_ctx);
+
+    buffer->ctx = ctx;
+    buffer->type = PG_BUFFER_TYPE_INDEX;
+    buffer->usage = usage;
+    buffer->count = count;
+    buffer->size = max_elements * sizeof(uint32_t);
+    buffer->offset = 0;
+
+    buffer->handle = sg_make_buffer(&(sg_buffer_desc)
+    {
+        .type  = SG_BUFFERTYPE_INDEXBUFFER,
+        .usage = pg_map_usage(usage),
+        .data  = { .ptr = data, .size = count * sizeof(uint32_t) },
+        .size  = buffer->size
+    });
+
+    PICO_GFX_ASSERT(sg_query_buffer_state(buffer->handle) == SG_RESOURCESTATE_VALID);
+
+    return buffer;
+}
+
+void pg_update_buffer(pg_buffer_t* buffer, void* data, size_t count)
+{
+    PICO_GFX_ASSERT(buffer);
+    PICO_GFX_ASSERT(data);
+    PICO_GFX_ASSERT(count > 0);
+
+    sg_update_buffer(buffer->handle, &(sg_range)
+    {
+        .ptr = data,
+        .size = count * buffer->element_size
+    });
+
+    buffer->count = count;
+    buffer->offset = 0;
+
+    buffer->ctx->stats.bytes_uploaded += count * buffer->element_size;
+}
+
+int pg_append_buffer(pg_buffer_t* buffer, void* data, size_t count)
+{
+    PICO_GFX_ASSERT(buffer);
+    PICO_GFX_ASSERT(data);
+    PICO_GFX_ASSERT(count > 0);
+
+    int offset = sg_append_buffer(buffer->handle, &(sg_range)
+    {
+        .ptr = data,
+        .size = count * buffer->element_size
+    });
+
+    buffer->count = count;
+    buffer->offset = offset;
+
+    buffer->ctx->stats.bytes_uploaded += count * buffer->element_size;
+
+    return offset;
+}
+
+int pg_get_buffer_offset(pg_buffer_t* buffer)
+{
+    PICO_GFX_ASSERT(buffer);
+    return buffer->offset;
+}
+
+void pg_set_buffer_offset(pg_buffer_t* buffer, int offset)
+{
+    PICO_GFX_ASSERT(buffer);
+    buffer->offset = offset;
+}
+
+void pg_reset_buffer(pg_buffer_t* buffer)
+{
+    PICO_GFX_ASSERT(buffer);
+
+    sg_destroy_buffer(buffer->handle);
+
+    buffer->handle = sg_make_buffer(&(sg_buffer_desc)
+    {
+        .type  = pg_map_buffer_type(buffer->type),
+        .usage = pg_map_usage(buffer->usage),
+        .data  = { .ptr = NULL, .size = 0 },
+        .size  = buffer->size
+    });
+
+    PICO_GFX_ASSERT(sg_query_buffer_state(buffer->handle) == SG_RESOURCESTATE_VALID);
+}
+
+pg_buffer_t* pg_create_stream_buffer(pg_ctx_t* ctx, size_t size)
+{
+    PICO_GFX_ASSERT(ctx);
+    PICO_GFX_ASSERT(size > 0);
+
+    return pg_create_vertex_buffer(ctx, PG_USAGE_STREAM, NULL, 0, size, 1);
+}
+
+int pg_alloc_stream_buffer(pg_buffer_t* buffer, const void* data, size_t size)
+{
+    PICO_GFX_ASSERT(buffer);
+    PICO_GFX_ASSERT(buffer->usage == PG_USAGE_STREAM);
+    PICO_GFX_ASSERT(buffer->element_size == 1);
+    PICO_GFX_ASSERT(data);
+    PICO_GFX_ASSERT(size > 0);
+
+    // sokol_gfx starts appending at the beginning of the buffer each frame
+    if (sg_query_buffer_will_overflow(buffer->handle, size))
+        return -1;
+
+    int offset = sg_append_buffer(buffer->handle, &(sg_range)
+    {
+        .ptr = data,
+        .size = size
+    });
+
+    buffer->count = size;
+    buffer->offset = offset;
+
+    buffer->ctx->stats.bytes_uploaded += size;
+
+    return offset;
+}
+
+void pg_destroy_buffer(pg_buffer_t* buffer)
+{
+    PICO_GFX_ASSERT(buffer);
+    sg_destroy_buffer(buffer->handle);
+    PICO_GFX_FREE(buffer, buffer->ctx->mem_ctx);
+}
+
+static void pg_apply_view_state(pg_ctx_t* ctx)
+{
+    pg_applied_state_t* applied = &ctx->applied;
+
+    const pg_rect_t* vp_rect = &ctx->state.viewport;
+
+    if (!applied->valid || !pg_rect_equal(&applied->viewport, vp_rect))
+    {
+        sg_apply_viewport(vp_rect->x, vp_rect->y, vp_rect->width, vp_rect->height, true);
+        applied->viewport = *vp_rect;
+    }
+
+    const pg_rect_t* s_rect = &ctx->state.scissor;
+
+    if (!applied->valid || !pg_rect_equal(&applied->scissor, s_rect))
+    {
+        sg_apply_scissor_rect(s_rect->x, s_rect->y, s_rect->width, s_rect->height, true);
+        applied->scissor = *s_rect;
+    }
+}
+
+static void pg_apply_textures(const pg_shader_t* shader, sg_bindings* bindings)
+{
+    for (int i = 0; i < PG_MAX_TEXTURE_SLOTS; i++)
+    {
+        if (!shader->textures[i])
+            continue;
+
+        bindings->fs.images[i] = shader->textures[i]->handle;
+    }
+}
+
+static void pg_apply_samplers(const pg_shader_t* shader, sg_bindings* bindings)
+{
+    for (int i = 0; i < PG_MAX_SAMPLER_SLOTS; i++)
+    {
+        if (!shader->samplers[i])
+            continue;
+
+        bindings->fs.samplers[i] = shader->samplers[i]->handle;
+    }
+}
+
+static void pg_apply_buffers(const pg_ctx_t* ctx, sg_bindings* bindings)
+{
+    pg_buffer_t* const* buffers = ctx->state.buffers;
+    const int* offsets = ctx->state.buffer_offsets;
+
+    for (int slot = 0; slot < PG_MAX_VERTEX_BUFFERS && buffers[slot] != NULL; slot++)
+    {
+        bindings->vertex_buffer_offsets[slot] = (offsets[slot] >= 0)
+                                              ? offsets[slot]
+                                              : (int)buffers[slot]->offset;
+        bindings->vertex_buffers[slot] = buffers[slot]->handle;
+    }
+}
+
+void pg_draw(pg_ctx_t* ctx, size_t start, size_t count, size_t instances)
+{
+    PICO_GFX_ASSERT(ctx);
+    PICO_GFX_ASSERT(ctx->pass_active);
+
+    // Preserve draw order
+    if (ctx->batch)
+        pg_flush_batch(ctx->batch);
+
+    sg_bindings bindings = { 0 };
+
+    pg_pipeline_t* pipeline = ctx->state.pipeline;
+
+    pg_apply_textures(pipeline->shader, &bindings);
+    pg_apply_samplers(pipeline->shader, &bindings);
+
+    pg_apply_buffers(ctx, &bindings);
+
+    if (ctx->state.index_buffer)
+    {
+        bindings.index_buffer_offset = ctx->state.index_buffer->offset;
+        bindings.index_buffer = ctx->state.index_buffer->handle;
+    }
+
+    pg_applied_state_t* applied = &ctx->applied;
+
+    // Applying a pipeline invalidates the bindings and uniforms
+    bool pipeline_changed = !applied->valid ||
+                            applied->pipeline.id != pipeline->handle.id;
+
+    if (pipeline_changed)
+    {
+        sg_apply_pipeline(pipeline->handle);
+        applied->pipeline = pipeline->handle;
+        ctx->stats.pipeline_switches++;
+    }
+
+    if (!applied->valid || memcmp(&applied->bindings.fs.images, &bindings.fs.images,
+                                  sizeof(bindings.fs.images)) != 0)
+    {
+        ctx->stats.texture_switches++;
+    }
+
+    if (pipeline_changed || memcmp(&applied->bindings, &bindings, sizeof(sg_bindings)) != 0)
+    {
+        sg_apply_bindings(&bindings);
+        applied->bindings = bindings;
+
+        for (int i = 0; i < PG_MAX_TEXTURE_SLOTS; i++)
+        {
+            if (bindings.fs.images[i].id != SG_INVALID_ID)
+                ctx->stats.texture_binds++;
+        }
+    }
+
+    pg_apply_uniforms(pipeline->shader, pipeline_changed);
+    pg_apply_view_state(ctx);
+
+    applied->valid = true;
+
+    sg_draw(start, count, instances);
+
+    ctx->stats.draws++;
+}
+
+pg_batch_t* pg_create_batch(pg_ctx_t* ctx, size_t max_vertices, size_t vertex_size)
+{
+    PICO_GFX_ASSERT(ctx);
+    PICO_GFX_ASSERT(max_vertices > 0);
+    PICO_GFX_ASSERT(vertex_size > 0);
+
+    pg_batch_t* batch = PICO_GFX_MALLOC(sizeof(pg_batch_t), ctx->mem_ctx);
+
+    memset(batch, 0, sizeof(pg_batch_t));
+
+    batch->ctx = ctx;
+    batch->capacity = max_vertices;
+    batch->element_size = vertex_size;
+    batch->count = 0;
+    batch->data = PICO_GFX_MALLOC(max_vertices * vertex_size, ctx->mem_ctx);
+
+    batch->buffer = pg_create_vertex_buffer(ctx, PG_USAGE_STREAM, NULL, 0,
+                                            max_vertices, vertex_size);
+
+    return batch;
+}
+
+void pg_destroy_batch(pg_batch_t* batch)
+{
+    PICO_GFX_ASSERT(batch);
+
+    pg_ctx_t* ctx = batch->ctx;
+
+    if (ctx->batch == batch)
+        ctx->batch = NULL;
+
+    pg_destroy_buffer(batch->buffer);
+    PICO_GFX_FREE(batch->data, ctx->mem_ctx);
+    PICO_GFX_FREE(batch, ctx->mem_ctx);
+}
+
+pg_batch_t* pg_create_instanced_batch(pg_ctx_t* ctx,
+                                      pg_buffer_t* vertices,
+                                      size_t vertex_count,
+                                      size_t max_instances,
+                                      size_t instance_size)
+{
+    PICO_GFX_ASSERT(vertices);
+    PICO_GFX_ASSERT(vertices->type == PG_BUFFER_TYPE_VERTEX);
+    PICO_GFX_ASSERT(vertex_count > 0);
+
+    pg_batch_t* batch = pg_create_batch(ctx, max_instances, instance_size);
+
+    batch->instanced = true;
+    batch->vertex_buffer = vertices;
+    batch->vertex_count = vertex_count;
+
+    return batch;
+}
+
+// Returns true if vertices can be added to the pending geometry without
+// changing how it is drawn
+static bool pg_batch_compatible(const pg_batch_t* batch)
+{
+    const pg_state_t* state = &batch->ctx->state;
+
+    return batch->state.pipeline == state->pipeline &&
+           pg_rect_equal(&batch->state.viewport, &state->viewport) &&
+           pg_rect_equal(&batch->state.scissor, &state->scissor);
+}
+
+// Makes room for the specified number of vertices in the pending geometry,
+// drawing it first if necessary, and returns a pointer to the reserved space
+static char* pg_batch_reserve(pg_batch_t* batch, size_t count)
+{
+    PICO_GFX_ASSERT(count <= batch->capacity);
+
+    pg_ctx_t* ctx = batch->ctx;
+
+    PICO_GFX_ASSERT(ctx->pass_active);
+    PICO_GFX_ASSERT(ctx->state.pipeline);
+    PICO_GFX_ASSERT(!ctx->state.pipeline->indexed);
+
+    if (ctx->batch && ctx->batch != batch)
+        pg_flush_batch(ctx->batch);
+
+    if (batch->count > 0 && !pg_batch_compatible(batch))
+        pg_flush_batch(batch);
+
+    if (batch->count + count > batch->capacity)
+        pg_flush_batch(batch);
+
+    if (batch->count == 0)
+    {
+        batch->state = ctx->state;
+        ctx->batch = batch;
+    }
+
+    char* dst = batch->data + batch->count * batch->element_size;
+
+    batch->count += count;
+
+    return dst;
+}
+
+void pg_batch_vertices(pg_batch_t* batch, const void* vertices, size_t count)
+{
+    PICO_GFX_ASSERT(batch);
+    PICO_GFX_ASSERT(!batch->instanced);
+    PICO_GFX_ASSERT(vertices);
+    PICO_GFX_ASSERT(count % 3 == 0);
+
+    char* dst = pg_batch_reserve(batch, count);
+
+    memcpy(dst, vertices, count * batch->element_size);
+}
+
+void pg_batch_quad(pg_batch_t* batch, const void* vertices)
+{
+    PICO_GFX_ASSERT(batch);
+    PICO_GFX_ASSERT(!batch->instanced);
+    PICO_GFX_ASSERT(vertices);
+
+    static const int order[6] = { 0, 1, 2, 0, 2, 3 };
+
+    const char* src = vertices;
+    size_t size = batch->element_size;
+
+    char* dst = pg_batch_reserve(batch, 6);
+
+    for (int i = 0; i < 6; i++)
+    {
+        memcpy(dst + i * size, src + order[i] * size, size);
+    }
+}
+
+void* pg_batch_alloc_instances(pg_batch_t* batch, size_t count, size_t instance_size)
+{
+    PICO_GFX_ASSERT(batch);
+    PICO_GFX_ASSERT(batch->instanced);
+    PICO_GFX_ASSERT(instance_size == batch->element_size);
+    PICO_GFX_ASSERT(count > 0);
 
-    pg_sampler_t* sampler = PICO_GFX_MALLOC(sizeof(pg_sampler_t), ctx->mem_ctx);
+    (void)instance_size;
 
-    sg_sampler_desc desc = { 0 };
+    return pg_batch_reserve(batch, count);
+}
 
-    desc.min_filter = (opts->smooth) ? SG_FILTER_LINEAR : SG_FILTER_NEAREST;
-    desc.mag_filter = (opts->smooth) ? SG_FILTER_LINEAR : SG_FILTER_NEAREST;
+pg_cmdbuf_t* pg_create_cmdbuf(pg_ctx_t* ctx, size_t size)
+{
+    PICO_GFX_ASSERT(ctx);
+    PICO_GFX_ASSERT(size > 0);
 
-    desc.wrap_u = (opts->repeat_u) ? SG_WRAP_REPEAT : SG_WRAP_CLAMP_TO_EDGE;
-    desc.wrap_v = (opts->repeat_v) ? SG_WRAP_REPEAT : SG_WRAP_CLAMP_TO_EDGE;
+    pg_cmdbuf_t* cmdbuf = PICO_GFX_MALLOC(sizeof(pg_cmdbuf_t), ctx->mem_ctx);
 
-    sampler->ctx = ctx;
-    sampler->handle = sg_make_sampler(&desc);
+    cmdbuf->ctx = ctx;
+    cmdbuf->arena = pg_arena_new(size, ctx->mem_ctx);
+    cmdbuf->head = NULL;
+    cmdbuf->tail = NULL;
+    cmdbuf->group_count = 0;
 
-    return sampler;
+    return cmdbuf;
 }
 
-void pg_destroy_sampler(pg_sampler_t* sampler)
+void pg_destroy_cmdbuf(pg_cmdbuf_t* cmdbuf)
 {
-    sg_destroy_sampler(sampler->handle);
-    PICO_GFX_FREE(sampler, sampler->ctx->mem_ctx);
+    PICO_GFX_ASSERT(cmdbuf);
+    pg_arena_free(cmdbuf->arena);
+    PICO_GFX_FREE(cmdbuf, cmdbuf->ctx->mem_ctx);
 }
 
-static void pg_apply_uniforms(pg_shader_t* shader)
+void pg_reset_cmdbuf(pg_cmdbuf_t* cmdbuf)
 {
-    PICO_GFX_ASSERT(shader);
+    PICO_GFX_ASSERT(cmdbuf);
+    pg_arena_reset(cmdbuf->arena);
+    cmdbuf->head = NULL;
+    cmdbuf->tail = NULL;
+    cmdbuf->group_count = 0;
+}
 
-    pg_hashtable_iterator_t iterator;
-    pg_hashtable_init_iterator(shader->uniform_blocks, &iterator);
+static pg_cmd_t* pg_cmdbuf_push(pg_cmdbuf_t* cmdbuf, pg_cmd_type_t type)
+{
+    PICO_GFX_ASSERT(cmdbuf);
 
-    char* key = NULL;
-    void* value = NULL;
+    pg_cmd_t* cmd = pg_arena_alloc(cmdbuf->arena, sizeof(pg_cmd_t));
 
-    while (pg_hashtable_iterator_next(&iterator, &key, &value))
-    {
-        pg_uniform_block_t* block = (pg_uniform_block_t*)value;
+    cmd->next = NULL;
+    cmd->type = type;
 
-        sg_range range = { .ptr = block->data, .size = block->size };
+    if (cmdbuf->tail)
+        cmdbuf->tail->next = cmd;
+    else
+        cmdbuf->head = cmd;
 
-        sg_shader_stage stage = pg_map_stage(block->stage);
+    cmdbuf->tail = cmd;
 
-        sg_apply_uniforms(stage, block->slot, &range);
-    }
+    return cmd;
 }
 
-pg_buffer_t* pg_create_vertex_buffer(pg_ctx_t* ctx,
-                                     pg_buffer_usage_t usage,
-                                     const void* data,
-                                     size_t count,
-                                     size_t max_elements,
-                                     size_t element_size)
+void pg_cmdbuf_set_pipeline(pg_cmdbuf_t* cmdbuf, pg_pipeline_t* pipeline)
 {
-    PICO_GFX_ASSERT(ctx);
+    pg_cmd_t* cmd = pg_cmdbuf_push(cmdbuf, PG_CMD_SET_PIPELINE);
+    cmd->u.pipeline = pipeline;
+}
 
-    pg_buffer_t* buffer = PICO_GFX_MALLOC(sizeof(pg_buffer_t), ctx->mem_ctx);
+void pg_cmdbuf_set_viewport(pg_cmdbuf_t* cmdbuf, int x, int y, int w, int h)
+{
+    pg_cmd_t* cmd = pg_cmdbuf_push(cmdbuf, PG_CMD_SET_VIEWPORT);
+    cmd->u.rect = (pg_rect_t){ x, y, w, h };
+}
 
-    buffer->ctx = ctx;
-    buffer->type = PG_BUFFER_TYPE_VERTEX;
-    buffer->usage = usage;
-    buffer->count = count;
-    buffer->element_size = element_size;
-    buffer->size = max_elements * element_size;
-    buffer->offset = 0;
+void pg_cmdbuf_set_scissor(pg_cmdbuf_t* cmdbuf, int x, int y, int w, int h)
+{
+    pg_cmd_t* cmd = pg_cmdbuf_push(cmdbuf, PG_CMD_SET_SCISSOR);
+    cmd->u.rect = (pg_rect_t){ x, y, w, h };
+}
 
-    buffer->handle = sg_make_buffer(&(sg_buffer_desc)
-    {
-        .type  = SG_BUFFERTYPE_VERTEXBUFFER,
-        .usage = pg_map_usage(usage),
-        .data  = { .ptr = data, .size = count * element_size },
-        .size  = buffer->size
-    });
+void pg_cmdbuf_bind_buffer(pg_cmdbuf_t* cmdbuf, int slot, pg_buffer_t* buffer)
+{
+    PICO_GFX_ASSERT(!buffer || buffer->type == PG_BUFFER_TYPE_VERTEX);
+    PICO_GFX_ASSERT(slot >= 0);
+    PICO_GFX_ASSERT(slot < PG_MAX_VERTEX_BUFFERS);
 
-    PICO_GFX_ASSERT(sg_query_buffer_state(buffer->handle) == SG_RESOURCESTATE_VALID);
+    pg_cmd_t* cmd = pg_cmdbuf_push(cmdbuf, PG_CMD_BIND_BUFFER);
+    cmd->u.buffer.slot = slot;
+    cmd->u.buffer.buffer = buffer;
+    cmd->u.buffer.offset = -1;
+}
 
-    return buffer;
+void pg_cmdbuf_bind_buffer_offset(pg_cmdbuf_t* cmdbuf,
+                                  int slot,
+                                  pg_buffer_t* buffer,
+                                  int offset)
+{
+    PICO_GFX_ASSERT(offset >= 0);
+
+    pg_cmdbuf_bind_buffer(cmdbuf, slot, buffer);
+    cmdbuf->tail->u.buffer.offset = offset;
 }
 
-pg_buffer_t* pg_create_index_buffer(pg_ctx_t* ctx,
-                                    pg_buffer_usage_t usage,
-                                    const void* data,
-                                    size_t count,
-                                    size_t max_elements)
+void pg_cmdbuf_set_index_buffer(pg_cmdbuf_t* cmdbuf, pg_buffer_t* buffer)
 {
-    PICO_GFX_ASSERT(ctx);
+    PICO_GFX_ASSERT(!buffer || buffer->type == PG_BUFFER_TYPE_INDEX);
 
-    pg_buffer_t* buffer = PICO_GFX_MALLOC(sizeof(pg_buffer_t), ctx->mem_ctx);
+    pg_cmd_t* cmd = pg_cmdbuf_push(cmdbuf, PG_CMD_SET_INDEX_BUFFER);
+    cmd->u.buffer.slot = 0;
+    cmd->u.buffer.buffer = buffer;
+    cmd->u.buffer.offset = -1;
+}
 
-    buffer->ctx = ctx;
-    buffer->type = PG_BUFFER_TYPE_INDEX;
-    buffer->usage = usage;
-    buffer->count = count;
-    buffer->size = max_elements * sizeof(uint32_t);
-    buffer->offset = 0;
+void pg_cmdbuf_bind_texture(pg_cmdbuf_t* cmdbuf,
+                            pg_shader_t* shader,
+                            int handle,
+                            pg_texture_t* texture)
+{
+    PICO_GFX_ASSERT(shader);
+    PICO_GFX_ASSERT(handle >= 0);
+    PICO_GFX_ASSERT(handle < PG_MAX_TEXTURE_SLOTS);
 
-    buffer->handle = sg_make_buffer(&(sg_buffer_desc)
-    {
-        .type  = SG_BUFFERTYPE_INDEXBUFFER,
-        .usage = pg_map_usage(usage),
-        .data  = { .ptr = data, .size = count * sizeof(uint32_t) },
-        .size  = buffer->size
-    });
+    pg_cmd_t* cmd = pg_cmdbuf_push(cmdbuf, PG_CMD_BIND_TEXTURE);
+    cmd->u.texture.shader = shader;
+    cmd->u.texture.handle = handle;
+    cmd->u.texture.texture = texture;
+}
 
-    PICO_GFX_ASSERT(sg_query_buffer_state(buffer->handle) == SG_RESOURCESTATE_VALID);
+void pg_cmdbuf_bind_sampler(pg_cmdbuf_t* cmdbuf,
+                            pg_shader_t* shader,
+                            int handle,
+                            pg_sampler_t* sampler)
+{
+    PICO_GFX_ASSERT(shader);
+    PICO_GFX_ASSERT(handle >= 0);
+    PICO_GFX_ASSERT(handle < PG_MAX_SAMPLER_SLOTS);
 
-    return buffer;
+    pg_cmd_t* cmd = pg_cmdbuf_push(cmdbuf, PG_CMD_BIND_SAMPLER);
+    cmd->u.sampler.shader = shader;
+    cmd->u.sampler.handle = handle;
+    cmd->u.sampler.sampler = sampler;
 }
 
-void pg_update_buffer(pg_buffer_t* buffer, void* data, size_t count)
+void pg_cmdbuf_set_uniform_block(pg_cmdbuf_t* cmdbuf,
+                                 pg_shader_t* shader,
+                                 int handle,
+                                 const void* data)
 {
-    PICO_GFX_ASSERT(buffer);
+    PICO_GFX_ASSERT(shader);
+    PICO_GFX_ASSERT(handle >= 0);
+    PICO_GFX_ASSERT(handle < shader->uniform_block_count);
     PICO_GFX_ASSERT(data);
-    PICO_GFX_ASSERT(count > 0);
 
-    sg_update_buffer(buffer->handle, &(sg_range)
-    {
-        .ptr = data,
-        .size = count * buffer->element_size
-    });
+    size_t size = shader->uniform_blocks[handle].size;
 
-    buffer->count = count;
-    buffer->offset = 0;
+    pg_cmd_t* cmd = pg_cmdbuf_push(cmdbuf, PG_CMD_SET_UNIFORM_BLOCK);
+    cmd->u.uniforms.shader = shader;
+    cmd->u.uniforms.handle = handle;
+    cmd->u.uniforms.data = pg_arena_alloc(cmdbuf->arena, size);
+
+    memcpy(cmd->u.uniforms.data, data, size);
 }
 
-int pg_append_buffer(pg_buffer_t* buffer, void* data, size_t count)
+void pg_cmdbuf_append_buffer(pg_cmdbuf_t* cmdbuf,
+                             pg_buffer_t* buffer,
+                             const void* data,
+                             size_t count)
 {
     PICO_GFX_ASSERT(buffer);
     PICO_GFX_ASSERT(data);
     PICO_GFX_ASSERT(count > 0);
 
-    int offset = sg_append_buffer(buffer->handle, &(sg_range)
-    {
-        .ptr = data,
-        .size = count * buffer->element_size
-    });
+    size_t size = count * buffer->element_size;
 
-    buffer->count = count;
-    buffer->offset = offset;
+    pg_cmd_t* cmd = pg_cmdbuf_push(cmdbuf, PG_CMD_APPEND_BUFFER);
+    cmd->u.append.buffer = buffer;
+    cmd->u.append.data = pg_arena_alloc(cmdbuf->arena, size);
+    cmd->u.append.count = count;
 
-    return offset;
+    memcpy(cmd->u.append.data, data, size);
 }
 
-int pg_get_buffer_offset(pg_buffer_t* buffer)
+void pg_cmdbuf_draw(pg_cmdbuf_t* cmdbuf, size_t start, size_t count, size_t instances)
 {
-    PICO_GFX_ASSERT(buffer);
-    return buffer->offset;
+    pg_cmd_t* cmd = pg_cmdbuf_push(cmdbuf, PG_CMD_DRAW);
+    cmd->u.draw.start = start;
+    cmd->u.draw.count = count;
+    cmd->u.draw.instances = instances;
 }
 
-void pg_set_buffer_offset(pg_buffer_t* buffer, int offset)
+void pg_cmdbuf_set_sort_key(pg_cmdbuf_t* cmdbuf, uint64_t key)
 {
-    PICO_GFX_ASSERT(buffer);
-    buffer->offset = offset;
+    pg_cmd_t* cmd = pg_cmdbuf_push(cmdbuf, PG_CMD_SORT_KEY);
+    cmd->u.key = key;
+    cmdbuf->group_count++;
 }
 
-void pg_reset_buffer(pg_buffer_t* buffer)
+static int pg_compare_cmd_groups(const void* a, const void* b)
 {
-    PICO_GFX_ASSERT(buffer);
-
-    sg_destroy_buffer(buffer->handle);
+    const pg_cmd_group_t* g1 = a;
+    const pg_cmd_group_t* g2 = b;
 
-    buffer->handle = sg_make_buffer(&(sg_buffer_desc)
-    {
-        .type  = pg_map_buffer_type(buffer->type),
-        .usage = pg_map_usage(buffer->usage),
-        .data  = { .ptr = NULL, .size = 0 },
-        .size  = buffer->size
-    });
+    if (g1->key != g2->key)
+        return (g1->key < g2->key) ? -1 : 1;
 
-    PICO_GFX_ASSERT(sg_query_buffer_state(buffer->handle) == SG_RESOURCESTATE_VALID);
+    // Recording order breaks ties, which makes the sort stable
+    return (g1->seq < g2->seq) ? -1 : (g1->seq > g2->seq);
 }
 
-void pg_destroy_buffer(pg_buffer_t* buffer)
+void pg_sort_cmdbuf(pg_cmdbuf_t* cmdbuf)
 {
-    PICO_GFX_ASSERT(buffer);
-    sg_destroy_buffer(buffer->handle);
-    PICO_GFX_FREE(buffer, buffer->ctx->mem_ctx);
-}
+    PICO_GFX_ASSERT(cmdbuf);
 
-static void pg_apply_view_state(const pg_ctx_t* ctx)
-{
-    const pg_rect_t* vp_rect = &ctx->state.viewport;
-    sg_apply_viewport(vp_rect->x, vp_rect->y, vp_rect->width, vp_rect->height, true);
+    if (!cmdbuf->head || cmdbuf->group_count == 0)
+        return;
 
-    const pg_rect_t* s_rect = &ctx->state.scissor;
-    sg_apply_scissor_rect(s_rect->x, s_rect->y, s_rect->width, s_rect->height, true);
-}
+    // One extra group for commands recorded before the first key
+    pg_cmd_group_t* groups = PICO_GFX_MALLOC((cmdbuf->group_count + 1) * sizeof(pg_cmd_group_t),
+                                             cmdbuf->ctx->mem_ctx);
 
-static void pg_apply_textures(const pg_shader_t* shader, sg_bindings* bindings)
-{
-    for (int i = 0; i < PG_MAX_TEXTURE_SLOTS; i++)
+    size_t count = 0;
+
+    for (pg_cmd_t* cmd = cmdbuf->head; cmd != NULL; cmd = cmd->next)
     {
-        if (!shader->textures[i])
-            continue;
+        if (cmd->type == PG_CMD_SORT_KEY || count == 0)
+        {
+            groups[count] = (pg_cmd_group_t)
+            {
+                .key  = (cmd->type == PG_CMD_SORT_KEY) ? cmd->u.key : 0,
+                .seq  = count,
+                .head = cmd,
+            };
 
-        bindings->fs.images[i] = shader->textures[i]->handle;
+            count++;
+        }
+
+        groups[count - 1].tail = cmd;
     }
+
+    PICO_GFX_ASSERT(count <= cmdbuf->group_count + 1);
+
+    qsort(groups, count, sizeof(pg_cmd_group_t), pg_compare_cmd_groups);
+
+    for (size_t i = 0; i + 1 < count; i++)
+    {
+        groups[i].tail->next = groups[i + 1].head;
+    }
+
+    groups[count - 1].tail->next = NULL;
+
+    cmdbuf->head = groups[0].head;
+    cmdbuf->tail = groups[count - 1].tail;
+
+    PICO_GFX_FREE(groups, cmdbuf->ctx->mem_ctx);
 }
 
-static void pg_apply_samplers(const pg_shader_t* shader, sg_bindings* bindings)
+uint64_t pg_make_sort_key(uint8_t layer,
+                          const pg_pipeline_t* pipeline,
+                          const pg_texture_t* texture,
+                          float depth)
 {
-    for (int i = 0; i < PG_MAX_SAMPLER_SLOTS; i++)
+    // The low 16 bits of a sokol handle are its pool slot, which is unique
+    // among live resources
+    uint64_t pipeline_bits = (pipeline) ? (pipeline->handle.id & 0xFFFF) : 0;
+    uint64_t texture_bits  = (texture)  ? (texture->handle.id  & 0xFFFF) : 0;
+
+    if (depth < 0.0f) depth = 0.0f;
+    if (depth > 1.0f) depth = 1.0f;
+
+    uint64_t depth_bits = (uint64_t)(depth * (float)0xFFFFFF);
+
+    return ((uint64_t)layer << 56) |
+           (pipeline_bits  << 40) |
+           (texture_bits   << 24) |
+           depth_bits;
+}
+
+static void pg_execute_cmd(pg_ctx_t* ctx, const pg_cmd_t* cmd)
+{
+    switch (cmd->type)
     {
-        if (!shader->samplers[i])
-            continue;
+        case PG_CMD_SET_PIPELINE:
+            pg_set_pipeline(ctx, cmd->u.pipeline);
+            break;
 
-        bindings->fs.samplers[i] = shader->samplers[i]->handle;
+        case PG_CMD_SET_VIEWPORT:
+            ctx->state.viewport = cmd->u.rect;
+            break;
+
+        case PG_CMD_SET_SCISSOR:
+            ctx->state.scissor = cmd->u.rect;
+            break;
+
+        case PG_CMD_BIND_BUFFER:
+            pg_bind_buffer(ctx, cmd->u.buffer.slot, cmd->u.buffer.buffer);
+            ctx->state.buffer_offsets[cmd->u.buffer.slot] = cmd->u.buffer.offset;
+            break;
+
+        case PG_CMD_SET_INDEX_BUFFER:
+            pg_set_index_buffer(ctx, cmd->u.buffer.buffer);
+            break;
+
+        case PG_CMD_BIND_TEXTURE:
+            pg_bind_texture_by_handle(cmd->u.texture.shader,
+                                      cmd->u.texture.handle,
+                                      cmd->u.texture.texture);
+            break;
+
+        case PG_CMD_BIND_SAMPLER:
+            pg_bind_sampler_by_handle(cmd->u.sampler.shader,
+                                      cmd->u.sampler.handle,
+                                      cmd->u.sampler.sampler);
+            break;
+
+        case PG_CMD_SET_UNIFORM_BLOCK:
+            pg_set_uniform_block_by_handle(cmd->u.uniforms.shader,
+                                           cmd->u.uniforms.handle,
+                                           cmd->u.uniforms.data);
+            break;
+
+        case PG_CMD_APPEND_BUFFER:
+            pg_append_buffer(cmd->u.append.buffer, cmd->u.append.data, cmd->u.append.count);
+            break;
+
+        case PG_CMD_DRAW:
+            pg_draw(ctx, cmd->u.draw.start, cmd->u.draw.count, cmd->u.draw.instances);
+            break;
+
+        case PG_CMD_SORT_KEY:
+            break;
+
+        default:
+            PICO_GFX_ASSERT(false);
+            break;
     }
 }
 
-static void pg_apply_buffers(const pg_ctx_t* ctx, sg_bindings* bindings)
+void pg_submit_cmdbuf(pg_ctx_t* ctx, const pg_cmdbuf_t* cmdbuf)
 {
-    pg_buffer_t* const* buffers = ctx->state.buffers;
+    PICO_GFX_ASSERT(ctx);
+    PICO_GFX_ASSERT(cmdbuf);
+    PICO_GFX_ASSERT(ctx->pass_active);
+
+    pg_state_t state = ctx->state;
 
-    for (int slot = 0; buffers[slot] != NULL; slot++)
+    for (const pg_cmd_t* cmd = cmdbuf->head; cmd != NULL; cmd = cmd->next)
     {
-        bindings->vertex_buffer_offsets[slot] = buffers[slot]->offset;
-        bindings->vertex_buffers[slot] = buffers[slot]->handle;
+        pg_execute_cmd(ctx, cmd);
     }
+
+    ctx->state = state;
 }
 
-void pg_draw(const pg_ctx_t* ctx, size_t start, size_t count, size_t instances)
+void pg_flush_batch(pg_batch_t* batch)
 {
-    PICO_GFX_ASSERT(ctx);
+    PICO_GFX_ASSERT(batch);
+
+    if (batch->count == 0)
+        return;
+
+    pg_ctx_t* ctx = batch->ctx;
+    pg_buffer_t* buffer = batch->buffer;
+
     PICO_GFX_ASSERT(ctx->pass_active);
+    PICO_GFX_ASSERT(!sg_query_buffer_will_overflow(buffer->handle,
+                                                   batch->count * batch->element_size));
 
-    sg_bindings bindings = { 0 };
+    size_t count = batch->count;
 
-    pg_pipeline_t* pipeline = ctx->state.pipeline;
+    batch->count = 0;
+    ctx->batch = NULL;
 
-    pg_apply_textures(pipeline->shader, &bindings);
-    pg_apply_samplers(pipeline->shader, &bindings);
+    pg_append_buffer(buffer, batch->data, count);
 
-    pg_apply_buffers(ctx, &bindings);
-    pg_apply_view_state(ctx);
+    // Draw with the state captured when the geometry was added
+    pg_state_t state = ctx->state;
 
-    if (ctx->state.index_buffer)
+    ctx->state = batch->state;
+    ctx->state.index_buffer = NULL;
+
+    pg_reset_buffers(ctx);
+
+    if (batch->instanced)
     {
-        bindings.index_buffer_offset = ctx->state.index_buffer->offset;
-        bindings.index_buffer = ctx->state.index_buffer->handle;
+        pg_bind_buffer(ctx, 0, batch->vertex_buffer);
+        pg_bind_buffer(ctx, 1, buffer);
+        pg_draw(ctx, 0, batch->vertex_count, count);
+    }
+    else
+    {
+        pg_bind_buffer(ctx, 0, buffer);
+        pg_draw(ctx, 0, count, 1);
     }
 
-    sg_apply_pipeline(pipeline->handle);
-    sg_apply_bindings(&bindings);
-    pg_apply_uniforms(pipeline->shader);
-
-    sg_draw(start, count, instances);
+    ctx->state = state;
 }
 
 /*==============================================================================
@@ -2302,7 +4094,7 @@ static void pg_hashtable_rehash(pg_hashtable_t* ht)
 {
     pg_hashtable_t* new_ht = pg_hashtable_new(ht->capacity * 2,
                                               ht->key_size,
-                                              ht->size,
+                                              ht->value_size,
                                               ht->mem_ctx);
 
     pg_hashtable_iterator_t iterator;
@@ -2340,7 +4132,8 @@ static size_t pg_hashtable_compute_hash(const pg_hashtable_t* ht, const char* ke
 
     pg_hash_t hash = offset_basis;
 
-    for (size_t i = 0; i < ht->key_size; i++) {
+    // Keys are strings, so hash up to the terminator like strncmp compares
+    for (size_t i = 0; i < ht->key_size && data[i] != '\0'; i++) {
         hash ^= (pg_hash_t)data[i];
         hash *= prime;
     }
@@ -2356,14 +4149,43 @@ static size_t pg_hashtable_compute_hash(const pg_hashtable_t* ht, const char* ke
  * Arena Allocator
  *============================================================================*/
 
+// Allocations are never moved, so the arena grows by chaining blocks
+typedef struct pg_arena_block_t
+{
+    struct pg_arena_block_t* next;
+    size_t capacity;
+    size_t size;
+} pg_arena_block_t;
+
 struct pg_arena_t
 {
     void*  mem_ctx;
     size_t capacity;
-    size_t size;
-    void*  block;
+    pg_arena_block_t* blocks;
 };
 
+#define PG_ARENA_ALIGNMENT 16
+
+static size_t pg_arena_align(size_t size)
+{
+    return (size + PG_ARENA_ALIGNMENT - 1) & ~(size_t)(PG_ARENA_ALIGNMENT - 1);
+}
+
+static pg_arena_block_t* pg_arena_new_block(pg_arena_t* arena, size_t capacity)
+{
+    size_t header_size = pg_arena_align(sizeof(pg_arena_block_t));
+
+    pg_arena_block_t* block = PICO_GFX_MALLOC(header_size + capacity, arena->mem_ctx);
+
+    block->next = arena->blocks;
+    block->capacity = capacity;
+    block->size = 0;
+
+    arena->blocks = block;
+
+    return block;
+}
+
 static pg_arena_t* pg_arena_new(size_t size, void* mem_ctx)
 {
     PICO_GFX_ASSERT(size > 0);
@@ -2373,35 +4195,72 @@ static pg_arena_t* pg_arena_new(size_t size, void* mem_ctx)
     memset(arena, 0, sizeof(pg_arena_t));
 
     arena->mem_ctx = mem_ctx;
-    arena->capacity = size * 2;
-    arena->block = PICO_GFX_MALLOC(arena->capacity, mem_ctx);
-    arena->size = size;
+    arena->capacity = pg_arena_align(size);
+
+    pg_arena_new_block(arena, arena->capacity);
 
     return arena;
 }
 
 static void* pg_arena_alloc(pg_arena_t* arena, size_t size)
 {
-    if (arena->size + size > arena->capacity)
+    size = pg_arena_align(size);
+
+    pg_arena_block_t* block = arena->blocks;
+
+    if (block->size + size > block->capacity)
     {
-        while (arena->size + size >= arena->capacity)
+        // Each new block is at least as large as the arena so far
+        size_t capacity = arena->capacity;
+
+        while (capacity < size)
         {
-            arena->capacity *= 2;
+            capacity *= 2;
         }
 
-        arena->block = PICO_GFX_REALLOC(arena->block, arena->capacity, arena->mem_ctx);
+        block = pg_arena_new_block(arena, capacity);
+        arena->capacity += capacity;
     }
 
-    void* mem = (char*)arena->block + arena->size;
+    void* mem = (char*)block + pg_arena_align(sizeof(pg_arena_block_t)) + block->size;
 
-    arena->size += size;
+    block->size += size;
 
     return mem;
 }
 
+static void pg_arena_reset(pg_arena_t* arena)
+{
+    pg_arena_block_t* block = arena->blocks;
+
+    // Coalesce into a single block so that steady state usage never allocates
+    if (block->next)
+    {
+        while (block)
+        {
+            pg_arena_block_t* next = block->next;
+            PICO_GFX_FREE(block, arena->mem_ctx);
+            block = next;
+        }
+
+        arena->blocks = NULL;
+        pg_arena_new_block(arena, arena->capacity);
+    }
+
+    arena->blocks->size = 0;
+}
+
 static void pg_arena_free(pg_arena_t* arena)
 {
-    PICO_GFX_FREE(arena->block, arena->mem_ctx);
+    pg_arena_block_t* block = arena->blocks;
+
+    while (block)
+    {
+        pg_arena_block_t* next = block->next;
+        PICO_GFX_FREE(block, arena->mem_ctx);
+        block = next;
+    }
+
     PICO_GFX_FREE(arena, arena->mem_ctx);
 }
 
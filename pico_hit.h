@@ -13,6 +13,12 @@
     - Tests overlaps for AABBs, polygons, and circles using SAT
     - Provides collision information including the normal and amount of overlap
     - Ray casts against line segments, polygons, and circles
+    - Batched tests over arrays of shape pairs (SIMD accelerated when available)
+    - Ray casts against arrays of shapes with AABB pre-rejection
+    - GJK/EPA polygon tests that can be warm-started across frames
+    - Time of impact queries for moving circles and polygons
+    - Feature IDs and a contact cache for persistent contacts
+    - Incremental broad phase based on a dynamic AABB tree
     - Permissive license (MIT)
 
     Summary:
@@ -39,6 +45,77 @@
     IMPORTANT: Polygons in this library use counter-clockwise (CCW) winding. See
     the `ph_aabb_to_poly` for an example.
 
+    Caching:
+    --------
+    A polygon that takes part in many tests per frame can be stored in a
+    `ph_poly_cache_t`. The cache holds the transformed polygon along with the
+    projection of the polygon onto each of its own normals, and is only
+    rebuilt when its transform changes. `ph_sat_poly_poly_cached` then skips
+    half of the projections performed by `ph_sat_poly_poly`.
+
+    Batches:
+    --------
+    The `*_batch` functions test many pairs of shapes at once. Each pair holds
+    two indices into a single array of shapes, which is the form in which a
+    broad phase typically reports candidates. Circle and AABB pairs are tested
+    four at a time using SSE or NEON in single precision. Define
+    PICO_HIT_NO_SIMD to always use the scalar code path.
+
+    Rays can be cast against arrays of shapes as well. Shapes whose AABBs the
+    ray misses, or which lie beyond the closest hit found so far, are rejected
+    four at a time using slab tests, before the exact tests are performed.
+
+    GJK:
+    ----
+    `ph_sat_poly_poly` projects both polygons onto every edge normal, which
+    costs O(n * m) for polygons with n and m vertices. `ph_gjk_poly_poly`
+    instead searches the Minkowski difference of the polygons for the origin
+    (GJK), and only runs EPA to find the normal and overlap if a manifold is
+    requested. Each iteration costs O(n + m), which pays off for polygons with
+    many vertices. `ph_gjk_distance` reports the distance between polygons
+    that do not overlap.
+
+    The final simplex can be stored in a `ph_simplex_t` and passed to the next
+    query on the same pair of polygons. While the polygons move little between
+    frames, the query then typically finishes in one or two iterations.
+
+    Time of impact:
+    ---------------
+    Fast shapes can pass through each other between two frames. The
+    `ph_toi_*` functions take the displacement of each shape over a frame and
+    find the fraction of the frame at which the shapes first touch. They use
+    conservative advancement: the distance between the shapes is found using
+    GJK, and the shapes are moved forward by as much as this distance allows.
+    Since the shapes only translate, the distance is a convex function of
+    time, and the search never steps past the time of impact. Rotation during
+    the frame is not taken into account.
+
+    Contacts:
+    ---------
+    Manifolds record the feature (the edge or vertex of either shape) that
+    produced the normal. When polygons do not overlap, the feature identifies
+    the separating axis that was found instead. Since shapes move little
+    between frames, `ph_sat_poly_poly_coherent` tests that axis first and
+    returns early if it still separates the polygons.
+
+    A `ph_contact_cache_t` stores a `ph_contact_t` for each pair of shapes,
+    keyed by the indices of the shapes. Along with the latest manifold, each
+    contact holds impulses for a solver to warm-start from. `ph_contact_poly_poly`
+    updates a contact and clears the impulses whenever the contact feature
+    changes. Contacts that are not accessed between two calls to
+    `ph_contact_cache_prune` are removed.
+
+    Broad phase:
+    ------------
+    A broad phase quickly finds the pairs of shapes that might collide, so
+    that only those pairs need to be passed to the SAT tests. This library
+    provides a dynamic AABB tree that persists across frames. Each shape is
+    stored with a "fat" AABB that is enlarged by a margin. Moving a shape
+    only updates the tree once it leaves its fat AABB, so shapes that are
+    static or move slowly cost next to nothing per frame.
+    `ph_broadphase_find_pairs` reports the pairs of fat AABBs that overlap,
+    which can be fed straight into the `*_batch` functions.
+
     Usage:
     ------
 
@@ -59,6 +136,16 @@
     > #include "pico_math.h"
 
     to the same or other source file (once).
+
+    Customization:
+    --------------
+    A few macros can be overridden simply by defining them before including this
+    source file. Here is a list of them.
+
+    PICO_HIT_ASSERT
+    PICO_HIT_MALLOC
+    PICO_HIT_REALLOC
+    PICO_HIT_FREE
 */
 
 #ifndef PICO_HIT_H
@@ -106,18 +193,89 @@ typedef struct
     pfloat dist; //!< The length of the ray
 } ph_ray_t;
 
+/**
+ * @brief The kind of feature that produced the normal of a manifold
+ */
+typedef enum
+{
+    PH_FEATURE_NONE,     //!< No feature (e.g. the normal of two circles)
+    PH_FEATURE_EDGE_A,   //!< An edge of shape 1
+    PH_FEATURE_EDGE_B,   //!< An edge of shape 2
+    PH_FEATURE_VERTEX_A, //!< A vertex of shape 1
+    PH_FEATURE_VERTEX_B  //!< A vertex of shape 2
+} ph_feature_t;
+
 /**
  * @brief A collision manifold
  * Provides information about a collision. Normals always point from shape 1 to
- * shape 2.
+ * shape 2. If polygons do not overlap, `feature` and `index` identify the
+ * separating axis that was found.
  */
 typedef struct
 {
-    pv2    normal;  //!< Normal to colliding edge (in direction of MTV)
-    pfloat overlap; //!< Amount of overlap between two shapes along colliding axis (MTD)
-    pv2    vector;  //!< Vector defined by `vector = normal * overlap`
+    pv2          normal;  //!< Normal to colliding edge (in direction of MTV)
+    pfloat       overlap; //!< Amount of overlap between two shapes along colliding axis (MTD)
+    pv2          vector;  //!< Vector defined by `vector = normal * overlap`
+    ph_feature_t feature; //!< The kind of feature that produced the normal
+    int          index;   //!< Index of the edge or vertex, or -1 if there is none
 } ph_manifold_t;
 
+/**
+ * @brief A pair of indices into an array of shapes
+ */
+typedef struct
+{
+    int a; //!< Index of the colliding shape
+    int b; //!< Index of the target shape
+} ph_pair_t;
+
+/**
+ * @brief A transformed polygon along with its projections onto its own normals
+ * Initialize with `ph_poly_cache_init` and update with `ph_poly_cache_update`
+ */
+typedef struct
+{
+    ph_poly_t poly;                               //!< The transformed polygon
+    pfloat    ranges[PICO_HIT_MAX_POLY_VERTS][2]; //!< Range of `poly` projected onto each of its normals
+    pt2       transform;                          //!< The transform used to build `poly`
+    bool      valid;                              //!< False if the cache needs to be rebuilt
+} ph_poly_cache_t;
+
+/**
+ * @brief A GJK simplex, which is kept between queries to warm-start them
+ * Initialize with `ph_simplex_init`
+ */
+typedef struct
+{
+    int count;      //!< Number of vertices, zero if the simplex is empty
+    int index_a[3]; //!< Vertex of the first polygon for each simplex vertex
+    int index_b[3]; //!< Vertex of the second polygon for each simplex vertex
+} ph_simplex_t;
+
+/**
+ * @brief Persistent contact information about a pair of shapes
+ */
+typedef struct
+{
+    int           a;               //!< Index of the colliding shape
+    int           b;               //!< Index of the target shape
+    ph_manifold_t manifold;        //!< The manifold of the latest test
+    bool          touching;        //!< True if the shapes overlapped in the latest test
+    pfloat        normal_impulse;  //!< Solver impulse along the normal, kept while the feature persists
+    pfloat        tangent_impulse; //!< Solver impulse along the tangent, kept while the feature persists
+    bool          used;            //!< True if the contact was accessed since the last prune
+} ph_contact_t;
+
+/**
+ * @brief A cache of contacts keyed by pairs of shapes
+ */
+typedef struct ph_contact_cache_t ph_contact_cache_t;
+
+/**
+ * @brief A broad phase that persists across frames
+ */
+typedef struct ph_broadphase_t ph_broadphase_t;
+
 /**
  *  @brief Raycast information
  */
@@ -127,6 +285,15 @@ typedef struct
     pfloat dist; //!< The distance fromt the origin to the point of impact
 } ph_raycast_t;
 
+/**
+ * @brief Time of impact information
+ */
+typedef struct
+{
+    pfloat time;   //!< The fraction of the displacements at which the shapes first touch
+    pv2    normal; //!< Normal at the point of impact, pointing from shape 1 to shape 2
+} ph_toi_t;
+
 /**
  * @brief Initializes a circle
  * @param pos    Circle center
@@ -201,6 +368,77 @@ bool ph_sat_circle_circle(const ph_circle_t* circle_a,
                           const ph_circle_t* circle_b,
                           ph_manifold_t* manifold);
 
+/**
+ * @brief Tests to see if two AABBs overlap
+ *
+ * For boxes with a non-zero size, this detects the same overlaps as calling
+ * `ph_sat_poly_poly` on the AABBs converted with `ph_aabb_to_poly`, but is much
+ * cheaper. The conversion recomputes the corners from the position and size,
+ * so boxes that barely touch may be classified differently due to rounding.
+ * For the same reason, the manifold normal may differ when the overlaps along
+ * both axes, or in both directions along an axis, are nearly equal.
+ *
+ * @param aabb_a   The colliding AABB
+ * @param aabb_b   The target AABB
+ * @param manifold The collision manifold to populate (or NULL)
+ * @returns True if the AABBs overlap and false otherwise
+ */
+bool ph_sat_aabb_aabb(const pb2* aabb_a,
+                      const pb2* aabb_b,
+                      ph_manifold_t* manifold);
+
+/**
+ * @brief Tests many pairs of polygons
+ *
+ * @param polys      The polygons
+ * @param pairs      Indices of the colliding and target polygons of each pair
+ * @param pair_count The number of pairs
+ * @param hits       Receives the result of each test (or NULL)
+ * @param manifolds  Receives the collision manifold of each pair (or NULL)
+ * @returns The number of overlapping pairs
+ */
+int ph_sat_poly_poly_batch(const ph_poly_t* polys,
+                           const ph_pair_t* pairs,
+                           int pair_count,
+                           bool* hits,
+                           ph_manifold_t* manifolds);
+
+/**
+ * @brief Tests many pairs of circles
+ *
+ * The results are the same as calling `ph_sat_circle_circle` for each pair
+ *
+ * @param circles    The circles
+ * @param pairs      Indices of the colliding and target circles of each pair
+ * @param pair_count The number of pairs
+ * @param hits       Receives the result of each test (or NULL)
+ * @param manifolds  Receives the collision manifold of each pair (or NULL)
+ * @returns The number of overlapping pairs
+ */
+int ph_sat_circle_circle_batch(const ph_circle_t* circles,
+                               const ph_pair_t* pairs,
+                               int pair_count,
+                               bool* hits,
+                               ph_manifold_t* manifolds);
+
+/**
+ * @brief Tests many pairs of AABBs
+ *
+ * The results are the same as calling `ph_sat_aabb_aabb` for each pair
+ *
+ * @param aabbs      The AABBs
+ * @param pairs      Indices of the colliding and target AABBs of each pair
+ * @param pair_count The number of pairs
+ * @param hits       Receives the result of each test (or NULL)
+ * @param manifolds  Receives the collision manifold of each pair (or NULL)
+ * @returns The number of overlapping pairs
+ */
+int ph_sat_aabb_aabb_batch(const pb2* aabbs,
+                           const ph_pair_t* pairs,
+                           int pair_count,
+                           bool* hits,
+                           ph_manifold_t* manifolds);
+
 /**
  * @brief Tests if ray intersects a (directed) line segment
  *
@@ -232,6 +470,83 @@ bool ph_ray_poly(const ph_ray_t* ray, const ph_poly_t* poly, ph_raycast_t* rayca
  */
 bool ph_ray_circle(const ph_ray_t* ray, const ph_circle_t* circle, ph_raycast_t* raycast);
 
+/**
+ * @brief Finds the closest polygon hit by a ray
+ *
+ * @param ray     Ray to test
+ * @param polys   The polygons
+ * @param aabbs   The bounds of the polygons (see `ph_poly_to_aabb`)
+ * @param count   The number of polygons
+ * @param raycast Normal and distance of the closest impact (or NULL). If NULL,
+ * the function returns as soon as any polygon is hit
+ * @returns The index of the polygon hit, or -1 if no polygon was hit
+ */
+int ph_ray_poly_closest(const ph_ray_t* ray,
+                        const ph_poly_t* polys,
+                        const pb2* aabbs,
+                        int count,
+                        ph_raycast_t* raycast);
+
+/**
+ * @brief Finds the closest circle hit by a ray
+ *
+ * Unlike `ph_ray_circle`, circles that are further away than the length of the
+ * ray are not hit
+ *
+ * @param ray     Ray to test
+ * @param circles The circles
+ * @param count   The number of circles
+ * @param raycast Normal and distance of the closest impact (or NULL). If NULL,
+ * the function returns as soon as any circle is hit
+ * @returns The index of the circle hit, or -1 if no circle was hit
+ */
+int ph_ray_circle_closest(const ph_ray_t* ray,
+                          const ph_circle_t* circles,
+                          int count,
+                          ph_raycast_t* raycast);
+
+/**
+ * @brief Casts many rays against a set of polygons
+ *
+ * @param rays       The rays to test
+ * @param ray_count  The number of rays
+ * @param polys      The polygons
+ * @param aabbs      The bounds of the polygons (see `ph_poly_to_aabb`)
+ * @param poly_count The number of polygons
+ * @param indices    Receives the index of the closest polygon hit by each ray,
+ * or -1
+ * @param raycasts   Receives the closest impact of each ray (or NULL). If NULL,
+ * `indices` receives any polygon hit by the ray
+ * @returns The number of rays that hit a polygon
+ */
+int ph_ray_poly_batch(const ph_ray_t* rays,
+                      int ray_count,
+                      const ph_poly_t* polys,
+                      const pb2* aabbs,
+                      int poly_count,
+                      int* indices,
+                      ph_raycast_t* raycasts);
+
+/**
+ * @brief Casts many rays against a set of circles
+ *
+ * @param rays         The rays to test
+ * @param ray_count    The number of rays
+ * @param circles      The circles
+ * @param circle_count The number of circles
+ * @param indices      Receives the index of the closest circle hit by each
+ * ray, or -1
+ * @param raycasts     Receives the closest impact of each ray (or NULL). If
+ * NULL, `indices` receives any circle hit by the ray
+ * @returns The number of rays that hit a circle
+ */
+int ph_ray_circle_batch(const ph_ray_t* rays,
+                        int ray_count,
+                        const ph_circle_t* circles,
+                        int circle_count,
+                        int* indices,
+                        ph_raycast_t* raycasts);
+
 /**
  * @brief Finds the point along the ray at the specified distance from the origin
  */
@@ -253,6 +568,267 @@ ph_poly_t ph_transform_poly(const pt2* transform, const ph_poly_t* poly);
  */
 ph_circle_t ph_transform_circle(const pt2* transform, const ph_circle_t* circle);
 
+/**
+ * @brief Invalidates a polygon cache
+ *
+ * This must be called before the first update, and whenever the source polygon
+ * changes
+ *
+ * @param cache The cache to initialize
+ */
+void ph_poly_cache_init(ph_poly_cache_t* cache);
+
+/**
+ * @brief Transforms a polygon into a cache, unless the cache already holds it
+ *
+ * The polygon is transformed and projected only if the transform differs from
+ * the one the cache was last built with
+ *
+ * @param cache     The cache to update
+ * @param transform The transform
+ * @param poly      The polygon to transform
+ * @returns The transformed polygon stored in the cache
+ */
+const ph_poly_t* ph_poly_cache_update(ph_poly_cache_t* cache,
+                                      const pt2* transform,
+                                      const ph_poly_t* poly);
+
+/**
+ * @brief Tests to see if one cached polygon overlaps with another
+ *
+ * The results are the same as calling `ph_sat_poly_poly` on the cached
+ * polygons
+ *
+ * @param cache_a  The colliding polygon
+ * @param cache_b  The target polygon
+ * @param manifold The collision manifold to populate (or NULL)
+ * @returns True if the polygons overlap and false otherwise
+ */
+bool ph_sat_poly_poly_cached(const ph_poly_cache_t* cache_a,
+                             const ph_poly_cache_t* cache_b,
+                             ph_manifold_t* manifold);
+
+/**
+ * @brief Empties a simplex, so that the next query starts from scratch
+ * @param simplex The simplex to initialize
+ */
+void ph_simplex_init(ph_simplex_t* simplex);
+
+/**
+ * @brief Tests to see if one polygon overlaps with another using GJK, and EPA
+ * if a manifold is requested
+ *
+ * The overlap agrees with `ph_sat_poly_poly` up to rounding errors. The normal
+ * always points from `poly_a` to `poly_b`. Polygons that merely touch may be
+ * reported as overlapping, with an overlap of zero
+ *
+ * @param poly_a   The colliding polygon
+ * @param poly_b   The target polygon
+ * @param simplex  The simplex of the previous query on the polygons, which
+ * receives the final simplex (or NULL)
+ * @param manifold The collision manifold to populate (or NULL)
+ * @returns True if the polygons overlap and false otherwise
+ */
+bool ph_gjk_poly_poly(const ph_poly_t* poly_a,
+                      const ph_poly_t* poly_b,
+                      ph_simplex_t* simplex,
+                      ph_manifold_t* manifold);
+
+/**
+ * @brief Computes the distance between two polygons using GJK
+ * @param poly_a  The first polygon
+ * @param poly_b  The second polygon
+ * @param simplex The simplex of the previous query on the polygons, which
+ * receives the final simplex (or NULL)
+ * @returns The distance between the polygons, or zero if they overlap
+ */
+pfloat ph_gjk_distance(const ph_poly_t* poly_a,
+                       const ph_poly_t* poly_b,
+                       ph_simplex_t* simplex);
+
+/**
+ * @brief Finds the time at which a moving circle first touches a moving
+ * polygon
+ *
+ * @param circle      The circle at the start of the motion
+ * @param circle_disp The displacement of the circle during the motion
+ * @param poly        The polygon at the start of the motion
+ * @param poly_disp   The displacement of the polygon during the motion
+ * @param toi         Time and normal of the impact (or NULL)
+ * @returns True if the shapes touch during the motion and false otherwise. If
+ * the shapes overlap at the start, the time of impact is zero
+ */
+bool ph_toi_circle_poly(const ph_circle_t* circle,
+                        pv2 circle_disp,
+                        const ph_poly_t* poly,
+                        pv2 poly_disp,
+                        ph_toi_t* toi);
+
+/**
+ * @brief Finds the time at which a moving polygon first touches another
+ *
+ * @param poly_a The first polygon at the start of the motion
+ * @param disp_a The displacement of the first polygon during the motion
+ * @param poly_b The second polygon at the start of the motion
+ * @param disp_b The displacement of the second polygon during the motion
+ * @param toi    Time and normal of the impact (or NULL)
+ * @returns True if the polygons touch during the motion and false otherwise.
+ * If the polygons overlap at the start, the time of impact is zero
+ */
+bool ph_toi_poly_poly(const ph_poly_t* poly_a,
+                      pv2 disp_a,
+                      const ph_poly_t* poly_b,
+                      pv2 disp_b,
+                      ph_toi_t* toi);
+
+/**
+ * @brief Tests to see if one polygon overlaps with another, starting with the
+ * separating axis of a previous test
+ *
+ * The result and manifold are the same as those of `ph_sat_poly_poly`, except
+ * that a different separating axis may be reported. If the previous separating
+ * axis still separates the polygons, this only costs a single projection
+ *
+ * @param poly_a   The colliding polygon
+ * @param poly_b   The target polygon
+ * @param previous The manifold of the previous test of the polygons (or NULL).
+ * May be the same as `manifold`
+ * @param manifold The collision manifold to populate (or NULL)
+ * @returns True if the polygons overlap and false otherwise
+ */
+bool ph_sat_poly_poly_coherent(const ph_poly_t* poly_a,
+                               const ph_poly_t* poly_b,
+                               const ph_manifold_t* previous,
+                               ph_manifold_t* manifold);
+
+/**
+ * @brief Creates a contact cache
+ * @param mem_ctx Used to store user data for custom memory allocators
+ * @returns A contact cache instance
+ */
+ph_contact_cache_t* ph_contact_cache_create(void* mem_ctx);
+
+/**
+ * @brief Destroys a contact cache
+ * @param cache The contact cache to destroy
+ */
+void ph_contact_cache_destroy(ph_contact_cache_t* cache);
+
+/**
+ * @brief Finds the contact of a pair of shapes, creating it if required
+ *
+ * New contacts have no impulses and are not touching. The contact is marked as
+ * used, so that it survives the next prune. The pointer remains valid until
+ * the next call to `ph_contact_cache_get` or `ph_contact_cache_prune`
+ *
+ * @param cache The contact cache
+ * @param a     Index of the colliding shape
+ * @param b     Index of the target shape
+ * @returns The contact of the shapes
+ */
+ph_contact_t* ph_contact_cache_get(ph_contact_cache_t* cache, int a, int b);
+
+/**
+ * @brief Removes contacts that were not accessed since the last prune
+ *
+ * This is typically called once per frame, after all pairs have been tested
+ *
+ * @param cache The contact cache
+ */
+void ph_contact_cache_prune(ph_contact_cache_t* cache);
+
+/**
+ * @brief Returns the number of contacts in a cache
+ */
+int ph_contact_cache_count(const ph_contact_cache_t* cache);
+
+/**
+ * @brief Tests a pair of polygons and updates their contact
+ *
+ * The polygons are tested using `ph_sat_poly_poly_coherent`, starting with the
+ * separating axis of the previous test. The impulses of the contact are reset
+ * unless the polygons were touching before and the same feature produced the
+ * normal
+ *
+ * @param contact The contact of the polygons
+ * @param poly_a  The colliding polygon
+ * @param poly_b  The target polygon
+ * @returns True if the polygons overlap and false otherwise
+ */
+bool ph_contact_poly_poly(ph_contact_t* contact,
+                          const ph_poly_t* poly_a,
+                          const ph_poly_t* poly_b);
+
+/**
+ * @brief Creates a broad phase
+ * @param margin  The amount by which AABBs are enlarged on each side
+ * @param mem_ctx Used to store user data for custom memory allocators
+ * @returns A broad phase instance
+ */
+ph_broadphase_t* ph_broadphase_create(pfloat margin, void* mem_ctx);
+
+/**
+ * @brief Destroys a broad phase
+ * @param bp The broad phase to destroy
+ */
+void ph_broadphase_destroy(ph_broadphase_t* bp);
+
+/**
+ * @brief Adds a shape to the broad phase
+ * @param bp    The broad phase instance
+ * @param aabb  The bounds of the shape
+ * @param value A value identifying the shape (e.g. an index into an array of
+ * shapes), which is reported in pairs
+ * @returns A proxy used to move or remove the shape
+ */
+int ph_broadphase_insert(ph_broadphase_t* bp, const pb2* aabb, int value);
+
+/**
+ * @brief Removes a shape from the broad phase
+ * @param bp    The broad phase instance
+ * @param proxy The proxy returned by `ph_broadphase_insert`
+ */
+void ph_broadphase_remove(ph_broadphase_t* bp, int proxy);
+
+/**
+ * @brief Updates the bounds of a shape
+ *
+ * The tree is only changed if the bounds are no longer contained within the
+ * fat AABB of the shape
+ *
+ * @param bp    The broad phase instance
+ * @param proxy The proxy returned by `ph_broadphase_insert`
+ * @param aabb  The new bounds of the shape
+ * @returns True if the shape was reinserted, and false otherwise
+ */
+bool ph_broadphase_move(ph_broadphase_t* bp, int proxy, const pb2* aabb);
+
+/**
+ * @brief Finds all pairs of shapes whose fat AABBs overlap
+ *
+ * Each pair is reported once. The `a` and `b` members of each pair hold the
+ * values the shapes were inserted with.
+ *
+ * @param bp       The broad phase instance
+ * @param pairs    The destination buffer (can be NULL if `capacity` is zero)
+ * @param capacity The number of pairs that fit into the buffer
+ * @returns The total number of pairs. If this is larger than `capacity`, only
+ * the first `capacity` pairs were written
+ */
+int ph_broadphase_find_pairs(const ph_broadphase_t* bp, ph_pair_t* pairs, int capacity);
+
+/**
+ * @brief Finds all shapes whose fat AABBs overlap the specified AABB
+ *
+ * @param bp       The broad phase instance
+ * @param aabb     The search area
+ * @param values   The destination buffer (can be NULL if `capacity` is zero)
+ * @param capacity The number of values that fit into the buffer
+ * @returns The total number of shapes found. If this is larger than
+ * `capacity`, only the first `capacity` values were written
+ */
+int ph_broadphase_query(const ph_broadphase_t* bp, const pb2* aabb, int* values, int capacity);
+
 /**
  * @brief Returns the bounding box for the given polygon
  */
@@ -280,8 +856,29 @@ pb2 ph_circle_to_aabb(const ph_circle_t* circle);
     #endif
 #endif
 
+#if !defined(PICO_HIT_MALLOC) || !defined(PICO_HIT_REALLOC) || !defined(PICO_HIT_FREE)
+    #include <stdlib.h>
+    #define PICO_HIT_MALLOC(size, ctx)       (malloc(size))
+    #define PICO_HIT_REALLOC(ptr, size, ctx) (realloc(ptr, size))
+    #define PICO_HIT_FREE(ptr, ctx)          (free(ptr))
+#endif
+
 #define SAT_ASSERT PICO_HIT_ASSERT // Alias
 
+#define PH_MALLOC  PICO_HIT_MALLOC
+#define PH_REALLOC PICO_HIT_REALLOC
+#define PH_FREE    PICO_HIT_FREE
+
+#if !defined(PICO_HIT_NO_SIMD) && !defined(PICO_MATH_DOUBLE)
+    #if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+        #include <xmmintrin.h>
+        #define PH_SIMD_SSE
+    #elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+        #include <arm_neon.h>
+        #define PH_SIMD_NEON
+    #endif
+#endif
+
 /*=============================================================================
  * Internal function declarations
  *============================================================================*/
@@ -292,7 +889,68 @@ static void ph_init_manifold(ph_manifold_t* manifold);
 // Updates manifold if requried
 static void ph_update_manifold(ph_manifold_t* manifold,
                                pv2 normal,
-                               pfloat overlap);
+                               pfloat overlap,
+                               ph_feature_t feature,
+                               int index);
+
+// Records the feature of a separating axis
+static void ph_separating_feature(ph_manifold_t* manifold,
+                                  ph_feature_t feature,
+                                  int index);
+
+// Exchanges the roles of the shapes of a feature
+static ph_feature_t ph_swap_feature(ph_feature_t feature);
+
+// Fills in the manifold of two overlapping circles
+static void ph_circle_circle_manifold(pv2 diff,
+                                      pfloat dist2,
+                                      pfloat total_radius,
+                                      ph_manifold_t* manifold);
+
+// Fills in the manifold of two overlapping AABBs
+static void ph_aabb_aabb_manifold(const pb2* aabb_a,
+                                  const pb2* aabb_b,
+                                  ph_manifold_t* manifold);
+
+// Tests four pairs of circles, bit i of the result is set if pair i overlaps
+static unsigned ph_circle_circle_mask4(const ph_circle_t* circles,
+                                       const ph_pair_t* pairs);
+
+// Tests four pairs of AABBs, bit i of the result is set if pair i overlaps
+static unsigned ph_aabb_aabb_mask4(const pb2* aabbs, const ph_pair_t* pairs);
+
+// A ray prepared for slab tests against AABBs
+typedef struct
+{
+    pv2 pos;
+    pv2 inv_dir; // Reciprocal of the direction, huge for zero components
+} ph_slab_ray_t;
+
+// Prepares a ray for slab tests
+static ph_slab_ray_t ph_make_slab_ray(const ph_ray_t* ray);
+
+// Tests if the ray enters the AABB within `max_dist`
+static bool ph_ray_slab(const ph_slab_ray_t* ray, const pb2* aabb, pfloat max_dist);
+
+// Tests four AABBs, bit i of the result is set if the ray enters AABB i within
+// `max_dist`
+static unsigned ph_ray_slab4(const ph_slab_ray_t* ray, const pb2* aabbs, pfloat max_dist);
+
+// Records a shape that passed the slab test if it is the closest hit so far.
+// `candidate` may only be NULL if `raycast` is NULL. Returns true if the shape
+// was recorded
+static bool ph_ray_record(const ph_ray_t* ray,
+                          bool hit,
+                          const ph_raycast_t* candidate,
+                          int index,
+                          int* closest,
+                          ph_raycast_t* raycast);
+
+// Stores the result of a pair test of a batch
+static void ph_batch_result(int i,
+                            bool hit,
+                            bool* hits,
+                            ph_manifold_t* manifolds);
 
 // Determines the polygon's limits when projected onto the normal vector
 static void ph_axis_range(const ph_poly_t* poly, pv2 normal, pfloat range[2]);
@@ -302,6 +960,111 @@ static pfloat ph_axis_overlap(const ph_poly_t* poly_a,
                                 const ph_poly_t* poly_b,
                                 pv2 axis);
 
+// Determines the amount overlap of two projected ranges
+static pfloat ph_range_overlap(const pfloat range_a[2], const pfloat range_b[2]);
+
+// Tests the normals of a cached polygon against another polygon, returns false
+// if one of them is separating
+static bool ph_cached_axes_overlap(const ph_poly_cache_t* cache,
+                                   const ph_poly_t* poly,
+                                   ph_feature_t feature,
+                                   ph_manifold_t* manifold);
+
+// Maximum number of GJK iterations
+#define PH_GJK_MAX_ITERATIONS 32
+
+// Maximum number of EPA polytope vertices. The Minkowski difference of two
+// polygons has at most as many vertices as both polygons combined
+#define PH_EPA_MAX_VERTS (2 * PICO_HIT_MAX_POLY_VERTS)
+
+// Vertex of a simplex on the Minkowski difference of two polygons
+typedef struct
+{
+    pv2    point;   // Vertex of poly_a minus vertex of poly_b
+    pfloat u;       // Barycentric coordinate of the closest point
+    int    index_a;
+    int    index_b;
+} ph_gjk_vertex_t;
+
+// Working simplex of GJK
+typedef struct
+{
+    ph_gjk_vertex_t vertices[3];
+    int             count;
+} ph_gjk_t;
+
+// Finds the vertex of the polygon furthest along the direction
+static int ph_support(const ph_poly_t* poly, pv2 dir);
+
+// Builds a simplex vertex from a vertex of each polygon
+static ph_gjk_vertex_t ph_gjk_make_vertex(const ph_poly_t* poly_a,
+                                          const ph_poly_t* poly_b,
+                                          int index_a,
+                                          int index_b);
+
+// Reduces a line segment simplex to the feature closest to the origin
+static void ph_gjk_solve2(ph_gjk_t* gjk);
+
+// Reduces a triangle simplex to the feature closest to the origin, the
+// triangle is kept only if it contains the origin (including its boundary)
+static void ph_gjk_solve3(ph_gjk_t* gjk);
+
+// Computes the point of the simplex closest to the origin
+static pv2 ph_gjk_closest(const ph_gjk_t* gjk);
+
+// Runs GJK, starting from the simplex (or NULL) and storing the final simplex
+// back into it. Returns true if the polygons overlap, in which case `gjk` is
+// a triangle containing the origin
+static bool ph_gjk(const ph_poly_t* poly_a,
+                   const ph_poly_t* poly_b,
+                   ph_simplex_t* simplex,
+                   ph_gjk_t* gjk);
+
+// Expands the triangle found by GJK to the edge of the Minkowski difference
+// closest to the origin, which gives the normal and overlap
+static void ph_epa(const ph_poly_t* poly_a,
+                   const ph_poly_t* poly_b,
+                   const ph_gjk_t* gjk,
+                   ph_manifold_t* manifold);
+
+// Removes a vertex from the EPA polytope, and returns the new position of the
+// vertex at position `k`
+static int ph_epa_remove(ph_gjk_vertex_t* polytope, int count, int index, int k);
+
+// Shapes closer than this are considered to touch by time of impact queries
+#define PH_TOI_TOLERANCE 1e-3f
+
+// Maximum number of conservative advancement steps
+#define PH_TOI_MAX_ITERATIONS 32
+
+// Finds the time of impact of a polygon moving by `motion` relative to another
+// polygon, where the first polygon is enlarged by `radius`
+static bool ph_toi(const ph_poly_t* poly_a,
+                   const ph_poly_t* poly_b,
+                   pv2 motion,
+                   pfloat radius,
+                   ph_toi_t* toi);
+
+struct ph_contact_cache_t
+{
+    void*         mem_ctx;
+    ph_contact_t* contacts;
+    int           count;
+    int           capacity;
+    int*          slots;      // Open addressing table of contact indices
+    int           slot_count; // Power of two, at least twice the capacity
+};
+
+// Hashes a pair of shape indices
+static unsigned ph_pair_hash(int a, int b);
+
+// Finds the slot holding the contact of the pair, or the empty slot where it
+// belongs
+static int ph_contact_slot(const ph_contact_cache_t* cache, int a, int b);
+
+// Rebuilds the table of slots from the contacts
+static void ph_contact_rehash(ph_contact_cache_t* cache);
+
 // Line Voronoi regions
 typedef enum
 {
@@ -318,6 +1081,79 @@ typedef enum
 //               line
 static ph_voronoi_region_t ph_voronoi_region(pv2 point, pv2 line);
 
+// Marks the absence of a node
+#define PH_NULL_NODE (-1)
+
+// Node of the dynamic AABB tree. Leaves hold shapes
+typedef struct
+{
+    pb2 aabb;   // Fat AABB for leaves, union of the children otherwise
+    int parent; // Next free node if the node is unused
+    int child1;
+    int child2;
+    int height; // Zero for leaves and -1 for unused nodes
+    int value;
+} ph_bp_node_t;
+
+struct ph_broadphase_t
+{
+    void*         mem_ctx;
+    pfloat        margin;
+    int           root;
+    int           free_list;
+    int           capacity;
+    ph_bp_node_t* nodes;
+};
+
+// State of `ph_broadphase_find_pairs`
+typedef struct
+{
+    ph_pair_t* pairs;
+    int        capacity;
+    int        count;
+} ph_bp_pairs_t;
+
+// State of `ph_broadphase_query`
+typedef struct
+{
+    int* values;
+    int  capacity;
+    int  count;
+} ph_bp_values_t;
+
+// Takes a node from the free list, growing the pool if required
+static int ph_bp_alloc_node(ph_broadphase_t* bp);
+
+// Returns a node to the free list
+static void ph_bp_free_node(ph_broadphase_t* bp, int node);
+
+// Links a leaf into the tree, next to the sibling that adds the least perimeter
+static void ph_bp_insert_leaf(ph_broadphase_t* bp, int leaf);
+
+// Unlinks a leaf from the tree
+static void ph_bp_remove_leaf(ph_broadphase_t* bp, int leaf);
+
+// Refits and rebalances the ancestors of a node
+static void ph_bp_refit(ph_broadphase_t* bp, int node);
+
+// Rotates the subtree to keep it balanced, returns its new root
+static int ph_bp_balance(ph_broadphase_t* bp, int node);
+
+// Reports the overlapping pairs within a subtree
+static void ph_bp_self_pairs(const ph_broadphase_t* bp, int node, ph_bp_pairs_t* result);
+
+// Reports the overlapping pairs between two disjoint subtrees
+static void ph_bp_cross_pairs(const ph_broadphase_t* bp, int node1, int node2, ph_bp_pairs_t* result);
+
+// Reports the leaves of a subtree that overlap the AABB
+static void ph_bp_query_node(const ph_broadphase_t* bp, int node, const pb2* aabb, ph_bp_values_t* result);
+
+// Perimeter of an AABB, used as the cost of a node
+static pfloat ph_perimeter(const pb2* aabb);
+
+// Maximum of two integers
+static int ph_max(int a, int b);
+
 // 2D matrix
 typedef struct
 {
@@ -418,11 +1254,14 @@ bool ph_sat_poly_poly(const ph_poly_t* poly_a,
 
         // Axis is separating, polygons do not overlap
         if (overlap == 0.0f)
+        {
+            ph_separating_feature(manifold, PH_FEATURE_EDGE_A, i);
             return false;
+        }
 
         // Update manifold information with new overlap and normal
         if (manifold)
-            ph_update_manifold(manifold, poly_a->normals[i], overlap);
+            ph_update_manifold(manifold, poly_a->normals[i], overlap, PH_FEATURE_EDGE_A, i);
     }
 
     // Test axises on poly_b
@@ -433,11 +1272,14 @@ bool ph_sat_poly_poly(const ph_poly_t* poly_a,
 
         // Axis is separating, polygons do not overlap
         if (overlap == 0.0f)
+        {
+            ph_separating_feature(manifold, PH_FEATURE_EDGE_B, i);
             return false;
+        }
 
         // Update manifold information with new overlap and normal
         if (manifold)
-            ph_update_manifold(manifold, poly_b->normals[i], overlap);
+            ph_update_manifold(manifold, poly_b->normals[i], overlap, PH_FEATURE_EDGE_B, i);
     }
 
     return true;
@@ -516,7 +1358,7 @@ bool ph_sat_poly_circle(const ph_poly_t* poly,
                     pv2 normal = pv2_normalize(point);
 
                     // Update manifold
-                    ph_update_manifold(manifold, normal, overlap);
+                    ph_update_manifold(manifold, normal, overlap, PH_FEATURE_VERTEX_A, i);
                 }
             }
         }
@@ -540,7 +1382,7 @@ bool ph_sat_poly_circle(const ph_poly_t* poly,
                     pfloat diff = pf_sqrt(diff2);
                     pfloat overlap = circle->radius - diff;
                     pv2 normal = pv2_normalize(point);
-                    ph_update_manifold(manifold, normal, overlap);
+                    ph_update_manifold(manifold, normal, overlap, PH_FEATURE_VERTEX_A, i);
                 }
             }
         }
@@ -564,7 +1406,7 @@ bool ph_sat_poly_circle(const ph_poly_t* poly,
                 pfloat overlap = circle->radius - diff;
 
                 // Update manifold
-                ph_update_manifold(manifold, normal, overlap);
+                ph_update_manifold(manifold, normal, overlap, PH_FEATURE_EDGE_A, i);
             }
         }
     }
@@ -585,8 +1427,9 @@ bool ph_sat_circle_poly(const ph_circle_t* circle,
     {
         // Since arguments were swapped, reversing these vectors is all that is
         // required
-        manifold->normal = pv2_reflect(manifold->normal);
-        manifold->vector = pv2_reflect(manifold->vector);
+        manifold->normal  = pv2_reflect(manifold->normal);
+        manifold->vector  = pv2_reflect(manifold->vector);
+        manifold->feature = ph_swap_feature(manifold->feature);
     }
 
     return hit;
@@ -620,30 +1463,172 @@ bool ph_sat_circle_circle(const ph_circle_t* circle_a,
         return false;
 
     if (manifold)
-    {
-         // Calculate distance because we need it now
-        pfloat dist = pf_sqrt(dist2);
+        ph_circle_circle_manifold(diff, dist2, total_radius, manifold);
+
+    return true;
+}
 
-        // Calculate overlap
-        pfloat overlap = total_radius - dist;
+bool ph_sat_aabb_aabb(const pb2* aabb_a,
+                      const pb2* aabb_b,
+                      ph_manifold_t* manifold)
+{
+    SAT_ASSERT(aabb_a);
+    SAT_ASSERT(aabb_b);
+
+    if (manifold)
+        ph_init_manifold(manifold);
 
-        // Normal direction is just circle_b relative to circle_a
-        pv2 normal = pv2_normalize(diff);
+    // Overlap along each axis. Touching boxes do not overlap, just like in
+    // `ph_sat_poly_poly`
+    pfloat overlap_x = pf_min(aabb_a->max.x - aabb_b->min.x, aabb_b->max.x - aabb_a->min.x);
+    pfloat overlap_y = pf_min(aabb_a->max.y - aabb_b->min.y, aabb_b->max.y - aabb_a->min.y);
 
-        // Update manifold
-        ph_update_manifold(manifold, normal, overlap);
-    }
+    if (!(overlap_x > 0.0f && overlap_y > 0.0f))
+        return false;
+
+    if (manifold)
+        ph_aabb_aabb_manifold(aabb_a, aabb_b, manifold);
 
     return true;
 }
 
-/*
-    The basic idea here is to represent the rays in parametric form and
-    solve a linear equation to get the parameters where they intersect.
-    In this application we are only interested in the case where both of them
-    are contained in the interval [0, 1]
-*/
-bool ph_ray_line(const ph_ray_t* ray, pv2 s1, pv2 s2, ph_raycast_t* raycast)
+int ph_sat_poly_poly_batch(const ph_poly_t* polys,
+                           const ph_pair_t* pairs,
+                           int pair_count,
+                           bool* hits,
+                           ph_manifold_t* manifolds)
+{
+    SAT_ASSERT(polys);
+    SAT_ASSERT(pairs || 0 == pair_count);
+
+    int hit_count = 0;
+
+    for (int i = 0; i < pair_count; i++)
+    {
+        bool hit = ph_sat_poly_poly(&polys[pairs[i].a],
+                                    &polys[pairs[i].b],
+                                    (manifolds) ? &manifolds[i] : NULL);
+
+        if (hits)
+            hits[i] = hit;
+
+        hit_count += hit;
+    }
+
+    return hit_count;
+}
+
+int ph_sat_circle_circle_batch(const ph_circle_t* circles,
+                               const ph_pair_t* pairs,
+                               int pair_count,
+                               bool* hits,
+                               ph_manifold_t* manifolds)
+{
+    SAT_ASSERT(circles);
+    SAT_ASSERT(pairs || 0 == pair_count);
+
+    int hit_count = 0;
+    int i = 0;
+
+    // Four pairs at a time, manifolds are only calculated for hits
+    for (; i + 4 <= pair_count; i += 4)
+    {
+        unsigned mask = ph_circle_circle_mask4(circles, &pairs[i]);
+
+        for (int j = 0; j < 4; j++)
+        {
+            bool hit = (mask >> j) & 1;
+
+            ph_batch_result(i + j, hit, hits, manifolds);
+
+            if (hit && manifolds)
+            {
+                const ph_circle_t* circle_a = &circles[pairs[i + j].a];
+                const ph_circle_t* circle_b = &circles[pairs[i + j].b];
+
+                pv2 diff = pv2_sub(circle_b->pos, circle_a->pos);
+
+                ph_circle_circle_manifold(diff,
+                                          pv2_len2(diff),
+                                          circle_a->radius + circle_b->radius,
+                                          &manifolds[i + j]);
+            }
+
+            hit_count += hit;
+        }
+    }
+
+    for (; i < pair_count; i++)
+    {
+        bool hit = ph_sat_circle_circle(&circles[pairs[i].a],
+                                        &circles[pairs[i].b],
+                                        (manifolds) ? &manifolds[i] : NULL);
+
+        if (hits)
+            hits[i] = hit;
+
+        hit_count += hit;
+    }
+
+    return hit_count;
+}
+
+int ph_sat_aabb_aabb_batch(const pb2* aabbs,
+                           const ph_pair_t* pairs,
+                           int pair_count,
+                           bool* hits,
+                           ph_manifold_t* manifolds)
+{
+    SAT_ASSERT(aabbs);
+    SAT_ASSERT(pairs || 0 == pair_count);
+
+    int hit_count = 0;
+    int i = 0;
+
+    // Four pairs at a time, manifolds are only calculated for hits
+    for (; i + 4 <= pair_count; i += 4)
+    {
+        unsigned mask = ph_aabb_aabb_mask4(aabbs, &pairs[i]);
+
+        for (int j = 0; j < 4; j++)
+        {
+            bool hit = (mask >> j) & 1;
+
+            ph_batch_result(i + j, hit, hits, manifolds);
+
+            if (hit && manifolds)
+            {
+                ph_aabb_aabb_manifold(&aabbs[pairs[i + j].a],
+                                      &aabbs[pairs[i + j].b],
+                                      &manifolds[i + j]);
+            }
+
+            hit_count += hit;
+        }
+    }
+
+    for (; i < pair_count; i++)
+    {
+        bool hit = ph_sat_aabb_aabb(&aabbs[pairs[i].a],
+                                    &aabbs[pairs[i].b],
+                                    (manifolds) ? &manifolds[i] : NULL);
+
+        if (hits)
+            hits[i] = hit;
+
+        hit_count += hit;
+    }
+
+    return hit_count;
+}
+
+/*
+    The basic idea here is to represent the rays in parametric form and
+    solve a linear equation to get the parameters where they intersect.
+    In this application we are only interested in the case where both of them
+    are contained in the interval [0, 1]
+*/
+bool ph_ray_line(const ph_ray_t* ray, pv2 s1, pv2 s2, ph_raycast_t* raycast)
 {
     pv2 r1 = ray->pos;
     pv2 r2 = pv2_add(ray->pos, pv2_scale(ray->dir, ray->dist));
@@ -765,6 +1750,161 @@ bool ph_ray_circle(const ph_ray_t* ray, const ph_circle_t* circle, ph_raycast_t*
     return true;
 }
 
+int ph_ray_poly_closest(const ph_ray_t* ray,
+                        const ph_poly_t* polys,
+                        const pb2* aabbs,
+                        int count,
+                        ph_raycast_t* raycast)
+{
+    SAT_ASSERT(ray);
+    SAT_ASSERT((polys && aabbs) || 0 == count);
+
+    ph_slab_ray_t slab = ph_make_slab_ray(ray);
+
+    ph_raycast_t candidate;
+    int closest = -1;
+    int i = 0;
+
+    // Shapes further away than the closest hit are rejected by the slab test
+    for (; i + 4 <= count; i += 4)
+    {
+        pfloat max_dist = (raycast && closest >= 0) ? raycast->dist : ray->dist;
+
+        unsigned mask = ph_ray_slab4(&slab, &aabbs[i], max_dist);
+
+        for (int j = 0; mask; j++, mask >>= 1)
+        {
+            if (!(mask & 1))
+                continue;
+
+            ph_raycast_t* result = (raycast) ? &candidate : NULL;
+
+            bool hit = ph_ray_poly(ray, &polys[i + j], result);
+
+            if (ph_ray_record(ray, hit, result, i + j, &closest, raycast) && !raycast)
+                return closest;
+        }
+    }
+
+    for (; i < count; i++)
+    {
+        pfloat max_dist = (raycast && closest >= 0) ? raycast->dist : ray->dist;
+
+        if (!ph_ray_slab(&slab, &aabbs[i], max_dist))
+            continue;
+
+        ph_raycast_t* result = (raycast) ? &candidate : NULL;
+
+        bool hit = ph_ray_poly(ray, &polys[i], result);
+
+        if (ph_ray_record(ray, hit, result, i, &closest, raycast) && !raycast)
+            return closest;
+    }
+
+    return closest;
+}
+
+int ph_ray_circle_closest(const ph_ray_t* ray,
+                          const ph_circle_t* circles,
+                          int count,
+                          ph_raycast_t* raycast)
+{
+    SAT_ASSERT(ray);
+    SAT_ASSERT(circles || 0 == count);
+
+    ph_slab_ray_t slab = ph_make_slab_ray(ray);
+
+    ph_raycast_t candidate;
+    int closest = -1;
+
+    for (int i = 0; i < count; i += 4)
+    {
+        int group = (count - i < 4) ? count - i : 4;
+
+        // Bounds of the circles, unused slots repeat the last circle
+        pb2 aabbs[4];
+
+        for (int j = 0; j < 4; j++)
+        {
+            const ph_circle_t* circle = &circles[i + ((j < group) ? j : group - 1)];
+
+            pv2 radius = pv2_make(circle->radius, circle->radius);
+
+            aabbs[j] = pb2_make_minmax(pv2_sub(circle->pos, radius), pv2_add(circle->pos, radius));
+        }
+
+        pfloat max_dist = (raycast && closest >= 0) ? raycast->dist : ray->dist;
+
+        unsigned mask = ph_ray_slab4(&slab, aabbs, max_dist) & ((1u << group) - 1);
+
+        for (int j = 0; mask; j++, mask >>= 1)
+        {
+            if (!(mask & 1))
+                continue;
+
+            // The distance is always needed to ignore circles beyond the ray
+            bool hit = ph_ray_circle(ray, &circles[i + j], &candidate);
+
+            if (ph_ray_record(ray, hit, &candidate, i + j, &closest, raycast) && !raycast)
+                return closest;
+        }
+    }
+
+    return closest;
+}
+
+int ph_ray_poly_batch(const ph_ray_t* rays,
+                      int ray_count,
+                      const ph_poly_t* polys,
+                      const pb2* aabbs,
+                      int poly_count,
+                      int* indices,
+                      ph_raycast_t* raycasts)
+{
+    SAT_ASSERT(rays || 0 == ray_count);
+    SAT_ASSERT(indices || 0 == ray_count);
+
+    int hit_count = 0;
+
+    for (int i = 0; i < ray_count; i++)
+    {
+        indices[i] = ph_ray_poly_closest(&rays[i],
+                                         polys,
+                                         aabbs,
+                                         poly_count,
+                                         (raycasts) ? &raycasts[i] : NULL);
+
+        hit_count += (indices[i] >= 0);
+    }
+
+    return hit_count;
+}
+
+int ph_ray_circle_batch(const ph_ray_t* rays,
+                        int ray_count,
+                        const ph_circle_t* circles,
+                        int circle_count,
+                        int* indices,
+                        ph_raycast_t* raycasts)
+{
+    SAT_ASSERT(rays || 0 == ray_count);
+    SAT_ASSERT(indices || 0 == ray_count);
+
+    int hit_count = 0;
+
+    for (int i = 0; i < ray_count; i++)
+    {
+        indices[i] = ph_ray_circle_closest(&rays[i],
+                                           circles,
+                                           circle_count,
+                                           (raycasts) ? &raycasts[i] : NULL);
+
+        hit_count += (indices[i] >= 0);
+    }
+
+    return hit_count;
+}
+
 pv2 ph_ray_at(const ph_ray_t* ray, pfloat dist)
 {
     return pv2_add(ray->pos, pv2_scale(ray->dir, dist));
@@ -788,121 +1928,1909 @@ ph_circle_t ph_transform_circle(const pt2* transform,
     return ph_make_circle(pt2_map(transform, circle->pos), circle->radius);
 }
 
-pb2 ph_poly_to_aabb(const ph_poly_t* poly)
+void ph_poly_cache_init(ph_poly_cache_t* cache)
 {
-    return pb2_enclosing(poly->vertices, poly->vertex_count);
+    SAT_ASSERT(cache);
+
+    cache->poly.vertex_count = 0;
+    cache->transform = pt2_identity();
+    cache->valid = false;
 }
 
-pb2 ph_circle_to_aabb(const ph_circle_t* circle)
+const ph_poly_t* ph_poly_cache_update(ph_poly_cache_t* cache,
+                                      const pt2* transform,
+                                      const ph_poly_t* poly)
 {
-    pv2 half_radius = pv2_make(circle->radius / 2.0f, circle->radius / 2.0f);
+    SAT_ASSERT(cache);
+    SAT_ASSERT(transform);
+    SAT_ASSERT(poly);
 
-    pv2 min = pv2_sub(circle->pos, half_radius);
-    pv2 max = pv2_add(circle->pos, half_radius);
+    // The transform is compared exactly, so that the cached polygon is the
+    // same as the one `ph_transform_poly` would return
+    const pt2* t = &cache->transform;
 
-    return pb2_make_minmax(min, max);
+    bool same = t->t00 == transform->t00 && t->t10 == transform->t10 &&
+                t->t01 == transform->t01 && t->t11 == transform->t11 &&
+                t->tx  == transform->tx  && t->ty  == transform->ty;
+
+    if (cache->valid && same)
+        return &cache->poly;
+
+    cache->poly = ph_transform_poly(transform, poly);
+    cache->transform = *transform;
+    cache->valid = true;
+
+    for (int i = 0; i < cache->poly.vertex_count; i++)
+    {
+        ph_axis_range(&cache->poly, cache->poly.normals[i], cache->ranges[i]);
+    }
+
+    return &cache->poly;
 }
 
-/*=============================================================================
- * Internal function definitions
- *============================================================================*/
+bool ph_sat_poly_poly_cached(const ph_poly_cache_t* cache_a,
+                             const ph_poly_cache_t* cache_b,
+                             ph_manifold_t* manifold)
+{
+    SAT_ASSERT(cache_a && cache_a->valid);
+    SAT_ASSERT(cache_b && cache_b->valid);
 
-static void ph_init_manifold(ph_manifold_t* manifold)
+    if (manifold)
+        ph_init_manifold(manifold);
+
+    // Same order of axises as `ph_sat_poly_poly`
+    return ph_cached_axes_overlap(cache_a, &cache_b->poly, PH_FEATURE_EDGE_A, manifold) &&
+           ph_cached_axes_overlap(cache_b, &cache_a->poly, PH_FEATURE_EDGE_B, manifold);
+}
+
+void ph_simplex_init(ph_simplex_t* simplex)
 {
-    SAT_ASSERT(manifold);
+    SAT_ASSERT(simplex);
 
-    manifold->overlap = PM_FLOAT_MAX;
-    manifold->normal  = pv2_zero();
-    manifold->vector  = pv2_zero();
+    simplex->count = 0;
 }
 
-static void ph_update_manifold(ph_manifold_t* manifold, pv2 normal, pfloat overlap)
+bool ph_gjk_poly_poly(const ph_poly_t* poly_a,
+                      const ph_poly_t* poly_b,
+                      ph_simplex_t* simplex,
+                      ph_manifold_t* manifold)
 {
-    SAT_ASSERT(manifold);
+    SAT_ASSERT(poly_a);
+    SAT_ASSERT(poly_b);
 
-    pfloat abs_overlap = pf_abs(overlap);
+    if (manifold)
+        ph_init_manifold(manifold);
 
-    // Only update if the new overlap is smaller than the old one
-    if (abs_overlap < manifold->overlap)
-    {
-        // Update overlap (always positive)
-        manifold->overlap = abs_overlap;
+    ph_gjk_t gjk;
 
-        // If the overlap is less that zero the normal must be reversed
-        if (overlap < 0.0f)
-            manifold->normal = pv2_reflect(normal);
-        else if (overlap > 0.0f)
-            manifold->normal = normal;
+    if (!ph_gjk(poly_a, poly_b, simplex, &gjk))
+        return false;
 
-        manifold->vector = pv2_scale(manifold->normal, manifold->overlap);
-    }
+    if (manifold)
+        ph_epa(poly_a, poly_b, &gjk, manifold);
+
+    return true;
 }
 
-static void ph_axis_range(const ph_poly_t* poly, pv2 normal, pfloat range[2])
+pfloat ph_gjk_distance(const ph_poly_t* poly_a,
+                       const ph_poly_t* poly_b,
+                       ph_simplex_t* simplex)
 {
-    SAT_ASSERT(poly);
-    SAT_ASSERT(range);
+    SAT_ASSERT(poly_a);
+    SAT_ASSERT(poly_b);
 
-    pfloat dot = pv2_dot(poly->vertices[0], normal);
-    pfloat min = dot;
-    pfloat max = dot;
+    ph_gjk_t gjk;
 
-    // Find the minimum and maximum distance of the polygon along the normal
-    for (int i = 1; i < poly->vertex_count; i++)
-    {
-        dot = pv2_dot(poly->vertices[i], normal);
+    if (ph_gjk(poly_a, poly_b, simplex, &gjk))
+        return 0.0f;
 
-        if (dot < min)
-            min = dot;
+    return pv2_len(ph_gjk_closest(&gjk));
+}
 
-        if (dot > max)
-            max = dot;
-    }
+bool ph_toi_circle_poly(const ph_circle_t* circle,
+                        pv2 circle_disp,
+                        const ph_poly_t* poly,
+                        pv2 poly_disp,
+                        ph_toi_t* toi)
+{
+    SAT_ASSERT(circle);
+    SAT_ASSERT(poly);
 
-    // The range defines the interval induced by the polygon projected onto the
-    // normal vector
-    range[0] = min;
-    range[1] = max;
+    // The circle is a point enlarged by its radius. GJK only needs vertices,
+    // so the point can be stored as a polygon with a single vertex
+    ph_poly_t point;
+    point.vertex_count = 1;
+    point.vertices[0] = circle->pos;
+
+    return ph_toi(&point, poly, pv2_sub(circle_disp, poly_disp), circle->radius, toi);
 }
 
-static pfloat ph_axis_overlap(const ph_poly_t* poly_a,
-                                const ph_poly_t* poly_b,
-                                pv2 axis)
+bool ph_toi_poly_poly(const ph_poly_t* poly_a,
+                      pv2 disp_a,
+                      const ph_poly_t* poly_b,
+                      pv2 disp_b,
+                      ph_toi_t* toi)
+{
+    SAT_ASSERT(poly_a);
+    SAT_ASSERT(poly_b);
 
+    return ph_toi(poly_a, poly_b, pv2_sub(disp_a, disp_b), 0.0f, toi);
+}
+
+bool ph_sat_poly_poly_coherent(const ph_poly_t* poly_a,
+                               const ph_poly_t* poly_b,
+                               const ph_manifold_t* previous,
+                               ph_manifold_t* manifold)
 {
     SAT_ASSERT(poly_a);
     SAT_ASSERT(poly_b);
 
-    pfloat range_a[2];
-    pfloat range_b[2];
+    // The separating axis of the previous test is likely to still separate
+    if (previous)
+    {
+        ph_feature_t feature = previous->feature;
+        int index = previous->index;
 
-    // Get the ranges of polygons projected onto the axis vector
-    ph_axis_range(poly_a, axis, range_a);
-    ph_axis_range(poly_b, axis, range_b);
+        pfloat overlap = 1.0f;
 
-    // Ranges do not overlaps
-    if (range_a[1] < range_b[0] || range_b[1] < range_a[0])
-        return 0.0f;
+        if (feature == PH_FEATURE_EDGE_A && index >= 0 && index < poly_a->vertex_count)
+            overlap = ph_axis_overlap(poly_a, poly_b, poly_a->normals[index]);
+        else if (feature == PH_FEATURE_EDGE_B && index >= 0 && index < poly_b->vertex_count)
+            overlap = ph_axis_overlap(poly_b, poly_a, poly_b->normals[index]);
 
-    // Calculate overlap candidates
-    pfloat overlap1 = range_a[1] - range_b[0];
-    pfloat overlap2 = range_b[1] - range_a[0];
+        if (overlap == 0.0f)
+        {
+            ph_separating_feature(manifold, feature, index);
+            return false;
+        }
+    }
 
-    // Return the smaller overlap
-    return (overlap2 > overlap1) ? overlap1 : -overlap2;
+    return ph_sat_poly_poly(poly_a, poly_b, manifold);
 }
 
-static ph_voronoi_region_t ph_voronoi_region(pv2 point, pv2 line)
+ph_contact_cache_t* ph_contact_cache_create(void* mem_ctx)
 {
-    pfloat len2 = pv2_len2(line);
-    pfloat dot  = pv2_dot(point, line);
+    ph_contact_cache_t* cache = (ph_contact_cache_t*)PH_MALLOC(sizeof(ph_contact_cache_t), mem_ctx);
 
-    if (dot < 0.0f)                 // Point is to the left of the line
-        return PH_VORONOI_LEFT;
-    else if (dot > len2)            // Point is to the right of the line
-        return PH_VORONOI_RIGHT;
-    else
-        return PH_VORONOI_MIDDLE;  // Point is somewhere in the middle
+    if (!cache)
+        return NULL;
+
+    cache->mem_ctx    = mem_ctx;
+    cache->contacts   = NULL;
+    cache->count      = 0;
+    cache->capacity   = 0;
+    cache->slots      = NULL;
+    cache->slot_count = 0;
+
+    return cache;
+}
+
+void ph_contact_cache_destroy(ph_contact_cache_t* cache)
+{
+    SAT_ASSERT(cache);
+
+    if (cache->contacts)
+        PH_FREE(cache->contacts, cache->mem_ctx);
+
+    if (cache->slots)
+        PH_FREE(cache->slots, cache->mem_ctx);
+
+    PH_FREE(cache, cache->mem_ctx);
+}
+
+ph_contact_t* ph_contact_cache_get(ph_contact_cache_t* cache, int a, int b)
+{
+    SAT_ASSERT(cache);
+
+    if (cache->count == cache->capacity)
+    {
+        // Grow the contacts and the table of slots
+        cache->capacity = (cache->capacity > 0) ? cache->capacity * 2 : 16;
+        cache->slot_count = cache->capacity * 2;
+
+        cache->contacts = (ph_contact_t*)PH_REALLOC(cache->contacts,
+                                                    sizeof(ph_contact_t) * cache->capacity,
+                                                    cache->mem_ctx);
+
+        cache->slots = (int*)PH_REALLOC(cache->slots,
+                                        sizeof(int) * cache->slot_count,
+                                        cache->mem_ctx);
+
+        ph_contact_rehash(cache);
+    }
+
+    int slot = ph_contact_slot(cache, a, b);
+
+    if (cache->slots[slot] >= 0)
+    {
+        ph_contact_t* contact = &cache->contacts[cache->slots[slot]];
+        contact->used = true;
+        return contact;
+    }
+
+    cache->slots[slot] = cache->count;
+
+    ph_contact_t* contact = &cache->contacts[cache->count++];
+
+    contact->a = a;
+    contact->b = b;
+    ph_init_manifold(&contact->manifold);
+    contact->touching        = false;
+    contact->normal_impulse  = 0.0f;
+    contact->tangent_impulse = 0.0f;
+    contact->used            = true;
+
+    return contact;
+}
+
+void ph_contact_cache_prune(ph_contact_cache_t* cache)
+{
+    SAT_ASSERT(cache);
+
+    int count = 0;
+
+    // Compact the used contacts, which need to be used again to survive the
+    // next prune
+    for (int i = 0; i < cache->count; i++)
+    {
+        if (!cache->contacts[i].used)
+            continue;
+
+        cache->contacts[count] = cache->contacts[i];
+        cache->contacts[count].used = false;
+        count++;
+    }
+
+    if (count == cache->count)
+        return;
+
+    cache->count = count;
+
+    ph_contact_rehash(cache);
+}
+
+int ph_contact_cache_count(const ph_contact_cache_t* cache)
+{
+    SAT_ASSERT(cache);
+
+    return cache->count;
+}
+
+bool ph_contact_poly_poly(ph_contact_t* contact,
+                          const ph_poly_t* poly_a,
+                          const ph_poly_t* poly_b)
+{
+    SAT_ASSERT(contact);
+
+    ph_feature_t feature = contact->manifold.feature;
+    int index = contact->manifold.index;
+
+    bool hit = ph_sat_poly_poly_coherent(poly_a, poly_b, &contact->manifold, &contact->manifold);
+
+    // Impulses only apply to the same contact feature
+    if (!hit || !contact->touching ||
+        contact->manifold.feature != feature || contact->manifold.index != index)
+    {
+        contact->normal_impulse  = 0.0f;
+        contact->tangent_impulse = 0.0f;
+    }
+
+    contact->touching = hit;
+
+    return hit;
+}
+
+ph_broadphase_t* ph_broadphase_create(pfloat margin, void* mem_ctx)
+{
+    SAT_ASSERT(margin >= 0.0f);
+
+    ph_broadphase_t* bp = (ph_broadphase_t*)PH_MALLOC(sizeof(ph_broadphase_t), mem_ctx);
+
+    if (!bp)
+        return NULL;
+
+    bp->mem_ctx   = mem_ctx;
+    bp->margin    = margin;
+    bp->root      = PH_NULL_NODE;
+    bp->free_list = PH_NULL_NODE;
+    bp->capacity  = 0;
+    bp->nodes     = NULL;
+
+    return bp;
+}
+
+void ph_broadphase_destroy(ph_broadphase_t* bp)
+{
+    SAT_ASSERT(bp);
+
+    if (bp->nodes)
+        PH_FREE(bp->nodes, bp->mem_ctx);
+
+    PH_FREE(bp, bp->mem_ctx);
+}
+
+int ph_broadphase_insert(ph_broadphase_t* bp, const pb2* aabb, int value)
+{
+    SAT_ASSERT(bp);
+    SAT_ASSERT(aabb);
+
+    int leaf = ph_bp_alloc_node(bp);
+
+    ph_bp_node_t* node = &bp->nodes[leaf];
+
+    pv2 margin = pv2_make(bp->margin, bp->margin);
+
+    node->aabb   = pb2_make_minmax(pv2_sub(aabb->min, margin), pv2_add(aabb->max, margin));
+    node->child1 = PH_NULL_NODE;
+    node->child2 = PH_NULL_NODE;
+    node->height = 0;
+    node->value  = value;
+
+    ph_bp_insert_leaf(bp, leaf);
+
+    return leaf;
+}
+
+void ph_broadphase_remove(ph_broadphase_t* bp, int proxy)
+{
+    SAT_ASSERT(bp);
+    SAT_ASSERT(proxy >= 0 && proxy < bp->capacity);
+    SAT_ASSERT(bp->nodes[proxy].height == 0);
+
+    ph_bp_remove_leaf(bp, proxy);
+    ph_bp_free_node(bp, proxy);
+}
+
+bool ph_broadphase_move(ph_broadphase_t* bp, int proxy, const pb2* aabb)
+{
+    SAT_ASSERT(bp);
+    SAT_ASSERT(aabb);
+    SAT_ASSERT(proxy >= 0 && proxy < bp->capacity);
+    SAT_ASSERT(bp->nodes[proxy].height == 0);
+
+    ph_bp_node_t* node = &bp->nodes[proxy];
+
+    // Small movements are absorbed by the margin
+    if (pb2_contains(&node->aabb, aabb))
+        return false;
+
+    ph_bp_remove_leaf(bp, proxy);
+
+    pv2 margin = pv2_make(bp->margin, bp->margin);
+
+    node->aabb = pb2_make_minmax(pv2_sub(aabb->min, margin), pv2_add(aabb->max, margin));
+
+    ph_bp_insert_leaf(bp, proxy);
+
+    return true;
+}
+
+int ph_broadphase_find_pairs(const ph_broadphase_t* bp, ph_pair_t* pairs, int capacity)
+{
+    SAT_ASSERT(bp);
+    SAT_ASSERT(capacity >= 0);
+    SAT_ASSERT(pairs || 0 == capacity);
+
+    ph_bp_pairs_t result = { pairs, capacity, 0 };
+
+    if (bp->root != PH_NULL_NODE)
+        ph_bp_self_pairs(bp, bp->root, &result);
+
+    return result.count;
+}
+
+int ph_broadphase_query(const ph_broadphase_t* bp, const pb2* aabb, int* values, int capacity)
+{
+    SAT_ASSERT(bp);
+    SAT_ASSERT(aabb);
+    SAT_ASSERT(capacity >= 0);
+    SAT_ASSERT(values || 0 == capacity);
+
+    ph_bp_values_t result = { values, capacity, 0 };
+
+    if (bp->root != PH_NULL_NODE)
+        ph_bp_query_node(bp, bp->root, aabb, &result);
+
+    return result.count;
+}
+
+pb2 ph_poly_to_aabb(const ph_poly_t* poly)
+{
+    return pb2_enclosing(poly->vertices, poly->vertex_count);
+}
+
+pb2 ph_circle_to_aabb(const ph_circle_t* circle)
+{
+    pv2 half_radius = pv2_make(circle->radius / 2.0f, circle->radius / 2.0f);
+
+    pv2 min = pv2_sub(circle->pos, half_radius);
+    pv2 max = pv2_add(circle->pos, half_radius);
+
+    return pb2_make_minmax(min, max);
+}
+
+/*=============================================================================
+ * Internal function definitions
+ *============================================================================*/
+
+static void ph_init_manifold(ph_manifold_t* manifold)
+{
+    SAT_ASSERT(manifold);
+
+    manifold->overlap = PM_FLOAT_MAX;
+    manifold->normal  = pv2_zero();
+    manifold->vector  = pv2_zero();
+    manifold->feature = PH_FEATURE_NONE;
+    manifold->index   = -1;
+}
+
+static void ph_update_manifold(ph_manifold_t* manifold,
+                               pv2 normal,
+                               pfloat overlap,
+                               ph_feature_t feature,
+                               int index)
+{
+    SAT_ASSERT(manifold);
+
+    pfloat abs_overlap = pf_abs(overlap);
+
+    // Only update if the new overlap is smaller than the old one
+    if (abs_overlap < manifold->overlap)
+    {
+        // Update overlap (always positive)
+        manifold->overlap = abs_overlap;
+
+        // If the overlap is less that zero the normal must be reversed
+        if (overlap < 0.0f)
+            manifold->normal = pv2_reflect(normal);
+        else if (overlap > 0.0f)
+            manifold->normal = normal;
+
+        manifold->vector = pv2_scale(manifold->normal, manifold->overlap);
+
+        manifold->feature = feature;
+        manifold->index   = index;
+    }
+}
+
+static void ph_separating_feature(ph_manifold_t* manifold,
+                                  ph_feature_t feature,
+                                  int index)
+{
+    if (!manifold)
+        return;
+
+    // The rest of the manifold stays initialized
+    ph_init_manifold(manifold);
+
+    manifold->feature = feature;
+    manifold->index   = index;
+}
+
+static ph_feature_t ph_swap_feature(ph_feature_t feature)
+{
+    switch (feature)
+    {
+        case PH_FEATURE_EDGE_A:   return PH_FEATURE_EDGE_B;
+        case PH_FEATURE_EDGE_B:   return PH_FEATURE_EDGE_A;
+        case PH_FEATURE_VERTEX_A: return PH_FEATURE_VERTEX_B;
+        case PH_FEATURE_VERTEX_B: return PH_FEATURE_VERTEX_A;
+        default:                  return PH_FEATURE_NONE;
+    }
+}
+
+static void ph_circle_circle_manifold(pv2 diff,
+                                      pfloat dist2,
+                                      pfloat total_radius,
+                                      ph_manifold_t* manifold)
+{
+    SAT_ASSERT(manifold);
+
+    ph_init_manifold(manifold);
+
+    // Calculate distance because we need it now
+    pfloat dist = pf_sqrt(dist2);
+
+    // Calculate overlap
+    pfloat overlap = total_radius - dist;
+
+    // Normal direction is just circle_b relative to circle_a
+    pv2 normal = pv2_normalize(diff);
+
+    // Update manifold
+    ph_update_manifold(manifold, normal, overlap, PH_FEATURE_NONE, -1);
+}
+
+static void ph_aabb_aabb_manifold(const pb2* aabb_a,
+                                  const pb2* aabb_b,
+                                  ph_manifold_t* manifold)
+{
+    SAT_ASSERT(manifold);
+
+    // Overlaps of the ranges of the boxes along the x and y axises, in both
+    // directions
+    pfloat x1 = aabb_a->max.x - aabb_b->min.x;
+    pfloat x2 = aabb_b->max.x - aabb_a->min.x;
+    pfloat y1 = aabb_a->max.y - aabb_b->min.y;
+    pfloat y2 = aabb_b->max.y - aabb_a->min.y;
+
+    // `ph_sat_poly_poly` tests the normals of `ph_aabb_to_poly` in the order
+    // -x, +y, +x, -y and only replaces the manifold on a strictly smaller
+    // overlap, which decides the direction and edge in case of exact ties.
+    // Near ties may still be resolved differently, since the polygon's
+    // projections are rounded differently.
+    pfloat overlap_x = pf_min(x1, x2);
+    pfloat overlap_y = pf_min(y1, y2);
+
+    ph_init_manifold(manifold);
+
+    if (overlap_y < overlap_x)
+        ph_update_manifold(manifold, pv2_make(0.0f, (y2 > y1) ? 1.0f : -1.0f), overlap_y, PH_FEATURE_EDGE_A, 1);
+    else
+        ph_update_manifold(manifold, pv2_make((x1 > x2) ? -1.0f : 1.0f, 0.0f), overlap_x, PH_FEATURE_EDGE_A, 0);
+}
+
+static unsigned ph_circle_circle_mask4(const ph_circle_t* circles,
+                                       const ph_pair_t* pairs)
+{
+    const ph_circle_t* a0 = &circles[pairs[0].a];
+    const ph_circle_t* a1 = &circles[pairs[1].a];
+    const ph_circle_t* a2 = &circles[pairs[2].a];
+    const ph_circle_t* a3 = &circles[pairs[3].a];
+
+    const ph_circle_t* b0 = &circles[pairs[0].b];
+    const ph_circle_t* b1 = &circles[pairs[1].b];
+    const ph_circle_t* b2 = &circles[pairs[2].b];
+    const ph_circle_t* b3 = &circles[pairs[3].b];
+
+#if defined(PH_SIMD_SSE)
+
+    // Gather the pairs into one lane each
+    __m128 dx = _mm_sub_ps(_mm_setr_ps(b0->pos.x, b1->pos.x, b2->pos.x, b3->pos.x),
+                           _mm_setr_ps(a0->pos.x, a1->pos.x, a2->pos.x, a3->pos.x));
+
+    __m128 dy = _mm_sub_ps(_mm_setr_ps(b0->pos.y, b1->pos.y, b2->pos.y, b3->pos.y),
+                           _mm_setr_ps(a0->pos.y, a1->pos.y, a2->pos.y, a3->pos.y));
+
+    __m128 r = _mm_add_ps(_mm_setr_ps(a0->radius, a1->radius, a2->radius, a3->radius),
+                          _mm_setr_ps(b0->radius, b1->radius, b2->radius, b3->radius));
+
+    __m128 dist2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+
+    // Same as the negation of `dist2 >= total_radius2` in `ph_sat_circle_circle`
+    return (unsigned)_mm_movemask_ps(_mm_cmpnge_ps(dist2, _mm_mul_ps(r, r)));
+
+#elif defined(PH_SIMD_NEON)
+
+    float32x4_t ax = { a0->pos.x, a1->pos.x, a2->pos.x, a3->pos.x };
+    float32x4_t ay = { a0->pos.y, a1->pos.y, a2->pos.y, a3->pos.y };
+    float32x4_t bx = { b0->pos.x, b1->pos.x, b2->pos.x, b3->pos.x };
+    float32x4_t by = { b0->pos.y, b1->pos.y, b2->pos.y, b3->pos.y };
+    float32x4_t ra = { a0->radius, a1->radius, a2->radius, a3->radius };
+    float32x4_t rb = { b0->radius, b1->radius, b2->radius, b3->radius };
+
+    float32x4_t dx = vsubq_f32(bx, ax);
+    float32x4_t dy = vsubq_f32(by, ay);
+    float32x4_t r  = vaddq_f32(ra, rb);
+
+    float32x4_t dist2 = vaddq_f32(vmulq_f32(dx, dx), vmulq_f32(dy, dy));
+
+    uint32x4_t result = vmvnq_u32(vcgeq_f32(dist2, vmulq_f32(r, r)));
+
+    return (vgetq_lane_u32(result, 0) & 1) |
+           (vgetq_lane_u32(result, 1) & 2) |
+           (vgetq_lane_u32(result, 2) & 4) |
+           (vgetq_lane_u32(result, 3) & 8);
+
+#else
+
+    return (unsigned)ph_sat_circle_circle(a0, b0, NULL)        |
+           (unsigned)ph_sat_circle_circle(a1, b1, NULL) << 1   |
+           (unsigned)ph_sat_circle_circle(a2, b2, NULL) << 2   |
+           (unsigned)ph_sat_circle_circle(a3, b3, NULL) << 3;
+
+#endif
+}
+
+static unsigned ph_aabb_aabb_mask4(const pb2* aabbs, const ph_pair_t* pairs)
+{
+    const pb2* a0 = &aabbs[pairs[0].a];
+    const pb2* a1 = &aabbs[pairs[1].a];
+    const pb2* a2 = &aabbs[pairs[2].a];
+    const pb2* a3 = &aabbs[pairs[3].a];
+
+    const pb2* b0 = &aabbs[pairs[0].b];
+    const pb2* b1 = &aabbs[pairs[1].b];
+    const pb2* b2 = &aabbs[pairs[2].b];
+    const pb2* b3 = &aabbs[pairs[3].b];
+
+#if defined(PH_SIMD_SSE)
+
+    __m128 a_min_x = _mm_setr_ps(a0->min.x, a1->min.x, a2->min.x, a3->min.x);
+    __m128 a_min_y = _mm_setr_ps(a0->min.y, a1->min.y, a2->min.y, a3->min.y);
+    __m128 a_max_x = _mm_setr_ps(a0->max.x, a1->max.x, a2->max.x, a3->max.x);
+    __m128 a_max_y = _mm_setr_ps(a0->max.y, a1->max.y, a2->max.y, a3->max.y);
+
+    __m128 b_min_x = _mm_setr_ps(b0->min.x, b1->min.x, b2->min.x, b3->min.x);
+    __m128 b_min_y = _mm_setr_ps(b0->min.y, b1->min.y, b2->min.y, b3->min.y);
+    __m128 b_max_x = _mm_setr_ps(b0->max.x, b1->max.x, b2->max.x, b3->max.x);
+    __m128 b_max_y = _mm_setr_ps(b0->max.y, b1->max.y, b2->max.y, b3->max.y);
+
+    __m128 overlap_x = _mm_min_ps(_mm_sub_ps(a_max_x, b_min_x), _mm_sub_ps(b_max_x, a_min_x));
+    __m128 overlap_y = _mm_min_ps(_mm_sub_ps(a_max_y, b_min_y), _mm_sub_ps(b_max_y, a_min_y));
+
+    __m128 zero = _mm_setzero_ps();
+
+    return (unsigned)_mm_movemask_ps(_mm_and_ps(_mm_cmpgt_ps(overlap_x, zero),
+                                                _mm_cmpgt_ps(overlap_y, zero)));
+
+#elif defined(PH_SIMD_NEON)
+
+    float32x4_t a_min_x = { a0->min.x, a1->min.x, a2->min.x, a3->min.x };
+    float32x4_t a_min_y = { a0->min.y, a1->min.y, a2->min.y, a3->min.y };
+    float32x4_t a_max_x = { a0->max.x, a1->max.x, a2->max.x, a3->max.x };
+    float32x4_t a_max_y = { a0->max.y, a1->max.y, a2->max.y, a3->max.y };
+
+    float32x4_t b_min_x = { b0->min.x, b1->min.x, b2->min.x, b3->min.x };
+    float32x4_t b_min_y = { b0->min.y, b1->min.y, b2->min.y, b3->min.y };
+    float32x4_t b_max_x = { b0->max.x, b1->max.x, b2->max.x, b3->max.x };
+    float32x4_t b_max_y = { b0->max.y, b1->max.y, b2->max.y, b3->max.y };
+
+    float32x4_t overlap_x = vminq_f32(vsubq_f32(a_max_x, b_min_x), vsubq_f32(b_max_x, a_min_x));
+    float32x4_t overlap_y = vminq_f32(vsubq_f32(a_max_y, b_min_y), vsubq_f32(b_max_y, a_min_y));
+
+    float32x4_t zero = vdupq_n_f32(0.0f);
+
+    uint32x4_t result = vandq_u32(vcgtq_f32(overlap_x, zero), vcgtq_f32(overlap_y, zero));
+
+    return (vgetq_lane_u32(result, 0) & 1) |
+           (vgetq_lane_u32(result, 1) & 2) |
+           (vgetq_lane_u32(result, 2) & 4) |
+           (vgetq_lane_u32(result, 3) & 8);
+
+#else
+
+    return (unsigned)ph_sat_aabb_aabb(a0, b0, NULL)         |
+           (unsigned)ph_sat_aabb_aabb(a1, b1, NULL) << 1    |
+           (unsigned)ph_sat_aabb_aabb(a2, b2, NULL) << 2    |
+           (unsigned)ph_sat_aabb_aabb(a3, b3, NULL) << 3;
+
+#endif
+}
+
+static ph_slab_ray_t ph_make_slab_ray(const ph_ray_t* ray)
+{
+    ph_slab_ray_t slab;
+
+    slab.pos = ray->pos;
+
+    // A huge reciprocal instead of infinity keeps the products finite when
+    // the ray starts on a slab boundary
+    slab.inv_dir.x = (ray->dir.x != 0.0f) ? 1.0f / ray->dir.x : PM_FLOAT_MAX;
+    slab.inv_dir.y = (ray->dir.y != 0.0f) ? 1.0f / ray->dir.y : PM_FLOAT_MAX;
+
+    return slab;
+}
+
+static bool ph_ray_slab(const ph_slab_ray_t* ray, const pb2* aabb, pfloat max_dist)
+{
+    // Distances along the ray at which it crosses the slabs of the AABB
+    pfloat tx1 = (aabb->min.x - ray->pos.x) * ray->inv_dir.x;
+    pfloat tx2 = (aabb->max.x - ray->pos.x) * ray->inv_dir.x;
+    pfloat ty1 = (aabb->min.y - ray->pos.y) * ray->inv_dir.y;
+    pfloat ty2 = (aabb->max.y - ray->pos.y) * ray->inv_dir.y;
+
+    pfloat t_enter = pf_max(pf_max(pf_min(tx1, tx2), pf_min(ty1, ty2)), 0.0f);
+    pfloat t_exit  = pf_min(pf_min(pf_max(tx1, tx2), pf_max(ty1, ty2)), max_dist);
+
+    return t_enter <= t_exit;
+}
+
+static unsigned ph_ray_slab4(const ph_slab_ray_t* ray, const pb2* aabbs, pfloat max_dist)
+{
+#if defined(PH_SIMD_SSE)
+
+    // Each AABB is four consecutive floats, transposing yields the columns
+    __m128 min_x = _mm_loadu_ps(&aabbs[0].min.x);
+    __m128 min_y = _mm_loadu_ps(&aabbs[1].min.x);
+    __m128 max_x = _mm_loadu_ps(&aabbs[2].min.x);
+    __m128 max_y = _mm_loadu_ps(&aabbs[3].min.x);
+
+    _MM_TRANSPOSE4_PS(min_x, min_y, max_x, max_y);
+
+    __m128 pos_x = _mm_set1_ps(ray->pos.x);
+    __m128 pos_y = _mm_set1_ps(ray->pos.y);
+    __m128 inv_x = _mm_set1_ps(ray->inv_dir.x);
+    __m128 inv_y = _mm_set1_ps(ray->inv_dir.y);
+
+    __m128 tx1 = _mm_mul_ps(_mm_sub_ps(min_x, pos_x), inv_x);
+    __m128 tx2 = _mm_mul_ps(_mm_sub_ps(max_x, pos_x), inv_x);
+    __m128 ty1 = _mm_mul_ps(_mm_sub_ps(min_y, pos_y), inv_y);
+    __m128 ty2 = _mm_mul_ps(_mm_sub_ps(max_y, pos_y), inv_y);
+
+    __m128 t_enter = _mm_max_ps(_mm_max_ps(_mm_min_ps(tx1, tx2), _mm_min_ps(ty1, ty2)), _mm_setzero_ps());
+    __m128 t_exit  = _mm_min_ps(_mm_min_ps(_mm_max_ps(tx1, tx2), _mm_max_ps(ty1, ty2)), _mm_set1_ps(max_dist));
+
+    return (unsigned)_mm_movemask_ps(_mm_cmple_ps(t_enter, t_exit));
+
+#elif defined(PH_SIMD_NEON)
+
+    // Loading interleaved structures yields the columns directly
+    float32x4x4_t columns = vld4q_f32(&aabbs[0].min.x);
+
+    float32x4_t pos_x = vdupq_n_f32(ray->pos.x);
+    float32x4_t pos_y = vdupq_n_f32(ray->pos.y);
+    float32x4_t inv_x = vdupq_n_f32(ray->inv_dir.x);
+    float32x4_t inv_y = vdupq_n_f32(ray->inv_dir.y);
+
+    float32x4_t tx1 = vmulq_f32(vsubq_f32(columns.val[0], pos_x), inv_x);
+    float32x4_t ty1 = vmulq_f32(vsubq_f32(columns.val[1], pos_y), inv_y);
+    float32x4_t tx2 = vmulq_f32(vsubq_f32(columns.val[2], pos_x), inv_x);
+    float32x4_t ty2 = vmulq_f32(vsubq_f32(columns.val[3], pos_y), inv_y);
+
+    float32x4_t t_enter = vmaxq_f32(vmaxq_f32(vminq_f32(tx1, tx2), vminq_f32(ty1, ty2)), vdupq_n_f32(0.0f));
+    float32x4_t t_exit  = vminq_f32(vminq_f32(vmaxq_f32(tx1, tx2), vmaxq_f32(ty1, ty2)), vdupq_n_f32(max_dist));
+
+    uint32x4_t result = vcleq_f32(t_enter, t_exit);
+
+    return (vgetq_lane_u32(result, 0) & 1) |
+           (vgetq_lane_u32(result, 1) & 2) |
+           (vgetq_lane_u32(result, 2) & 4) |
+           (vgetq_lane_u32(result, 3) & 8);
+
+#else
+
+    return (unsigned)ph_ray_slab(ray, &aabbs[0], max_dist)       |
+           (unsigned)ph_ray_slab(ray, &aabbs[1], max_dist) << 1  |
+           (unsigned)ph_ray_slab(ray, &aabbs[2], max_dist) << 2  |
+           (unsigned)ph_ray_slab(ray, &aabbs[3], max_dist) << 3;
+
+#endif
+}
+
+static bool ph_ray_record(const ph_ray_t* ray,
+                          bool hit,
+                          const ph_raycast_t* candidate,
+                          int index,
+                          int* closest,
+                          ph_raycast_t* raycast)
+{
+    if (!hit)
+        return false;
+
+    // Without a candidate the hit is known to be within the length of the ray
+    if (candidate && candidate->dist > ray->dist)
+        return false;
+
+    // Ties go to the first shape
+    if (raycast && *closest >= 0 && candidate->dist >= raycast->dist)
+        return false;
+
+    *closest = index;
+
+    if (raycast)
+        *raycast = *candidate;
+
+    return true;
+}
+
+static void ph_batch_result(int i,
+                            bool hit,
+                            bool* hits,
+                            ph_manifold_t* manifolds)
+{
+    if (hits)
+        hits[i] = hit;
+
+    // Misses get an initialized manifold, just like the single pair tests
+    if (manifolds && !hit)
+        ph_init_manifold(&manifolds[i]);
+}
+
+static void ph_axis_range(const ph_poly_t* poly, pv2 normal, pfloat range[2])
+{
+    SAT_ASSERT(poly);
+    SAT_ASSERT(range);
+
+    pfloat dot = pv2_dot(poly->vertices[0], normal);
+    pfloat min = dot;
+    pfloat max = dot;
+
+    // Find the minimum and maximum distance of the polygon along the normal
+    for (int i = 1; i < poly->vertex_count; i++)
+    {
+        dot = pv2_dot(poly->vertices[i], normal);
+
+        if (dot < min)
+            min = dot;
+
+        if (dot > max)
+            max = dot;
+    }
+
+    // The range defines the interval induced by the polygon projected onto the
+    // normal vector
+    range[0] = min;
+    range[1] = max;
+}
+
+static pfloat ph_axis_overlap(const ph_poly_t* poly_a,
+                                const ph_poly_t* poly_b,
+                                pv2 axis)
+
+{
+    SAT_ASSERT(poly_a);
+    SAT_ASSERT(poly_b);
+
+    pfloat range_a[2];
+    pfloat range_b[2];
+
+    // Get the ranges of polygons projected onto the axis vector
+    ph_axis_range(poly_a, axis, range_a);
+    ph_axis_range(poly_b, axis, range_b);
+
+    return ph_range_overlap(range_a, range_b);
+}
+
+static pfloat ph_range_overlap(const pfloat range_a[2], const pfloat range_b[2])
+{
+    // Ranges do not overlaps
+    if (range_a[1] < range_b[0] || range_b[1] < range_a[0])
+        return 0.0f;
+
+    // Calculate overlap candidates
+    pfloat overlap1 = range_a[1] - range_b[0];
+    pfloat overlap2 = range_b[1] - range_a[0];
+
+    // Return the smaller overlap
+    return (overlap2 > overlap1) ? overlap1 : -overlap2;
+}
+
+static bool ph_cached_axes_overlap(const ph_poly_cache_t* cache,
+                                   const ph_poly_t* poly,
+                                   ph_feature_t feature,
+                                   ph_manifold_t* manifold)
+{
+    const ph_poly_t* cached = &cache->poly;
+
+    for (int i = 0; i < cached->vertex_count; i++)
+    {
+        // Only the other polygon needs to be projected
+        pfloat range[2];
+        ph_axis_range(poly, cached->normals[i], range);
+
+        pfloat overlap = ph_range_overlap(cache->ranges[i], range);
+
+        // Axis is separating, polygons do not overlap
+        if (overlap == 0.0f)
+        {
+            ph_separating_feature(manifold, feature, i);
+            return false;
+        }
+
+        if (manifold)
+            ph_update_manifold(manifold, cached->normals[i], overlap, feature, i);
+    }
+
+    return true;
+}
+
+static int ph_support(const ph_poly_t* poly, pv2 dir)
+{
+    int index = 0;
+    pfloat max_dot = pv2_dot(poly->vertices[0], dir);
+
+    for (int i = 1; i < poly->vertex_count; i++)
+    {
+        pfloat dot = pv2_dot(poly->vertices[i], dir);
+
+        if (dot > max_dot)
+        {
+            index = i;
+            max_dot = dot;
+        }
+    }
+
+    return index;
+}
+
+static ph_gjk_vertex_t ph_gjk_make_vertex(const ph_poly_t* poly_a,
+                                          const ph_poly_t* poly_b,
+                                          int index_a,
+                                          int index_b)
+{
+    ph_gjk_vertex_t vertex;
+
+    vertex.point   = pv2_sub(poly_a->vertices[index_a], poly_b->vertices[index_b]);
+    vertex.u       = 1.0f;
+    vertex.index_a = index_a;
+    vertex.index_b = index_b;
+
+    return vertex;
+}
+
+static void ph_gjk_solve2(ph_gjk_t* gjk)
+{
+    ph_gjk_vertex_t* v = gjk->vertices;
+
+    pv2 w1 = v[0].point;
+    pv2 w2 = v[1].point;
+    pv2 e12 = pv2_sub(w2, w1);
+
+    // The origin is beyond w1
+    pfloat d12_2 = -pv2_dot(w1, e12);
+
+    if (d12_2 <= 0.0f)
+    {
+        v[0].u = 1.0f;
+        gjk->count = 1;
+        return;
+    }
+
+    // The origin is beyond w2
+    pfloat d12_1 = pv2_dot(w2, e12);
+
+    if (d12_1 <= 0.0f)
+    {
+        v[0] = v[1];
+        v[0].u = 1.0f;
+        gjk->count = 1;
+        return;
+    }
+
+    // The origin projects onto the segment
+    pfloat inv = 1.0f / (d12_1 + d12_2);
+
+    v[0].u = d12_1 * inv;
+    v[1].u = d12_2 * inv;
+    gjk->count = 2;
+}
+
+static void ph_gjk_solve3(ph_gjk_t* gjk)
+{
+    ph_gjk_vertex_t* v = gjk->vertices;
+
+    pv2 w1 = v[0].point;
+    pv2 w2 = v[1].point;
+    pv2 w3 = v[2].point;
+
+    // Barycentric coordinates of the origin on each edge
+    pv2 e12 = pv2_sub(w2, w1);
+    pfloat d12_1 =  pv2_dot(w2, e12);
+    pfloat d12_2 = -pv2_dot(w1, e12);
+
+    pv2 e13 = pv2_sub(w3, w1);
+    pfloat d13_1 =  pv2_dot(w3, e13);
+    pfloat d13_2 = -pv2_dot(w1, e13);
+
+    pv2 e23 = pv2_sub(w3, w2);
+    pfloat d23_1 =  pv2_dot(w3, e23);
+    pfloat d23_2 = -pv2_dot(w2, e23);
+
+    // Barycentric coordinates of the origin on the triangle
+    pfloat n123 = pv2_cross(e12, e13);
+
+    pfloat d123_1 = n123 * pv2_cross(w2, w3);
+    pfloat d123_2 = n123 * pv2_cross(w3, w1);
+    pfloat d123_3 = n123 * pv2_cross(w1, w2);
+
+    // w1 region
+    if (d12_2 <= 0.0f && d13_2 <= 0.0f)
+    {
+        v[0].u = 1.0f;
+        gjk->count = 1;
+        return;
+    }
+
+    // Unlike the vertex regions, the edge regions exclude the edges, so that an
+    // origin on the boundary of the triangle is contained in it
+
+    // e12 region
+    if (d12_1 > 0.0f && d12_2 > 0.0f && d123_3 < 0.0f)
+    {
+        pfloat inv = 1.0f / (d12_1 + d12_2);
+
+        v[0].u = d12_1 * inv;
+        v[1].u = d12_2 * inv;
+        gjk->count = 2;
+        return;
+    }
+
+    // e13 region
+    if (d13_1 > 0.0f && d13_2 > 0.0f && d123_2 < 0.0f)
+    {
+        pfloat inv = 1.0f / (d13_1 + d13_2);
+
+        v[0].u = d13_1 * inv;
+        v[2].u = d13_2 * inv;
+        v[1] = v[2];
+        gjk->count = 2;
+        return;
+    }
+
+    // w2 region
+    if (d12_1 <= 0.0f && d23_2 <= 0.0f)
+    {
+        v[0] = v[1];
+        v[0].u = 1.0f;
+        gjk->count = 1;
+        return;
+    }
+
+    // w3 region
+    if (d13_1 <= 0.0f && d23_1 <= 0.0f)
+    {
+        v[0] = v[2];
+        v[0].u = 1.0f;
+        gjk->count = 1;
+        return;
+    }
+
+    // e23 region
+    if (d23_1 > 0.0f && d23_2 > 0.0f && d123_1 < 0.0f)
+    {
+        pfloat inv = 1.0f / (d23_1 + d23_2);
+
+        v[1].u = d23_1 * inv;
+        v[2].u = d23_2 * inv;
+        v[0] = v[2];
+        gjk->count = 2;
+        return;
+    }
+
+    // The origin is inside the triangle (the barycentric coordinates are not
+    // needed)
+    gjk->count = 3;
+}
+
+static pv2 ph_gjk_closest(const ph_gjk_t* gjk)
+{
+    const ph_gjk_vertex_t* v = gjk->vertices;
+
+    switch (gjk->count)
+    {
+        case 1:
+            return v[0].point;
+
+        case 2:
+            return pv2_add(pv2_scale(v[0].point, v[0].u),
+                           pv2_scale(v[1].point, v[1].u));
+
+        default:
+            return pv2_zero();
+    }
+}
+
+static bool ph_gjk(const ph_poly_t* poly_a,
+                   const ph_poly_t* poly_b,
+                   ph_simplex_t* simplex,
+                   ph_gjk_t* gjk)
+{
+    SAT_ASSERT(poly_a->vertex_count > 0);
+    SAT_ASSERT(poly_b->vertex_count > 0);
+
+    ph_gjk_vertex_t* v = gjk->vertices;
+
+    gjk->count = 0;
+
+    // Warm start from the previous simplex, provided it is still valid
+    if (simplex)
+    {
+        SAT_ASSERT(simplex->count >= 0 && simplex->count <= 3);
+
+        for (int i = 0; i < simplex->count; i++)
+        {
+            int index_a = simplex->index_a[i];
+            int index_b = simplex->index_b[i];
+
+            if (index_a < 0 || index_a >= poly_a->vertex_count ||
+                index_b < 0 || index_b >= poly_b->vertex_count)
+            {
+                gjk->count = 0;
+                break;
+            }
+
+            v[gjk->count++] = ph_gjk_make_vertex(poly_a, poly_b, index_a, index_b);
+        }
+
+        // The polygons may have moved since, so that the simplex collapsed
+        if (gjk->count == 2 &&
+            pv2_len2(pv2_sub(v[1].point, v[0].point)) < PM_EPSILON * PM_EPSILON)
+        {
+            gjk->count = 0;
+        }
+
+        if (gjk->count == 3 &&
+            pf_abs(pv2_cross(pv2_sub(v[1].point, v[0].point),
+                             pv2_sub(v[2].point, v[0].point))) < PM_EPSILON)
+        {
+            gjk->count = 0;
+        }
+    }
+
+    if (gjk->count == 0)
+    {
+        v[0] = ph_gjk_make_vertex(poly_a, poly_b, 0, 0);
+        gjk->count = 1;
+    }
+
+    bool overlap = false;
+
+    for (int iteration = 0; iteration < PH_GJK_MAX_ITERATIONS; iteration++)
+    {
+        // Remember the vertices, so that cycles can be detected
+        int saved_count = gjk->count;
+        int saved_a[3], saved_b[3];
+
+        for (int i = 0; i < saved_count; i++)
+        {
+            saved_a[i] = v[i].index_a;
+            saved_b[i] = v[i].index_b;
+        }
+
+        if (gjk->count == 2)
+            ph_gjk_solve2(gjk);
+        else if (gjk->count == 3)
+            ph_gjk_solve3(gjk);
+
+        // The simplex contains the origin, unless it is flat, in which case the
+        // polygons only touch
+        if (gjk->count == 3)
+        {
+            overlap = pf_abs(pv2_cross(pv2_sub(v[1].point, v[0].point),
+                                       pv2_sub(v[2].point, v[0].point))) >= PM_EPSILON;
+            break;
+        }
+
+        // Search towards the origin
+        pv2 dir;
+
+        if (gjk->count == 1)
+        {
+            dir = pv2_reflect(v[0].point);
+        }
+        else
+        {
+            pv2 e12 = pv2_sub(v[1].point, v[0].point);
+
+            dir = pv2_perp(e12);
+
+            if (pv2_cross(e12, pv2_reflect(v[0].point)) <= 0.0f)
+                dir = pv2_reflect(dir);
+        }
+
+        // The origin is on the simplex, so the polygons only touch
+        if (pv2_len2(dir) < PM_EPSILON * PM_EPSILON)
+            break;
+
+        int index_a = ph_support(poly_a, dir);
+        int index_b = ph_support(poly_b, pv2_reflect(dir));
+
+        // No progress can be made
+        bool duplicate = false;
+
+        for (int i = 0; i < saved_count; i++)
+        {
+            if (saved_a[i] == index_a && saved_b[i] == index_b)
+            {
+                duplicate = true;
+                break;
+            }
+        }
+
+        // Stopping before the new vertex is added keeps the simplex solved
+        if (duplicate || iteration == PH_GJK_MAX_ITERATIONS - 1)
+            break;
+
+        v[gjk->count++] = ph_gjk_make_vertex(poly_a, poly_b, index_a, index_b);
+    }
+
+    if (simplex)
+    {
+        simplex->count = gjk->count;
+
+        for (int i = 0; i < gjk->count; i++)
+        {
+            simplex->index_a[i] = v[i].index_a;
+            simplex->index_b[i] = v[i].index_b;
+        }
+    }
+
+    return overlap;
+}
+
+static void ph_epa(const ph_poly_t* poly_a,
+                   const ph_poly_t* poly_b,
+                   const ph_gjk_t* gjk,
+                   ph_manifold_t* manifold)
+{
+    SAT_ASSERT(gjk->count == 3);
+
+    // The polytope, using CCW winding
+    ph_gjk_vertex_t polytope[PH_EPA_MAX_VERTS];
+    int count = 3;
+
+    for (int i = 0; i < 3; i++)
+    {
+        polytope[i] = gjk->vertices[i];
+    }
+
+    if (pv2_cross(pv2_sub(polytope[1].point, polytope[0].point),
+                  pv2_sub(polytope[2].point, polytope[0].point)) < 0.0f)
+    {
+        ph_gjk_vertex_t vertex = polytope[1];
+        polytope[1] = polytope[2];
+        polytope[2] = vertex;
+    }
+
+    pv2 normal = pv2_zero();
+    pfloat dist = PM_FLOAT_MAX;
+    int edge = 0;
+
+    while (true)
+    {
+        // Find the edge closest to the origin
+        edge = 0;
+
+        normal = pv2_zero();
+        dist = PM_FLOAT_MAX;
+
+        for (int i = 0; i < count; i++)
+        {
+            int j = (i + 1 == count) ? 0 : i + 1;
+
+            pv2 e = pv2_sub(polytope[j].point, polytope[i].point);
+
+            // Outward normal of a CCW edge
+            pv2 n = pv2_normalize(pv2_make(e.y, -e.x));
+
+            pfloat d = pv2_dot(n, polytope[i].point);
+
+            if (d < dist)
+            {
+                edge = i;
+                normal = n;
+                dist = d;
+            }
+        }
+
+        // The edge is on the boundary of the Minkowski difference if the
+        // support point along its normal does not lie further out, or is
+        // already part of the polytope
+        int index_a = ph_support(poly_a, normal);
+        int index_b = ph_support(poly_b, pv2_reflect(normal));
+
+        ph_gjk_vertex_t vertex = ph_gjk_make_vertex(poly_a, poly_b, index_a, index_b);
+
+        if (pv2_dot(vertex.point, normal) - dist <= PM_EPSILON * (1.0f + dist) ||
+            count == PH_EPA_MAX_VERTS)
+        {
+            break;
+        }
+
+        bool duplicate = false;
+
+        for (int i = 0; i < count; i++)
+        {
+            if (polytope[i].index_a == index_a && polytope[i].index_b == index_b)
+            {
+                duplicate = true;
+                break;
+            }
+        }
+
+        if (duplicate)
+            break;
+
+        // Insert the support point into the closest edge
+        int k = edge + 1;
+
+        for (int i = count; i > k; i--)
+        {
+            polytope[i] = polytope[i - 1];
+        }
+
+        polytope[k] = vertex;
+        count++;
+
+        // The vertices found by GJK need not be vertices of the Minkowski
+        // difference. Removing those that the new vertex makes concave keeps
+        // the polytope convex
+        while (count > 3)
+        {
+            int prev  = (k + count - 1) % count;
+            int prev2 = (k + count - 2) % count;
+
+            if (pv2_cross(pv2_sub(polytope[prev].point, polytope[prev2].point),
+                          pv2_sub(polytope[k].point, polytope[prev].point)) > 0.0f)
+            {
+                break;
+            }
+
+            k = ph_epa_remove(polytope, count--, prev, k);
+        }
+
+        while (count > 3)
+        {
+            int next  = (k + 1) % count;
+            int next2 = (k + 2) % count;
+
+            if (pv2_cross(pv2_sub(polytope[next].point, polytope[k].point),
+                          pv2_sub(polytope[next2].point, polytope[next].point)) > 0.0f)
+            {
+                break;
+            }
+
+            k = ph_epa_remove(polytope, count--, next, k);
+        }
+    }
+
+    manifold->normal  = normal;
+    manifold->overlap = dist;
+    manifold->vector  = pv2_scale(normal, dist);
+
+    // An edge of the Minkowski difference that shares the vertex of one
+    // polygon is an edge of the other polygon
+    const ph_gjk_vertex_t* v1 = &polytope[edge];
+    const ph_gjk_vertex_t* v2 = &polytope[(edge + 1 == count) ? 0 : edge + 1];
+
+    int next_a = (v1->index_a + 1 == poly_a->vertex_count) ? 0 : v1->index_a + 1;
+    int next_b = (v1->index_b + 1 == poly_b->vertex_count) ? 0 : v1->index_b + 1;
+
+    if (v1->index_b == v2->index_b && v2->index_a == next_a)
+    {
+        manifold->feature = PH_FEATURE_EDGE_A;
+        manifold->index   = v1->index_a;
+    }
+    else if (v1->index_a == v2->index_a && v2->index_b == next_b)
+    {
+        manifold->feature = PH_FEATURE_EDGE_B;
+        manifold->index   = v1->index_b;
+    }
+    else
+    {
+        manifold->feature = PH_FEATURE_NONE;
+        manifold->index   = -1;
+    }
+}
+
+static int ph_epa_remove(ph_gjk_vertex_t* polytope, int count, int index, int k)
+{
+    for (int i = index; i < count - 1; i++)
+    {
+        polytope[i] = polytope[i + 1];
+    }
+
+    return (index < k) ? k - 1 : k;
+}
+
+static bool ph_toi(const ph_poly_t* poly_a,
+                   const ph_poly_t* poly_b,
+                   pv2 motion,
+                   pfloat radius,
+                   ph_toi_t* toi)
+{
+    ph_simplex_t simplex;
+    ph_simplex_init(&simplex);
+
+    ph_poly_t moved = *poly_a;
+
+    pfloat time = 0.0f;
+
+    for (int iteration = 0; iteration < PH_TOI_MAX_ITERATIONS; iteration++)
+    {
+        // Only the vertices are used by GJK and EPA
+        pv2 offset = pv2_scale(motion, time);
+
+        for (int i = 0; i < poly_a->vertex_count; i++)
+        {
+            moved.vertices[i] = pv2_add(poly_a->vertices[i], offset);
+        }
+
+        ph_gjk_t gjk;
+
+        // Since the search is conservative, this can only happen at the start
+        if (ph_gjk(&moved, poly_b, &simplex, &gjk))
+        {
+            if (toi)
+            {
+                ph_manifold_t manifold;
+                ph_epa(&moved, poly_b, &gjk, &manifold);
+
+                toi->time = time;
+                toi->normal = manifold.normal;
+            }
+
+            return true;
+        }
+
+        // Closest point on the Minkowski difference, which points from the
+        // second polygon to the first
+        pv2 closest = ph_gjk_closest(&gjk);
+        pfloat len = pv2_len(closest);
+        pfloat dist = len - radius;
+
+        // Direction from the first shape to the second
+        pv2 normal = (len > PM_EPSILON) ? pv2_scale(closest, -1.0f / len)
+                                        : pv2_normalize(motion);
+
+        if (dist <= PH_TOI_TOLERANCE)
+        {
+            if (toi)
+            {
+                toi->time = time;
+                toi->normal = normal;
+            }
+
+            return true;
+        }
+
+        // Rate at which the distance decreases
+        pfloat speed = pv2_dot(normal, motion);
+
+        // The distance is convex in time, so it never decreases again
+        if (speed <= 0.0f)
+            return false;
+
+        // Newton step on a convex function, which does not pass the root
+        time += dist / speed;
+
+        if (time > 1.0f)
+            return false;
+    }
+
+    // Running out of steps reports a conservative impact
+    if (toi)
+    {
+        toi->time = time;
+        toi->normal = pv2_normalize(motion);
+    }
+
+    return true;
+}
+
+static unsigned ph_pair_hash(int a, int b)
+{
+    unsigned hash = (unsigned)a * 0x9E3779B1u ^ (unsigned)b * 0x85EBCA77u;
+
+    // Mix the high bits into the low bits used by the table
+    hash ^= hash >> 15;
+    hash *= 0x2C1B3C6Du;
+    hash ^= hash >> 12;
+
+    return hash;
+}
+
+static int ph_contact_slot(const ph_contact_cache_t* cache, int a, int b)
+{
+    unsigned mask = (unsigned)cache->slot_count - 1;
+    unsigned slot = ph_pair_hash(a, b) & mask;
+
+    // Linear probing, the table is never more than half full
+    while (cache->slots[slot] >= 0)
+    {
+        const ph_contact_t* contact = &cache->contacts[cache->slots[slot]];
+
+        if (contact->a == a && contact->b == b)
+            break;
+
+        slot = (slot + 1) & mask;
+    }
+
+    return (int)slot;
+}
+
+static void ph_contact_rehash(ph_contact_cache_t* cache)
+{
+    for (int i = 0; i < cache->slot_count; i++)
+    {
+        cache->slots[i] = -1;
+    }
+
+    for (int i = 0; i < cache->count; i++)
+    {
+        const ph_contact_t* contact = &cache->contacts[i];
+
+        cache->slots[ph_contact_slot(cache, contact->a, contact->b)] = i;
+    }
+}
+
+static ph_voronoi_region_t ph_voronoi_region(pv2 point, pv2 line)
+{
+    pfloat len2 = pv2_len2(line);
+    pfloat dot  = pv2_dot(point, line);
+
+    if (dot < 0.0f)                 // Point is to the left of the line
+        return PH_VORONOI_LEFT;
+    else if (dot > len2)            // Point is to the right of the line
+        return PH_VORONOI_RIGHT;
+    else
+        return PH_VORONOI_MIDDLE;  // Point is somewhere in the middle
+}
+
+static int ph_bp_alloc_node(ph_broadphase_t* bp)
+{
+    if (bp->free_list == PH_NULL_NODE)
+    {
+        // Grow the pool and chain the new nodes into the free list
+        int old_capacity = bp->capacity;
+        int new_capacity = (old_capacity > 0) ? old_capacity * 2 : 16;
+
+        bp->nodes = (ph_bp_node_t*)PH_REALLOC(bp->nodes,
+                                              sizeof(ph_bp_node_t) * new_capacity,
+                                              bp->mem_ctx);
+
+        for (int i = old_capacity; i < new_capacity; i++)
+        {
+            bp->nodes[i].parent = (i + 1 < new_capacity) ? i + 1 : PH_NULL_NODE;
+            bp->nodes[i].height = -1;
+        }
+
+        bp->capacity  = new_capacity;
+        bp->free_list = old_capacity;
+    }
+
+    int node = bp->free_list;
+
+    bp->free_list = bp->nodes[node].parent;
+
+    bp->nodes[node].parent = PH_NULL_NODE;
+    bp->nodes[node].child1 = PH_NULL_NODE;
+    bp->nodes[node].child2 = PH_NULL_NODE;
+    bp->nodes[node].height = 0;
+    bp->nodes[node].value  = 0;
+
+    return node;
+}
+
+static void ph_bp_free_node(ph_broadphase_t* bp, int node)
+{
+    SAT_ASSERT(node >= 0 && node < bp->capacity);
+
+    bp->nodes[node].parent = bp->free_list;
+    bp->nodes[node].height = -1;
+
+    bp->free_list = node;
+}
+
+static void ph_bp_insert_leaf(ph_broadphase_t* bp, int leaf)
+{
+    ph_bp_node_t* nodes = bp->nodes;
+
+    if (bp->root == PH_NULL_NODE)
+    {
+        bp->root = leaf;
+        nodes[leaf].parent = PH_NULL_NODE;
+        return;
+    }
+
+    // Descend towards the sibling for which the insertion increases the total
+    // perimeter of the tree the least
+    pb2 leaf_aabb = nodes[leaf].aabb;
+
+    int index = bp->root;
+
+    while (nodes[index].height > 0)
+    {
+        int child1 = nodes[index].child1;
+        int child2 = nodes[index].child2;
+
+        pb2 combined = pb2_combine(&nodes[index].aabb, &leaf_aabb);
+
+        pfloat perimeter = ph_perimeter(&nodes[index].aabb);
+        pfloat combined_perimeter = ph_perimeter(&combined);
+
+        // Cost of creating a new parent for this node and the leaf
+        pfloat cost = 2.0f * combined_perimeter;
+
+        // Minimum cost of pushing the leaf further down the tree
+        pfloat inheritance_cost = 2.0f * (combined_perimeter - perimeter);
+
+        pfloat child_costs[2];
+        int children[2] = { child1, child2 };
+
+        for (int i = 0; i < 2; i++)
+        {
+            const ph_bp_node_t* child = &nodes[children[i]];
+
+            pb2 aabb = pb2_combine(&leaf_aabb, &child->aabb);
+
+            if (child->height == 0)
+                child_costs[i] = ph_perimeter(&aabb) + inheritance_cost;
+            else
+                child_costs[i] = ph_perimeter(&aabb) - ph_perimeter(&child->aabb) + inheritance_cost;
+        }
+
+        if (cost < child_costs[0] && cost < child_costs[1])
+            break;
+
+        index = (child_costs[0] < child_costs[1]) ? child1 : child2;
+    }
+
+    int sibling = index;
+
+    // Create a new parent for the leaf and its sibling
+    int old_parent = nodes[sibling].parent;
+    int new_parent = ph_bp_alloc_node(bp);
+
+    // The pool may have moved
+    nodes = bp->nodes;
+
+    nodes[new_parent].parent = old_parent;
+    nodes[new_parent].aabb   = pb2_combine(&leaf_aabb, &nodes[sibling].aabb);
+    nodes[new_parent].height = nodes[sibling].height + 1;
+    nodes[new_parent].child1 = sibling;
+    nodes[new_parent].child2 = leaf;
+
+    nodes[sibling].parent = new_parent;
+    nodes[leaf].parent = new_parent;
+
+    if (old_parent != PH_NULL_NODE)
+    {
+        if (nodes[old_parent].child1 == sibling)
+            nodes[old_parent].child1 = new_parent;
+        else
+            nodes[old_parent].child2 = new_parent;
+    }
+    else
+    {
+        bp->root = new_parent;
+    }
+
+    ph_bp_refit(bp, nodes[leaf].parent);
+}
+
+static void ph_bp_remove_leaf(ph_broadphase_t* bp, int leaf)
+{
+    ph_bp_node_t* nodes = bp->nodes;
+
+    if (leaf == bp->root)
+    {
+        bp->root = PH_NULL_NODE;
+        return;
+    }
+
+    // The sibling takes the place of the parent
+    int parent = nodes[leaf].parent;
+    int grand_parent = nodes[parent].parent;
+    int sibling = (nodes[parent].child1 == leaf) ? nodes[parent].child2 : nodes[parent].child1;
+
+    if (grand_parent != PH_NULL_NODE)
+    {
+        if (nodes[grand_parent].child1 == parent)
+            nodes[grand_parent].child1 = sibling;
+        else
+            nodes[grand_parent].child2 = sibling;
+
+        nodes[sibling].parent = grand_parent;
+
+        ph_bp_free_node(bp, parent);
+        ph_bp_refit(bp, grand_parent);
+    }
+    else
+    {
+        bp->root = sibling;
+        nodes[sibling].parent = PH_NULL_NODE;
+
+        ph_bp_free_node(bp, parent);
+    }
+}
+
+static void ph_bp_refit(ph_broadphase_t* bp, int index)
+{
+    ph_bp_node_t* nodes = bp->nodes;
+
+    while (index != PH_NULL_NODE)
+    {
+        index = ph_bp_balance(bp, index);
+
+        int child1 = nodes[index].child1;
+        int child2 = nodes[index].child2;
+
+        nodes[index].height = 1 + ph_max(nodes[child1].height, nodes[child2].height);
+        nodes[index].aabb   = pb2_combine(&nodes[child1].aabb, &nodes[child2].aabb);
+
+        index = nodes[index].parent;
+    }
+}
+
+static int ph_bp_balance(ph_broadphase_t* bp, int index_a)
+{
+    ph_bp_node_t* nodes = bp->nodes;
+    ph_bp_node_t* a = &nodes[index_a];
+
+    if (a->height < 2)
+        return index_a;
+
+    int index_b = a->child1;
+    int index_c = a->child2;
+
+    ph_bp_node_t* b = &nodes[index_b];
+    ph_bp_node_t* c = &nodes[index_c];
+
+    int balance = c->height - b->height;
+
+    if (balance > 1)
+    {
+        // Rotate C up
+        int index_f = c->child1;
+        int index_g = c->child2;
+
+        ph_bp_node_t* f = &nodes[index_f];
+        ph_bp_node_t* g = &nodes[index_g];
+
+        c->child1 = index_a;
+        c->parent = a->parent;
+        a->parent = index_c;
+
+        if (c->parent != PH_NULL_NODE)
+        {
+            if (nodes[c->parent].child1 == index_a)
+                nodes[c->parent].child1 = index_c;
+            else
+                nodes[c->parent].child2 = index_c;
+        }
+        else
+        {
+            bp->root = index_c;
+        }
+
+        // The taller grandchild stays with C
+        if (f->height > g->height)
+        {
+            c->child2 = index_f;
+            a->child2 = index_g;
+            g->parent = index_a;
+
+            a->aabb = pb2_combine(&b->aabb, &g->aabb);
+            c->aabb = pb2_combine(&a->aabb, &f->aabb);
+
+            a->height = 1 + ph_max(b->height, g->height);
+            c->height = 1 + ph_max(a->height, f->height);
+        }
+        else
+        {
+            c->child2 = index_g;
+            a->child2 = index_f;
+            f->parent = index_a;
+
+            a->aabb = pb2_combine(&b->aabb, &f->aabb);
+            c->aabb = pb2_combine(&a->aabb, &g->aabb);
+
+            a->height = 1 + ph_max(b->height, f->height);
+            c->height = 1 + ph_max(a->height, g->height);
+        }
+
+        return index_c;
+    }
+
+    if (balance < -1)
+    {
+        // Rotate B up
+        int index_d = b->child1;
+        int index_e = b->child2;
+
+        ph_bp_node_t* d = &nodes[index_d];
+        ph_bp_node_t* e = &nodes[index_e];
+
+        b->child1 = index_a;
+        b->parent = a->parent;
+        a->parent = index_b;
+
+        if (b->parent != PH_NULL_NODE)
+        {
+            if (nodes[b->parent].child1 == index_a)
+                nodes[b->parent].child1 = index_b;
+            else
+                nodes[b->parent].child2 = index_b;
+        }
+        else
+        {
+            bp->root = index_b;
+        }
+
+        // The taller grandchild stays with B
+        if (d->height > e->height)
+        {
+            b->child2 = index_d;
+            a->child1 = index_e;
+            e->parent = index_a;
+
+            a->aabb = pb2_combine(&c->aabb, &e->aabb);
+            b->aabb = pb2_combine(&a->aabb, &d->aabb);
+
+            a->height = 1 + ph_max(c->height, e->height);
+            b->height = 1 + ph_max(a->height, d->height);
+        }
+        else
+        {
+            b->child2 = index_e;
+            a->child1 = index_d;
+            d->parent = index_a;
+
+            a->aabb = pb2_combine(&c->aabb, &d->aabb);
+            b->aabb = pb2_combine(&a->aabb, &e->aabb);
+
+            a->height = 1 + ph_max(c->height, d->height);
+            b->height = 1 + ph_max(a->height, e->height);
+        }
+
+        return index_b;
+    }
+
+    return index_a;
+}
+
+static void ph_bp_self_pairs(const ph_broadphase_t* bp, int index, ph_bp_pairs_t* result)
+{
+    const ph_bp_node_t* node = &bp->nodes[index];
+
+    if (node->height == 0)
+        return;
+
+    ph_bp_self_pairs(bp, node->child1, result);
+    ph_bp_self_pairs(bp, node->child2, result);
+    ph_bp_cross_pairs(bp, node->child1, node->child2, result);
+}
+
+static void ph_bp_cross_pairs(const ph_broadphase_t* bp, int index1, int index2, ph_bp_pairs_t* result)
+{
+    const ph_bp_node_t* node1 = &bp->nodes[index1];
+    const ph_bp_node_t* node2 = &bp->nodes[index2];
+
+    if (!pb2_overlaps(&node1->aabb, &node2->aabb))
+        return;
+
+    if (node1->height == 0 && node2->height == 0)
+    {
+        if (result->count < result->capacity)
+            result->pairs[result->count] = (ph_pair_t){ node1->value, node2->value };
+
+        result->count++;
+        return;
+    }
+
+    // Descend into the larger subtree
+    if (node2->height == 0 || (node1->height > 0 && ph_perimeter(&node1->aabb) > ph_perimeter(&node2->aabb)))
+    {
+        ph_bp_cross_pairs(bp, node1->child1, index2, result);
+        ph_bp_cross_pairs(bp, node1->child2, index2, result);
+    }
+    else
+    {
+        ph_bp_cross_pairs(bp, index1, node2->child1, result);
+        ph_bp_cross_pairs(bp, index1, node2->child2, result);
+    }
+}
+
+static void ph_bp_query_node(const ph_broadphase_t* bp, int index, const pb2* aabb, ph_bp_values_t* result)
+{
+    const ph_bp_node_t* node = &bp->nodes[index];
+
+    if (!pb2_overlaps(&node->aabb, aabb))
+        return;
+
+    if (node->height == 0)
+    {
+        if (result->count < result->capacity)
+            result->values[result->count] = node->value;
+
+        result->count++;
+        return;
+    }
+
+    ph_bp_query_node(bp, node->child1, aabb, result);
+    ph_bp_query_node(bp, node->child2, aabb, result);
+}
+
+static pfloat ph_perimeter(const pb2* aabb)
+{
+    return 2.0f * ((aabb->max.x - aabb->min.x) + (aabb->max.y - aabb->min.y));
+}
+
+static int ph_max(int a, int b)
+{
+    return a > b ? a : b;
 }
 
 // Determinant of 2D matrix
@@ -17,6 +17,9 @@
     - Ability to set logging level (TRACE, DEBUG, INFO, WARN, ERROR, and FATAL)
     - Ability to toggle date/time, log level, filename/line, and function
     - reporting individually, on a per appender basis
+    - Optional asynchronous mode backed by a lock-free queue
+    - Buffered file appender with size based rotation
+    - Binary logging mode with deferred formatting
     - Permissive licensing (zlib or public domain)
 
     Summary:
@@ -45,6 +48,33 @@
     this function pointer is passed true the lock is acquired and false to
     release the lock.
 
+    Logging can be made asynchronous with `log_enable_async`. The calling thread
+    then only formats the message and pushes it into a lock-free queue, without
+    taking locks or calling appenders. Queued entries are written in batches by
+    `log_flush_async`, which can be called periodically or from a dedicated
+    thread. When the queue is full, entries are dropped, the caller waits, or
+    entries are dropped and counted, as chosen by the overflow policy. The
+    asynchronous mode requires atomic operations (GCC, Clang, or MSVC).
+
+    Files can be written through a buffered appender registered with
+    `log_add_file`. Entries are collected in a large buffer that is written
+    when it fills, when a second has passed since the last write, or
+    immediately for ERROR and FATAL entries. The remaining entries are written
+    by `log_flush`, which also runs at normal program exit. Files can be
+    rotated when they reach a given size (e.g. app.log is renamed app.log.1,
+    app.log.1 becomes app.log.2, and so on). In asynchronous mode writing and rotation happen in
+    the thread calling `log_flush_async`, so logging threads never wait on
+    the file system.
+
+    For hot paths, the `log_*_binary` macros avoid formatting text altogether.
+    Each call site registers its format string once, after which an entry is
+    written as the format ID, a timestamp, and the raw bytes of its arguments
+    to the appender set with `log_set_binary_appender`. `log_decode_binary`
+    turns these records back into text and writes it to the regular appenders,
+    either in a background thread or offline (on the same platform). If
+    pico_time.h is included before the implementation, timestamps come from
+    `pt_now`, which has microsecond resolution.
+
     Please see the examples for more details.
 
     Usage:
@@ -62,6 +92,13 @@
 
     - PICO_LOG_MAX_APPENDERS (default: 16)
     - PICO_LOG_MAX_MSG_LENGTH (default: 1024)
+    - PICO_LOG_ASYNC_CAPACITY (default: 128, must be a power of two)
+    - PICO_LOG_MAX_FILES (default: 4)
+    - PICO_LOG_FILE_BUFFER_SIZE (default: 65536)
+    - PICO_LOG_FILE_FLUSH_INTERVAL (default: 1 second)
+    - PICO_LOG_FILE_FLUSH_LEVEL (default: LOG_LEVEL_ERROR)
+    - PICO_LOG_MAX_FORMATS (default: 256)
+    - PICO_LOG_MAX_BINARY_ARGS (default: 16)
 
     Must be defined before PICO_LOG_IMPLEMENTATION
 */
@@ -112,6 +149,27 @@ typedef void (*log_appender_lock_fn)(bool lock, void *udata);
  */
 typedef int log_appender_t;
 
+/**
+ * @brief What happens to entries logged while the asynchronous queue is full
+ */
+typedef enum
+{
+    LOG_OVERFLOW_DROP,  //!< The entry is discarded
+    LOG_OVERFLOW_BLOCK, //!< The caller waits for space (writing entries itself)
+    LOG_OVERFLOW_COUNT  //!< The entry is discarded, and the number of discarded
+                        //!< entries is logged as a warning once there is space
+} log_overflow_t;
+
+/**
+ * @brief Binary appender function definition. A binary appender stores raw
+ * records, for example by appending them to a file.
+ *
+ * @param data  The record
+ * @param size  The size of the record in bytes
+ * @param udata Data obtained from the corresponding `log_set_binary_appender`
+ */
+typedef void (*log_binary_fn)(const void* data, size_t size, void* udata);
+
 /**
   * @brief Converts a string to the corresponding log level
   */
@@ -162,6 +220,35 @@ log_appender_t log_add_appender(log_appender_fn appender_fp,
  */
 log_appender_t log_add_stream(FILE* stream, log_level_t level);
 
+/**
+ * @brief Registers a buffered file appender.
+ *
+ * Entries are appended to the file in large writes rather than one write per
+ * entry. The buffer is written when it is full, when
+ * PICO_LOG_FILE_FLUSH_INTERVAL seconds have passed since the last write, and
+ * for entries at or above PICO_LOG_FILE_FLUSH_LEVEL. The file is closed (and
+ * the buffer written) when the appender is removed.
+ *
+ * Buffered entries are otherwise lost when the program ends. `log_flush` is
+ * registered with `atexit`, which covers returning from `main` and `exit`.
+ * Call `log_flush` before any other kind of termination (e.g. `abort` or
+ * `_exit`).
+ *
+ * @param path        The file to append to
+ * @param level       The appender's log level
+ * @param max_size    The file is rotated before it would exceed this size in
+ *                    bytes. Pass 0 to disable rotation.
+ * @param max_backups The number of rotated files to keep (path.1 being the
+ *                    newest). If 0, the file is truncated when rotated.
+ *
+ * @return            An identifier for the appender, or -1 if the file could
+ *                    not be opened or PICO_LOG_MAX_FILES files are open
+ */
+log_appender_t log_add_file(const char* path,
+                            log_level_t level,
+                            size_t max_size,
+                            int max_backups);
+
 /**
  * @brief Unregisters appender (removes the appender from the logger).
  *
@@ -260,6 +347,49 @@ void log_display_file(log_appender_t id, bool enabled);
  */
 void log_display_function(log_appender_t id, bool enabled);
 
+/**
+ * @brief Enables asynchronous logging
+ *
+ * Entries are queued instead of being written immediately. Call
+ * `log_flush_async` to write them.
+ *
+ * @param policy What to do with entries when the queue is full
+ *
+ * @return       False if atomic operations are not available on this platform
+ */
+bool log_enable_async(log_overflow_t policy);
+
+/**
+ * @brief Disables asynchronous logging and writes any queued entries. Must not
+ * be called while other threads are logging.
+ */
+void log_disable_async(void);
+
+/**
+ * @brief Writes the entries queued in asynchronous mode
+ *
+ * May be called from any thread. If another thread is already writing
+ * entries, the call returns immediately.
+ *
+ * @return The number of entries written
+ */
+size_t log_flush_async(void);
+
+/**
+ * @brief Writes all pending entries
+ *
+ * Writes the entries queued in asynchronous mode and the buffers of file
+ * appenders, and flushes stream appenders. Called automatically at normal
+ * program exit once a file appender has been added.
+ */
+void log_flush(void);
+
+/**
+ * @brief Returns the number of entries discarded because the asynchronous
+ * queue was full
+ */
+unsigned long log_get_dropped_count(void);
+
 /**
  * @brief Logs a TRACE an INFO message
  *
@@ -325,6 +455,85 @@ void log_write(log_level_t level,
                const char* func,
                const char* fmt, ...);
 
+/**
+ * @brief Sets the appender that receives binary records
+ *
+ * The first record written is a clock record, followed by the formats
+ * registered so far. Formats registered later are written before their first
+ * entry. Records must be kept in order for the decoder. The appender may be
+ * called from any thread that logs, so it must do its own locking if needed.
+ *
+ * @param appender_fp The binary appender, or NULL to disable binary logging
+ * @param level       Binary entries below this level are discarded
+ * @param udata       A pointer supplied to the appender function
+ */
+void log_set_binary_appender(log_binary_fn appender_fp,
+                             log_level_t level,
+                             void* udata);
+
+/**
+ * @brief Converts binary records to text and writes them to the registered
+ * appenders
+ *
+ * Formats are looked up in the records being decoded and then among those
+ * registered in the running program. To decode a log offline, pass the
+ * complete log (from its first record) to a single call. Entries with a
+ * malformed format or arguments are skipped.
+ *
+ * @param data A sequence of whole records
+ * @param size The size of the sequence in bytes
+ *
+ * @return     The number of entries decoded
+ */
+size_t log_decode_binary(const void* data, size_t size);
+
+/**
+ * @brief Logs binary messages at the corresponding level
+ *
+ * Usage is similar to printf (i.e. log_info_binary(format, args...)), except
+ * that the format must be a string literal. All conversions are supported
+ * other than %n and wide characters or strings (%lc, %ls). Field widths and
+ * precisions, including those passed as '*' arguments, are limited to
+ * PICO_LOG_MAX_MSG_LENGTH.
+ */
+#define log_trace_binary(...) LOG_WRITE_BINARY(LOG_LEVEL_TRACE, __VA_ARGS__)
+#define log_debug_binary(...) LOG_WRITE_BINARY(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define log_info_binary(...)  LOG_WRITE_BINARY(LOG_LEVEL_INFO,  __VA_ARGS__)
+#define log_warn_binary(...)  LOG_WRITE_BINARY(LOG_LEVEL_WARN,  __VA_ARGS__)
+#define log_error_binary(...) LOG_WRITE_BINARY(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define log_fatal_binary(...) LOG_WRITE_BINARY(LOG_LEVEL_FATAL, __VA_ARGS__)
+
+/*
+ * Each call site owns a static format ID, assigned on first use
+ */
+#define LOG_WRITE_BINARY(level, ...) \
+        do { \
+            static volatile int log_format_id = -1; \
+            log_write_binary(&log_format_id, level, __FILE__, __LINE__, \
+                             __func__, __VA_ARGS__); \
+        } while (0)
+
+/*
+ * Lets the compiler check the arguments of binary entries against their format
+ */
+#if defined(__GNUC__) || defined(__clang__)
+    #define LOG_PRINTF_FORMAT(fmt_index, arg_index) \
+            __attribute__((format(printf, fmt_index, arg_index)))
+#else
+    #define LOG_PRINTF_FORMAT(fmt_index, arg_index)
+#endif
+
+/**
+ * WARNING: It is inadvisable to call this function directly. Use the macros
+ * instead.
+ */
+void log_write_binary(volatile int* id,
+                      log_level_t level,
+                      const char* file,
+                      unsigned line,
+                      const char* func,
+                      const char* fmt, ...) LOG_PRINTF_FORMAT(6, 7);
+
 
 #ifdef __cplusplus
 }
@@ -334,8 +543,10 @@ void log_write(log_level_t level,
 
 #ifdef PICO_LOG_IMPLEMENTATION
 
-#include <time.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 /*
  * Configuration constants/macros.
@@ -348,6 +559,34 @@ void log_write(log_level_t level,
 #define PICO_LOG_MAX_MSG_LENGTH 1024
 #endif
 
+#ifndef PICO_LOG_ASYNC_CAPACITY
+#define PICO_LOG_ASYNC_CAPACITY 128
+#endif
+
+#ifndef PICO_LOG_MAX_FILES
+#define PICO_LOG_MAX_FILES 4
+#endif
+
+#ifndef PICO_LOG_FILE_BUFFER_SIZE
+#define PICO_LOG_FILE_BUFFER_SIZE 65536
+#endif
+
+#ifndef PICO_LOG_FILE_FLUSH_INTERVAL
+#define PICO_LOG_FILE_FLUSH_INTERVAL 1
+#endif
+
+#ifndef PICO_LOG_FILE_FLUSH_LEVEL
+#define PICO_LOG_FILE_FLUSH_LEVEL LOG_LEVEL_ERROR
+#endif
+
+#ifndef PICO_LOG_MAX_FORMATS
+#define PICO_LOG_MAX_FORMATS 256
+#endif
+
+#ifndef PICO_LOG_MAX_BINARY_ARGS
+#define PICO_LOG_MAX_BINARY_ARGS 16
+#endif
+
 #ifdef NDEBUG
     #define PICO_LOG_ASSERT(expr) ((void)0)
 #else
@@ -363,8 +602,64 @@ void log_write(log_level_t level,
 
 #define LOG_MAX_APPENDERS  PICO_LOG_MAX_APPENDERS
 #define LOG_MAX_MSG_LENGTH PICO_LOG_MAX_MSG_LENGTH
+#define LOG_ASYNC_CAPACITY PICO_LOG_ASYNC_CAPACITY
+#define LOG_MAX_FILES      PICO_LOG_MAX_FILES
+#define LOG_FILE_BUF_SIZE  PICO_LOG_FILE_BUFFER_SIZE
+#define LOG_MAX_FORMATS    PICO_LOG_MAX_FORMATS
+#define LOG_MAX_ARGS       PICO_LOG_MAX_BINARY_ARGS
 #define LOG_ASSERT         PICO_LOG_ASSERT
 
+/*
+ * Atomic operations used by the asynchronous queue. C99 has none, so compiler
+ * intrinsics are used where available.
+ */
+
+#if defined(__GNUC__) || defined(__clang__)
+    #define LOG_ATOMICS
+    #define LOG_ATOMIC_LOAD(ptr)       __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+    #define LOG_ATOMIC_STORE(ptr, val) __atomic_store_n(ptr, val, __ATOMIC_RELEASE)
+    #define LOG_ATOMIC_ADD(ptr, val)   __atomic_fetch_add(ptr, val, __ATOMIC_ACQ_REL)
+    #define LOG_ATOMIC_SWAP(ptr, val)  __atomic_exchange_n(ptr, val, __ATOMIC_ACQ_REL)
+    #define LOG_ATOMIC_CAS(ptr, expected, desired) \
+            __atomic_compare_exchange_n(ptr, &(expected), desired, false, \
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#elif defined(_MSC_VER)
+    #include <intrin.h>
+    #define LOG_ATOMICS
+    #define LOG_ATOMIC_LOAD(ptr)       ((log_atomic_t)_InterlockedOr((volatile long*)(ptr), 0))
+    #define LOG_ATOMIC_STORE(ptr, val) ((void)_InterlockedExchange((volatile long*)(ptr), (long)(val)))
+    #define LOG_ATOMIC_ADD(ptr, val)   ((log_atomic_t)_InterlockedExchangeAdd((volatile long*)(ptr), (long)(val)))
+    #define LOG_ATOMIC_SWAP(ptr, val)  ((log_atomic_t)_InterlockedExchange((volatile long*)(ptr), (long)(val)))
+    #define LOG_ATOMIC_CAS(ptr, expected, desired) \
+            log_msvc_cas((volatile long*)(ptr), &(expected), (long)(desired))
+#endif
+
+/*
+ * Gives up the processor while a producer waits for space in a full queue.
+ * Spinning without yielding can starve the consumer on a single core.
+ */
+
+#if defined(_WIN32)
+    #include <windows.h>
+    #define LOG_YIELD() ((void)SwitchToThread())
+#elif defined(__unix__) || defined(__APPLE__)
+    #include <sched.h>
+    #define LOG_YIELD() ((void)sched_yield())
+#else
+    #define LOG_YIELD() ((void)0)
+#endif
+
+/*
+ * Binary timestamps in microseconds. pt_now is preferred when pico_time.h is
+ * available.
+ */
+
+#ifdef PICO_TIME_H
+    #define LOG_CLOCK() ((unsigned long long)pt_to_usec(pt_now()))
+#else
+    #define LOG_CLOCK() ((unsigned long long)time(0) * 1000000ULL)
+#endif
+
 /*
  * Log entry component maximum sizes. These have been chosen to be overly
  * generous powers of 2 for the sake of safety and simplicity.
@@ -377,11 +672,13 @@ void log_write(log_level_t level,
 #define LOG_MSG_LEN       LOG_MAX_MSG_LENGTH
 #define LOG_BREAK_LEN     1
 
-#define LOG_ENTRY_LEN (LOG_TIMESTAMP_LEN  + \
-                       LOG_LEVEL_LEN      + \
-                       LOG_FILE_LEN       + \
-                       LOG_FUNC_LEN       + \
-                       LOG_MSG_LEN        + \
+#define LOG_PREFIX_LEN (LOG_TIMESTAMP_LEN + \
+                        LOG_LEVEL_LEN     + \
+                        LOG_FILE_LEN      + \
+                        LOG_FUNC_LEN)
+
+#define LOG_ENTRY_LEN (LOG_PREFIX_LEN + \
+                       LOG_MSG_LEN    + \
                        LOG_BREAK_LEN)
 
 #define LOG_TIME_FMT_LEN 32
@@ -395,6 +692,27 @@ static bool log_initialized    = false; // True if logger is initialized
 static bool log_enabled        = true;  // True if logger is enabled
 static int  log_appender_count = 0;     // Number of appenders
 
+// Lowest level admitted by an enabled appender (LOG_LEVEL_COUNT if none)
+static log_level_t log_min_level = LOG_LEVEL_COUNT;
+
+/*
+ * Positions in the queue wrap around, so they are unsigned.
+ */
+typedef unsigned long log_atomic_t;
+
+#if defined(_MSC_VER) && !defined(__clang__)
+static bool log_msvc_cas(volatile long* ptr, log_atomic_t* expected, long desired)
+{
+    long prev = _InterlockedCompareExchange(ptr, desired, (long)*expected);
+
+    if (prev == (long)*expected)
+        return true;
+
+    *expected = (log_atomic_t)prev;
+    return false;
+}
+#endif
+
 /*
  * Logger level strings indexed by level ID (log_level_t).
  */
@@ -453,6 +771,128 @@ typedef struct
  */
 static log_appender_data_t log_appenders[LOG_MAX_APPENDERS];
 
+/*
+ * A log entry before the metadata of an appender is added to it. File and
+ * function names are string literals, so the pointers remain valid while the
+ * entry is queued.
+ */
+typedef struct
+{
+    log_level_t level;
+    const char* file;
+    unsigned    line;
+    const char* func;
+    time_t      time;
+    char        msg[LOG_MSG_LEN];
+} log_record_t;
+
+/*
+ * The asynchronous queue is a bounded ring in which every slot carries a
+ * sequence number. A slot may be written when its sequence equals the write
+ * position and read when it equals the read position plus one. Producers
+ * claim positions with compare-and-swap, so pushing never blocks. There is a
+ * single consumer at a time.
+ */
+typedef struct
+{
+    volatile log_atomic_t seq;
+    log_record_t          record;
+} log_slot_t;
+
+#ifdef LOG_ATOMICS
+static log_slot_t log_async_slots[LOG_ASYNC_CAPACITY];
+
+static volatile log_atomic_t log_async_enabled = 0;
+static volatile log_atomic_t log_async_head    = 0; // Next position to write
+static volatile log_atomic_t log_async_busy    = 0; // 1 while entries are written
+static volatile log_atomic_t log_async_dropped = 0; // Total discarded entries
+static volatile log_atomic_t log_async_pending = 0; // Discarded but not reported
+static log_atomic_t          log_async_tail    = 0; // Next position to read
+static log_overflow_t        log_async_policy  = LOG_OVERFLOW_DROP;
+#endif
+
+/*
+ * State of a buffered file appender (the appender's user data)
+ */
+typedef struct
+{
+    bool        used_slot;
+    FILE*       stream;       // NULL if the file could not be reopened
+    char        path[LOG_FILE_LEN];
+    size_t      max_size;     // Rotation threshold (0 if disabled)
+    int         max_backups;
+    size_t      size;         // Size of the current file, including the buffer
+    size_t      used;         // Number of buffered bytes
+    time_t      flush_time;   // Time of the last write to the file
+    log_level_t entry_level;  // Level of the entry being appended
+    time_t      entry_time;   // Time of the entry being appended
+    char        buffer[LOG_FILE_BUF_SIZE];
+} log_file_t;
+
+static log_file_t log_files[LOG_MAX_FILES];
+
+/*
+ * Argument types of binary entries, as determined by the conversions of the
+ * format string
+ */
+typedef enum
+{
+    LOG_ARG_INT,
+    LOG_ARG_LONG,
+    LOG_ARG_LLONG,
+    LOG_ARG_SIZE,
+    LOG_ARG_INTMAX,
+    LOG_ARG_PTRDIFF,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_LDOUBLE,
+    LOG_ARG_STR,
+    LOG_ARG_PTR,
+    LOG_ARG_INVALID
+} log_arg_t;
+
+typedef struct
+{
+    log_level_t   level;
+    const char*   file;
+    unsigned      line;
+    const char*   func;
+    const char*   fmt;
+    int           arg_count;
+    unsigned char args[LOG_MAX_ARGS]; // log_arg_t
+} log_format_data_t;
+
+/*
+ * Binary records start with one of these bytes. Values are stored in native
+ * byte order.
+ *
+ * Clock:  time_t wall time, unsigned long long clock at that time
+ * Format: int ID, int level, unsigned line, file, function, and format strings
+ *         (null terminated)
+ * Entry:  int ID, unsigned long long clock, unsigned short size, arguments
+ *         (strings are stored as an unsigned short length and characters)
+ */
+#define LOG_RECORD_CLOCK  'C'
+#define LOG_RECORD_FORMAT 'F'
+#define LOG_RECORD_ENTRY  'E'
+
+// Room for every argument at its largest, plus the strings
+#define LOG_BINARY_LEN (32 + LOG_MAX_ARGS * sizeof(long double) + LOG_MSG_LEN)
+
+static log_format_data_t log_formats[LOG_MAX_FORMATS];
+static int               log_format_count = 0;
+
+static log_binary_fn     log_binary_fp    = NULL;
+static void*             log_binary_udata = NULL;
+static log_level_t       log_binary_level = LOG_LEVEL_TRACE;
+static time_t            log_binary_wall  = 0; // Wall time when the clock was
+static unsigned long long log_binary_clock = 0;
+
+#ifdef LOG_ATOMICS
+static volatile log_atomic_t log_format_lock = 0;
+#endif
+
+static void log_dispatch(const log_record_t* record);
+
 /*
  * Initializes the logger provided it has not been initialized.
  */
@@ -472,11 +912,33 @@ log_try_init (void)
     log_initialized = true;
 }
 
+/*
+ * Recomputes the lowest level that any enabled appender admits. Must be called
+ * whenever an appender is changed.
+ */
+static void
+log_update_min_level (void)
+{
+    log_min_level = LOG_LEVEL_COUNT;
+
+    for (int i = 0; i < LOG_MAX_APPENDERS; i++)
+    {
+        const log_appender_data_t* appender = &log_appenders[i];
+
+        if (NULL != appender->appender_fp && appender->enabled &&
+            appender->log_level < log_min_level)
+        {
+            log_min_level = appender->log_level;
+        }
+    }
+}
+
 static bool log_appender_exists(log_appender_t id)
 {
     log_try_init();
 
-    return (id < LOG_MAX_APPENDERS && NULL != log_appenders[id].appender_fp);
+    return (id >= 0 && id < LOG_MAX_APPENDERS &&
+            NULL != log_appenders[id].appender_fp);
 }
 
 static bool log_appender_enabled(log_appender_t id)
@@ -552,6 +1014,8 @@ log_add_appender (log_appender_fn appender_fp, log_level_t level, void* udata)
 
             log_appender_count++;
 
+            log_update_min_level();
+
             return (log_appender_t)i;
         }
     }
@@ -561,12 +1025,17 @@ log_add_appender (log_appender_fn appender_fp, log_level_t level, void* udata)
     return 0;
 }
 
+// True while queued entries are written. Streams are flushed once per batch.
+static bool log_batch = false;
+
 static void
 log_stream_appender (const char* entry, void* udata)
 {
     FILE* stream = (FILE*)udata;
     fprintf(stream, "%s", entry);
-    fflush(stream);
+
+    if (!log_batch)
+        fflush(stream);
 }
 
 log_appender_t
@@ -578,6 +1047,154 @@ log_add_stream (FILE* stream, log_level_t level)
     return log_add_appender(log_stream_appender, level, stream);
 }
 
+/*
+ * Writes the buffered entries to the file.
+ */
+static void
+log_file_flush (log_file_t* file, time_t time)
+{
+    if (file->used > 0 && NULL != file->stream)
+    {
+        fwrite(file->buffer, 1, file->used, file->stream);
+        fflush(file->stream);
+        file->used = 0;
+    }
+
+    file->flush_time = time;
+}
+
+/*
+ * Shifts path.1 ... path.(n-1) up by one, moves the current file to path.1,
+ * and starts a new one.
+ */
+static void
+log_file_rotate (log_file_t* file)
+{
+    char old_path[LOG_FILE_LEN + 16];
+    char new_path[LOG_FILE_LEN + 16];
+
+    log_file_flush(file, file->entry_time);
+
+    if (NULL != file->stream)
+        fclose(file->stream);
+
+    if (file->max_backups > 0)
+    {
+        snprintf(old_path, sizeof(old_path), "%s.%d", file->path, file->max_backups);
+        remove(old_path);
+
+        for (int i = file->max_backups - 1; i > 0; i--)
+        {
+            snprintf(old_path, sizeof(old_path), "%s.%d", file->path, i);
+            snprintf(new_path, sizeof(new_path), "%s.%d", file->path, i + 1);
+            rename(old_path, new_path);
+        }
+
+        snprintf(new_path, sizeof(new_path), "%s.1", file->path);
+        rename(file->path, new_path);
+    }
+
+    file->stream = fopen(file->path, "w");
+    file->size   = 0;
+    file->used   = 0;
+
+    // If the file cannot be reopened, entries are discarded
+    if (NULL != file->stream)
+        setvbuf(file->stream, NULL, _IONBF, 0);
+}
+
+static void
+log_file_appender (const char* entry, void* udata)
+{
+    log_file_t* file = (log_file_t*)udata;
+
+    size_t len = strlen(entry);
+
+    if (file->max_size > 0 && file->size > 0 && file->size + len > file->max_size)
+        log_file_rotate(file);
+
+    if (NULL == file->stream)
+        return;
+
+    if (file->used + len > LOG_FILE_BUF_SIZE)
+        log_file_flush(file, file->flush_time);
+
+    // Entries larger than the buffer bypass it
+    if (len > LOG_FILE_BUF_SIZE)
+    {
+        fwrite(entry, 1, len, file->stream);
+    }
+    else
+    {
+        memcpy(file->buffer + file->used, entry, len);
+        file->used += len;
+    }
+
+    file->size += len;
+
+    if (file->entry_level >= PICO_LOG_FILE_FLUSH_LEVEL ||
+        difftime(file->entry_time, file->flush_time) >= PICO_LOG_FILE_FLUSH_INTERVAL)
+    {
+        log_file_flush(file, file->entry_time);
+    }
+}
+
+// True once log_flush is registered to run at exit
+static bool log_flush_at_exit = false;
+
+log_appender_t
+log_add_file (const char* path, log_level_t level, size_t max_size, int max_backups)
+{
+    // Path must not be NULL and must fit, with room for the backup suffix
+    LOG_ASSERT(NULL != path);
+    LOG_ASSERT(strlen(path) < LOG_FILE_LEN);
+    LOG_ASSERT(max_backups >= 0);
+
+    log_file_t* file = NULL;
+
+    for (int i = 0; i < LOG_MAX_FILES; i++)
+    {
+        if (!log_files[i].used_slot)
+        {
+            file = &log_files[i];
+            break;
+        }
+    }
+
+    if (NULL == file)
+        return -1;
+
+    FILE* stream = fopen(path, "a");
+
+    if (NULL == stream)
+        return -1;
+
+    // The appender does its own buffering
+    setvbuf(stream, NULL, _IONBF, 0);
+
+    fseek(stream, 0, SEEK_END);
+    long size = ftell(stream);
+
+    file->used_slot   = true;
+    file->stream      = stream;
+    file->max_size    = max_size;
+    file->max_backups = max_backups;
+    file->size        = (size > 0) ? (size_t)size : 0;
+    file->used        = 0;
+    file->flush_time  = time(0);
+    file->entry_level = LOG_LEVEL_TRACE;
+    file->entry_time  = file->flush_time;
+
+    strncpy(file->path, path, LOG_FILE_LEN - 1);
+    file->path[LOG_FILE_LEN - 1] = '\0';
+
+    // Entries still in the buffer would otherwise be lost at exit
+    if (!log_flush_at_exit)
+        log_flush_at_exit = (0 == atexit(log_flush));
+
+    return log_add_appender(log_file_appender, level, file);
+}
+
 void
 log_remove_appender (log_appender_t id)
 {
@@ -587,10 +1204,26 @@ log_remove_appender (log_appender_t id)
     // Ensure appender is registered
     LOG_ASSERT(log_appender_exists(id));
 
+    // Write and close a buffered file
+    if (log_file_appender == log_appenders[id].appender_fp)
+    {
+        log_file_t* file = (log_file_t*)log_appenders[id].udata;
+
+        log_file_flush(file, time(0));
+
+        if (NULL != file->stream)
+            fclose(file->stream);
+
+        file->stream    = NULL;
+        file->used_slot = false;
+    }
+
     // Reset appender with given ID
     log_appenders[id].appender_fp = NULL;
 
     log_appender_count--;
+
+    log_update_min_level();
 }
 
 void
@@ -604,6 +1237,8 @@ log_enable_appender (log_appender_t id)
 
     // Enable appender
     log_appenders[id].enabled = true;
+
+    log_update_min_level();
 }
 
 void
@@ -617,6 +1252,8 @@ log_disable_appender (log_appender_t id)
 
     // Disable appender
     log_appenders[id].enabled = false;
+
+    log_update_min_level();
 }
 
 void
@@ -649,6 +1286,8 @@ log_set_level (log_appender_t id, log_level_t level)
 
     // Set the level
     log_appenders[id].log_level = level;
+
+    log_update_min_level();
 }
 
 void
@@ -730,29 +1369,26 @@ log_display_function (log_appender_t id, bool enabled)
 }
 
 /*
- * Formats the current time as as string.
+ * Formats a time as as string.
  */
 static char*
-log_time_str (const char* time_fmt, char* str, size_t len)
+log_time_str (const char* time_fmt, time_t time, char* str, size_t len)
 {
-    time_t now = time(0);
-    size_t ret = strftime(str, len, time_fmt, localtime(&now));
+    size_t ret = strftime(str, len, time_fmt, localtime(&time));
 
     LOG_ASSERT(ret > 0);
+    (void)ret;
 
     return str;
 }
 
 static void
-log_append_timestamp (char* entry_str, const char* time_fmt)
+log_format_timestamp (char* time_str, size_t len, const char* time_fmt, time_t time)
 {
-    char time_str[LOG_TIMESTAMP_LEN + 1];
     char tmp_str[LOG_TIMESTAMP_LEN];
 
-    snprintf(time_str, sizeof(time_str), "%s ",
-             log_time_str(time_fmt, tmp_str, sizeof(tmp_str)));
-
-    strncat(entry_str, time_str, LOG_TIMESTAMP_LEN);
+    snprintf(time_str, len, "%s ",
+             log_time_str(time_fmt, time, tmp_str, sizeof(tmp_str)));
 }
 
 static void
@@ -803,22 +1439,27 @@ log_append_func (char* entry_str, const char* func, bool colors)
     strncat(entry_str, func_str, LOG_FUNC_LEN);
 }
 
-void
-log_write (log_level_t level, const char* file, unsigned line,
-                              const char* func, const char* fmt, ...)
+/*
+ * Writes a record to every appender that admits its level. The message is
+ * copied once into the end of a shared buffer, and each appender writes its
+ * prefix (timestamp, level, etc.) directly in front of it.
+ */
+static void
+log_dispatch (const log_record_t* record)
 {
-    // Ensure logger is initialized
-    log_try_init();
+    char entry_str[LOG_ENTRY_LEN + 1]; // Ensure there is space for null char
 
-    // Only write entry if there are registered appenders and the logger is
-    // enabled
-    if (0 == log_appender_count || !log_enabled)
-    {
-        return;
-    }
+    char* msg_str = entry_str + LOG_PREFIX_LEN;
 
-    // Ensure valid log level
-    LOG_ASSERT(level < LOG_LEVEL_COUNT);
+    // Append the log message
+    size_t msg_len = strlen(record->msg);
+
+    memcpy(msg_str, record->msg, msg_len);
+    memcpy(msg_str + msg_len, "\n", 2);
+
+    // Appenders that share a time format share the timestamp
+    char time_str[LOG_TIMESTAMP_LEN + 1];
+    const char* time_fmt = NULL;
 
     for (log_appender_t i = 0; i < LOG_MAX_APPENDERS; i++)
     {
@@ -827,47 +1468,50 @@ log_write (log_level_t level, const char* file, unsigned line,
         if (!log_appender_enabled(i))
             continue;
 
-        if (log_appenders[i].log_level <= level)
+        if (log_appenders[i].log_level <= record->level)
         {
-            char entry_str[LOG_ENTRY_LEN + 1]; // Ensure there is space for
-                                              // null char
+            char prefix_str[LOG_PREFIX_LEN + 1];
 
-            entry_str[0] = '\0'; // Ensure the entry is null terminated
+            prefix_str[0] = '\0'; // Ensure the prefix is null terminated
 
             // Append a timestamp
             if (appender->timestamp)
             {
-                log_append_timestamp(entry_str, appender->time_fmt);
+                if (NULL == time_fmt || 0 != strcmp(time_fmt, appender->time_fmt))
+                {
+                    log_format_timestamp(time_str, sizeof(time_str),
+                                         appender->time_fmt, record->time);
+
+                    time_fmt = appender->time_fmt;
+                }
+
+                strncat(prefix_str, time_str, LOG_TIMESTAMP_LEN);
             }
 
             // Append the logger level
             if (appender->level)
             {
-                log_append_level(entry_str, level, appender->colors);
+                log_append_level(prefix_str, record->level, appender->colors);
             }
 
             // Append the filename/line number
             if (appender->file)
             {
-                log_append_file(entry_str, file, line);
+                log_append_file(prefix_str, record->file, record->line);
             }
 
             // Append the function name
             if (appender->func)
             {
-                log_append_func(entry_str, func, appender->colors);
+                log_append_func(prefix_str, record->func, appender->colors);
             }
 
-            // Append the log message
-            char msg_str[LOG_MSG_LEN];
+            // Place the prefix in front of the message
+            size_t prefix_len = strlen(prefix_str);
 
-            va_list args;
-            va_start(args, fmt);
-            vsnprintf(msg_str, sizeof(msg_str), fmt, args);
-            va_end(args);
+            char* appender_str = msg_str - prefix_len;
 
-            strncat(entry_str, msg_str, LOG_MSG_LEN);
-            strcat(entry_str, "\n");
+            memcpy(appender_str, prefix_str, prefix_len);
 
             // Locks the appender
             if (NULL != appender->lock_fp)
@@ -875,7 +1519,17 @@ log_write (log_level_t level, const char* file, unsigned line,
                 appender->lock_fp(true, appender->lock_udata);
             }
 
-            appender->appender_fp(entry_str, appender->udata);
+            // Buffered files flush depending on the level and time of the
+            // entry, which the entry string does not carry
+            if (log_file_appender == appender->appender_fp)
+            {
+                log_file_t* file = (log_file_t*)appender->udata;
+
+                file->entry_level = record->level;
+                file->entry_time  = record->time;
+            }
+
+            appender->appender_fp(appender_str, appender->udata);
 
             // Unlocks the appender
             if (NULL != appender->lock_fp)
@@ -886,6 +1540,979 @@ log_write (log_level_t level, const char* file, unsigned line,
     }
 }
 
+#ifdef LOG_ATOMICS
+
+/*
+ * Claims the slot at the write position, or returns NULL if the queue is full.
+ */
+static log_slot_t*
+log_async_claim (log_atomic_t* pos)
+{
+    *pos = LOG_ATOMIC_LOAD(&log_async_head);
+
+    for (;;)
+    {
+        log_slot_t* slot = &log_async_slots[*pos & (LOG_ASYNC_CAPACITY - 1)];
+
+        log_atomic_t seq = LOG_ATOMIC_LOAD(&slot->seq);
+
+        // The slot still holds an entry from the previous lap
+        if (seq != *pos && (long)(seq - *pos) < 0)
+            return NULL;
+
+        if (seq == *pos)
+        {
+            // On failure, pos is updated to the current write position
+            if (LOG_ATOMIC_CAS(&log_async_head, *pos, *pos + 1))
+                return slot;
+        }
+        else
+        {
+            // Another producer claimed this position
+            *pos = LOG_ATOMIC_LOAD(&log_async_head);
+        }
+    }
+}
+
+static void
+log_async_push (log_level_t level, const char* file, unsigned line,
+                const char* func, const char* fmt, va_list args)
+{
+    log_atomic_t pos;
+    log_slot_t* slot = log_async_claim(&pos);
+
+    while (!slot)
+    {
+        if (LOG_OVERFLOW_BLOCK != log_async_policy)
+        {
+            LOG_ATOMIC_ADD(&log_async_dropped, 1);
+            LOG_ATOMIC_ADD(&log_async_pending, 1);
+            return;
+        }
+
+        // Make space by writing entries (unless another thread already is)
+        if (0 == log_flush_async())
+            LOG_YIELD();
+
+        slot = log_async_claim(&pos);
+    }
+
+    log_record_t* record = &slot->record;
+
+    record->level = level;
+    record->file  = file;
+    record->line  = line;
+    record->func  = func;
+    record->time  = time(0);
+
+    vsnprintf(record->msg, sizeof(record->msg), fmt, args);
+
+    // Publish the entry to the consumer
+    LOG_ATOMIC_STORE(&slot->seq, pos + 1);
+}
+
+#endif // LOG_ATOMICS
+
+bool
+log_enable_async (log_overflow_t policy)
+{
+#ifdef LOG_ATOMICS
+    // Ensure the capacity is a power of two
+    LOG_ASSERT(LOG_ASYNC_CAPACITY > 0 &&
+               0 == (LOG_ASYNC_CAPACITY & (LOG_ASYNC_CAPACITY - 1)));
+
+    if (LOG_ATOMIC_LOAD(&log_async_enabled))
+    {
+        log_async_policy = policy;
+        return true;
+    }
+
+    for (log_atomic_t i = 0; i < LOG_ASYNC_CAPACITY; i++)
+    {
+        log_async_slots[i].seq = i;
+    }
+
+    log_async_head   = 0;
+    log_async_tail   = 0;
+    log_async_policy = policy;
+
+    LOG_ATOMIC_STORE(&log_async_enabled, 1);
+
+    return true;
+#else
+    (void)policy;
+    return false;
+#endif
+}
+
+void
+log_disable_async (void)
+{
+#ifdef LOG_ATOMICS
+    LOG_ATOMIC_STORE(&log_async_enabled, 0);
+
+    // Wait for a concurrent flush, then write what remains
+    while (LOG_ATOMIC_LOAD(&log_async_busy) || 0 != log_flush_async())
+    {
+    }
+#endif
+}
+
+size_t
+log_flush_async (void)
+{
+#ifdef LOG_ATOMICS
+    log_atomic_t idle = 0;
+
+    // Only one thread consumes at a time
+    if (!LOG_ATOMIC_CAS(&log_async_busy, idle, 1))
+        return 0;
+
+    size_t count = 0;
+
+    log_batch = true;
+
+    for (;;)
+    {
+        log_slot_t* slot = &log_async_slots[log_async_tail & (LOG_ASYNC_CAPACITY - 1)];
+
+        if (LOG_ATOMIC_LOAD(&slot->seq) != log_async_tail + 1)
+            break;
+
+        log_dispatch(&slot->record);
+
+        // Hand the slot back to the producers for the next lap
+        LOG_ATOMIC_STORE(&slot->seq, log_async_tail + LOG_ASYNC_CAPACITY);
+
+        log_async_tail++;
+        count++;
+    }
+
+    log_atomic_t pending = LOG_ATOMIC_SWAP(&log_async_pending, 0);
+
+    if (pending > 0 && LOG_OVERFLOW_COUNT == log_async_policy)
+    {
+        log_record_t record;
+
+        record.level = LOG_LEVEL_WARN;
+        record.file  = __FILE__;
+        record.line  = __LINE__;
+        record.func  = __func__;
+        record.time  = time(0);
+
+        snprintf(record.msg, sizeof(record.msg),
+                 "%lu log entries were dropped", (unsigned long)pending);
+
+        log_dispatch(&record);
+    }
+
+    log_batch = false;
+
+    // Flush streams once per batch rather than once per entry. Buffered files
+    // are also written here once their interval has passed, so that entries
+    // do not linger in the buffer while the logger is idle
+    time_t now = time(0);
+
+    for (log_appender_t i = 0; i < LOG_MAX_APPENDERS; i++)
+    {
+        log_appender_data_t* appender = &log_appenders[i];
+
+        bool stream = (count > 0 && log_stream_appender == appender->appender_fp);
+        bool file   = (log_file_appender == appender->appender_fp);
+
+        if (!log_appender_enabled(i) || (!stream && !file))
+            continue;
+
+        if (NULL != appender->lock_fp)
+            appender->lock_fp(true, appender->lock_udata);
+
+        if (stream)
+        {
+            fflush((FILE*)appender->udata);
+        }
+        else
+        {
+            log_file_t* log_file = (log_file_t*)appender->udata;
+
+            if (difftime(now, log_file->flush_time) >= PICO_LOG_FILE_FLUSH_INTERVAL)
+                log_file_flush(log_file, now);
+        }
+
+        if (NULL != appender->lock_fp)
+            appender->lock_fp(false, appender->lock_udata);
+    }
+
+    LOG_ATOMIC_STORE(&log_async_busy, 0);
+
+    return count;
+#else
+    return 0;
+#endif
+}
+
+void
+log_flush (void)
+{
+    // Write queued entries first, so they reach the buffers flushed below
+    log_flush_async();
+
+    time_t now = time(0);
+
+    for (log_appender_t i = 0; i < LOG_MAX_APPENDERS; i++)
+    {
+        log_appender_data_t* appender = &log_appenders[i];
+
+        bool stream = (log_stream_appender == appender->appender_fp);
+        bool file   = (log_file_appender == appender->appender_fp);
+
+        if (!stream && !file)
+            continue;
+
+        if (NULL != appender->lock_fp)
+            appender->lock_fp(true, appender->lock_udata);
+
+        if (stream)
+            fflush((FILE*)appender->udata);
+        else
+            log_file_flush((log_file_t*)appender->udata, now);
+
+        if (NULL != appender->lock_fp)
+            appender->lock_fp(false, appender->lock_udata);
+    }
+}
+
+unsigned long
+log_get_dropped_count (void)
+{
+#ifdef LOG_ATOMICS
+    return (unsigned long)LOG_ATOMIC_LOAD(&log_async_dropped);
+#else
+    return 0;
+#endif
+}
+
+void
+log_write (log_level_t level, const char* file, unsigned line,
+                              const char* func, const char* fmt, ...)
+{
+    // Ensure logger is initialized
+    log_try_init();
+
+    // Only write entry if there are registered appenders and the logger is
+    // enabled
+    if (0 == log_appender_count || !log_enabled)
+    {
+        return;
+    }
+
+    // Ensure valid log level
+    LOG_ASSERT(level < LOG_LEVEL_COUNT);
+
+    // Skip all formatting if no appender admits the entry
+    if (level < log_min_level)
+    {
+        return;
+    }
+
+    va_list args;
+    va_start(args, fmt);
+
+#ifdef LOG_ATOMICS
+    if (LOG_ATOMIC_LOAD(&log_async_enabled))
+    {
+        log_async_push(level, file, line, func, fmt, args);
+        va_end(args);
+        return;
+    }
+#endif
+
+    log_record_t record;
+
+    record.level = level;
+    record.file  = file;
+    record.line  = line;
+    record.func  = func;
+    record.time  = time(0);
+
+    // Format the log message
+    vsnprintf(record.msg, sizeof(record.msg), fmt, args);
+    va_end(args);
+
+    log_dispatch(&record);
+}
+
+/*
+ * Parses a decimal field width or precision. Returns a pointer past the digits
+ * and sets valid to false if the value exceeds LOG_MSG_LEN.
+ */
+static const char*
+log_parse_field (const char* p, bool* valid)
+{
+    size_t value = 0;
+
+    while (*p >= '0' && *p <= '9')
+    {
+        if (value <= LOG_MSG_LEN)
+            value = value * 10 + (size_t)(*p - '0');
+
+        p++;
+    }
+
+    if (value > LOG_MSG_LEN)
+        *valid = false;
+
+    return p;
+}
+
+/*
+ * Parses the conversion specification starting at the '%' in fmt. Returns a
+ * pointer past the specification, the number of '*' fields (each taking an
+ * int argument), and the type of the converted argument. The type is invalid
+ * if the length modifier does not apply to the conversion, or if the width or
+ * precision exceeds LOG_MSG_LEN.
+ */
+static const char*
+log_parse_conversion (const char* fmt, int* stars, log_arg_t* type)
+{
+    const char* p = fmt + 1;
+
+    bool valid = true;
+
+    *stars = 0;
+
+    // Flags
+    while ('\0' != *p && NULL != strchr("-+ #0", *p))
+        p++;
+
+    // Width
+    if ('*' == *p)
+    {
+        (*stars)++;
+        p++;
+    }
+
+    p = log_parse_field(p, &valid);
+
+    // Precision
+    if ('.' == *p)
+    {
+        p++;
+
+        if ('*' == *p)
+        {
+            (*stars)++;
+            p++;
+        }
+
+        p = log_parse_field(p, &valid);
+    }
+
+    // Length modifier
+    char length = '\0';
+
+    if ('h' == *p || 'l' == *p || 'j' == *p || 'z' == *p || 't' == *p || 'L' == *p)
+    {
+        length = *p++;
+
+        if (('h' == length || 'l' == length) && *p == length)
+        {
+            length = ('l' == length) ? 'q' : 'h';
+            p++;
+        }
+    }
+
+    switch (*p)
+    {
+        case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+            switch (length)
+            {
+                case 'l': *type = LOG_ARG_LONG;    break;
+                case 'q': *type = LOG_ARG_LLONG;   break;
+                case 'z': *type = LOG_ARG_SIZE;    break;
+                case 'j': *type = LOG_ARG_INTMAX;  break;
+                case 't': *type = LOG_ARG_PTRDIFF; break;
+                case 'L': *type = LOG_ARG_INVALID; break;
+                default:  *type = LOG_ARG_INT;     break;
+            }
+            break;
+
+        case 'f': case 'F': case 'e': case 'E':
+        case 'g': case 'G': case 'a': case 'A':
+            switch (length)
+            {
+                case '\0': case 'l': *type = LOG_ARG_DOUBLE;  break;
+                case 'L':            *type = LOG_ARG_LDOUBLE; break;
+                default:             *type = LOG_ARG_INVALID; break;
+            }
+            break;
+
+        case 'c':
+            *type = ('\0' == length) ? LOG_ARG_INT : LOG_ARG_INVALID;
+            break;
+
+        case 's':
+            *type = ('\0' == length) ? LOG_ARG_STR : LOG_ARG_INVALID;
+            break;
+
+        case 'p':
+            *type = ('\0' == length) ? LOG_ARG_PTR : LOG_ARG_INVALID;
+            break;
+
+        default:
+            *type = LOG_ARG_INVALID;
+            return p;
+    }
+
+    if (!valid)
+        *type = LOG_ARG_INVALID;
+
+    return p + 1;
+}
+
+/*
+ * Writes a record to the binary appender
+ */
+static void
+log_binary_append (const void* data, size_t size)
+{
+    if (NULL != log_binary_fp)
+        log_binary_fp(data, size, log_binary_udata);
+}
+
+static void
+log_append_format_record (int id)
+{
+    const log_format_data_t* format = &log_formats[id];
+
+    unsigned char data[1 + 3 * sizeof(int) + LOG_FILE_LEN + LOG_FUNC_LEN + LOG_MSG_LEN];
+
+    int level = (int)format->level;
+
+    size_t size = 0;
+
+    data[size++] = LOG_RECORD_FORMAT;
+
+    memcpy(data + size, &id, sizeof(id));                     size += sizeof(id);
+    memcpy(data + size, &level, sizeof(level));               size += sizeof(level);
+    memcpy(data + size, &format->line, sizeof(format->line)); size += sizeof(format->line);
+
+    const char* strs[3] = { format->file, format->func, format->fmt };
+    size_t lens[3]      = { LOG_FILE_LEN, LOG_FUNC_LEN, LOG_MSG_LEN };
+
+    for (int i = 0; i < 3; i++)
+    {
+        size_t len = strlen(strs[i]);
+
+        if (len >= lens[i])
+            len = lens[i] - 1;
+
+        memcpy(data + size, strs[i], len);
+        size += len;
+        data[size++] = '\0';
+    }
+
+    log_binary_append(data, size);
+}
+
+static void
+log_append_clock_record (void)
+{
+    unsigned char data[1 + sizeof(time_t) + sizeof(unsigned long long)];
+
+    data[0] = LOG_RECORD_CLOCK;
+
+    memcpy(data + 1, &log_binary_wall, sizeof(time_t));
+    memcpy(data + 1 + sizeof(time_t), &log_binary_clock, sizeof(unsigned long long));
+
+    log_binary_append(data, sizeof(data));
+}
+
+/*
+ * Registers the format of a call site, or returns -1 if the format table is
+ * full or the format has an unsupported conversion
+ */
+static int
+log_register_format (volatile int* id, log_level_t level, const char* file,
+                     unsigned line, const char* func, const char* fmt)
+{
+#ifdef LOG_ATOMICS
+    log_atomic_t unlocked = 0;
+
+    while (!LOG_ATOMIC_CAS(&log_format_lock, unlocked, 1))
+    {
+        unlocked = 0;
+        LOG_YIELD();
+    }
+#endif
+
+    int result = *id;
+
+    // Another thread may have registered the call site in the meantime
+    if (result < 0 && log_format_count < LOG_MAX_FORMATS)
+    {
+        log_format_data_t* format = &log_formats[log_format_count];
+
+        format->level     = level;
+        format->file      = file;
+        format->line      = line;
+        format->func      = func;
+        format->fmt       = fmt;
+        format->arg_count = 0;
+
+        bool valid = true;
+
+        for (const char* p = fmt; valid && '\0' != *p; )
+        {
+            if ('%' != *p)
+            {
+                p++;
+                continue;
+            }
+
+            if ('%' == p[1])
+            {
+                p += 2;
+                continue;
+            }
+
+            int stars;
+            log_arg_t type;
+
+            p = log_parse_conversion(p, &stars, &type);
+
+            valid = (LOG_ARG_INVALID != type &&
+                     format->arg_count + stars + 1 <= LOG_MAX_ARGS);
+
+            for (int i = 0; valid && i < stars; i++)
+                format->args[format->arg_count++] = LOG_ARG_INT;
+
+            if (valid)
+                format->args[format->arg_count++] = (unsigned char)type;
+        }
+
+        LOG_ASSERT(valid);
+
+        if (valid)
+        {
+            result = log_format_count++;
+
+            // The format must reach the decoder before any of its entries
+            log_append_format_record(result);
+
+#ifdef LOG_ATOMICS
+            // Publish the format to threads reading the ID without the lock
+            LOG_ATOMIC_STORE(id, result);
+#else
+            *id = result;
+#endif
+        }
+    }
+
+#ifdef LOG_ATOMICS
+    LOG_ATOMIC_STORE(&log_format_lock, 0);
+#endif
+
+    return result;
+}
+
+void
+log_set_binary_appender (log_binary_fn appender_fp, log_level_t level, void* udata)
+{
+    // Ensure level is valid
+    LOG_ASSERT(level >= 0 && level < LOG_LEVEL_COUNT);
+
+    log_binary_fp    = appender_fp;
+    log_binary_level = level;
+    log_binary_udata = udata;
+
+    log_binary_wall  = time(0);
+    log_binary_clock = LOG_CLOCK();
+
+    // Make the new log self-contained
+    log_append_clock_record();
+
+    for (int i = 0; i < log_format_count; i++)
+    {
+        log_append_format_record(i);
+    }
+}
+
+#define LOG_PACK(type) \
+        do { \
+            type value = va_arg(args, type); \
+            memcpy(data + size, &value, sizeof(value)); \
+            size += sizeof(value); \
+        } while (0)
+
+void
+log_write_binary (volatile int* id, log_level_t level, const char* file,
+                  unsigned line, const char* func, const char* fmt, ...)
+{
+    // Ensure valid log level
+    LOG_ASSERT(level < LOG_LEVEL_COUNT);
+
+    if (!log_enabled || NULL == log_binary_fp || level < log_binary_level)
+    {
+        return;
+    }
+
+#ifdef LOG_ATOMICS
+    int format_id = (int)LOG_ATOMIC_LOAD(id);
+#else
+    int format_id = *id;
+#endif
+
+    if (format_id < 0)
+    {
+        format_id = log_register_format(id, level, file, line, func, fmt);
+
+        if (format_id < 0)
+            return;
+    }
+
+    const log_format_data_t* format = &log_formats[format_id];
+
+    unsigned char data[LOG_BINARY_LEN];
+
+    unsigned long long clock = LOG_CLOCK();
+
+    size_t size = 0;
+
+    data[size++] = LOG_RECORD_ENTRY;
+
+    memcpy(data + size, &format_id, sizeof(format_id)); size += sizeof(format_id);
+    memcpy(data + size, &clock, sizeof(clock));         size += sizeof(clock);
+
+    // Filled in once the arguments are stored
+    size_t args_pos = size;
+    size += sizeof(unsigned short);
+
+    // Strings share LOG_MSG_LEN bytes, so the other arguments always fit
+    size_t str_room = LOG_MSG_LEN;
+
+    va_list args;
+    va_start(args, fmt);
+
+    for (int i = 0; i < format->arg_count; i++)
+    {
+        switch ((log_arg_t)format->args[i])
+        {
+            case LOG_ARG_INT:     LOG_PACK(int);         break;
+            case LOG_ARG_LONG:    LOG_PACK(long);        break;
+            case LOG_ARG_LLONG:   LOG_PACK(long long);   break;
+            case LOG_ARG_SIZE:    LOG_PACK(size_t);      break;
+            case LOG_ARG_INTMAX:  LOG_PACK(intmax_t);    break;
+            case LOG_ARG_PTRDIFF: LOG_PACK(ptrdiff_t);   break;
+            case LOG_ARG_DOUBLE:  LOG_PACK(double);      break;
+            case LOG_ARG_LDOUBLE: LOG_PACK(long double); break;
+            case LOG_ARG_PTR:     LOG_PACK(void*);       break;
+
+            case LOG_ARG_STR:
+            {
+                const char* str = va_arg(args, const char*);
+
+                if (NULL == str)
+                    str = "(null)";
+
+                size_t len = strlen(str);
+
+                if (len > str_room)
+                    len = str_room;
+
+                str_room -= len;
+
+                unsigned short str_len = (unsigned short)len;
+
+                memcpy(data + size, &str_len, sizeof(str_len));
+                memcpy(data + size + sizeof(str_len), str, len);
+
+                size += sizeof(str_len) + len;
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    va_end(args);
+
+    unsigned short args_size = (unsigned short)(size - args_pos - sizeof(unsigned short));
+    memcpy(data + args_pos, &args_size, sizeof(args_size));
+
+    log_binary_append(data, size);
+}
+
+#undef LOG_PACK
+
+/*
+ * Formats a single argument according to a conversion specification, passing
+ * the '*' fields first
+ */
+#define LOG_UNPACK(type) \
+        do { \
+            type value; \
+            if (pos + sizeof(value) > size) return false; \
+            memcpy(&value, args + pos, sizeof(value)); \
+            pos += sizeof(value); \
+            if (2 == stars) \
+                n = snprintf(out, room, spec, star[0], star[1], value); \
+            else if (1 == stars) \
+                n = snprintf(out, room, spec, star[0], value); \
+            else \
+                n = snprintf(out, room, spec, value); \
+        } while (0)
+
+/*
+ * Formats the message of a binary entry. Returns false if the record is
+ * malformed.
+ */
+static bool
+log_format_binary (char* msg, size_t len, const char* fmt,
+                   const unsigned char* args, size_t size)
+{
+    size_t used = 0;
+    size_t pos  = 0;
+
+    msg[0] = '\0';
+
+    for (const char* p = fmt; '\0' != *p && used + 1 < len; )
+    {
+        if ('%' != *p || '%' == p[1])
+        {
+            msg[used++] = *p;
+            p += ('%' == *p) ? 2 : 1;
+            msg[used] = '\0';
+            continue;
+        }
+
+        int stars;
+        log_arg_t type;
+
+        const char* end = log_parse_conversion(p, &stars, &type);
+
+        char spec[32];
+
+        if (LOG_ARG_INVALID == type || (size_t)(end - p) >= sizeof(spec))
+            return false;
+
+        memcpy(spec, p, (size_t)(end - p));
+        spec[end - p] = '\0';
+
+        int star[2] = { 0, 0 };
+
+        for (int i = 0; i < stars; i++)
+        {
+            if (pos + sizeof(int) > size)
+                return false;
+
+            memcpy(&star[i], args + pos, sizeof(int));
+            pos += sizeof(int);
+
+            // A negative width left-justifies and a negative precision is
+            // ignored, but both are bounded like literal fields
+            if (star[i] > (int)LOG_MSG_LEN || star[i] < -(int)LOG_MSG_LEN)
+                return false;
+        }
+
+        char*  out  = msg + used;
+        size_t room = len - used;
+        int    n    = 0;
+
+        switch (type)
+        {
+            case LOG_ARG_INT:     LOG_UNPACK(int);         break;
+            case LOG_ARG_LONG:    LOG_UNPACK(long);        break;
+            case LOG_ARG_LLONG:   LOG_UNPACK(long long);   break;
+            case LOG_ARG_SIZE:    LOG_UNPACK(size_t);      break;
+            case LOG_ARG_INTMAX:  LOG_UNPACK(intmax_t);    break;
+            case LOG_ARG_PTRDIFF: LOG_UNPACK(ptrdiff_t);   break;
+            case LOG_ARG_DOUBLE:  LOG_UNPACK(double);      break;
+            case LOG_ARG_LDOUBLE: LOG_UNPACK(long double); break;
+            case LOG_ARG_PTR:     LOG_UNPACK(void*);       break;
+
+            case LOG_ARG_STR:
+            {
+                unsigned short str_len;
+                char str[LOG_MSG_LEN + 1];
+
+                if (pos + sizeof(str_len) > size)
+                    return false;
+
+                memcpy(&str_len, args + pos, sizeof(str_len));
+                pos += sizeof(str_len);
+
+                if (str_len > LOG_MSG_LEN || pos + str_len > size)
+                    return false;
+
+                memcpy(str, args + pos, str_len);
+                str[str_len] = '\0';
+                pos += str_len;
+
+                const char* value = str;
+
+                if (2 == stars)
+                    n = snprintf(out, room, spec, star[0], star[1], value);
+                else if (1 == stars)
+                    n = snprintf(out, room, spec, star[0], value);
+                else
+                    n = snprintf(out, room, spec, value);
+
+                break;
+            }
+
+            default:
+                return false;
+        }
+
+        if (n < 0)
+            return false;
+
+        used += ((size_t)n < room) ? (size_t)n : room - 1;
+        p = end;
+    }
+
+    return true;
+}
+
+#undef LOG_UNPACK
+
+size_t
+log_decode_binary (const void* data, size_t size)
+{
+    // Formats found in the records being decoded
+    static log_format_data_t formats[LOG_MAX_FORMATS];
+    static bool              found[LOG_MAX_FORMATS];
+
+    LOG_ASSERT(NULL != data || 0 == size);
+
+    memset(found, 0, sizeof(found));
+
+    time_t             wall  = log_binary_wall;
+    unsigned long long clock = log_binary_clock;
+
+    const unsigned char* bytes = (const unsigned char*)data;
+
+    size_t pos   = 0;
+    size_t count = 0;
+
+    while (pos < size)
+    {
+        unsigned char type = bytes[pos++];
+
+        if (LOG_RECORD_CLOCK == type)
+        {
+            if (pos + sizeof(time_t) + sizeof(unsigned long long) > size)
+                break;
+
+            memcpy(&wall, bytes + pos, sizeof(time_t));
+            memcpy(&clock, bytes + pos + sizeof(time_t), sizeof(unsigned long long));
+
+            pos += sizeof(time_t) + sizeof(unsigned long long);
+        }
+        else if (LOG_RECORD_FORMAT == type)
+        {
+            int id, level;
+            unsigned line;
+
+            if (pos + 2 * sizeof(int) + sizeof(unsigned) > size)
+                break;
+
+            memcpy(&id, bytes + pos, sizeof(id));       pos += sizeof(id);
+            memcpy(&level, bytes + pos, sizeof(level)); pos += sizeof(level);
+            memcpy(&line, bytes + pos, sizeof(line));   pos += sizeof(line);
+
+            const char* strs[3];
+            bool complete = true;
+
+            for (int i = 0; i < 3; i++)
+            {
+                const unsigned char* end = (const unsigned char*)memchr(bytes + pos, '\0', size - pos);
+
+                if (NULL == end)
+                {
+                    complete = false;
+                    break;
+                }
+
+                strs[i] = (const char*)(bytes + pos);
+                pos = (size_t)(end - bytes) + 1;
+            }
+
+            if (!complete)
+                break;
+
+            if (id < 0 || id >= LOG_MAX_FORMATS || level < 0 || level >= LOG_LEVEL_COUNT)
+                continue;
+
+            formats[id].level = (log_level_t)level;
+            formats[id].file  = strs[0];
+            formats[id].line  = line;
+            formats[id].func  = strs[1];
+            formats[id].fmt   = strs[2];
+
+            found[id] = true;
+        }
+        else if (LOG_RECORD_ENTRY == type)
+        {
+            int id;
+            unsigned long long entry_clock;
+            unsigned short args_size;
+
+            if (pos + sizeof(id) + sizeof(entry_clock) + sizeof(args_size) > size)
+                break;
+
+            memcpy(&id, bytes + pos, sizeof(id));                   pos += sizeof(id);
+            memcpy(&entry_clock, bytes + pos, sizeof(entry_clock)); pos += sizeof(entry_clock);
+            memcpy(&args_size, bytes + pos, sizeof(args_size));     pos += sizeof(args_size);
+
+            if (pos + args_size > size)
+                break;
+
+            const unsigned char* args = bytes + pos;
+            pos += args_size;
+
+            const log_format_data_t* format = NULL;
+
+            if (id >= 0 && id < LOG_MAX_FORMATS && found[id])
+                format = &formats[id];
+            else if (id >= 0 && id < log_format_count)
+                format = &log_formats[id];
+
+            if (NULL == format)
+                continue;
+
+            log_record_t record;
+
+            record.level = format->level;
+            record.file  = format->file;
+            record.line  = format->line;
+            record.func  = format->func;
+
+            // Unsigned, since corrupt clocks could overflow a signed difference
+            if (entry_clock >= clock)
+                record.time = wall + (time_t)((entry_clock - clock) / 1000000);
+            else
+                record.time = wall - (time_t)((clock - entry_clock) / 1000000);
+
+            if (!log_format_binary(record.msg, sizeof(record.msg), format->fmt,
+                                   args, args_size))
+                continue;
+
+            log_dispatch(&record);
+
+            count++;
+        }
+        else
+        {
+            // Unknown record, the rest cannot be parsed
+            break;
+        }
+    }
+
+    return count;
+}
+
 #endif // PICO_LOG_IMPLEMENTATION
 
 
@@ -1,6 +1,6 @@
 /**
     @file pico_math.h
-    @brief A 2D math library for games
+    @brief A 2D (and basic 3D) math library for games
 
     ----------------------------------------------------------------------------
     Licensing information at end of header
@@ -24,7 +24,12 @@
     - Written in C99
     - Single header library for easy build system integration
     - Arithmetic for 2D vectors, transforms, and AABBs
+    - 3D vectors and 4x4 matrices compatible with pico_gl
     - Functions for creating and manipulating affine transformations
+    - Batch kernels for transforming arrays of vectors, transforms, and AABBs
+    - Vector streams in SoA form with vectorized arithmetic
+    - Random number generation in bulk and in independent streams
+    - Optional fast approximations of sqrt, sin, cos, and atan2
     - Strikes a solid balance between simplicity and performance
     - Extensive test suite
     - Permissive license (zlib or public domain)
@@ -60,9 +65,41 @@
     functions for computing unions and intersections of AABBs as well as
     for computing the minimum enclosing AABB for a set of points.
 
+    There are also batch versions of the most frequently used transform
+    functions. These map arrays of vectors (interleaved or as separate x/y
+    arrays), transform arrays of AABBs, and compose arrays of transforms, for
+    example when flattening a scene graph. In single precision the kernels use
+    SSE or NEON when available. This can be disabled by defining
+    `PICO_MATH_NO_SIMD` before including the implementation, in which case the
+    kernels fall back to scalar loops.
+
+    For rendering there are 3D and 4D vectors (pv3, pv4) and 4x4 matrices
+    (pm4). Matrix functions include multiplication, inversion, and the usual
+    view (look at) and projection (orthographic and perspective) matrices,
+    which follow the OpenGL conventions. Matrices are stored in column-major
+    order, which in single precision is exactly the layout of `pgl_m4_t` in
+    pico_gl (with transposition disabled, the default). The array `m.m` can
+    therefore be passed directly to functions such as `pgl_set_transform`.
+
+    Vector streams (pv2s) store the components of many vectors in separate x
+    and y arrays (structure of arrays) owned by the caller. Stream functions
+    apply common vector operations to every element and are vectorized in the
+    same way as the batch kernels.
+
     The random number generator uses the xoshiro128** algorithm, which is
     substantially better than `rand()` in terms of the quality of its output
-    without sacrificing too much performance.
+    without sacrificing too much performance. Generators can be split into
+    non-overlapping streams, for example one per thread, using jumps. A four
+    lane generator (prng4_t) advances four such streams at once using SSE2 or
+    NEON, and fills buffers with integers or floats in a single call.
+
+    The library provides fast approximations of the square root (and its
+    reciprocal), sine, cosine, and arctangent, which are accurate to roughly
+    1e-5. They are always available as `pf_fast_*` functions. Defining
+    `PICO_MATH_FAST` replaces `pf_sin`, `pf_cos`, and `pf_atan2` with these
+    approximations, affecting every function that uses them (e.g. `pv2_polar`,
+    `pv2_angle`, and `pt2_rotation`), and makes `pv2_normalize` use the fast
+    reciprocal square root.
 
     Please see the unit tests for some concrete examples.
 
@@ -75,6 +112,9 @@
     > #include "pico_ml.h"
 
     to a source file (once), then simply include the header normally.
+
+    If you want to use the fast approximations, `PICO_MATH_FAST` must be
+    defined consistently wherever the header is included.
 */
 
 #ifndef PICO_MATH_H
@@ -85,6 +125,12 @@
 #include <stdbool.h> // bool, true, false
 #include <stdint.h>  // uint32_t
 
+#if !defined(PICO_MATH_NO_SIMD) && !defined(PICO_MATH_DOUBLE) && \
+    (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+    #include <xmmintrin.h> // _mm_rsqrt_ss
+    #define PM_FAST_SSE
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -119,6 +165,7 @@ extern "C" {
     #define pf_sqrt  sqrt
     #define pf_cos   cos
     #define pf_sin   sin
+    #define pf_tan   tan
     #define pf_acos  acos
     #define pf_asin  asin
     #define pf_atan2 atan2
@@ -148,6 +195,7 @@ extern "C" {
     #define pf_sqrt  sqrtf
     #define pf_cos   cosf
     #define pf_sin   sinf
+    #define pf_tan   tanf
     #define pf_acos  acosf
     #define pf_asin  asinf
     #define pf_atan2 atan2f
@@ -190,6 +238,45 @@ typedef struct
     pv2 min, max;
 } pb2;
 
+/**
+ * @brief A 3D vector
+ */
+typedef struct
+{
+    pfloat x, y, z;
+} pv3;
+
+/**
+ * @brief A 4D vector (homogeneous coordinates)
+ */
+typedef struct
+{
+    pfloat x, y, z, w;
+} pv4;
+
+/**
+ * @brief A 4x4 matrix
+ *
+ * The entries are stored in column-major order, so the entry in row `r` and
+ * column `c` is `m[c * 4 + r]`.
+ */
+typedef struct
+{
+    pfloat m[16];
+} pm4;
+
+/**
+ * @brief A stream of 2D vectors in structure of arrays (SoA) form
+ *
+ * The stream refers to, but does not own, its component arrays.
+ */
+typedef struct
+{
+    pfloat* x;
+    pfloat* y;
+    int count;
+} pv2s;
+
 /*==============================================================================
  * Scalar functions and macros
  *============================================================================*/
@@ -258,6 +345,131 @@ PM_INLINE pfloat pf_normalize_angle(pfloat angle)
     return angle;
 }
 
+/**
+ * @brief Approximates the reciprocal of the square root
+ *
+ * Uses the SSE estimate refined by one Newton step when available (relative
+ * error around 3e-7) and otherwise the well known bit-level estimate refined
+ * by two Newton steps (relative error around 5e-6)
+ */
+PM_INLINE pfloat pf_fast_rsqrt(pfloat c)
+{
+#if defined(PM_FAST_SSE)
+    pfloat r = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(c)));
+    return r * (1.5f - 0.5f * c * r * r);
+#else
+    #ifdef PICO_MATH_DOUBLE
+        union { double f; uint64_t i; } u = { c };
+        u.i = 0x5FE6EB50C7B537A9 - (u.i >> 1);
+    #else
+        union { float f; uint32_t i; } u = { c };
+        u.i = 0x5F375A86 - (u.i >> 1);
+    #endif
+
+    pfloat half = 0.5f * c;
+    pfloat r = u.f;
+
+    r = r * (1.5f - half * r * r);
+    r = r * (1.5f - half * r * r);
+
+    return r;
+#endif
+}
+
+/**
+ * @brief Approximates the square root (zero if `c` is not positive)
+ */
+PM_INLINE pfloat pf_fast_sqrt(pfloat c)
+{
+    return (c > 0.0f) ? c * pf_fast_rsqrt(c) : 0.0f;
+}
+
+/**
+ * @brief Approximates the sine
+ *
+ * The absolute error is below 4e-6 for angles in [-32, 32]. Outside of this
+ * range the error grows with the magnitude of the angle (to about 6e-5 at
+ * 1000), since the range reduction is done in single precision.
+ */
+PM_INLINE pfloat pf_fast_sin(pfloat angle)
+{
+    // Huge angles have no precision left for the reduction below, and would
+    // overflow the conversion to an integer. Infinities and NaN become NaN.
+    if (!(pf_abs(angle) < 65536.0f))
+    {
+        angle = pf_fmod(angle, PM_PI2);
+
+        if (angle != angle)
+            return angle;
+    }
+
+    // Reduce the angle to [-pi/2, pi/2] using sin(x + k * pi) = (-1)^k sin(x),
+    // truncation is much cheaper than floor and avoids branches
+    pfloat q = angle * (1.0f / PM_PI);
+    int32_t k = (int32_t)(q + ((q < 0.0f) ? -0.5f : 0.5f));
+
+    pfloat x = angle - PM_PI * (pfloat)k;
+    pfloat sign = (pfloat)(1 - 2 * (k & 1));
+
+    // Taylor polynomial of degree nine
+    pfloat x2 = x * x;
+
+    return sign * x * (1.0f + x2 * (-1.0f / 6.0f + x2 * (1.0f / 120.0f +
+                       x2 * (-1.0f / 5040.0f + x2 * (1.0f / 362880.0f)))));
+}
+
+/**
+ * @brief Approximates the cosine (same accuracy as `pf_fast_sin`)
+ */
+PM_INLINE pfloat pf_fast_cos(pfloat angle)
+{
+    return pf_fast_sin(angle + PM_PI / 2.0f);
+}
+
+/**
+ * @brief Approximates the arctangent of `y / x` in [-pi, pi] (absolute error
+ * around 1e-5)
+ */
+PM_INLINE pfloat pf_fast_atan2(pfloat y, pfloat x)
+{
+    pfloat ax = pf_abs(x);
+    pfloat ay = pf_abs(y);
+
+    pfloat max = (ax > ay) ? ax : ay;
+    pfloat min = (ax > ay) ? ay : ax;
+
+    if (0.0f == max)
+        return 0.0f;
+
+    // Polynomial approximation of the arctangent in [0, 1] (Abramowitz and
+    // Stegun 4.4.49)
+    pfloat a = min / max;
+    pfloat s = a * a;
+    pfloat r = a * (0.9998660f + s * (-0.3302995f + s * (0.1801410f +
+               s * (-0.0851330f + s * 0.0208351f))));
+
+    // Map back from the first octant
+    if (ay > ax)
+        r = PM_PI / 2.0f - r;
+
+    if (x < 0.0f)
+        r = PM_PI - r;
+
+    return (y < 0.0f) ? -r : r;
+}
+
+// The square root is not replaced since it is a single instruction on most
+// targets, see the benchmark in the unit tests
+#ifdef PICO_MATH_FAST
+    #undef  pf_cos
+    #undef  pf_sin
+    #undef  pf_atan2
+
+    #define pf_cos   pf_fast_cos
+    #define pf_sin   pf_fast_sin
+    #define pf_atan2 pf_fast_atan2
+#endif
+
 /*==============================================================================
  * Vectors
  *============================================================================*/
@@ -337,12 +549,21 @@ PM_INLINE pfloat pv2_len(pv2 v)
  */
 PM_INLINE pv2 pv2_normalize(pv2 v)
 {
+#ifdef PICO_MATH_FAST
+    pfloat c = pv2_len2(v);
+
+    if (c < PM_EPSILON * PM_EPSILON)
+        return pv2_make(0.0f, 0.0f);
+    else
+        return pv2_scale(v, pf_fast_rsqrt(c));
+#else
     pfloat c = pv2_len(v);
 
     if (c < PM_EPSILON)
         return pv2_make(0.0f, 0.0f);
     else
         return pv2_scale(v, 1.0f / c);
+#endif
 }
 
 /**
@@ -462,6 +683,88 @@ PM_INLINE pv2 pv2_ceil(pv2 v)
     return pv2_make(pf_ceil(v.x), pf_ceil(v.y));
 }
 
+/*==============================================================================
+ * Vector streams
+ *============================================================================*/
+
+/*
+ * Stream functions process as many elements as there are in the first input
+ * stream. The output stream must have at least that many elements, as must
+ * the other input streams. The output stream may be the same as an input
+ * stream.
+ */
+
+/**
+ * @brief Constructs a vector stream from component arrays
+ * @param x     The x-coordinates
+ * @param y     The y-coordinates
+ * @param count The number of elements
+ */
+#define pv2s_make(x, y, count) ((const pv2s){ x, y, count })
+
+/**
+ * @brief Returns the vector at the specified index
+ */
+PM_INLINE pv2 pv2s_get(const pv2s* s, int i)
+{
+    return pv2_make(s->x[i], s->y[i]);
+}
+
+/**
+ * @brief Stores a vector at the specified index
+ */
+PM_INLINE void pv2s_set(const pv2s* s, int i, pv2 v)
+{
+    s->x[i] = v.x;
+    s->y[i] = v.y;
+}
+
+/**
+ * @brief Adds two streams
+ */
+void pv2s_add(const pv2s* out, const pv2s* s1, const pv2s* s2);
+
+/**
+ * @brief Subtracts two streams
+ */
+void pv2s_sub(const pv2s* out, const pv2s* s1, const pv2s* s2);
+
+/**
+ * @brief Scales a stream
+ * @param out The scaled stream
+ * @param s   The stream to scale
+ * @param c   The scale factor
+ */
+void pv2s_scale(const pv2s* out, const pv2s* s, pfloat c);
+
+/**
+ * @brief Adds a scaled stream to another stream
+ *
+ * Computes `s1 + s2 * c`, for example to integrate positions from velocities
+ * over a time step.
+ */
+void pv2s_add_scaled(const pv2s* out, const pv2s* s1, const pv2s* s2, pfloat c);
+
+/**
+ * @brief Computes the dot products of the elements of two streams
+ * @param out The dot products
+ * @param s1  The first stream
+ * @param s2  The second stream
+ */
+void pv2s_dot(pfloat out[], const pv2s* s1, const pv2s* s2);
+
+/**
+ * @brief Normalizes the elements of a stream
+ *
+ * Elements shorter than epsilon become the zero vector (see `pv2_normalize`).
+ */
+void pv2s_normalize(const pv2s* out, const pv2s* s);
+
+/**
+ * @brief Linearly interpolates two streams
+ */
+void pv2s_lerp(const pv2s* out, const pv2s* s1, const pv2s* s2, pfloat alpha);
+
 /*==============================================================================
  * 2D Affine Transforms
  *============================================================================*/
@@ -554,6 +857,45 @@ PM_INLINE pv2 pt2_map(const pt2* t, pv2 v)
     return out;
 }
 
+/**
+ * @brief Maps an array of points
+ *
+ * Equivalent to calling `pt2_map` on each point. The input and output arrays
+ * may be the same.
+ *
+ * @param t     The transform
+ * @param in    The points to map
+ * @param out   The mapped points
+ * @param count The number of points
+ */
+void pt2_map_array(const pt2* t, const pv2 in[], pv2 out[], int count);
+
+/**
+ * @brief Maps an array of points stored as separate x and y arrays
+ *
+ * Equivalent to `pt2_map_array`, but for points in structure of arrays (SoA)
+ * form. The input and output arrays may be the same.
+ *
+ * @param t     The transform
+ * @param in_x  The x-coordinates of the points to map
+ * @param in_y  The y-coordinates of the points to map
+ * @param out_x The x-coordinates of the mapped points
+ * @param out_y The y-coordinates of the mapped points
+ * @param count The number of points
+ */
+void pt2_map_soa(const pt2* t,
+                 const pfloat in_x[], const pfloat in_y[],
+                 pfloat out_x[], pfloat out_y[],
+                 int count);
+
+/**
+ * @brief Maps a vector stream (see `pt2_map_soa`)
+ * @param out The mapped stream
+ * @param t   The transform
+ * @param s   The stream to map
+ */
+void pt2_map_stream(const pv2s* out, const pt2* t, const pv2s* s);
+
 /**
  * @brief Returns the determinant of the transform
  */
@@ -573,6 +915,20 @@ pt2 pt2_inv(const pt2* t);
  */
 pt2 pt2_mult(const pt2* t1, const pt2* t2);
 
+/**
+ * @brief Composes arrays of transforms pairwise
+ *
+ * Computes `out[i] = t1[i] * t2[i]`. When flattening a hierarchy, `t1` holds
+ * the world transforms of the parents and `t2` the local transforms of the
+ * children. The output array may be the same as either input array.
+ *
+ * @param t1    The left-hand transforms
+ * @param t2    The right-hand transforms
+ * @param out   The composed transforms
+ * @param count The number of transforms
+ */
+void pt2_mult_array(const pt2 t1[], const pt2 t2[], pt2 out[], int count);
+
 /**
  * @brief Linearly interpolates two transforms
  */
@@ -780,105 +1136,523 @@ pb2 pb2_enclosing(const pv2 verts[], int count);
 pb2 pb2_transform(const pt2* t, const pb2* b);
 
 /**
- * @brief The pseudo random number generator (RNG) state
+ * @brief Transforms an array of AABBs
+ *
+ * Equivalent to calling `pb2_transform` on each box (up to rounding). The
+ * input and output arrays may be the same.
+ *
+ * @param t     The transform
+ * @param in    The boxes to transform
+ * @param out   The transformed boxes
+ * @param count The number of boxes
  */
-typedef struct prng_t
-{
-    uint32_t s[4];
-} prng_t;
+void pb2_transform_array(const pt2* t, const pb2 in[], pb2 out[], int count);
+
+/*==============================================================================
+ * 3D vectors
+ *============================================================================*/
 
 /**
- * @brief Initialize and seed the RNG
- * @param rng A reference to the RNG
- * @param seed The seed (choosing the same seed will yield identical sequences)
+ * @brief Constructs a 3D vector
  */
-void prng_seed(prng_t* rng, uint64_t seed);
+#define pv3_make(x, y, z) ((const pv3){ x, y, z })
 
 /**
- * @brief Generates a pseudo random number in [0, UINT32_MAX]
- * @param rng A reference to the RNG
+ * @brief Returns the zero vector
  */
-uint32_t prng_random(prng_t* rng);
+#define pv3_zero() (pv3_make(0.0f, 0.0f, 0.0f))
 
 /**
- * @brief Generates a psuedo random number in [0, 1]
+ * @brief Returns true if the vectors are equal (within epsilon)
  */
-pfloat pf_random(prng_t* rng);
-
-#ifdef __cplusplus
+PM_INLINE bool pv3_equal(pv3 v1, pv3 v2)
+{
+    return pf_equal(v1.x, v2.x) &&
+           pf_equal(v1.y, v2.y) &&
+           pf_equal(v1.z, v2.z);
 }
-#endif
-
-#endif // PICO_MATH_H
-
-#ifdef PICO_MATH_IMPLEMENTATION
 
-pfloat pf_lerp_angle(pfloat angle1, pfloat angle2, pfloat alpha)
+/**
+ * @brief Adds two vectors
+ */
+PM_INLINE pv3 pv3_add(pv3 v1, pv3 v2)
 {
-    const pv2 v1 = pv2_make(pf_cos(angle1), pf_sin(angle1));
-    const pv2 v2 = pv2_make(pf_cos(angle2), pf_sin(angle2));
-
-    // Calculuate cosine of angle between the two vectors
-    pfloat dot = pf_clamp(pv2_dot(v1, v2), -1.0f, 1.0f);
-
-    // LERP if the cosine is too close to its limits
-    if (pf_equal(dot, 1.0f) || pf_equal(dot, -1.0f))
-    {
-        pv2 tmp = pv2_lerp(v1, v2, alpha);
-        return pf_normalize_angle(pf_atan2(tmp.y, tmp.x));
-    }
-
-    // Calculate angle
-    pfloat angle = pf_acos(dot) * alpha;
-
-    // Gram-Schmidt(construct a new vector 'v0' that is orthogonal to 'v1')
-    pv2 v0  = pv2_sub(v2, pv2_scale(v1, dot));
-    v0 = pv2_normalize(v0);
+    return pv3_make(v1.x + v2.x, v1.y + v2.y, v1.z + v2.z);
+}
 
-    // Calcuate vector in new coordinate system
-    pv2 tmp1 = pv2_scale(v1, pf_cos(angle));
-    pv2 tmp2 = pv2_scale(v0, pf_sin(angle));
+/**
+ * @brief Subtracts two vectors
+ */
+PM_INLINE pv3 pv3_sub(pv3 v1, pv3 v2)
+{
+    return pv3_make(v1.x - v2.x, v1.y - v2.y, v1.z - v2.z);
+}
 
-    pv2 tmp = pv2_add(tmp1, tmp2);
+/**
+ * @brief Scales a vector
+ */
+PM_INLINE pv3 pv3_scale(pv3 v, pfloat c)
+{
+    return pv3_make(v.x * c, v.y * c, v.z * c);
+}
 
-    // Calculate new angle
-    return pf_normalize_angle(pf_atan2(tmp.y, tmp.x));
+/**
+ * @brief Computes the dot product of two vectors
+ */
+PM_INLINE pfloat pv3_dot(pv3 v1, pv3 v2)
+{
+    return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z;
 }
 
-bool pt2_equal(const pt2* t1, const pt2* t2)
+/**
+ * @brief Computes the cross product of two vectors
+ */
+PM_INLINE pv3 pv3_cross(pv3 v1, pv3 v2)
 {
-    return pf_equal(t1->t00, t2->t00) &&
-           pf_equal(t1->t10, t2->t10) &&
-           pf_equal(t1->t01, t2->t01) &&
-           pf_equal(t1->t11, t2->t11) &&
-           pf_equal(t1->tx,  t2->tx)  &&
-           pf_equal(t1->ty,  t2->ty);
+    return pv3_make(v1.y * v2.z - v1.z * v2.y,
+                    v1.z * v2.x - v1.x * v2.z,
+                    v1.x * v2.y - v1.y * v2.x);
 }
 
-void pt2_set_scale(pt2* t, pv2 scale)
+/**
+ * @brief Returns the square of the length of the vector
+ */
+PM_INLINE pfloat pv3_len2(pv3 v)
 {
-    pfloat angle = pt2_get_angle(t);
+    return pv3_dot(v, v);
+}
 
-    pfloat c = pf_cos(angle);
-    pfloat s = pf_sin(angle);
+/**
+ * @brief Returns the length of the vector
+ */
+PM_INLINE pfloat pv3_len(pv3 v)
+{
+    return pf_sqrt(pv3_len2(v));
+}
 
-    pfloat sx = scale.x;
-    pfloat sy = scale.y;
+/**
+ * @brief Normalizes a vector (returns a unit vector in the same direction)
+ */
+PM_INLINE pv3 pv3_normalize(pv3 v)
+{
+    pfloat c = pv3_len(v);
 
-    t->t00 = sx * c; t->t01 = sy * -s;
-    t->t10 = sx * s; t->t11 = sy *  c;
+    if (c < PM_EPSILON)
+        return pv3_zero();
+    else
+        return pv3_scale(v, 1.0f / c);
 }
 
-pv2 pt2_get_scale(const pt2* t)
+/**
+ * @brief Linearly interpolates between two vectors
+ */
+PM_INLINE pv3 pv3_lerp(pv3 v1, pv3 v2, pfloat alpha)
 {
-    pfloat angle = pt2_get_angle(t);
-    pfloat cos_sign = pf_sign(pf_cos(angle));
+    return pv3_make(pf_lerp(v1.x, v2.x, alpha),
+                    pf_lerp(v1.y, v2.y, alpha),
+                    pf_lerp(v1.z, v2.z, alpha));
+}
 
-    pv2 out;
+/**
+ * @brief Constructs a 4D vector
+ */
+#define pv4_make(x, y, z, w) ((const pv4){ x, y, z, w })
 
-    if (0.0f == cos_sign) //TODO: pf_equal?
-    {
-        out.x =  t->t10;
+/**
+ * @brief Returns true if the vectors are equal (within epsilon)
+ */
+PM_INLINE bool pv4_equal(pv4 v1, pv4 v2)
+{
+    return pf_equal(v1.x, v2.x) &&
+           pf_equal(v1.y, v2.y) &&
+           pf_equal(v1.z, v2.z) &&
+           pf_equal(v1.w, v2.w);
+}
+
+/**
+ * @brief Computes the dot product of two vectors
+ */
+PM_INLINE pfloat pv4_dot(pv4 v1, pv4 v2)
+{
+    return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z + v1.w * v2.w;
+}
+
+/*==============================================================================
+ * 4x4 matrices
+ *============================================================================*/
+
+/**
+ * @brief Returns the identity matrix
+ */
+PM_INLINE pm4 pm4_identity(void)
+{
+    pm4 out = {{ 1.0f, 0.0f, 0.0f, 0.0f,
+                 0.0f, 1.0f, 0.0f, 0.0f,
+                 0.0f, 0.0f, 1.0f, 0.0f,
+                 0.0f, 0.0f, 0.0f, 1.0f }};
+    return out;
+}
+
+/**
+ * @brief Returns true if the matrices are equal (within epsilon)
+ */
+bool pm4_equal(const pm4* m1, const pm4* m2);
+
+/**
+ * @brief Returns the entry in the specified row and column
+ */
+PM_INLINE pfloat pm4_get(const pm4* m, int row, int col)
+{
+    return m->m[col * 4 + row];
+}
+
+/**
+ * @brief Sets the entry in the specified row and column
+ */
+PM_INLINE void pm4_set(pm4* m, int row, int col, pfloat value)
+{
+    m->m[col * 4 + row] = value;
+}
+
+/**
+ * @brief Multiplies a vector by a matrix
+ */
+PM_INLINE pv4 pm4_map(const pm4* m, pv4 v)
+{
+    const pfloat* a = m->m;
+
+    return pv4_make(a[0] * v.x + a[4] * v.y + a[8]  * v.z + a[12] * v.w,
+                    a[1] * v.x + a[5] * v.y + a[9]  * v.z + a[13] * v.w,
+                    a[2] * v.x + a[6] * v.y + a[10] * v.z + a[14] * v.w,
+                    a[3] * v.x + a[7] * v.y + a[11] * v.z + a[15] * v.w);
+}
+
+/**
+ * @brief Transforms a point (with implicit `w = 1`), dividing by the
+ * resulting `w` if it is not one (for example, with perspective projections)
+ */
+PM_INLINE pv3 pm4_map_point(const pm4* m, pv3 p)
+{
+    pv4 v = pm4_map(m, pv4_make(p.x, p.y, p.z, 1.0f));
+
+    if (1.0f != v.w && 0.0f != v.w)
+        return pv3_make(v.x / v.w, v.y / v.w, v.z / v.w);
+    else
+        return pv3_make(v.x, v.y, v.z);
+}
+
+/**
+ * @brief Multiplies two matrices (`m1 * m2`)
+ *
+ * The product applies `m2` first, then `m1`. In single precision the product
+ * is computed using SSE or NEON when available.
+ */
+pm4 pm4_mult(const pm4* m1, const pm4* m2);
+
+/**
+ * @brief Returns the transpose of a matrix
+ */
+pm4 pm4_transpose(const pm4* m);
+
+/**
+ * @brief Computes the determinant of a matrix
+ */
+pfloat pm4_det(const pm4* m);
+
+/**
+ * @brief Computes the inverse of a matrix
+ *
+ * Returns the identity if the matrix is singular (the same as `pt2_inv`)
+ */
+pm4 pm4_inv(const pm4* m);
+
+/**
+ * @brief Constructs a translation matrix
+ */
+pm4 pm4_translation(pv3 pos);
+
+/**
+ * @brief Constructs a scaling matrix
+ */
+pm4 pm4_scaling(pv3 scale);
+
+/**
+ * @brief Constructs a rotation about an axis
+ * @param axis  The axis of rotation (need not be normalized)
+ * @param angle The angle of rotation (counter-clockwise about the axis)
+ */
+pm4 pm4_rotation(pv3 axis, pfloat angle);
+
+/**
+ * @brief Constructs a view matrix (the same as `gluLookAt`)
+ * @param eye    The position of the camera
+ * @param target The point the camera faces
+ * @param up     The up direction
+ */
+pm4 pm4_look_at(pv3 eye, pv3 target, pv3 up);
+
+/**
+ * @brief Constructs an orthographic projection (the same as `glOrtho`)
+ */
+pm4 pm4_ortho(pfloat left, pfloat right,
+              pfloat bottom, pfloat top,
+              pfloat znear, pfloat zfar);
+
+/**
+ * @brief Constructs a perspective projection (the same as `gluPerspective`)
+ * @param fovy   The vertical field of view (in radians)
+ * @param aspect The aspect ratio (width / height)
+ * @param znear  The distance to the near plane (positive)
+ * @param zfar   The distance to the far plane (positive)
+ */
+pm4 pm4_perspective(pfloat fovy, pfloat aspect, pfloat znear, pfloat zfar);
+
+/**
+ * @brief Converts a 2D transform into a 4x4 matrix (in the xy-plane)
+ *
+ * This avoids building `pgl_m3_t` or `pgl_m4_t` by hand when passing a
+ * transform to pico_gl.
+ */
+pm4 pm4_from_pt2(const pt2* t);
+
+/**
+ * @brief The pseudo random number generator (RNG) state
+ */
+typedef struct prng_t
+{
+    uint32_t s[4];
+} prng_t;
+
+/**
+ * @brief Initialize and seed the RNG
+ * @param rng A reference to the RNG
+ * @param seed The seed (choosing the same seed will yield identical sequences)
+ */
+void prng_seed(prng_t* rng, uint64_t seed);
+
+/**
+ * @brief Generates a pseudo random number in [0, UINT32_MAX]
+ * @param rng A reference to the RNG
+ */
+uint32_t prng_random(prng_t* rng);
+
+/**
+ * @brief Generates a psuedo random number in [0, 1]
+ */
+pfloat pf_random(prng_t* rng);
+
+/**
+ * @brief Advances the RNG by 2^64 steps
+ *
+ * This is equivalent to 2^64 calls to `prng_random`, so starting from the same
+ * state, successive jumps yield 2^64 non-overlapping values per stream.
+ */
+void prng_jump(prng_t* rng);
+
+/**
+ * @brief Advances the RNG by 2^96 steps
+ */
+void prng_long_jump(prng_t* rng);
+
+/**
+ * @brief Splits off an independent stream from the RNG
+ *
+ * The new stream continues from the current state of the RNG, which then
+ * performs a long jump. Each split stream therefore has 2^96 values that
+ * never overlap those of other streams split from the same RNG.
+ *
+ * @param rng The RNG to split
+ * @param out The new RNG
+ */
+void prng_split(prng_t* rng, prng_t* out);
+
+/**
+ * @brief A four lane pseudo random number generator (RNG) state
+ *
+ * The state for each lane is an independent xoshiro128** stream. The state
+ * words are stored by lane (`s[word][lane]`) so all lanes step at once.
+ */
+typedef struct prng4_t
+{
+    uint32_t s[4][4];
+} prng4_t;
+
+/**
+ * @brief Initializes a four lane RNG from an RNG
+ *
+ * Lane `i` starts from the state of `rng` after `i` jumps (see `prng_jump`),
+ * so lane streams do not overlap. The state of `rng` is not modified. Use
+ * `prng_split` to obtain an RNG for each four lane generator.
+ */
+void prng4_init(prng4_t* rng4, const prng_t* rng);
+
+/**
+ * @brief Initialize and seed a four lane RNG
+ */
+void prng4_seed(prng4_t* rng4, uint64_t seed);
+
+/**
+ * @brief Fills a buffer with pseudo random numbers in [0, UINT32_MAX]
+ *
+ * The buffer is filled by stepping all lanes and storing the four results
+ * consecutively. If `count` is not a multiple of four, the excess results of
+ * the final step are discarded.
+ *
+ * @param rng4  The four lane RNG
+ * @param out   The buffer to fill
+ * @param count The number of values
+ */
+void prng4_fill(prng4_t* rng4, uint32_t out[], int count);
+
+/**
+ * @brief Fills a buffer with pseudo random numbers in [0, 1]
+ *
+ * Each value is computed from the value of `prng4_fill` in the same way as
+ * `pf_random`.
+ */
+void pf_random_fill(prng4_t* rng4, pfloat out[], int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PICO_MATH_H
+
+#ifdef PICO_MATH_IMPLEMENTATION
+
+#if !defined(PICO_MATH_NO_SIMD) && !defined(PICO_MATH_DOUBLE)
+    #if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+        #include <xmmintrin.h>
+        #define PM_SIMD_SSE
+
+        #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+            #include <emmintrin.h>
+            #define PM_SIMD_SSE2
+        #endif
+    #elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+        #include <arm_neon.h>
+        #define PM_SIMD_NEON
+    #endif
+#endif
+
+// Four lane vectors common to SSE and NEON
+#if defined(PM_SIMD_SSE)
+    #define PM_SIMD
+
+    typedef __m128 pm_f4;
+
+    #define pm_f4_set1  _mm_set1_ps
+    #define pm_f4_load  _mm_loadu_ps
+    #define pm_f4_store _mm_storeu_ps
+    #define pm_f4_add   _mm_add_ps
+    #define pm_f4_sub   _mm_sub_ps
+    #define pm_f4_mul   _mm_mul_ps
+#elif defined(PM_SIMD_NEON)
+    #define PM_SIMD
+
+    typedef float32x4_t pm_f4;
+
+    #define pm_f4_set1  vdupq_n_f32
+    #define pm_f4_load  vld1q_f32
+    #define pm_f4_store vst1q_f32
+    #define pm_f4_add   vaddq_f32
+    #define pm_f4_sub   vsubq_f32
+    #define pm_f4_mul   vmulq_f32
+#endif
+
+// Four lane unsigned integer vectors (used by the four lane RNG)
+#if defined(PM_SIMD_SSE2)
+    #define PM_SIMD_INT
+
+    typedef __m128i pm_u4;
+
+    #define pm_u4_load(p)     _mm_loadu_si128((const __m128i*)(p))
+    #define pm_u4_store(p, v) _mm_storeu_si128((__m128i*)(p), v)
+    #define pm_u4_add         _mm_add_epi32
+    #define pm_u4_or          _mm_or_si128
+    #define pm_u4_xor         _mm_xor_si128
+    #define pm_u4_shl         _mm_slli_epi32
+    #define pm_u4_shr         _mm_srli_epi32
+#elif defined(PM_SIMD_NEON)
+    #define PM_SIMD_INT
+
+    typedef uint32x4_t pm_u4;
+
+    #define pm_u4_load  vld1q_u32
+    #define pm_u4_store vst1q_u32
+    #define pm_u4_add   vaddq_u32
+    #define pm_u4_or    vorrq_u32
+    #define pm_u4_xor   veorq_u32
+    #define pm_u4_shl   vshlq_n_u32
+    #define pm_u4_shr   vshrq_n_u32
+#endif
+
+pfloat pf_lerp_angle(pfloat angle1, pfloat angle2, pfloat alpha)
+{
+    const pv2 v1 = pv2_make(pf_cos(angle1), pf_sin(angle1));
+    const pv2 v2 = pv2_make(pf_cos(angle2), pf_sin(angle2));
+
+    // Calculuate cosine of angle between the two vectors
+    pfloat dot = pf_clamp(pv2_dot(v1, v2), -1.0f, 1.0f);
+
+    // LERP if the cosine is too close to its limits
+    if (pf_equal(dot, 1.0f) || pf_equal(dot, -1.0f))
+    {
+        pv2 tmp = pv2_lerp(v1, v2, alpha);
+        return pf_normalize_angle(pf_atan2(tmp.y, tmp.x));
+    }
+
+    // Calculate angle
+    pfloat angle = pf_acos(dot) * alpha;
+
+    // Gram-Schmidt(construct a new vector 'v0' that is orthogonal to 'v1')
+    pv2 v0  = pv2_sub(v2, pv2_scale(v1, dot));
+    v0 = pv2_normalize(v0);
+
+    // Calcuate vector in new coordinate system
+    pv2 tmp1 = pv2_scale(v1, pf_cos(angle));
+    pv2 tmp2 = pv2_scale(v0, pf_sin(angle));
+
+    pv2 tmp = pv2_add(tmp1, tmp2);
+
+    // Calculate new angle
+    return pf_normalize_angle(pf_atan2(tmp.y, tmp.x));
+}
+
+bool pt2_equal(const pt2* t1, const pt2* t2)
+{
+    return pf_equal(t1->t00, t2->t00) &&
+           pf_equal(t1->t10, t2->t10) &&
+           pf_equal(t1->t01, t2->t01) &&
+           pf_equal(t1->t11, t2->t11) &&
+           pf_equal(t1->tx,  t2->tx)  &&
+           pf_equal(t1->ty,  t2->ty);
+}
+
+void pt2_set_scale(pt2* t, pv2 scale)
+{
+    pfloat angle = pt2_get_angle(t);
+
+    pfloat c = pf_cos(angle);
+    pfloat s = pf_sin(angle);
+
+    pfloat sx = scale.x;
+    pfloat sy = scale.y;
+
+    t->t00 = sx * c; t->t01 = sy * -s;
+    t->t10 = sx * s; t->t11 = sy *  c;
+}
+
+pv2 pt2_get_scale(const pt2* t)
+{
+    pfloat angle = pt2_get_angle(t);
+    pfloat cos_sign = pf_sign(pf_cos(angle));
+
+    pv2 out;
+
+    if (0.0f == cos_sign) //TODO: pf_equal?
+    {
+        out.x =  t->t10;
         out.y = -t->t01;
         return out;
     }
@@ -902,46 +1676,360 @@ void pt2_set_angle(pt2* t, pfloat angle)
     pfloat sx = scale.x;
     pfloat sy = scale.y;
 
-    t->t00 = sx * c; t->t01 = sy * -s;
-    t->t10 = sx * s; t->t11 = sy *  c;
+    t->t00 = sx * c; t->t01 = sy * -s;
+    t->t10 = sx * s; t->t11 = sy *  c;
+}
+
+pt2 pt2_inv(const pt2* t)
+{
+    pfloat det = pt2_det(t);
+
+    if (0.0f == det) // Intentionally not using epsilon because determinants
+    {                // can be really small and still be valid
+        return pt2_identity();
+    }
+
+    pfloat inv_det = 1.0f / det;
+
+    pt2 out;
+
+    out.t00 =  t->t11 * inv_det; out.t01 = -t->t01 * inv_det;
+    out.t10 = -t->t10 * inv_det; out.t11 =  t->t00 * inv_det;
+
+    out.tx = (t->t01 * t->ty - t->t11 * t->tx) * inv_det;
+    out.ty = (t->t10 * t->tx - t->t00 * t->ty) * inv_det;
+
+    return out;
+}
+
+pt2 pt2_mult(const pt2* t1, const pt2* t2)
+{
+    pt2 out;
+
+    out.t00 = t1->t00 * t2->t00 + t1->t01 * t2->t10;
+    out.t10 = t1->t10 * t2->t00 + t1->t11 * t2->t10;
+
+    out.t01 = t1->t00 * t2->t01 + t1->t01 * t2->t11;
+    out.t11 = t1->t10 * t2->t01 + t1->t11 * t2->t11;
+
+    out.tx = t1->t00 * t2->tx + t1->t01 * t2->ty + t1->tx;
+    out.ty = t1->t10 * t2->tx + t1->t11 * t2->ty + t1->ty;
+
+    return out;
+}
+
+void pv2s_add(const pv2s* out, const pv2s* s1, const pv2s* s2)
+{
+    int i = 0;
+
+#if defined(PM_SIMD)
+    for (; i + 4 <= s1->count; i += 4)
+    {
+        pm_f4_store(&out->x[i], pm_f4_add(pm_f4_load(&s1->x[i]), pm_f4_load(&s2->x[i])));
+        pm_f4_store(&out->y[i], pm_f4_add(pm_f4_load(&s1->y[i]), pm_f4_load(&s2->y[i])));
+    }
+#endif
+
+    for (; i < s1->count; i++)
+    {
+        out->x[i] = s1->x[i] + s2->x[i];
+        out->y[i] = s1->y[i] + s2->y[i];
+    }
+}
+
+void pv2s_sub(const pv2s* out, const pv2s* s1, const pv2s* s2)
+{
+    int i = 0;
+
+#if defined(PM_SIMD)
+    for (; i + 4 <= s1->count; i += 4)
+    {
+        pm_f4_store(&out->x[i], pm_f4_sub(pm_f4_load(&s1->x[i]), pm_f4_load(&s2->x[i])));
+        pm_f4_store(&out->y[i], pm_f4_sub(pm_f4_load(&s1->y[i]), pm_f4_load(&s2->y[i])));
+    }
+#endif
+
+    for (; i < s1->count; i++)
+    {
+        out->x[i] = s1->x[i] - s2->x[i];
+        out->y[i] = s1->y[i] - s2->y[i];
+    }
+}
+
+void pv2s_scale(const pv2s* out, const pv2s* s, pfloat c)
+{
+    int i = 0;
+
+#if defined(PM_SIMD)
+    const pm_f4 c4 = pm_f4_set1(c);
+
+    for (; i + 4 <= s->count; i += 4)
+    {
+        pm_f4_store(&out->x[i], pm_f4_mul(pm_f4_load(&s->x[i]), c4));
+        pm_f4_store(&out->y[i], pm_f4_mul(pm_f4_load(&s->y[i]), c4));
+    }
+#endif
+
+    for (; i < s->count; i++)
+    {
+        out->x[i] = s->x[i] * c;
+        out->y[i] = s->y[i] * c;
+    }
+}
+
+void pv2s_add_scaled(const pv2s* out, const pv2s* s1, const pv2s* s2, pfloat c)
+{
+    int i = 0;
+
+#if defined(PM_SIMD)
+    const pm_f4 c4 = pm_f4_set1(c);
+
+    for (; i + 4 <= s1->count; i += 4)
+    {
+        pm_f4 x = pm_f4_mul(pm_f4_load(&s2->x[i]), c4);
+        pm_f4 y = pm_f4_mul(pm_f4_load(&s2->y[i]), c4);
+
+        pm_f4_store(&out->x[i], pm_f4_add(pm_f4_load(&s1->x[i]), x));
+        pm_f4_store(&out->y[i], pm_f4_add(pm_f4_load(&s1->y[i]), y));
+    }
+#endif
+
+    for (; i < s1->count; i++)
+    {
+        out->x[i] = s1->x[i] + s2->x[i] * c;
+        out->y[i] = s1->y[i] + s2->y[i] * c;
+    }
+}
+
+void pv2s_dot(pfloat out[], const pv2s* s1, const pv2s* s2)
+{
+    int i = 0;
+
+#if defined(PM_SIMD)
+    for (; i + 4 <= s1->count; i += 4)
+    {
+        pm_f4 x = pm_f4_mul(pm_f4_load(&s1->x[i]), pm_f4_load(&s2->x[i]));
+        pm_f4 y = pm_f4_mul(pm_f4_load(&s1->y[i]), pm_f4_load(&s2->y[i]));
+
+        pm_f4_store(&out[i], pm_f4_add(x, y));
+    }
+#endif
+
+    for (; i < s1->count; i++)
+    {
+        out[i] = s1->x[i] * s2->x[i] + s1->y[i] * s2->y[i];
+    }
+}
+
+void pv2s_normalize(const pv2s* out, const pv2s* s)
+{
+    int i = 0;
+
+// ARMv7 NEON has no vector square root or division
+#if defined(PM_SIMD_SSE)
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 eps = _mm_set1_ps(PM_EPSILON);
+
+    for (; i + 4 <= s->count; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(&s->x[i]);
+        __m128 y = _mm_loadu_ps(&s->y[i]);
+
+        __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)));
+
+        // Zero vectors produce infinities here, which the mask discards
+        __m128 inv = _mm_and_ps(_mm_cmpge_ps(len, eps), _mm_div_ps(one, len));
+
+        _mm_storeu_ps(&out->x[i], _mm_mul_ps(x, inv));
+        _mm_storeu_ps(&out->y[i], _mm_mul_ps(y, inv));
+    }
+#elif defined(PM_SIMD_NEON) && defined(__aarch64__)
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t eps = vdupq_n_f32(PM_EPSILON);
+
+    for (; i + 4 <= s->count; i += 4)
+    {
+        float32x4_t x = vld1q_f32(&s->x[i]);
+        float32x4_t y = vld1q_f32(&s->y[i]);
+
+        float32x4_t len = vsqrtq_f32(vaddq_f32(vmulq_f32(x, x), vmulq_f32(y, y)));
+
+        // Zero vectors produce infinities here, which the mask discards
+        uint32x4_t mask = vcgeq_f32(len, eps);
+        float32x4_t inv = vreinterpretq_f32_u32(vandq_u32(mask,
+                              vreinterpretq_u32_f32(vdivq_f32(one, len))));
+
+        vst1q_f32(&out->x[i], vmulq_f32(x, inv));
+        vst1q_f32(&out->y[i], vmulq_f32(y, inv));
+    }
+#endif
+
+    for (; i < s->count; i++)
+    {
+        pv2s_set(out, i, pv2_normalize(pv2s_get(s, i)));
+    }
+}
+
+void pv2s_lerp(const pv2s* out, const pv2s* s1, const pv2s* s2, pfloat alpha)
+{
+    int i = 0;
+
+#if defined(PM_SIMD)
+    const pm_f4 a4 = pm_f4_set1(alpha);
+
+    for (; i + 4 <= s1->count; i += 4)
+    {
+        pm_f4 x1 = pm_f4_load(&s1->x[i]);
+        pm_f4 y1 = pm_f4_load(&s1->y[i]);
+
+        pm_f4 x = pm_f4_mul(pm_f4_sub(pm_f4_load(&s2->x[i]), x1), a4);
+        pm_f4 y = pm_f4_mul(pm_f4_sub(pm_f4_load(&s2->y[i]), y1), a4);
+
+        pm_f4_store(&out->x[i], pm_f4_add(x1, x));
+        pm_f4_store(&out->y[i], pm_f4_add(y1, y));
+    }
+#endif
+
+    for (; i < s1->count; i++)
+    {
+        out->x[i] = pf_lerp(s1->x[i], s2->x[i], alpha);
+        out->y[i] = pf_lerp(s1->y[i], s2->y[i], alpha);
+    }
+}
+
+void pt2_map_array(const pt2* t, const pv2 in[], pv2 out[], int count)
+{
+    int i = 0;
+
+#if defined(PM_SIMD_SSE)
+    const __m128 c0 = _mm_setr_ps(t->t00, t->t10, t->t00, t->t10);
+    const __m128 c1 = _mm_setr_ps(t->t01, t->t11, t->t01, t->t11);
+    const __m128 c2 = _mm_setr_ps(t->tx,  t->ty,  t->tx,  t->ty);
+
+    // Two points per iteration
+    for (; i + 2 <= count; i += 2)
+    {
+        __m128 v = _mm_loadu_ps(&in[i].x);
+        __m128 x = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 0, 0));
+        __m128 y = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 1, 1));
+
+        v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, x), _mm_mul_ps(c1, y)), c2);
+        _mm_storeu_ps(&out[i].x, v);
+    }
+#elif defined(PM_SIMD_NEON)
+    const float32x4_t c0 = vcombine_f32(vld1_f32(&t->t00), vld1_f32(&t->t00));
+    const float32x4_t c1 = vcombine_f32(vld1_f32(&t->t01), vld1_f32(&t->t01));
+    const float32x4_t c2 = vcombine_f32(vld1_f32(&t->tx),  vld1_f32(&t->tx));
+
+    // Two points per iteration
+    for (; i + 2 <= count; i += 2)
+    {
+        float32x4_t v = vld1q_f32(&in[i].x);
+        float32x4x2_t xy = vtrnq_f32(v, v);
+
+        v = vaddq_f32(vaddq_f32(vmulq_f32(c0, xy.val[0]),
+                                vmulq_f32(c1, xy.val[1])), c2);
+        vst1q_f32(&out[i].x, v);
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        out[i] = pt2_map(t, in[i]);
+    }
+}
+
+void pt2_map_soa(const pt2* t,
+                 const pfloat in_x[], const pfloat in_y[],
+                 pfloat out_x[], pfloat out_y[],
+                 int count)
+{
+    int i = 0;
+
+#if defined(PM_SIMD)
+    const pm_f4 t00 = pm_f4_set1(t->t00), t01 = pm_f4_set1(t->t01);
+    const pm_f4 t10 = pm_f4_set1(t->t10), t11 = pm_f4_set1(t->t11);
+    const pm_f4 tx  = pm_f4_set1(t->tx),  ty  = pm_f4_set1(t->ty);
+
+    // Four points per iteration
+    for (; i + 4 <= count; i += 4)
+    {
+        pm_f4 x = pm_f4_load(&in_x[i]);
+        pm_f4 y = pm_f4_load(&in_y[i]);
+
+        pm_f4 mx = pm_f4_add(pm_f4_add(pm_f4_mul(t00, x), pm_f4_mul(t01, y)), tx);
+        pm_f4 my = pm_f4_add(pm_f4_add(pm_f4_mul(t10, x), pm_f4_mul(t11, y)), ty);
+
+        pm_f4_store(&out_x[i], mx);
+        pm_f4_store(&out_y[i], my);
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        pfloat x = in_x[i];
+        pfloat y = in_y[i];
+
+        out_x[i] = t->t00 * x + t->t01 * y + t->tx;
+        out_y[i] = t->t10 * x + t->t11 * y + t->ty;
+    }
+}
+
+void pt2_map_stream(const pv2s* out, const pt2* t, const pv2s* s)
+{
+    pt2_map_soa(t, s->x, s->y, out->x, out->y, s->count);
 }
 
-pt2 pt2_inv(const pt2* t)
+void pt2_mult_array(const pt2 t1[], const pt2 t2[], pt2 out[], int count)
 {
-    pfloat det = pt2_det(t);
+    for (int i = 0; i < count; i++)
+    {
+#if defined(PM_SIMD_SSE)
+        // The columns of the linear part are contiguous: (t00, t10, t01, t11)
+        __m128 a = _mm_loadu_ps(&t1[i].t00);
+        __m128 b = _mm_loadu_ps(&t2[i].t00);
 
-    if (0.0f == det) // Intentionally not using epsilon because determinants
-    {                // can be really small and still be valid
-        return pt2_identity();
-    }
+        __m128 at = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)&t1[i].tx);
+        __m128 bt = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)&t2[i].tx);
 
-    pfloat inv_det = 1.0f / det;
+        __m128 c0 = _mm_movelh_ps(a, a); // (t00, t10, t00, t10)
+        __m128 c1 = _mm_movehl_ps(a, a); // (t01, t11, t01, t11)
 
-    pt2 out;
+        __m128 bx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 0, 0));
+        __m128 by = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 1, 1));
 
-    out.t00 =  t->t11 * inv_det; out.t01 = -t->t01 * inv_det;
-    out.t10 = -t->t10 * inv_det; out.t11 =  t->t00 * inv_det;
+        __m128 tx = _mm_shuffle_ps(bt, bt, _MM_SHUFFLE(0, 0, 0, 0));
+        __m128 ty = _mm_shuffle_ps(bt, bt, _MM_SHUFFLE(1, 1, 1, 1));
 
-    out.tx = (t->t01 * t->ty - t->t11 * t->tx) * inv_det;
-    out.ty = (t->t10 * t->tx - t->t00 * t->ty) * inv_det;
+        __m128 m = _mm_add_ps(_mm_mul_ps(c0, bx), _mm_mul_ps(c1, by));
+        __m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, tx), _mm_mul_ps(c1, ty)), at);
 
-    return out;
-}
+        _mm_storeu_ps(&out[i].t00, m);
+        _mm_storel_pi((__m64*)&out[i].tx, v);
+#elif defined(PM_SIMD_NEON)
+        float32x4_t a = vld1q_f32(&t1[i].t00);
+        float32x4_t b = vld1q_f32(&t2[i].t00);
 
-pt2 pt2_mult(const pt2* t1, const pt2* t2)
-{
-    pt2 out;
+        float32x2_t at = vld1_f32(&t1[i].tx);
+        float32x2_t bt = vld1_f32(&t2[i].tx);
 
-    out.t00 = t1->t00 * t2->t00 + t1->t01 * t2->t10;
-    out.t10 = t1->t10 * t2->t00 + t1->t11 * t2->t10;
+        float32x2_t a0 = vget_low_f32(a);
+        float32x2_t a1 = vget_high_f32(a);
 
-    out.t01 = t1->t00 * t2->t01 + t1->t01 * t2->t11;
-    out.t11 = t1->t10 * t2->t01 + t1->t11 * t2->t11;
+        float32x4x2_t bxy = vtrnq_f32(b, b);
 
-    out.tx = t1->t00 * t2->tx + t1->t01 * t2->ty + t1->tx;
-    out.ty = t1->t10 * t2->tx + t1->t11 * t2->ty + t1->ty;
+        float32x4_t m = vaddq_f32(vmulq_f32(vcombine_f32(a0, a0), bxy.val[0]),
+                                  vmulq_f32(vcombine_f32(a1, a1), bxy.val[1]));
 
-    return out;
+        float32x2_t v = vadd_f32(vadd_f32(vmul_lane_f32(a0, bt, 0),
+                                          vmul_lane_f32(a1, bt, 1)), at);
+
+        vst1q_f32(&out[i].t00, m);
+        vst1_f32(&out[i].tx, v);
+#else
+        out[i] = pt2_mult(&t1[i], &t2[i]);
+#endif
+    }
 }
 
 pt2 pt2_lerp(const pt2* t1, const pt2* t2, pfloat alpha)
@@ -1038,6 +2126,329 @@ pb2 pb2_transform(const pt2* t, const pb2* b)
     return pb2_enclosing(verts, 4);
 }
 
+/*
+ * Each bound of the transformed box is the sum of the extremes of the products
+ * of the transform entries with the box intervals (Arvo's method). This avoids
+ * mapping all four corners.
+ */
+void pb2_transform_array(const pt2* t, const pb2 in[], pb2 out[], int count)
+{
+#if defined(PM_SIMD_SSE)
+    const __m128 cx = _mm_setr_ps(t->t00, t->t00, t->t10, t->t10);
+    const __m128 cy = _mm_setr_ps(t->t01, t->t01, t->t11, t->t11);
+    const __m128 ct = _mm_setr_ps(t->tx,  t->ty,  t->tx,  t->ty);
+
+    for (int i = 0; i < count; i++)
+    {
+        __m128 b = _mm_loadu_ps(&in[i].min.x);
+
+        __m128 x = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 0, 2, 0)); // (min.x, max.x, ...)
+        __m128 y = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 3, 1)); // (min.y, max.y, ...)
+
+        __m128 p = _mm_mul_ps(x, cx);
+        __m128 q = _mm_mul_ps(y, cy);
+
+        __m128 ps = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 3, 0, 1));
+        __m128 qs = _mm_shuffle_ps(q, q, _MM_SHUFFLE(2, 3, 0, 1));
+
+        __m128 lo = _mm_add_ps(_mm_min_ps(p, ps), _mm_min_ps(q, qs));
+        __m128 hi = _mm_add_ps(_mm_max_ps(p, ps), _mm_max_ps(q, qs));
+
+        __m128 r = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+        _mm_storeu_ps(&out[i].min.x, _mm_add_ps(r, ct));
+    }
+#elif defined(PM_SIMD_NEON)
+    const float32x4_t cx = vcombine_f32(vdup_n_f32(t->t00), vdup_n_f32(t->t10));
+    const float32x4_t cy = vcombine_f32(vdup_n_f32(t->t01), vdup_n_f32(t->t11));
+    const float32x4_t ct = vcombine_f32(vld1_f32(&t->tx), vld1_f32(&t->tx));
+
+    for (int i = 0; i < count; i++)
+    {
+        float32x4_t b = vld1q_f32(&in[i].min.x);
+        float32x4x2_t xy = vuzpq_f32(b, b); // (min.x, max.x, ...), (min.y, max.y, ...)
+
+        float32x4_t p = vmulq_f32(xy.val[0], cx);
+        float32x4_t q = vmulq_f32(xy.val[1], cy);
+
+        float32x4_t ps = vrev64q_f32(p);
+        float32x4_t qs = vrev64q_f32(q);
+
+        float32x4_t lo = vaddq_f32(vminq_f32(p, ps), vminq_f32(q, qs));
+        float32x4_t hi = vaddq_f32(vmaxq_f32(p, ps), vmaxq_f32(q, qs));
+
+        float32x4_t r = vuzpq_f32(lo, hi).val[0];
+        vst1q_f32(&out[i].min.x, vaddq_f32(r, ct));
+    }
+#else
+    for (int i = 0; i < count; i++)
+    {
+        pb2 b = in[i];
+
+        pfloat x0 = t->t00 * b.min.x, x1 = t->t00 * b.max.x;
+        pfloat y0 = t->t01 * b.min.y, y1 = t->t01 * b.max.y;
+        pfloat u0 = t->t10 * b.min.x, u1 = t->t10 * b.max.x;
+        pfloat v0 = t->t11 * b.min.y, v1 = t->t11 * b.max.y;
+
+        out[i].min.x = pf_min(x0, x1) + pf_min(y0, y1) + t->tx;
+        out[i].min.y = pf_min(u0, u1) + pf_min(v0, v1) + t->ty;
+        out[i].max.x = pf_max(x0, x1) + pf_max(y0, y1) + t->tx;
+        out[i].max.y = pf_max(u0, u1) + pf_max(v0, v1) + t->ty;
+    }
+#endif
+}
+
+bool pm4_equal(const pm4* m1, const pm4* m2)
+{
+    for (int i = 0; i < 16; i++)
+    {
+        if (!pf_equal(m1->m[i], m2->m[i]))
+            return false;
+    }
+
+    return true;
+}
+
+/*
+ * Each column of the product is a combination of the columns of m1 weighted
+ * by the entries of the corresponding column of m2
+ */
+pm4 pm4_mult(const pm4* m1, const pm4* m2)
+{
+    pm4 out;
+
+    const pfloat* a = m1->m;
+    const pfloat* b = m2->m;
+
+#if defined(PM_SIMD)
+    const pm_f4 a0 = pm_f4_load(&a[0]);
+    const pm_f4 a1 = pm_f4_load(&a[4]);
+    const pm_f4 a2 = pm_f4_load(&a[8]);
+    const pm_f4 a3 = pm_f4_load(&a[12]);
+
+    for (int j = 0; j < 4; j++)
+    {
+        const pfloat* bj = &b[j * 4];
+
+        pm_f4 c = pm_f4_mul(a0, pm_f4_set1(bj[0]));
+        c = pm_f4_add(c, pm_f4_mul(a1, pm_f4_set1(bj[1])));
+        c = pm_f4_add(c, pm_f4_mul(a2, pm_f4_set1(bj[2])));
+        c = pm_f4_add(c, pm_f4_mul(a3, pm_f4_set1(bj[3])));
+
+        pm_f4_store(&out.m[j * 4], c);
+    }
+#else
+    for (int j = 0; j < 4; j++)
+    {
+        const pfloat* bj = &b[j * 4];
+
+        for (int i = 0; i < 4; i++)
+        {
+            out.m[j * 4 + i] = a[i] * bj[0] + a[4 + i] * bj[1] +
+                               a[8 + i] * bj[2] + a[12 + i] * bj[3];
+        }
+    }
+#endif
+
+    return out;
+}
+
+pm4 pm4_transpose(const pm4* m)
+{
+    pm4 out;
+
+    for (int c = 0; c < 4; c++)
+    {
+        for (int r = 0; r < 4; r++)
+            out.m[r * 4 + c] = m->m[c * 4 + r];
+    }
+
+    return out;
+}
+
+/*
+ * Computes the 2x2 minors of the first two and last two groups of four
+ * entries. Since the inverse of the transpose is the transpose of the inverse,
+ * the cofactor expansion below applies to the array regardless of whether it
+ * is read by rows or by columns.
+ */
+static void pm4_minors(const pm4* m, pfloat s[6], pfloat c[6])
+{
+    const pfloat* a = m->m;
+
+    s[0] = a[0] * a[5] - a[4] * a[1];
+    s[1] = a[0] * a[6] - a[4] * a[2];
+    s[2] = a[0] * a[7] - a[4] * a[3];
+    s[3] = a[1] * a[6] - a[5] * a[2];
+    s[4] = a[1] * a[7] - a[5] * a[3];
+    s[5] = a[2] * a[7] - a[6] * a[3];
+
+    c[0] = a[8]  * a[13] - a[12] * a[9];
+    c[1] = a[8]  * a[14] - a[12] * a[10];
+    c[2] = a[8]  * a[15] - a[12] * a[11];
+    c[3] = a[9]  * a[14] - a[13] * a[10];
+    c[4] = a[9]  * a[15] - a[13] * a[11];
+    c[5] = a[10] * a[15] - a[14] * a[11];
+}
+
+pfloat pm4_det(const pm4* m)
+{
+    pfloat s[6], c[6];
+    pm4_minors(m, s, c);
+
+    return s[0] * c[5] - s[1] * c[4] + s[2] * c[3] +
+           s[3] * c[2] - s[4] * c[1] + s[5] * c[0];
+}
+
+pm4 pm4_inv(const pm4* m)
+{
+    pfloat s[6], c[6];
+    pm4_minors(m, s, c);
+
+    pfloat det = s[0] * c[5] - s[1] * c[4] + s[2] * c[3] +
+                 s[3] * c[2] - s[4] * c[1] + s[5] * c[0];
+
+    if (0.0f == det) // See pt2_inv
+        return pm4_identity();
+
+    pfloat inv_det = 1.0f / det;
+
+    const pfloat* a = m->m;
+
+    pm4 out;
+    pfloat* o = out.m;
+
+    o[0]  = ( a[5]  * c[5] - a[6]  * c[4] + a[7]  * c[3]) * inv_det;
+    o[1]  = (-a[1]  * c[5] + a[2]  * c[4] - a[3]  * c[3]) * inv_det;
+    o[2]  = ( a[13] * s[5] - a[14] * s[4] + a[15] * s[3]) * inv_det;
+    o[3]  = (-a[9]  * s[5] + a[10] * s[4] - a[11] * s[3]) * inv_det;
+
+    o[4]  = (-a[4]  * c[5] + a[6]  * c[2] - a[7]  * c[1]) * inv_det;
+    o[5]  = ( a[0]  * c[5] - a[2]  * c[2] + a[3]  * c[1]) * inv_det;
+    o[6]  = (-a[12] * s[5] + a[14] * s[2] - a[15] * s[1]) * inv_det;
+    o[7]  = ( a[8]  * s[5] - a[10] * s[2] + a[11] * s[1]) * inv_det;
+
+    o[8]  = ( a[4]  * c[4] - a[5]  * c[2] + a[7]  * c[0]) * inv_det;
+    o[9]  = (-a[0]  * c[4] + a[1]  * c[2] - a[3]  * c[0]) * inv_det;
+    o[10] = ( a[12] * s[4] - a[13] * s[2] + a[15] * s[0]) * inv_det;
+    o[11] = (-a[8]  * s[4] + a[9]  * s[2] - a[11] * s[0]) * inv_det;
+
+    o[12] = (-a[4]  * c[3] + a[5]  * c[1] - a[6]  * c[0]) * inv_det;
+    o[13] = ( a[0]  * c[3] - a[1]  * c[1] + a[2]  * c[0]) * inv_det;
+    o[14] = (-a[12] * s[3] + a[13] * s[1] - a[14] * s[0]) * inv_det;
+    o[15] = ( a[8]  * s[3] - a[9]  * s[1] + a[10] * s[0]) * inv_det;
+
+    return out;
+}
+
+pm4 pm4_translation(pv3 pos)
+{
+    pm4 out = pm4_identity();
+
+    out.m[12] = pos.x;
+    out.m[13] = pos.y;
+    out.m[14] = pos.z;
+
+    return out;
+}
+
+pm4 pm4_scaling(pv3 scale)
+{
+    pm4 out = pm4_identity();
+
+    out.m[0]  = scale.x;
+    out.m[5]  = scale.y;
+    out.m[10] = scale.z;
+
+    return out;
+}
+
+pm4 pm4_rotation(pv3 axis, pfloat angle)
+{
+    pv3 u = pv3_normalize(axis);
+
+    pfloat c = pf_cos(angle);
+    pfloat s = pf_sin(angle);
+    pfloat k = 1.0f - c;
+
+    pm4 out = pm4_identity();
+
+    // Rodrigues' rotation formula
+    pm4_set(&out, 0, 0, u.x * u.x * k + c);
+    pm4_set(&out, 1, 0, u.y * u.x * k + u.z * s);
+    pm4_set(&out, 2, 0, u.z * u.x * k - u.y * s);
+
+    pm4_set(&out, 0, 1, u.x * u.y * k - u.z * s);
+    pm4_set(&out, 1, 1, u.y * u.y * k + c);
+    pm4_set(&out, 2, 1, u.z * u.y * k + u.x * s);
+
+    pm4_set(&out, 0, 2, u.x * u.z * k + u.y * s);
+    pm4_set(&out, 1, 2, u.y * u.z * k - u.x * s);
+    pm4_set(&out, 2, 2, u.z * u.z * k + c);
+
+    return out;
+}
+
+pm4 pm4_look_at(pv3 eye, pv3 target, pv3 up)
+{
+    pv3 f = pv3_normalize(pv3_sub(target, eye)); // Forward
+    pv3 s = pv3_normalize(pv3_cross(f, up));     // Right
+    pv3 u = pv3_cross(s, f);                     // Up
+
+    pm4 out = pm4_identity();
+
+    pm4_set(&out, 0, 0,  s.x); pm4_set(&out, 0, 1,  s.y); pm4_set(&out, 0, 2,  s.z);
+    pm4_set(&out, 1, 0,  u.x); pm4_set(&out, 1, 1,  u.y); pm4_set(&out, 1, 2,  u.z);
+    pm4_set(&out, 2, 0, -f.x); pm4_set(&out, 2, 1, -f.y); pm4_set(&out, 2, 2, -f.z);
+
+    pm4_set(&out, 0, 3, -pv3_dot(s, eye));
+    pm4_set(&out, 1, 3, -pv3_dot(u, eye));
+    pm4_set(&out, 2, 3,  pv3_dot(f, eye));
+
+    return out;
+}
+
+pm4 pm4_ortho(pfloat left, pfloat right,
+              pfloat bottom, pfloat top,
+              pfloat znear, pfloat zfar)
+{
+    pm4 out = pm4_identity();
+
+    pm4_set(&out, 0, 0,  2.0f / (right - left));
+    pm4_set(&out, 1, 1,  2.0f / (top - bottom));
+    pm4_set(&out, 2, 2, -2.0f / (zfar - znear));
+
+    pm4_set(&out, 0, 3, -(right + left) / (right - left));
+    pm4_set(&out, 1, 3, -(top + bottom) / (top - bottom));
+    pm4_set(&out, 2, 3, -(zfar + znear) / (zfar - znear));
+
+    return out;
+}
+
+pm4 pm4_perspective(pfloat fovy, pfloat aspect, pfloat znear, pfloat zfar)
+{
+    pfloat f = 1.0f / pf_tan(fovy / 2.0f);
+
+    pm4 out = {{ 0.0f }};
+
+    pm4_set(&out, 0, 0, f / aspect);
+    pm4_set(&out, 1, 1, f);
+    pm4_set(&out, 2, 2, (zfar + znear) / (znear - zfar));
+    pm4_set(&out, 2, 3, 2.0f * zfar * znear / (znear - zfar));
+    pm4_set(&out, 3, 2, -1.0f);
+
+    return out;
+}
+
+pm4 pm4_from_pt2(const pt2* t)
+{
+    pm4 out = pm4_identity();
+
+    pm4_set(&out, 0, 0, t->t00); pm4_set(&out, 0, 1, t->t01); pm4_set(&out, 0, 3, t->tx);
+    pm4_set(&out, 1, 0, t->t10); pm4_set(&out, 1, 1, t->t11); pm4_set(&out, 1, 3, t->ty);
+
+    return out;
+}
+
 /*
  * Implementation of the xoshiro128** algorithm
  * https://en.wikipedia.org/wiki/Xorshift
@@ -1068,7 +2479,7 @@ uint32_t prng_random(prng_t* rng)
 {
 	uint32_t *s = rng->s;
 	uint32_t const result = rng_rol32(s[1] * 5, 7) * 9;
-	uint32_t const t = s[1] << 17;
+	uint32_t const t = s[1] << 9;
 
 	s[2] ^= s[0];
 	s[3] ^= s[1];
@@ -1076,7 +2487,7 @@ uint32_t prng_random(prng_t* rng)
 	s[0] ^= s[3];
 
 	s[2] ^= t;
-	s[3] = rng_rol32(s[3], 45);
+	s[3] = rng_rol32(s[3], 11);
 
 	return result;
 }
@@ -1086,6 +2497,208 @@ pfloat pf_random(prng_t* rng)
     return (pfloat)prng_random(rng) / (pfloat)UINT32_MAX;
 }
 
+/*
+ * Jumps are computed by evaluating the jump polynomial of the state
+ * transition, see https://prng.di.unimi.it/xoshiro128starstar.c
+ */
+static void prng_jump_poly(prng_t* rng, const uint32_t poly[4])
+{
+    uint32_t s[4] = { 0, 0, 0, 0 };
+
+    for (int i = 0; i < 4; i++)
+    {
+        for (int b = 0; b < 32; b++)
+        {
+            if (poly[i] & (UINT32_C(1) << b))
+            {
+                for (int j = 0; j < 4; j++)
+                    s[j] ^= rng->s[j];
+            }
+
+            prng_random(rng);
+        }
+    }
+
+    for (int j = 0; j < 4; j++)
+        rng->s[j] = s[j];
+}
+
+void prng_jump(prng_t* rng)
+{
+    static const uint32_t poly[4] = { 0x8764000b, 0xf542d2d3, 0x6fa035c3, 0x77f2db5b };
+    prng_jump_poly(rng, poly);
+}
+
+void prng_long_jump(prng_t* rng)
+{
+    static const uint32_t poly[4] = { 0xb523952e, 0x0b6f099f, 0xccf5a0ef, 0x1c580662 };
+    prng_jump_poly(rng, poly);
+}
+
+void prng_split(prng_t* rng, prng_t* out)
+{
+    *out = *rng;
+    prng_long_jump(rng);
+}
+
+void prng4_init(prng4_t* rng4, const prng_t* rng)
+{
+    prng_t lane = *rng;
+
+    for (int i = 0; i < 4; i++)
+    {
+        for (int j = 0; j < 4; j++)
+            rng4->s[j][i] = lane.s[j];
+
+        prng_jump(&lane);
+    }
+}
+
+void prng4_seed(prng4_t* rng4, uint64_t seed)
+{
+    prng_t rng;
+    prng_seed(&rng, seed);
+    prng4_init(rng4, &rng);
+}
+
+#if defined(PM_SIMD_INT)
+
+#define pm_u4_rol(x, k) pm_u4_or(pm_u4_shl(x, k), pm_u4_shr(x, 32 - (k)))
+
+// Steps all lanes, the multiplications by 5 and 9 are shifts and additions
+static pm_u4 prng4_next(pm_u4 s[4])
+{
+    pm_u4 result = pm_u4_add(pm_u4_shl(s[1], 2), s[1]);
+    result = pm_u4_rol(result, 7);
+    result = pm_u4_add(pm_u4_shl(result, 3), result);
+
+    pm_u4 t = pm_u4_shl(s[1], 9);
+
+    s[2] = pm_u4_xor(s[2], s[0]);
+    s[3] = pm_u4_xor(s[3], s[1]);
+    s[1] = pm_u4_xor(s[1], s[2]);
+    s[0] = pm_u4_xor(s[0], s[3]);
+
+    s[2] = pm_u4_xor(s[2], t);
+    s[3] = pm_u4_rol(s[3], 11);
+
+    return result;
+}
+
+#else
+
+static void prng4_next(prng4_t* rng4, uint32_t out[4])
+{
+    for (int i = 0; i < 4; i++)
+    {
+        prng_t lane = {{ rng4->s[0][i], rng4->s[1][i], rng4->s[2][i], rng4->s[3][i] }};
+
+        out[i] = prng_random(&lane);
+
+        for (int j = 0; j < 4; j++)
+            rng4->s[j][i] = lane.s[j];
+    }
+}
+
+#endif // PM_SIMD_INT
+
+void prng4_fill(prng4_t* rng4, uint32_t out[], int count)
+{
+    int i = 0;
+    uint32_t tmp[4];
+
+#if defined(PM_SIMD_INT)
+    pm_u4 s[4];
+
+    for (int j = 0; j < 4; j++)
+        s[j] = pm_u4_load(rng4->s[j]);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        pm_u4_store(&out[i], prng4_next(s));
+    }
+
+    if (i < count)
+    {
+        pm_u4_store(tmp, prng4_next(s));
+    }
+
+    for (int j = 0; j < 4; j++)
+        pm_u4_store(rng4->s[j], s[j]);
+#else
+    for (; i + 4 <= count; i += 4)
+    {
+        prng4_next(rng4, &out[i]);
+    }
+
+    if (i < count)
+    {
+        prng4_next(rng4, tmp);
+    }
+#endif
+
+    for (int j = 0; i < count; i++, j++)
+    {
+        out[i] = tmp[j];
+    }
+}
+
+void pf_random_fill(prng4_t* rng4, pfloat out[], int count)
+{
+    int i = 0;
+    uint32_t tmp[4];
+
+#if defined(PM_SIMD_INT)
+    pm_u4 s[4];
+
+    for (int j = 0; j < 4; j++)
+        s[j] = pm_u4_load(rng4->s[j]);
+
+    // UINT32_MAX rounds to 2^32 as a float, so the division is exact
+    const pm_f4 scale = pm_f4_set1(1.0f / (pfloat)UINT32_MAX);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        pm_u4 u = prng4_next(s);
+
+    #if defined(PM_SIMD_SSE2)
+        // SSE2 only converts signed integers, so the conversion is split into
+        // two exact halves whose sum is rounded once, as in a direct conversion
+        __m128 hi = _mm_cvtepi32_ps(_mm_srli_epi32(u, 16));
+        __m128 lo = _mm_cvtepi32_ps(_mm_and_si128(u, _mm_set1_epi32(0xffff)));
+        __m128 f  = _mm_add_ps(_mm_mul_ps(hi, _mm_set1_ps(65536.0f)), lo);
+    #else
+        float32x4_t f = vcvtq_f32_u32(u);
+    #endif
+
+        pm_f4_store(&out[i], pm_f4_mul(f, scale));
+    }
+
+    if (i < count)
+    {
+        pm_u4_store(tmp, prng4_next(s));
+    }
+
+    for (int j = 0; j < 4; j++)
+        pm_u4_store(rng4->s[j], s[j]);
+
+    for (int j = 0; i < count; i++, j++)
+    {
+        out[i] = (pfloat)tmp[j] / (pfloat)UINT32_MAX;
+    }
+#else
+    for (; i < count; i += 4)
+    {
+        prng4_fill(rng4, tmp, 4);
+
+        for (int j = 0; j < 4 && i + j < count; j++)
+        {
+            out[i + j] = (pfloat)tmp[j] / (pfloat)UINT32_MAX;
+        }
+    }
+#endif
+}
+
 #endif // PICO_MATH_IMPLEMENTATION
 
 /*
@@ -37,6 +37,33 @@
     Eventually all of the additional space is wasted with no benefit to
     performance.
 
+    Loose trees:
+    ------------
+    In a regular quadtree an item only moves into a subtree if the subtree
+    fully contains it. Items straddling the boundary between subtrees stay in
+    shallow nodes no matter how small they are, and every query has to test
+    them. A loose quadtree, created by `qt_create_loose`, expands the bounds of
+    each node by a factor (typically 2). Items are then placed into the subtree
+    containing their center, and settle at a depth that matches their size.
+    Queries test against the expanded bounds, which overlap, so they visit a
+    few more nodes in exchange for far fewer items per node.
+
+    Value index:
+    ------------
+    By default, `qt_remove` searches the whole tree for the value to remove.
+    Calling `qt_enable_value_index` makes the tree maintain a hash map from each
+    value to the node and slot holding it, which makes `qt_remove` and
+    `qt_update` constant time operations. This suits trees containing moving
+    objects. In this mode, every value in the tree must be unique.
+
+    Linear trees:
+    -------------
+    For geometry that rarely changes, `qt_linear_create` or `qt_linear_build`
+    produce a read-only copy of a tree without any pointers. The nodes are
+    stored breadth-first in a flat array and the items of each subtree occupy a
+    contiguous range of a single buffer, so queries are cache friendly and a
+    subtree contained in the search area is reported as one range.
+
     Usage:
     ------
     To use this library in your project, add the following
@@ -61,6 +88,13 @@
     PICO_QT_FREE
     PICO_QT_MEMCPY
     PICO_QT_MEMSET
+
+    SIMD:
+    -----
+    The items of each node are stored as separate columns of coordinates and
+    values. When compiling for SSE or NEON in single precision, queries test
+    four items at once against the search area. Define PICO_QT_NO_SIMD to
+    always use the scalar code path.
 */
 
 #ifndef PICO_QT_H
@@ -100,6 +134,11 @@ typedef PICO_QT_VALUE_TYPE qt_value_t;
  */
 typedef struct qt_t qt_t;
 
+/**
+ * @brief Static quadtree stored in flat arrays (see `qt_linear_create`)
+ */
+typedef struct qt_linear_t qt_linear_t;
+
 /**
  * @brief Rectangle for representing bounds
  */
@@ -123,6 +162,21 @@ qt_rect_t qt_make_rect(qt_float x, qt_float y, qt_float w, qt_float h);
  */
 qt_t* qt_create(qt_rect_t bounds, int max_depth, void* mem_ctx);
 
+/**
+ * @brief Creates a loose quadtree with the specified global bounds
+ *
+ * The bounds of every node below the root are scaled by `looseness` around
+ * their center, so that the nodes overlap. See the summary for more
+ *
+ * @param bounds    The global bounds
+ * @param max_depth Maximum height of the quadtree
+ * @param looseness The scale applied to node bounds (at least 1, typically 2)
+ * @param mem_ctx   Used to store user data for custom memory allocators
+ *
+ * @returns A quadtree instance
+ */
+qt_t* qt_create_loose(qt_rect_t bounds, int max_depth, qt_float looseness, void* mem_ctx);
+
 /**
  * @brief Destroys a quadtree
  * @param qt The quadtree instance to destroy
@@ -144,11 +198,27 @@ void qt_reset(qt_t* qt);
  */
 void qt_insert(qt_t* qt, qt_rect_t bounds, qt_value_t value);
 
+/**
+ * @brief Replaces the contents of a quadtree with the specified items
+ *
+ * The result is the same as calling `qt_reset` followed by `qt_insert` for each
+ * item, but the items are partitioned top-down in a single pass and the items
+ * array of each node is allocated once with the exact size. This is much
+ * faster for loading large numbers of items.
+ *
+ * @param qt     The quadtree instance
+ * @param rects  The bounds of the items
+ * @param values The values of the items
+ * @param count  The number of items
+ */
+void qt_build(qt_t* qt, const qt_rect_t* rects, const qt_value_t* values, int count);
+
 /**
  * @brief Searches for and removes a value in a quadtree
  *
- * This function is very inefficient. If numerous values need to be removed and
- * reinserted it is advisable to simply rebuild the tree.
+ * This function is very inefficient unless the value index is enabled. If
+ * numerous values need to be removed and reinserted it is advisable to either
+ * enable the index or to simply rebuild the tree.
  *
  * @param qt    The quadtree instance
  * @param value The value to remove
@@ -156,6 +226,31 @@ void qt_insert(qt_t* qt, qt_rect_t bounds, qt_value_t value);
  */
 bool qt_remove(qt_t* qt, qt_value_t value);
 
+/**
+ * @brief Changes the bounds of a value in a quadtree
+ *
+ * The item is only moved to another node if it no longer belongs to the node
+ * it is in, otherwise its bounds are updated in place. This is efficient if
+ * the value index is enabled, otherwise the value must be searched for.
+ *
+ * @param qt     The quadtree instance
+ * @param value  The value to update
+ * @param bounds The new bounds associated with the value
+ * @returns True if the item was found, and false otherwise
+ */
+bool qt_update(qt_t* qt, qt_value_t value, qt_rect_t bounds);
+
+/**
+ * @brief Enables the value index
+ *
+ * The index maps each value to its location in the tree. It is built from the
+ * items already in the tree and is then kept up to date. All values in the tree
+ * must be unique.
+ *
+ * @param qt The quadtree instance
+ */
+void qt_enable_value_index(qt_t* qt);
+
 /**
  * @brief Returns all values associated with items that are either overlapping
  * or contained within the search area
@@ -169,6 +264,178 @@ bool qt_remove(qt_t* qt, qt_value_t value);
  */
 qt_value_t* qt_query(const qt_t* qt, qt_rect_t area, int* size);
 
+/**
+ * @brief Writes the values of items that are either overlapping or contained
+ * within the search area into a caller provided buffer
+ *
+ * This function does not allocate memory. Several threads may query the same
+ * tree concurrently, provided that it is not modified at the same time.
+ *
+ * @param qt       The quadtree instance
+ * @param area     The search area
+ * @param values   The destination buffer (can be NULL if `capacity` is zero)
+ * @param capacity The number of values that fit into the buffer
+ *
+ * @returns The total number of matching values. If this is larger than
+ * `capacity`, only the first `capacity` values were written
+ */
+int qt_query_into(const qt_t* qt, qt_rect_t area, qt_value_t* values, int capacity);
+
+/**
+ * @brief Callback invoked for each value found by `qt_query_visit`
+ *
+ * @param value The value of an item in the search area
+ * @param udata The user data passed to `qt_query_visit`
+ *
+ * @returns True to continue the search, or false to stop it
+ */
+typedef bool (*qt_visit_fn)(qt_value_t value, void* udata);
+
+/**
+ * @brief Invokes a callback for each value of an item that is either
+ * overlapping or contained within the search area
+ *
+ * Like `qt_query_into`, this function does not allocate memory and may be
+ * called from several threads concurrently.
+ *
+ * @param qt       The quadtree instance
+ * @param area     The search area
+ * @param visit_cb The callback
+ * @param udata    User data passed to the callback
+ *
+ * @returns False if the callback stopped the search, and true otherwise
+ */
+bool qt_query_visit(const qt_t* qt, qt_rect_t area, qt_visit_fn visit_cb, void* udata);
+
+/**
+ * @brief Writes the values of items within a distance of a point into a caller
+ * provided buffer
+ *
+ * The distance to an item is measured to the closest point of its bounds.
+ * Subtrees whose bounds are further away than the radius are skipped. Like
+ * `qt_query_into`, this function does not allocate memory.
+ *
+ * @param qt       The quadtree instance
+ * @param x        The x-coordinate of the center
+ * @param y        The y-coordinate of the center
+ * @param radius   The search radius
+ * @param values   The destination buffer (can be NULL if `capacity` is zero)
+ * @param capacity The number of values that fit into the buffer
+ *
+ * @returns The total number of matching values. If this is larger than
+ * `capacity`, only the first `capacity` values were written
+ */
+int qt_query_radius(const qt_t* qt,
+                    qt_float x,
+                    qt_float y,
+                    qt_float radius,
+                    qt_value_t* values,
+                    int capacity);
+
+/**
+ * @brief Finds the items closest to a point
+ *
+ * The distance to an item is measured to the closest point of its bounds.
+ * Subtrees are searched closest first and skipped once they are further away
+ * than the k-th closest item found so far. This function does not allocate
+ * memory.
+ *
+ * @param qt      The quadtree instance
+ * @param x       The x-coordinate of the point
+ * @param y       The y-coordinate of the point
+ * @param k       The maximum number of items to find
+ * @param values  Receives the values, closest first (`k` elements)
+ * @param dist_sq Receives the squared distances of the values (`k` elements)
+ *
+ * @returns The number of values found, which is less than `k` if the tree
+ * holds fewer items
+ */
+int qt_query_nearest(const qt_t* qt,
+                     qt_float x,
+                     qt_float y,
+                     int k,
+                     qt_value_t* values,
+                     qt_float* dist_sq);
+
+/**
+ * @brief A pair of values whose items overlap
+ */
+typedef struct
+{
+    qt_value_t a, b;
+} qt_pair_t;
+
+/**
+ * @brief Finds all pairs of items in the tree whose bounds overlap
+ *
+ * Each pair is reported once. The items of every node are tested against each
+ * other and against the items of its descendants, skipping subtrees that do
+ * not overlap the item. Sibling subtrees are only joined where their bounds
+ * overlap, which happens along shared edges, or across larger regions in loose
+ * trees. This is much faster than running one query per item and removing
+ * duplicates, and suits the broad phase of collision detection. This function
+ * does not allocate memory.
+ *
+ * @param qt       The quadtree instance
+ * @param pairs    The destination buffer (can be NULL if `capacity` is zero)
+ * @param capacity The number of pairs that fit into the buffer
+ *
+ * @returns The total number of overlapping pairs. If this is larger than
+ * `capacity`, only the first `capacity` pairs were written
+ */
+int qt_find_pairs(const qt_t* qt, qt_pair_t* pairs, int capacity);
+
+/**
+ * @brief A unit of work dispatched to a worker pool
+ *
+ * @param data  Opaque data owned by the library
+ * @param index The index of the task
+ */
+typedef void (*qt_task_fn)(void* data, int index);
+
+/**
+ * @brief Runs tasks on a worker pool
+ *
+ * Must call `task(data, i)` exactly once for every `i` in `[0, count)`, from
+ * any thread, and only return once all calls have completed.
+ *
+ * @param task  The task function
+ * @param data  The data to pass to the task function
+ * @param count The number of tasks
+ * @param udata The user data passed to `qt_query_batch`
+ */
+typedef void (*qt_parallel_fn)(qt_task_fn task, void* data, int count, void* udata);
+
+/**
+ * @brief Runs many queries at once
+ *
+ * The results are stored in compressed sparse row form: the values found in
+ * `areas[i]` are `values[offsets[i]]` to `values[offsets[i + 1] - 1]`. The
+ * queries are run in two passes, the first counts the results of each area and
+ * the second writes them. Each pass is split into one task per area, which
+ * are run by `parallel_cb` if it is not NULL.
+ *
+ * @param qt          The quadtree instance
+ * @param areas       The search areas
+ * @param area_count  The number of search areas
+ * @param offsets     Receives the result offsets (`area_count + 1` elements)
+ * @param values      The destination buffer (can be NULL if `capacity` is zero)
+ * @param capacity    The number of values that fit into the buffer
+ * @param parallel_cb Dispatches tasks to a worker pool (can be NULL)
+ * @param udata       The user data passed to `parallel_cb`
+ *
+ * @returns The total number of values. If this is larger than `capacity`, only
+ * the offsets have been written
+ */
+int qt_query_batch(const qt_t* qt,
+                   const qt_rect_t* areas,
+                   int area_count,
+                   int* offsets,
+                   qt_value_t* values,
+                   int capacity,
+                   qt_parallel_fn parallel_cb,
+                   void* udata);
+
 /**
  * @brief Returns all bounds associated with the quadtree's recursive grid
  * structure.
@@ -216,6 +483,83 @@ void qt_clear(qt_t* qt);
  */
 void qt_clean(qt_t* qt);
 
+/**
+ * @brief Creates a linear copy of a quadtree
+ *
+ * A linear tree cannot be modified, but it does not contain any pointers.
+ * Nodes are stored breadth-first in a single array, with the children of each
+ * node next to each other, and all items are stored in one buffer where each
+ * subtree occupies a contiguous range. Empty subtrees are left out. This makes
+ * queries touch far less memory, which suits static geometry.
+ *
+ * The linear tree uses the memory context of the source tree and is
+ * independent of it once created.
+ *
+ * @param qt The quadtree to copy
+ *
+ * @returns A linear quadtree instance
+ */
+qt_linear_t* qt_linear_create(const qt_t* qt);
+
+/**
+ * @brief Bulk loads items straight into a linear quadtree
+ *
+ * This is equivalent to calling `qt_build` on a temporary tree and then
+ * `qt_linear_create`.
+ *
+ * @param bounds    The bounds of the quadtree
+ * @param max_depth Maximum depth of the quadtree
+ * @param rects     The bounds of the items
+ * @param values    The values of the items
+ * @param count     The number of items
+ * @param mem_ctx   Used to store user data for custom memory allocators
+ *
+ * @returns A linear quadtree instance
+ */
+qt_linear_t* qt_linear_build(qt_rect_t bounds,
+                             int max_depth,
+                             const qt_rect_t* rects,
+                             const qt_value_t* values,
+                             int count,
+                             void* mem_ctx);
+
+/**
+ * @brief Destroys a linear quadtree
+ *
+ * @param lqt The linear quadtree instance to destroy
+ */
+void qt_linear_destroy(qt_linear_t* lqt);
+
+/**
+ * @brief Writes the values of items that are either overlapping or contained
+ * within the search area into a caller provided buffer
+ *
+ * Behaves like `qt_query_into`.
+ *
+ * @param lqt      The linear quadtree instance
+ * @param area     The search area
+ * @param values   The destination buffer (can be NULL if `capacity` is zero)
+ * @param capacity The number of values that fit into the buffer
+ *
+ * @returns The total number of matching values
+ */
+int qt_linear_query_into(const qt_linear_t* lqt, qt_rect_t area, qt_value_t* values, int capacity);
+
+/**
+ * @brief Invokes a callback for each value of an item that is either
+ * overlapping or contained within the search area
+ *
+ * Behaves like `qt_query_visit`.
+ *
+ * @param lqt      The linear quadtree instance
+ * @param area     The search area
+ * @param visit_cb The callback
+ * @param udata    User data passed to the callback
+ *
+ * @returns False if the callback stopped the search, and true otherwise
+ */
+bool qt_linear_query_visit(const qt_linear_t* lqt, qt_rect_t area, qt_visit_fn visit_cb, void* udata);
+
 #ifdef __cplusplus
 }
 #endif
@@ -258,6 +602,16 @@ void qt_clean(qt_t* qt);
     #define PICO_QT_BLOCK_SIZE 128
 #endif
 
+#if !defined(PICO_QT_NO_SIMD) && !defined(PICO_QT_USE_DOUBLE)
+    #if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+        #include <xmmintrin.h>
+        #define QT_SIMD_SSE
+    #elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+        #include <arm_neon.h>
+        #define QT_SIMD_NEON
+    #endif
+#endif
+
 /*=============================================================================
  * Internal aliases
  *============================================================================*/
@@ -293,13 +647,29 @@ typedef struct
     qt_value_t value;
 } qt_item_t;
 
+// Items stored as columns, so that several bounds can be tested at once. All
+// columns share a single allocation
+typedef struct
+{
+    int         count;
+    int         capacity;
+    qt_float*   x;
+    qt_float*   y;
+    qt_float*   w;
+    qt_float*   h;
+    qt_value_t* values;
+} qt_items_t;
+
 struct qt_node_t
 {
     int        depth;
     int        max_depth;
+    qt_rect_t  rect;      // Bounds of this node, expanded in loose trees
+    qt_rect_t  cell;      // Bounds of this node before expansion
+    qt_node_t* parent;
     qt_rect_t  bounds[4];
     qt_node_t* nodes[4];
-    qt_array qt_item_t* items;
+    qt_items_t items;
 };
 
 typedef union qt_unode_t
@@ -314,11 +684,50 @@ typedef struct qt_node_allocator_t
     qt_array qt_unode_t** blocks;
 } qt_node_allocator_t;
 
+// Location of an item in the tree
+typedef struct
+{
+    qt_value_t value;
+    qt_node_t* node; // NULL if the entry is unused
+    int        slot;
+} qt_handle_t;
+
+// Open addressing hash map from values to handles
+typedef struct
+{
+    bool         enabled;
+    int          count;
+    int          capacity; // Always a power of two
+    qt_handle_t* handles;
+} qt_index_t;
+
+// Node of a linear tree. Children are stored next to each other starting at
+// `first_child`, so child i lives at `first_child` plus the number of bits set
+// in `child_mask` below bit i
+typedef struct
+{
+    qt_rect_t bounds;        // Bounds of the node as seen from its parent
+    int       first_child;
+    int       child_mask;    // Bit i is set if child i exists
+    int       first_item;
+    int       item_count;    // Items of this node
+    int       subtree_count; // Items of this node and all of its descendants
+} qt_lnode_t;
+
+struct qt_linear_t
+{
+    void*       mem_ctx;
+    int         node_count;
+    qt_lnode_t* nodes;
+    qt_items_t  items;
+};
+
 struct qt_t
 {
     qt_rect_t  bounds;
     qt_node_t* root;
     void*      mem_ctx;
+    qt_float   looseness; // One unless the tree is loose
 
     // A custom allocator is used here to allocate individual nodes.
     // This attempts to pack all the nodes together in memory to try and
@@ -327,6 +736,9 @@ struct qt_t
     // currently in the CPU cache) would incur a cache miss for every single
     // node no matter what.
     qt_node_allocator_t allocator;
+
+    // Maps values to their location (if enabled)
+    qt_index_t index;
 };
 
 /*=============================================================================
@@ -361,6 +773,10 @@ struct qt_t
 // Makes sure the capacity of the array can fit `n` elements.
 #define qt_array_fit(ctx, a, n) ((n) <= qt_array_capacity(a) ? 0 : (*(void**)&(a) = qt_array_fit_impl((a), (n), sizeof(*a), (ctx))))
 
+// Makes sure the capacity of the array can fit `n` elements without
+// allocating any extra space.
+#define qt_array_reserve(ctx, a, n) ((n) <= qt_array_capacity(a) ? 0 : (*(void**)&(a) = qt_array_alloc_impl((a), (n), sizeof(*a), (ctx))))
+
 // Pushes an element onto the array. Will resize itself as necessary.
 #define qt_array_push(ctx, a , ...) (QT_ARRAY_CANARY(a), qt_array_fit((ctx), (a), 1 + ((a) ? qt_array_size(a) : 0)), (a)[qt_array_len(a)++] = (__VA_ARGS__))
 
@@ -383,28 +799,84 @@ static bool qt_rect_contains(const qt_rect_t* r1, const qt_rect_t* r2);
 static bool qt_rect_overlaps(const qt_rect_t* r1, const qt_rect_t* r2);
 
 static void* qt_array_fit_impl(const void* array, int new_size, size_t element_size, void* mem_ctx);
+static void* qt_array_alloc_impl(const void* array, int capacity, size_t element_size, void* mem_ctx);
+
+static void qt_items_reserve(void* mem_ctx, qt_items_t* items, int capacity);
+static void qt_items_push(void* mem_ctx, qt_items_t* items, const qt_rect_t* bounds, qt_value_t value);
+static void qt_items_remove(qt_items_t* items, int i);
+static void qt_items_destroy(void* mem_ctx, qt_items_t* items);
+static qt_rect_t qt_items_bounds(const qt_items_t* items, int i);
+static void qt_items_set_bounds(qt_items_t* items, int i, const qt_rect_t* bounds);
+static bool qt_items_overlap(const qt_items_t* items, int i, const qt_rect_t* area);
+static unsigned qt_items_overlap4(const qt_items_t* items, int i, const qt_rect_t* area);
 
 static qt_node_t* qt_node_alloc(qt_t* qt);
 static void qt_node_free(qt_t* qt, qt_node_t* node);
 
-static qt_node_t* qt_node_create(qt_t* qt, qt_rect_t bounds, int depth, int max_depth);
+static qt_node_t* qt_node_create(qt_t* qt, qt_node_t* parent, qt_rect_t bounds, int depth, int max_depth);
 static void qt_node_destroy(qt_t* qt, qt_node_t* node);
+static qt_rect_t qt_node_quadrant(const qt_node_t* node, int i);
+static qt_rect_t qt_loosen_rect(const qt_t* qt, qt_rect_t rect);
+static int qt_node_child_index(const qt_t* qt, const qt_node_t* node, const qt_rect_t* bounds);
 static void qt_node_insert(qt_t* qt, qt_node_t* node, const qt_rect_t* bounds, qt_value_t value);
-static bool qt_node_remove(qt_node_t* node, qt_value_t value);
-
-static qt_array qt_value_t* qt_node_query(const qt_t* qt, const qt_node_t* node, const qt_rect_t* area, qt_array qt_value_t* values);
+static void qt_node_push(qt_t* qt, qt_node_t* node, const qt_rect_t* bounds, qt_value_t value);
+static void qt_node_remove_at(qt_t* qt, qt_node_t* node, int slot);
+static bool qt_node_find(qt_node_t* node, qt_value_t value, qt_node_t** found, int* slot);
+static bool qt_locate(qt_t* qt, qt_value_t value, qt_node_t** node, int* slot);
+static void qt_node_build(qt_t* qt,
+                          qt_node_t* node,
+                          const qt_rect_t* rects,
+                          const qt_value_t* values,
+                          int* indices,
+                          int* scratch,
+                          int* buckets,
+                          int count);
+
+static bool qt_node_visit(const qt_node_t* node, const qt_rect_t* area, qt_visit_fn visit_cb, void* udata);
+static bool qt_node_visit_all(const qt_node_t* node, qt_visit_fn visit_cb, void* udata);
+static bool qt_collect_value(qt_value_t value, void* udata);
+static bool qt_push_value(qt_value_t value, void* udata);
+static qt_float qt_rect_dist_sq(const qt_rect_t* rect, qt_float x, qt_float y);
+static qt_float qt_items_dist_sq(const qt_items_t* items, int i, qt_float x, qt_float y);
+static void qt_node_query_radius(const qt_node_t* node, qt_float x, qt_float y, qt_float radius_sq, void* collector);
+static void qt_node_query_nearest(const qt_node_t* node, qt_float x, qt_float y, void* data);
+static bool qt_collect_pair(qt_value_t value, void* udata);
+static void qt_node_find_pairs(const qt_node_t* node, void* collector);
+static void qt_node_join_pairs(const qt_node_t* node, const qt_node_t* other, void* collector);
+static void qt_batch_count(void* data, int index);
+static void qt_batch_write(void* data, int index);
+static void qt_run_tasks(qt_parallel_fn parallel_cb, void* udata, qt_task_fn task, void* data, int count);
 static void qt_node_clear(qt_node_t* node);
 
+static bool qt_items_visit(const qt_items_t* items, int begin, int end, const qt_rect_t* area, qt_visit_fn visit_cb, void* udata);
+static int qt_child_count(int child_mask);
+static bool qt_node_is_empty(const qt_node_t* node);
+static int qt_node_measure(const qt_node_t* node, int* node_count);
+static int qt_linear_fill(qt_linear_t* lqt, const qt_node_t** sources, int index, int offset);
+static bool qt_linear_visit(const qt_linear_t* lqt, int index, const qt_rect_t* area, qt_visit_fn visit_cb, void* udata);
+
 static qt_array qt_item_t* qt_node_all_items(const qt_t* qt, const qt_node_t* node, qt_array qt_item_t* items);
-static qt_array qt_value_t* qt_node_all_values(const qt_t* qt, const qt_node_t* node, qt_array qt_value_t* values);
 static qt_array qt_rect_t* qt_node_all_grid_rects(const qt_t* qt, const qt_node_t* node, qt_array qt_rect_t* rects);
 
+static qt_handle_t* qt_index_find(const qt_t* qt, qt_value_t value);
+static void qt_index_set(qt_t* qt, qt_value_t value, qt_node_t* node, int slot);
+static void qt_index_remove(qt_t* qt, qt_value_t value);
+static void qt_index_clear(qt_t* qt);
+static void qt_index_add_node(qt_t* qt, qt_node_t* node);
+
 /*=============================================================================
  * Public API implementation
  *============================================================================*/
 
 qt_t* qt_create(qt_rect_t bounds, int max_depth, void* mem_ctx)
 {
+    return qt_create_loose(bounds, max_depth, 1, mem_ctx);
+}
+
+qt_t* qt_create_loose(qt_rect_t bounds, int max_depth, qt_float looseness, void* mem_ctx)
+{
+    QT_ASSERT(looseness >= 1);
+
     qt_t* qt = (qt_t*)QT_MALLOC(sizeof(qt_t), mem_ctx);
 
     QT_MEMSET(qt, 0, sizeof(*qt));
@@ -412,10 +884,11 @@ qt_t* qt_create(qt_rect_t bounds, int max_depth, void* mem_ctx)
     if (!qt)
         return NULL;
 
-    qt->bounds = bounds;
-    qt->root = qt_node_create(qt, bounds, 0, max_depth);
-
     qt->mem_ctx = mem_ctx;
+    qt->looseness = looseness;
+
+    qt->bounds = bounds;
+    qt->root = qt_node_create(qt, NULL, bounds, 0, max_depth);
 
     return qt;
 }
@@ -432,6 +905,10 @@ void qt_destroy(qt_t* qt)
     }
 
     qt_array_destroy(qt->mem_ctx, qt->allocator.blocks);
+
+    if (qt->index.handles)
+        QT_FREE(qt->index.handles, qt->mem_ctx);
+
     QT_FREE(qt, qt->mem_ctx);
 }
 
@@ -443,7 +920,9 @@ void qt_reset(qt_t* qt)
 
     qt_node_destroy(qt, qt->root);
 
-    qt->root = qt_node_create(qt, qt->bounds, 0, max_depth);
+    qt->root = qt_node_create(qt, NULL, qt->bounds, 0, max_depth);
+
+    qt_index_clear(qt);
 }
 
 void qt_insert(qt_t* qt, qt_rect_t bounds, qt_value_t value)
@@ -452,12 +931,99 @@ void qt_insert(qt_t* qt, qt_rect_t bounds, qt_value_t value)
     qt_node_insert(qt, qt->root, &bounds, value);
 }
 
+void qt_build(qt_t* qt, const qt_rect_t* rects, const qt_value_t* values, int count)
+{
+    QT_ASSERT(qt);
+    QT_ASSERT(count >= 0);
+    QT_ASSERT(0 == count || (rects && values));
+
+    qt_reset(qt);
+
+    if (count <= 0)
+        return;
+
+    // Item indices, scratch space for partitioning them, and the bucket
+    // (child or node) of each item
+    int* indices = (int*)QT_MALLOC(sizeof(int) * count * 3, qt->mem_ctx);
+    int* scratch = indices + count;
+    int* buckets = scratch + count;
+
+    for (int i = 0; i < count; i++)
+    {
+        indices[i] = i;
+    }
+
+    qt_node_build(qt, qt->root, rects, values, indices, scratch, buckets, count);
+
+    QT_FREE(indices, qt->mem_ctx);
+}
+
 bool qt_remove(qt_t* qt, qt_value_t value)
 {
     QT_ASSERT(qt);
-    return qt_node_remove(qt->root, value);
+
+    qt_node_t* node;
+    int slot;
+
+    if (!qt_locate(qt, value, &node, &slot))
+        return false;
+
+    qt_node_remove_at(qt, node, slot);
+
+    return true;
+}
+
+bool qt_update(qt_t* qt, qt_value_t value, qt_rect_t bounds)
+{
+    QT_ASSERT(qt);
+
+    qt_node_t* node;
+    int slot;
+
+    if (!qt_locate(qt, value, &node, &slot))
+        return false;
+
+    // The item stays where it is if the node still contains it (the root
+    // holds anything) and it does not fit into a subtree
+    bool contained = !node->parent || qt_rect_contains(&node->rect, &bounds);
+
+    if (contained && qt_node_child_index(qt, node, &bounds) < 0)
+    {
+        qt_items_set_bounds(&node->items, slot, &bounds);
+        return true;
+    }
+
+    qt_node_remove_at(qt, node, slot);
+
+    // Reinsert starting from the closest node that contains the new bounds
+    while (node->parent && !qt_rect_contains(&node->rect, &bounds))
+    {
+        node = node->parent;
+    }
+
+    qt_node_insert(qt, node, &bounds, value);
+
+    return true;
+}
+
+void qt_enable_value_index(qt_t* qt)
+{
+    QT_ASSERT(qt);
+
+    if (qt->index.enabled)
+        return;
+
+    qt->index.enabled = true;
+    qt_index_add_node(qt, qt->root);
 }
 
+// State of `qt_query`
+typedef struct
+{
+    const qt_t*           qt;
+    qt_array qt_value_t** values;
+} qt_pusher_t;
+
 qt_value_t* qt_query(const qt_t* qt, qt_rect_t area, int* size)
 {
     QT_ASSERT(qt);
@@ -468,7 +1034,8 @@ qt_value_t* qt_query(const qt_t* qt, qt_rect_t area, int* size)
         return NULL;
 
     // Start query the root node
-    qt_array qt_value_t* values = qt_node_query(qt, qt->root, &area, NULL);
+    qt_array qt_value_t* values = NULL;
+    qt_node_visit(qt->root, &area, qt_push_value, &(qt_pusher_t){ qt, &values });
 
     // If no results then return NULL
     if (!values)
@@ -483,6 +1050,153 @@ qt_value_t* qt_query(const qt_t* qt, qt_rect_t area, int* size)
     return values;
 }
 
+// State of `qt_query_into`
+typedef struct
+{
+    qt_value_t* values;
+    int         capacity;
+    int         count;
+} qt_collector_t;
+
+int qt_query_into(const qt_t* qt, qt_rect_t area, qt_value_t* values, int capacity)
+{
+    QT_ASSERT(qt);
+    QT_ASSERT(capacity >= 0);
+    QT_ASSERT(values || 0 == capacity);
+
+    qt_collector_t collector = { values, capacity, 0 };
+
+    qt_node_visit(qt->root, &area, qt_collect_value, &collector);
+
+    return collector.count;
+}
+
+bool qt_query_visit(const qt_t* qt, qt_rect_t area, qt_visit_fn visit_cb, void* udata)
+{
+    QT_ASSERT(qt);
+    QT_ASSERT(visit_cb);
+
+    return qt_node_visit(qt->root, &area, visit_cb, udata);
+}
+
+int qt_query_radius(const qt_t* qt,
+                    qt_float x,
+                    qt_float y,
+                    qt_float radius,
+                    qt_value_t* values,
+                    int capacity)
+{
+    QT_ASSERT(qt);
+    QT_ASSERT(radius >= 0);
+    QT_ASSERT(capacity >= 0);
+    QT_ASSERT(values || 0 == capacity);
+
+    qt_collector_t collector = { values, capacity, 0 };
+
+    qt_node_query_radius(qt->root, x, y, radius * radius, &collector);
+
+    return collector.count;
+}
+
+// State of `qt_query_nearest`
+typedef struct
+{
+    int         k;
+    int         count;
+    qt_value_t* values;
+    qt_float*   dist_sq;
+} qt_nearest_t;
+
+int qt_query_nearest(const qt_t* qt,
+                     qt_float x,
+                     qt_float y,
+                     int k,
+                     qt_value_t* values,
+                     qt_float* dist_sq)
+{
+    QT_ASSERT(qt);
+    QT_ASSERT(k >= 0);
+    QT_ASSERT(values || 0 == k);
+    QT_ASSERT(dist_sq || 0 == k);
+
+    if (k <= 0)
+        return 0;
+
+    qt_nearest_t nearest = { k, 0, values, dist_sq };
+
+    qt_node_query_nearest(qt->root, x, y, &nearest);
+
+    return nearest.count;
+}
+
+// State of `qt_find_pairs`
+typedef struct
+{
+    qt_value_t value; // The item the others are tested against
+    qt_pair_t* pairs;
+    int        capacity;
+    int        count;
+} qt_pair_collector_t;
+
+int qt_find_pairs(const qt_t* qt, qt_pair_t* pairs, int capacity)
+{
+    QT_ASSERT(qt);
+    QT_ASSERT(capacity >= 0);
+    QT_ASSERT(pairs || 0 == capacity);
+
+    qt_pair_collector_t collector = { 0, pairs, capacity, 0 };
+
+    qt_node_find_pairs(qt->root, &collector);
+
+    return collector.count;
+}
+
+// State of `qt_query_batch`
+typedef struct
+{
+    const qt_t*      qt;
+    const qt_rect_t* areas;
+    int*             offsets;
+    qt_value_t*      values;
+} qt_batch_t;
+
+int qt_query_batch(const qt_t* qt,
+                   const qt_rect_t* areas,
+                   int area_count,
+                   int* offsets,
+                   qt_value_t* values,
+                   int capacity,
+                   qt_parallel_fn parallel_cb,
+                   void* udata)
+{
+    QT_ASSERT(qt);
+    QT_ASSERT(area_count >= 0);
+    QT_ASSERT(areas || 0 == area_count);
+    QT_ASSERT(offsets);
+    QT_ASSERT(capacity >= 0);
+    QT_ASSERT(values || 0 == capacity);
+
+    qt_batch_t batch = { qt, areas, offsets, values };
+
+    // Count the results of each area into the next offset
+    offsets[0] = 0;
+    qt_run_tasks(parallel_cb, udata, qt_batch_count, &batch, area_count);
+
+    // Turn the counts into offsets
+    for (int i = 0; i < area_count; i++)
+    {
+        offsets[i + 1] += offsets[i];
+    }
+
+    int total = offsets[area_count];
+
+    // Each area writes its results into its own range of the buffer
+    if (total <= capacity && total > 0)
+        qt_run_tasks(parallel_cb, udata, qt_batch_write, &batch, area_count);
+
+    return total;
+}
+
 qt_rect_t* qt_grid_rects(const qt_t* qt, int* size)
 {
     QT_ASSERT(qt);
@@ -521,6 +1235,7 @@ void qt_clear(qt_t* qt)
 {
     QT_ASSERT(qt);
     qt_node_clear(qt->root);
+    qt_index_clear(qt);
 }
 
 void qt_clean(qt_t* qt)
@@ -539,13 +1254,127 @@ void qt_clean(qt_t* qt)
     qt_array_destroy(qt->mem_ctx, items);
 }
 
-/*=============================================================================
- * Internal function definitions
- *============================================================================*/
-
-static int qt_max(int a, int b)
+qt_linear_t* qt_linear_create(const qt_t* qt)
 {
-    return a > b ? a : b;
+    QT_ASSERT(qt);
+
+    qt_linear_t* lqt = (qt_linear_t*)QT_MALLOC(sizeof(qt_linear_t), qt->mem_ctx);
+
+    if (!lqt)
+        return NULL;
+
+    QT_MEMSET(lqt, 0, sizeof(*lqt));
+
+    lqt->mem_ctx = qt->mem_ctx;
+
+    int node_count = 0;
+    int item_count = qt_node_measure(qt->root, &node_count);
+
+    lqt->nodes = (qt_lnode_t*)QT_MALLOC(sizeof(qt_lnode_t) * node_count, lqt->mem_ctx);
+    qt_items_reserve(lqt->mem_ctx, &lqt->items, item_count);
+
+    // The source node of each linear node, which doubles as the queue of the
+    // breadth-first traversal
+    const qt_node_t** sources = (const qt_node_t**)QT_MALLOC(sizeof(qt_node_t*) * node_count, lqt->mem_ctx);
+
+    sources[0] = qt->root;
+    lqt->nodes[0].bounds = qt->bounds;
+    lqt->node_count = 1;
+
+    for (int head = 0; head < lqt->node_count; head++)
+    {
+        const qt_node_t* node = sources[head];
+        qt_lnode_t* lnode = &lqt->nodes[head];
+
+        lnode->first_child = lqt->node_count;
+        lnode->child_mask = 0;
+
+        for (int i = 0; i < 4; i++)
+        {
+            if (!node->nodes[i] || qt_node_is_empty(node->nodes[i]))
+                continue;
+
+            lnode->child_mask |= 1 << i;
+
+            sources[lqt->node_count] = node->nodes[i];
+            lqt->nodes[lqt->node_count].bounds = node->bounds[i];
+            lqt->node_count++;
+        }
+    }
+
+    QT_ASSERT(lqt->node_count == node_count);
+
+    // Items are laid out depth-first, so that subtrees are contiguous
+    lqt->items.count = qt_linear_fill(lqt, sources, 0, 0);
+
+    QT_ASSERT(lqt->items.count == item_count);
+
+    QT_FREE(sources, lqt->mem_ctx);
+
+    return lqt;
+}
+
+qt_linear_t* qt_linear_build(qt_rect_t bounds,
+                             int max_depth,
+                             const qt_rect_t* rects,
+                             const qt_value_t* values,
+                             int count,
+                             void* mem_ctx)
+{
+    qt_t* qt = qt_create(bounds, max_depth, mem_ctx);
+
+    if (!qt)
+        return NULL;
+
+    qt_build(qt, rects, values, count);
+
+    qt_linear_t* lqt = qt_linear_create(qt);
+
+    qt_destroy(qt);
+
+    return lqt;
+}
+
+void qt_linear_destroy(qt_linear_t* lqt)
+{
+    QT_ASSERT(lqt);
+
+    void* mem_ctx = lqt->mem_ctx;
+
+    qt_items_destroy(mem_ctx, &lqt->items);
+
+    QT_FREE(lqt->nodes, mem_ctx);
+    QT_FREE(lqt, mem_ctx);
+}
+
+int qt_linear_query_into(const qt_linear_t* lqt, qt_rect_t area, qt_value_t* values, int capacity)
+{
+    QT_ASSERT(lqt);
+    QT_ASSERT(capacity >= 0);
+    QT_ASSERT(values || 0 == capacity);
+
+    qt_collector_t collector = { values, capacity, 0 };
+
+    qt_linear_visit(lqt, 0, &area, qt_collect_value, &collector);
+
+    return collector.count;
+}
+
+bool qt_linear_query_visit(const qt_linear_t* lqt, qt_rect_t area, qt_visit_fn visit_cb, void* udata)
+{
+    QT_ASSERT(lqt);
+    QT_ASSERT(visit_cb);
+
+    return qt_linear_visit(lqt, 0, &area, visit_cb, udata);
+}
+
+/*=============================================================================
+ * Internal function definitions
+ *============================================================================*/
+
+static int qt_max(int a, int b)
+{
+    return a > b ? a : b;
 }
 
 // Don't call this directly -- use `qt_array_fit` instead.
@@ -561,6 +1390,16 @@ static void* qt_array_fit_impl(const void* array, int new_size, size_t element_s
 
     QT_ASSERT(new_size <= new_capacity);
 
+    return qt_array_alloc_impl(array, new_capacity, element_size, mem_ctx);
+}
+
+// Don't call this directly -- use `qt_array_fit` or `qt_array_reserve` instead.
+static void* qt_array_alloc_impl(const void* array, int new_capacity, size_t element_size, void* mem_ctx)
+{
+    (void)mem_ctx;
+
+    QT_ARRAY_CANARY(array);
+
     // Total size of the header struct `qt_array_header_t` along with the size of all
     // elements packed together in a single allocation.
     size_t total_size = sizeof(qt_array_header_t) + new_capacity * element_size;
@@ -615,46 +1454,210 @@ static bool qt_rect_overlaps(const qt_rect_t* r1, const qt_rect_t* r2)
            r2->y + r2->h >= r1->y;
 }
 
-static qt_node_t* qt_node_create(qt_t* qt, qt_rect_t bounds, int depth, int max_depth)
+static void qt_items_reserve(void* mem_ctx, qt_items_t* items, int capacity)
+{
+    if (capacity <= items->capacity)
+        return;
+
+    // Coordinate columns come first so that the values column is aligned
+    size_t column_size = sizeof(qt_float) * capacity;
+    char* data = (char*)QT_MALLOC(4 * column_size + sizeof(qt_value_t) * capacity, mem_ctx);
+
+    qt_items_t resized;
+    resized.count    = items->count;
+    resized.capacity = capacity;
+    resized.x        = (qt_float*)(data);
+    resized.y        = (qt_float*)(data + column_size);
+    resized.w        = (qt_float*)(data + column_size * 2);
+    resized.h        = (qt_float*)(data + column_size * 3);
+    resized.values   = (qt_value_t*)(data + column_size * 4);
+
+    if (items->count > 0)
+    {
+        QT_MEMCPY(resized.x, items->x, sizeof(qt_float) * items->count);
+        QT_MEMCPY(resized.y, items->y, sizeof(qt_float) * items->count);
+        QT_MEMCPY(resized.w, items->w, sizeof(qt_float) * items->count);
+        QT_MEMCPY(resized.h, items->h, sizeof(qt_float) * items->count);
+        QT_MEMCPY(resized.values, items->values, sizeof(qt_value_t) * items->count);
+    }
+
+    qt_items_destroy(mem_ctx, items);
+
+    *items = resized;
+}
+
+static void qt_items_push(void* mem_ctx, qt_items_t* items, const qt_rect_t* bounds, qt_value_t value)
+{
+    // Same growth policy as `qt_array_fit`
+    if (items->count == items->capacity)
+        qt_items_reserve(mem_ctx, items, qt_max(2 * items->capacity, 16));
+
+    int i = items->count++;
+
+    qt_items_set_bounds(items, i, bounds);
+    items->values[i] = value;
+}
+
+static void qt_items_remove(qt_items_t* items, int i)
+{
+    // Overwrites the item with the last one, changing the order of items
+    int last = --items->count;
+
+    items->x[i] = items->x[last];
+    items->y[i] = items->y[last];
+    items->w[i] = items->w[last];
+    items->h[i] = items->h[last];
+    items->values[i] = items->values[last];
+}
+
+static void qt_items_destroy(void* mem_ctx, qt_items_t* items)
+{
+    (void)mem_ctx;
+
+    // The other columns are part of the same allocation
+    if (items->x)
+        QT_FREE(items->x, mem_ctx);
+
+    QT_MEMSET(items, 0, sizeof(*items));
+}
+
+static qt_rect_t qt_items_bounds(const qt_items_t* items, int i)
+{
+    return qt_make_rect(items->x[i], items->y[i], items->w[i], items->h[i]);
+}
+
+static void qt_items_set_bounds(qt_items_t* items, int i, const qt_rect_t* bounds)
+{
+    items->x[i] = bounds->x;
+    items->y[i] = bounds->y;
+    items->w[i] = bounds->w;
+    items->h[i] = bounds->h;
+}
+
+static bool qt_items_overlap(const qt_items_t* items, int i, const qt_rect_t* area)
+{
+    // Same test as `qt_rect_overlaps`
+    return area->x + area->w >= items->x[i] &&
+           area->y + area->h >= items->y[i] &&
+           items->x[i] + items->w[i] >= area->x &&
+           items->y[i] + items->h[i] >= area->y;
+}
+
+static unsigned qt_items_overlap4(const qt_items_t* items, int i, const qt_rect_t* area)
+{
+    // Returns a mask with bit j set if item i + j overlaps the area
+
+#if defined(QT_SIMD_SSE)
+
+    __m128 area_x0 = _mm_set1_ps(area->x);
+    __m128 area_y0 = _mm_set1_ps(area->y);
+    __m128 area_x1 = _mm_set1_ps(area->x + area->w);
+    __m128 area_y1 = _mm_set1_ps(area->y + area->h);
+
+    __m128 x = _mm_loadu_ps(&items->x[i]);
+    __m128 y = _mm_loadu_ps(&items->y[i]);
+    __m128 w = _mm_loadu_ps(&items->w[i]);
+    __m128 h = _mm_loadu_ps(&items->h[i]);
+
+    __m128 result = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(area_x1, x),
+                                          _mm_cmpge_ps(area_y1, y)),
+                               _mm_and_ps(_mm_cmpge_ps(_mm_add_ps(x, w), area_x0),
+                                          _mm_cmpge_ps(_mm_add_ps(y, h), area_y0)));
+
+    return (unsigned)_mm_movemask_ps(result);
+
+#elif defined(QT_SIMD_NEON)
+
+    float32x4_t area_x0 = vdupq_n_f32(area->x);
+    float32x4_t area_y0 = vdupq_n_f32(area->y);
+    float32x4_t area_x1 = vdupq_n_f32(area->x + area->w);
+    float32x4_t area_y1 = vdupq_n_f32(area->y + area->h);
+
+    float32x4_t x = vld1q_f32(&items->x[i]);
+    float32x4_t y = vld1q_f32(&items->y[i]);
+    float32x4_t w = vld1q_f32(&items->w[i]);
+    float32x4_t h = vld1q_f32(&items->h[i]);
+
+    uint32x4_t result = vandq_u32(vandq_u32(vcgeq_f32(area_x1, x),
+                                            vcgeq_f32(area_y1, y)),
+                                  vandq_u32(vcgeq_f32(vaddq_f32(x, w), area_x0),
+                                            vcgeq_f32(vaddq_f32(y, h), area_y0)));
+
+    return (vgetq_lane_u32(result, 0) & 1) |
+           (vgetq_lane_u32(result, 1) & 2) |
+           (vgetq_lane_u32(result, 2) & 4) |
+           (vgetq_lane_u32(result, 3) & 8);
+
+#else
+
+    unsigned mask = 0;
+
+    for (int j = 0; j < 4; j++)
+    {
+        if (qt_items_overlap(items, i + j, area))
+            mask |= 1u << j;
+    }
+
+    return mask;
+
+#endif
+}
+
+static qt_node_t* qt_node_create(qt_t* qt, qt_node_t* parent, qt_rect_t bounds, int depth, int max_depth)
 {
     qt_node_t* node = qt_node_alloc(qt);
 
     node->depth = depth;
     node->max_depth = max_depth;
+    node->cell = bounds;
+    node->parent = parent;
+
+    // The root holds anything, so its bounds are never expanded
+    node->rect = parent ? qt_loosen_rect(qt, bounds) : bounds;
 
+    // Calculates bounds of subtrees
+    for (int i = 0; i < 4; i++)
+    {
+        node->bounds[i] = qt_loosen_rect(qt, qt_node_quadrant(node, i));
+    }
+
+    return node;
+}
+
+static qt_rect_t qt_node_quadrant(const qt_node_t* node, int i)
+{
     // Calculate subdivided bounds
+    qt_rect_t bounds = node->cell;
+
     bounds.w /= 2.0f;
     bounds.h /= 2.0f;
 
-    // Calculates bounds of subtrees
-    node->bounds[0] = qt_make_rect(bounds.x,
-                                   bounds.y,
-                                   bounds.w,
-                                   bounds.h);
-
-    node->bounds[1] = qt_make_rect(bounds.x + bounds.w,
-                                   bounds.y,
-                                   bounds.w,
-                                   bounds.h);
-
-    node->bounds[2] = qt_make_rect(bounds.x,
-                                   bounds.y + bounds.h,
-                                   bounds.w,
-                                   bounds.h);
-
-    node->bounds[3] = qt_make_rect(bounds.x + bounds.w,
-                                   bounds.y + bounds.h,
-                                   bounds.w,
-                                   bounds.h);
+    if (i & 1)
+        bounds.x += bounds.w;
 
-    return node;
+    if (i & 2)
+        bounds.y += bounds.h;
+
+    return bounds;
+}
+
+static qt_rect_t qt_loosen_rect(const qt_t* qt, qt_rect_t rect)
+{
+    if (qt->looseness == 1)
+        return rect;
+
+    // Scale around the center
+    qt_float w = rect.w * qt->looseness;
+    qt_float h = rect.h * qt->looseness;
+
+    return qt_make_rect(rect.x - (w - rect.w) / 2, rect.y - (h - rect.h) / 2, w, h);
 }
 
 static void qt_node_destroy(qt_t* qt, qt_node_t* node)
 {
     QT_ASSERT(node);
 
-    qt_array_destroy(qt->mem_ctx, node->items);
+    qt_items_destroy(qt->mem_ctx, &node->items);
 
     // Recursively destroy nodes
     for (int i = 0; i < 4; i++)
@@ -676,105 +1679,234 @@ static void qt_node_insert(qt_t* qt, qt_node_t* node, const qt_rect_t* bounds, q
     // This occurs when the item is no longer fully contained within a subtree,
     // or the depth limit has been reached.
 
-    // Checks to see if the depth limit has been reached. If it hasn't, try to
-    // fit the item into a subtree
-    if (node->depth + 1 < node->max_depth)
+    // Try to fit the item into a subtree
+    int i = qt_node_child_index(qt, node, bounds);
+
+    if (i >= 0)
     {
-        // Loop over child nodes
-        for (int i = 0; i < 4; i++)
+        // If child node does not exist, then create it
+        if (!node->nodes[i])
         {
-            // Check if subtree contains the bounds
-            if (qt_rect_contains(&node->bounds[i], bounds))
-            {
-                // If child node does not exist, then create it
-                if (!node->nodes[i])
-                {
-                    node->nodes[i] = qt_node_create(qt,
-                                                    node->bounds[i],
-                                                    node->depth + 1,
-                                                    node->max_depth);
-                }
-
-                // Recursively try to insert the item into the subtree
-                qt_node_insert(qt, node->nodes[i], bounds, value);
-                return;
-            }
+            node->nodes[i] = qt_node_create(qt,
+                                            node,
+                                            qt_node_quadrant(node, i),
+                                            node->depth + 1,
+                                            node->max_depth);
         }
+
+        // Recursively try to insert the item into the subtree
+        qt_node_insert(qt, node->nodes[i], bounds, value);
+        return;
     }
 
     // If none of the children fully contain the bounds, or the maximum depth
     // has been reached, then the item belongs to this node
-    qt_array_push(qt->mem_ctx, node->items, (qt_item_t){ *bounds, value });
+    qt_node_push(qt, node, bounds, value);
+}
+
+static void qt_node_push(qt_t* qt, qt_node_t* node, const qt_rect_t* bounds, qt_value_t value)
+{
+    qt_items_push(qt->mem_ctx, &node->items, bounds, value);
+
+    if (qt->index.enabled)
+    {
+        // Values must be unique for the index to work
+        QT_ASSERT(!qt_index_find(qt, value));
+        qt_index_set(qt, value, node, node->items.count - 1);
+    }
+}
+
+static void qt_node_remove_at(qt_t* qt, qt_node_t* node, int slot)
+{
+    QT_ASSERT(slot >= 0 && slot < node->items.count);
+
+    if (qt->index.enabled)
+        qt_index_remove(qt, node->items.values[slot]);
+
+    qt_items_remove(&node->items, slot);
+
+    // The last item was moved into the vacated slot
+    if (qt->index.enabled && slot < node->items.count)
+        qt_index_set(qt, node->items.values[slot], node, slot);
 }
 
-static bool qt_node_remove(qt_node_t* node, qt_value_t value)
+static int qt_node_child_index(const qt_t* qt, const qt_node_t* node, const qt_rect_t* bounds)
+{
+    // Checks to see if the depth limit has been reached
+    if (node->depth + 1 >= node->max_depth)
+        return -1;
+
+    // Find the first subtree that fully contains the bounds
+    if (qt->looseness == 1)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            if (qt_rect_contains(&node->bounds[i], bounds))
+                return i;
+        }
+
+        return -1;
+    }
+
+    // Subtrees of a loose tree overlap, so the subtree is picked by the center
+    // of the bounds, which it contains if the bounds are small enough
+    qt_float cx = node->cell.x + node->cell.w / 2;
+    qt_float cy = node->cell.y + node->cell.h / 2;
+
+    int i = (bounds->x + bounds->w / 2 >= cx ? 1 : 0) |
+            (bounds->y + bounds->h / 2 >= cy ? 2 : 0);
+
+    return qt_rect_contains(&node->bounds[i], bounds) ? i : -1;
+}
+
+static void qt_node_build(qt_t* qt,
+                          qt_node_t* node,
+                          const qt_rect_t* rects,
+                          const qt_value_t* values,
+                          int* indices,
+                          int* scratch,
+                          int* buckets,
+                          int count)
 {
     QT_ASSERT(node);
 
-    // Searches the items in this node and, if found, removes the item with the
-    // specified value
-    for (int i = 0; i < qt_array_size(node->items); i++)
+    // Sort the items into buckets, 0-3 for the subtrees and 4 for this node.
+    // This makes the same decision as `qt_node_insert`
+    int counts[5] = { 0 };
+
+    for (int i = 0; i < count; i++)
+    {
+        int child = qt_node_child_index(qt, node, &rects[indices[i]]);
+
+        buckets[i] = (child >= 0) ? child : 4;
+        counts[buckets[i]]++;
+    }
+
+    // Items of this node come first, followed by the items of each subtree
+    int offsets[5];
+    offsets[4] = 0;
+    offsets[0] = counts[4];
+
+    for (int i = 1; i < 4; i++)
+    {
+        offsets[i] = offsets[i - 1] + counts[i - 1];
+    }
+
+    int starts[5];
+    QT_MEMCPY(starts, offsets, sizeof(starts));
+
+    for (int i = 0; i < count; i++)
+    {
+        scratch[offsets[buckets[i]]++] = indices[i];
+    }
+
+    QT_MEMCPY(indices, scratch, sizeof(int) * count);
+
+    // The exact number of items is known, so the array is allocated only once
+    if (counts[4] > 0)
     {
-        // If value is found, then remove it and it's bounds from the node
-        if (node->items[i].value == value)
+        qt_items_reserve(qt->mem_ctx, &node->items, counts[4]);
+
+        for (int i = 0; i < counts[4]; i++)
         {
-            qt_array_remove(node->items, i);
-            return true;
+            int index = indices[i];
+            qt_node_push(qt, node, &rects[index], values[index]);
         }
     }
 
-    // If the item wasn't found, recursively search the subtrees of this node
+    // Recursively build the subtrees using disjoint ranges of the buffers
     for (int i = 0; i < 4; i++)
     {
-        if (node->nodes[i])
+        if (0 == counts[i])
+            continue;
+
+        if (!node->nodes[i])
         {
-            if (qt_node_remove(node->nodes[i], value))
-                return true;
+            node->nodes[i] = qt_node_create(qt,
+                                            node,
+                                            qt_node_quadrant(node, i),
+                                            node->depth + 1,
+                                            node->max_depth);
         }
+
+        int start = starts[i];
+
+        qt_node_build(qt,
+                      node->nodes[i],
+                      rects,
+                      values,
+                      indices + start,
+                      scratch + start,
+                      buckets + start,
+                      counts[i]);
     }
+}
 
-    // Value wasn't found
-    return false;
+static bool qt_locate(qt_t* qt, qt_value_t value, qt_node_t** node, int* slot)
+{
+    // Without the index, the whole tree has to be searched
+    if (!qt->index.enabled)
+        return qt_node_find(qt->root, value, node, slot);
+
+    qt_handle_t* handle = qt_index_find(qt, value);
+
+    if (!handle)
+        return false;
+
+    *node = handle->node;
+    *slot = handle->slot;
+
+    return true;
 }
 
-static qt_array qt_item_t* qt_node_all_items(const qt_t* qt, const qt_node_t* node, qt_array qt_item_t* items)
+static bool qt_node_find(qt_node_t* node, qt_value_t value, qt_node_t** found, int* slot)
 {
     QT_ASSERT(node);
 
-    // Add all values in this node into the array
-    for (int i = 0; i < qt_array_size(node->items); i++)
+    // Searches the items in this node for the specified value
+    for (int i = 0; i < node->items.count; i++)
     {
-        qt_array_push(qt->mem_ctx, items, node->items[i]);
+        if (node->items.values[i] == value)
+        {
+            *found = node;
+            *slot  = i;
+            return true;
+        }
     }
 
-    // Recursively add all values found in the subtrees
+    // If the item wasn't found, recursively search the subtrees of this node
     for (int i = 0; i < 4; i++)
     {
         if (node->nodes[i])
-            items = qt_node_all_items(qt, node->nodes[i], items);
+        {
+            if (qt_node_find(node->nodes[i], value, found, slot))
+                return true;
+        }
     }
 
-    return items;
+    // Value wasn't found
+    return false;
 }
 
-static qt_array qt_value_t* qt_node_all_values(const qt_t* qt, const qt_node_t* node, qt_array qt_value_t* values)
+static qt_array qt_item_t* qt_node_all_items(const qt_t* qt, const qt_node_t* node, qt_array qt_item_t* items)
 {
     QT_ASSERT(node);
 
     // Add all values in this node into the array
-    for (int i = 0; i < qt_array_size(node->items); i++)
+    for (int i = 0; i < node->items.count; i++)
     {
-        qt_array_push(qt->mem_ctx, values, node->items[i].value);
+        qt_array_push(qt->mem_ctx, items, (qt_item_t){ qt_items_bounds(&node->items, i),
+                                                      node->items.values[i] });
     }
 
     // Recursively add all values found in the subtrees
     for (int i = 0; i < 4; i++)
     {
         if (node->nodes[i])
-            values = qt_node_all_values(qt, node->nodes[i], values);
+            items = qt_node_all_items(qt, node->nodes[i], items);
     }
 
-    return values;
+    return items;
 }
 
 static qt_array qt_rect_t* qt_node_all_grid_rects(const qt_t* qt, const qt_node_t* node, qt_array qt_rect_t* rects)
@@ -798,51 +1930,452 @@ static qt_array qt_rect_t* qt_node_all_grid_rects(const qt_t* qt, const qt_node_
     return rects;
 }
 
-static qt_array qt_value_t* qt_node_query(const qt_t* qt, const qt_node_t* node, const qt_rect_t* area, qt_array qt_value_t* values)
+static bool qt_node_visit(const qt_node_t* node, const qt_rect_t* area, qt_visit_fn visit_cb, void* udata)
 {
     QT_ASSERT(node);
     QT_ASSERT(area);
 
-    // Searches for items in this node that intersect the area and adds them to
-    // the array
-    for (int i = 0; i < qt_array_size(node->items); i++)
+    // Searches for items in this node that intersect the area
+    if (!qt_items_visit(&node->items, 0, node->items.count, area, visit_cb, udata))
+        return false;
+
+    // Loop over subtrees
+    for (int i = 0; i < 4; i++)
     {
-        const qt_item_t* item = &node->items[i];
+        if (!node->nodes[i])
+            continue;
 
-        if (qt_rect_overlaps(area, &item->bounds))
-            qt_array_push(qt->mem_ctx, values, node->items[i].value);
+        // If the area contains the the entire subtree, all items in the
+        // subtree match
+        if (qt_rect_contains(area, &node->bounds[i]))
+        {
+            if (!qt_node_visit_all(node->nodes[i], visit_cb, udata))
+                return false;
+        }
+        // Otherwise, if the area intersects the bounds of the subtree, the
+        // subtree is recursively searched for items intersecting or contained
+        // within the area
+        else if (qt_rect_overlaps(area, &node->bounds[i]))
+        {
+            if (!qt_node_visit(node->nodes[i], area, visit_cb, udata))
+                return false;
+        }
     }
 
-    // Loop over subtrees
+    return true;
+}
+
+static bool qt_node_visit_all(const qt_node_t* node, qt_visit_fn visit_cb, void* udata)
+{
+    QT_ASSERT(node);
+
+    for (int i = 0; i < node->items.count; i++)
+    {
+        if (!visit_cb(node->items.values[i], udata))
+            return false;
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (node->nodes[i] && !qt_node_visit_all(node->nodes[i], visit_cb, udata))
+            return false;
+    }
+
+    return true;
+}
+
+static bool qt_collect_value(qt_value_t value, void* udata)
+{
+    qt_collector_t* collector = (qt_collector_t*)udata;
+
+    // Keep counting once the buffer is full, so that the caller learns the
+    // required capacity
+    if (collector->count < collector->capacity)
+        collector->values[collector->count] = value;
+
+    collector->count++;
+
+    return true;
+}
+
+static bool qt_push_value(qt_value_t value, void* udata)
+{
+    qt_pusher_t* pusher = (qt_pusher_t*)udata;
+    qt_array_push(pusher->qt->mem_ctx, *pusher->values, value);
+    return true;
+}
+
+static qt_float qt_rect_dist_sq(const qt_rect_t* rect, qt_float x, qt_float y)
+{
+    // Distance along each axis, zero if the point is within the extent
+    qt_float dx = 0, dy = 0;
+
+    if (x < rect->x)
+        dx = rect->x - x;
+    else if (x > rect->x + rect->w)
+        dx = x - (rect->x + rect->w);
+
+    if (y < rect->y)
+        dy = rect->y - y;
+    else if (y > rect->y + rect->h)
+        dy = y - (rect->y + rect->h);
+
+    return dx * dx + dy * dy;
+}
+
+static qt_float qt_items_dist_sq(const qt_items_t* items, int i, qt_float x, qt_float y)
+{
+    qt_rect_t bounds = qt_items_bounds(items, i);
+    return qt_rect_dist_sq(&bounds, x, y);
+}
+
+static void qt_node_query_radius(const qt_node_t* node, qt_float x, qt_float y, qt_float radius_sq, void* collector)
+{
+    QT_ASSERT(node);
+
+    const qt_items_t* items = &node->items;
+
+    for (int i = 0; i < items->count; i++)
+    {
+        if (qt_items_dist_sq(items, i, x, y) <= radius_sq)
+            qt_collect_value(items->values[i], collector);
+    }
+
+    // Subtrees further away than the radius cannot contain any matches
+    for (int i = 0; i < 4; i++)
+    {
+        if (node->nodes[i] && qt_rect_dist_sq(&node->bounds[i], x, y) <= radius_sq)
+            qt_node_query_radius(node->nodes[i], x, y, radius_sq, collector);
+    }
+}
+
+static void qt_nearest_add(qt_nearest_t* nearest, qt_value_t value, qt_float dist_sq)
+{
+    // Results are kept sorted, the furthest one is dropped once full
+    if (nearest->count == nearest->k)
+    {
+        if (dist_sq >= nearest->dist_sq[nearest->k - 1])
+            return;
+
+        nearest->count--;
+    }
+
+    int i = nearest->count++;
+
+    while (i > 0 && nearest->dist_sq[i - 1] > dist_sq)
+    {
+        nearest->values[i]  = nearest->values[i - 1];
+        nearest->dist_sq[i] = nearest->dist_sq[i - 1];
+        i--;
+    }
+
+    nearest->values[i]  = value;
+    nearest->dist_sq[i] = dist_sq;
+}
+
+static void qt_node_query_nearest(const qt_node_t* node, qt_float x, qt_float y, void* data)
+{
+    QT_ASSERT(node);
+
+    qt_nearest_t* nearest = (qt_nearest_t*)data;
+
+    const qt_items_t* items = &node->items;
+
+    for (int i = 0; i < items->count; i++)
+    {
+        qt_nearest_add(nearest, items->values[i], qt_items_dist_sq(items, i, x, y));
+    }
+
+    // Visit the subtrees closest first
+    int order[4];
+    qt_float child_dist_sq[4];
+    int child_count = 0;
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (!node->nodes[i])
+            continue;
+
+        qt_float dist_sq = qt_rect_dist_sq(&node->bounds[i], x, y);
+
+        int j = child_count++;
+
+        while (j > 0 && child_dist_sq[j - 1] > dist_sq)
+        {
+            order[j] = order[j - 1];
+            child_dist_sq[j] = child_dist_sq[j - 1];
+            j--;
+        }
+
+        order[j] = i;
+        child_dist_sq[j] = dist_sq;
+    }
+
+    for (int i = 0; i < child_count; i++)
+    {
+        // All further subtrees are out of reach as well
+        if (nearest->count == nearest->k &&
+            child_dist_sq[i] >= nearest->dist_sq[nearest->k - 1])
+            break;
+
+        qt_node_query_nearest(node->nodes[order[i]], x, y, nearest);
+    }
+}
+
+static bool qt_collect_pair(qt_value_t value, void* udata)
+{
+    qt_pair_collector_t* collector = (qt_pair_collector_t*)udata;
+
+    if (collector->count < collector->capacity)
+        collector->pairs[collector->count] = (qt_pair_t){ collector->value, value };
+
+    collector->count++;
+
+    return true;
+}
+
+static void qt_node_find_pairs(const qt_node_t* node, void* data)
+{
+    QT_ASSERT(node);
+
+    qt_pair_collector_t* collector = (qt_pair_collector_t*)data;
+
+    const qt_items_t* items = &node->items;
+
+    for (int i = 0; i < items->count; i++)
+    {
+        qt_rect_t bounds = qt_items_bounds(items, i);
+
+        collector->value = items->values[i];
+
+        // Later items of the same node, so that each pair is only found once
+        qt_items_visit(items, i + 1, items->count, &bounds, qt_collect_pair, collector);
+
+        // Items of the subtrees
+        for (int j = 0; j < 4; j++)
+        {
+            if (node->nodes[j] && qt_rect_overlaps(&bounds, &node->bounds[j]))
+                qt_node_visit(node->nodes[j], &bounds, qt_collect_pair, collector);
+        }
+    }
+
+    // Pairs between items in different subtrees
+    for (int i = 0; i < 4; i++)
+    {
+        for (int j = i + 1; j < 4; j++)
+        {
+            if (node->nodes[i] && node->nodes[j] && qt_rect_overlaps(&node->bounds[i], &node->bounds[j]))
+                qt_node_join_pairs(node->nodes[i], node->nodes[j], collector);
+        }
+    }
+
+    // Pairs between items that are both in the same subtree
     for (int i = 0; i < 4; i++)
     {
         if (node->nodes[i])
+            qt_node_find_pairs(node->nodes[i], collector);
+    }
+}
+
+static void qt_node_join_pairs(const qt_node_t* node, const qt_node_t* other, void* data)
+{
+    // Finds the pairs between the items of two disjoint subtrees
+    qt_pair_collector_t* collector = (qt_pair_collector_t*)data;
+
+    const qt_items_t* items = &node->items;
+
+    for (int i = 0; i < items->count; i++)
+    {
+        qt_rect_t bounds = qt_items_bounds(items, i);
+
+        if (!qt_rect_overlaps(&bounds, &other->rect))
+            continue;
+
+        collector->value = items->values[i];
+        qt_node_visit(other, &bounds, qt_collect_pair, collector);
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (node->nodes[i] && qt_rect_overlaps(&node->bounds[i], &other->rect))
+            qt_node_join_pairs(node->nodes[i], other, collector);
+    }
+}
+
+static void qt_batch_count(void* data, int index)
+{
+    qt_batch_t* batch = (qt_batch_t*)data;
+    batch->offsets[index + 1] = qt_query_into(batch->qt, batch->areas[index], NULL, 0);
+}
+
+static void qt_batch_write(void* data, int index)
+{
+    qt_batch_t* batch = (qt_batch_t*)data;
+
+    int offset = batch->offsets[index];
+    int count  = batch->offsets[index + 1] - offset;
+
+    qt_query_into(batch->qt, batch->areas[index], batch->values + offset, count);
+}
+
+static void qt_run_tasks(qt_parallel_fn parallel_cb, void* udata, qt_task_fn task, void* data, int count)
+{
+    if (count <= 0)
+        return;
+
+    if (parallel_cb)
+    {
+        parallel_cb(task, data, count, udata);
+        return;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        task(data, i);
+    }
+}
+
+static bool qt_items_visit(const qt_items_t* items, int begin, int end, const qt_rect_t* area, qt_visit_fn visit_cb, void* udata)
+{
+    // Tests items four at a time if possible
+    int i = begin;
+
+    for (; i + 4 <= end; i += 4)
+    {
+        unsigned mask = qt_items_overlap4(items, i, area);
+
+        for (int j = 0; mask; j++, mask >>= 1)
         {
-            // If the area contains the the entire subtree, all items in the
-            // subtree match and are recursively added to the array
-            if (qt_rect_contains(area, &node->bounds[i]))
-            {
-                values = qt_node_all_values(qt, node->nodes[i], values);
-            }
-            else
+            if ((mask & 1) && !visit_cb(items->values[i + j], udata))
+                return false;
+        }
+    }
+
+    for (; i < end; i++)
+    {
+        if (qt_items_overlap(items, i, area) && !visit_cb(items->values[i], udata))
+            return false;
+    }
+
+    return true;
+}
+
+static int qt_child_count(int child_mask)
+{
+    static const int counts[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+    return counts[child_mask & 15];
+}
+
+static bool qt_node_is_empty(const qt_node_t* node)
+{
+    if (node->items.count > 0)
+        return false;
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (node->nodes[i] && !qt_node_is_empty(node->nodes[i]))
+            return false;
+    }
+
+    return true;
+}
+
+static int qt_node_measure(const qt_node_t* node, int* node_count)
+{
+    // Returns the number of items in the subtree and adds the number of
+    // non-empty nodes to `node_count` (the node itself is always counted)
+    int item_count = node->items.count;
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (!node->nodes[i])
+            continue;
+
+        int child_nodes = 0;
+        int child_items = qt_node_measure(node->nodes[i], &child_nodes);
+
+        if (child_items > 0)
+        {
+            item_count += child_items;
+            *node_count += child_nodes;
+        }
+    }
+
+    (*node_count)++;
+
+    return item_count;
+}
+
+static int qt_linear_fill(qt_linear_t* lqt, const qt_node_t** sources, int index, int offset)
+{
+    // Copies the items of a subtree starting at `offset` and returns the end
+    // of its range
+    qt_lnode_t* lnode = &lqt->nodes[index];
+    const qt_items_t* items = &sources[index]->items;
+
+    lnode->first_item = offset;
+    lnode->item_count = items->count;
+
+    if (items->count > 0)
+    {
+        QT_MEMCPY(lqt->items.x + offset, items->x, sizeof(qt_float) * items->count);
+        QT_MEMCPY(lqt->items.y + offset, items->y, sizeof(qt_float) * items->count);
+        QT_MEMCPY(lqt->items.w + offset, items->w, sizeof(qt_float) * items->count);
+        QT_MEMCPY(lqt->items.h + offset, items->h, sizeof(qt_float) * items->count);
+        QT_MEMCPY(lqt->items.values + offset, items->values, sizeof(qt_value_t) * items->count);
+    }
+
+    int end = offset + items->count;
+    int child_count = qt_child_count(lnode->child_mask);
+
+    for (int i = 0; i < child_count; i++)
+    {
+        end = qt_linear_fill(lqt, sources, lnode->first_child + i, end);
+    }
+
+    lnode->subtree_count = end - offset;
+
+    return end;
+}
+
+static bool qt_linear_visit(const qt_linear_t* lqt, int index, const qt_rect_t* area, qt_visit_fn visit_cb, void* udata)
+{
+    const qt_lnode_t* lnode = &lqt->nodes[index];
+
+    if (!qt_items_visit(&lqt->items, lnode->first_item, lnode->first_item + lnode->item_count, area, visit_cb, udata))
+        return false;
+
+    int child_count = qt_child_count(lnode->child_mask);
+
+    for (int i = 0; i < child_count; i++)
+    {
+        const qt_lnode_t* child = &lqt->nodes[lnode->first_child + i];
+
+        // If the area contains the entire subtree, its whole range of items
+        // matches
+        if (qt_rect_contains(area, &child->bounds))
+        {
+            int end = child->first_item + child->subtree_count;
+
+            for (int j = child->first_item; j < end; j++)
             {
-                // Otherwise, if the area intersects the bounds of the subtree,
-                // the subtree is recursively searched for items intersecting
-                // or contained within the area
-                if (qt_rect_overlaps(area, &node->bounds[i]))
-                {
-                    values = qt_node_query(qt, node->nodes[i], area, values);
-                }
+                if (!visit_cb(lqt->items.values[j], udata))
+                    return false;
             }
         }
+        else if (qt_rect_overlaps(area, &child->bounds))
+        {
+            if (!qt_linear_visit(lqt, lnode->first_child + i, area, visit_cb, udata))
+                return false;
+        }
     }
 
-    return values;
+    return true;
 }
 
 static void qt_node_clear(qt_node_t* node)
 {
-    qt_array_clear(node->items);
+    node->items.count = 0;
 
     for (int i = 0; i < 4; i++)
     {
@@ -851,6 +2384,147 @@ static void qt_node_clear(qt_node_t* node)
     }
 }
 
+static uint64_t qt_index_hash(qt_value_t value)
+{
+    // Finalizer of splitmix64
+    uint64_t x = (uint64_t)value;
+    x ^= x >> 30; x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27; x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+static qt_handle_t* qt_index_find(const qt_t* qt, qt_value_t value)
+{
+    const qt_index_t* index = &qt->index;
+
+    if (0 == index->count)
+        return NULL;
+
+    int mask = index->capacity - 1;
+    int i = (int)(qt_index_hash(value) & (uint64_t)mask);
+
+    // Linear probing, an unused entry ends the search
+    while (index->handles[i].node)
+    {
+        if (index->handles[i].value == value)
+            return &index->handles[i];
+
+        i = (i + 1) & mask;
+    }
+
+    return NULL;
+}
+
+static void qt_index_set(qt_t* qt, qt_value_t value, qt_node_t* node, int slot)
+{
+    qt_index_t* index = &qt->index;
+
+    qt_handle_t* handle = qt_index_find(qt, value);
+
+    if (handle)
+    {
+        handle->node = node;
+        handle->slot = slot;
+        return;
+    }
+
+    // Keep the load factor at or below one half
+    if (2 * (index->count + 1) > index->capacity)
+    {
+        int old_capacity = index->capacity;
+        qt_handle_t* old_handles = index->handles;
+
+        index->capacity = qt_max(2 * old_capacity, 64);
+        index->handles = (qt_handle_t*)QT_MALLOC(sizeof(qt_handle_t) * index->capacity,
+                                                 qt->mem_ctx);
+        QT_MEMSET(index->handles, 0, sizeof(qt_handle_t) * index->capacity);
+        index->count = 0;
+
+        for (int i = 0; i < old_capacity; i++)
+        {
+            if (old_handles[i].node)
+                qt_index_set(qt, old_handles[i].value, old_handles[i].node, old_handles[i].slot);
+        }
+
+        if (old_handles)
+            QT_FREE(old_handles, qt->mem_ctx);
+    }
+
+    int mask = index->capacity - 1;
+    int i = (int)(qt_index_hash(value) & (uint64_t)mask);
+
+    while (index->handles[i].node)
+    {
+        i = (i + 1) & mask;
+    }
+
+    index->handles[i] = (qt_handle_t){ value, node, slot };
+    index->count++;
+}
+
+static void qt_index_remove(qt_t* qt, qt_value_t value)
+{
+    qt_index_t* index = &qt->index;
+
+    qt_handle_t* handle = qt_index_find(qt, value);
+
+    if (!handle)
+        return;
+
+    int mask = index->capacity - 1;
+    int i = (int)(handle - index->handles);
+    int j = i;
+
+    // Backward shift deletion: move later entries of the probe sequence into
+    // the hole, so no tombstones are needed
+    for (;;)
+    {
+        j = (j + 1) & mask;
+
+        if (!index->handles[j].node)
+            break;
+
+        int home = (int)(qt_index_hash(index->handles[j].value) & (uint64_t)mask);
+
+        // The entry may move into the hole if its home is not in (i, j]
+        if ((j > i && (home <= i || home > j)) || (j < i && (home <= i && home > j)))
+        {
+            index->handles[i] = index->handles[j];
+            i = j;
+        }
+    }
+
+    index->handles[i].node = NULL;
+    index->count--;
+}
+
+static void qt_index_clear(qt_t* qt)
+{
+    qt_index_t* index = &qt->index;
+
+    if (index->handles)
+        QT_MEMSET(index->handles, 0, sizeof(qt_handle_t) * index->capacity);
+
+    index->count = 0;
+}
+
+static void qt_index_add_node(qt_t* qt, qt_node_t* node)
+{
+    for (int i = 0; i < node->items.count; i++)
+    {
+        // Values must be unique for the index to work
+        QT_ASSERT(!qt_index_find(qt, node->items.values[i]));
+        qt_index_set(qt, node->items.values[i], node, i);
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (node->nodes[i])
+            qt_index_add_node(qt, node->nodes[i]);
+    }
+}
+
 static void qt_freelist_push(qt_t* qt, qt_unode_t *unode)
 {
     qt_node_allocator_t* allocator = &qt->allocator;
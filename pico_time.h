@@ -12,6 +12,9 @@
     - Single header library for easy build system integration
     - Cross-platform time and sleep functions
     - Time conversion functions
+    - Low overhead cycle counter clock
+    - Profiling zones recorded per thread
+    - Frame limiter with jitter statistics
 
     Summary:
     --------
@@ -23,6 +26,26 @@
     that you use the `pt_to_usec` and `pt_from_usec` functions should this ever
     change.
 
+    `pt_now` relies on the operating system clock, which is too expensive to
+    call many times in hot loops. `pt_ticks` reads the processor's cycle
+    counter instead (rdtsc on x86, cntvct on ARM64) where available. Ticks
+    are converted to time using a ratio calibrated against `pt_now`, either
+    explicitly with `pt_calibrate_ticks` or automatically at the first
+    conversion.
+
+    Profiling zones are built on top of the tick clock. `pt_zone_begin` and
+    `pt_zone_end` record a named, possibly nested, interval in a buffer that
+    belongs to the calling thread. The zones recorded by a thread can be
+    examined with `pt_get_zones` (e.g. once per frame) and discarded with
+    `pt_clear_zones`.
+
+    A frame limiter (`pt_limiter_t`) paces a loop to a target period. Each
+    call to `pt_wait_frame` sleeps until shortly before the frame's deadline
+    and then spins on `pt_now` for the remainder. The spinning margin adapts
+    to how late the operating system wakes the thread, so precise pacing
+    costs little CPU time. On Windows, high resolution waitable timers are used
+    when available.
+
     Usage:
     ------
 
@@ -33,6 +56,12 @@
 
     to a source file (once).
 
+    Constants:
+    ----------
+
+    - PICO_TIME_MAX_ZONES (default: 1024) Zones recorded per thread
+    - PICO_TIME_MAX_ZONE_DEPTH (default: 32) Maximum nesting of zones
+
     IMPORTANT: On POSIX systems, when defining PICO_TIME_IMPLEMENTATION, one of
     three conditions must hold:
 
@@ -102,6 +131,137 @@ ptime_t pt_from_msec(int32_t msec);
  */
 ptime_t pt_from_sec(double sec);
 
+/**
+ * @brief Returns the value of a high frequency counter (usually the CPU cycle
+ * counter). Falls back to `pt_now` on platforms without one.
+ */
+uint64_t pt_ticks(void);
+
+/**
+ * @brief Measures the tick frequency against `pt_now`
+ *
+ * Busy waits for the specified duration. Longer durations are more accurate.
+ * This is done automatically (for 10ms) the first time ticks are converted,
+ * once even if several threads convert at the same time. An explicit
+ * calibration must not overlap conversions in other threads, so call it
+ * before starting them.
+ */
+void pt_calibrate_ticks(ptime_t duration);
+
+/**
+ * @brief Converts a tick interval to time
+ */
+ptime_t pt_from_ticks(uint64_t ticks);
+
+/**
+ * @brief Converts a tick interval to seconds
+ */
+double pt_ticks_to_sec(uint64_t ticks);
+
+/**
+ * @brief A recorded profiling zone
+ */
+typedef struct
+{
+    const char* name;  //!< Name passed to `pt_zone_begin`
+    uint64_t    start; //!< Tick count at the beginning of the zone
+    uint64_t    end;   //!< Tick count at the end (0 while the zone is open)
+    int         depth; //!< Nesting depth (0 for top level zones)
+} pt_zone_t;
+
+/**
+ * @brief Begins a profiling zone in the calling thread
+ *
+ * Zones may be nested. Zones that do not fit in the thread's buffer are
+ * counted but not recorded.
+ *
+ * @param name A string that must remain valid while the zone is recorded
+ * (usually a string literal)
+ */
+void pt_zone_begin(const char* name);
+
+/**
+ * @brief Ends the most recently begun profiling zone in the calling thread
+ */
+void pt_zone_end(void);
+
+/**
+ * @brief Returns the zones recorded by the calling thread in the order they
+ * began
+ *
+ * @param zones Set to the zones, which remain valid until `pt_clear_zones`
+ *
+ * @returns The number of zones
+ */
+int pt_get_zones(const pt_zone_t** zones);
+
+/**
+ * @brief Returns the number of zones the calling thread did not record since
+ * the last `pt_clear_zones` because its buffer was full
+ */
+int pt_get_dropped_zones(void);
+
+/**
+ * @brief Discards the zones recorded by the calling thread. Open zones are
+ * kept, so this may be called in the middle of a zone (e.g. a frame).
+ */
+void pt_clear_zones(void);
+
+/**
+ * @brief Paces a loop to a fixed period. Members are private.
+ */
+typedef struct
+{
+    ptime_t  period;
+    ptime_t  deadline;
+    ptime_t  last;
+    ptime_t  margin;
+    uint64_t frames;
+    uint64_t missed;
+    ptime_t  jitter_sum;
+    ptime_t  jitter_max;
+} pt_limiter_t;
+
+/**
+ * @brief Frame limiter statistics
+ */
+typedef struct
+{
+    uint64_t frames;      //!< Frames since the last reset
+    uint64_t missed;      //!< Frames that ended after their deadline
+    ptime_t  mean_jitter; //!< Mean difference between frame duration and period
+    ptime_t  max_jitter;  //!< Largest difference between frame duration and period
+    ptime_t  margin;      //!< Time currently spent spinning before a deadline
+} pt_limiter_stats_t;
+
+/**
+ * @brief Initializes a frame limiter. The first frame begins immediately.
+ *
+ * @param period The target frame duration (e.g. `pt_from_sec(1.0 / 144.0)`)
+ */
+void pt_init_limiter(pt_limiter_t* limiter, ptime_t period);
+
+/**
+ * @brief Waits until the end of the current frame
+ *
+ * Deadlines are spaced by the period, so a short delay in one frame is made
+ * up in the next. If a deadline has already passed, the frame is counted as
+ * missed and the schedule restarts from the present time.
+ *
+ * @returns The duration of the frame that ended
+ */
+ptime_t pt_wait_frame(pt_limiter_t* limiter);
+
+/**
+ * @brief Retrieves the statistics accumulated since the last reset
+ */
+void pt_get_limiter_stats(const pt_limiter_t* limiter, pt_limiter_stats_t* stats);
+
+/**
+ * @brief Resets the statistics of a frame limiter
+ */
+void pt_reset_limiter_stats(pt_limiter_t* limiter);
+
 #ifdef __cplusplus
 }
 #endif
@@ -155,6 +315,34 @@ void pt_sleep(ptime_t duration)
     timeEndPeriod(tc.wPeriodMin);
 }
 
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+// Used by the frame limiter. High resolution timers (Windows 10 1803+) are
+// not bound to the scheduler tick
+static void pt_coarse_sleep(ptime_t duration)
+{
+    HANDLE timer = CreateWaitableTimerExW(NULL, NULL,
+                                          CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+                                          TIMER_ALL_ACCESS);
+    if (timer)
+    {
+        LARGE_INTEGER due;
+        due.QuadPart = -(LONGLONG)(duration * 10); // Relative, 100ns units
+
+        BOOL waited = SetWaitableTimer(timer, &due, 0, NULL, NULL, FALSE) &&
+                      WaitForSingleObject(timer, INFINITE) == WAIT_OBJECT_0;
+
+        CloseHandle(timer);
+
+        if (waited)
+            return;
+    }
+
+    pt_sleep(duration);
+}
+
 /*==============================================================================
  * Apple (pt_now)
  *============================================================================*/
@@ -210,6 +398,11 @@ void pt_sleep(ptime_t duration)
     while ((nanosleep(&ti, &ti) == -1) && (errno == EINTR));
 }
 
+static void pt_coarse_sleep(ptime_t duration)
+{
+    pt_sleep(duration);
+}
+
 #endif // PT_PLATFORM
 
 int64_t pt_to_usec(ptime_t time)
@@ -242,6 +435,336 @@ ptime_t pt_from_sec(double sec)
     return (ptime_t)(sec * 1000000.0 + 0.5);
 }
 
+/*==============================================================================
+ * Cycle counter
+ *============================================================================*/
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #include <intrin.h>
+    #define PT_TICKS() ((uint64_t)__rdtsc())
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    #include <x86intrin.h>
+    #define PT_TICKS() ((uint64_t)__rdtsc())
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__aarch64__)
+    static inline uint64_t pt_read_cntvct(void)
+    {
+        uint64_t value;
+        __asm__ __volatile__ ("mrs %0, cntvct_el0" : "=r" (value));
+        return value;
+    }
+    #define PT_TICKS() pt_read_cntvct()
+#else
+    #define PT_TICKS() ((uint64_t)pt_now())
+#endif
+
+/*
+ * The first conversion calibrates the ticks, possibly in several threads at
+ * once. Atomics ensure that only one of them measures while the others wait.
+ */
+
+#if defined(__GNUC__) || defined(__clang__)
+    #define PT_ATOMICS
+    #define PT_ATOMIC_LOAD(ptr)       __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+    #define PT_ATOMIC_STORE(ptr, val) __atomic_store_n(ptr, val, __ATOMIC_RELEASE)
+    #define PT_ATOMIC_CAS(ptr, expected, desired) \
+            __sync_bool_compare_and_swap(ptr, expected, desired)
+#elif defined(_MSC_VER)
+    #include <intrin.h>
+    #define PT_ATOMICS
+    #define PT_ATOMIC_LOAD(ptr)       _InterlockedOr(ptr, 0)
+    #define PT_ATOMIC_STORE(ptr, val) ((void)_InterlockedExchange(ptr, val))
+    #define PT_ATOMIC_CAS(ptr, expected, desired) \
+            ((expected) == _InterlockedCompareExchange(ptr, desired, expected))
+#endif
+
+enum
+{
+    PT_UNCALIBRATED,
+    PT_CALIBRATING,
+    PT_CALIBRATED
+};
+
+static volatile long pt_calibration = PT_UNCALIBRATED;
+
+static double pt_ticks_per_usec = 0.0;
+
+uint64_t pt_ticks(void)
+{
+    return PT_TICKS();
+}
+
+static double pt_measure_ticks(ptime_t duration)
+{
+    ptime_t  start_time  = pt_now();
+    uint64_t start_ticks = PT_TICKS();
+
+    ptime_t  end_time;
+    uint64_t end_ticks;
+
+    // Spin rather than sleep to keep the core (and its counter) busy
+    do
+    {
+        end_time  = pt_now();
+        end_ticks = PT_TICKS();
+    } while (end_time - start_time < duration || end_time == start_time);
+
+    return (double)(end_ticks - start_ticks) / (double)(end_time - start_time);
+}
+
+void pt_calibrate_ticks(ptime_t duration)
+{
+    pt_ticks_per_usec = pt_measure_ticks(duration);
+
+#ifdef PT_ATOMICS
+    PT_ATOMIC_STORE(&pt_calibration, PT_CALIBRATED);
+#else
+    pt_calibration = PT_CALIBRATED;
+#endif
+}
+
+static double pt_get_ticks_per_usec(void)
+{
+#ifdef PT_ATOMICS
+    if (PT_CALIBRATED != PT_ATOMIC_LOAD(&pt_calibration))
+    {
+        if (PT_ATOMIC_CAS(&pt_calibration, PT_UNCALIBRATED, PT_CALIBRATING))
+        {
+            pt_calibrate_ticks(pt_from_msec(10));
+        }
+        else
+        {
+            // Another thread is calibrating
+            while (PT_CALIBRATED != PT_ATOMIC_LOAD(&pt_calibration))
+            {
+            }
+        }
+    }
+#else
+    if (PT_CALIBRATED != pt_calibration)
+        pt_calibrate_ticks(pt_from_msec(10));
+#endif
+
+    return pt_ticks_per_usec;
+}
+
+ptime_t pt_from_ticks(uint64_t ticks)
+{
+    return (ptime_t)((double)ticks / pt_get_ticks_per_usec() + 0.5);
+}
+
+double pt_ticks_to_sec(uint64_t ticks)
+{
+    return (double)ticks / pt_get_ticks_per_usec() / 1000000.0;
+}
+
+/*==============================================================================
+ * Profiling zones
+ *============================================================================*/
+
+#ifndef PICO_TIME_MAX_ZONES
+#define PICO_TIME_MAX_ZONES 1024
+#endif
+
+#ifndef PICO_TIME_MAX_ZONE_DEPTH
+#define PICO_TIME_MAX_ZONE_DEPTH 32
+#endif
+
+#if defined(_MSC_VER)
+    #define PT_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__) || defined(__clang__)
+    #define PT_THREAD_LOCAL __thread
+#else
+    #define PT_THREAD_LOCAL // Zones are not thread safe on other compilers
+#endif
+
+typedef struct
+{
+    pt_zone_t zones[PICO_TIME_MAX_ZONES];
+    int       zone_count;
+    int       dropped;
+    int       stack[PICO_TIME_MAX_ZONE_DEPTH]; // Open zones (-1 if dropped)
+    int       depth;
+} pt_zone_buffer_t;
+
+static PT_THREAD_LOCAL pt_zone_buffer_t pt_zone_buffer;
+
+void pt_zone_begin(const char* name)
+{
+    pt_zone_buffer_t* buffer = &pt_zone_buffer;
+
+    int index = -1;
+
+    if (buffer->zone_count < PICO_TIME_MAX_ZONES &&
+        buffer->depth < PICO_TIME_MAX_ZONE_DEPTH)
+    {
+        index = buffer->zone_count++;
+
+        pt_zone_t* zone = &buffer->zones[index];
+
+        zone->name  = name;
+        zone->depth = buffer->depth;
+        zone->end   = 0;
+        zone->start = PT_TICKS();
+    }
+    else
+    {
+        buffer->dropped++;
+    }
+
+    if (buffer->depth < PICO_TIME_MAX_ZONE_DEPTH)
+        buffer->stack[buffer->depth] = index;
+
+    buffer->depth++;
+}
+
+void pt_zone_end(void)
+{
+    uint64_t ticks = PT_TICKS();
+
+    pt_zone_buffer_t* buffer = &pt_zone_buffer;
+
+    if (buffer->depth <= 0)
+        return;
+
+    buffer->depth--;
+
+    if (buffer->depth >= PICO_TIME_MAX_ZONE_DEPTH)
+        return;
+
+    int index = buffer->stack[buffer->depth];
+
+    if (index >= 0)
+        buffer->zones[index].end = ticks;
+}
+
+int pt_get_zones(const pt_zone_t** zones)
+{
+    *zones = pt_zone_buffer.zones;
+    return pt_zone_buffer.zone_count;
+}
+
+int pt_get_dropped_zones(void)
+{
+    return pt_zone_buffer.dropped;
+}
+
+void pt_clear_zones(void)
+{
+    pt_zone_buffer_t* buffer = &pt_zone_buffer;
+
+    int depth = (buffer->depth < PICO_TIME_MAX_ZONE_DEPTH) ?
+                buffer->depth : PICO_TIME_MAX_ZONE_DEPTH;
+
+    int count = 0;
+
+    // Move the open zones to the front of the buffer
+    for (int i = 0; i < depth; i++)
+    {
+        int index = buffer->stack[i];
+
+        if (index < 0)
+            continue;
+
+        buffer->zones[count] = buffer->zones[index];
+        buffer->stack[i] = count++;
+    }
+
+    buffer->zone_count = count;
+    buffer->dropped = 0;
+}
+
+/*==============================================================================
+ * Frame limiter
+ *============================================================================*/
+
+#define PT_MIN_MARGIN 50 // Microseconds
+
+void pt_init_limiter(pt_limiter_t* limiter, ptime_t period)
+{
+    ptime_t now = pt_now();
+
+    limiter->period   = period;
+    limiter->deadline = now + period;
+    limiter->last     = now;
+    limiter->margin   = pt_from_msec(1);
+
+    pt_reset_limiter_stats(limiter);
+}
+
+ptime_t pt_wait_frame(pt_limiter_t* limiter)
+{
+    ptime_t now = pt_now();
+
+    if (now >= limiter->deadline)
+    {
+        limiter->missed++;
+        limiter->deadline = now;
+    }
+    else
+    {
+        ptime_t remaining = limiter->deadline - now;
+
+        if (remaining > limiter->margin)
+        {
+            ptime_t request = remaining - limiter->margin;
+
+            pt_coarse_sleep(request);
+
+            ptime_t slept = pt_now() - now;
+            ptime_t overshoot = (slept > request) ? slept - request : 0;
+
+            // Keep twice the observed overshoot in reserve. The margin grows
+            // immediately and shrinks slowly, since a late wakeup costs a frame
+            ptime_t target = 2 * overshoot;
+
+            if (target < PT_MIN_MARGIN)
+                target = PT_MIN_MARGIN;
+
+            if (target > limiter->margin)
+                limiter->margin = target;
+            else
+                limiter->margin -= (limiter->margin - target) / 16;
+
+            if (limiter->margin > limiter->period)
+                limiter->margin = limiter->period;
+        }
+
+        while ((now = pt_now()) < limiter->deadline);
+    }
+
+    ptime_t duration = now - limiter->last;
+    ptime_t jitter = (duration > limiter->period) ? duration - limiter->period
+                                                  : limiter->period - duration;
+
+    limiter->frames++;
+    limiter->jitter_sum += jitter;
+
+    if (jitter > limiter->jitter_max)
+        limiter->jitter_max = jitter;
+
+    limiter->last = now;
+    limiter->deadline += limiter->period;
+
+    return duration;
+}
+
+void pt_get_limiter_stats(const pt_limiter_t* limiter, pt_limiter_stats_t* stats)
+{
+    stats->frames      = limiter->frames;
+    stats->missed      = limiter->missed;
+    stats->mean_jitter = (limiter->frames > 0) ? limiter->jitter_sum / limiter->frames : 0;
+    stats->max_jitter  = limiter->jitter_max;
+    stats->margin      = limiter->margin;
+}
+
+void pt_reset_limiter_stats(pt_limiter_t* limiter)
+{
+    limiter->frames     = 0;
+    limiter->missed     = 0;
+    limiter->jitter_sum = 0;
+    limiter->jitter_max = 0;
+}
+
 #endif // PICO_TIME_IMPLEMENTATION
 
 /*
@@ -19,6 +19,8 @@
     * Ability to print test statistics
     * Optional color coded output
     * Optional time measurement
+    * Micro-benchmarks with CSV or JSON output
+    * Optional parallel test execution (threads or isolated processes)
     * Permissive licensing (zlib or public domain)
 
     Summary:
@@ -46,6 +48,34 @@
     shows up in the test statistics. There is also the option to flexibly define
     setup and teardown functions for groups of tests.
 
+    Benchmarks are defined with BENCH_CASE and run with RUN_BENCH_CASE. A
+    benchmark executes its body `iterations` times. The number of iterations is
+    calibrated so that each sample takes at least PICO_UNIT_BENCH_SAMPLE_TIME
+    seconds, and samples are taken after a warmup period. The minimum, median,
+    99th percentile and mean time per iteration are reported. Results that are
+    otherwise unused should be passed to PU_DO_NOT_OPTIMIZE so the compiler
+    cannot remove the code being measured. Results can also be written to a
+    file, one line per benchmark, in CSV or JSON Lines format (see
+    `pu_bench_output`).
+
+    Benchmarks are timed with the cycle counter of pico_time if pico_time.h is
+    included before the implementation of this library, and with `clock`
+    otherwise. They are skipped if PICO_UNIT_NO_CLOCK is defined and pico_time
+    is not available.
+
+    Independent tests can be run in parallel. Tests and suites run between
+    calls to `pu_begin_parallel` and `pu_end_parallel` are queued, then run
+    concurrently by a number of worker threads, or by child processes so that
+    a crashing test is reported as a failure rather than ending the run. Their
+    results are printed in the original order and added to the statistics.
+    Setup and teardown functions run in the worker along with each test, so
+    tests (and fixtures) that share state must not be run in parallel. This
+    feature requires PICO_UNIT_PARALLEL to be defined before the
+    implementation (and linking with pthreads on POSIX systems); otherwise
+    tests always run serially. Process isolation is only available on POSIX
+    systems, elsewhere threads are used instead. Elapsed times are not
+    displayed for tests run in parallel.
+
     Please see the examples for more details.
 
     Usage:
@@ -57,13 +87,29 @@
     > #include "pico_unit.h"
 
     to a source file (once), then simply include the header normally.
+
+    When PICO_UNIT_PARALLEL is defined, this library must be included before
+    any other headers in the file that contains the implementation.
+
+    Constants:
+    ----------
+
+    - PICO_UNIT_BENCH_SAMPLES (default: 100) Samples taken per benchmark
+    - PICO_UNIT_BENCH_SAMPLE_TIME (default: 0.001) Minimum sample duration
+      (seconds)
+    - PICO_UNIT_BENCH_WARMUP_TIME (default: 0.05) Warmup duration (seconds)
 */
 
+#if defined(PICO_UNIT_IMPLEMENTATION) && defined(PICO_UNIT_PARALLEL) && \
+    !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #ifndef PICO_UNIT_H
 #define PICO_UNIT_H
 
 #include <stdbool.h> /* bool, true, false */
-#include <stddef.h>  /* NULL */
+#include <stddef.h>  /* NULL, size_t */
 #include <string.h>  /* strcmp */
 
 #ifdef __cplusplus
@@ -117,6 +163,62 @@ extern "C" {
  */
 #define RUN_TEST_SUITE(suite_fp) pu_run_suite(#suite_fp, suite_fp)
 
+/**
+ * @brief Defines a benchmark.
+ *
+ * The body of the benchmark must execute the code being measured `iterations`
+ * times, e.g. `for (size_t i = 0; i < iterations; i++) { ... }`.
+ *
+ * @param name The name of the benchmark. Must be a valid C function name
+ */
+#define BENCH_CASE(name) static void name(size_t iterations)
+
+/**
+ * @brief Runs a benchmark function and prints its timings.
+ *
+ * @param bench_fp The benchmark function to execute
+ */
+#define RUN_BENCH_CASE(bench_fp) (pu_run_bench(#bench_fp, bench_fp))
+
+/**
+ * @brief Prevents the compiler from optimizing away the computation of a value.
+ *
+ * Passing an array (or pointer) also forces the memory it points to to be
+ * written. The value must be an lvalue (e.g. a variable), since its address
+ * is taken on every compiler.
+ *
+ * @param value A scalar, pointer, or array variable
+ */
+#if defined(__GNUC__) || defined(__clang__)
+    #define PU_DO_NOT_OPTIMIZE(value) \
+        __asm__ __volatile__ ("" : : "g" (&(value)) : "memory")
+#else
+    #define PU_DO_NOT_OPTIMIZE(value) pu_do_not_optimize(&(value))
+#endif
+
+/**
+ * @brief Benchmark output formats
+ */
+typedef enum
+{
+    PU_BENCH_CSV,
+    PU_BENCH_JSON  //!< One JSON object per line (JSON Lines)
+} pu_bench_format_t;
+
+/**
+ * @brief Writes the results of subsequent benchmarks to a file, in addition
+ * to printing them.
+ *
+ * The file is overwritten. Each result is flushed as soon as the benchmark
+ * completes. CSV files begin with a header line.
+ *
+ * @param path The path of the file or `NULL` to close the current file
+ * @param format The format of the results
+ *
+ * @returns `false` if the file could not be opened
+ */
+bool pu_bench_output(const char* path, pu_bench_format_t format);
+
 /**
  * @brief Functions that are run before or after a number of unit tests execute.
  */
@@ -151,7 +253,23 @@ void pu_display_colors(bool enabled);
 void pu_display_time(bool enabled);
 
 /**
- * @brief Prints test statistics.
+ * @brief Queues subsequent tests to be run in parallel.
+ *
+ * Requires PICO_UNIT_PARALLEL, otherwise this function does nothing.
+ * Benchmarks are not queued.
+ *
+ * @param workers The number of tests to run at once (0 for one per CPU)
+ * @param isolate If `true` each test runs in its own process (POSIX only)
+ */
+void pu_begin_parallel(int workers, bool isolate);
+
+/**
+ * @brief Runs the queued tests and waits for them to finish.
+ */
+void pu_end_parallel(void);
+
+/**
+ * @brief Prints test statistics. Runs any queued tests first.
  */
 void pu_print_stats(void);
 
@@ -168,6 +286,7 @@ bool pu_test_failed(void);
  */
 typedef bool (*pu_test_fn)(void);
 typedef void (*pu_suite_fn)(void);
+typedef void (*pu_bench_fn)(size_t iterations);
 
 /**
  * @brief Used internally
@@ -187,6 +306,16 @@ void pu_run_test(const char* const name, pu_test_fn test_fp);
  */
 void pu_run_suite(const char* const name, pu_suite_fn suite_fp);
 
+/**
+ * @brief Used internally
+ */
+void pu_run_bench(const char* const name, pu_bench_fn bench_fp);
+
+/**
+ * @brief Used internally
+ */
+void pu_do_not_optimize(const void* ptr);
+
 #ifdef __cplusplus
 }
 #endif
@@ -195,7 +324,8 @@ void pu_run_suite(const char* const name, pu_suite_fn suite_fp);
 
 #ifdef PICO_UNIT_IMPLEMENTATION
 
-#include <stdio.h> /* printf */
+#include <stdio.h>  /* printf, FILE */
+#include <stdlib.h> /* qsort */
 
 #ifndef PICO_UNIT_NO_CLOCK
 #include <time.h>  /* clock_t, clock */
@@ -217,6 +347,43 @@ static bool     pu_time        = false;
 static pu_setup_fn pu_setup_fp    = NULL;
 static pu_setup_fn pu_teardown_fp = NULL;
 
+static bool pu_queue_tests(const char* name, pu_test_fn test_fp);
+static bool pu_queue_suite(const char* name);
+static bool pu_record_require(bool passed, const char* expr,
+                              const char* file, int line);
+
+static void
+pu_print_failure (const char* const expr,
+                  const char* const file,
+                  int line)
+{
+    if (pu_colors)
+    {
+        printf("(%c%sFAILED%c%s: %s (%d): %s)\n",
+               TERM_COLOR_CODE, TERM_COLOR_RED,
+               TERM_COLOR_CODE, TERM_COLOR_RESET,
+               file, line, expr);
+    }
+    else
+    {
+        printf("(FAILED: %s (%d): %s)\n", file, line, expr);
+    }
+}
+
+static void
+pu_print_ok (void)
+{
+    if (pu_colors)
+    {
+        printf("(%c%sOK%c%s)", TERM_COLOR_CODE, TERM_COLOR_GREEN,
+                               TERM_COLOR_CODE, TERM_COLOR_RESET);
+    }
+    else
+    {
+        printf("(OK)");
+    }
+}
+
 void
 pu_setup (pu_setup_fn fp_setup, pu_setup_fn fp_teardown)
 {
@@ -255,6 +422,11 @@ pu_require(bool passed,
            const char* const file,
            int line)
 {
+    if (pu_record_require(passed, expr, file, line))
+    {
+        return passed;
+    }
+
     pu_num_asserts++;
 
     if (passed)
@@ -262,17 +434,7 @@ pu_require(bool passed,
         return true;
     }
 
-    if (pu_colors)
-    {
-        printf("(%c%sFAILED%c%s: %s (%d): %s)\n",
-               TERM_COLOR_CODE, TERM_COLOR_RED,
-               TERM_COLOR_CODE, TERM_COLOR_RESET,
-               file, line, expr);
-    }
-    else
-    {
-        printf("(FAILED: %s (%d): %s)\n", file, line, expr);
-    }
+    pu_print_failure(expr, file, line);
 
     return false;
 }
@@ -280,6 +442,11 @@ pu_require(bool passed,
 void
 pu_run_test (const char* const name, pu_test_fn test_fp)
 {
+    if (pu_queue_tests(name, test_fp))
+    {
+        return;
+    }
+
     if (NULL != pu_setup_fp)
     {
         pu_setup_fp();
@@ -320,15 +487,7 @@ pu_run_test (const char* const name, pu_test_fn test_fp)
 
     #endif // PICO_UNIT_NO_CLOCK
 
-    if (pu_colors)
-    {
-        printf("(%c%sOK%c%s)", TERM_COLOR_CODE, TERM_COLOR_GREEN,
-                               TERM_COLOR_CODE, TERM_COLOR_RESET);
-    }
-    else
-    {
-        printf("(OK)");
-    }
+    pu_print_ok();
 
     #ifndef PICO_UNIT_NO_CLOCK
 
@@ -349,8 +508,8 @@ pu_run_test (const char* const name, pu_test_fn test_fp)
     }
 }
 
-void
-pu_run_suite (const char* const name, pu_suite_fn suite_fp)
+static void
+pu_print_suite (const char* const name)
 {
     printf("===============================================================\n");
 
@@ -366,6 +525,19 @@ pu_run_suite (const char* const name, pu_suite_fn suite_fp)
     }
 
     printf("---------------------------------------------------------------\n");
+}
+
+void
+pu_run_suite (const char* const name, pu_suite_fn suite_fp)
+{
+    if (pu_queue_suite(name))
+    {
+        suite_fp();
+        pu_num_suites++;
+        return;
+    }
+
+    pu_print_suite(name);
     suite_fp();
     pu_num_suites++;
 }
@@ -373,6 +545,8 @@ pu_run_suite (const char* const name, pu_suite_fn suite_fp)
 void
 pu_print_stats (void)
 {
+    pu_end_parallel();
+
     printf("===============================================================\n");
 
     if (pu_colors)
@@ -401,6 +575,737 @@ pu_print_stats (void)
     }
 }
 
+/*==============================================================================
+ * Parallel execution
+ *============================================================================*/
+
+#ifdef PICO_UNIT_PARALLEL
+
+#if defined(_WIN32)
+    #include <windows.h>
+
+    typedef CRITICAL_SECTION pu_mutex_t;
+
+    #define PU_MUTEX_INIT(m)    InitializeCriticalSection(&(m))
+    #define PU_MUTEX_DESTROY(m) DeleteCriticalSection(&(m))
+    #define PU_MUTEX_LOCK(m)    EnterCriticalSection(&(m))
+    #define PU_MUTEX_UNLOCK(m)  LeaveCriticalSection(&(m))
+#else
+    #include <errno.h>
+    #include <pthread.h>
+    #include <sys/wait.h>
+    #include <unistd.h>
+
+    typedef pthread_mutex_t pu_mutex_t;
+
+    #define PU_MUTEX_INIT(m)    pthread_mutex_init(&(m), NULL)
+    #define PU_MUTEX_DESTROY(m) pthread_mutex_destroy(&(m))
+    #define PU_MUTEX_LOCK(m)    pthread_mutex_lock(&(m))
+    #define PU_MUTEX_UNLOCK(m)  pthread_mutex_unlock(&(m))
+#endif
+
+#if defined(_MSC_VER)
+    #define PU_THREAD_LOCAL __declspec(thread)
+#else
+    #define PU_THREAD_LOCAL __thread
+#endif
+
+/*
+ * Outcome of a test. Sent through a pipe from isolated processes, which is
+ * safe for the pointers since they refer to string literals in a forked copy
+ * of the program
+ */
+typedef struct
+{
+    bool        passed;
+    unsigned    asserts;
+    const char* expr;   // First failed assertion (NULL if none)
+    const char* file;
+    int         line;
+    int         signal; // Set if the process crashed
+    int         status; // Set if the process exited from within the test
+} pu_result_t;
+
+typedef struct
+{
+    const char* name;
+    pu_test_fn  test_fp;  // NULL for suite headers
+    pu_setup_fn setup_fp;
+    pu_setup_fn teardown_fp;
+    bool        done;
+    pu_result_t result;
+    #ifndef _WIN32
+    pid_t       pid;
+    int         fd;
+    #endif
+} pu_job_t;
+
+static bool      pu_parallel      = false;
+static int       pu_workers       = 0;
+static bool      pu_isolate       = false;
+static pu_job_t* pu_jobs          = NULL;
+static size_t    pu_job_count     = 0;
+static size_t    pu_job_capacity  = 0;
+static size_t    pu_next_job      = 0;
+static size_t    pu_printed_jobs  = 0;
+static pu_mutex_t pu_job_mutex;
+
+static PU_THREAD_LOCAL pu_result_t* pu_current_result = NULL;
+
+static pu_job_t*
+pu_add_job (const char* name, pu_test_fn test_fp)
+{
+    if (pu_job_count == pu_job_capacity)
+    {
+        size_t capacity = (pu_job_capacity > 0) ? 2 * pu_job_capacity : 64;
+        pu_job_t* jobs = (pu_job_t*)realloc(pu_jobs, capacity * sizeof(pu_job_t));
+
+        if (NULL == jobs)
+        {
+            return NULL;
+        }
+
+        pu_jobs = jobs;
+        pu_job_capacity = capacity;
+    }
+
+    pu_job_t* job = &pu_jobs[pu_job_count++];
+
+    memset(job, 0, sizeof(pu_job_t));
+
+    job->name        = name;
+    job->test_fp     = test_fp;
+    job->setup_fp    = pu_setup_fp;
+    job->teardown_fp = pu_teardown_fp;
+    job->done        = (NULL == test_fp);
+
+    return job;
+}
+
+static bool
+pu_queue_tests (const char* name, pu_test_fn test_fp)
+{
+    // Falls back to running the test serially if the queue cannot grow
+    return pu_parallel && NULL != pu_add_job(name, test_fp);
+}
+
+static bool
+pu_queue_suite (const char* name)
+{
+    return pu_parallel && NULL != pu_add_job(name, NULL);
+}
+
+static bool
+pu_record_require (bool passed, const char* expr, const char* file, int line)
+{
+    pu_result_t* result = pu_current_result;
+
+    if (NULL == result)
+    {
+        return false;
+    }
+
+    result->asserts++;
+
+    if (!passed && NULL == result->expr)
+    {
+        result->expr = expr;
+        result->file = file;
+        result->line = line;
+    }
+
+    return true;
+}
+
+static void
+pu_execute_job (pu_job_t* job)
+{
+    pu_current_result = &job->result;
+
+    if (NULL != job->setup_fp)
+    {
+        job->setup_fp();
+    }
+
+    job->result.passed = job->test_fp();
+
+    if (NULL != job->teardown_fp)
+    {
+        job->teardown_fp();
+    }
+
+    pu_current_result = NULL;
+}
+
+static void
+pu_print_abnormal (const char* reason, int code)
+{
+    if (pu_colors)
+    {
+        printf("(%c%sFAILED%c%s: %s %d)\n",
+               TERM_COLOR_CODE, TERM_COLOR_RED,
+               TERM_COLOR_CODE, TERM_COLOR_RESET,
+               reason, code);
+    }
+    else
+    {
+        printf("(FAILED: %s %d)\n", reason, code);
+    }
+}
+
+// Prints the completed jobs that follow the ones already printed, so output
+// appears in the order the tests were queued
+static void
+pu_print_jobs (void)
+{
+    while (pu_printed_jobs < pu_job_count && pu_jobs[pu_printed_jobs].done)
+    {
+        const pu_job_t* job = &pu_jobs[pu_printed_jobs++];
+        const pu_result_t* result = &job->result;
+
+        if (NULL == job->test_fp)
+        {
+            pu_print_suite(job->name);
+            continue;
+        }
+
+        printf("Running: %s ", job->name);
+
+        pu_num_asserts += result->asserts;
+
+        if (result->passed)
+        {
+            pu_print_ok();
+            printf("\n");
+            pu_num_passed++;
+            continue;
+        }
+
+        pu_num_failed++;
+
+        if (NULL != result->expr)
+        {
+            pu_print_failure(result->expr, result->file, result->line);
+        }
+        else if (0 != result->signal)
+        {
+            pu_print_abnormal("crashed with signal", result->signal);
+        }
+        else
+        {
+            pu_print_abnormal("exited with status", result->status);
+        }
+    }
+
+    fflush(stdout);
+}
+
+#if defined(_WIN32)
+
+static DWORD WINAPI
+pu_worker (LPVOID arg)
+#else
+
+static void*
+pu_worker (void* arg)
+#endif
+{
+    (void)arg;
+
+    for (;;)
+    {
+        PU_MUTEX_LOCK(pu_job_mutex);
+
+        while (pu_next_job < pu_job_count && pu_jobs[pu_next_job].done)
+        {
+            pu_next_job++;
+        }
+
+        pu_job_t* job = (pu_next_job < pu_job_count) ? &pu_jobs[pu_next_job++] : NULL;
+
+        PU_MUTEX_UNLOCK(pu_job_mutex);
+
+        if (NULL == job)
+        {
+            break;
+        }
+
+        pu_execute_job(job);
+
+        PU_MUTEX_LOCK(pu_job_mutex);
+        job->done = true;
+        pu_print_jobs();
+        PU_MUTEX_UNLOCK(pu_job_mutex);
+    }
+
+    return 0;
+}
+
+static void
+pu_run_threads (void)
+{
+    int thread_count = pu_workers - 1; // The calling thread is also a worker
+
+    #if defined(_WIN32)
+    HANDLE* threads = (HANDLE*)calloc((size_t)thread_count + 1, sizeof(HANDLE));
+    #else
+    pthread_t* threads = (pthread_t*)calloc((size_t)thread_count + 1, sizeof(pthread_t));
+    #endif
+
+    int started = 0;
+
+    PU_MUTEX_INIT(pu_job_mutex);
+
+    for (int i = 0; NULL != threads && i < thread_count; i++)
+    {
+        #if defined(_WIN32)
+        threads[started] = CreateThread(NULL, 0, pu_worker, NULL, 0, NULL);
+
+        if (NULL == threads[started])
+            break;
+        #else
+        if (0 != pthread_create(&threads[started], NULL, pu_worker, NULL))
+            break;
+        #endif
+
+        started++;
+    }
+
+    pu_worker(NULL);
+
+    for (int i = 0; i < started; i++)
+    {
+        #if defined(_WIN32)
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+        #else
+        pthread_join(threads[i], NULL);
+        #endif
+    }
+
+    PU_MUTEX_DESTROY(pu_job_mutex);
+
+    free(threads);
+}
+
+#ifndef _WIN32
+
+static void
+pu_finish_process (pu_job_t* job, int status)
+{
+    pu_result_t result;
+
+    if ((ssize_t)sizeof(result) == read(job->fd, &result, sizeof(result)))
+    {
+        job->result = result;
+    }
+    else if (WIFSIGNALED(status))
+    {
+        job->result.signal = WTERMSIG(status);
+    }
+    else
+    {
+        job->result.status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    }
+
+    close(job->fd);
+    job->pid = 0;
+    job->done = true;
+}
+
+static void
+pu_run_processes (void)
+{
+    size_t next = 0;
+    int running = 0;
+
+    while (next < pu_job_count || running > 0)
+    {
+        while (running < pu_workers && next < pu_job_count)
+        {
+            pu_job_t* job = &pu_jobs[next++];
+
+            if (job->done)
+            {
+                continue;
+            }
+
+            int fds[2];
+
+            if (0 != pipe(fds))
+            {
+                job->result.status = -1;
+                job->done = true;
+                continue;
+            }
+
+            // Prevents buffered output from being written twice
+            fflush(stdout);
+
+            pid_t pid = fork();
+
+            if (0 == pid)
+            {
+                close(fds[0]);
+                pu_execute_job(job);
+                fflush(stdout);
+
+                ssize_t written = write(fds[1], &job->result, sizeof(pu_result_t));
+                (void)written;
+
+                _exit(0);
+            }
+
+            close(fds[1]);
+
+            if (pid < 0)
+            {
+                close(fds[0]);
+                job->result.status = -1;
+                job->done = true;
+                continue;
+            }
+
+            job->pid = pid;
+            job->fd = fds[0];
+            running++;
+        }
+
+        pu_print_jobs();
+
+        if (0 == running)
+        {
+            continue;
+        }
+
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+
+        if (pid < 0)
+        {
+            if (EINTR == errno)
+                continue;
+
+            break;
+        }
+
+        for (size_t i = 0; i < next; i++)
+        {
+            if (pu_jobs[i].pid == pid && !pu_jobs[i].done)
+            {
+                pu_finish_process(&pu_jobs[i], status);
+                running--;
+                break;
+            }
+        }
+    }
+
+    pu_print_jobs();
+}
+
+#endif // _WIN32
+
+void
+pu_begin_parallel (int workers, bool isolate)
+{
+    if (workers <= 0)
+    {
+        #if defined(_WIN32)
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        workers = (int)info.dwNumberOfProcessors;
+        #else
+        workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        #endif
+    }
+
+    pu_parallel = true;
+    pu_workers  = (workers > 0) ? workers : 1;
+    pu_isolate  = isolate;
+}
+
+void
+pu_end_parallel (void)
+{
+    if (!pu_parallel)
+    {
+        return;
+    }
+
+    pu_parallel = false;
+
+    #ifndef _WIN32
+    if (pu_isolate)
+    {
+        pu_run_processes();
+    }
+    else
+    #endif
+    {
+        pu_run_threads();
+    }
+
+    free(pu_jobs);
+
+    pu_jobs         = NULL;
+    pu_job_count    = 0;
+    pu_job_capacity = 0;
+    pu_next_job     = 0;
+    pu_printed_jobs = 0;
+}
+
+#else
+
+static bool
+pu_queue_tests (const char* name, pu_test_fn test_fp)
+{
+    (void)name;
+    (void)test_fp;
+    return false;
+}
+
+static bool
+pu_queue_suite (const char* name)
+{
+    (void)name;
+    return false;
+}
+
+static bool
+pu_record_require (bool passed, const char* expr, const char* file, int line)
+{
+    (void)passed;
+    (void)expr;
+    (void)file;
+    (void)line;
+    return false;
+}
+
+void
+pu_begin_parallel (int workers, bool isolate)
+{
+    (void)workers;
+    (void)isolate;
+}
+
+void
+pu_end_parallel (void)
+{
+}
+
+#endif // PICO_UNIT_PARALLEL
+
+/*==============================================================================
+ * Benchmarks
+ *============================================================================*/
+
+#ifndef PICO_UNIT_BENCH_SAMPLES
+#define PICO_UNIT_BENCH_SAMPLES 100
+#endif
+
+#ifndef PICO_UNIT_BENCH_SAMPLE_TIME
+#define PICO_UNIT_BENCH_SAMPLE_TIME 0.001
+#endif
+
+#ifndef PICO_UNIT_BENCH_WARMUP_TIME
+#define PICO_UNIT_BENCH_WARMUP_TIME 0.05
+#endif
+
+#if defined(PICO_TIME_H)
+    #define PU_BENCH_CLOCK
+    typedef uint64_t pu_bench_time_t;
+    #define PU_BENCH_NOW() pt_ticks()
+    #define PU_BENCH_ELAPSED(start, end) pt_ticks_to_sec((end) - (start))
+#elif !defined(PICO_UNIT_NO_CLOCK)
+    #define PU_BENCH_CLOCK
+    typedef clock_t pu_bench_time_t;
+    #define PU_BENCH_NOW() clock()
+    #define PU_BENCH_ELAPSED(start, end) ((double)((end) - (start)) / CLOCKS_PER_SEC)
+#endif
+
+static FILE*             pu_bench_file   = NULL;
+static pu_bench_format_t pu_bench_format = PU_BENCH_CSV;
+
+static volatile char pu_bench_sink = 0;
+
+void
+pu_do_not_optimize (const void* ptr)
+{
+    pu_bench_sink = *(const volatile char*)ptr;
+}
+
+bool
+pu_bench_output (const char* path, pu_bench_format_t format)
+{
+    if (NULL != pu_bench_file)
+    {
+        fclose(pu_bench_file);
+        pu_bench_file = NULL;
+    }
+
+    if (NULL == path)
+    {
+        return true;
+    }
+
+    pu_bench_file = fopen(path, "w");
+
+    if (NULL == pu_bench_file)
+    {
+        return false;
+    }
+
+    pu_bench_format = format;
+
+    if (PU_BENCH_CSV == format)
+    {
+        fprintf(pu_bench_file, "name,iterations,samples,"
+                               "min_ns,median_ns,p99_ns,mean_ns\n");
+        fflush(pu_bench_file);
+    }
+
+    return true;
+}
+
+#ifdef PU_BENCH_CLOCK
+
+static double
+pu_time_bench (pu_bench_fn bench_fp, size_t iterations)
+{
+    pu_bench_time_t start_time = PU_BENCH_NOW();
+    bench_fp(iterations);
+    pu_bench_time_t end_time = PU_BENCH_NOW();
+
+    return PU_BENCH_ELAPSED(start_time, end_time);
+}
+
+static int
+pu_compare_samples (const void* a, const void* b)
+{
+    double lhs = *(const double*)a;
+    double rhs = *(const double*)b;
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+static void
+pu_print_duration (const char* label, double secs)
+{
+    if (secs < 1e-6)
+        printf("%s %.2f ns", label, secs * 1e9);
+    else if (secs < 1e-3)
+        printf("%s %.2f us", label, secs * 1e6);
+    else if (secs < 1.0)
+        printf("%s %.2f ms", label, secs * 1e3);
+    else
+        printf("%s %.2f s", label, secs);
+}
+
+#endif // PU_BENCH_CLOCK
+
+void
+pu_run_bench (const char* const name, pu_bench_fn bench_fp)
+{
+    printf("Benchmark: %s ", name);
+
+    #ifndef PU_BENCH_CLOCK
+
+    (void)bench_fp;
+
+    if (pu_colors)
+    {
+        printf("(%c%sSKIPPED%c%s: no clock)\n", TERM_COLOR_CODE, TERM_COLOR_BOLD,
+                                                 TERM_COLOR_CODE, TERM_COLOR_RESET);
+    }
+    else
+    {
+        printf("(SKIPPED: no clock)\n");
+    }
+
+    #else
+
+    fflush(stdout);
+
+    static double samples[PICO_UNIT_BENCH_SAMPLES];
+
+    // Find the number of iterations that fills a sample
+    size_t iterations = 1;
+
+    for (;;)
+    {
+        double elapsed = pu_time_bench(bench_fp, iterations);
+
+        // The second condition guards against bodies optimized away entirely
+        if (elapsed >= PICO_UNIT_BENCH_SAMPLE_TIME || iterations > (size_t)-1 / 16)
+        {
+            break;
+        }
+
+        // Grow by at most 10x, since the first timings are the least reliable
+        double scale = (elapsed > 0.0) ? 1.2 * PICO_UNIT_BENCH_SAMPLE_TIME / elapsed
+                                       : 10.0;
+
+        if (scale > 10.0)
+            scale = 10.0;
+
+        if (scale < 2.0)
+            scale = 2.0;
+
+        iterations = (size_t)((double)iterations * scale);
+    }
+
+    // Warm up caches, branch predictors and CPU frequency
+    double warmup = 0.0;
+
+    while (warmup < PICO_UNIT_BENCH_WARMUP_TIME)
+    {
+        warmup += pu_time_bench(bench_fp, iterations);
+    }
+
+    double total = 0.0;
+
+    for (int i = 0; i < PICO_UNIT_BENCH_SAMPLES; i++)
+    {
+        samples[i] = pu_time_bench(bench_fp, iterations) / (double)iterations;
+        total += samples[i];
+    }
+
+    qsort(samples, PICO_UNIT_BENCH_SAMPLES, sizeof(double), pu_compare_samples);
+
+    double min    = samples[0];
+    double median = samples[PICO_UNIT_BENCH_SAMPLES / 2];
+    double p99    = samples[(PICO_UNIT_BENCH_SAMPLES * 99 + 99) / 100 - 1];
+    double mean   = total / PICO_UNIT_BENCH_SAMPLES;
+
+    printf("(");
+    pu_print_duration("min", min);
+    pu_print_duration(", median", median);
+    pu_print_duration(", p99", p99);
+    pu_print_duration(", mean", mean);
+    printf(", %d x %lu iterations)\n", PICO_UNIT_BENCH_SAMPLES, (unsigned long)iterations);
+
+    if (NULL != pu_bench_file)
+    {
+        if (PU_BENCH_CSV == pu_bench_format)
+        {
+            fprintf(pu_bench_file, "%s,%lu,%d,%.3f,%.3f,%.3f,%.3f\n",
+                    name, (unsigned long)iterations, PICO_UNIT_BENCH_SAMPLES,
+                    min * 1e9, median * 1e9, p99 * 1e9, mean * 1e9);
+        }
+        else
+        {
+            fprintf(pu_bench_file, "{\"name\": \"%s\", \"iterations\": %lu, "
+                                   "\"samples\": %d, \"min_ns\": %.3f, "
+                                   "\"median_ns\": %.3f, \"p99_ns\": %.3f, "
+                                   "\"mean_ns\": %.3f}\n",
+                    name, (unsigned long)iterations, PICO_UNIT_BENCH_SAMPLES,
+                    min * 1e9, median * 1e9, p99 * 1e9, mean * 1e9);
+        }
+
+        fflush(pu_bench_file);
+    }
+
+    #endif // PU_BENCH_CLOCK
+}
 
 #endif // PICO_UNIT_IMPLEMENTATION
 
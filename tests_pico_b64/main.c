@@ -72,11 +72,178 @@ TEST_CASE(test_decode)
     return true;
 }
 
+/*
+ * Inputs long enough to be handled by the vector kernels
+ */
+
+TEST_CASE(test_long_roundtrip)
+{
+    unsigned char src[1000];
+    char encoded[1336];
+    unsigned char decoded[1000];
+
+    for (size_t len = 0; len <= sizeof(src); len += 37)
+    {
+        for (size_t i = 0; i < len; i++)
+        {
+            src[i] = (unsigned char)(i * 7 + len);
+        }
+
+        size_t encoded_len = b64_encode(encoded, src, len);
+
+        REQUIRE(encoded_len == b64_encoded_size(len));
+        REQUIRE(b64_decoded_size(encoded, encoded_len) == len);
+        REQUIRE(b64_decode(decoded, encoded, encoded_len) == len);
+        REQUIRE(0 == memcmp(src, decoded, len));
+    }
+
+    return true;
+}
+
+TEST_CASE(test_long_decode_invalid)
+{
+    char src[200];
+    unsigned char decoded[150];
+
+    memset(src, 'A', sizeof(src));
+
+    // Decoding stops at the first character outside of the alphabet
+    src[101] = '*';
+    REQUIRE(b64_decode(decoded, src, sizeof(src)) == 75);
+
+    src[101] = '=';
+    REQUIRE(b64_decode(decoded, src, sizeof(src)) == 75);
+
+    src[101] = (char)0xC3;
+    REQUIRE(b64_decode(decoded, src, sizeof(src)) == 75);
+
+    src[101] = 'A';
+    REQUIRE(b64_decode(decoded, src, sizeof(src)) == 150);
+
+    return true;
+}
+
+TEST_CASE(test_stream)
+{
+    const char* src = "Many hands make light work.";
+    const char* expected = "TWFueSBoYW5kcyBtYWtlIGxpZ2h0IHdvcmsu";
+
+    size_t len = strlen(src);
+
+    // Every chunk size, including chunks smaller than a group
+    for (size_t chunk = 1; chunk <= len; chunk++)
+    {
+        char encoded[64];
+        unsigned char decoded[64];
+        size_t encoded_len = 0;
+        size_t decoded_len = 0;
+
+        b64_encode_state_t encoder;
+        b64_encode_init(&encoder);
+
+        for (size_t i = 0; i < len; i += chunk)
+        {
+            size_t n = (len - i < chunk) ? len - i : chunk;
+            encoded_len += b64_encode_update(&encoder, encoded + encoded_len,
+                                             (const unsigned char*)src + i, n);
+        }
+
+        encoded_len += b64_encode_final(&encoder, encoded + encoded_len);
+
+        REQUIRE(encoded_len == strlen(expected));
+        REQUIRE(0 == memcmp(encoded, expected, encoded_len));
+
+        b64_decode_state_t decoder;
+        b64_decode_init(&decoder);
+
+        for (size_t i = 0; i < encoded_len; i += chunk)
+        {
+            size_t n = (encoded_len - i < chunk) ? encoded_len - i : chunk;
+            decoded_len += b64_decode_update(&decoder, decoded + decoded_len,
+                                             encoded + i, n);
+        }
+
+        decoded_len += b64_decode_final(&decoder, decoded + decoded_len);
+
+        REQUIRE(decoded_len == len);
+        REQUIRE(0 == memcmp(decoded, src, len));
+    }
+
+    // Padding ends the data, later chunks are ignored
+    unsigned char decoded[16];
+    b64_decode_state_t decoder;
+    b64_decode_init(&decoder);
+
+    size_t decoded_len = b64_decode_update(&decoder, decoded, "Zm9vYg", 6);
+    decoded_len += b64_decode_update(&decoder, decoded + decoded_len, "==", 2);
+
+    REQUIRE(decoder.stopped);
+    REQUIRE(0 == b64_decode_update(&decoder, decoded + decoded_len, "Zm9v", 4));
+
+    decoded_len += b64_decode_final(&decoder, decoded + decoded_len);
+
+    REQUIRE(decoded_len == 4);
+    REQUIRE(0 == memcmp(decoded, "foob", 4));
+
+    return true;
+}
+
+static bool checked_test(const char* src, b64_alphabet_t alphabet,
+                         const char* expected, size_t expected_error)
+{
+    unsigned char buf[64];
+    size_t error = 0;
+    size_t len = b64_decode_checked(buf, src, strlen(src), alphabet, &error);
+
+    return error == expected_error &&
+           len == strlen(expected) &&
+           0 == memcmp(buf, expected, len);
+}
+
+TEST_CASE(test_decode_checked)
+{
+    REQUIRE(checked_test(""            , B64_STANDARD, ""      , B64_NO_ERROR));
+    REQUIRE(checked_test("Zm9vYmFy"    , B64_STANDARD, "foobar", B64_NO_ERROR));
+    REQUIRE(checked_test("Zm9vYg=="    , B64_STANDARD, "foob"  , B64_NO_ERROR));
+    REQUIRE(checked_test("Zm9vYmE="    , B64_STANDARD, "fooba" , B64_NO_ERROR));
+    REQUIRE(checked_test("YStiL2M="    , B64_STANDARD, "a+b/c" , B64_NO_ERROR));
+
+    // Padding is optional
+    REQUIRE(checked_test("Zm9vYg"      , B64_STANDARD, "foob"  , B64_NO_ERROR));
+    REQUIRE(checked_test("Zm9vYmE"     , B64_STANDARD, "fooba" , B64_NO_ERROR));
+
+    // URL-safe alphabet
+    REQUIRE(checked_test("YStiL2M"     , B64_URL     , "a+b/c" , B64_NO_ERROR));
+    REQUIRE(checked_test("-_-_"        , B64_URL     , "\xfb\xff\xbf", B64_NO_ERROR));
+    REQUIRE(checked_test("-_-_"        , B64_STANDARD, ""      , 0));
+    REQUIRE(checked_test("+/+/"        , B64_URL     , ""      , 0));
+
+    // Invalid characters, reported with the complete groups before them
+    REQUIRE(checked_test("Zm9v*mFy"    , B64_STANDARD, "foo"   , 4));
+    REQUIRE(checked_test("Zm9vYm\nFy" , B64_STANDARD, "foo"   , 6));
+
+    // A lone character does not encode a byte
+    REQUIRE(checked_test("Zm9vY"       , B64_STANDARD, "foo"   , 4));
+
+    // Malformed padding
+    REQUIRE(checked_test("Zm9v="       , B64_STANDARD, "foo"   , 4));
+    REQUIRE(checked_test("Zm9vY==="    , B64_STANDARD, "foo"   , 5));
+    REQUIRE(checked_test("Zm9vYg="     , B64_STANDARD, "foo"   , 7));
+    REQUIRE(checked_test("Zm9vYg=A"    , B64_STANDARD, "foo"   , 7));
+    REQUIRE(checked_test("Zm9vYg==Zm9v", B64_STANDARD, "foo"   , 8));
+
+    return true;
+}
+
 int main()
 {
     pu_display_colors(true);
     RUN_TEST_CASE(test_encode);
     RUN_TEST_CASE(test_decode);
+    RUN_TEST_CASE(test_long_roundtrip);
+    RUN_TEST_CASE(test_long_decode_invalid);
+    RUN_TEST_CASE(test_stream);
+    RUN_TEST_CASE(test_decode_checked);
     pu_print_stats();
     return pu_test_failed();
 }
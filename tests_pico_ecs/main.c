@@ -6,6 +6,8 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define MIN_ENTITIES (1 * 1024)
 #define MAX_ENTITIES (8 * 1024)
@@ -100,6 +102,61 @@ TEST_CASE(test_exclude)
     return true;
 }
 
+static int exclude_add_count;
+static int exclude_remove_count;
+
+static void exclude_add_cb(ecs_t* ecs, ecs_id_t entity_id, void* udata)
+{
+    (void)ecs;
+    (void)entity_id;
+    (void)udata;
+    exclude_add_count++;
+}
+
+static void exclude_remove_cb(ecs_t* ecs, ecs_id_t entity_id, void* udata)
+{
+    (void)ecs;
+    (void)entity_id;
+    (void)udata;
+    exclude_remove_count++;
+}
+
+TEST_CASE(test_exclude_add_remove)
+{
+    exclude_add_count = 0;
+    exclude_remove_count = 0;
+
+    ecs_id_t system_id = ecs_register_system(ecs, exclude_system,
+                                             exclude_add_cb, exclude_remove_cb, NULL);
+
+    ecs_require_component(ecs, system_id, comp2_id);
+    ecs_exclude_component(ecs, system_id, comp1_id);
+
+    ecs_id_t entity_id = ecs_create(ecs);
+    ecs_add(ecs, entity_id, comp2_id, NULL);
+
+    REQUIRE(exclude_add_count == 1);
+
+    // Adding an excluded component removes the entity from the system
+    ecs_add(ecs, entity_id, comp1_id, NULL);
+
+    REQUIRE(exclude_remove_count == 1);
+
+    ecs_update_system(ecs, system_id, 0.0);
+    REQUIRE(exclude_sys_state.count == 0);
+
+    // Removing it again puts the entity back
+    ecs_remove(ecs, entity_id, comp1_id);
+
+    REQUIRE(exclude_add_count == 2);
+
+    ecs_update_system(ecs, system_id, 0.0);
+    REQUIRE(exclude_sys_state.count == 1);
+    REQUIRE(exclude_sys_state.eid == entity_id);
+
+    return true;
+}
+
 typedef struct
 {
     bool used;
@@ -297,6 +354,10 @@ static ecs_ret_t comp_system(ecs_t* ecs,
     return 0;
 }
 
+// Adding or removing components moves entities between archetypes, which
+// invalidates the component pointers held by the following tests
+#ifndef PICO_ECS_ARCHETYPES
+
 TEST_CASE(test_add_systems)
 {
     // Set up systems
@@ -423,6 +484,8 @@ TEST_CASE(test_destroy)
     return true;
 }
 
+#endif // PICO_ECS_ARCHETYPES
+
 static ecs_ret_t destroy_system(ecs_t* ecs,
                                 ecs_id_t* entities,
                                 int entity_count,
@@ -698,25 +761,777 @@ TEST_CASE(test_add_remove_callbacks)
     return true;
 }
 
+typedef struct
+{
+    int value;
+} value_t;
+
+TEST_CASE(test_packed_storage)
+{
+    ecs_id_t comp_id = ecs_register_component(ecs, sizeof(value_t), NULL, NULL);
+    ecs_set_component_storage(ecs, comp_id, ECS_STORAGE_PACKED);
+
+    ecs_id_t ids[16];
+
+    // Only add the packed component to every other entity
+    for (int i = 0; i < 16; i++)
+    {
+        ecs_id_t id = ecs_create(ecs);
+        ids[i] = id;
+
+        if (i % 2 == 0)
+        {
+            value_t* value = ecs_add(ecs, id, comp_id, NULL);
+            value->value = i;
+        }
+    }
+
+    // Remove a component from the middle of the packed array
+    ecs_remove(ecs, ids[4], comp_id);
+    REQUIRE(!ecs_has(ecs, ids[4], comp_id));
+
+    // Destroy an entity with a packed component
+    ecs_destroy(ecs, ids[0]);
+
+    // Remaining components must keep their values
+    for (int i = 2; i < 16; i += 2)
+    {
+        if (i == 4)
+            continue;
+
+        REQUIRE(ecs_has(ecs, ids[i], comp_id));
+
+        value_t* value = ecs_get(ecs, ids[i], comp_id);
+        REQUIRE(value->value == i);
+    }
+
+    // Re-adding a component yields a zeroed instance
+    value_t* value = ecs_add(ecs, ids[4], comp_id, NULL);
+    REQUIRE(value->value == 0);
+
+    return true;
+}
+
+static int many_add_count;
+
+static void many_add_cb(ecs_t* ecs, ecs_id_t entity_id, void* udata)
+{
+    (void)ecs;
+    (void)entity_id;
+    (void)udata;
+    many_add_count++;
+}
+
+TEST_CASE(test_create_add_many)
+{
+    enum { COUNT = 2000 }; // Exceeds the initial pool
+    static ecs_id_t ids[COUNT];
+    static value_t values[COUNT];
+
+    many_add_count = 0;
+
+    ecs_id_t value_id = ecs_register_component(ecs, sizeof(value_t), NULL, NULL);
+
+    ecs_id_t sys_id = ecs_register_system(ecs, exclude_system, many_add_cb, NULL, NULL);
+    ecs_require_component(ecs, sys_id, value_id);
+    ecs_require_component(ecs, sys_id, comp2_id);
+
+    for (int i = 0; i < COUNT; i++)
+        values[i].value = i;
+
+    ecs_id_t comp_ids[] = { comp1_id, value_id };
+    const void* comp_values[] = { NULL, values };
+
+    ecs_create_many(ecs, ids, COUNT, comp_ids, 2, comp_values);
+
+    for (int i = 0; i < COUNT; i++)
+    {
+        REQUIRE(ecs_is_ready(ecs, ids[i]));
+        REQUIRE(ecs_has(ecs, ids[i], comp1_id));
+        REQUIRE(!ecs_has(ecs, ids[i], comp2_id));
+
+        value_t* value = ecs_get(ecs, ids[i], value_id);
+        REQUIRE(value->value == i);
+    }
+
+    // Entities lack comp2, so they do not belong to the system yet
+    REQUIRE(many_add_count == 0);
+
+    ecs_add_many(ecs, ids, COUNT, comp2_id, NULL, NULL);
+
+    REQUIRE(many_add_count == COUNT);
+
+    ecs_update_system(ecs, sys_id, 0.0);
+    REQUIRE(exclude_sys_state.count == COUNT);
+
+    return true;
+}
+
+TEST_CASE(test_prefab)
+{
+    many_add_count = 0;
+
+    ecs_id_t value_id = ecs_register_component(ecs, sizeof(value_t), NULL, NULL);
+
+    ecs_id_t prefab_id = ecs_register_prefab(ecs);
+    value_t* defaults = ecs_prefab_add(ecs, prefab_id, value_id);
+    defaults->value = 42;
+    ecs_prefab_add(ecs, prefab_id, comp1_id);
+
+    ecs_id_t sys_id = ecs_register_system(ecs, exclude_system, many_add_cb, NULL, NULL);
+    ecs_require_component(ecs, sys_id, value_id);
+
+    ecs_id_t entity_id = ecs_instantiate(ecs, prefab_id);
+
+    REQUIRE(ecs_has(ecs, entity_id, comp1_id));
+    REQUIRE(!ecs_has(ecs, entity_id, comp2_id));
+    REQUIRE(((value_t*)ecs_get(ecs, entity_id, value_id))->value == 42);
+    REQUIRE(many_add_count == 1);
+
+    // Systems registered after the first instantiation must be picked up
+    ecs_id_t exclude_id = ecs_register_system(ecs, exclude_system, many_add_cb, NULL, NULL);
+    ecs_require_component(ecs, exclude_id, value_id);
+    ecs_exclude_component(ecs, exclude_id, comp1_id);
+
+    ecs_id_t other_id = ecs_register_system(ecs, exclude_system, many_add_cb, NULL, NULL);
+    ecs_require_component(ecs, other_id, comp1_id);
+
+    ecs_id_t ids[8];
+    ecs_instantiate_many(ecs, prefab_id, ids, 8);
+
+    REQUIRE(many_add_count == 1 + 8 * 2);
+
+    ecs_update_system(ecs, sys_id, 0.0);
+    REQUIRE(exclude_sys_state.count == 9);
+
+    ecs_update_system(ecs, exclude_id, 0.0);
+    REQUIRE(exclude_sys_state.count == 0);
+
+    // Instances are independent copies of the defaults
+    value_t* value = ecs_get(ecs, ids[0], value_id);
+    value->value = 7;
+
+    REQUIRE(((value_t*)ecs_get(ecs, ids[1], value_id))->value == 42);
+
+    return true;
+}
+
+TEST_CASE(test_change_tracking)
+{
+    ecs_id_t value_id = ecs_register_component(ecs, sizeof(value_t), NULL, NULL);
+    ecs_track_changes(ecs, value_id);
+
+    ecs_id_t sys_id = ecs_register_system(ecs, exclude_system, NULL, NULL, NULL);
+    ecs_require_component(ecs, sys_id, value_id);
+    ecs_require_changed(ecs, sys_id, value_id);
+
+    ecs_id_t ids[4];
+
+    for (int i = 0; i < 4; i++)
+    {
+        ids[i] = ecs_create(ecs);
+        ecs_add(ecs, ids[i], value_id, NULL);
+    }
+
+    // Newly added components count as changed
+    ecs_update_system(ecs, sys_id, 0.0);
+    REQUIRE(exclude_sys_state.count == 4);
+
+    ecs_update_system(ecs, sys_id, 0.0);
+    REQUIRE(exclude_sys_state.count == 0);
+
+    // Reading does not count as a change
+    ecs_get(ecs, ids[0], value_id);
+
+    value_t* value = ecs_get_mut(ecs, ids[2], value_id);
+    value->value = 1;
+
+    ecs_update_system(ecs, sys_id, 0.0);
+    REQUIRE(exclude_sys_state.count == 1);
+    REQUIRE(exclude_sys_state.eid == ids[2]);
+
+    ecs_mark_changed(ecs, ids[3], value_id);
+
+    ecs_update_system(ecs, sys_id, 0.0);
+    REQUIRE(exclude_sys_state.count == 1);
+    REQUIRE(exclude_sys_state.eid == ids[3]);
+
+    // Growing the entity pool keeps tracking intact
+    static ecs_id_t more[2 * MIN_ENTITIES];
+    ecs_id_t comp_ids[] = { value_id };
+
+    ecs_create_many(ecs, more, 2 * MIN_ENTITIES, comp_ids, 1, NULL);
+
+    ecs_update_system(ecs, sys_id, 0.0);
+    REQUIRE(exclude_sys_state.count == 2 * MIN_ENTITIES);
+
+    return true;
+}
+
+TEST_CASE(test_query)
+{
+    // Entities created before the query is registered
+    ecs_id_t eid1 = ecs_create(ecs);
+    ecs_add(ecs, eid1, comp1_id, NULL);
+
+    ecs_id_t eid2 = ecs_create(ecs);
+    ecs_add(ecs, eid2, comp1_id, NULL);
+    ecs_add(ecs, eid2, comp2_id, NULL);
+
+    ecs_id_t require[] = { comp1_id };
+    ecs_id_t exclude[] = { comp2_id };
+
+    ecs_id_t query_id = ecs_register_query(ecs, require, 1, exclude, 1);
+
+    REQUIRE(ecs_query_count(ecs, query_id) == 1);
+    REQUIRE(ecs_query_entities(ecs, query_id)[0] == eid1);
+
+    // Results follow component changes
+    ecs_remove(ecs, eid2, comp2_id);
+    REQUIRE(ecs_query_count(ecs, query_id) == 2);
+
+    ecs_add(ecs, eid1, comp2_id, NULL);
+    REQUIRE(ecs_query_count(ecs, query_id) == 1);
+    REQUIRE(ecs_query_entities(ecs, query_id)[0] == eid2);
+
+    ecs_remove(ecs, eid2, comp1_id);
+    REQUIRE(ecs_query_count(ecs, query_id) == 0);
+
+    ecs_id_t eid3 = ecs_create(ecs);
+    ecs_add(ecs, eid3, comp1_id, NULL);
+    REQUIRE(ecs_query_count(ecs, query_id) == 1);
+
+    ecs_destroy(ecs, eid3);
+    REQUIRE(ecs_query_count(ecs, query_id) == 0);
+
+    // Uncached scan
+    ecs_id_t found[4];
+
+    REQUIRE(ecs_scan(ecs, exclude, 1, NULL, 0, found, 4) == 1);
+    REQUIRE(found[0] == eid1);
+
+    REQUIRE(ecs_scan(ecs, require, 1, exclude, 1, NULL, 0) == 0);
+
+    return true;
+}
+
+TEST_CASE(test_snapshot)
+{
+    ecs_id_t value_id = ecs_register_component(ecs, sizeof(value_t), NULL, NULL);
+
+    ecs_id_t sys_id = ecs_register_system(ecs, exclude_system, NULL, NULL, NULL);
+    ecs_require_component(ecs, sys_id, value_id);
+
+    ecs_id_t ids[8];
+
+    for (int i = 0; i < 8; i++)
+    {
+        ids[i] = ecs_create(ecs);
+        value_t* value = ecs_add(ecs, ids[i], value_id, NULL);
+        value->value = i;
+    }
+
+    size_t size = ecs_snapshot(ecs, NULL, 0);
+    REQUIRE(size > 0);
+
+    char* base = malloc(size);
+    REQUIRE(ecs_snapshot(ecs, base, size) == size);
+
+    // Change the world
+    ((value_t*)ecs_get(ecs, ids[3], value_id))->value = 100;
+    ecs_destroy(ecs, ids[5]);
+    ecs_id_t extra = ecs_create(ecs);
+    ecs_add(ecs, extra, comp1_id, NULL);
+
+    size_t changed_size = ecs_snapshot(ecs, NULL, 0);
+    char* changed = malloc(changed_size);
+    ecs_snapshot(ecs, changed, changed_size);
+
+    // Deltas rebuild the changed snapshot from the base
+    size_t delta_size = ecs_snapshot_diff(base, size, changed, changed_size, NULL, 0);
+    REQUIRE(delta_size < changed_size);
+
+    char* delta = malloc(delta_size);
+    ecs_snapshot_diff(base, size, changed, changed_size, delta, delta_size);
+
+    char* patched = malloc(changed_size);
+    REQUIRE(ecs_snapshot_patch(base, size, delta, delta_size, patched, changed_size) == changed_size);
+    REQUIRE(0 == memcmp(patched, changed, changed_size));
+
+    // Roll back
+    REQUIRE(ecs_restore(ecs, base, size));
+
+    // The extra entity reused the index of the destroyed one
+    REQUIRE(ECS_ID_INDEX(extra) == ECS_ID_INDEX(ids[5]));
+    REQUIRE(!ecs_has(ecs, ids[5], comp1_id));
+
+    for (int i = 0; i < 8; i++)
+    {
+        REQUIRE(ecs_is_ready(ecs, ids[i]));
+        REQUIRE(((value_t*)ecs_get(ecs, ids[i], value_id))->value == i);
+    }
+
+    ecs_update_system(ecs, sys_id, 0.0);
+    REQUIRE(exclude_sys_state.count == 8);
+
+    // Roll forward again
+    REQUIRE(ecs_restore(ecs, patched, changed_size));
+    REQUIRE(ecs_has(ecs, extra, comp1_id));
+    REQUIRE(!ecs_has(ecs, extra, value_id));
+    REQUIRE(((value_t*)ecs_get(ecs, ids[3], value_id))->value == 100);
+
+    ecs_update_system(ecs, sys_id, 0.0);
+    REQUIRE(exclude_sys_state.count == 7);
+
+    // Snapshots of a differently configured ECS are rejected
+    ecs_register_component(ecs, sizeof(value_t), NULL, NULL);
+    REQUIRE(!ecs_restore(ecs, base, size));
+
+    free(base);
+    free(changed);
+    free(delta);
+    free(patched);
+
+    return true;
+}
+
+static struct
+{
+    int batch_sizes[8];
+    int batch_count;
+} parallel_state;
+
+// Runs tasks in reverse order to make sure batches do not depend on ordering
+static void reverse_parallel(ecs_task_fn task, void* data, int count, void* udata)
+{
+    (void)udata;
+
+    parallel_state.batch_sizes[parallel_state.batch_count++] = count;
+
+    for (int i = count - 1; i >= 0; i--)
+    {
+        task(data, i);
+    }
+}
+
+static struct
+{
+    ecs_id_t value_id;
+    ecs_order_t order;
+    bool sorted;
+    int count;
+} order_state;
+
+static uint64_t order_key(ecs_t* ecs, ecs_id_t entity_id, void* udata)
+{
+    (void)udata;
+
+    value_t* value = ecs_get(ecs, entity_id, order_state.value_id);
+    return (uint64_t)value->value;
+}
+
+static ecs_ret_t order_system(ecs_t* ecs,
+                              ecs_id_t* entities,
+                              int entity_count,
+                              ecs_dt_t dt,
+                              void* udata)
+{
+    (void)dt;
+
+    order_state.sorted = true;
+    order_state.count  = entity_count;
+
+    for (int i = 1; i < entity_count; i++)
+    {
+        uint64_t prev, next;
+
+        if (ECS_ORDER_KEY == order_state.order)
+        {
+            prev = order_key(ecs, entities[i - 1], udata);
+            next = order_key(ecs, entities[i], udata);
+        }
+        else
+        {
+            prev = ECS_ID_INDEX(entities[i - 1]);
+            next = ECS_ID_INDEX(entities[i]);
+        }
+
+        if (prev > next)
+            order_state.sorted = false;
+    }
+
+    return 0;
+}
+
+TEST_CASE(test_system_order)
+{
+    order_state.value_id = ecs_register_component(ecs, sizeof(value_t), NULL, NULL);
+
+    ecs_id_t sys_id = ecs_register_system(ecs, order_system, NULL, NULL, NULL);
+    ecs_require_component(ecs, sys_id, order_state.value_id);
+
+    ecs_id_t ids[64];
+
+    for (int i = 0; i < 64; i++)
+    {
+        ids[i] = ecs_create(ecs);
+        value_t* value = ecs_add(ecs, ids[i], order_state.value_id, NULL);
+        value->value = 64 - i;
+    }
+
+    // Churn the system so that entities are out of order
+    for (int i = 0; i < 64; i += 3)
+        ecs_remove(ecs, ids[i], order_state.value_id);
+
+    for (int i = 63; i >= 0; i -= 3)
+    {
+        value_t* value = ecs_add(ecs, ids[i], order_state.value_id, NULL);
+        value->value = 64 - i;
+    }
+
+    order_state.order = ECS_ORDER_ID;
+    ecs_set_system_order(ecs, sys_id, ECS_ORDER_ID, NULL);
+    ecs_update_system(ecs, sys_id, 0.0);
+
+    REQUIRE(order_state.sorted);
+    int count = order_state.count;
+
+    // Sorted by the component value, which runs opposite to the IDs
+    order_state.order = ECS_ORDER_KEY;
+    ecs_set_system_order(ecs, sys_id, ECS_ORDER_KEY, order_key);
+    ecs_update_system(ecs, sys_id, 0.0);
+
+    REQUIRE(order_state.sorted);
+    REQUIRE(order_state.count == count);
+
+    // Membership tests still work after reordering
+    ecs_remove(ecs, ids[10], order_state.value_id);
+    ecs_update_system(ecs, sys_id, 0.0);
+
+    REQUIRE(order_state.sorted);
+    REQUIRE(order_state.count == count - 1);
+
+    return true;
+}
+
+TEST_CASE(test_reserved)
+{
+    ecs_t* reserved = ecs_new_reserved(16, 4096, NULL);
+    REQUIRE(reserved);
+
+    ecs_id_t value_id = ecs_register_component(reserved, sizeof(value_t), NULL, NULL);
+    ecs_track_changes(reserved, value_id);
+
+    ecs_id_t first = ecs_create(reserved);
+    value_t* first_value = ecs_add(reserved, first, value_id, NULL);
+    first_value->value = 42;
+
+    // Grow well past the initial entity count
+    for (int i = 1; i < 4096; i++)
+    {
+        ecs_id_t id = ecs_create(reserved);
+        value_t* value = ecs_add(reserved, id, value_id, NULL);
+        value->value = i;
+    }
+
+#ifndef PICO_ECS_ARCHETYPES
+    // Indexed storage was allocated once, so the pointer is still valid
+    REQUIRE(ecs_get(reserved, first, value_id) == first_value);
+#endif
+
+    REQUIRE(((value_t*)ecs_get(reserved, first, value_id))->value == 42);
+
+    ecs_free(reserved);
+
+    return true;
+}
+
+#ifdef PICO_ECS_GENERATIONS
+TEST_CASE(test_generations)
+{
+    ecs_id_t sys_id = ecs_register_system(ecs, exclude_system, NULL, NULL, NULL);
+    ecs_require_component(ecs, sys_id, comp1_id);
+
+    ecs_id_t old_id = ecs_create(ecs);
+    ecs_add(ecs, old_id, comp1_id, NULL);
+
+    REQUIRE(ECS_ID_GENERATION(old_id) == 0);
+
+    ecs_destroy(ecs, old_id);
+
+    // The index is recycled with a new generation
+    ecs_id_t new_id = ecs_create(ecs);
+
+    REQUIRE(ECS_ID_INDEX(new_id) == ECS_ID_INDEX(old_id));
+    REQUIRE(ECS_ID_GENERATION(new_id) == 1);
+    REQUIRE(new_id != old_id);
+
+    // The stale handle no longer refers to a live entity
+    REQUIRE(!ecs_is_ready(ecs, old_id));
+    REQUIRE(ecs_is_ready(ecs, new_id));
+
+    // Systems see the full handle
+    ecs_add(ecs, new_id, comp1_id, NULL);
+
+    exclude_sys_state.count = 0;
+    ecs_update_system(ecs, sys_id, 0.0);
+
+    REQUIRE(exclude_sys_state.count == 1);
+    REQUIRE(exclude_sys_state.eid == new_id);
+
+    ecs_remove(ecs, new_id, comp1_id);
+
+    exclude_sys_state.count = 0;
+    ecs_update_system(ecs, sys_id, 0.0);
+
+    REQUIRE(exclude_sys_state.count == 0);
+
+    return true;
+}
+#endif
+
+TEST_CASE(test_update_systems_parallel)
+{
+    memset(&parallel_state, 0, sizeof(parallel_state));
+
+    ecs_set_parallel(ecs, reverse_parallel, NULL);
+
+    // Writes component 1
+    system1_id = ecs_register_system(ecs, comp_system, NULL, NULL, NULL);
+    ecs_require_component(ecs, system1_id, comp1_id);
+
+    // Only reads component 2, so it can run alongside system 1
+    system2_id = ecs_register_system(ecs, exclude_system, NULL, NULL, NULL);
+    ecs_require_component_access(ecs, system2_id, comp2_id, ECS_ACCESS_READ);
+
+    // Writes component 1, so it must run after system 1 has finished
+    ecs_id_t system3_id = ecs_register_system(ecs, queue_destroy_system, NULL, NULL, NULL);
+    ecs_require_component(ecs, system3_id, comp1_id);
+
+    for (int i = 0; i < 16; i++)
+    {
+        ecs_id_t id = ecs_create(ecs);
+        ecs_add(ecs, id, comp1_id, NULL);
+        ecs_add(ecs, id, comp2_id, NULL);
+    }
+
+    REQUIRE(0 == ecs_update_systems_parallel(ecs, 0.0));
+
+    REQUIRE(parallel_state.batch_count == 2);
+    REQUIRE(parallel_state.batch_sizes[0] == 2);
+    REQUIRE(parallel_state.batch_sizes[1] == 1);
+
+    // System 2 ran before the destruction queued by system 3 was flushed
+    REQUIRE(exclude_sys_state.count == 16);
+
+    for (int i = 0; i < MIN_ENTITIES; i++)
+    {
+        REQUIRE(!ecs_is_ready(ecs, i));
+    }
+
+    return true;
+}
+
+static ecs_ret_t slice_system(ecs_t* ecs,
+                              ecs_id_t* entities,
+                              int entity_count,
+                              ecs_dt_t dt,
+                              void* udata)
+{
+    (void)dt;
+
+    int* processed = udata;
+
+    if (entity_count > 100)
+        return -1;
+
+    for (int i = 0; i < entity_count; i++)
+    {
+        comp_t* comp = ecs_get(ecs, entities[i], comp1_id);
+
+        if (comp->used)
+            return -1;
+
+        comp->used = true;
+        ecs_queue_remove(ecs, entities[i], comp1_id);
+    }
+
+    *processed += entity_count;
+
+    return 0;
+}
+
+TEST_CASE(test_system_slices)
+{
+    int processed = 0;
+
+    memset(&parallel_state, 0, sizeof(parallel_state));
+
+    ecs_set_parallel(ecs, reverse_parallel, NULL);
+
+    system1_id = ecs_register_system(ecs, slice_system, NULL, NULL, &processed);
+    ecs_require_component(ecs, system1_id, comp1_id);
+    ecs_set_system_slices(ecs, system1_id, 100);
+
+    for (int i = 0; i < 1000; i++)
+    {
+        ecs_id_t id = ecs_create(ecs);
+        ecs_add(ecs, id, comp1_id, NULL);
+    }
+
+    REQUIRE(0 == ecs_update_system(ecs, system1_id, 0.0));
+
+    // Every entity was processed exactly once, in ten slices
+    REQUIRE(processed == 1000);
+    REQUIRE(parallel_state.batch_count == 1);
+    REQUIRE(parallel_state.batch_sizes[0] == 10);
+
+    // Queued removals from all slices were flushed
+    for (int i = 0; i < MIN_ENTITIES; i++)
+    {
+        if (ecs_is_ready(ecs, i))
+            REQUIRE(!ecs_has(ecs, i, comp1_id));
+    }
+
+    return true;
+}
+
+#ifdef PICO_ECS_ARCHETYPES
+
+typedef struct
+{
+    int x, y;
+} vec_t;
+
+static ecs_id_t pos_id;
+static ecs_id_t vel_id;
+
+// Integrates velocities into positions one chunk at a time
+static ecs_ret_t chunk_system(ecs_t* ecs,
+                              ecs_chunk_t* chunk,
+                              ecs_dt_t dt,
+                              void* udata)
+{
+    (void)ecs;
+    (void)dt;
+
+    int* chunk_count = udata;
+    (*chunk_count)++;
+
+    int count = ecs_chunk_count(chunk);
+
+    if (count > PICO_ECS_CHUNK_SIZE)
+        return -1;
+
+    vec_t* pos = ecs_chunk_column(chunk, pos_id);
+    vec_t* vel = ecs_chunk_column(chunk, vel_id);
+
+    for (int i = 0; i < count; i++)
+    {
+        pos[i].x += vel[i].x;
+        pos[i].y += vel[i].y;
+    }
+
+    return 0;
+}
+
+TEST_CASE(test_chunk_system)
+{
+    int chunk_count = 0;
+
+    pos_id = ecs_register_component(ecs, sizeof(vec_t), NULL, NULL);
+    vel_id = ecs_register_component(ecs, sizeof(vec_t), NULL, NULL);
+
+    ecs_id_t sys_id = ecs_register_chunk_system(ecs, chunk_system, NULL, NULL, &chunk_count);
+    ecs_require_component(ecs, sys_id, pos_id);
+    ecs_require_component(ecs, sys_id, vel_id);
+
+    // Spread entities over two archetypes and several chunks
+    static ecs_id_t ids[3 * PICO_ECS_CHUNK_SIZE];
+    const int count = 3 * PICO_ECS_CHUNK_SIZE;
+
+    for (int i = 0; i < count; i++)
+    {
+        ecs_id_t id = ecs_create(ecs);
+        ids[i] = id;
+
+        ecs_add(ecs, id, pos_id, NULL);
+        ecs_add(ecs, id, vel_id, NULL);
+
+        if (i % 2 == 0)
+            ecs_add(ecs, id, comp1_id, NULL);
+
+        *(vec_t*)ecs_get(ecs, id, pos_id) = (vec_t){ i, 0 };
+        *(vec_t*)ecs_get(ecs, id, vel_id) = (vec_t){ 1, 2 };
+    }
+
+    // Removing a component from an entity in the middle of a chunk swaps
+    // the last entity of the archetype into its place
+    ecs_remove(ecs, ids[2], comp1_id);
+
+    REQUIRE(0 == ecs_update_system(ecs, sys_id, 0.0));
+    REQUIRE(chunk_count >= 3);
+
+    for (int i = 0; i < count; i++)
+    {
+        vec_t* pos = ecs_get(ecs, ids[i], pos_id);
+        REQUIRE(pos->x == i + 1);
+        REQUIRE(pos->y == 2);
+    }
+
+    // Entities lacking a required component are not processed
+    ecs_remove(ecs, ids[0], vel_id);
+
+    ecs_update_system(ecs, sys_id, 0.0);
+
+    vec_t* pos = ecs_get(ecs, ids[0], pos_id);
+    REQUIRE(pos->x == 1);
+
+    return true;
+}
+
+#endif // PICO_ECS_ARCHETYPES
+
 static TEST_SUITE(suite_ecs)
 {
     RUN_TEST_CASE(test_reset);
     RUN_TEST_CASE(test_exclude);
+    RUN_TEST_CASE(test_exclude_add_remove);
     RUN_TEST_CASE(test_constructor);
     RUN_TEST_CASE(test_destructor_remove);
     RUN_TEST_CASE(test_destructor_destroy);
     RUN_TEST_CASE(test_create_destroy);
     RUN_TEST_CASE(test_add_remove);
+#ifndef PICO_ECS_ARCHETYPES
     RUN_TEST_CASE(test_add_systems);
     RUN_TEST_CASE(test_remove);
+#endif
     RUN_TEST_CASE(test_remove_comp_system);
+#ifndef PICO_ECS_ARCHETYPES
     RUN_TEST_CASE(test_destroy);
+#endif
     RUN_TEST_CASE(test_destroy_system);
     RUN_TEST_CASE(test_remove_system);
     RUN_TEST_CASE(test_queue_destroy_system);
     RUN_TEST_CASE(test_queue_remove_system);
     RUN_TEST_CASE(test_enable_disable);
     RUN_TEST_CASE(test_add_remove_callbacks);
+    RUN_TEST_CASE(test_packed_storage);
+    RUN_TEST_CASE(test_create_add_many);
+    RUN_TEST_CASE(test_prefab);
+    RUN_TEST_CASE(test_change_tracking);
+    RUN_TEST_CASE(test_query);
+    RUN_TEST_CASE(test_snapshot);
+    RUN_TEST_CASE(test_reserved);
+    RUN_TEST_CASE(test_system_order);
+#ifdef PICO_ECS_GENERATIONS
+    RUN_TEST_CASE(test_generations);
+#endif
+    RUN_TEST_CASE(test_update_systems_parallel);
+    RUN_TEST_CASE(test_system_slices);
+#ifdef PICO_ECS_ARCHETYPES
+    RUN_TEST_CASE(test_chunk_system);
+#endif
 }
 
 int main ()
@@ -0,0 +1,193 @@
+#include "../pico_hit.h"
+#include "../pico_unit.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SHAPE_COUNT 128
+#define MAX_PAIRS   (SHAPE_COUNT * SHAPE_COUNT)
+
+static pb2  aabbs[SHAPE_COUNT];
+static int  proxies[SHAPE_COUNT];
+static bool alive[SHAPE_COUNT];
+static int  found[SHAPE_COUNT][SHAPE_COUNT];
+
+static ph_pair_t pairs[MAX_PAIRS];
+
+static pb2 random_aabb(void)
+{
+    pfloat x = (pfloat)(rand() % 100);
+    pfloat y = (pfloat)(rand() % 100);
+    pfloat w = (pfloat)(rand() % 8 + 1);
+    pfloat h = (pfloat)(rand() % 8 + 1);
+
+    return pb2_make(x, y, w, h);
+}
+
+// Checks the reported pairs against all pairs of live shapes. Without a margin
+// exactly the overlapping pairs are reported, otherwise at least those
+static bool check_pairs(const ph_broadphase_t* bp, bool exact)
+{
+    int count = ph_broadphase_find_pairs(bp, pairs, MAX_PAIRS);
+
+    if (count > MAX_PAIRS)
+        return false;
+
+    memset(found, 0, sizeof(found));
+
+    for (int i = 0; i < count; i++)
+    {
+        int a = pairs[i].a;
+        int b = pairs[i].b;
+
+        if (a == b || !alive[a] || !alive[b] || found[a][b] || found[b][a])
+            return false;
+
+        found[a][b] = 1;
+    }
+
+    for (int i = 0; i < SHAPE_COUNT; i++)
+    {
+        for (int j = i + 1; j < SHAPE_COUNT; j++)
+        {
+            if (!alive[i] || !alive[j])
+                continue;
+
+            bool overlaps = pb2_overlaps(&aabbs[i], &aabbs[j]);
+            bool reported = found[i][j] || found[j][i];
+
+            if (overlaps && !reported)
+                return false;
+
+            if (exact && reported && !overlaps)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+static void populate(ph_broadphase_t* bp)
+{
+    for (int i = 0; i < SHAPE_COUNT; i++)
+    {
+        aabbs[i] = random_aabb();
+        proxies[i] = ph_broadphase_insert(bp, &aabbs[i], i);
+        alive[i] = true;
+    }
+}
+
+TEST_CASE(test_broadphase_pairs)
+{
+    ph_broadphase_t* bp = ph_broadphase_create(0.0f, NULL);
+
+    srand(1);
+
+    populate(bp);
+
+    REQUIRE(check_pairs(bp, true));
+
+    // Move, remove and reinsert shapes
+    for (int i = 0; i < SHAPE_COUNT; i += 3)
+    {
+        aabbs[i] = random_aabb();
+        ph_broadphase_move(bp, proxies[i], &aabbs[i]);
+    }
+
+    for (int i = 1; i < SHAPE_COUNT; i += 4)
+    {
+        ph_broadphase_remove(bp, proxies[i]);
+        alive[i] = false;
+    }
+
+    REQUIRE(check_pairs(bp, true));
+
+    for (int i = 1; i < SHAPE_COUNT; i += 8)
+    {
+        aabbs[i] = random_aabb();
+        proxies[i] = ph_broadphase_insert(bp, &aabbs[i], i);
+        alive[i] = true;
+    }
+
+    REQUIRE(check_pairs(bp, true));
+
+    // Query
+    pb2 area = pb2_make(20.0f, 20.0f, 30.0f, 30.0f);
+
+    int values[SHAPE_COUNT];
+    int count = ph_broadphase_query(bp, &area, values, SHAPE_COUNT);
+
+    int expected = 0;
+
+    for (int i = 0; i < SHAPE_COUNT; i++)
+    {
+        if (alive[i] && pb2_overlaps(&aabbs[i], &area))
+            expected++;
+    }
+
+    REQUIRE(count == expected);
+    REQUIRE(ph_broadphase_query(bp, &area, NULL, 0) == expected);
+
+    for (int i = 0; i < count; i++)
+    {
+        REQUIRE(alive[values[i]] && pb2_overlaps(&aabbs[values[i]], &area));
+    }
+
+    ph_broadphase_destroy(bp);
+
+    return true;
+}
+
+TEST_CASE(test_broadphase_margin)
+{
+    ph_broadphase_t* bp = ph_broadphase_create(2.0f, NULL);
+
+    srand(2);
+
+    populate(bp);
+
+    // Movements within the margin leave the tree unchanged
+    for (int i = 0; i < SHAPE_COUNT; i++)
+    {
+        pb2 moved = aabbs[i];
+
+        moved.min.x += 1.0f;
+        moved.max.x += 1.0f;
+
+        REQUIRE(!ph_broadphase_move(bp, proxies[i], &moved));
+
+        aabbs[i] = moved;
+    }
+
+    REQUIRE(check_pairs(bp, false));
+
+    // Larger movements reinsert the shape
+    for (int i = 0; i < SHAPE_COUNT; i++)
+    {
+        aabbs[i].min.x += 5.0f;
+        aabbs[i].max.x += 5.0f;
+
+        REQUIRE(ph_broadphase_move(bp, proxies[i], &aabbs[i]));
+    }
+
+    REQUIRE(check_pairs(bp, false));
+
+    // Removing everything
+    for (int i = 0; i < SHAPE_COUNT; i++)
+    {
+        ph_broadphase_remove(bp, proxies[i]);
+        alive[i] = false;
+    }
+
+    REQUIRE(ph_broadphase_find_pairs(bp, NULL, 0) == 0);
+
+    ph_broadphase_destroy(bp);
+
+    return true;
+}
+
+TEST_SUITE(suite_broadphase)
+{
+    RUN_TEST_CASE(test_broadphase_pairs);
+    RUN_TEST_CASE(test_broadphase_margin);
+}
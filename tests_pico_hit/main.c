@@ -3,12 +3,15 @@
 
 TEST_SUITE(suite_sat);
 TEST_SUITE(suite_ray);
+TEST_SUITE(suite_broadphase);
 
 int main()
 {
     pu_display_colors(true);
     RUN_TEST_SUITE(suite_sat);
     RUN_TEST_SUITE(suite_ray);
+    RUN_TEST_SUITE(suite_broadphase);
+TEST_SUITE(suite_broadphase);
     pu_print_stats();
     return pu_test_failed();
 }
@@ -1,6 +1,8 @@
 #include "../pico_unit.h"
 #include "../pico_hit.h"
 
+#include <stdlib.h>
+
 TEST_CASE(test_segment_hit)
 {
     ph_ray_t r = ph_make_ray(pv2_make(0.f, 0.f), pv2_make(1.f, 0.f), 10.f);
@@ -231,6 +233,175 @@ TEST_CASE(test_ray_at)
     return true;
 }
 
+static pfloat random_float(pfloat min, pfloat max)
+{
+    return min + (max - min) * (pfloat)rand() / (pfloat)RAND_MAX;
+}
+
+static ph_ray_t random_ray(void)
+{
+    pv2 pos = pv2_make(random_float(-5.f, 25.f), random_float(-5.f, 25.f));
+    pv2 dir = pv2_make(random_float(-1.f, 1.f), random_float(-1.f, 1.f));
+
+    // Axis aligned rays now and then
+    if (rand() % 8 == 0)
+        dir.x = 0.f;
+    else if (rand() % 8 == 0)
+        dir.y = 0.f;
+
+    if (pv2_equal(dir, pv2_zero()))
+        dir = pv2_make(1.f, 0.f);
+
+    return ph_make_ray(pos, dir, random_float(1.f, 30.f));
+}
+
+TEST_CASE(test_ray_poly_batch)
+{
+    srand(27);
+
+    enum { POLY_COUNT = 23, RAY_COUNT = 200 };
+
+    ph_poly_t polys[POLY_COUNT];
+    pb2 aabbs[POLY_COUNT];
+
+    for (int i = 0; i < POLY_COUNT; i++)
+    {
+        pfloat x = random_float(0.f, 20.f);
+        pfloat y = random_float(0.f, 20.f);
+        pfloat w = random_float(0.5f, 4.f);
+        pfloat h = random_float(0.5f, 4.f);
+
+        pb2 aabb = pb2_make(x, y, w, h);
+
+        polys[i] = ph_aabb_to_poly(&aabb);
+        aabbs[i] = ph_poly_to_aabb(&polys[i]);
+    }
+
+    ph_ray_t rays[RAY_COUNT];
+    int indices[RAY_COUNT];
+    ph_raycast_t raycasts[RAY_COUNT];
+
+    for (int i = 0; i < RAY_COUNT; i++)
+    {
+        rays[i] = random_ray();
+    }
+
+    int hit_count = ph_ray_poly_batch(rays, RAY_COUNT, polys, aabbs, POLY_COUNT,
+                                      indices, raycasts);
+
+    int expected_count = 0;
+
+    for (int i = 0; i < RAY_COUNT; i++)
+    {
+        // Brute force
+        int closest = -1;
+        ph_raycast_t best;
+
+        for (int j = 0; j < POLY_COUNT; j++)
+        {
+            ph_raycast_t raycast;
+
+            if (ph_ray_poly(&rays[i], &polys[j], &raycast) &&
+                (closest < 0 || raycast.dist < best.dist))
+            {
+                closest = j;
+                best = raycast;
+            }
+        }
+
+        expected_count += (closest >= 0);
+
+        REQUIRE(indices[i] == closest);
+
+        if (closest >= 0)
+        {
+            REQUIRE(pf_equal(raycasts[i].dist, best.dist));
+            REQUIRE(pv2_equal(raycasts[i].normal, best.normal));
+        }
+
+        // Any hit
+        int any = ph_ray_poly_closest(&rays[i], polys, aabbs, POLY_COUNT, NULL);
+
+        REQUIRE((any >= 0) == (closest >= 0));
+        REQUIRE(any < 0 || ph_ray_poly(&rays[i], &polys[any], NULL));
+    }
+
+    REQUIRE(hit_count == expected_count);
+    REQUIRE(hit_count > 0 && hit_count < RAY_COUNT);
+
+    REQUIRE(-1 == ph_ray_poly_closest(&rays[0], polys, aabbs, 0, NULL));
+
+    return true;
+}
+
+TEST_CASE(test_ray_circle_batch)
+{
+    srand(28);
+
+    enum { CIRCLE_COUNT = 18, RAY_COUNT = 200 };
+
+    ph_circle_t circles[CIRCLE_COUNT];
+
+    for (int i = 0; i < CIRCLE_COUNT; i++)
+    {
+        pv2 pos = pv2_make(random_float(0.f, 20.f), random_float(0.f, 20.f));
+        circles[i] = ph_make_circle(pos, random_float(0.5f, 3.f));
+    }
+
+    ph_ray_t rays[RAY_COUNT];
+    int indices[RAY_COUNT];
+    ph_raycast_t raycasts[RAY_COUNT];
+
+    for (int i = 0; i < RAY_COUNT; i++)
+    {
+        rays[i] = random_ray();
+    }
+
+    int hit_count = ph_ray_circle_batch(rays, RAY_COUNT, circles, CIRCLE_COUNT,
+                                        indices, raycasts);
+
+    int expected_count = 0;
+
+    for (int i = 0; i < RAY_COUNT; i++)
+    {
+        // Brute force, ignoring hits beyond the ray
+        int closest = -1;
+        ph_raycast_t best;
+
+        for (int j = 0; j < CIRCLE_COUNT; j++)
+        {
+            ph_raycast_t raycast;
+
+            if (ph_ray_circle(&rays[i], &circles[j], &raycast) &&
+                raycast.dist <= rays[i].dist &&
+                (closest < 0 || raycast.dist < best.dist))
+            {
+                closest = j;
+                best = raycast;
+            }
+        }
+
+        expected_count += (closest >= 0);
+
+        REQUIRE(indices[i] == closest);
+
+        if (closest >= 0)
+        {
+            REQUIRE(pf_equal(raycasts[i].dist, best.dist));
+            REQUIRE(pv2_equal(raycasts[i].normal, best.normal));
+        }
+
+        int any = ph_ray_circle_closest(&rays[i], circles, CIRCLE_COUNT, NULL);
+
+        REQUIRE((any >= 0) == (closest >= 0));
+    }
+
+    REQUIRE(hit_count == expected_count);
+    REQUIRE(hit_count > 0 && hit_count < RAY_COUNT);
+
+    return true;
+}
+
 TEST_SUITE(suite_ray)
 {
     RUN_TEST_CASE(test_segment_hit);
@@ -243,4 +414,6 @@ TEST_SUITE(suite_ray)
     RUN_TEST_CASE(test_circle_no_hit);
     RUN_TEST_CASE(test_circle_raycast);
     RUN_TEST_CASE(test_ray_at);
+    RUN_TEST_CASE(test_ray_poly_batch);
+    RUN_TEST_CASE(test_ray_circle_batch);
 }
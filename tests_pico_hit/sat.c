@@ -1,6 +1,8 @@
 #include "../pico_hit.h"
 #include "../pico_unit.h"
 
+#include <stdlib.h>
+
 TEST_CASE(test_aabb_aabb_collide)
 {
     pb2 aabb1 = pb2_make(5, 5, 2, 2);
@@ -238,6 +240,684 @@ TEST_CASE(test_transform_circle)
     return true;
 }
 
+static pfloat random_coord(void)
+{
+    // Multiples of one half, so that edges touch now and then
+    return (pfloat)(rand() % 21) * 0.5f;
+}
+
+static pb2 random_aabb(void)
+{
+    pfloat x = random_coord();
+    pfloat y = random_coord();
+    pfloat w = random_coord() + 0.5f;
+    pfloat h = random_coord() + 0.5f;
+
+    return pb2_make(x, y, w, h);
+}
+
+static bool manifold_equal(const ph_manifold_t* m1, const ph_manifold_t* m2)
+{
+    return pf_equal(m1->overlap, m2->overlap) &&
+           m1->feature == m2->feature &&
+           m1->index == m2->index &&
+           pv2_equal(m1->normal, m2->normal) &&
+           pv2_equal(m1->vector, m2->vector);
+}
+
+TEST_CASE(test_aabb_aabb)
+{
+    srand(3);
+
+    // Same results as the polygon test
+    for (int i = 0; i < 500; i++)
+    {
+        pb2 aabb1 = random_aabb();
+        pb2 aabb2 = random_aabb();
+
+        ph_poly_t p1 = ph_aabb_to_poly(&aabb1);
+        ph_poly_t p2 = ph_aabb_to_poly(&aabb2);
+
+        ph_manifold_t m1, m2;
+
+        bool hit = ph_sat_poly_poly(&p1, &p2, &m1);
+
+        REQUIRE(ph_sat_aabb_aabb(&aabb1, &aabb2, &m2) == hit);
+
+        if (hit)
+            REQUIRE(manifold_equal(&m1, &m2));
+    }
+
+    return true;
+}
+
+#define BATCH_SHAPES 16
+#define BATCH_PAIRS  103 // Not a multiple of four
+
+TEST_CASE(test_batch)
+{
+    ph_circle_t circles[BATCH_SHAPES];
+    pb2         aabbs[BATCH_SHAPES];
+    ph_poly_t   polys[BATCH_SHAPES];
+    ph_pair_t   pairs[BATCH_PAIRS];
+
+    bool          hits[BATCH_PAIRS];
+    ph_manifold_t manifolds[BATCH_PAIRS];
+
+    srand(4);
+
+    for (int i = 0; i < BATCH_SHAPES; i++)
+    {
+        circles[i] = ph_make_circle(pv2_make(random_coord(), random_coord()), random_coord() * 0.5f);
+        aabbs[i] = random_aabb();
+        polys[i] = ph_aabb_to_poly(&aabbs[i]);
+    }
+
+    for (int i = 0; i < BATCH_PAIRS; i++)
+    {
+        pairs[i].a = rand() % BATCH_SHAPES;
+        pairs[i].b = rand() % BATCH_SHAPES;
+    }
+
+    // Circles
+    int hit_count = ph_sat_circle_circle_batch(circles, pairs, BATCH_PAIRS, hits, manifolds);
+    int expected = 0;
+
+    for (int i = 0; i < BATCH_PAIRS; i++)
+    {
+        ph_manifold_t manifold;
+
+        bool hit = ph_sat_circle_circle(&circles[pairs[i].a], &circles[pairs[i].b], &manifold);
+
+        REQUIRE(hits[i] == hit);
+        REQUIRE(manifold.overlap == manifolds[i].overlap);
+        REQUIRE(pv2_equal(manifold.normal, manifolds[i].normal));
+
+        expected += hit;
+    }
+
+    REQUIRE(hit_count == expected);
+    REQUIRE(ph_sat_circle_circle_batch(circles, pairs, BATCH_PAIRS, NULL, NULL) == expected);
+
+    // AABBs
+    hit_count = ph_sat_aabb_aabb_batch(aabbs, pairs, BATCH_PAIRS, hits, manifolds);
+    expected = 0;
+
+    for (int i = 0; i < BATCH_PAIRS; i++)
+    {
+        ph_manifold_t manifold;
+
+        bool hit = ph_sat_aabb_aabb(&aabbs[pairs[i].a], &aabbs[pairs[i].b], &manifold);
+
+        REQUIRE(hits[i] == hit);
+
+        if (hit)
+            REQUIRE(manifold_equal(&manifold, &manifolds[i]));
+
+        expected += hit;
+    }
+
+    REQUIRE(hit_count == expected);
+
+    // Polygons
+    REQUIRE(ph_sat_poly_poly_batch(polys, pairs, BATCH_PAIRS, hits, NULL) == expected);
+
+    return true;
+}
+
+TEST_CASE(test_poly_cache)
+{
+    const pv2 vertices[] = { { 0, 0 }, { 2, 0 }, { 3, 1 }, { 1, 2 } };
+
+    ph_poly_t p1 = ph_make_poly(vertices, 4);
+    ph_poly_t p2 = ph_make_poly(vertices, 4);
+
+    ph_poly_cache_t c1, c2;
+
+    ph_poly_cache_init(&c1);
+    ph_poly_cache_init(&c2);
+
+    srand(6);
+
+    // Same results as testing the transformed polygons
+    for (int i = 0; i < 200; i++)
+    {
+        pt2 t1 = pt2_rotation((pfloat)(rand() % 16) * PM_PI / 8.0f);
+        pt2 t2 = pt2_rotation((pfloat)(rand() % 16) * PM_PI / 8.0f);
+
+        pt2_translate(&t2, pv2_make(random_coord() * 0.5f, random_coord() * 0.5f));
+
+        ph_poly_t res1 = ph_transform_poly(&t1, &p1);
+        ph_poly_t res2 = ph_transform_poly(&t2, &p2);
+
+        ph_poly_cache_update(&c1, &t1, &p1);
+        ph_poly_cache_update(&c2, &t2, &p2);
+
+        ph_manifold_t m1, m2;
+
+        bool hit = ph_sat_poly_poly(&res1, &res2, &m1);
+
+        REQUIRE(ph_sat_poly_poly_cached(&c1, &c2, &m2) == hit);
+        REQUIRE(ph_sat_poly_poly_cached(&c1, &c2, NULL) == hit);
+
+        if (hit)
+        {
+            REQUIRE(m1.overlap == m2.overlap);
+            REQUIRE(pv2_equal(m1.normal, m2.normal));
+        }
+    }
+
+    // The cache is only rebuilt when the transform changes
+    pt2 t = pt2_translation(pv2_make(1, 0));
+
+    const ph_poly_t* cached = ph_poly_cache_update(&c1, &t, &p1);
+
+    REQUIRE(pv2_equal(cached->vertices[0], pv2_make(1, 0)));
+
+    p1.vertices[0] = pv2_make(5, 5);
+
+    REQUIRE(ph_poly_cache_update(&c1, &t, &p1) == cached);
+    REQUIRE(pv2_equal(cached->vertices[0], pv2_make(1, 0)));
+
+    ph_poly_cache_init(&c1);
+    ph_poly_cache_update(&c1, &t, &p1);
+
+    REQUIRE(pv2_equal(cached->vertices[0], pv2_make(6, 5)));
+
+    return true;
+}
+
+static ph_poly_t random_poly(void)
+{
+    // Jittered angles around a circle give a convex polygon with CCW winding
+    int vertex_count = 3 + rand() % (PICO_HIT_MAX_POLY_VERTS - 2);
+
+    pv2 center = pv2_make(random_coord(), random_coord());
+    pfloat radius = 1.0f + random_coord() * 0.5f;
+
+    pv2 vertices[PICO_HIT_MAX_POLY_VERTS];
+
+    for (int i = 0; i < vertex_count; i++)
+    {
+        pfloat jitter = (pfloat)rand() / (pfloat)RAND_MAX * 0.8f;
+        pfloat angle = ((pfloat)i + jitter) * PM_PI2 / (pfloat)vertex_count;
+
+        vertices[i] = pv2_add(center, pv2_polar(angle, radius));
+    }
+
+    return ph_make_poly(vertices, vertex_count);
+}
+
+TEST_CASE(test_gjk_poly_poly)
+{
+    srand(28);
+
+    int hit_count = 0;
+
+    for (int i = 0; i < 500; i++)
+    {
+        ph_poly_t p1 = random_poly();
+        ph_poly_t p2 = random_poly();
+
+        ph_manifold_t m1, m2;
+
+        bool hit = ph_sat_poly_poly(&p1, &p2, &m1);
+
+        // Results may differ within rounding errors of touching polygons
+        if (hit && m1.overlap < 1e-3f)
+            continue;
+
+        REQUIRE(hit == ph_gjk_poly_poly(&p1, &p2, NULL, &m2));
+        REQUIRE(hit == ph_gjk_poly_poly(&p1, &p2, NULL, NULL));
+
+        if (hit)
+        {
+            hit_count++;
+
+            REQUIRE(pf_abs(m1.overlap - m2.overlap) < 1e-3f);
+
+            // SAT reports the normals of poly_b pointing towards poly_a
+            REQUIRE(pf_abs(pv2_dot(m1.normal, m2.normal)) > 0.999f);
+            REQUIRE(pf_abs(pv2_len(m2.vector) - m2.overlap) < 1e-3f);
+
+            // The MTV separates the polygons
+            pt2 t = pt2_translation(pv2_scale(m2.normal, m2.overlap + 1e-2f));
+            ph_poly_t moved = ph_transform_poly(&t, &p2);
+
+            REQUIRE(!ph_gjk_poly_poly(&p1, &moved, NULL, NULL));
+        }
+    }
+
+    REQUIRE(hit_count > 50);
+
+    return true;
+}
+
+TEST_CASE(test_gjk_distance)
+{
+    pb2 aabb1 = pb2_make(0, 0, 2, 2);
+    pb2 aabb2 = pb2_make(5, 6, 2, 2);
+    pb2 aabb3 = pb2_make(1, 1, 2, 2);
+
+    ph_poly_t p1 = ph_aabb_to_poly(&aabb1);
+    ph_poly_t p2 = ph_aabb_to_poly(&aabb2);
+    ph_poly_t p3 = ph_aabb_to_poly(&aabb3);
+
+    // Closest points are the corners (2, 2) and (5, 6)
+    REQUIRE(pf_equal(ph_gjk_distance(&p1, &p2, NULL), 5.0f));
+    REQUIRE(pf_equal(ph_gjk_distance(&p2, &p1, NULL), 5.0f));
+    REQUIRE(pf_equal(ph_gjk_distance(&p1, &p3, NULL), 0.0f));
+
+    // Closest features are parallel edges
+    pb2 aabb4 = pb2_make(3, 1, 2, 2);
+    ph_poly_t p4 = ph_aabb_to_poly(&aabb4);
+
+    REQUIRE(pf_equal(ph_gjk_distance(&p1, &p4, NULL), 1.0f));
+
+    return true;
+}
+
+TEST_CASE(test_gjk_warm_start)
+{
+    srand(29);
+
+    for (int i = 0; i < 100; i++)
+    {
+        ph_poly_t p1 = random_poly();
+        ph_poly_t p2 = random_poly();
+
+        ph_simplex_t simplex;
+        ph_simplex_init(&simplex);
+
+        // Move the second polygon along a path, reusing the simplex
+        pv2 step = pv2_make(random_coord() - 5.0f, random_coord() - 5.0f);
+        step = pv2_scale(step, 0.02f);
+
+        for (int j = 0; j < 20; j++)
+        {
+            pt2 t = pt2_translation(pv2_scale(step, (pfloat)j));
+            ph_poly_t moved = ph_transform_poly(&t, &p2);
+
+            ph_manifold_t m1, m2;
+
+            bool warm = ph_gjk_poly_poly(&p1, &moved, &simplex, &m1);
+            bool cold = ph_gjk_poly_poly(&p1, &moved, NULL, &m2);
+
+            REQUIRE(simplex.count >= 1 && simplex.count <= 3);
+
+            ph_manifold_t m3;
+            bool sat = ph_sat_poly_poly(&p1, &moved, &m3);
+
+            if (sat && m3.overlap < 1e-3f)
+                continue;
+
+            REQUIRE(warm == cold);
+
+            if (warm)
+            {
+                REQUIRE(pf_abs(m1.overlap - m2.overlap) < 1e-3f);
+                REQUIRE(pv2_dot(m1.normal, m2.normal) > 0.999f);
+            }
+            else
+            {
+                pfloat d1 = ph_gjk_distance(&p1, &moved, &simplex);
+                pfloat d2 = ph_gjk_distance(&p1, &moved, NULL);
+
+                REQUIRE(pf_abs(d1 - d2) < 1e-3f);
+            }
+        }
+    }
+
+    // A stale simplex from other polygons is discarded
+    ph_simplex_t simplex = { 3, { 15, 15, 15 }, { 15, 15, 15 } };
+
+    pb2 aabb1 = pb2_make(0, 0, 2, 2);
+    pb2 aabb2 = pb2_make(1, 1, 2, 2);
+
+    ph_poly_t p1 = ph_aabb_to_poly(&aabb1);
+    ph_poly_t p2 = ph_aabb_to_poly(&aabb2);
+
+    REQUIRE(ph_gjk_poly_poly(&p1, &p2, &simplex, NULL));
+
+    return true;
+}
+
+TEST_CASE(test_toi_circle_poly)
+{
+    pb2 aabb = pb2_make(10.0f, -5.0f, 0.2f, 10.0f);
+    ph_poly_t wall = ph_aabb_to_poly(&aabb);
+
+    ph_circle_t circle = ph_make_circle(pv2_make(0.0f, 0.0f), 0.5f);
+
+    // Passes through the wall within one step
+    ph_toi_t toi;
+
+    REQUIRE(ph_toi_circle_poly(&circle, pv2_make(20.0f, 0.0f), &wall, pv2_zero(), &toi));
+    REQUIRE(pf_abs(toi.time - 9.5f / 20.0f) < 1e-3f);
+    REQUIRE(pv2_dot(toi.normal, pv2_make(1.0f, 0.0f)) > 0.999f);
+
+    // The wall moving towards the circle
+    REQUIRE(ph_toi_circle_poly(&circle, pv2_make(10.0f, 0.0f), &wall, pv2_make(-10.0f, 0.0f), &toi));
+    REQUIRE(pf_abs(toi.time - 9.5f / 20.0f) < 1e-3f);
+
+    // Stops short of the wall
+    REQUIRE(!ph_toi_circle_poly(&circle, pv2_make(9.0f, 0.0f), &wall, pv2_zero(), NULL));
+
+    // Passes the wall
+    REQUIRE(!ph_toi_circle_poly(&circle, pv2_make(20.0f, 20.0f), &wall, pv2_zero(), NULL));
+
+    // Moves away from the wall
+    REQUIRE(!ph_toi_circle_poly(&circle, pv2_make(-20.0f, 0.0f), &wall, pv2_zero(), NULL));
+
+    // Overlaps at the start
+    circle = ph_make_circle(pv2_make(9.8f, 0.0f), 0.5f);
+
+    REQUIRE(ph_toi_circle_poly(&circle, pv2_make(-20.0f, 0.0f), &wall, pv2_zero(), &toi));
+    REQUIRE(pf_equal(toi.time, 0.0f));
+
+    // The center is inside the wall
+    circle = ph_make_circle(pv2_make(10.1f, 0.0f), 0.5f);
+
+    REQUIRE(ph_toi_circle_poly(&circle, pv2_make(-20.0f, 0.0f), &wall, pv2_zero(), &toi));
+    REQUIRE(pf_equal(toi.time, 0.0f));
+
+    return true;
+}
+
+TEST_CASE(test_toi_poly_poly)
+{
+    pb2 aabb1 = pb2_make(0.0f, 0.0f, 1.0f, 1.0f);
+    pb2 aabb2 = pb2_make(5.0f, 0.5f, 1.0f, 1.0f);
+
+    ph_poly_t p1 = ph_aabb_to_poly(&aabb1);
+    ph_poly_t p2 = ph_aabb_to_poly(&aabb2);
+
+    ph_toi_t toi;
+
+    // Gap of 4 closed at a relative speed of 20
+    REQUIRE(ph_toi_poly_poly(&p1, pv2_make(10.0f, 0.0f), &p2, pv2_make(-10.0f, 0.0f), &toi));
+    REQUIRE(pf_abs(toi.time - 0.2f) < 1e-3f);
+    REQUIRE(pv2_dot(toi.normal, pv2_make(1.0f, 0.0f)) > 0.999f);
+
+    // The second polygon moves away faster
+    REQUIRE(!ph_toi_poly_poly(&p1, pv2_make(10.0f, 0.0f), &p2, pv2_make(20.0f, 0.0f), NULL));
+
+    // Compare against sampling the motion
+    srand(30);
+
+    int hit_count = 0;
+
+    for (int i = 0; i < 200; i++)
+    {
+        ph_poly_t a = random_poly();
+        ph_poly_t b = random_poly();
+
+        // Roughly towards each other, so that about half of the pairs collide
+        pv2 dir = pv2_sub(b.vertices[0], a.vertices[0]);
+
+        pv2 disp_a = pv2_make(random_coord() - 5.0f, random_coord() - 5.0f);
+        pv2 disp_b = pv2_make(random_coord() - 5.0f, random_coord() - 5.0f);
+
+        disp_a = pv2_add(disp_a, pv2_scale(dir, 2.0f));
+
+        if (ph_sat_poly_poly(&a, &b, NULL))
+            continue;
+
+        bool hit = ph_toi_poly_poly(&a, disp_a, &b, disp_b, &toi);
+
+        if (hit)
+        {
+            hit_count++;
+
+            REQUIRE(toi.time >= 0.0f && toi.time <= 1.0f);
+        }
+
+        pfloat end = (hit) ? toi.time : 1.0f;
+
+        // The polygons do not overlap before the time of impact
+        for (int j = 0; j <= 100; j++)
+        {
+            pfloat time = end * (pfloat)j / 100.0f;
+
+            pt2 t1 = pt2_translation(pv2_scale(disp_a, time));
+            pt2 t2 = pt2_translation(pv2_scale(disp_b, time));
+
+            ph_poly_t moved_a = ph_transform_poly(&t1, &a);
+            ph_poly_t moved_b = ph_transform_poly(&t2, &b);
+
+            // At the time of impact the polygons touch, up to rounding errors
+            if (j < 100)
+                REQUIRE(!ph_sat_poly_poly(&moved_a, &moved_b, NULL));
+            else if (hit)
+                REQUIRE(ph_gjk_distance(&moved_a, &moved_b, NULL) < 2e-3f);
+        }
+    }
+
+    REQUIRE(hit_count > 50);
+
+    return true;
+}
+
+TEST_CASE(test_manifold_features)
+{
+    pb2 aabb1 = pb2_make(5, 5, 2, 2);
+    pb2 aabb2 = pb2_make(6, 5.5f, 2, 1);
+
+    ph_poly_t p1 = ph_aabb_to_poly(&aabb1);
+    ph_poly_t p2 = ph_aabb_to_poly(&aabb2);
+
+    ph_manifold_t manifold;
+
+    // The right side of p1 is the +x axis, which is tied with the -x edge
+    REQUIRE(ph_sat_poly_poly(&p1, &p2, &manifold));
+    REQUIRE(manifold.feature == PH_FEATURE_EDGE_A);
+    REQUIRE(manifold.index == 0);
+
+    // A triangle poking into the box from above with its tip
+    pv2 vertices[] = { { 5.5f, 6.8f }, { 6.5f, 8.0f }, { 4.5f, 8.0f } };
+    ph_poly_t tri = ph_make_poly(vertices, 3);
+
+    REQUIRE(ph_sat_poly_poly(&p1, &tri, &manifold));
+    REQUIRE(manifold.feature == PH_FEATURE_EDGE_A);
+    REQUIRE(manifold.index == 1);
+
+    // The separating axis is reported for misses
+    pb2 aabb3 = pb2_make(10, 5, 2, 2);
+    ph_poly_t p3 = ph_aabb_to_poly(&aabb3);
+
+    REQUIRE(!ph_sat_poly_poly(&p1, &p3, &manifold));
+    REQUIRE(manifold.feature == PH_FEATURE_EDGE_A);
+    REQUIRE(manifold.index == 0);
+
+    // Circles against edges
+    ph_circle_t circle = ph_make_circle(pv2_make(6, 7.5f), 1);
+
+    REQUIRE(ph_sat_poly_circle(&p1, &circle, &manifold));
+    REQUIRE(manifold.feature == PH_FEATURE_EDGE_A);
+    REQUIRE(manifold.index == 1);
+
+    REQUIRE(ph_sat_circle_poly(&circle, &p1, &manifold));
+    REQUIRE(manifold.feature == PH_FEATURE_EDGE_B);
+    REQUIRE(manifold.index == 1);
+
+    ph_circle_t circle2 = ph_make_circle(pv2_make(6.5f, 8.5f), 1);
+
+    REQUIRE(ph_sat_circle_circle(&circle, &circle2, &manifold));
+    REQUIRE(manifold.feature == PH_FEATURE_NONE);
+    REQUIRE(manifold.index == -1);
+
+    // EPA finds the same edges as SAT
+    srand(30);
+
+    for (int i = 0; i < 200; i++)
+    {
+        ph_poly_t a = random_poly();
+        ph_poly_t b = random_poly();
+
+        ph_manifold_t m1, m2;
+
+        if (!ph_sat_poly_poly(&a, &b, &m1) || m1.overlap < 1e-3f)
+            continue;
+
+        REQUIRE(ph_gjk_poly_poly(&a, &b, NULL, &m2));
+        REQUIRE(m1.feature == m2.feature);
+        REQUIRE(m1.index == m2.index);
+    }
+
+    return true;
+}
+
+TEST_CASE(test_sat_coherent)
+{
+    srand(31);
+
+    for (int i = 0; i < 500; i++)
+    {
+        ph_poly_t p1 = random_poly();
+        ph_poly_t p2 = random_poly();
+        ph_poly_t p3 = random_poly();
+
+        ph_manifold_t m1, m2, previous;
+
+        // The previous test may be of any pair of polygons
+        ph_sat_poly_poly(&p1, &p3, &previous);
+
+        bool hit = ph_sat_poly_poly(&p1, &p2, &m1);
+
+        REQUIRE(hit == ph_sat_poly_poly_coherent(&p1, &p2, &previous, &m2));
+        REQUIRE(hit == ph_sat_poly_poly_coherent(&p1, &p2, NULL, NULL));
+
+        if (hit)
+            REQUIRE(manifold_equal(&m1, &m2));
+        else
+            REQUIRE(m2.feature == PH_FEATURE_EDGE_A || m2.feature == PH_FEATURE_EDGE_B);
+
+        // Updating in place
+        REQUIRE(hit == ph_sat_poly_poly_coherent(&p1, &p2, &m2, &m2));
+    }
+
+    // A separating axis of B that persists is tested first
+    pb2 aabb1 = pb2_make(0, 0, 2, 2);
+    pb2 aabb2 = pb2_make(0, 3, 2, 2);
+
+    ph_poly_t p1 = ph_aabb_to_poly(&aabb1);
+    ph_poly_t p2 = ph_aabb_to_poly(&aabb2);
+
+    ph_manifold_t previous = { 0 };
+    previous.feature = PH_FEATURE_EDGE_B;
+    previous.index = 3;
+
+    ph_manifold_t manifold;
+
+    REQUIRE(!ph_sat_poly_poly_coherent(&p1, &p2, &previous, &manifold));
+    REQUIRE(manifold.feature == PH_FEATURE_EDGE_B);
+    REQUIRE(manifold.index == 3);
+
+    return true;
+}
+
+TEST_CASE(test_contact_cache)
+{
+    ph_contact_cache_t* cache = ph_contact_cache_create(NULL);
+
+    REQUIRE(0 == ph_contact_cache_count(cache));
+
+    // Enough pairs to grow the cache a few times
+    for (int i = 0; i < 100; i++)
+    {
+        ph_contact_t* contact = ph_contact_cache_get(cache, i, i + 1);
+
+        REQUIRE(contact->a == i && contact->b == i + 1);
+        REQUIRE(!contact->touching);
+        REQUIRE(contact->normal_impulse == 0.0f);
+
+        contact->normal_impulse = (pfloat)i;
+    }
+
+    REQUIRE(100 == ph_contact_cache_count(cache));
+
+    // Pairs are ordered
+    REQUIRE(ph_contact_cache_get(cache, 1, 0)->normal_impulse == 0.0f);
+    REQUIRE(101 == ph_contact_cache_count(cache));
+
+    for (int i = 0; i < 100; i++)
+    {
+        REQUIRE(ph_contact_cache_get(cache, i, i + 1)->normal_impulse == (pfloat)i);
+    }
+
+    REQUIRE(101 == ph_contact_cache_count(cache));
+
+    // Everything was used since the cache was created
+    ph_contact_cache_prune(cache);
+    REQUIRE(101 == ph_contact_cache_count(cache));
+
+    // Only touch the even pairs
+    for (int i = 0; i < 100; i += 2)
+    {
+        ph_contact_cache_get(cache, i, i + 1);
+    }
+
+    ph_contact_cache_prune(cache);
+    REQUIRE(50 == ph_contact_cache_count(cache));
+
+    for (int i = 0; i < 100; i += 2)
+    {
+        REQUIRE(ph_contact_cache_get(cache, i, i + 1)->normal_impulse == (pfloat)i);
+    }
+
+    REQUIRE(ph_contact_cache_get(cache, 1, 2)->normal_impulse == 0.0f);
+
+    ph_contact_cache_prune(cache);
+    ph_contact_cache_prune(cache);
+    REQUIRE(0 == ph_contact_cache_count(cache));
+
+    ph_contact_cache_destroy(cache);
+
+    return true;
+}
+
+TEST_CASE(test_contact_poly_poly)
+{
+    ph_contact_cache_t* cache = ph_contact_cache_create(NULL);
+
+    pb2 ground_aabb = pb2_make(0, 0, 10, 1);
+    pb2 box_aabb = pb2_make(4, 0.9f, 1, 1);
+
+    ph_poly_t ground = ph_aabb_to_poly(&ground_aabb);
+    ph_poly_t box = ph_aabb_to_poly(&box_aabb);
+
+    ph_contact_t* contact = ph_contact_cache_get(cache, 0, 1);
+
+    REQUIRE(ph_contact_poly_poly(contact, &ground, &box));
+    REQUIRE(contact->touching);
+    REQUIRE(contact->manifold.feature == PH_FEATURE_EDGE_A);
+    REQUIRE(contact->manifold.index == 1);
+
+    // The solver stores its impulse, which persists while the box rests
+    contact->normal_impulse = 2.0f;
+
+    pt2 t = pt2_translation(pv2_make(0.5f, 0.0f));
+    box = ph_transform_poly(&t, &box);
+
+    contact = ph_contact_cache_get(cache, 0, 1);
+
+    REQUIRE(ph_contact_poly_poly(contact, &ground, &box));
+    REQUIRE(contact->normal_impulse == 2.0f);
+
+    // The box lifts off, so the impulse is discarded
+    t = pt2_translation(pv2_make(0.0f, 1.0f));
+    box = ph_transform_poly(&t, &box);
+
+    REQUIRE(!ph_contact_poly_poly(contact, &ground, &box));
+    REQUIRE(!contact->touching);
+    REQUIRE(contact->normal_impulse == 0.0f);
+    REQUIRE(contact->manifold.feature != PH_FEATURE_NONE);
+
+    ph_contact_cache_destroy(cache);
+
+    return true;
+}
+
 TEST_SUITE(suite_sat)
 {
     RUN_TEST_CASE(test_aabb_aabb_collide);
@@ -251,4 +931,16 @@ TEST_SUITE(suite_sat)
     RUN_TEST_CASE(test_poly_to_aabb);
     RUN_TEST_CASE(test_transform_poly);
     RUN_TEST_CASE(test_transform_circle);
+    RUN_TEST_CASE(test_aabb_aabb);
+    RUN_TEST_CASE(test_batch);
+    RUN_TEST_CASE(test_poly_cache);
+    RUN_TEST_CASE(test_gjk_poly_poly);
+    RUN_TEST_CASE(test_gjk_distance);
+    RUN_TEST_CASE(test_gjk_warm_start);
+    RUN_TEST_CASE(test_toi_circle_poly);
+    RUN_TEST_CASE(test_toi_poly_poly);
+    RUN_TEST_CASE(test_manifold_features);
+    RUN_TEST_CASE(test_sat_coherent);
+    RUN_TEST_CASE(test_contact_cache);
+    RUN_TEST_CASE(test_contact_poly_poly);
 }
@@ -185,6 +185,47 @@ TEST_CASE(test_b2_transform)
     return true;
 }
 
+TEST_CASE(test_b2_transform_array)
+{
+    prng_t rng;
+    prng_seed(&rng, 0x4321);
+
+    pt2 t = pt2_scaling(pv2_make(2.0f, -0.5f));
+    pt2_rotate(&t, PM_PI / 6.0f);
+    pt2_translate(&t, pv2_make(3.0f, -1.0f));
+
+    pb2 in[9];
+    pb2 out[9];
+
+    for (int i = 0; i < 9; i++)
+    {
+        pfloat x = pf_random(&rng) - 0.5f;
+        pfloat y = pf_random(&rng) - 0.5f;
+        pfloat w = pf_random(&rng);
+        pfloat h = pf_random(&rng);
+
+        in[i] = pb2_make(x, y, w, h);
+    }
+
+    pb2_transform_array(&t, in, out, 9);
+
+    for (int i = 0; i < 9; i++)
+    {
+        pb2 exp = pb2_transform(&t, &in[i]);
+        REQUIRE(pb2_equal(&out[i], &exp));
+    }
+
+    // In place
+    pb2_transform_array(&t, in, in, 9);
+
+    for (int i = 0; i < 9; i++)
+    {
+        REQUIRE(pb2_equal(&in[i], &out[i]));
+    }
+
+    return true;
+}
+
 TEST_SUITE(suite_b2)
 {
     RUN_TEST_CASE(test_b2_get_pos);
@@ -197,4 +238,5 @@ TEST_SUITE(suite_b2)
     RUN_TEST_CASE(test_b2_contains_point);
     RUN_TEST_CASE(test_b2_enclosing);
     RUN_TEST_CASE(test_b2_transform);
+    RUN_TEST_CASE(test_b2_transform_array);
 }
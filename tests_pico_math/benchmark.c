@@ -0,0 +1,257 @@
+/*=============================================================================
+ * Compares the fast approximations in pico_math with the exact libm versions
+ *============================================================================*/
+
+#define PICO_TIME_IMPLEMENTATION
+#include "../pico_time.h"
+
+#define PICO_MATH_IMPLEMENTATION
+#include "../pico_math.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_COUNT (1000 * 1000)
+#define ITERATIONS    10
+
+// Number of inputs (set from the command line)
+static int count = DEFAULT_COUNT;
+
+// Inputs in [0, 100] for square roots and [-4 pi, 4 pi] for angles
+static pfloat* values = NULL;
+static pfloat* angles = NULL;
+
+// Results are accumulated here so that the calls cannot be optimized away
+static volatile pfloat sink = 0.0f;
+
+typedef pfloat (*bench_fn)(void);
+
+// Runs a benchmark function and reports its cost per call
+static void bench_run(const char* name, bench_fn fp)
+{
+    ptime_t start = pt_now();
+
+    for (int i = 0; i < ITERATIONS; i++)
+        sink += fp();
+
+    ptime_t end = pt_now();
+
+    double elapsed_ms = (double)pt_to_usec(end - start) / 1000.0;
+    double ns_per_op  = elapsed_ms * 1000000.0 / ((double)count * ITERATIONS);
+
+    printf("%-24s %12.2f %12.3f\n", name, ns_per_op, elapsed_ms);
+}
+
+#define BENCH_RUN(fp) bench_run(#fp, fp)
+
+// The exact versions call libm directly so that they are unaffected by
+// PICO_MATH_FAST
+#ifdef PICO_MATH_DOUBLE
+    #define exact_sqrt  sqrt
+    #define exact_sin   sin
+    #define exact_cos   cos
+    #define exact_atan2 atan2
+#else
+    #define exact_sqrt  sqrtf
+    #define exact_sin   sinf
+    #define exact_cos   cosf
+    #define exact_atan2 atan2f
+#endif
+
+static pfloat sqrt_exact(void)
+{
+    pfloat sum = 0.0f;
+
+    for (int i = 0; i < count; i++)
+        sum += exact_sqrt(values[i]);
+
+    return sum;
+}
+
+static pfloat sqrt_fast(void)
+{
+    pfloat sum = 0.0f;
+
+    for (int i = 0; i < count; i++)
+        sum += pf_fast_sqrt(values[i]);
+
+    return sum;
+}
+
+static pfloat rsqrt_exact(void)
+{
+    pfloat sum = 0.0f;
+
+    for (int i = 0; i < count; i++)
+        sum += 1.0f / exact_sqrt(values[i]);
+
+    return sum;
+}
+
+static pfloat rsqrt_fast(void)
+{
+    pfloat sum = 0.0f;
+
+    for (int i = 0; i < count; i++)
+        sum += pf_fast_rsqrt(values[i]);
+
+    return sum;
+}
+
+static pfloat sin_exact(void)
+{
+    pfloat sum = 0.0f;
+
+    for (int i = 0; i < count; i++)
+        sum += exact_sin(angles[i]);
+
+    return sum;
+}
+
+static pfloat sin_fast(void)
+{
+    pfloat sum = 0.0f;
+
+    for (int i = 0; i < count; i++)
+        sum += pf_fast_sin(angles[i]);
+
+    return sum;
+}
+
+static pfloat cos_exact(void)
+{
+    pfloat sum = 0.0f;
+
+    for (int i = 0; i < count; i++)
+        sum += exact_cos(angles[i]);
+
+    return sum;
+}
+
+static pfloat cos_fast(void)
+{
+    pfloat sum = 0.0f;
+
+    for (int i = 0; i < count; i++)
+        sum += pf_fast_cos(angles[i]);
+
+    return sum;
+}
+
+static pfloat atan2_exact(void)
+{
+    pfloat sum = 0.0f;
+
+    for (int i = 0; i + 1 < count; i++)
+        sum += exact_atan2(angles[i], angles[i + 1]);
+
+    return sum;
+}
+
+static pfloat atan2_fast(void)
+{
+    pfloat sum = 0.0f;
+
+    for (int i = 0; i + 1 < count; i++)
+        sum += pf_fast_atan2(angles[i], angles[i + 1]);
+
+    return sum;
+}
+
+// Reports the largest absolute error of the approximations over the inputs
+static void print_errors(void)
+{
+    double sqrt_err = 0.0, rsqrt_err = 0.0, sin_err = 0.0;
+    double cos_err = 0.0, atan2_err = 0.0;
+
+    for (int i = 0; i + 1 < count; i++)
+    {
+        double v = values[i];
+        double a = angles[i];
+        double b = angles[i + 1];
+
+        sqrt_err  = pf_max(sqrt_err,  fabs(pf_fast_sqrt(values[i]) - sqrt(v)));
+        sin_err   = pf_max(sin_err,   fabs(pf_fast_sin(angles[i]) - sin(a)));
+        cos_err   = pf_max(cos_err,   fabs(pf_fast_cos(angles[i]) - cos(a)));
+        atan2_err = pf_max(atan2_err, fabs(pf_fast_atan2(angles[i], angles[i + 1]) - atan2(a, b)));
+
+        if (v > 0.01) // Relative error, since 1 / sqrt is unbounded near zero
+            rsqrt_err = pf_max(rsqrt_err, fabs(pf_fast_rsqrt(values[i]) * sqrt(v) - 1.0));
+    }
+
+    printf("%-24s %12g\n", "sqrt",  sqrt_err);
+    printf("%-24s %12g\n", "rsqrt (relative)", rsqrt_err);
+    printf("%-24s %12g\n", "sin",   sin_err);
+    printf("%-24s %12g\n", "cos",   cos_err);
+    printf("%-24s %12g\n", "atan2", atan2_err);
+}
+
+static void print_usage(const char* name)
+{
+    printf("Usage: %s [-n count]\n", name);
+}
+
+int main(int argc, char** argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (0 == strcmp(argv[i], "-n") && i + 1 < argc)
+        {
+            count = atoi(argv[++i]);
+        }
+        else
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (count <= 1)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    values = malloc(count * sizeof(pfloat));
+    angles = malloc(count * sizeof(pfloat));
+
+    prng_t rng;
+    prng_seed(&rng, 1);
+
+    for (int i = 0; i < count; i++)
+    {
+        values[i] = 100.0f * pf_random(&rng);
+        angles[i] = 4.0f * PM_PI2 * (pf_random(&rng) - 0.5f);
+    }
+
+    printf("===================================================\n");
+    printf("Number of inputs: %d\n", count);
+    printf("---------------------------------------------------\n");
+    printf("%-24s %12s %12s\n", "Benchmark", "ns/op", "Total (ms)");
+    printf("---------------------------------------------------\n");
+
+    BENCH_RUN(sqrt_exact);
+    BENCH_RUN(sqrt_fast);
+    BENCH_RUN(rsqrt_exact);
+    BENCH_RUN(rsqrt_fast);
+    BENCH_RUN(sin_exact);
+    BENCH_RUN(sin_fast);
+    BENCH_RUN(cos_exact);
+    BENCH_RUN(cos_fast);
+    BENCH_RUN(atan2_exact);
+    BENCH_RUN(atan2_fast);
+
+    printf("---------------------------------------------------\n");
+    printf("%-24s %12s\n", "Approximation", "Max error");
+    printf("---------------------------------------------------\n");
+
+    print_errors();
+
+    printf("===================================================\n");
+
+    free(values);
+    free(angles);
+
+    return 0;
+}
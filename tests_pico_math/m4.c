@@ -0,0 +1,242 @@
+#include "../pico_math.h"
+#include "../pico_unit.h"
+
+static pm4 random_matrix(prng_t* rng)
+{
+    pm4 m;
+
+    for (int i = 0; i < 16; i++)
+        m.m[i] = 2.0f * pf_random(rng) - 1.0f;
+
+    return m;
+}
+
+TEST_CASE(test_m4_layout)
+{
+    // Column-major (translation in the last four entries), as in pico_gl
+    pm4 m = pm4_translation(pv3_make(1, 2, 3));
+
+    REQUIRE(pf_equal(m.m[12], 1));
+    REQUIRE(pf_equal(m.m[13], 2));
+    REQUIRE(pf_equal(m.m[14], 3));
+
+    REQUIRE(pf_equal(pm4_get(&m, 0, 3), 1));
+    REQUIRE(pf_equal(pm4_get(&m, 1, 3), 2));
+    REQUIRE(pf_equal(pm4_get(&m, 2, 3), 3));
+
+    pm4_set(&m, 3, 0, 5);
+    REQUIRE(pf_equal(m.m[3], 5));
+
+    return true;
+}
+
+TEST_CASE(test_m4_mult)
+{
+    prng_t rng;
+    prng_seed(&rng, 0x1357);
+
+    pm4 m1 = random_matrix(&rng);
+    pm4 m2 = random_matrix(&rng);
+
+    pm4 res = pm4_mult(&m1, &m2);
+
+    for (int r = 0; r < 4; r++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            pfloat exp = 0.0f;
+
+            for (int k = 0; k < 4; k++)
+                exp += pm4_get(&m1, r, k) * pm4_get(&m2, k, c);
+
+            REQUIRE(pf_equal(pm4_get(&res, r, c), exp));
+        }
+    }
+
+    pm4 id = pm4_identity();
+    res = pm4_mult(&m1, &id);
+    REQUIRE(pm4_equal(&res, &m1));
+
+    // Applies m2 first
+    pv4 v = pv4_make(1, -2, 3, 1);
+    pv4 exp = pm4_map(&m1, pm4_map(&m2, v));
+
+    res = pm4_mult(&m1, &m2);
+    REQUIRE(pv4_equal(pm4_map(&res, v), exp));
+
+    return true;
+}
+
+TEST_CASE(test_m4_transpose)
+{
+    prng_t rng;
+    prng_seed(&rng, 0x2468);
+
+    pm4 m = random_matrix(&rng);
+    pm4 t = pm4_transpose(&m);
+
+    for (int r = 0; r < 4; r++)
+    {
+        for (int c = 0; c < 4; c++)
+            REQUIRE(pf_equal(pm4_get(&t, r, c), pm4_get(&m, c, r)));
+    }
+
+    return true;
+}
+
+TEST_CASE(test_m4_det)
+{
+    pm4 m = pm4_scaling(pv3_make(2, 3, 4));
+    REQUIRE(pf_equal(pm4_det(&m), 24));
+
+    m = pm4_rotation(pv3_make(1, 1, 0), 0.7f);
+    REQUIRE(pf_equal(pm4_det(&m), 1));
+
+    return true;
+}
+
+TEST_CASE(test_m4_inv)
+{
+    prng_t rng;
+    prng_seed(&rng, 0x3579);
+
+    pm4 id = pm4_identity();
+
+    for (int i = 0; i < 10; i++)
+    {
+        pm4 m = random_matrix(&rng);
+
+        if (pf_abs(pm4_det(&m)) < 0.1f) // Skip ill-conditioned matrices
+            continue;
+
+        pm4 inv = pm4_inv(&m);
+        pm4 res = pm4_mult(&m, &inv);
+
+        REQUIRE(pm4_equal(&res, &id));
+
+        res = pm4_mult(&inv, &m);
+        REQUIRE(pm4_equal(&res, &id));
+    }
+
+    // Singular matrices invert to the identity
+    pm4 m = pm4_scaling(pv3_make(1, 0, 1));
+    pm4 inv = pm4_inv(&m);
+
+    REQUIRE(pm4_equal(&inv, &id));
+
+    return true;
+}
+
+TEST_CASE(test_m4_affine)
+{
+    pv3 p = pv3_make(1, 2, 3);
+
+    pm4 m = pm4_translation(pv3_make(1, -1, 2));
+    pv3 exp = pv3_make(2, 1, 5);
+    REQUIRE(pv3_equal(pm4_map_point(&m, p), exp));
+
+    m = pm4_scaling(pv3_make(2, 3, -1));
+    exp = pv3_make(2, 6, -3);
+    REQUIRE(pv3_equal(pm4_map_point(&m, p), exp));
+
+    // Counter-clockwise about z
+    m = pm4_rotation(pv3_make(0, 0, 2), PM_PI / 2.0f);
+    exp = pv3_make(-2, 1, 3);
+    REQUIRE(pv3_equal(pm4_map_point(&m, p), exp));
+
+    // Points on the axis are fixed
+    m = pm4_rotation(p, 1.3f);
+    REQUIRE(pv3_equal(pm4_map_point(&m, p), p));
+
+    return true;
+}
+
+TEST_CASE(test_m4_look_at)
+{
+    pv3 eye = pv3_make(0, 0, 5);
+    pm4 m = pm4_look_at(eye, pv3_zero(), pv3_make(0, 1, 0));
+
+    // The camera looks down the negative z-axis
+    pv3 exp = pv3_make(0, 0, -5);
+    REQUIRE(pv3_equal(pm4_map_point(&m, pv3_zero()), exp));
+    REQUIRE(pv3_equal(pm4_map_point(&m, eye), pv3_zero()));
+
+    eye = pv3_make(3, 0, 0);
+    m = pm4_look_at(eye, pv3_zero(), pv3_make(0, 1, 0));
+
+    exp = pv3_make(0, 1, -3);
+    REQUIRE(pv3_equal(pm4_map_point(&m, pv3_make(0, 1, 0)), exp));
+
+    return true;
+}
+
+TEST_CASE(test_m4_ortho)
+{
+    pm4 m = pm4_ortho(0, 800, 600, 0, -1, 1);
+
+    pv3 exp = pv3_make(-1, 1, 0);
+    REQUIRE(pv3_equal(pm4_map_point(&m, pv3_make(0, 0, 0)), exp));
+
+    exp = pv3_make(1, -1, 0);
+    REQUIRE(pv3_equal(pm4_map_point(&m, pv3_make(800, 600, 0)), exp));
+
+    m = pm4_ortho(-1, 1, -1, 1, 1, 10);
+
+    exp = pv3_make(0, 0, -1);
+    REQUIRE(pv3_equal(pm4_map_point(&m, pv3_make(0, 0, -1)), exp));
+
+    exp = pv3_make(0, 0, 1);
+    REQUIRE(pv3_equal(pm4_map_point(&m, pv3_make(0, 0, -10)), exp));
+
+    return true;
+}
+
+TEST_CASE(test_m4_perspective)
+{
+    pm4 m = pm4_perspective(PM_PI / 2.0f, 2.0f, 1.0f, 100.0f);
+
+    // The near and far planes map to -1 and 1
+    pv3 exp = pv3_make(0, 0, -1);
+    REQUIRE(pv3_equal(pm4_map_point(&m, pv3_make(0, 0, -1)), exp));
+
+    exp = pv3_make(0, 0, 1);
+    REQUIRE(pv3_equal(pm4_map_point(&m, pv3_make(0, 0, -100)), exp));
+
+    // A 90 degree field of view maps the top edge of the near plane to 1
+    pv3 res = pm4_map_point(&m, pv3_make(2, 1, -1));
+    REQUIRE(pf_equal(res.x, 1) && pf_equal(res.y, 1));
+
+    return true;
+}
+
+TEST_CASE(test_m4_from_t2)
+{
+    pt2 t = pt2_rotation(0.5f);
+    pt2_translate(&t, pv2_make(3, -2));
+    pt2_scale(&t, pv2_make(2, 0.5f));
+
+    pm4 m = pm4_from_pt2(&t);
+
+    pv2 v = pv2_make(1.5f, -0.5f);
+    pv2 exp = pt2_map(&t, v);
+    pv3 res = pm4_map_point(&m, pv3_make(v.x, v.y, 0));
+
+    REQUIRE(pv2_equal(pv2_make(res.x, res.y), exp));
+    REQUIRE(pf_equal(res.z, 0));
+
+    return true;
+}
+
+TEST_SUITE(suite_m4)
+{
+    RUN_TEST_CASE(test_m4_layout);
+    RUN_TEST_CASE(test_m4_mult);
+    RUN_TEST_CASE(test_m4_transpose);
+    RUN_TEST_CASE(test_m4_det);
+    RUN_TEST_CASE(test_m4_inv);
+    RUN_TEST_CASE(test_m4_affine);
+    RUN_TEST_CASE(test_m4_look_at);
+    RUN_TEST_CASE(test_m4_ortho);
+    RUN_TEST_CASE(test_m4_perspective);
+    RUN_TEST_CASE(test_m4_from_t2);
+}
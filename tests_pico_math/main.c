@@ -6,8 +6,12 @@
 
 TEST_SUITE(suite_scalar);
 TEST_SUITE(suite_v2);
+TEST_SUITE(suite_v2s);
 TEST_SUITE(suite_t2);
 TEST_SUITE(suite_b2);
+TEST_SUITE(suite_prng);
+TEST_SUITE(suite_v3);
+TEST_SUITE(suite_m4);
 
 int main()
 {
@@ -15,8 +19,18 @@ int main()
 
     RUN_TEST_SUITE(suite_scalar);
     RUN_TEST_SUITE(suite_v2);
+    RUN_TEST_SUITE(suite_v2s);
+TEST_SUITE(suite_v2s);
     RUN_TEST_SUITE(suite_t2);
     RUN_TEST_SUITE(suite_b2);
+    RUN_TEST_SUITE(suite_prng);
+    RUN_TEST_SUITE(suite_v3);
+    RUN_TEST_SUITE(suite_m4);
+TEST_SUITE(suite_v3);
+TEST_SUITE(suite_m4);
+TEST_SUITE(suite_prng);
+TEST_SUITE(suite_v3);
+TEST_SUITE(suite_m4);
 
     pu_print_stats();
 
@@ -0,0 +1,147 @@
+#include "../pico_math.h"
+#include "../pico_unit.h"
+
+TEST_CASE(test_prng_random)
+{
+    // Reference output of xoshiro128** for the state { 1, 2, 3, 4 }
+    prng_t rng = {{ 1, 2, 3, 4 }};
+
+    REQUIRE(prng_random(&rng) == 11520);
+    REQUIRE(prng_random(&rng) == 0);
+    REQUIRE(prng_random(&rng) == 5927040);
+    REQUIRE(prng_random(&rng) == 70819200);
+
+    return true;
+}
+
+TEST_CASE(test_prng_jump)
+{
+    prng_t rng = {{ 1, 2, 3, 4 }};
+
+    prng_jump(&rng);
+
+    REQUIRE(rng.s[0] == 0xa9765206);
+    REQUIRE(rng.s[1] == 0x797aa168);
+    REQUIRE(rng.s[2] == 0x5b62e331);
+    REQUIRE(rng.s[3] == 0x02abd971);
+
+    REQUIRE(prng_random(&rng) == 1194304935);
+    REQUIRE(prng_random(&rng) == 745561276);
+
+    return true;
+}
+
+TEST_CASE(test_prng_long_jump)
+{
+    prng_t rng = {{ 1, 2, 3, 4 }};
+
+    prng_long_jump(&rng);
+
+    REQUIRE(rng.s[0] == 0x6014af26);
+    REQUIRE(rng.s[1] == 0x7eb5a852);
+    REQUIRE(rng.s[2] == 0x399fbba1);
+    REQUIRE(rng.s[3] == 0xbe5ebfce);
+
+    return true;
+}
+
+TEST_CASE(test_prng_split)
+{
+    prng_t rng, tmp, out;
+
+    prng_seed(&rng, 42);
+
+    tmp = rng;
+    prng_long_jump(&tmp);
+
+    prng_t exp = rng;
+    prng_split(&rng, &out);
+
+    for (int i = 0; i < 4; i++)
+    {
+        REQUIRE(out.s[i] == exp.s[i]); // Continues the stream
+        REQUIRE(rng.s[i] == tmp.s[i]); // Long jumps the source
+    }
+
+    return true;
+}
+
+#define FILL_SIZE 23 // Not a multiple of four to exercise the remainder
+
+TEST_CASE(test_prng4_fill)
+{
+    prng_t rng;
+    prng_seed(&rng, 1234);
+
+    prng4_t rng4;
+    prng4_init(&rng4, &rng);
+
+    // Lane streams
+    prng_t lanes[4];
+    lanes[0] = rng;
+
+    for (int i = 1; i < 4; i++)
+    {
+        lanes[i] = lanes[i - 1];
+        prng_jump(&lanes[i]);
+    }
+
+    uint32_t out[FILL_SIZE];
+
+    for (int k = 0; k < 2; k++)
+    {
+        prng4_fill(&rng4, out, FILL_SIZE);
+
+        for (int i = 0; i < FILL_SIZE; i++)
+        {
+            REQUIRE(out[i] == prng_random(&lanes[i % 4]));
+        }
+
+        // Excess results of the final step are discarded
+        for (int i = FILL_SIZE % 4; i < 4; i++)
+        {
+            prng_random(&lanes[i]);
+        }
+    }
+
+    return true;
+}
+
+TEST_CASE(test_pf_random_fill)
+{
+    prng4_t rng4;
+    prng4_seed(&rng4, 5678);
+
+    prng4_t tmp = rng4;
+
+    uint32_t ints[FILL_SIZE];
+    pfloat out[FILL_SIZE];
+
+    prng4_fill(&tmp, ints, FILL_SIZE);
+    pf_random_fill(&rng4, out, FILL_SIZE);
+
+    for (int i = 0; i < FILL_SIZE; i++)
+    {
+        REQUIRE(out[i] == (pfloat)ints[i] / (pfloat)UINT32_MAX);
+        REQUIRE(out[i] >= 0.0f && out[i] <= 1.0f);
+    }
+
+    // Both generators end in the same state
+    for (int i = 0; i < 4; i++)
+    {
+        for (int j = 0; j < 4; j++)
+            REQUIRE(tmp.s[i][j] == rng4.s[i][j]);
+    }
+
+    return true;
+}
+
+TEST_SUITE(suite_prng)
+{
+    RUN_TEST_CASE(test_prng_random);
+    RUN_TEST_CASE(test_prng_jump);
+    RUN_TEST_CASE(test_prng_long_jump);
+    RUN_TEST_CASE(test_prng_split);
+    RUN_TEST_CASE(test_prng4_fill);
+    RUN_TEST_CASE(test_pf_random_fill);
+}
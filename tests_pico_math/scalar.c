@@ -49,10 +49,69 @@ TEST_CASE(test_lerp_angle)
     return true;
 }
 
+// Required accuracy of the fast approximations
+#define FAST_TOLERANCE 1e-4
+
+// The fast functions are compared against libm in double precision, which
+// remains exact even if PICO_MATH_FAST is defined
+
+TEST_CASE(test_fast_sqrt)
+{
+    for (int i = 1; i <= 1000; i++)
+    {
+        pfloat c = (pfloat)i * (pfloat)i / 1000.0f;
+        double exp = sqrt((double)c);
+
+        REQUIRE(fabs(pf_fast_sqrt(c) - exp) <= FAST_TOLERANCE * exp);
+        REQUIRE(fabs(pf_fast_rsqrt(c) - 1.0 / exp) <= FAST_TOLERANCE / exp);
+    }
+
+    REQUIRE(0.0f == pf_fast_sqrt(0.0f));
+    REQUIRE(0.0f == pf_fast_sqrt(-1.0f));
+
+    return true;
+}
+
+TEST_CASE(test_fast_sin_cos)
+{
+    for (int i = -1000; i <= 1000; i++)
+    {
+        pfloat angle = (pfloat)i * PM_PI2 / 250.0f; // Four revolutions each way
+
+        REQUIRE(fabs(pf_fast_sin(angle) - sin((double)angle)) <= FAST_TOLERANCE);
+        REQUIRE(fabs(pf_fast_cos(angle) - cos((double)angle)) <= FAST_TOLERANCE);
+    }
+
+    return true;
+}
+
+TEST_CASE(test_fast_atan2)
+{
+    for (int i = 0; i < 1000; i++)
+    {
+        pfloat angle = (pfloat)i * PM_PI2 / 1000.0f;
+        pfloat len = 0.5f + (pfloat)(i % 7);
+
+        pfloat y = len * (pfloat)sin((double)angle);
+        pfloat x = len * (pfloat)cos((double)angle);
+
+        REQUIRE(fabs(pf_fast_atan2(y, x) - atan2((double)y, (double)x)) <= FAST_TOLERANCE);
+    }
+
+    REQUIRE(0.0f == pf_fast_atan2(0.0f, 0.0f));
+    REQUIRE(pf_equal(pf_fast_atan2(0.0f, -1.0f), PM_PI));
+    REQUIRE(pf_equal(pf_fast_atan2(1.0f, 0.0f), PM_PI / 2.0f));
+
+    return true;
+}
+
 TEST_SUITE(suite_scalar)
 {
     RUN_TEST_CASE(test_min);
     RUN_TEST_CASE(test_max);
     RUN_TEST_CASE(test_clamp);
     RUN_TEST_CASE(test_lerp_angle);
+    RUN_TEST_CASE(test_fast_sqrt);
+    RUN_TEST_CASE(test_fast_sin_cos);
+    RUN_TEST_CASE(test_fast_atan2);
 }
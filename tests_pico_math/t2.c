@@ -280,6 +280,108 @@ TEST_CASE(test_t2_lerp_identity)
     return true;
 }
 
+static pt2 random_transform(prng_t* rng)
+{
+    pt2 t = pt2_scaling(pv2_make(0.5f + pf_random(rng), 0.5f + pf_random(rng)));
+    pt2_rotate(&t, PM_PI2 * pf_random(rng));
+    pt2_translate(&t, pv2_make(10.0f * pf_random(rng) - 5.0f,
+                               10.0f * pf_random(rng) - 5.0f));
+    return t;
+}
+
+TEST_CASE(test_t2_map_array)
+{
+    prng_t rng;
+    prng_seed(&rng, 0x1234);
+
+    pt2 t = random_transform(&rng);
+
+    pv2 in[13];  // Odd count exercises the remainder
+    pv2 out[13];
+
+    for (int i = 0; i < 13; i++)
+    {
+        in[i] = pv2_make(pf_random(&rng) - 0.5f, pf_random(&rng) - 0.5f);
+    }
+
+    pt2_map_array(&t, in, out, 13);
+
+    for (int i = 0; i < 13; i++)
+    {
+        pv2 exp = pt2_map(&t, in[i]);
+        REQUIRE(pv2_equal(out[i], exp));
+    }
+
+    // In place
+    pt2_map_array(&t, in, in, 13);
+
+    for (int i = 0; i < 13; i++)
+    {
+        REQUIRE(pv2_equal(in[i], out[i]));
+    }
+
+    return true;
+}
+
+TEST_CASE(test_t2_map_soa)
+{
+    prng_t rng;
+    prng_seed(&rng, 0x5678);
+
+    pt2 t = random_transform(&rng);
+
+    pfloat in_x[11], in_y[11];
+    pfloat out_x[11], out_y[11];
+
+    for (int i = 0; i < 11; i++)
+    {
+        in_x[i] = pf_random(&rng) - 0.5f;
+        in_y[i] = pf_random(&rng) - 0.5f;
+    }
+
+    pt2_map_soa(&t, in_x, in_y, out_x, out_y, 11);
+
+    for (int i = 0; i < 11; i++)
+    {
+        pv2 exp = pt2_map(&t, pv2_make(in_x[i], in_y[i]));
+        REQUIRE(pv2_equal(pv2_make(out_x[i], out_y[i]), exp));
+    }
+
+    return true;
+}
+
+TEST_CASE(test_t2_mult_array)
+{
+    prng_t rng;
+    prng_seed(&rng, 0x9abc);
+
+    pt2 t1[7], t2[7], out[7];
+
+    for (int i = 0; i < 7; i++)
+    {
+        t1[i] = random_transform(&rng);
+        t2[i] = random_transform(&rng);
+    }
+
+    pt2_mult_array(t1, t2, out, 7);
+
+    for (int i = 0; i < 7; i++)
+    {
+        pt2 exp = pt2_mult(&t1[i], &t2[i]);
+        REQUIRE(pt2_equal(&out[i], &exp));
+    }
+
+    // In place (as when flattening a hierarchy into the local transforms)
+    pt2_mult_array(t1, t2, t2, 7);
+
+    for (int i = 0; i < 7; i++)
+    {
+        REQUIRE(pt2_equal(&t2[i], &out[i]));
+    }
+
+    return true;
+}
+
 TEST_SUITE(suite_t2)
 {
     RUN_TEST_CASE(test_t2_equal);
@@ -294,4 +396,7 @@ TEST_SUITE(suite_t2)
     RUN_TEST_CASE(test_t2_inv);
     RUN_TEST_CASE(test_t2_lerp);
     RUN_TEST_CASE(test_t2_lerp_identity);
+    RUN_TEST_CASE(test_t2_map_array);
+    RUN_TEST_CASE(test_t2_map_soa);
+    RUN_TEST_CASE(test_t2_mult_array);
 }
@@ -0,0 +1,188 @@
+#include "../pico_math.h"
+#include "../pico_unit.h"
+
+#define STREAM_SIZE 11 // Not a multiple of four to exercise the remainder
+
+static pfloat ax[STREAM_SIZE], ay[STREAM_SIZE];
+static pfloat bx[STREAM_SIZE], by[STREAM_SIZE];
+static pfloat cx[STREAM_SIZE], cy[STREAM_SIZE];
+
+static pv2s s1, s2, s3;
+
+static void setup(void)
+{
+    prng_t rng;
+    prng_seed(&rng, 0x2468);
+
+    for (int i = 0; i < STREAM_SIZE; i++)
+    {
+        ax[i] = 4.0f * pf_random(&rng) - 2.0f;
+        ay[i] = 4.0f * pf_random(&rng) - 2.0f;
+        bx[i] = 4.0f * pf_random(&rng) - 2.0f;
+        by[i] = 4.0f * pf_random(&rng) - 2.0f;
+        cx[i] = cy[i] = 0.0f;
+    }
+
+    s1 = pv2s_make(ax, ay, STREAM_SIZE);
+    s2 = pv2s_make(bx, by, STREAM_SIZE);
+    s3 = pv2s_make(cx, cy, STREAM_SIZE);
+}
+
+static void teardown(void)
+{
+}
+
+TEST_CASE(test_v2s_get_set)
+{
+    pv2s_set(&s3, 3, pv2_make(1, 2));
+
+    pv2 res = pv2s_get(&s3, 3);
+    pv2 exp = pv2_make(1, 2);
+
+    REQUIRE(pv2_equal(res, exp));
+    REQUIRE(pf_equal(cx[3], 1) && pf_equal(cy[3], 2));
+
+    return true;
+}
+
+TEST_CASE(test_v2s_add)
+{
+    pv2s_add(&s3, &s1, &s2);
+
+    for (int i = 0; i < STREAM_SIZE; i++)
+    {
+        pv2 exp = pv2_add(pv2s_get(&s1, i), pv2s_get(&s2, i));
+        REQUIRE(pv2_equal(pv2s_get(&s3, i), exp));
+    }
+
+    return true;
+}
+
+TEST_CASE(test_v2s_sub)
+{
+    pv2s_sub(&s3, &s1, &s2);
+
+    for (int i = 0; i < STREAM_SIZE; i++)
+    {
+        pv2 exp = pv2_sub(pv2s_get(&s1, i), pv2s_get(&s2, i));
+        REQUIRE(pv2_equal(pv2s_get(&s3, i), exp));
+    }
+
+    return true;
+}
+
+TEST_CASE(test_v2s_scale)
+{
+    pv2s_scale(&s3, &s1, 2.5f);
+
+    for (int i = 0; i < STREAM_SIZE; i++)
+    {
+        pv2 exp = pv2_scale(pv2s_get(&s1, i), 2.5f);
+        REQUIRE(pv2_equal(pv2s_get(&s3, i), exp));
+    }
+
+    return true;
+}
+
+TEST_CASE(test_v2s_add_scaled)
+{
+    pv2s_add_scaled(&s3, &s1, &s2, 0.25f);
+
+    for (int i = 0; i < STREAM_SIZE; i++)
+    {
+        pv2 exp = pv2_add(pv2s_get(&s1, i), pv2_scale(pv2s_get(&s2, i), 0.25f));
+        REQUIRE(pv2_equal(pv2s_get(&s3, i), exp));
+    }
+
+    // In place
+    pv2s_add_scaled(&s1, &s1, &s2, 0.25f);
+
+    for (int i = 0; i < STREAM_SIZE; i++)
+    {
+        REQUIRE(pv2_equal(pv2s_get(&s1, i), pv2s_get(&s3, i)));
+    }
+
+    return true;
+}
+
+TEST_CASE(test_v2s_dot)
+{
+    pfloat out[STREAM_SIZE];
+
+    pv2s_dot(out, &s1, &s2);
+
+    for (int i = 0; i < STREAM_SIZE; i++)
+    {
+        pfloat exp = pv2_dot(pv2s_get(&s1, i), pv2s_get(&s2, i));
+        REQUIRE(pf_equal(out[i], exp));
+    }
+
+    return true;
+}
+
+TEST_CASE(test_v2s_normalize)
+{
+    pv2s_set(&s1, 1, pv2_zero()); // Degenerate elements in both the vector
+    pv2s_set(&s1, 9, pv2_zero()); // and scalar loops
+
+    pv2s_normalize(&s3, &s1);
+
+    for (int i = 0; i < STREAM_SIZE; i++)
+    {
+        pv2 exp = pv2_normalize(pv2s_get(&s1, i));
+        REQUIRE(pv2_equal(pv2s_get(&s3, i), exp));
+    }
+
+    pv2 zero = pv2_zero();
+
+    REQUIRE(pv2_equal(pv2s_get(&s3, 1), zero));
+    REQUIRE(pv2_equal(pv2s_get(&s3, 9), zero));
+
+    return true;
+}
+
+TEST_CASE(test_v2s_lerp)
+{
+    pv2s_lerp(&s3, &s1, &s2, 0.3f);
+
+    for (int i = 0; i < STREAM_SIZE; i++)
+    {
+        pv2 exp = pv2_lerp(pv2s_get(&s1, i), pv2s_get(&s2, i), 0.3f);
+        REQUIRE(pv2_equal(pv2s_get(&s3, i), exp));
+    }
+
+    return true;
+}
+
+TEST_CASE(test_v2s_map)
+{
+    pt2 t = pt2_rotation(PM_PI / 3.0f);
+    pt2_translate(&t, pv2_make(1, -2));
+
+    pt2_map_stream(&s3, &t, &s1);
+
+    for (int i = 0; i < STREAM_SIZE; i++)
+    {
+        pv2 exp = pt2_map(&t, pv2s_get(&s1, i));
+        REQUIRE(pv2_equal(pv2s_get(&s3, i), exp));
+    }
+
+    return true;
+}
+
+TEST_SUITE(suite_v2s)
+{
+    pu_setup(setup, teardown);
+
+    RUN_TEST_CASE(test_v2s_get_set);
+    RUN_TEST_CASE(test_v2s_add);
+    RUN_TEST_CASE(test_v2s_sub);
+    RUN_TEST_CASE(test_v2s_scale);
+    RUN_TEST_CASE(test_v2s_add_scaled);
+    RUN_TEST_CASE(test_v2s_dot);
+    RUN_TEST_CASE(test_v2s_normalize);
+    RUN_TEST_CASE(test_v2s_lerp);
+    RUN_TEST_CASE(test_v2s_map);
+
+    pu_clear_setup();
+}
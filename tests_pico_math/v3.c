@@ -0,0 +1,101 @@
+#include "../pico_math.h"
+#include "../pico_unit.h"
+
+TEST_CASE(test_v3_equal)
+{
+    pv3 v1 = pv3_make(1, 2, 3);
+    pv3 v2 = pv3_make(1, 2, 4);
+
+    REQUIRE(pv3_equal(v1, v1));
+    REQUIRE(!pv3_equal(v1, v2));
+
+    return true;
+}
+
+TEST_CASE(test_v3_arithmetic)
+{
+    pv3 v1 = pv3_make(1, 2, 3);
+    pv3 v2 = pv3_make(4, 5, 6);
+
+    pv3 exp = pv3_make(5, 7, 9);
+    REQUIRE(pv3_equal(pv3_add(v1, v2), exp));
+
+    exp = pv3_make(-3, -3, -3);
+    REQUIRE(pv3_equal(pv3_sub(v1, v2), exp));
+
+    exp = pv3_make(2, 4, 6);
+    REQUIRE(pv3_equal(pv3_scale(v1, 2), exp));
+
+    REQUIRE(pf_equal(pv3_dot(v1, v2), 32));
+
+    return true;
+}
+
+TEST_CASE(test_v3_cross)
+{
+    pv3 x = pv3_make(1, 0, 0);
+    pv3 y = pv3_make(0, 1, 0);
+    pv3 z = pv3_make(0, 0, 1);
+
+    REQUIRE(pv3_equal(pv3_cross(x, y), z));
+    REQUIRE(pv3_equal(pv3_cross(y, z), x));
+    REQUIRE(pv3_equal(pv3_cross(z, x), y));
+
+    pv3 v1 = pv3_make(1, 2, 3);
+    pv3 v2 = pv3_make(-2, 0.5f, 4);
+    pv3 c = pv3_cross(v1, v2);
+
+    // Orthogonal to both
+    REQUIRE(pf_equal(pv3_dot(c, v1), 0));
+    REQUIRE(pf_equal(pv3_dot(c, v2), 0));
+
+    return true;
+}
+
+TEST_CASE(test_v3_normalize)
+{
+    pv3 v = pv3_make(2, 3, 6);
+
+    REQUIRE(pf_equal(pv3_len(v), 7));
+
+    pv3 exp = pv3_make(2.0f / 7.0f, 3.0f / 7.0f, 6.0f / 7.0f);
+    REQUIRE(pv3_equal(pv3_normalize(v), exp));
+
+    pv3 zero = pv3_zero();
+    REQUIRE(pv3_equal(pv3_normalize(zero), zero));
+
+    return true;
+}
+
+TEST_CASE(test_v3_lerp)
+{
+    pv3 v1 = pv3_make(0, 2, -4);
+    pv3 v2 = pv3_make(4, 2, 4);
+
+    pv3 exp = pv3_make(1, 2, -2);
+    REQUIRE(pv3_equal(pv3_lerp(v1, v2, 0.25f), exp));
+
+    return true;
+}
+
+TEST_CASE(test_v4_dot)
+{
+    pv4 v1 = pv4_make(1, 2, 3, 4);
+    pv4 v2 = pv4_make(5, 6, 7, 8);
+
+    REQUIRE(pf_equal(pv4_dot(v1, v2), 70));
+    REQUIRE(pv4_equal(v1, v1));
+    REQUIRE(!pv4_equal(v1, v2));
+
+    return true;
+}
+
+TEST_SUITE(suite_v3)
+{
+    RUN_TEST_CASE(test_v3_equal);
+    RUN_TEST_CASE(test_v3_arithmetic);
+    RUN_TEST_CASE(test_v3_cross);
+    RUN_TEST_CASE(test_v3_normalize);
+    RUN_TEST_CASE(test_v3_lerp);
+    RUN_TEST_CASE(test_v4_dot);
+}
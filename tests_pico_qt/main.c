@@ -349,6 +349,683 @@ TEST_CASE(test_grid_rects)
     return true;
 }
 
+TEST_CASE(test_build)
+{
+    enum { COUNT = 500 };
+
+    qt_rect_t  rects[COUNT];
+    qt_value_t items[COUNT];
+
+    srand(42);
+
+    for (int i = 0; i < COUNT; i++)
+    {
+        int x = random_int(-9, 9);
+        int y = random_int(-9, 9);
+        int w = random_int( 1, 10 - x);
+        int h = random_int( 1, 10 - y);
+        rects[i] = qt_make_rect(x, y, w * 0.25f, h * 0.25f);
+        items[i] = i;
+    }
+
+    // Reference tree built by individual insertions
+    qt_t* ref = qt_create(qt_make_rect(-10, -10, 20, 20), 6, NULL);
+
+    for (int i = 0; i < COUNT; i++)
+    {
+        qt_insert(ref, rects[i], items[i]);
+    }
+
+    qt_insert(qt, qt_make_rect(0, 0, 1, 1), COUNT);
+    qt_build(qt, rects, items, COUNT);
+
+    int size;
+    values = qt_query(qt, qt_make_rect(-10, -10, 20, 20), &size);
+
+    REQUIRE(size == COUNT);
+
+    qt_free(qt, values);
+
+    // Both trees return the same results
+    for (int i = 0; i < 32; i++)
+    {
+        int x = random_int(-10, 9);
+        int y = random_int(-10, 9);
+        qt_rect_t area = qt_make_rect(x, y, random_int(1, 5), random_int(1, 5));
+
+        int ref_size;
+        qt_value_t* ref_values = qt_query(ref, area, &ref_size);
+        values = qt_query(qt, area, &size);
+
+        REQUIRE(size == ref_size);
+
+        sort_values(values, size);
+        sort_values(ref_values, ref_size);
+
+        for (int j = 0; j < size; j++)
+        {
+            REQUIRE(values[j] == ref_values[j]);
+        }
+
+        qt_free(qt, values);
+        qt_free(ref, ref_values);
+    }
+
+    // The grid structure matches as well
+    int grid_size, ref_grid_size;
+    qt_rect_t* rects_grid = qt_grid_rects(qt, &grid_size);
+    qt_rect_t* ref_grid = qt_grid_rects(ref, &ref_grid_size);
+
+    REQUIRE(grid_size == ref_grid_size);
+
+    for (int i = 0; i < grid_size; i++)
+    {
+        REQUIRE(rect_in_array(ref_grid, ref_grid_size, rects_grid[i]));
+    }
+
+    qt_free(qt, rects_grid);
+    qt_free(ref, ref_grid);
+
+    qt_destroy(ref);
+
+    return true;
+}
+
+static bool value_in_query(qt_t* tree, qt_rect_t area, qt_value_t value)
+{
+    int size;
+    qt_value_t* results = qt_query(tree, area, &size);
+
+    bool found = false;
+
+    for (int i = 0; i < size; i++)
+    {
+        if (results[i] == value)
+            found = true;
+    }
+
+    qt_free(tree, results);
+
+    return found;
+}
+
+TEST_CASE(test_update)
+{
+    qt_insert(qt, qt_make_rect(-9, -9, 1, 1), 0);
+    qt_insert(qt, qt_make_rect( 5,  5, 1, 1), 1);
+
+    // Moving within the same node
+    REQUIRE(qt_update(qt, 0, qt_make_rect(-8, -8, 1, 1)));
+    REQUIRE(value_in_query(qt, qt_make_rect(-8, -8, 0.5f, 0.5f), 0));
+    REQUIRE(!value_in_query(qt, qt_make_rect(-9, -9, 0.5f, 0.5f), 0));
+
+    // Moving across the tree
+    REQUIRE(qt_update(qt, 0, qt_make_rect(7, -9, 1, 1)));
+    REQUIRE(value_in_query(qt, qt_make_rect(7, -9, 0.5f, 0.5f), 0));
+    REQUIRE(!value_in_query(qt, qt_make_rect(-8, -8, 0.5f, 0.5f), 0));
+
+    // Unknown values are not updated
+    REQUIRE(!qt_update(qt, 2, qt_make_rect(0, 0, 1, 1)));
+
+    return true;
+}
+
+TEST_CASE(test_value_index)
+{
+    enum { COUNT = 256 };
+
+    qt_rect_t rects[COUNT];
+
+    srand(42);
+
+    for (int i = 0; i < COUNT; i++)
+    {
+        rects[i] = qt_make_rect(random_int(-10, 8), random_int(-10, 8), 1, 1);
+
+        // Some items are inserted before the index exists
+        if (i == COUNT / 2)
+            qt_enable_value_index(qt);
+
+        qt_insert(qt, rects[i], i);
+    }
+
+    // Move every item a few times
+    for (int k = 0; k < 4; k++)
+    {
+        for (int i = 0; i < COUNT; i++)
+        {
+            rects[i] = qt_make_rect(random_int(-10, 8) + 0.5f, random_int(-10, 8), 0.25f, 1);
+            REQUIRE(qt_update(qt, i, rects[i]));
+        }
+    }
+
+    for (int i = 0; i < COUNT; i++)
+    {
+        REQUIRE(value_in_query(qt, rects[i], i));
+    }
+
+    // Remove every other item
+    for (int i = 0; i < COUNT; i += 2)
+    {
+        REQUIRE(qt_remove(qt, i));
+        REQUIRE(!qt_remove(qt, i));
+    }
+
+    int size;
+    values = qt_query(qt, qt_make_rect(-10, -10, 20, 20), &size);
+
+    REQUIRE(size == COUNT / 2);
+
+    sort_values(values, size);
+
+    for (int i = 0; i < size; i++)
+    {
+        REQUIRE(values[i] == (qt_value_t)(2 * i + 1));
+    }
+
+    qt_free(qt, values);
+
+    // The index survives rebuilding the tree
+    qt_clean(qt);
+
+    REQUIRE(qt_update(qt, 1, qt_make_rect(0, 0, 1, 1)));
+    REQUIRE(value_in_query(qt, qt_make_rect(0, 0, 1, 1), 1));
+
+    qt_clear(qt);
+
+    REQUIRE(!qt_remove(qt, 1));
+
+    return true;
+}
+
+typedef struct
+{
+    int count;
+    int limit;
+} visit_state_t;
+
+static bool visit_value(qt_value_t value, void* udata)
+{
+    (void)value;
+
+    visit_state_t* state = (visit_state_t*)udata;
+    state->count++;
+
+    return state->count < state->limit;
+}
+
+TEST_CASE(test_query_into)
+{
+    srand(42);
+
+    for (int i = 0; i < 32; i++)
+    {
+        int x = random_int(-9, 9);
+        int y = random_int(-9, 9);
+        int w = random_int( 1, 10 - x);
+        int h = random_int( 1, 10 - y);
+        qt_insert(qt, qt_make_rect(x, y, w, h), i);
+    }
+
+    qt_value_t buffer[32];
+
+    // Matches the allocating query
+    for (int i = 0; i < 16; i++)
+    {
+        qt_rect_t area = qt_make_rect(random_int(-10, 9), random_int(-10, 9), 3, 3);
+
+        int size;
+        values = qt_query(qt, area, &size);
+
+        REQUIRE(qt_query_into(qt, area, buffer, 32) == size);
+
+        sort_values(values, size);
+        sort_values(buffer, size);
+
+        for (int j = 0; j < size; j++)
+        {
+            REQUIRE(buffer[j] == values[j]);
+        }
+
+        qt_free(qt, values);
+    }
+
+    // A short buffer receives as many values as fit
+    qt_rect_t all = qt_make_rect(-10, -10, 20, 20);
+
+    REQUIRE(qt_query_into(qt, all, NULL, 0) == 32);
+    REQUIRE(qt_query_into(qt, all, buffer, 4) == 32);
+
+    // Visiting stops early
+    visit_state_t state = { 0, 5 };
+
+    REQUIRE(!qt_query_visit(qt, all, visit_value, &state));
+    REQUIRE(state.count == 5);
+
+    state = (visit_state_t){ 0, 100 };
+
+    REQUIRE(qt_query_visit(qt, all, visit_value, &state));
+    REQUIRE(state.count == 32);
+
+    return true;
+}
+
+static bool rects_overlap(qt_rect_t r1, qt_rect_t r2)
+{
+    return r1.x + r1.w >= r2.x &&
+           r1.y + r1.h >= r2.y &&
+           r2.x + r2.w >= r1.x &&
+           r2.y + r2.h >= r1.y;
+}
+
+TEST_CASE(test_query_leaf)
+{
+    enum { COUNT = 37 };
+
+    // A tree of depth one keeps all items in a single node
+    qt_t* flat = qt_create(qt_make_rect(-10, -10, 20, 20), 1, NULL);
+
+    qt_rect_t rects[COUNT];
+
+    srand(7);
+
+    for (int i = 0; i < COUNT; i++)
+    {
+        rects[i] = qt_make_rect(random_int(-10, 8), random_int(-10, 8), random_int(0, 3), random_int(0, 3));
+        qt_insert(flat, rects[i], i);
+    }
+
+    qt_value_t buffer[COUNT];
+
+    for (int k = 0; k < 64; k++)
+    {
+        qt_rect_t area = qt_make_rect(random_int(-10, 9), random_int(-10, 9), random_int(0, 4), random_int(0, 4));
+
+        int expected = 0;
+
+        for (int i = 0; i < COUNT; i++)
+        {
+            if (rects_overlap(area, rects[i]))
+                expected++;
+        }
+
+        int size = qt_query_into(flat, area, buffer, COUNT);
+
+        REQUIRE(size == expected);
+
+        for (int i = 0; i < size; i++)
+        {
+            REQUIRE(rects_overlap(area, rects[buffer[i]]));
+        }
+    }
+
+    qt_destroy(flat);
+
+    return true;
+}
+
+static int parallel_calls = 0;
+
+// Runs tasks in reverse order to catch any dependence on ordering
+static void reverse_parallel(qt_task_fn task, void* data, int count, void* udata)
+{
+    (void)udata;
+
+    parallel_calls++;
+
+    for (int i = count - 1; i >= 0; i--)
+    {
+        task(data, i);
+    }
+}
+
+TEST_CASE(test_query_batch)
+{
+    enum { AREA_COUNT = 16 };
+
+    srand(42);
+
+    for (int i = 0; i < 64; i++)
+    {
+        qt_insert(qt, qt_make_rect(random_int(-10, 8), random_int(-10, 8), 1, 1), i);
+    }
+
+    qt_rect_t areas[AREA_COUNT];
+
+    for (int i = 0; i < AREA_COUNT; i++)
+    {
+        areas[i] = qt_make_rect(random_int(-10, 6), random_int(-10, 6), 4, 4);
+    }
+
+    int offsets[AREA_COUNT + 1];
+
+    // Sizing pass
+    int total = qt_query_batch(qt, areas, AREA_COUNT, offsets, NULL, 0, NULL, NULL);
+
+    REQUIRE(total > 0);
+    REQUIRE(offsets[AREA_COUNT] == total);
+
+    qt_value_t* results = malloc(sizeof(qt_value_t) * total);
+
+    parallel_calls = 0;
+
+    REQUIRE(total == qt_query_batch(qt, areas, AREA_COUNT, offsets, results, total,
+                                    reverse_parallel, NULL));
+    REQUIRE(parallel_calls == 2);
+
+    // Each row matches an individual query
+    qt_value_t buffer[64];
+
+    for (int i = 0; i < AREA_COUNT; i++)
+    {
+        int size = qt_query_into(qt, areas[i], buffer, 64);
+        int row  = offsets[i + 1] - offsets[i];
+
+        REQUIRE(size == row);
+
+        sort_values(buffer, size);
+        sort_values(results + offsets[i], row);
+
+        for (int j = 0; j < size; j++)
+        {
+            REQUIRE(buffer[j] == results[offsets[i] + j]);
+        }
+    }
+
+    free(results);
+
+    return true;
+}
+
+static float rect_dist_sq(qt_rect_t r, float x, float y)
+{
+    float dx = fmaxf(fmaxf(r.x - x, 0), x - (r.x + r.w));
+    float dy = fmaxf(fmaxf(r.y - y, 0), y - (r.y + r.h));
+    return dx * dx + dy * dy;
+}
+
+TEST_CASE(test_query_radius_nearest)
+{
+    enum { COUNT = 128, K = 5 };
+
+    qt_rect_t rects[COUNT];
+
+    srand(42);
+
+    for (int i = 0; i < COUNT; i++)
+    {
+        rects[i] = qt_make_rect(random_int(-10, 9), random_int(-10, 9), random_int(0, 2) * 0.5f, 0.5f);
+        qt_insert(qt, rects[i], i);
+    }
+
+    qt_value_t buffer[COUNT];
+    qt_value_t nearest[K];
+    qt_float   dist_sq[K];
+
+    for (int k = 0; k < 16; k++)
+    {
+        float x = random_int(-10, 10) + 0.25f;
+        float y = random_int(-10, 10) + 0.25f;
+        float radius = random_int(0, 6) * 0.5f;
+
+        // Radius query against brute force
+        int expected = 0;
+
+        for (int i = 0; i < COUNT; i++)
+        {
+            if (rect_dist_sq(rects[i], x, y) <= radius * radius)
+                expected++;
+        }
+
+        int size = qt_query_radius(qt, x, y, radius, buffer, COUNT);
+
+        REQUIRE(size == expected);
+
+        for (int i = 0; i < size; i++)
+        {
+            REQUIRE(rect_dist_sq(rects[buffer[i]], x, y) <= radius * radius);
+        }
+
+        // Nearest query: results are sorted, and no other item is closer
+        // than the furthest result
+        REQUIRE(qt_query_nearest(qt, x, y, K, nearest, dist_sq) == K);
+
+        for (int i = 0; i < K; i++)
+        {
+            REQUIRE(dist_sq[i] == rect_dist_sq(rects[nearest[i]], x, y));
+
+            if (i > 0)
+                REQUIRE(dist_sq[i - 1] <= dist_sq[i]);
+        }
+
+        int closer = 0;
+
+        for (int i = 0; i < COUNT; i++)
+        {
+            if (rect_dist_sq(rects[i], x, y) < dist_sq[K - 1])
+                closer++;
+        }
+
+        REQUIRE(closer < K);
+    }
+
+    // Asking for more items than the tree holds
+    qt_t* small = qt_create(qt_make_rect(-10, -10, 20, 20), 6, NULL);
+    qt_insert(small, qt_make_rect(1, 1, 1, 1), 7);
+
+    REQUIRE(qt_query_nearest(small, 0, 0, K, nearest, dist_sq) == 1);
+    REQUIRE(nearest[0] == 7);
+    REQUIRE(dist_sq[0] == 2);
+
+    qt_destroy(small);
+
+    return true;
+}
+
+TEST_CASE(test_linear)
+{
+    enum { COUNT = 256 };
+
+    qt_rect_t  rects[COUNT];
+    qt_value_t ids[COUNT];
+
+    srand(7);
+
+    for (int i = 0; i < COUNT; i++)
+    {
+        rects[i] = qt_make_rect(random_int(-10, 9), random_int(-10, 9), random_int(0, 4) * 0.5f, random_int(0, 4) * 0.5f);
+        ids[i] = i;
+        qt_insert(qt, rects[i], ids[i]);
+    }
+
+    // Leave some empty subtrees behind
+    for (int i = 0; i < COUNT; i += 3)
+    {
+        REQUIRE(qt_remove(qt, ids[i]));
+    }
+
+    qt_linear_t* lqt = qt_linear_create(qt);
+    qt_linear_t* built = qt_linear_build(qt_make_rect(-10, -10, 20, 20), 6, rects, ids, COUNT, NULL);
+
+    qt_value_t expected[COUNT];
+    qt_value_t actual[COUNT];
+
+    for (int k = 0; k < 32; k++)
+    {
+        qt_rect_t area = qt_make_rect(random_int(-12, 10), random_int(-12, 10), random_int(0, 12), random_int(0, 12));
+
+        // Linear copy against the source tree
+        int size = qt_query_into(qt, area, expected, COUNT);
+
+        REQUIRE(qt_linear_query_into(lqt, area, actual, COUNT) == size);
+
+        sort_values(expected, size);
+        sort_values(actual, size);
+
+        for (int i = 0; i < size; i++)
+        {
+            REQUIRE(expected[i] == actual[i]);
+        }
+
+        // Bulk-loaded linear tree against brute force
+        int total = 0;
+
+        for (int i = 0; i < COUNT; i++)
+        {
+            if (rects_overlap(area, rects[i]))
+                total++;
+        }
+
+        REQUIRE(qt_linear_query_into(built, area, NULL, 0) == total);
+    }
+
+    qt_linear_destroy(lqt);
+    qt_linear_destroy(built);
+
+    // An empty tree
+    qt_reset(qt);
+
+    lqt = qt_linear_create(qt);
+
+    REQUIRE(qt_linear_query_into(lqt, qt_make_rect(-10, -10, 20, 20), NULL, 0) == 0);
+
+    qt_linear_destroy(lqt);
+
+    return true;
+}
+
+TEST_CASE(test_loose)
+{
+    enum { COUNT = 256 };
+
+    qt_t* tight = qt_create(qt_make_rect(-10, -10, 20, 20), 6, NULL);
+    qt_t* loose = qt_create_loose(qt_make_rect(-10, -10, 20, 20), 6, 2, NULL);
+
+    // Small items straddling the center stay in the root of a regular tree,
+    // but not in the root of a loose tree
+    qt_insert(tight, qt_make_rect(-0.25f, -0.25f, 0.5f, 0.5f), 0);
+    qt_insert(loose, qt_make_rect(-0.25f, -0.25f, 0.5f, 0.5f), 0);
+
+    REQUIRE(tight->root->items.count == 1);
+    REQUIRE(loose->root->items.count == 0);
+
+    // Items larger than the tree still end up in the root
+    qt_insert(loose, qt_make_rect(-10, -10, 20, 20), 1);
+
+    REQUIRE(loose->root->items.count == 1);
+
+    qt_destroy(tight);
+    qt_reset(loose);
+
+    qt_rect_t rects[COUNT];
+
+    srand(11);
+
+    for (int i = 0; i < COUNT; i++)
+    {
+        rects[i] = qt_make_rect(random_int(-10, 9), random_int(-10, 9), random_int(0, 8) * 0.5f, random_int(0, 8) * 0.5f);
+        qt_insert(loose, rects[i], i);
+    }
+
+    // Move some of the items around
+    qt_enable_value_index(loose);
+
+    for (int i = 0; i < COUNT; i += 4)
+    {
+        rects[i].x = random_int(-10, 9);
+        rects[i].y = random_int(-10, 9);
+        REQUIRE(qt_update(loose, i, rects[i]));
+    }
+
+    qt_value_t buffer[COUNT];
+
+    for (int k = 0; k < 32; k++)
+    {
+        qt_rect_t area = qt_make_rect(random_int(-12, 10), random_int(-12, 10), random_int(0, 12), random_int(0, 12));
+
+        int expected = 0;
+
+        for (int i = 0; i < COUNT; i++)
+        {
+            if (rects_overlap(area, rects[i]))
+                expected++;
+        }
+
+        int size = qt_query_into(loose, area, buffer, COUNT);
+
+        REQUIRE(size == expected);
+
+        for (int i = 0; i < size; i++)
+        {
+            REQUIRE(rects_overlap(area, rects[buffer[i]]));
+        }
+    }
+
+    qt_destroy(loose);
+
+    return true;
+}
+
+TEST_CASE(test_find_pairs)
+{
+    enum { COUNT = 96, MAX_PAIRS = COUNT * COUNT };
+
+    static qt_rect_t rects[COUNT];
+    static qt_pair_t pairs[MAX_PAIRS];
+    static bool      found[COUNT][COUNT];
+
+    // Items of sibling subtrees only overlap along shared edges in a regular
+    // tree, but across wide regions in a loose tree
+    qt_t* loose = qt_create_loose(qt_make_rect(-10, -10, 20, 20), 6, 2, NULL);
+
+    srand(5);
+
+    for (int i = 0; i < COUNT; i++)
+    {
+        rects[i] = qt_make_rect(random_int(-10, 9), random_int(-10, 9), random_int(0, 6) * 0.5f, random_int(0, 6) * 0.5f);
+        qt_insert(qt, rects[i], i);
+        qt_insert(loose, rects[i], i);
+    }
+
+    int expected = 0;
+
+    for (int i = 0; i < COUNT; i++)
+    {
+        for (int j = i + 1; j < COUNT; j++)
+        {
+            if (rects_overlap(rects[i], rects[j]))
+                expected++;
+        }
+    }
+
+    qt_t* trees[2] = { qt, loose };
+
+    for (int k = 0; k < 2; k++)
+    {
+        REQUIRE(qt_find_pairs(trees[k], NULL, 0) == expected);
+        REQUIRE(qt_find_pairs(trees[k], pairs, MAX_PAIRS) == expected);
+
+        // Every pair overlaps and is reported once
+        memset(found, 0, sizeof(found));
+
+        for (int i = 0; i < expected; i++)
+        {
+            qt_value_t a = pairs[i].a;
+            qt_value_t b = pairs[i].b;
+
+            REQUIRE(a != b);
+            REQUIRE(rects_overlap(rects[a], rects[b]));
+            REQUIRE(!found[a][b] && !found[b][a]);
+
+            found[a][b] = true;
+        }
+    }
+
+    qt_destroy(loose);
+
+    return true;
+}
+
 static TEST_SUITE(suite_qt)
 {
     RUN_TEST_CASE(test_insert_single);
@@ -361,6 +1038,16 @@ static TEST_SUITE(suite_qt)
     RUN_TEST_CASE(test_clear);
     RUN_TEST_CASE(test_clean);
     RUN_TEST_CASE(test_grid_rects);
+    RUN_TEST_CASE(test_build);
+    RUN_TEST_CASE(test_update);
+    RUN_TEST_CASE(test_value_index);
+    RUN_TEST_CASE(test_query_into);
+    RUN_TEST_CASE(test_query_leaf);
+    RUN_TEST_CASE(test_query_batch);
+    RUN_TEST_CASE(test_query_radius_nearest);
+    RUN_TEST_CASE(test_linear);
+    RUN_TEST_CASE(test_loose);
+    RUN_TEST_CASE(test_find_pairs);
 }
 
 void setup(void)
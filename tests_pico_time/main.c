@@ -4,6 +4,8 @@
 #define PICO_UNIT_IMPLEMENTATION
 #include "../pico_unit.h"
 
+#include <string.h>
+
 TEST_CASE(test_sleep)
 {
     ptime_t before = pt_now();
@@ -54,6 +56,131 @@ TEST_CASE(test_sec)
     return true;
 }
 
+TEST_CASE(test_ticks)
+{
+    pt_calibrate_ticks(pt_from_msec(50));
+
+    uint64_t before = pt_ticks();
+    pt_sleep(pt_from_msec(100));
+    uint64_t after = pt_ticks();
+
+    REQUIRE(after > before);
+
+    // Generous bounds, the sleep may overshoot on a busy machine
+    REQUIRE(pt_to_msec(pt_from_ticks(after - before)) >= 90);
+    REQUIRE(pt_to_msec(pt_from_ticks(after - before)) < 1000);
+    REQUIRE(pt_ticks_to_sec(after - before) >= 0.09);
+
+    return true;
+}
+
+TEST_CASE(test_zones)
+{
+    const pt_zone_t* zones = NULL;
+
+    pt_clear_zones();
+
+    pt_zone_begin("frame");
+        pt_zone_begin("update");
+        pt_zone_end();
+        pt_zone_begin("render");
+            pt_zone_begin("pass");
+            pt_zone_end();
+        pt_zone_end();
+    pt_zone_end();
+
+    REQUIRE(pt_get_zones(&zones) == 4);
+
+    REQUIRE(0 == strcmp(zones[0].name, "frame"));
+    REQUIRE(0 == strcmp(zones[1].name, "update"));
+    REQUIRE(0 == strcmp(zones[2].name, "render"));
+    REQUIRE(0 == strcmp(zones[3].name, "pass"));
+
+    REQUIRE(zones[0].depth == 0);
+    REQUIRE(zones[1].depth == 1);
+    REQUIRE(zones[2].depth == 1);
+    REQUIRE(zones[3].depth == 2);
+
+    // Children are contained in their parents
+    REQUIRE(zones[0].start <= zones[1].start && zones[1].end <= zones[0].end);
+    REQUIRE(zones[2].start <= zones[3].start && zones[3].end <= zones[2].end);
+    REQUIRE(zones[1].end <= zones[2].start);
+
+    // Open zones survive clearing
+    pt_zone_begin("open");
+    pt_clear_zones();
+
+    REQUIRE(pt_get_zones(&zones) == 1);
+    REQUIRE(zones[0].end == 0);
+
+    pt_zone_end();
+
+    REQUIRE(zones[0].end >= zones[0].start);
+
+    pt_clear_zones();
+
+    REQUIRE(pt_get_zones(&zones) == 0);
+
+    // Zones that do not fit are counted
+    for (int i = 0; i < PICO_TIME_MAX_ZONES + 10; i++)
+    {
+        pt_zone_begin("zone");
+        pt_zone_end();
+    }
+
+    REQUIRE(pt_get_zones(&zones) == PICO_TIME_MAX_ZONES);
+    REQUIRE(pt_get_dropped_zones() == 10);
+
+    pt_clear_zones();
+
+    REQUIRE(pt_get_dropped_zones() == 0);
+
+    return true;
+}
+
+TEST_CASE(test_limiter)
+{
+    pt_limiter_t limiter;
+    pt_limiter_stats_t stats;
+
+    ptime_t period = pt_from_msec(10);
+
+    ptime_t start = pt_now();
+
+    pt_init_limiter(&limiter, period);
+
+    for (int i = 0; i < 20; i++)
+    {
+        pt_wait_frame(&limiter);
+    }
+
+    ptime_t elapsed = pt_now() - start;
+
+    // Deadlines do not drift, but the machine may be busy
+    REQUIRE(elapsed >= 20 * period);
+    REQUIRE(elapsed < 30 * period);
+
+    pt_get_limiter_stats(&limiter, &stats);
+
+    REQUIRE(stats.frames == 20);
+    REQUIRE(stats.max_jitter >= stats.mean_jitter);
+    REQUIRE(stats.margin <= period);
+
+    // A frame that overruns its deadline is missed
+    pt_reset_limiter_stats(&limiter);
+    pt_sleep(3 * period);
+
+    REQUIRE(pt_wait_frame(&limiter) >= 3 * period);
+
+    pt_get_limiter_stats(&limiter, &stats);
+
+    REQUIRE(stats.frames == 1);
+    REQUIRE(stats.missed == 1);
+    REQUIRE(stats.max_jitter >= 2 * period);
+
+    return true;
+}
+
 int main (int argc, char* argv[])
 {
     (void)argc;
@@ -64,6 +191,9 @@ int main (int argc, char* argv[])
     RUN_TEST_CASE(test_usec);
     RUN_TEST_CASE(test_msec);
     RUN_TEST_CASE(test_sec);
+    RUN_TEST_CASE(test_ticks);
+    RUN_TEST_CASE(test_zones);
+    RUN_TEST_CASE(test_limiter);
     pu_print_stats();
 
     return pu_test_failed();